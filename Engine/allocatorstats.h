@@ -0,0 +1,53 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	allocatorstats.h
+//
+// summary:	Declares the allocator statistics structure
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _ALLOCATORSTATS_H_
+#define _ALLOCATORSTATS_H_
+
+// System Includes.
+#include <cstddef>
+
+// Globals.
+const size_t DEFAULT_ALIGNMENT = 16;
+const size_t ALLOCATOR_BENCHMARK_SIZE = 64;
+const int ALLOCATOR_BENCHMARK_ALLOCATIONS = 4096;
+const int ALLOCATOR_BENCHMARK_ROUNDS = 1000;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Usage counters shared by every engine allocator. The "peak" is the largest amount in use
+/// 	since the last Reset (for the frame allocator, the busiest point of the current frame),
+/// 	while the "high water mark" is the largest amount ever in use since Initialize. Comparing
+/// 	the high water mark with the capacity tells us how much headroom an allocator really has.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct AllocatorStats
+{
+	size_t capacity;
+	size_t used;
+	size_t peak;
+	size_t highWaterMark;
+	unsigned long allocationCount;
+	unsigned long totalAllocations;
+	unsigned long failedAllocations;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	What an allocator benchmark checked and measured, the milliseconds of a round of
+/// 	allocations with the allocator and with new and delete.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct AllocatorBenchmark
+{
+	int allocations;
+	int rounds;
+	int checks;
+	int failures;
+	double allocatorMs;
+	double heapMs;
+};
+
+#endif
@@ -0,0 +1,452 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	assetloaderclass.cpp
+//
+// summary:	Implements the assetloaderclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "assetloaderclass.h"
+
+// Includes.
+#include "profilerclass.h"
+#include "scratchallocatorclass.h"
+#include "logclass.h"
+#include "taskgraphclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+AssetLoaderClass::AssetLoaderClass()
+{
+	m_fileSystem = 0;
+	m_pending = 0;
+	m_running = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+AssetLoaderClass::AssetLoaderClass(const AssetLoaderClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+AssetLoaderClass::~AssetLoaderClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts the I/O thread and the workers. </summary>
+///
+/// <param name="fileSystem"> The file system the files are read through. </param>
+/// <param name="workers">	  The number of decode threads. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AssetLoaderClass::Initialize(FileSystemClass* fileSystem, int workers)
+{
+	int i;
+
+	if(m_running || !fileSystem || workers < 1)
+	{
+		return false;
+	}
+
+	m_fileSystem = fileSystem;
+
+	m_pending = 0;
+	m_running = true;
+
+	m_ioThread = thread(&AssetLoaderClass::IoThread, this);
+	for(i=0; i<workers; i++)
+	{
+		m_workerThreads.push_back(thread(&AssetLoaderClass::WorkerThread, this));
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Stops the threads and drops the loads still in flight. The read or decode running at the
+/// 	time is finished first, so the owners of the assets can be shut down after this.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void AssetLoaderClass::Shutdown()
+{
+	unsigned int i;
+
+	if(!m_running)
+	{
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_lock);
+		m_running = false;
+	}
+	m_ioWake.notify_all();
+	m_workerWake.notify_all();
+	m_uploadWake.notify_all();
+
+	m_ioThread.join();
+	for(i=0; i<m_workerThreads.size(); i++)
+	{
+		m_workerThreads[i].join();
+	}
+	m_workerThreads.clear();
+
+	if(m_pending > 0)
+	{
+		LOG_WARNING(LOG_CATEGORY_RESOURCE, "%d asset loads were still in flight at shutdown.", m_pending);
+	}
+
+	// Release the requests.
+	for(i=0; i<m_requests.size(); i++)
+	{
+		delete m_requests[i];
+	}
+	m_requests.clear();
+	m_readQueue.clear();
+	m_decodeQueue.clear();
+	m_uploadQueue.clear();
+	m_pending = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts loading an asset, the call returns before anything is read. </summary>
+///
+/// <param name="filename"> Filename of the file. </param>
+/// <param name="decode">   Turns the bytes of the file into the asset, runs on a worker. </param>
+/// <param name="upload">   Swaps the asset in, runs on the render thread during Update. </param>
+///
+/// <returns> The handle of the load, -1 if the loader isn't running. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int AssetLoaderClass::Load(const char* filename, const function<bool(const vector<char>&)>& decode, const function<bool()>& upload)
+{
+	AssetRequest* request;
+	int handle;
+
+	if(!filename)
+	{
+		return -1;
+	}
+
+	request = new AssetRequest;
+	if(!request)
+	{
+		return -1;
+	}
+
+	request->filename = filename;
+	request->decode = decode;
+	request->upload = upload;
+	request->state = ASSET_READING;
+	request->requested = ProfilerClass::GetTimestamp();
+	request->finished = 0;
+
+	{
+		lock_guard<mutex> lock(m_lock);
+		if(!m_running)
+		{
+			delete request;
+			return -1;
+		}
+
+		handle = (int)m_requests.size();
+		m_requests.push_back(request);
+		m_readQueue.push_back(handle);
+		m_pending++;
+	}
+	m_ioWake.notify_one();
+
+	return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the stage a load is at. </summary>
+///
+/// <param name="handle"> The handle of the load. </param>
+///
+/// <returns> The state, failed for an unknown handle. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+AssetState AssetLoaderClass::GetState(int handle)
+{
+	lock_guard<mutex> lock(m_lock);
+
+	if(handle < 0 || handle >= (int)m_requests.size())
+	{
+		return ASSET_FAILED;
+	}
+
+	return m_requests[handle]->state;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if a load has been swapped in. </summary>
+///
+/// <param name="handle"> The handle of the load. </param>
+///
+/// <returns> true if the asset is ready, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AssetLoaderClass::IsReady(int handle)
+{
+	return GetState(handle) == ASSET_READY;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Blocks until a load is finished, doing the uploads meanwhile. Only for the render thread,
+/// 	and only where stalling is fine, like tools or a loading screen.
+/// </summary>
+///
+/// <param name="handle"> The handle of the load. </param>
+///
+/// <returns> true if the asset is ready, false if the load failed. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool AssetLoaderClass::Wait(int handle)
+{
+	AssetState state;
+
+	PROFILE_FUNCTION();
+
+	if(handle < 0)
+	{
+		return false;
+	}
+
+	state = GetState(handle);
+	while(state != ASSET_READY && state != ASSET_FAILED)
+	{
+		// Nothing to upload yet, sleep until a worker queues something.
+		{
+			unique_lock<mutex> lock(m_lock);
+			while(m_running && m_uploadQueue.empty() && m_requests[handle]->state != ASSET_READY && m_requests[handle]->state != ASSET_FAILED)
+			{
+				m_uploadWake.wait(lock);
+			}
+
+			if(!m_running)
+			{
+				return false;
+			}
+		}
+
+		Update(0.0f);
+		state = GetState(handle);
+	}
+
+	return state == ASSET_READY;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Runs the uploads that are ready, on the render thread, until the budget is spent. At least
+/// 	one upload runs every call so a slow one can't be put off forever.
+/// </summary>
+///
+/// <param name="budgetMs"> The time to spend, in ms. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void AssetLoaderClass::Update(float budgetMs)
+{
+	AssetRequest* request;
+	unsigned long long start;
+	bool result;
+	int handle;
+
+	PROFILE_FUNCTION();
+
+	start = ProfilerClass::GetTimestamp();
+	for(;;)
+	{
+		{
+			lock_guard<mutex> lock(m_lock);
+			if(m_uploadQueue.empty())
+			{
+				return;
+			}
+
+			handle = m_uploadQueue.front();
+			m_uploadQueue.pop_front();
+			request = m_requests[handle];
+		}
+
+		{
+			PROFILE_ZONE("AssetLoaderClass::Upload");
+
+			result = request->upload ? request->upload() : true;
+		}
+
+		if(!result)
+		{
+			LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not upload asset %s.", request->filename.c_str());
+		}
+
+		Finish(request, result ? ASSET_READY : ASSET_FAILED);
+
+		if(ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start) >= budgetMs)
+		{
+			return;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of loads not finished yet. </summary>
+///
+/// <returns> The pending count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int AssetLoaderClass::GetPendingCount()
+{
+	lock_guard<mutex> lock(m_lock);
+
+	return m_pending;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Reads the queued files one at a time. A single thread keeps the reads in order, which is
+/// 	what a disk wants, and the decode of one file overlaps the read of the next.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void AssetLoaderClass::IoThread()
+{
+	AssetRequest* request;
+	bool result;
+	int handle;
+
+	for(;;)
+	{
+		{
+			unique_lock<mutex> lock(m_lock);
+			while(m_running && m_readQueue.empty())
+			{
+				m_ioWake.wait(lock);
+			}
+
+			if(!m_running)
+			{
+				break;
+			}
+
+			handle = m_readQueue.front();
+			m_readQueue.pop_front();
+			request = m_requests[handle];
+		}
+
+		{
+			PROFILE_ZONE("AssetLoaderClass::Read");
+
+			result = m_fileSystem->ReadFile(request->filename.c_str(), request->data);
+		}
+
+		if(!result)
+		{
+			LOG_WARNING(LOG_CATEGORY_RESOURCE, "Could not read asset %s, keeping its placeholder.", request->filename.c_str());
+			Finish(request, ASSET_FAILED);
+			continue;
+		}
+
+		// Hand it to the workers.
+		{
+			lock_guard<mutex> lock(m_lock);
+			request->state = ASSET_DECODING;
+			m_decodeQueue.push_back(handle);
+		}
+		m_workerWake.notify_one();
+	}
+
+	// Hand the scratch stack and the rings of this thread back.
+	TaskGraphClass::ShutdownThread();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Decodes the files that were read and queues them for upload. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void AssetLoaderClass::WorkerThread()
+{
+	AssetRequest* request;
+	bool result;
+	int handle;
+
+	// The decoders may use the scratch stack.
+	ScratchAllocatorClass::InitializeThread();
+
+	for(;;)
+	{
+		{
+			unique_lock<mutex> lock(m_lock);
+			while(m_running && m_decodeQueue.empty())
+			{
+				m_workerWake.wait(lock);
+			}
+
+			if(!m_running)
+			{
+				break;
+			}
+
+			handle = m_decodeQueue.front();
+			m_decodeQueue.pop_front();
+			request = m_requests[handle];
+		}
+
+		{
+			PROFILE_ZONE("AssetLoaderClass::Decode");
+
+			result = request->decode ? request->decode(request->data) : true;
+		}
+
+		// The bytes of the file aren't needed past the decode.
+		vector<char>().swap(request->data);
+
+		if(!result)
+		{
+			LOG_WARNING(LOG_CATEGORY_RESOURCE, "Could not decode asset %s, keeping its placeholder.", request->filename.c_str());
+			Finish(request, ASSET_FAILED);
+			continue;
+		}
+
+		{
+			lock_guard<mutex> lock(m_lock);
+			request->state = ASSET_UPLOADING;
+			m_uploadQueue.push_back(handle);
+		}
+		m_uploadWake.notify_all();
+	}
+
+	// Hand the scratch stack and the rings of this thread back.
+	TaskGraphClass::ShutdownThread();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Marks a load finished and wakes whoever waits on it. </summary>
+///
+/// <param name="request"> The load. </param>
+/// <param name="state">   Ready or failed. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void AssetLoaderClass::Finish(AssetRequest* request, AssetState state)
+{
+	{
+		lock_guard<mutex> lock(m_lock);
+		request->state = state;
+		request->finished = ProfilerClass::GetTimestamp();
+		m_pending--;
+	}
+	m_uploadWake.notify_all();
+
+	if(state == ASSET_READY)
+	{
+		LOG_INFO(LOG_CATEGORY_RESOURCE, "Asset %s ready %.1f ms after it was requested.", request->filename.c_str(), ProfilerClass::TicksToMilliseconds(request->finished - request->requested));
+	}
+
+	return;
+}
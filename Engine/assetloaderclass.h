@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	assetloaderclass.h
+//
+// summary:	Declares the assetloaderclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _ASSETLOADERCLASS_H_
+#define _ASSETLOADERCLASS_H_
+
+// System Includes.
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "filesystemclass.h"
+
+// Globals.
+const int ASSET_LOADER_WORKERS = 2;
+const float ASSET_LOADER_UPLOAD_BUDGET_MS = 2.0f;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the stages a load goes through. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum AssetState
+{
+	ASSET_READING,
+	ASSET_DECODING,
+	ASSET_UPLOADING,
+	ASSET_READY,
+	ASSET_FAILED
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	One load. Decode runs on a worker with the bytes of the file, upload runs on the render
+/// 	thread once decode succeeded; requested and finished are profiler time stamps.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct AssetRequest
+{
+	string filename;
+	function<bool(const vector<char>&)> decode;
+	function<bool()> upload;
+	vector<char> data;
+	AssetState state;
+	unsigned long long requested;
+	unsigned long long finished;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Loads assets without ever blocking the frame. Load returns a handle straight away and the
+/// 	asset goes through three stages, each on the thread suited to it: the file is read through
+/// 	the file system on the I/O thread, decoded on a worker, and uploaded on the render thread
+/// 	by Update, which only spends a time budget on it every frame. The handle can be polled
+/// 	with GetState, or waited on with Wait, which keeps doing the uploads while it waits.
+///
+/// 	The owner of the asset keeps drawing its placeholder until the upload swaps the real one
+/// 	in. A load that fails at any stage only logs it, the placeholder stays.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class AssetLoaderClass
+{
+public:
+	AssetLoaderClass();
+	AssetLoaderClass(const AssetLoaderClass&);
+	~AssetLoaderClass();
+
+	bool Initialize(FileSystemClass*, int = ASSET_LOADER_WORKERS);
+	void Shutdown();
+
+	int Load(const char*, const function<bool(const vector<char>&)>&, const function<bool()>&);
+	AssetState GetState(int);
+	bool IsReady(int);
+	bool Wait(int);
+
+	void Update(float = ASSET_LOADER_UPLOAD_BUDGET_MS);
+	int GetPendingCount();
+
+private:
+	void IoThread();
+	void WorkerThread();
+	void Finish(AssetRequest*, AssetState);
+
+private:
+	FileSystemClass* m_fileSystem;
+	vector<AssetRequest*> m_requests;
+	deque<int> m_readQueue;
+	deque<int> m_decodeQueue;
+	deque<int> m_uploadQueue;
+	mutex m_lock;
+	condition_variable m_ioWake;
+	condition_variable m_workerWake;
+	condition_variable m_uploadWake;
+	thread m_ioThread;
+	vector<thread> m_workerThreads;
+	int m_pending;
+	bool m_running;
+};
+
+#endif
@@ -0,0 +1,1748 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	bvhclass.cpp
+//
+// summary:	Implements the bvhclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "bvhclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#ifdef BVH_SIMD
+#include <xmmintrin.h>
+#endif
+
+// Includes.
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Turns an object into the child of a node, and a child back into its object. </summary>
+///
+/// <param name="value"> The object, or the child. </param>
+///
+/// <returns> The child, or the object. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int FlipObject(int value)
+{
+	return -2 - value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the surface area of a box. </summary>
+///
+/// <param name="bounds"> The box. </param>
+///
+/// <returns> The area. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float GetArea(const SceneBounds& bounds)
+{
+	return 8.0f * (bounds.extents.x * bounds.extents.y + bounds.extents.y * bounds.extents.z + bounds.extents.z * bounds.extents.x);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Makes the box around two boxes. </summary>
+///
+/// <param name="first">  The first box. </param>
+/// <param name="second"> The second box. </param>
+/// <param name="result"> [out] The box around both, may be one of them. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void MergeBounds(const SceneBounds& first, const SceneBounds& second, SceneBounds& result)
+{
+	float minimum[3], maximum[3];
+
+	minimum[0] = min(first.center.x - first.extents.x, second.center.x - second.extents.x);
+	minimum[1] = min(first.center.y - first.extents.y, second.center.y - second.extents.y);
+	minimum[2] = min(first.center.z - first.extents.z, second.center.z - second.extents.z);
+	maximum[0] = max(first.center.x + first.extents.x, second.center.x + second.extents.x);
+	maximum[1] = max(first.center.y + first.extents.y, second.center.y + second.extents.y);
+	maximum[2] = max(first.center.z + first.extents.z, second.center.z + second.extents.z);
+
+	result.center.x = (minimum[0] + maximum[0]) * 0.5f;
+	result.center.y = (minimum[1] + maximum[1]) * 0.5f;
+	result.center.z = (minimum[2] + maximum[2]) * 0.5f;
+	result.center.w = 0.0f;
+	result.extents.x = (maximum[0] - minimum[0]) * 0.5f;
+	result.extents.y = (maximum[1] - minimum[1]) * 0.5f;
+	result.extents.z = (maximum[2] - minimum[2]) * 0.5f;
+	result.extents.w = 0.0f;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the box of one child of a node. </summary>
+///
+/// <param name="node">   The node. </param>
+/// <param name="slot">   The slot of the child. </param>
+/// <param name="bounds"> [out] The box. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void GetSlotBounds(const BvhNode& node, int slot, SceneBounds& bounds)
+{
+	bounds.center.x = node.centerX[slot];
+	bounds.center.y = node.centerY[slot];
+	bounds.center.z = node.centerZ[slot];
+	bounds.center.w = 0.0f;
+	bounds.extents.x = node.extentX[slot];
+	bounds.extents.y = node.extentY[slot];
+	bounds.extents.z = node.extentZ[slot];
+	bounds.extents.w = 0.0f;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets the box of one child of a node. </summary>
+///
+/// <param name="node">   [in,out] The node. </param>
+/// <param name="slot">   The slot of the child. </param>
+/// <param name="bounds"> The box. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void SetSlotBounds(BvhNode& node, int slot, const SceneBounds& bounds)
+{
+	node.centerX[slot] = bounds.center.x;
+	node.centerY[slot] = bounds.center.y;
+	node.centerZ[slot] = bounds.center.z;
+	node.extentX[slot] = bounds.extents.x;
+	node.extentY[slot] = bounds.extents.y;
+	node.extentZ[slot] = bounds.extents.z;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Tests the four boxes of a node against the planes of a frustum still in play. A box is
+/// 	outside if it is behind one plane; a box fully in front of a plane doesn't need that
+/// 	plane below it.
+/// </summary>
+///
+/// <param name="node">	   The node. </param>
+/// <param name="planes">  The planes, a box is in front where a x + b y + c z + d >= 0. </param>
+/// <param name="mask">	   The planes to test, one bit each. </param>
+/// <param name="inside">  [out] For every plane, a bit for each box fully in front of it. </param>
+///
+/// <returns> A bit for each box outside. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int TestFrustum(const BvhNode& node, const SceneVector* planes, int mask, int* inside)
+{
+	int outside, i;
+
+#ifdef BVH_SIMD
+	__m128 centerX, centerY, centerZ, extentX, extentY, extentZ, distance, radius;
+
+	centerX = _mm_loadu_ps(node.centerX);
+	centerY = _mm_loadu_ps(node.centerY);
+	centerZ = _mm_loadu_ps(node.centerZ);
+	extentX = _mm_loadu_ps(node.extentX);
+	extentY = _mm_loadu_ps(node.extentY);
+	extentZ = _mm_loadu_ps(node.extentZ);
+
+	outside = 0;
+	for(i=0; i<BVH_FRUSTUM_PLANES; i++)
+	{
+		inside[i] = 0;
+		if(!(mask & (1 << i)))
+		{
+			continue;
+		}
+
+		distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[i].x), centerX), _mm_mul_ps(_mm_set1_ps(planes[i].y), centerY)), _mm_mul_ps(_mm_set1_ps(planes[i].z), centerZ)), _mm_set1_ps(planes[i].w));
+		radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabsf(planes[i].x)), extentX), _mm_mul_ps(_mm_set1_ps(fabsf(planes[i].y)), extentY)), _mm_mul_ps(_mm_set1_ps(fabsf(planes[i].z)), extentZ));
+
+		outside |= _mm_movemask_ps(_mm_cmplt_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius)));
+		inside[i] = _mm_movemask_ps(_mm_cmpge_ps(distance, radius));
+	}
+#else
+	float distance, radius;
+	int j;
+
+	outside = 0;
+	for(i=0; i<BVH_FRUSTUM_PLANES; i++)
+	{
+		inside[i] = 0;
+		if(!(mask & (1 << i)))
+		{
+			continue;
+		}
+
+		for(j=0; j<BVH_WIDTH; j++)
+		{
+			distance = planes[i].x * node.centerX[j] + planes[i].y * node.centerY[j] + planes[i].z * node.centerZ[j] + planes[i].w;
+			radius = fabsf(planes[i].x) * node.extentX[j] + fabsf(planes[i].y) * node.extentY[j] + fabsf(planes[i].z) * node.extentZ[j];
+
+			outside |= distance < -radius ? 1 << j : 0;
+			inside[i] |= distance >= radius ? 1 << j : 0;
+		}
+	}
+#endif
+
+	return outside;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Tests a ray against the four boxes of a node with the slab test. </summary>
+///
+/// <param name="node">		   The node. </param>
+/// <param name="origin">	   The start of the ray. </param>
+/// <param name="inverse">	   One over the direction of the ray, per axis. </param>
+/// <param name="maxDistance"> How far the ray goes, in lengths of the direction. </param>
+/// <param name="distances">   [out] Where the ray enters each box it hits. </param>
+///
+/// <returns> A bit for each box hit. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int TestRay(const BvhNode& node, const SceneVector& origin, const SceneVector& inverse, float maxDistance, float* distances)
+{
+#ifdef BVH_SIMD
+	__m128 centerX, centerY, centerZ, extentX, extentY, extentZ, low, high, entry, exit;
+
+	centerX = _mm_sub_ps(_mm_loadu_ps(node.centerX), _mm_set1_ps(origin.x));
+	centerY = _mm_sub_ps(_mm_loadu_ps(node.centerY), _mm_set1_ps(origin.y));
+	centerZ = _mm_sub_ps(_mm_loadu_ps(node.centerZ), _mm_set1_ps(origin.z));
+	extentX = _mm_loadu_ps(node.extentX);
+	extentY = _mm_loadu_ps(node.extentY);
+	extentZ = _mm_loadu_ps(node.extentZ);
+
+	low = _mm_mul_ps(_mm_sub_ps(centerX, extentX), _mm_set1_ps(inverse.x));
+	high = _mm_mul_ps(_mm_add_ps(centerX, extentX), _mm_set1_ps(inverse.x));
+	entry = _mm_min_ps(low, high);
+	exit = _mm_max_ps(low, high);
+
+	low = _mm_mul_ps(_mm_sub_ps(centerY, extentY), _mm_set1_ps(inverse.y));
+	high = _mm_mul_ps(_mm_add_ps(centerY, extentY), _mm_set1_ps(inverse.y));
+	entry = _mm_max_ps(entry, _mm_min_ps(low, high));
+	exit = _mm_min_ps(exit, _mm_max_ps(low, high));
+
+	low = _mm_mul_ps(_mm_sub_ps(centerZ, extentZ), _mm_set1_ps(inverse.z));
+	high = _mm_mul_ps(_mm_add_ps(centerZ, extentZ), _mm_set1_ps(inverse.z));
+	entry = _mm_max_ps(_mm_max_ps(entry, _mm_min_ps(low, high)), _mm_setzero_ps());
+	exit = _mm_min_ps(_mm_min_ps(exit, _mm_max_ps(low, high)), _mm_set1_ps(maxDistance));
+
+	_mm_storeu_ps(distances, entry);
+
+	return _mm_movemask_ps(_mm_cmple_ps(entry, exit));
+#else
+	float low, high, entry, exit;
+	int hits, i;
+
+	hits = 0;
+	for(i=0; i<BVH_WIDTH; i++)
+	{
+		low = (node.centerX[i] - origin.x - node.extentX[i]) * inverse.x;
+		high = (node.centerX[i] - origin.x + node.extentX[i]) * inverse.x;
+		entry = min(low, high);
+		exit = max(low, high);
+
+		low = (node.centerY[i] - origin.y - node.extentY[i]) * inverse.y;
+		high = (node.centerY[i] - origin.y + node.extentY[i]) * inverse.y;
+		entry = max(entry, min(low, high));
+		exit = min(exit, max(low, high));
+
+		low = (node.centerZ[i] - origin.z - node.extentZ[i]) * inverse.z;
+		high = (node.centerZ[i] - origin.z + node.extentZ[i]) * inverse.z;
+		entry = max(max(entry, min(low, high)), 0.0f);
+		exit = min(min(exit, max(low, high)), maxDistance);
+
+		distances[i] = entry;
+		hits |= entry <= exit ? 1 << i : 0;
+	}
+
+	return hits;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Tests a box against the four boxes of a node. </summary>
+///
+/// <param name="node">   The node. </param>
+/// <param name="bounds"> The box. </param>
+///
+/// <returns> A bit for each box overlapping it. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int TestBox(const BvhNode& node, const SceneBounds& bounds)
+{
+#ifdef BVH_SIMD
+	__m128 signMask, apart;
+
+	// Clearing the sign bit is the absolute value.
+	signMask = _mm_set1_ps(-0.0f);
+	apart = _mm_cmpgt_ps(_mm_andnot_ps(signMask, _mm_sub_ps(_mm_loadu_ps(node.centerX), _mm_set1_ps(bounds.center.x))), _mm_add_ps(_mm_loadu_ps(node.extentX), _mm_set1_ps(bounds.extents.x)));
+	apart = _mm_or_ps(apart, _mm_cmpgt_ps(_mm_andnot_ps(signMask, _mm_sub_ps(_mm_loadu_ps(node.centerY), _mm_set1_ps(bounds.center.y))), _mm_add_ps(_mm_loadu_ps(node.extentY), _mm_set1_ps(bounds.extents.y))));
+	apart = _mm_or_ps(apart, _mm_cmpgt_ps(_mm_andnot_ps(signMask, _mm_sub_ps(_mm_loadu_ps(node.centerZ), _mm_set1_ps(bounds.center.z))), _mm_add_ps(_mm_loadu_ps(node.extentZ), _mm_set1_ps(bounds.extents.z))));
+
+	return ~_mm_movemask_ps(apart) & 0xf;
+#else
+	int hits, i;
+
+	hits = 0;
+	for(i=0; i<BVH_WIDTH; i++)
+	{
+		if(fabsf(node.centerX[i] - bounds.center.x) <= node.extentX[i] + bounds.extents.x &&
+		   fabsf(node.centerY[i] - bounds.center.y) <= node.extentY[i] + bounds.extents.y &&
+		   fabsf(node.centerZ[i] - bounds.center.z) <= node.extentZ[i] + bounds.extents.z)
+		{
+			hits |= 1 << i;
+		}
+	}
+
+	return hits;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Orders the ray hits by distance. </summary>
+///
+/// <param name="first">  The first hit. </param>
+/// <param name="second"> The second hit. </param>
+///
+/// <returns> true if the first is nearer. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool CompareHits(const BvhRayHit& first, const BvhRayHit& second)
+{
+	return first.distance < second.distance;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The next number of a small random generator, between 0 and 1. </summary>
+///
+/// <param name="seed"> [in,out] The state of the generator. </param>
+///
+/// <returns> The number. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float NextRandom(unsigned int& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+
+	return (seed >> 8) / 16777216.0f;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+BvhClass::BvhClass()
+{
+	m_root = -1;
+	m_objectCount = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+BvhClass::BvhClass(const BvhClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+BvhClass::~BvhClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts empty. </summary>
+///
+/// <param name="capacity"> The number of objects to make room for. </param>
+///
+/// <returns> true. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BvhClass::Initialize(int capacity)
+{
+	m_objects.reserve(capacity);
+	m_nodes.reserve(capacity / 2);
+	m_nodeInfos.reserve(capacity / 2);
+	m_root = -1;
+	m_objectCount = 0;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the nodes and the objects. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::Shutdown()
+{
+	vector<BvhNode>().swap(m_nodes);
+	vector<NodeInfoType>().swap(m_nodeInfos);
+	vector<ObjectType>().swap(m_objects);
+	m_freeNodes.clear();
+	m_freeObjects.clear();
+	m_dirtyLevels.clear();
+	m_degraded.clear();
+	m_root = -1;
+	m_objectCount = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Inserts an object. </summary>
+///
+/// <param name="bounds"> The box of the object. </param>
+/// <param name="id">	  The id the queries give back for the object. </param>
+///
+/// <returns> The handle of the object. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int BvhClass::Insert(const SceneBounds& bounds, int id)
+{
+	int object;
+
+	if(!m_freeObjects.empty())
+	{
+		object = m_freeObjects.back();
+		m_freeObjects.pop_back();
+	}
+	else
+	{
+		m_objects.push_back(ObjectType());
+		object = (int)m_objects.size() - 1;
+	}
+
+	m_objects[object].bounds = bounds;
+	m_objects[object].id = id;
+	m_objects[object].node = -1;
+	m_objects[object].slot = -1;
+	m_objectCount++;
+
+	InsertObject(object);
+
+	return object;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gives an object a new box. An object still in the box of its node only has its slot
+/// 	changed, the nodes above follow at the next Refit; one that left it is inserted again
+/// 	where it is now, so it doesn't drag its old node across the world.
+/// </summary>
+///
+/// <param name="object"> The handle of the object. </param>
+/// <param name="bounds"> The new box. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::Update(int object, const SceneBounds& bounds)
+{
+	SceneBounds nodeBounds;
+	int node;
+
+	node = m_objects[object].node;
+	GetNodeBounds(node, nodeBounds);
+	m_objects[object].bounds = bounds;
+
+	if(fabsf(bounds.center.x - nodeBounds.center.x) > nodeBounds.extents.x ||
+	   fabsf(bounds.center.y - nodeBounds.center.y) > nodeBounds.extents.y ||
+	   fabsf(bounds.center.z - nodeBounds.center.z) > nodeBounds.extents.z)
+	{
+		DetachObject(object);
+		InsertObject(object);
+		return;
+	}
+
+	SetSlotBounds(m_nodes[node], m_objects[object].slot, bounds);
+	MarkDirty(node);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Removes an object, and the nodes it leaves empty. </summary>
+///
+/// <param name="object"> The handle of the object. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::Remove(int object)
+{
+	DetachObject(object);
+
+	m_objects[object].id = -1;
+	m_freeObjects.push_back(object);
+	m_objectCount--;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Throws the tree away and builds it again over every object. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::Build()
+{
+	vector<int> objects;
+	unsigned int i;
+
+	PROFILE_FUNCTION();
+
+	objects.reserve(m_objectCount);
+	for(i=0; i<m_objects.size(); i++)
+	{
+		if(m_objects[i].node >= 0)
+		{
+			objects.push_back((int)i);
+		}
+	}
+
+	m_nodes.clear();
+	m_nodeInfos.clear();
+	m_freeNodes.clear();
+	m_dirtyLevels.clear();
+	m_degraded.clear();
+	m_root = -1;
+
+	if(objects.empty())
+	{
+		return;
+	}
+
+	m_root = BuildNode(&objects[0], (int)objects.size(), -1, -1, 0);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Brings the boxes of the nodes up to date, one depth after the other from the deepest, and
+/// 	builds again the subtrees that grew too much, within the budget.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::Refit()
+{
+	vector<int> candidates;
+	SceneBounds bounds, slotBounds;
+	NodeInfoType* info;
+	unsigned int i;
+	int depth, node, budget, slot, child;
+	float area;
+
+	PROFILE_FUNCTION();
+
+	for(depth=(int)m_dirtyLevels.size() - 1; depth>=0; depth--)
+	{
+		for(i=0; i<m_dirtyLevels[depth].size(); i++)
+		{
+			node = m_dirtyLevels[depth][i];
+			info = &m_nodeInfos[node];
+			if(!info->dirty || info->depth != depth)
+			{
+				continue;
+			}
+			info->dirty = false;
+
+			GetNodeBounds(node, bounds);
+			area = GetArea(bounds);
+			if(!info->degraded && info->objectCount > BVH_WIDTH && area > info->builtArea * BVH_REBUILD_GROWTH)
+			{
+				info->degraded = true;
+				m_degraded.push_back(node);
+			}
+
+			// Carry the box up only when it changed, the rest of the path is still right.
+			if(info->parent >= 0)
+			{
+				GetSlotBounds(m_nodes[info->parent], info->slot, slotBounds);
+				if(memcmp(&slotBounds, &bounds, sizeof(SceneBounds)) != 0)
+				{
+					SetSlotBounds(m_nodes[info->parent], info->slot, bounds);
+					MarkDirty(info->parent);
+				}
+			}
+		}
+
+		m_dirtyLevels[depth].clear();
+	}
+
+	// Build the degraded subtrees again, the ones nearest the root first.
+	candidates.swap(m_degraded);
+	budget = BVH_REBUILD_BUDGET;
+	for(i=0; i<candidates.size(); i++)
+	{
+		node = candidates[i];
+		info = &m_nodeInfos[node];
+		if(info->depth < 0 || !info->degraded)
+		{
+			continue;
+		}
+
+		GetNodeBounds(node, bounds);
+		if(GetArea(bounds) <= info->builtArea * BVH_REBUILD_GROWTH)
+		{
+			info->degraded = false;
+			continue;
+		}
+
+		// Too big to ever fit, take its shape as it is and let its children be built again instead.
+		if(info->objectCount > BVH_REBUILD_BUDGET)
+		{
+			info->degraded = false;
+			info->builtArea = GetArea(bounds);
+			for(slot=0; slot<BVH_WIDTH; slot++)
+			{
+				child = m_nodes[node].children[slot];
+				if(child >= 0 && !m_nodeInfos[child].degraded && m_nodeInfos[child].objectCount > BVH_WIDTH)
+				{
+					m_nodeInfos[child].degraded = true;
+					candidates.push_back(child);
+				}
+			}
+			continue;
+		}
+
+		if(info->objectCount > budget)
+		{
+			m_degraded.push_back(node);
+			continue;
+		}
+
+		budget -= info->objectCount;
+		RebuildNode(node);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the objects whose box is inside or crosses a frustum. </summary>
+///
+/// <param name="planes">  The six planes of the frustum (a, b, c, d), inside where a x + b y + c z + d >= 0. </param>
+/// <param name="results"> [out] The ids of the objects. </param>
+///
+/// <returns> The number of objects. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int BvhClass::QueryFrustum(const SceneVector* planes, vector<int>& results)
+{
+	vector<int> stack;
+	int inside[BVH_FRUSTUM_PLANES];
+	int node, mask, childMask, outside, child, slot, i;
+
+	results.clear();
+	if(m_root < 0)
+	{
+		return 0;
+	}
+
+	// The stack holds a node and the planes it still has to be tested against.
+	stack.reserve(64);
+	stack.push_back(m_root);
+	stack.push_back((1 << BVH_FRUSTUM_PLANES) - 1);
+	while(!stack.empty())
+	{
+		mask = stack.back();
+		stack.pop_back();
+		node = stack.back();
+		stack.pop_back();
+
+		outside = TestFrustum(m_nodes[node], planes, mask, inside);
+		for(slot=0; slot<BVH_WIDTH; slot++)
+		{
+			child = m_nodes[node].children[slot];
+			if(child == BVH_EMPTY_SLOT || (outside & (1 << slot)))
+			{
+				continue;
+			}
+
+			if(child < BVH_EMPTY_SLOT)
+			{
+				results.push_back(m_objects[FlipObject(child)].id);
+				continue;
+			}
+
+			childMask = mask;
+			for(i=0; i<BVH_FRUSTUM_PLANES; i++)
+			{
+				if(inside[i] & (1 << slot))
+				{
+					childMask &= ~(1 << i);
+				}
+			}
+
+			if(childMask == 0)
+			{
+				AddSubtree(child, results);
+			}
+			else
+			{
+				stack.push_back(child);
+				stack.push_back(childMask);
+			}
+		}
+	}
+
+	return (int)results.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Finds the objects whose box a ray goes through, nearest first. The distances are in
+/// 	lengths of the direction, so they are in world units when it is normalized.
+/// </summary>
+///
+/// <param name="origin">	   The start of the ray. </param>
+/// <param name="direction">   The direction of the ray. </param>
+/// <param name="maxDistance"> How far the ray goes. </param>
+/// <param name="results">	   [out] The hits. </param>
+///
+/// <returns> The number of hits. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int BvhClass::QueryRay(const SceneVector& origin, const SceneVector& direction, float maxDistance, vector<BvhRayHit>& results)
+{
+	vector<int> stack;
+	SceneVector inverse;
+	BvhRayHit hit;
+	float distances[BVH_WIDTH];
+	int node, hits, child, slot;
+
+	results.clear();
+	if(m_root < 0)
+	{
+		return 0;
+	}
+
+	// A direction of 0 on an axis gives an infinite slab, the ray never leaves it if it starts in it.
+	inverse.x = direction.x != 0.0f ? 1.0f / direction.x : FLT_MAX;
+	inverse.y = direction.y != 0.0f ? 1.0f / direction.y : FLT_MAX;
+	inverse.z = direction.z != 0.0f ? 1.0f / direction.z : FLT_MAX;
+	inverse.w = 0.0f;
+
+	stack.reserve(64);
+	stack.push_back(m_root);
+	while(!stack.empty())
+	{
+		node = stack.back();
+		stack.pop_back();
+
+		hits = TestRay(m_nodes[node], origin, inverse, maxDistance, distances);
+		for(slot=0; slot<BVH_WIDTH; slot++)
+		{
+			child = m_nodes[node].children[slot];
+			if(child == BVH_EMPTY_SLOT || !(hits & (1 << slot)))
+			{
+				continue;
+			}
+
+			if(child < BVH_EMPTY_SLOT)
+			{
+				hit.id = m_objects[FlipObject(child)].id;
+				hit.distance = distances[slot];
+				results.push_back(hit);
+			}
+			else
+			{
+				stack.push_back(child);
+			}
+		}
+	}
+
+	sort(results.begin(), results.end(), CompareHits);
+
+	return (int)results.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the objects whose box overlaps a box. </summary>
+///
+/// <param name="bounds">  The box. </param>
+/// <param name="results"> [out] The ids of the objects. </param>
+///
+/// <returns> The number of objects. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int BvhClass::QueryBox(const SceneBounds& bounds, vector<int>& results)
+{
+	vector<int> stack;
+	int node, hits, child, slot;
+
+	results.clear();
+	if(m_root < 0)
+	{
+		return 0;
+	}
+
+	stack.reserve(64);
+	stack.push_back(m_root);
+	while(!stack.empty())
+	{
+		node = stack.back();
+		stack.pop_back();
+
+		hits = TestBox(m_nodes[node], bounds);
+		for(slot=0; slot<BVH_WIDTH; slot++)
+		{
+			child = m_nodes[node].children[slot];
+			if(child == BVH_EMPTY_SLOT || !(hits & (1 << slot)))
+			{
+				continue;
+			}
+
+			if(child < BVH_EMPTY_SLOT)
+			{
+				results.push_back(m_objects[FlipObject(child)].id);
+			}
+			else
+			{
+				stack.push_back(child);
+			}
+		}
+	}
+
+	return (int)results.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Draws the tree with the debug draw: the box of every node, as its parent holds it, and
+/// 	the box of every object.
+/// </summary>
+///
+/// <param name="nodeColor">   The color of the node boxes, 4 floats. </param>
+/// <param name="objectColor"> The color of the object boxes, 4 floats. </param>
+/// <param name="mode">		   Whether the boxes are hidden by the scene or drawn over it. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::DrawDebug(const float* nodeColor, const float* objectColor, DebugDrawMode mode)
+{
+	vector<int> stack;
+	SceneBounds bounds;
+	float minimum[3], maximum[3];
+	int node, child, slot;
+
+	if(m_root < 0)
+	{
+		return;
+	}
+
+	stack.reserve(64);
+	stack.push_back(m_root);
+	while(!stack.empty())
+	{
+		node = stack.back();
+		stack.pop_back();
+
+		for(slot=0; slot<BVH_WIDTH; slot++)
+		{
+			child = m_nodes[node].children[slot];
+			if(child == BVH_EMPTY_SLOT)
+			{
+				continue;
+			}
+
+			GetSlotBounds(m_nodes[node], slot, bounds);
+			minimum[0] = bounds.center.x - bounds.extents.x;
+			minimum[1] = bounds.center.y - bounds.extents.y;
+			minimum[2] = bounds.center.z - bounds.extents.z;
+			maximum[0] = bounds.center.x + bounds.extents.x;
+			maximum[1] = bounds.center.y + bounds.extents.y;
+			maximum[2] = bounds.center.z + bounds.extents.z;
+
+			if(child < BVH_EMPTY_SLOT)
+			{
+				DebugDrawClass::Box(minimum, maximum, objectColor, mode);
+			}
+			else
+			{
+				DebugDrawClass::Box(minimum, maximum, nodeColor, mode);
+				stack.push_back(child);
+			}
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of objects in the tree. </summary>
+///
+/// <returns> The object count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int BvhClass::GetObjectCount()
+{
+	return m_objectCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of nodes in use. </summary>
+///
+/// <returns> The node count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int BvhClass::GetNodeCount()
+{
+	return (int)(m_nodes.size() - m_freeNodes.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets the SAH cost of the tree: the area of every node over the area of the root, how many
+/// 	nodes a random ray is expected to visit. Lower is better.
+/// </summary>
+///
+/// <returns> The cost. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+float BvhClass::GetCost()
+{
+	SceneBounds bounds;
+	unsigned int i;
+	float total, rootArea;
+
+	if(m_root < 0)
+	{
+		return 0.0f;
+	}
+
+	GetNodeBounds(m_root, bounds);
+	rootArea = GetArea(bounds);
+	if(rootArea <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	total = 0.0f;
+	for(i=0; i<m_nodes.size(); i++)
+	{
+		if(m_nodeInfos[i].depth >= 0)
+		{
+			GetNodeBounds((int)i, bounds);
+			total += GetArea(bounds);
+		}
+	}
+
+	return total / rootArea;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the tree on boxes spread over a flat world of 2 by 2 km, checking the queries
+/// 	against the objects one by one as it goes: the frustum is a camera looking along the
+/// 	world from near its edge, 60 degrees wide and 300 m deep.
+/// </summary>
+///
+/// <param name="objects"> The number of objects. </param>
+/// <param name="result">  [out] The times. </param>
+///
+/// <returns> true if the queries found what they should, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool BvhClass::Benchmark(int objects, BvhBenchmark& result)
+{
+	const float WorldSize = 2000.0f;
+	const float WorldHeight = 100.0f;
+	const float HalfAngle = 0.5235988f;
+	const float Far = 300.0f;
+	BvhClass bvh;
+	vector<int> handles, found;
+	vector<BvhRayHit> hits;
+	SceneVector planes[BVH_FRUSTUM_PLANES], eye, origin, direction;
+	SceneBounds bounds;
+	unsigned long long start;
+	unsigned int seed;
+	float slope, distance, radius, length;
+	int i, j, pass, inside;
+	bool correct;
+
+	memset(&result, 0, sizeof(BvhBenchmark));
+	if(objects <= 0)
+	{
+		return false;
+	}
+
+	bvh.Initialize(objects);
+
+	seed = 4321;
+	handles.resize(objects);
+	for(i=0; i<objects; i++)
+	{
+		bounds.center.x = NextRandom(seed) * WorldSize;
+		bounds.center.y = NextRandom(seed) * WorldHeight;
+		bounds.center.z = NextRandom(seed) * WorldSize;
+		bounds.center.w = 0.0f;
+		bounds.extents.x = 0.5f + NextRandom(seed) * 1.5f;
+		bounds.extents.y = 0.5f + NextRandom(seed) * 1.5f;
+		bounds.extents.z = 0.5f + NextRandom(seed) * 1.5f;
+		bounds.extents.w = 0.0f;
+		handles[i] = bvh.Insert(bounds, i);
+	}
+
+	start = ProfilerClass::GetTimestamp();
+	bvh.Build();
+	result.buildMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+	result.objects = bvh.GetObjectCount();
+	result.nodes = bvh.GetNodeCount();
+	result.builtCost = bvh.GetCost();
+
+	// Near, far, left, right, bottom and top of a camera looking down +z.
+	eye.x = WorldSize * 0.5f;
+	eye.y = WorldHeight * 0.5f;
+	eye.z = WorldSize * 0.1f;
+	slope = tanf(HalfAngle);
+	planes[0].x = 0.0f; planes[0].y = 0.0f; planes[0].z = 1.0f; planes[0].w = -(eye.z + 0.1f);
+	planes[1].x = 0.0f; planes[1].y = 0.0f; planes[1].z = -1.0f; planes[1].w = eye.z + Far;
+	planes[2].x = 1.0f; planes[2].y = 0.0f; planes[2].z = slope; planes[2].w = -(eye.x + slope * eye.z);
+	planes[3].x = -1.0f; planes[3].y = 0.0f; planes[3].z = slope; planes[3].w = eye.x - slope * eye.z;
+	planes[4].x = 0.0f; planes[4].y = 1.0f; planes[4].z = slope; planes[4].w = -(eye.y + slope * eye.z);
+	planes[5].x = 0.0f; planes[5].y = -1.0f; planes[5].z = slope; planes[5].w = eye.y - slope * eye.z;
+
+	correct = true;
+	for(pass=0; pass<3; pass++)
+	{
+		// The best of a few runs, then the same test on every object.
+		for(i=0; i<5; i++)
+		{
+			start = ProfilerClass::GetTimestamp();
+			result.visible = bvh.QueryFrustum(planes, found);
+			distance = (float)ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+			if(pass == 0)
+			{
+				result.frustumMs = i == 0 || distance < result.frustumMs ? distance : result.frustumMs;
+			}
+		}
+
+		start = ProfilerClass::GetTimestamp();
+		inside = 0;
+		for(i=0; i<(int)bvh.m_objects.size(); i++)
+		{
+			if(bvh.m_objects[i].node < 0)
+			{
+				continue;
+			}
+
+			for(j=0; j<BVH_FRUSTUM_PLANES; j++)
+			{
+				distance = planes[j].x * bvh.m_objects[i].bounds.center.x + planes[j].y * bvh.m_objects[i].bounds.center.y + planes[j].z * bvh.m_objects[i].bounds.center.z + planes[j].w;
+				radius = fabsf(planes[j].x) * bvh.m_objects[i].bounds.extents.x + fabsf(planes[j].y) * bvh.m_objects[i].bounds.extents.y + fabsf(planes[j].z) * bvh.m_objects[i].bounds.extents.z;
+				if(distance < -radius)
+				{
+					break;
+				}
+			}
+			inside += j == BVH_FRUSTUM_PLANES ? 1 : 0;
+		}
+		if(pass == 0)
+		{
+			result.bruteForceMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+		}
+		correct = correct && inside == result.visible;
+
+		if(pass == 0)
+		{
+			// Rays from anywhere in the world, and boxes of 40 m.
+			start = ProfilerClass::GetTimestamp();
+			for(i=0; i<BVH_BENCHMARK_QUERIES; i++)
+			{
+				origin.x = NextRandom(seed) * WorldSize;
+				origin.y = NextRandom(seed) * WorldHeight;
+				origin.z = NextRandom(seed) * WorldSize;
+				direction.x = NextRandom(seed) * 2.0f - 1.0f;
+				direction.y = (NextRandom(seed) * 2.0f - 1.0f) * 0.1f;
+				direction.z = NextRandom(seed) * 2.0f - 1.0f;
+				length = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+				direction.x /= length;
+				direction.y /= length;
+				direction.z /= length;
+				bvh.QueryRay(origin, direction, Far, hits);
+			}
+			result.raysMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+			start = ProfilerClass::GetTimestamp();
+			for(i=0; i<BVH_BENCHMARK_QUERIES; i++)
+			{
+				bounds.center.x = NextRandom(seed) * WorldSize;
+				bounds.center.y = NextRandom(seed) * WorldHeight;
+				bounds.center.z = NextRandom(seed) * WorldSize;
+				bounds.extents.x = bounds.extents.y = bounds.extents.z = 20.0f;
+				bvh.QueryBox(bounds, found);
+			}
+			result.boxesMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+			// Nudge a share of the objects.
+			for(i=0; i<(int)(objects * BVH_BENCHMARK_MOVED); i++)
+			{
+				j = handles[(int)(NextRandom(seed) * objects)];
+				bounds = bvh.m_objects[j].bounds;
+				bounds.center.x += NextRandom(seed) * 2.0f - 1.0f;
+				bounds.center.z += NextRandom(seed) * 2.0f - 1.0f;
+				bvh.Update(j, bounds);
+			}
+
+			start = ProfilerClass::GetTimestamp();
+			bvh.Refit();
+			result.refitMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+		}
+		else if(pass == 1)
+		{
+			// Throw a share of them anywhere, then let the refits repair the tree.
+			for(i=0; i<(int)(objects * BVH_BENCHMARK_TELEPORTED); i++)
+			{
+				j = handles[(int)(NextRandom(seed) * objects)];
+				bounds = bvh.m_objects[j].bounds;
+				bounds.center.x = NextRandom(seed) * WorldSize;
+				bounds.center.z = NextRandom(seed) * WorldSize;
+				bvh.Update(j, bounds);
+			}
+
+			start = ProfilerClass::GetTimestamp();
+			bvh.Refit();
+			result.repairMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+			for(i=0; i<objects && !bvh.m_degraded.empty(); i+=BVH_REBUILD_BUDGET)
+			{
+				bvh.Refit();
+			}
+			result.repairedCost = bvh.GetCost();
+		}
+		else
+		{
+			bvh.Build();
+			result.rebuiltCost = bvh.GetCost();
+		}
+	}
+
+	bvh.Shutdown();
+
+	return correct;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Puts an object in the tree. It goes down the children whose box grows the least, and
+/// 	takes a free slot or pairs up with the object in the slot it ends on.
+/// </summary>
+///
+/// <param name="object"> The handle of the object, out of the tree. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::InsertObject(int object)
+{
+	SceneBounds slotBounds, merged;
+	float growth, bestGrowth, area, bestArea;
+	int node, slot, bestSlot, child, pair;
+
+	if(m_root < 0)
+	{
+		m_root = AllocateNode(-1, -1, 0);
+	}
+
+	node = m_root;
+	while(true)
+	{
+		for(slot=0; slot<BVH_WIDTH; slot++)
+		{
+			if(m_nodes[node].children[slot] == BVH_EMPTY_SLOT)
+			{
+				SetSlot(node, slot, FlipObject(object));
+				AddObjectCount(node, 1);
+				MarkDirty(node);
+				return;
+			}
+		}
+
+		// Every slot is taken, follow the child that grows the least.
+		bestSlot = 0;
+		bestGrowth = FLT_MAX;
+		bestArea = FLT_MAX;
+		for(slot=0; slot<BVH_WIDTH; slot++)
+		{
+			GetSlotBounds(m_nodes[node], slot, slotBounds);
+			MergeBounds(slotBounds, m_objects[object].bounds, merged);
+			area = GetArea(slotBounds);
+			growth = GetArea(merged) - area;
+			if(growth < bestGrowth || (growth == bestGrowth && area < bestArea))
+			{
+				bestSlot = slot;
+				bestGrowth = growth;
+				bestArea = area;
+			}
+		}
+
+		child = m_nodes[node].children[bestSlot];
+		if(child >= 0)
+		{
+			node = child;
+			continue;
+		}
+
+		// The child is an object, put both in a new node in its place.
+		pair = AllocateNode(node, bestSlot, m_nodeInfos[node].depth + 1);
+		SetSlot(pair, 0, child);
+		SetSlot(pair, 1, FlipObject(object));
+		m_nodeInfos[pair].objectCount = 1;
+		GetNodeBounds(pair, merged);
+		m_nodeInfos[pair].builtArea = GetArea(merged);
+
+		SetSlot(node, bestSlot, pair);
+		AddObjectCount(pair, 1);
+		MarkDirty(node);
+		return;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Takes an object out of the tree, and the nodes it leaves empty. </summary>
+///
+/// <param name="object"> The handle of the object. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::DetachObject(int object)
+{
+	int node, slot, parent;
+
+	node = m_objects[object].node;
+	ClearSlot(node, m_objects[object].slot);
+	AddObjectCount(node, -1);
+	m_objects[object].node = -1;
+	m_objects[object].slot = -1;
+
+	// Take the nodes left empty out of their parents.
+	while(node != m_root && m_nodeInfos[node].objectCount == 0)
+	{
+		parent = m_nodeInfos[node].parent;
+		slot = m_nodeInfos[node].slot;
+		ClearSlot(parent, slot);
+		FreeNode(node);
+		node = parent;
+	}
+
+	MarkDirty(node);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Takes a node from the free ones, or adds one, with every slot empty. </summary>
+///
+/// <param name="parent"> The parent node, -1 for the root. </param>
+/// <param name="slot">   The slot of the node in its parent. </param>
+/// <param name="depth">  The depth of the node. </param>
+///
+/// <returns> The node. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int BvhClass::AllocateNode(int parent, int slot, int depth)
+{
+	NodeInfoType* info;
+	int node, i;
+
+	if(!m_freeNodes.empty())
+	{
+		node = m_freeNodes.back();
+		m_freeNodes.pop_back();
+	}
+	else
+	{
+		m_nodes.push_back(BvhNode());
+		m_nodeInfos.push_back(NodeInfoType());
+		node = (int)m_nodes.size() - 1;
+	}
+
+	for(i=0; i<BVH_WIDTH; i++)
+	{
+		ClearSlot(node, i);
+	}
+
+	info = &m_nodeInfos[node];
+	info->parent = parent;
+	info->slot = slot;
+	info->depth = depth;
+	info->objectCount = 0;
+	info->builtArea = 0.0f;
+	info->dirty = false;
+	info->degraded = false;
+
+	return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives a node back to the free ones. </summary>
+///
+/// <param name="node"> The node. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::FreeNode(int node)
+{
+	m_nodeInfos[node].depth = -1;
+	m_nodeInfos[node].dirty = false;
+	m_nodeInfos[node].degraded = false;
+	m_freeNodes.push_back(node);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds a subtree over some objects. The objects are split in two with the surface area
+/// 	heuristic, then the larger part again, until there are four parts or only single
+/// 	objects left; every part of more than one object is a child node built the same way.
+/// </summary>
+///
+/// <param name="objects"> [in,out] The objects, reordered. </param>
+/// <param name="count">   The number of objects. </param>
+/// <param name="parent">  The parent node, -1 for the root. </param>
+/// <param name="slot">	   The slot of the subtree in its parent. </param>
+/// <param name="depth">   The depth of the subtree. </param>
+///
+/// <returns> The root node of the subtree. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int BvhClass::BuildNode(int* objects, int count, int parent, int slot, int depth)
+{
+	SceneBounds bounds;
+	int starts[BVH_WIDTH], counts[BVH_WIDTH];
+	int node, parts, largest, split, i;
+
+	node = AllocateNode(parent, slot, depth);
+
+	parts = 1;
+	starts[0] = 0;
+	counts[0] = count;
+	while(parts < BVH_WIDTH)
+	{
+		largest = -1;
+		for(i=0; i<parts; i++)
+		{
+			if(counts[i] > 1 && (largest < 0 || counts[i] > counts[largest]))
+			{
+				largest = i;
+			}
+		}
+		if(largest < 0)
+		{
+			break;
+		}
+
+		split = SplitObjects(objects + starts[largest], counts[largest]);
+		starts[parts] = starts[largest] + split;
+		counts[parts] = counts[largest] - split;
+		counts[largest] = split;
+		parts++;
+	}
+
+	for(i=0; i<parts; i++)
+	{
+		if(counts[i] == 1)
+		{
+			SetSlot(node, i, FlipObject(objects[starts[i]]));
+		}
+		else
+		{
+			SetSlot(node, i, BuildNode(objects + starts[i], counts[i], node, i, depth + 1));
+		}
+	}
+
+	GetNodeBounds(node, bounds);
+	m_nodeInfos[node].objectCount = count;
+	m_nodeInfos[node].builtArea = GetArea(bounds);
+
+	return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Splits objects in two along the longest axis of their centers, at the bin boundary with
+/// 	the lowest surface area cost. Falls back to halves by count when every center is in one
+/// 	bin.
+/// </summary>
+///
+/// <param name="objects"> [in,out] The objects, reordered so the first part comes first. </param>
+/// <param name="count">   The number of objects, 2 or more. </param>
+///
+/// <returns> The number of objects in the first part, between 1 and count - 1. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int BvhClass::SplitObjects(int* objects, int count)
+{
+	float binMinimum[BVH_BINS][3], binMaximum[BVH_BINS][3], leftAreas[BVH_BINS];
+	float minimum[3], maximum[3], center[3], scale, origin, cost, bestCost;
+	int binCounts[BVH_BINS], leftCounts[BVH_BINS];
+	int axis, bin, best, split, total, i, k;
+	const SceneBounds* bounds;
+	int* middle;
+
+	// Find the spread of the centers.
+	for(k=0; k<3; k++)
+	{
+		minimum[k] = FLT_MAX;
+		maximum[k] = -FLT_MAX;
+	}
+	for(i=0; i<count; i++)
+	{
+		bounds = &m_objects[objects[i]].bounds;
+		minimum[0] = min(minimum[0], bounds->center.x);
+		minimum[1] = min(minimum[1], bounds->center.y);
+		minimum[2] = min(minimum[2], bounds->center.z);
+		maximum[0] = max(maximum[0], bounds->center.x);
+		maximum[1] = max(maximum[1], bounds->center.y);
+		maximum[2] = max(maximum[2], bounds->center.z);
+	}
+
+	axis = 0;
+	for(k=1; k<3; k++)
+	{
+		if(maximum[k] - minimum[k] > maximum[axis] - minimum[axis])
+		{
+			axis = k;
+		}
+	}
+
+	if(maximum[axis] - minimum[axis] <= 0.0f)
+	{
+		return count / 2;
+	}
+
+	// Drop every object in the bin of its center, growing the box of the bin.
+	for(bin=0; bin<BVH_BINS; bin++)
+	{
+		binCounts[bin] = 0;
+		for(k=0; k<3; k++)
+		{
+			binMinimum[bin][k] = FLT_MAX;
+			binMaximum[bin][k] = -FLT_MAX;
+		}
+	}
+
+	origin = minimum[axis];
+	scale = BVH_BINS / (maximum[axis] - origin);
+	for(i=0; i<count; i++)
+	{
+		bounds = &m_objects[objects[i]].bounds;
+		center[0] = bounds->center.x;
+		center[1] = bounds->center.y;
+		center[2] = bounds->center.z;
+		bin = min((int)((center[axis] - origin) * scale), BVH_BINS - 1);
+
+		binCounts[bin]++;
+		binMinimum[bin][0] = min(binMinimum[bin][0], bounds->center.x - bounds->extents.x);
+		binMinimum[bin][1] = min(binMinimum[bin][1], bounds->center.y - bounds->extents.y);
+		binMinimum[bin][2] = min(binMinimum[bin][2], bounds->center.z - bounds->extents.z);
+		binMaximum[bin][0] = max(binMaximum[bin][0], bounds->center.x + bounds->extents.x);
+		binMaximum[bin][1] = max(binMaximum[bin][1], bounds->center.y + bounds->extents.y);
+		binMaximum[bin][2] = max(binMaximum[bin][2], bounds->center.z + bounds->extents.z);
+	}
+
+	// Sweep from the left for the area and count left of every boundary, then from the right for the cost.
+	for(k=0; k<3; k++)
+	{
+		minimum[k] = FLT_MAX;
+		maximum[k] = -FLT_MAX;
+	}
+	total = 0;
+	for(bin=0; bin<BVH_BINS - 1; bin++)
+	{
+		total += binCounts[bin];
+		for(k=0; k<3; k++)
+		{
+			minimum[k] = min(minimum[k], binMinimum[bin][k]);
+			maximum[k] = max(maximum[k], binMaximum[bin][k]);
+		}
+		leftCounts[bin] = total;
+		leftAreas[bin] = total > 0 ? 2.0f * ((maximum[0] - minimum[0]) * (maximum[1] - minimum[1]) + (maximum[1] - minimum[1]) * (maximum[2] - minimum[2]) + (maximum[2] - minimum[2]) * (maximum[0] - minimum[0])) : 0.0f;
+	}
+
+	for(k=0; k<3; k++)
+	{
+		minimum[k] = FLT_MAX;
+		maximum[k] = -FLT_MAX;
+	}
+	total = 0;
+	best = -1;
+	bestCost = FLT_MAX;
+	for(bin=BVH_BINS - 1; bin>0; bin--)
+	{
+		total += binCounts[bin];
+		for(k=0; k<3; k++)
+		{
+			minimum[k] = min(minimum[k], binMinimum[bin][k]);
+			maximum[k] = max(maximum[k], binMaximum[bin][k]);
+		}
+
+		if(total == 0 || leftCounts[bin - 1] == 0)
+		{
+			continue;
+		}
+
+		cost = leftAreas[bin - 1] * leftCounts[bin - 1] + 2.0f * ((maximum[0] - minimum[0]) * (maximum[1] - minimum[1]) + (maximum[1] - minimum[1]) * (maximum[2] - minimum[2]) + (maximum[2] - minimum[2]) * (maximum[0] - minimum[0])) * total;
+		if(cost < bestCost)
+		{
+			bestCost = cost;
+			best = bin;
+		}
+	}
+
+	if(best < 0)
+	{
+		return count / 2;
+	}
+
+	// Everything in the bins left of the best boundary goes first.
+	middle = partition(objects, objects + count, [this, axis, origin, scale, best](int object) -> bool
+	{
+		const SceneBounds& bounds = m_objects[object].bounds;
+		float center;
+
+		center = axis == 0 ? bounds.center.x : (axis == 1 ? bounds.center.y : bounds.center.z);
+		return min((int)((center - origin) * scale), BVH_BINS - 1) < best;
+	});
+	split = (int)(middle - objects);
+
+	return split > 0 && split < count ? split : count / 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Puts a child in a slot of a node, with its box, and tells the child where it is. </summary>
+///
+/// <param name="node">  The node. </param>
+/// <param name="slot">  The slot. </param>
+/// <param name="child"> The child node, or object turned with FlipObject. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::SetSlot(int node, int slot, int child)
+{
+	SceneBounds bounds;
+
+	m_nodes[node].children[slot] = child;
+	if(child >= 0)
+	{
+		m_nodeInfos[child].parent = node;
+		m_nodeInfos[child].slot = slot;
+		GetNodeBounds(child, bounds);
+		SetSlotBounds(m_nodes[node], slot, bounds);
+	}
+	else
+	{
+		m_objects[FlipObject(child)].node = node;
+		m_objects[FlipObject(child)].slot = slot;
+		SetSlotBounds(m_nodes[node], slot, m_objects[FlipObject(child)].bounds);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empties a slot of a node. </summary>
+///
+/// <param name="node"> The node. </param>
+/// <param name="slot"> The slot. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::ClearSlot(int node, int slot)
+{
+	m_nodes[node].children[slot] = BVH_EMPTY_SLOT;
+	m_nodes[node].centerX[slot] = 0.0f;
+	m_nodes[node].centerY[slot] = 0.0f;
+	m_nodes[node].centerZ[slot] = 0.0f;
+	m_nodes[node].extentX[slot] = 0.0f;
+	m_nodes[node].extentY[slot] = 0.0f;
+	m_nodes[node].extentZ[slot] = 0.0f;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Queues a node whose children changed for the next Refit. </summary>
+///
+/// <param name="node"> The node. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::MarkDirty(int node)
+{
+	NodeInfoType* info;
+
+	info = &m_nodeInfos[node];
+	if(info->dirty)
+	{
+		return;
+	}
+
+	info->dirty = true;
+	if(info->depth >= (int)m_dirtyLevels.size())
+	{
+		m_dirtyLevels.resize(info->depth + 1);
+	}
+	m_dirtyLevels[info->depth].push_back(node);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Changes the object count of a node and of every node above it. </summary>
+///
+/// <param name="node">  The node. </param>
+/// <param name="count"> The number of objects added, negative for removed. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::AddObjectCount(int node, int count)
+{
+	while(node >= 0)
+	{
+		m_nodeInfos[node].objectCount += count;
+		node = m_nodeInfos[node].parent;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Builds the subtree of a node again, in the same slot of the same parent. </summary>
+///
+/// <param name="node"> The node. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::RebuildNode(int node)
+{
+	vector<int> objects;
+	int parent, slot, depth, root;
+
+	CollectObjects(node, objects);
+	if(objects.empty())
+	{
+		return;
+	}
+
+	parent = m_nodeInfos[node].parent;
+	slot = m_nodeInfos[node].slot;
+	depth = m_nodeInfos[node].depth;
+
+	FreeSubtree(node);
+	root = BuildNode(&objects[0], (int)objects.size(), parent, slot, depth);
+	if(parent >= 0)
+	{
+		SetSlot(parent, slot, root);
+	}
+	else
+	{
+		m_root = root;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the handles of every object below a node. </summary>
+///
+/// <param name="node">    The node. </param>
+/// <param name="objects"> [in,out] The handles, added at the end. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::CollectObjects(int node, vector<int>& objects)
+{
+	vector<int> stack;
+	int child, slot;
+
+	stack.push_back(node);
+	while(!stack.empty())
+	{
+		node = stack.back();
+		stack.pop_back();
+
+		for(slot=0; slot<BVH_WIDTH; slot++)
+		{
+			child = m_nodes[node].children[slot];
+			if(child >= 0)
+			{
+				stack.push_back(child);
+			}
+			else if(child < BVH_EMPTY_SLOT)
+			{
+				objects.push_back(FlipObject(child));
+			}
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Frees a node and every node below it. </summary>
+///
+/// <param name="node"> The node. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::FreeSubtree(int node)
+{
+	vector<int> stack;
+	int slot;
+
+	stack.push_back(node);
+	while(!stack.empty())
+	{
+		node = stack.back();
+		stack.pop_back();
+
+		for(slot=0; slot<BVH_WIDTH; slot++)
+		{
+			if(m_nodes[node].children[slot] >= 0)
+			{
+				stack.push_back(m_nodes[node].children[slot]);
+			}
+		}
+		FreeNode(node);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds the ids of every object below a node, without testing them. </summary>
+///
+/// <param name="node">    The node. </param>
+/// <param name="results"> [in,out] The ids, added at the end. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::AddSubtree(int node, vector<int>& results)
+{
+	int stack[64 * BVH_WIDTH];
+	int count, child, slot;
+	vector<int> overflow;
+
+	count = 0;
+	stack[count++] = node;
+	while(count > 0 || !overflow.empty())
+	{
+		if(count > 0)
+		{
+			node = stack[--count];
+		}
+		else
+		{
+			node = overflow.back();
+			overflow.pop_back();
+		}
+
+		for(slot=0; slot<BVH_WIDTH; slot++)
+		{
+			child = m_nodes[node].children[slot];
+			if(child >= 0)
+			{
+				if(count < 64 * BVH_WIDTH)
+				{
+					stack[count++] = child;
+				}
+				else
+				{
+					overflow.push_back(child);
+				}
+			}
+			else if(child < BVH_EMPTY_SLOT)
+			{
+				results.push_back(m_objects[FlipObject(child)].id);
+			}
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the box around the children of a node. </summary>
+///
+/// <param name="node">   The node. </param>
+/// <param name="bounds"> [out] The box, empty at the center of the world if the node has no children. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void BvhClass::GetNodeBounds(int node, SceneBounds& bounds)
+{
+	SceneBounds slotBounds;
+	bool first;
+	int slot;
+
+	memset(&bounds, 0, sizeof(SceneBounds));
+	first = true;
+	for(slot=0; slot<BVH_WIDTH; slot++)
+	{
+		if(m_nodes[node].children[slot] == BVH_EMPTY_SLOT)
+		{
+			continue;
+		}
+
+		GetSlotBounds(m_nodes[node], slot, slotBounds);
+		if(first)
+		{
+			bounds = slotBounds;
+			first = false;
+		}
+		else
+		{
+			MergeBounds(bounds, slotBounds, bounds);
+		}
+	}
+
+	return;
+}
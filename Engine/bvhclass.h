@@ -0,0 +1,184 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	bvhclass.h
+//
+// summary:	Declares the bvhclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _BVHCLASS_H_
+#define _BVHCLASS_H_
+
+// Pre-processing directives.
+// The four boxes of a node are tested at once with SSE where the compiler has it, one by one elsewhere.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#define BVH_SIMD
+#endif
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "sceneclass.h"
+#include "debugdrawclass.h"
+
+// Globals.
+const int BVH_WIDTH = 4;
+const int BVH_BINS = 16;
+const int BVH_EMPTY_SLOT = -1;
+const int BVH_FRUSTUM_PLANES = 6;
+const float BVH_REBUILD_GROWTH = 2.0f;
+const int BVH_REBUILD_BUDGET = 32768;
+const int BVH_BENCHMARK_SMALL = 100000;
+const int BVH_BENCHMARK_LARGE = 1000000;
+const int BVH_BENCHMARK_QUERIES = 1000;
+const float BVH_BENCHMARK_MOVED = 0.01f;
+const float BVH_BENCHMARK_TELEPORTED = 0.1f;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A node: the boxes of its four children, as centers and half extents with one array per
+/// 	axis so the four are tested in one go, and what each child is. A child is a node if it
+/// 	is 0 or more, an object if it is below BVH_EMPTY_SLOT (-2 is object 0, -3 object 1...).
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct BvhNode
+{
+	float centerX[BVH_WIDTH];
+	float centerY[BVH_WIDTH];
+	float centerZ[BVH_WIDTH];
+	float extentX[BVH_WIDTH];
+	float extentY[BVH_WIDTH];
+	float extentZ[BVH_WIDTH];
+	int children[BVH_WIDTH];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> An object whose box a ray goes through, and how far along the ray it enters it. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct BvhRayHit
+{
+	int id;
+	float distance;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	What one benchmark measured, in ms: the SAH build, a frustum query against the tree and
+/// 	against every object, a thousand ray and box queries, the refit after a share of the
+/// 	objects moved a little, and the refit with the subtree rebuilds after a share of them
+/// 	were thrown across the world. The costs are the SAH cost of the tree as built, after
+/// 	the repairs and after a full build.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct BvhBenchmark
+{
+	int objects;
+	int nodes;
+	int visible;
+	double buildMs;
+	double frustumMs;
+	double bruteForceMs;
+	double raysMs;
+	double boxesMs;
+	double refitMs;
+	double repairMs;
+	float builtCost;
+	float repairedCost;
+	float rebuiltCost;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A bounding volume hierarchy over the boxes of the objects of the scene, four children to
+/// 	a node. Build sorts every object into a new tree with the surface area heuristic; Insert
+/// 	and Remove change the tree in place, and Update records the new box of an object, or
+/// 	inserts it again if it left the box of its node. Refit then brings the boxes of the nodes
+/// 	up to date from the bottom up, stopping where a box didn't change. Query after Refit.
+///
+/// 	Moving objects stretch the boxes of their nodes. A node whose box grew past
+/// 	BVH_REBUILD_GROWTH times its area when it was built has its subtree built again by Refit,
+/// 	up to BVH_REBUILD_BUDGET objects per call; the rest waits for the next calls, and a
+/// 	subtree too big for the budget has its children built again instead.
+///
+/// 	The queries give back the ids the objects were inserted with. A frustum query stops
+/// 	testing a plane below a node fully in front of it, and takes whole subtrees without a
+/// 	test once they are inside every plane.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class BvhClass
+{
+private:
+	struct ObjectType
+	{
+		SceneBounds bounds;
+		int id;
+		int node;
+		int slot;
+	};
+
+	struct NodeInfoType
+	{
+		int parent;
+		int slot;
+		int depth;
+		int objectCount;
+		float builtArea;
+		bool dirty;
+		bool degraded;
+	};
+
+public:
+	BvhClass();
+	BvhClass(const BvhClass&);
+	~BvhClass();
+
+	bool Initialize(int = 0);
+	void Shutdown();
+
+	int Insert(const SceneBounds&, int);
+	void Update(int, const SceneBounds&);
+	void Remove(int);
+	void Build();
+	void Refit();
+
+	int QueryFrustum(const SceneVector*, vector<int>&);
+	int QueryRay(const SceneVector&, const SceneVector&, float, vector<BvhRayHit>&);
+	int QueryBox(const SceneBounds&, vector<int>&);
+
+	void DrawDebug(const float*, const float*, DebugDrawMode = DEBUG_DRAW_DEPTH_TEST);
+
+	int GetObjectCount();
+	int GetNodeCount();
+	float GetCost();
+
+	static bool Benchmark(int, BvhBenchmark&);
+
+private:
+	void InsertObject(int);
+	void DetachObject(int);
+	int AllocateNode(int, int, int);
+	void FreeNode(int);
+	int BuildNode(int*, int, int, int, int);
+	int SplitObjects(int*, int);
+	void SetSlot(int, int, int);
+	void ClearSlot(int, int);
+	void MarkDirty(int);
+	void AddObjectCount(int, int);
+	void RebuildNode(int);
+	void CollectObjects(int, vector<int>&);
+	void FreeSubtree(int);
+	void AddSubtree(int, vector<int>&);
+	void GetNodeBounds(int, SceneBounds&);
+
+private:
+	vector<BvhNode> m_nodes;
+	vector<NodeInfoType> m_nodeInfos;
+	vector<int> m_freeNodes;
+	vector<ObjectType> m_objects;
+	vector<int> m_freeObjects;
+	vector<vector<int> > m_dirtyLevels;
+	vector<int> m_degraded;
+	int m_root;
+	int m_objectCount;
+};
+
+#endif
@@ -11,12 +11,14 @@ struct VertexInputType
 {
 	float4 position : POSITION;
 	float4 color : COLOR;
+	float2 tex : TEXCOORD0;
 };
 
 struct PixelInputType
 {
 	float4 position : SV_POSITION;
 	float4 color : COLOR;
+	float2 tex : TEXCOORD0;
 };
 
 // Vertex Shader
@@ -34,6 +36,9 @@ PixelInputType ColorVertexShader(VertexInputType input)
 
 	// Store the input color for the pixel shader to use.
 	output.color = input.color;
+
+	// Store the texture coordinates for the pixel shader.
+	output.tex = input.tex;
 	
 	return output;
 }
\ No newline at end of file
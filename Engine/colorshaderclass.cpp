@@ -6,6 +6,11 @@ ColorShaderClass::ColorShaderClass()
 	m_pixelShader = 0;
 	m_layout = 0;
 	m_matrixBuffer = 0;
+	m_sampleState = 0;
+	m_vertexShaderBuffer = 0;
+	m_pixelShaderBuffer = 0;
+	m_residencyManager = 0;
+	m_matrixHandle = -1;
 }
 
 ColorShaderClass::ColorShaderClass(const ColorShaderClass& other)
@@ -17,12 +22,25 @@ ColorShaderClass::~ColorShaderClass()
 {
 }
 
-bool ColorShaderClass::Initialize(ID3D11Device* device, HWND hwnd)
+bool ColorShaderClass::Initialize(ID3D11Device* device, HWND hwnd, ResidencyManagerClass* residencyManager, FileSystemClass* fileSystem)
 {
 	bool result;
 
+	// Keep the residency manager, the constant buffer is registered with it once created.
+	m_residencyManager = residencyManager;
+
+	// Compile the vertex and pixel shaders, unless the startup already did it on a worker thread.
+	if(!m_vertexShaderBuffer || !m_pixelShaderBuffer)
+	{
+		result = Compile(fileSystem, hwnd);
+		if(!result)
+		{
+			return false;
+		}
+	}
+
 	// Initialize the vertex and pixel shaders.
-	result = InitializeShader(device, hwnd, L"../Engine/color.vs", L"../Engine/color.ps");
+	result = InitializeShader(device);
 	if(!result)
 	{
 		return false;
@@ -31,81 +49,141 @@ bool ColorShaderClass::Initialize(ID3D11Device* device, HWND hwnd)
 	return true;
 }
 
+/*
+	Compiling needs no device, so the startup can run it on any thread while the device is being created. 
+	The compiled code is kept until Initialize creates the shaders from it.
+	The source files are found through the file system, so they can come from a pack.
+*/
+bool ColorShaderClass::Compile(FileSystemClass* fileSystem, HWND hwnd)
+{
+	PROFILE_FUNCTION();
+
+	return CompileShaders(fileSystem, hwnd, "color.vs", "color.ps");
+}
+
 void ColorShaderClass::Shutdown()
 {
 	// Shutdown the vertex and pixel shaders as well as the related objects.
 	ShutdownShader();
 }
 
-bool ColorShaderClass::Render(ID3D11DeviceContext* deviceContext, int indexCount, D3DXMATRIX worldMatrix, D3DXMATRIX viewMatrix, D3DXMATRIX projectionMatrix)
+bool ColorShaderClass::Render(ID3D11DeviceContext* deviceContext, int indexCount, D3DXMATRIX worldMatrix, D3DXMATRIX viewMatrix, D3DXMATRIX projectionMatrix, ID3D11ShaderResourceView* texture)
+{
+	// Draw from the start of the bound buffers.
+	return Render(deviceContext, indexCount, 0, 0, worldMatrix, viewMatrix, projectionMatrix, texture);
+}
+
+/*
+	Models living in the shared buffers of the geometry pool are drawn from the middle of them. 
+	The start index is where their indices begin and the base vertex is added to every index to find their vertices.
+	The texture is multiplied with the vertex color, so a white texture leaves the color as it is.
+*/
+bool ColorShaderClass::Render(ID3D11DeviceContext* deviceContext, int indexCount, int startIndex, int baseVertex, D3DXMATRIX worldMatrix, D3DXMATRIX viewMatrix, D3DXMATRIX projectionMatrix, ID3D11ShaderResourceView* texture)
 {
 	bool result;
 
+	PROFILE_FUNCTION();
+
 	// Set the shader parameters that it will use for rendering.
-	result = SetShaderParameters(deviceContext, worldMatrix, viewMatrix, projectionMatrix);
+	result = SetShaderParameters(deviceContext, worldMatrix, viewMatrix, projectionMatrix, texture);
 	if(!result)
 	{
 		return false;
 	}
 
 	// Now render the prepared buffers with the shader.
-	RenderShader(deviceContext, indexCount);
+	RenderShader(deviceContext, indexCount, startIndex, baseVertex);
 
 	return true;
 }
 
-bool ColorShaderClass::InitializeShader(ID3D11Device* device, HWND hwnd, WCHAR* vsFilename, WCHAR* psFilename)
+bool ColorShaderClass::CompileShaders(FileSystemClass* fileSystem, HWND hwnd, const char* vsFilename, const char* psFilename)
+{
+	bool result;
+
+
+	// Compile the vertex shader code.
+	result = CompileShader(fileSystem, hwnd, vsFilename, "ColorVertexShader", "vs_5_0", &m_vertexShaderBuffer);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Compile the pixel shader code.
+	result = CompileShader(fileSystem, hwnd, psFilename, "ColorPixelShader", "ps_5_0", &m_pixelShaderBuffer);
+	if(!result)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+/*
+	Compiles one shader from its source in memory. 
+	A shader stored uncompressed in a pack is compiled straight from the mapped pack, anything else is read into a buffer first.
+*/
+bool ColorShaderClass::CompileShader(FileSystemClass* fileSystem, HWND hwnd, const char* filename, const char* entryPoint, const char* profile, ID3D10Blob** shaderBuffer)
 {
 	HRESULT result;
 	ID3D10Blob* errorMessage;
-	ID3D10Blob* vertexShaderBuffer;
-	ID3D10Blob* pixelShaderBuffer;
-	D3D11_INPUT_ELEMENT_DESC polygonLayout[2];
-	unsigned int numElements;
-	D3D11_BUFFER_DESC matrixBufferDesc;
+	vector<char> data;
+	const char* source;
+	size_t size;
 
 
 	// Initialize the pointers this function will use to null.
 	errorMessage = 0;
-	vertexShaderBuffer = 0;
-	pixelShaderBuffer = 0;
 
-	// Compile the vertex shader code.
-	result = D3DX11CompileFromFile(vsFilename, NULL, NULL, "ColorVertexShader", "vs_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, NULL, &vertexShaderBuffer, &errorMessage, NULL);
-	if(FAILED(result))
+	// Find the source of the shader.
+	source = fileSystem ? fileSystem->GetMappedData(filename, size) : 0;
+	if(!source)
 	{
-		// If the shader failed to compile it should have writen something to the error message.
-		if(errorMessage)
+		if(!fileSystem || !fileSystem->ReadFile(filename, data) || data.empty())
 		{
-			OutputShaderErrorMessage(errorMessage, hwnd, vsFilename);
-		}
-		// If there was nothing in the error message then it simply could not find the shader file itself.
-		else
-		{
-			MessageBox(hwnd, vsFilename, L"Missing Shader File", MB_OK);
+			LOG_ERROR(LOG_CATEGORY_SHADER, "Missing shader file %s.", filename);
+			return false;
 		}
 
-		return false;
+		source = &data[0];
+		size = data.size();
 	}
 
-	// Compile the pixel shader code.
-	result = D3DX11CompileFromFile(psFilename, NULL, NULL, "ColorPixelShader", "ps_5_0", D3D10_SHADER_ENABLE_STRICTNESS, 0, NULL, &pixelShaderBuffer, &errorMessage, NULL);
+	// Compile the shader code.
+	result = D3DX11CompileFromMemory(source, size, filename, NULL, NULL, entryPoint, profile, D3D10_SHADER_ENABLE_STRICTNESS, 0, NULL, shaderBuffer, &errorMessage, NULL);
 	if(FAILED(result))
 	{
 		// If the shader failed to compile it should have writen something to the error message.
 		if(errorMessage)
 		{
-			OutputShaderErrorMessage(errorMessage, hwnd, psFilename);
+			OutputShaderErrorMessage(errorMessage, hwnd, filename);
 		}
-		// If there was  nothing in the error message then it simply could not find the file itself.
 		else
 		{
-			MessageBox(hwnd, psFilename, L"Missing Shader File", MB_OK);
+			LOG_ERROR(LOG_CATEGORY_SHADER, "Could not compile shader %s.", filename);
 		}
 
 		return false;
 	}
 
+	return true;
+}
+
+bool ColorShaderClass::InitializeShader(ID3D11Device* device)
+{
+	HRESULT result;
+	ID3D10Blob* vertexShaderBuffer;
+	ID3D10Blob* pixelShaderBuffer;
+	D3D11_INPUT_ELEMENT_DESC polygonLayout[3];
+	unsigned int numElements;
+	D3D11_BUFFER_DESC matrixBufferDesc;
+	D3D11_SAMPLER_DESC samplerDesc;
+
+
+	// Use the code Compile left behind.
+	vertexShaderBuffer = m_vertexShaderBuffer;
+	pixelShaderBuffer = m_pixelShaderBuffer;
+
 	//--------------------------------------------------------------------------------------
 
 	// Create the vertex shader from the buffer.
@@ -114,6 +192,7 @@ bool ColorShaderClass::InitializeShader(ID3D11Device* device, HWND hwnd, WCHAR*
 	{
 		return false;
 	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
 
 	// Create the pixel shader from the buffer.
 	result = device->CreatePixelShader(pixelShaderBuffer->GetBufferPointer(), pixelShaderBuffer->GetBufferSize(), NULL, &m_pixelShader);
@@ -121,6 +200,7 @@ bool ColorShaderClass::InitializeShader(ID3D11Device* device, HWND hwnd, WCHAR*
 	{
 		return false;
 	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
 
 	//--------------------------------------------------------------------------------------
 
@@ -142,6 +222,14 @@ bool ColorShaderClass::InitializeShader(ID3D11Device* device, HWND hwnd, WCHAR*
 	polygonLayout[1].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
 	polygonLayout[1].InstanceDataStepRate = 0;
 
+	polygonLayout[2].SemanticName = "TEXCOORD";
+	polygonLayout[2].SemanticIndex = 0;
+	polygonLayout[2].Format = DXGI_FORMAT_R32G32_FLOAT;
+	polygonLayout[2].InputSlot = 0;
+	polygonLayout[2].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
+	polygonLayout[2].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+	polygonLayout[2].InstanceDataStepRate = 0;
+
 	// Get a count of the elements in the layout.
 	numElements = sizeof(polygonLayout) / sizeof(polygonLayout[0]);
 
@@ -151,13 +239,14 @@ bool ColorShaderClass::InitializeShader(ID3D11Device* device, HWND hwnd, WCHAR*
 	{
 		return false;
 	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
 
 	// Release the vertex shader buffer and pixel shader buffer since they are no longer needed.
 	vertexShaderBuffer->Release();
-	vertexShaderBuffer = 0;
+	m_vertexShaderBuffer = 0;
 
 	pixelShaderBuffer->Release();
-	pixelShaderBuffer = 0;
+	m_pixelShaderBuffer = 0;
 
 	//--------------------------------------------------------------------------------------
 
@@ -179,15 +268,75 @@ bool ColorShaderClass::InitializeShader(ID3D11Device* device, HWND hwnd, WCHAR*
 	{
 		return false;
 	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
+
+	// Account for the constant buffer memory.
+	if(m_residencyManager)
+	{
+		m_matrixHandle = m_residencyManager->Register(RESOURCE_CONSTANT_BUFFER, matrixBufferDesc.ByteWidth, NULL);
+	}
+
+	/*
+	The sampler state tells the pixel shader how to read the texture. The filter is trilinear, so the pixel shader blends between the two nearest mip levels and the texture doesn't shimmer in the distance. The texture coordinates wrap, so values past 1 repeat the texture.
+	*/
+
+	// Create a texture sampler state description.
+	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	samplerDesc.MipLODBias = 0.0f;
+	samplerDesc.MaxAnisotropy = 1;
+	samplerDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+	samplerDesc.BorderColor[0] = 0;
+	samplerDesc.BorderColor[1] = 0;
+	samplerDesc.BorderColor[2] = 0;
+	samplerDesc.BorderColor[3] = 0;
+	samplerDesc.MinLOD = 0;
+	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	// Create the texture sampler state.
+	result = device->CreateSamplerState(&samplerDesc, &m_sampleState);
+	if(FAILED(result))
+	{
+		return false;
+	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
 
 	return true;
 }
 
 void ColorShaderClass::ShutdownShader()
 {
+	// Release the compiled code, if the shaders were never created from it.
+	if(m_vertexShaderBuffer)
+	{
+		m_vertexShaderBuffer->Release();
+		m_vertexShaderBuffer = 0;
+	}
+
+	if(m_pixelShaderBuffer)
+	{
+		m_pixelShaderBuffer->Release();
+		m_pixelShaderBuffer = 0;
+	}
+
+	// Release the sampler state.
+	if(m_sampleState)
+	{
+		m_sampleState->Release();
+		m_sampleState = 0;
+	}
+
 	// Release the matrix constant buffer.
 	if(m_matrixBuffer)
 	{
+		if(m_residencyManager)
+		{
+			m_residencyManager->Unregister(m_matrixHandle);
+		}
+		m_matrixHandle = -1;
+
 		m_matrixBuffer->Release();
 		m_matrixBuffer = 0;
 	}
@@ -216,11 +365,12 @@ void ColorShaderClass::ShutdownShader()
 	return;
 }
 
-void ColorShaderClass::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, WCHAR* shaderFilename)
+void ColorShaderClass::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND hwnd, const char* shaderFilename)
 {
 	char* compileErrors;
+	char line[LOG_TEXT_SIZE];
 	unsigned long bufferSize, i;
-	ofstream fout;
+	int length;
 
 	// Get a pointer to the error message text buffer.
 	compileErrors = (char*)(errorMessage->GetBufferPointer());
@@ -228,29 +378,37 @@ void ColorShaderClass::OutputShaderErrorMessage(ID3D10Blob* errorMessage, HWND h
 	// Get the length of the message.
 	bufferSize = errorMessage->GetBufferSize();
 
-	// Open a file to write the error message to.
-	fout.open("shader-error.txt");
+	LOG_ERROR(LOG_CATEGORY_SHADER, "Error compiling shader %s.", shaderFilename);
 
-	// Write out the error message.
-	for(i=0; i<bufferSize; i++)
+	// Log the compiler output one line at a time, the buffer isn't always null terminated.
+	length = 0;
+	for(i=0; i<=bufferSize; i++)
 	{
-		fout << compileErrors[i];
-	}
+		// A line ends at a new line, at the end of the buffer or when it doesn't fit in a record.
+		if(i == bufferSize || compileErrors[i] == '\n' || compileErrors[i] == '\0' || length == LOG_TEXT_SIZE - 1)
+		{
+			line[length] = '\0';
+			if(length > 0)
+			{
+				LOG_ERROR(LOG_CATEGORY_SHADER, "%s", line);
+			}
+			length = 0;
+		}
 
-	// Close the file.
-	fout.close();
+		if(i < bufferSize && compileErrors[i] != '\n' && compileErrors[i] != '\r' && compileErrors[i] != '\0')
+		{
+			line[length++] = compileErrors[i];
+		}
+	}
 
 	// Release the error message.
 	errorMessage->Release();
 	errorMessage = 0;
 
-	// Pop a message up on the screen to notify the user to check the text file for compile errors.
-	MessageBox(hwnd, L"Error compiling shader.  Check shader-error.txt for message.", shaderFilename, MB_OK);
-
 	return;
 }
 
-bool ColorShaderClass::SetShaderParameters(ID3D11DeviceContext* deviceContext, D3DXMATRIX worldMatrix, D3DXMATRIX viewMatrix, D3DXMATRIX projectionMatrix)
+bool ColorShaderClass::SetShaderParameters(ID3D11DeviceContext* deviceContext, D3DXMATRIX worldMatrix, D3DXMATRIX viewMatrix, D3DXMATRIX projectionMatrix, ID3D11ShaderResourceView* texture)
 {
 	HRESULT result;
 	D3D11_MAPPED_SUBRESOURCE mappedResource;
@@ -280,16 +438,26 @@ bool ColorShaderClass::SetShaderParameters(ID3D11DeviceContext* deviceContext, D
 	// Unlock the constant buffer.
 	deviceContext->Unmap(m_matrixBuffer, 0);
 
+	RenderStatsClass::Add(RENDER_COUNTER_MAP_CALLS);
+	RenderStatsClass::Add(RENDER_COUNTER_MAP_BYTES, sizeof(MatrixBufferType));
+
 	// Set the position of the constant buffer in the vertex shader.
 	bufferNumber = 0;
 
 	// Finanly set the constant buffer in the vertex shader with the updated values.
 	deviceContext->VSSetConstantBuffers(bufferNumber, 1, &m_matrixBuffer);
 
+	RenderStatsClass::Add(RENDER_COUNTER_BUFFER_BINDS);
+
+	// Set the texture in the pixel shader.
+	deviceContext->PSSetShaderResources(0, 1, &texture);
+
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
+
 	return true;
 }
 
-void ColorShaderClass::RenderShader(ID3D11DeviceContext* deviceContext, int indexCount)
+void ColorShaderClass::RenderShader(ID3D11DeviceContext* deviceContext, int indexCount, int startIndex, int baseVertex)
 {
 	// Set the vertex input layout.
 	deviceContext->IASetInputLayout(m_layout);
@@ -298,6 +466,16 @@ void ColorShaderClass::RenderShader(ID3D11DeviceContext* deviceContext, int inde
 	deviceContext->VSSetShader(m_vertexShader, NULL, 0);
 	deviceContext->PSSetShader(m_pixelShader, NULL, 0);
 
+	// Set the sampler state in the pixel shader.
+	deviceContext->PSSetSamplers(0, 1, &m_sampleState);
+
 	// Render the triangle.
-	deviceContext->DrawIndexed(indexCount, 0, 0);
+	deviceContext->DrawIndexed(indexCount, startIndex, baseVertex);
+
+	// Count the layout and the sampler as state binds, the two shaders as shader binds and the triangle list primitives.
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS, 2);
+	RenderStatsClass::Add(RENDER_COUNTER_SHADER_BINDS, 2);
+	RenderStatsClass::Add(RENDER_COUNTER_DRAW_CALLS);
+	RenderStatsClass::Add(RENDER_COUNTER_INSTANCES);
+	RenderStatsClass::Add(RENDER_COUNTER_PRIMITIVES, indexCount / 3);
 }
\ No newline at end of file
@@ -4,7 +4,12 @@
 #include <d3d11.h>
 #include <d3dx10math.h>
 #include <d3dx11async.h>
-#include <fstream>
+
+#include "residencymanagerclass.h"
+#include "filesystemclass.h"
+#include "profilerclass.h"
+#include "renderstatsclass.h"
+#include "logclass.h"
 
 using namespace std;
 
@@ -23,23 +28,32 @@ public:
 	ColorShaderClass(const ColorShaderClass&);
 	~ColorShaderClass();
 
-	bool Initialize(ID3D11Device*, HWND);
+	bool Compile(FileSystemClass*, HWND);
+	bool Initialize(ID3D11Device*, HWND, ResidencyManagerClass*, FileSystemClass*);
 	void Shutdown();
-	bool Render(ID3D11DeviceContext*, int, D3DXMATRIX, D3DXMATRIX, D3DXMATRIX);
+	bool Render(ID3D11DeviceContext*, int, D3DXMATRIX, D3DXMATRIX, D3DXMATRIX, ID3D11ShaderResourceView*);
+	bool Render(ID3D11DeviceContext*, int, int, int, D3DXMATRIX, D3DXMATRIX, D3DXMATRIX, ID3D11ShaderResourceView*);
 
 private:
-	bool InitializeShader(ID3D11Device*, HWND, WCHAR*, WCHAR*);
+	bool CompileShaders(FileSystemClass*, HWND, const char*, const char*);
+	bool CompileShader(FileSystemClass*, HWND, const char*, const char*, const char*, ID3D10Blob**);
+	bool InitializeShader(ID3D11Device*);
 	void ShutdownShader();
-	void OutputShaderErrorMessage(ID3D10Blob*, HWND, WCHAR*);
+	void OutputShaderErrorMessage(ID3D10Blob*, HWND, const char*);
 
-	bool SetShaderParameters(ID3D11DeviceContext*, D3DXMATRIX, D3DXMATRIX, D3DXMATRIX);
-	void RenderShader(ID3D11DeviceContext*, int);
+	bool SetShaderParameters(ID3D11DeviceContext*, D3DXMATRIX, D3DXMATRIX, D3DXMATRIX, ID3D11ShaderResourceView*);
+	void RenderShader(ID3D11DeviceContext*, int, int, int);
 
 private:
 	ID3D11VertexShader* m_vertexShader;
 	ID3D11PixelShader* m_pixelShader;
 	ID3D11InputLayout* m_layout;
 	ID3D11Buffer* m_matrixBuffer;
+	ID3D11SamplerState* m_sampleState;
+	ID3D10Blob* m_vertexShaderBuffer;
+	ID3D10Blob* m_pixelShaderBuffer;
+	ResidencyManagerClass* m_residencyManager;
+	int m_matrixHandle;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,337 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	compressionclass.cpp
+//
+// summary:	Implements the compressionclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "compressionclass.h"
+
+// System Includes.
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// Globals.
+// A match is at least four bytes, the last five bytes are always literals and no match starts in
+// the last twelve, which is what lets an LZ4 decoder copy in wide steps without reading past the end.
+static const size_t CompressionMinMatch = 4;
+static const size_t CompressionLastLiterals = 5;
+static const size_t CompressionMatchLimit = 12;
+static const size_t CompressionMaxDistance = 65535;
+static const size_t CompressionWindow = 65536;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads four bytes from any address. </summary>
+///
+/// <param name="source"> The bytes. </param>
+///
+/// <returns> The value. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline unsigned int Read32(const char* source)
+{
+	unsigned int value;
+
+	memcpy(&value, source, sizeof(value));
+
+	return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Hashes four bytes into an index of the match table. </summary>
+///
+/// <param name="value"> The bytes. </param>
+///
+/// <returns> The index. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static inline unsigned int HashSequence(unsigned int value)
+{
+	return (value * 2654435761u) >> (32 - COMPRESSION_HASH_BITS);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes the part of a length that didn't fit in the token, as bytes of 255 and a rest. </summary>
+///
+/// <param name="output"> Where to write. </param>
+/// <param name="length"> The length left. </param>
+///
+/// <returns> The end of what was written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static char* WriteLength(char* output, size_t length)
+{
+	while(length >= 255)
+	{
+		*output++ = (char)255;
+		length -= 255;
+	}
+	*output++ = (char)length;
+
+	return output;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes a sequence, the literals followed by the match. </summary>
+///
+/// <param name="output">		 Where to write. </param>
+/// <param name="literals">		 The literals. </param>
+/// <param name="literalLength"> The number of literals. </param>
+/// <param name="offset">		 How far back the match is. </param>
+/// <param name="matchLength">   The length of the match, 0 for the last sequence, which has none. </param>
+///
+/// <returns> The end of what was written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static char* WriteSequence(char* output, const char* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+	unsigned char* token;
+
+	// The token holds both lengths, 15 means the rest follows.
+	token = (unsigned char*)output++;
+	*token = (unsigned char)((literalLength < 15 ? literalLength : 15) << 4);
+	if(literalLength >= 15)
+	{
+		output = WriteLength(output, literalLength - 15);
+	}
+
+	memcpy(output, literals, literalLength);
+	output += literalLength;
+
+	if(matchLength == 0)
+	{
+		return output;
+	}
+
+	// The offset is little endian.
+	*output++ = (char)(offset & 0xFF);
+	*output++ = (char)(offset >> 8);
+
+	matchLength -= CompressionMinMatch;
+	*token |= (unsigned char)(matchLength < 15 ? matchLength : 15);
+	if(matchLength >= 15)
+	{
+		output = WriteLength(output, matchLength - 15);
+	}
+
+	return output;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the size the output of Compress can reach, for data that doesn't compress. </summary>
+///
+/// <param name="size"> The size of the data. </param>
+///
+/// <returns> The size in bytes. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CompressionClass::GetCompressBound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Compresses a block. </summary>
+///
+/// <param name="source">		   The data. </param>
+/// <param name="size">			   The size of the data. </param>
+/// <param name="destination">	   [out] The compressed data. </param>
+/// <param name="destinationSize"> The size of destination, at least GetCompressBound(size). </param>
+/// <param name="level">		   How hard to look for matches. </param>
+///
+/// <returns> The compressed size, 0 if destination is too small. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t CompressionClass::Compress(const char* source, size_t size, char* destination, size_t destinationSize, CompressionLevel level)
+{
+	vector<int> table, chain;
+	char* output;
+	size_t position, anchor, limit, matchEnd, length, bestLength, bestOffset, i;
+	unsigned int hash;
+	int candidate, depth;
+
+	if(!source || !destination || destinationSize < GetCompressBound(size))
+	{
+		return 0;
+	}
+
+	// The last position seen for every hash, and for the high level the one before it with the same hash.
+	table.assign((size_t)1 << COMPRESSION_HASH_BITS, -1);
+	if(level == COMPRESSION_HIGH)
+	{
+		chain.assign(CompressionWindow, -1);
+	}
+
+	output = destination;
+	anchor = 0;
+	position = 0;
+	limit = size > CompressionMatchLimit ? size - CompressionMatchLimit : 0;
+	matchEnd = size > CompressionLastLiterals ? size - CompressionLastLiterals : 0;
+
+	while(position < limit)
+	{
+		hash = HashSequence(Read32(source + position));
+		candidate = table[hash];
+		table[hash] = (int)position;
+
+		bestLength = 0;
+		bestOffset = 0;
+		if(level == COMPRESSION_HIGH)
+		{
+			chain[position & (CompressionWindow - 1)] = candidate;
+		}
+
+		// Try the candidates, only the first one on the fast level.
+		for(depth=0; candidate >= 0 && position - candidate <= CompressionMaxDistance && depth < COMPRESSION_HIGH_SEARCH_DEPTH; depth++)
+		{
+			if(Read32(source + candidate) == Read32(source + position))
+			{
+				length = CompressionMinMatch;
+				while(position + length < matchEnd && source[candidate + length] == source[position + length])
+				{
+					length++;
+				}
+
+				if(length > bestLength)
+				{
+					bestLength = length;
+					bestOffset = position - candidate;
+				}
+			}
+
+			if(level != COMPRESSION_HIGH)
+			{
+				break;
+			}
+			candidate = chain[candidate & (CompressionWindow - 1)];
+		}
+
+		if(bestLength == 0)
+		{
+			position++;
+			continue;
+		}
+
+		output = WriteSequence(output, source + anchor, position - anchor, bestOffset, bestLength);
+
+		// The high level also remembers the positions inside the match, the next matches are found from them.
+		if(level == COMPRESSION_HIGH)
+		{
+			for(i=position + 1; i<position + bestLength && i<limit; i++)
+			{
+				hash = HashSequence(Read32(source + i));
+				chain[i & (CompressionWindow - 1)] = table[hash];
+				table[hash] = (int)i;
+			}
+		}
+
+		position += bestLength;
+		anchor = position;
+	}
+
+	// The rest is literals.
+	output = WriteSequence(output, source + anchor, size - anchor, 0, 0);
+
+	return (size_t)(output - destination);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Decompresses a block, checking every length against both buffers. </summary>
+///
+/// <param name="source">		   The compressed data. </param>
+/// <param name="size">			   The size of the compressed data. </param>
+/// <param name="destination">	   [out] The data. </param>
+/// <param name="destinationSize"> The size the data had before it was compressed. </param>
+///
+/// <returns> true if it succeeds, false if the data is corrupt or has another size. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool CompressionClass::Decompress(const char* source, size_t size, char* destination, size_t destinationSize)
+{
+	const unsigned char* input;
+	size_t in, out, length, offset, i;
+	unsigned char token, byte;
+
+	if(!source || (!destination && destinationSize > 0))
+	{
+		return false;
+	}
+
+	input = (const unsigned char*)source;
+	in = 0;
+	out = 0;
+	while(in < size)
+	{
+		token = input[in++];
+
+		// Copy the literals.
+		length = token >> 4;
+		if(length == 15)
+		{
+			do
+			{
+				if(in >= size)
+				{
+					return false;
+				}
+				byte = input[in++];
+				length += byte;
+			}
+			while(byte == 255);
+		}
+
+		if(length > size - in || length > destinationSize - out)
+		{
+			return false;
+		}
+		memcpy(destination + out, source + in, length);
+		in += length;
+		out += length;
+
+		// The last sequence has no match.
+		if(in == size)
+		{
+			break;
+		}
+
+		// Copy the match, a byte at a time since it can overlap what it writes.
+		if(size - in < 2)
+		{
+			return false;
+		}
+		offset = input[in] | (input[in + 1] << 8);
+		in += 2;
+		if(offset == 0 || offset > out)
+		{
+			return false;
+		}
+
+		length = token & 15;
+		if(length == 15)
+		{
+			do
+			{
+				if(in >= size)
+				{
+					return false;
+				}
+				byte = input[in++];
+				length += byte;
+			}
+			while(byte == 255);
+		}
+		length += CompressionMinMatch;
+
+		if(length > destinationSize - out)
+		{
+			return false;
+		}
+
+		if(offset >= length)
+		{
+			memcpy(destination + out, destination + out - offset, length);
+		}
+		else
+		{
+			for(i=0; i<length; i++)
+			{
+				destination[out + i] = destination[out + i - offset];
+			}
+		}
+		out += length;
+	}
+
+	return out == destinationSize;
+}
@@ -0,0 +1,45 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	compressionclass.h
+//
+// summary:	Declares the compressionclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _COMPRESSIONCLASS_H_
+#define _COMPRESSIONCLASS_H_
+
+// System Includes.
+#include <cstddef>
+
+// Globals.
+const int COMPRESSION_HASH_BITS = 16;
+const int COMPRESSION_HIGH_SEARCH_DEPTH = 64;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent how hard the compressor looks for matches. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum CompressionLevel
+{
+	COMPRESSION_FAST,
+	COMPRESSION_HIGH
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Compresses blocks in the LZ4 block format: runs of literals and matches up to 64 KiB
+/// 	back, with no entropy coding, so decompressing is little more than copying. The fast
+/// 	level takes the first match a hash of the next four bytes finds; the high level follows
+/// 	a chain of earlier positions with the same hash and keeps the longest match, which is
+/// 	much slower to compress and decompresses just as fast.
+///
+/// 	Both work on whole blocks in memory and keep no state between calls, so any thread can
+/// 	use them at the same time.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class CompressionClass
+{
+public:
+	static size_t GetCompressBound(size_t);
+	static size_t Compress(const char*, size_t, char*, size_t, CompressionLevel);
+	static bool Decompress(const char*, size_t, char*, size_t);
+};
+
+#endif
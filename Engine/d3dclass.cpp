@@ -9,6 +9,11 @@ D3DClass::D3DClass()
 	m_depthStencilState = 0;
 	m_depthStencilView = 0;
 	m_rasterState = 0;
+	m_depthDisabledStencilState = 0;
+	m_alphaEnableBlendingState = 0;
+	m_alphaDisableBlendingState = 0;
+	m_depthStencilHandle = -1;
+	ZeroMemory(&m_viewport, sizeof(m_viewport));
 }
 
 D3DClass::D3DClass(const D3DClass& other)
@@ -38,9 +43,13 @@ bool D3DClass::Initialize(int screenWidth, int screenHeight, bool vsync, HWND hw
 	D3D11_DEPTH_STENCIL_DESC depthStencilDesc;
 	D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc;
 	D3D11_RASTERIZER_DESC rasterDesc;
+	D3D11_DEPTH_STENCIL_DESC depthDisabledStencilDesc;
+	D3D11_BLEND_DESC blendStateDesc;
 	D3D11_VIEWPORT viewport;
 	float fieldOfView=0.0f;
 	float screenAspect=0.0f;
+	ScratchAllocatorClass scratch;
+	bool allocatorResult;
 
 	// Store the vsync setting.
 	m_vsync_enabled = vsync;
@@ -81,7 +90,8 @@ bool D3DClass::Initialize(int screenWidth, int screenHeight, bool vsync, HWND hw
 	}
 
 	// Create a list to hold all the possible display modes for this monitor/video card combination.
-	displayModeList = new DXGI_MODE_DESC[numModes];
+	// The list is only needed inside this function, so it lives on the scratch stack and is given back on every return path.
+	displayModeList = (DXGI_MODE_DESC*)scratch.Allocate(sizeof(DXGI_MODE_DESC) * numModes);
 	if(!displayModeList)
 	{
 		return false;
@@ -118,6 +128,21 @@ bool D3DClass::Initialize(int screenWidth, int screenHeight, bool vsync, HWND hw
 	// Store the dedicated video card memory in megabytes.
 	m_videoCardMemory = (int)(adapterDesc.DedicatedVideoMemory / 1024 / 1024);
 
+	/*
+		The residency manager keeps the buffers and textures we create under a share of the dedicated video memory. 
+		Some adapters (the reference and software ones, and some integrated cards) report no dedicated memory at all, in which case a default is used.
+	*/
+
+	// Start tracking the video memory with a budget derived from the memory of the card.
+	if(m_videoCardMemory > 0)
+	{
+		m_residencyManager.Initialize((unsigned long long)((double)m_videoCardMemory * 1024.0 * 1024.0 * VIDEO_MEMORY_BUDGET));
+	}
+	else
+	{
+		m_residencyManager.Initialize((unsigned long long)((double)DEFAULT_VIDEO_MEMORY * 1024.0 * 1024.0 * VIDEO_MEMORY_BUDGET));
+	}
+
 	// Convert the name of the video card to a character array and store it.
 	error = wcstombs_s(&stringLength, m_videoCardDescription, 128, adapterDesc.Description, 128);
 	if(error != 0)
@@ -125,10 +150,6 @@ bool D3DClass::Initialize(int screenWidth, int screenHeight, bool vsync, HWND hw
 		return false;
 	}
 
-	// Release the display mode list.
-	delete [] displayModeList;
-	displayModeList = 0;
-
 	// Release the adapter output.
 	adapterOutput->Release();
 	adapterOutput = 0;
@@ -162,8 +183,9 @@ bool D3DClass::Initialize(int screenWidth, int screenHeight, bool vsync, HWND hw
 		swapChainDesc.BufferDesc.RefreshRate.Denominator = 1;
 	}
 
-	// Set regular 32-bit surface for the back buffer.
-	swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	// Set regular 32-bit surface for the back buffer. It is sRGB, so the shaders work in linear light and
+	// the sRGB textures they sample come out the way they were painted.
+	swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
 
 	// Set the scan line ordering and scaling to unspecified.
 	swapChainDesc.BufferDesc.ScanlineOrdering = DXGI_MODE_SCANLINE_ORDER_UNSPECIFIED;
@@ -241,6 +263,7 @@ This is not done automaticaly because many games render to the surface of a mode
 	{
 		return false;
 	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
 
 	// Release pointer to the back buffer as we no longer need it.
 	backBufferPtr->Release();
@@ -276,6 +299,10 @@ This is not done automaticaly because many games render to the surface of a mode
 	{
 		return false;
 	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
+
+	// Account for the depth buffer memory. (4 bytes per texel, it can't be evicted.)
+	m_depthStencilHandle = m_residencyManager.Register(RESOURCE_TEXTURE, (unsigned long long)screenWidth * screenHeight * 4, NULL);
 
 	//---------------------------------------------------------------------------------------------------------------------
 
@@ -300,6 +327,7 @@ This is not done automaticaly because many games render to the surface of a mode
 	{
 		return false;
 	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
 
 	//---------------------------------------------------------------------------------------------------------------------
 
@@ -311,6 +339,7 @@ This is not done automaticaly because many games render to the surface of a mode
 
 	// Bind the render target view and depth stencil buffer to the output render pipeline.
 	m_deviceContext->OMSetRenderTargets(1, &m_renderTargetView, m_depthStencilView);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
 
 	//---------------------------------------------------------------------------------------------------------------------
 
@@ -344,9 +373,11 @@ This is not done automaticaly because many games render to the surface of a mode
 	{
 		return false;
 	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
 
 	// Set the depth stencil state. (Notice we use the device context to set it.)
 	m_deviceContext->OMSetDepthStencilState(m_depthStencilState, 1);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
 
 	//---------------------------------------------------------------------------------------------------------------------
 
@@ -375,9 +406,59 @@ This is not done automaticaly because many games render to the surface of a mode
 	{
 		return false;
 	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
 
 	// Set the rasterizer state for the rasterizer stage of the pipeline.
 	m_deviceContext->RSSetState(m_rasterState);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
+
+	//---------------------------------------------------------------------------------------------------------------------
+
+	/*
+		The 2D elements are drawn over the scene, in the order they come, so they need a depth stencil state that neither tests nor writes the depth,
+		and a blend state that mixes them with what is under them by their alpha. Both are only set while drawing them, see TurnZBufferOff and TurnOnAlphaBlending.
+	*/
+
+	// The same as the depth stencil state above, with the depth testing off.
+	depthDisabledStencilDesc = depthStencilDesc;
+	depthDisabledStencilDesc.DepthEnable = false;
+	depthDisabledStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+
+	// Create the depth stencil state with no depth testing.
+	result = m_device->CreateDepthStencilState(&depthDisabledStencilDesc, &m_depthDisabledStencilState);
+	if(FAILED(result))
+	{
+		return false;
+	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
+
+	// Blend the source by its alpha over the destination.
+	ZeroMemory(&blendStateDesc, sizeof(blendStateDesc));
+	blendStateDesc.RenderTarget[0].BlendEnable = true;
+	blendStateDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	blendStateDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	blendStateDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	blendStateDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	blendStateDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	blendStateDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blendStateDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+	// Create the blend state with the alpha blending on.
+	result = m_device->CreateBlendState(&blendStateDesc, &m_alphaEnableBlendingState);
+	if(FAILED(result))
+	{
+		return false;
+	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
+
+	// And the same with it off, the default of the pipeline.
+	blendStateDesc.RenderTarget[0].BlendEnable = false;
+	result = m_device->CreateBlendState(&blendStateDesc, &m_alphaDisableBlendingState);
+	if(FAILED(result))
+	{
+		return false;
+	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
 
 	/*
 		The viewport also needs to be setup so that Direct3D can map clip space coordinates to the render target space. Set this to be the entire size of the window. 
@@ -393,6 +474,10 @@ This is not done automaticaly because many games render to the surface of a mode
 
 	// Create the viewport.
 	m_deviceContext->RSSetViewports(1, &viewport);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
+
+	// Keep it, the picking maps the screen back to the world through it.
+	m_viewport = viewport;
 
 	//---------------------------------------------------------------------------------------------------------------------
 
@@ -435,6 +520,23 @@ This is not done automaticaly because many games render to the surface of a mode
 
 	//---------------------------------------------------------------------------------------------------------------------
 
+	/*
+		The frame allocator holds everything that only needs to live until the end of the frame. 
+		It is reset in BeginScene, so per frame data never has to be freed one by one and never reaches the heap.
+	*/
+
+	// Create the per frame linear allocator.
+	allocatorResult = m_frameAllocator.Initialize(FRAME_ALLOCATOR_SIZE);
+	if(!allocatorResult)
+	{
+		return false;
+	}
+
+	// Start counting the work of each frame. Without the shared memory segment the counters are still readable through RenderStatsClass, so a failure is not fatal.
+	RenderStatsClass::Initialize();
+
+	//---------------------------------------------------------------------------------------------------------------------
+
 	/*	
 		- Select the best adaptor/display
 		- Create the SwapChain
@@ -456,12 +558,36 @@ This is not done automaticaly because many games render to the surface of a mode
 
 void D3DClass::Shutdown()
 {
+	// Release the frame allocator.
+	m_frameAllocator.Shutdown();
+
+	// Stop publishing the render counters.
+	RenderStatsClass::Shutdown();
+
 	// Before shutting down set to windowed mode or when you release the swap chain it will throw an exception.
 	if(m_swapChain)
 	{
 		m_swapChain->SetFullscreenState(false, NULL);
 	}
 
+	if(m_alphaDisableBlendingState)
+	{
+		m_alphaDisableBlendingState->Release();
+		m_alphaDisableBlendingState = 0;
+	}
+
+	if(m_alphaEnableBlendingState)
+	{
+		m_alphaEnableBlendingState->Release();
+		m_alphaEnableBlendingState = 0;
+	}
+
+	if(m_depthDisabledStencilState)
+	{
+		m_depthDisabledStencilState->Release();
+		m_depthDisabledStencilState = 0;
+	}
+
 	if(m_rasterState)
 	{
 		m_rasterState->Release();
@@ -482,6 +608,9 @@ void D3DClass::Shutdown()
 
 	if(m_depthStencilBuffer)
 	{
+		m_residencyManager.Unregister(m_depthStencilHandle);
+		m_depthStencilHandle = -1;
+
 		m_depthStencilBuffer->Release();
 		m_depthStencilBuffer = 0;
 	}
@@ -509,12 +638,23 @@ void D3DClass::Shutdown()
 		m_swapChain->Release();
 		m_swapChain = 0;
 	}
+
+	// Stop tracking the video memory.
+	m_residencyManager.Shutdown();
 }
 
 void D3DClass::BeginScene(float red, float green, float blue, float alpha)
 {
 	float color[4];
 
+	PROFILE_FUNCTION();
+
+	// Everything allocated during the previous frame is now dead.
+	m_frameAllocator.Reset();
+
+	// Start a new residency frame, evicting what hasn't been used if we are over the budget.
+	m_residencyManager.BeginFrame();
+
 	// Setup the color to clear the buffer to.
 	color[0] = red;
 	color[1] = green;
@@ -530,6 +670,8 @@ void D3DClass::BeginScene(float red, float green, float blue, float alpha)
 
 void D3DClass::EndScene()
 {
+	PROFILE_FUNCTION();
+
 	// Present the back buffer to the screen since rendering is complete.
 	if(m_vsync_enabled)
 	{
@@ -541,6 +683,37 @@ void D3DClass::EndScene()
 		// Present as fast as possible.
 		m_swapChain->Present(0, 0);
 	}
+
+	// Merge the counters of every thread into the counters of this frame.
+	RenderStatsClass::EndFrame();
+}
+
+void D3DClass::TurnZBufferOn()
+{
+	m_deviceContext->OMSetDepthStencilState(m_depthStencilState, 1);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
+}
+
+void D3DClass::TurnZBufferOff()
+{
+	m_deviceContext->OMSetDepthStencilState(m_depthDisabledStencilState, 1);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
+}
+
+void D3DClass::TurnOnAlphaBlending()
+{
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	m_deviceContext->OMSetBlendState(m_alphaEnableBlendingState, blendFactor, 0xffffffff);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
+}
+
+void D3DClass::TurnOffAlphaBlending()
+{
+	float blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	m_deviceContext->OMSetBlendState(m_alphaDisableBlendingState, blendFactor, 0xffffffff);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
 }
 
 ID3D11Device* D3DClass::GetDevice()
@@ -569,8 +742,23 @@ void D3DClass::GetOrthoMatrix(D3DXMATRIX& orthoMatrix)
 	orthoMatrix = m_orthoMatrix;
 }
 
+void D3DClass::GetViewport(D3D11_VIEWPORT& viewport)
+{
+	viewport = m_viewport;
+}
+
 void D3DClass::GetVideoCardInfo(char* cardName, int& memory)
 {
 	strcpy_s(cardName, 128, m_videoCardDescription);
 	memory = m_videoCardMemory;
+}
+
+LinearAllocatorClass* D3DClass::GetFrameAllocator()
+{
+	return &m_frameAllocator;
+}
+
+ResidencyManagerClass* D3DClass::GetResidencyManager()
+{
+	return &m_residencyManager;
 }
\ No newline at end of file
@@ -18,6 +18,13 @@
 #include <d3d11.h>
 #include <d3dx10math.h>
 
+// Includes.
+#include "linearallocatorclass.h"
+#include "scratchallocatorclass.h"
+#include "residencymanagerclass.h"
+#include "profilerclass.h"
+#include "renderstatsclass.h"
+
 class D3DClass
 {
 public:
@@ -31,15 +38,24 @@ public:
 	void BeginScene(float, float, float, float);
 	void EndScene();
 
+	void TurnZBufferOn();
+	void TurnZBufferOff();
+	void TurnOnAlphaBlending();
+	void TurnOffAlphaBlending();
+
 	ID3D11Device* GetDevice();
 	ID3D11DeviceContext* GetDeviceContext();
 
 	void GetProjectionMatrix(D3DXMATRIX&);
 	void GetWorldMatrix(D3DXMATRIX&);
 	void GetOrthoMatrix(D3DXMATRIX&);
+	void GetViewport(D3D11_VIEWPORT&);
 
 	void GetVideoCardInfo(char*, int&);
 
+	LinearAllocatorClass* GetFrameAllocator();
+	ResidencyManagerClass* GetResidencyManager();
+
 private:
 	bool m_vsync_enabled;
 	int m_videoCardMemory;
@@ -52,9 +68,21 @@ private:
 	ID3D11DepthStencilState* m_depthStencilState;
 	ID3D11DepthStencilView* m_depthStencilView;
 	ID3D11RasterizerState* m_rasterState;
+	ID3D11DepthStencilState* m_depthDisabledStencilState;
+	ID3D11BlendState* m_alphaEnableBlendingState;
+	ID3D11BlendState* m_alphaDisableBlendingState;
 	D3DXMATRIX m_projectionMatrix;
 	D3DXMATRIX m_worldMatrix;
 	D3DXMATRIX m_orthoMatrix;
+	D3D11_VIEWPORT m_viewport;
+	LinearAllocatorClass m_frameAllocator;
+	ResidencyManagerClass m_residencyManager;
+	int m_depthStencilHandle;
 };
 
+// Globals.
+const size_t FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024;
+const float VIDEO_MEMORY_BUDGET = 0.9f;
+const int DEFAULT_VIDEO_MEMORY = 256;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,682 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	debugdrawclass.cpp
+//
+// summary:	Implements the debugdrawclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "debugdrawclass.h"
+
+// System Includes.
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Includes.
+#include "profilerclass.h"
+
+// Globals.
+THREAD_LOCAL DebugDrawRing* DebugDrawThreadRing = 0;
+THREAD_LOCAL unsigned int DebugDrawThreadGeneration = 0;
+unsigned int DebugDrawClass::m_generation = 0;
+
+// The ring list lock is taken when a thread registers and while the rings are merged.
+static mutex DebugDrawLock;
+static vector<DebugDrawRing*> DebugDrawRings;
+static vector<DebugDrawRing*> DebugDrawFreeRings;
+static unsigned int DebugDrawGenerationCounter = 0;
+static unsigned int DebugDrawDropped = 0;
+static int DebugDrawLastLines[DEBUG_DRAW_MODE_COUNT];
+
+// The corners of a box or a frustum are numbered by their x, y and z bits, these are its edges.
+static const int BoxEdges[12][2] =
+{
+	{ 0, 1 }, { 1, 3 }, { 3, 2 }, { 2, 0 },
+	{ 4, 5 }, { 5, 7 }, { 7, 6 }, { 6, 4 },
+	{ 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }
+};
+
+static const float AxisColors[3][4] =
+{
+	{ 1.0f, 0.0f, 0.0f, 1.0f },
+	{ 0.0f, 1.0f, 0.0f, 1.0f },
+	{ 0.0f, 0.0f, 1.0f, 1.0f }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Inverts a 4x4 matrix by Gauss-Jordan elimination with partial pivoting. </summary>
+///
+/// <param name="matrix">  The matrix, 16 floats. </param>
+/// <param name="inverse"> [out] The inverse, 16 floats. </param>
+///
+/// <returns> false if the matrix can't be inverted. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool InvertMatrix(const float* matrix, float* inverse)
+{
+	double work[4][8];
+	double pivot, factor, swap;
+	int row, column, best, i;
+
+	for(row=0; row<4; row++)
+	{
+		for(column=0; column<4; column++)
+		{
+			work[row][column] = matrix[row * 4 + column];
+			work[row][column + 4] = row == column ? 1.0 : 0.0;
+		}
+	}
+
+	for(column=0; column<4; column++)
+	{
+		// Take the largest value left in the column as the pivot.
+		best = column;
+		for(row=column+1; row<4; row++)
+		{
+			if(fabs(work[row][column]) > fabs(work[best][column]))
+			{
+				best = row;
+			}
+		}
+		if(fabs(work[best][column]) < 1e-12)
+		{
+			return false;
+		}
+		if(best != column)
+		{
+			for(i=0; i<8; i++)
+			{
+				swap = work[column][i];
+				work[column][i] = work[best][i];
+				work[best][i] = swap;
+			}
+		}
+
+		pivot = work[column][column];
+		for(i=0; i<8; i++)
+		{
+			work[column][i] /= pivot;
+		}
+
+		for(row=0; row<4; row++)
+		{
+			if(row == column)
+			{
+				continue;
+			}
+
+			factor = work[row][column];
+			for(i=0; i<8; i++)
+			{
+				work[row][i] -= factor * work[column][i];
+			}
+		}
+	}
+
+	for(row=0; row<4; row++)
+	{
+		for(column=0; column<4; column++)
+		{
+			inverse[row * 4 + column] = (float)work[row][column + 4];
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts taking lines. </summary>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool DebugDrawClass::Initialize()
+{
+	if(m_generation)
+	{
+		return true;
+	}
+
+	// A new generation makes every thread register again, 0 is kept for "not running".
+	DebugDrawGenerationCounter++;
+	if(DebugDrawGenerationCounter == 0)
+	{
+		DebugDrawGenerationCounter++;
+	}
+
+	lock_guard<mutex> lock(DebugDrawLock);
+
+	m_generation = DebugDrawGenerationCounter;
+	DebugDrawDropped = 0;
+	memset(DebugDrawLastLines, 0, sizeof(DebugDrawLastLines));
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the rings. Must only be called once the other threads stopped drawing. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawClass::Shutdown()
+{
+	size_t i;
+
+	lock_guard<mutex> lock(DebugDrawLock);
+
+	m_generation = 0;
+
+	for(i=0; i<DebugDrawRings.size(); i++)
+	{
+		delete DebugDrawRings[i];
+	}
+	vector<DebugDrawRing*>().swap(DebugDrawRings);
+	vector<DebugDrawRing*>().swap(DebugDrawFreeRings);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws a line. </summary>
+///
+/// <param name="from">  The start, 3 floats. </param>
+/// <param name="to">	 The end, 3 floats. </param>
+/// <param name="color"> The color, 4 floats. </param>
+/// <param name="mode">  Whether the line is hidden by the scene or drawn over it. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawClass::Line(const float* from, const float* to, const float* color, DebugDrawMode mode)
+{
+	DebugDrawRing* ring;
+
+	ring = GetThreadRing();
+	if(!ring)
+	{
+		return;
+	}
+
+	AddLine(ring, mode, from[0], from[1], from[2], to[0], to[1], to[2], color);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws the edges of an axis aligned box. </summary>
+///
+/// <param name="minimum"> The lowest corner, 3 floats. </param>
+/// <param name="maximum"> The highest corner, 3 floats. </param>
+/// <param name="color">   The color, 4 floats. </param>
+/// <param name="mode">    Whether the box is hidden by the scene or drawn over it. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawClass::Box(const float* minimum, const float* maximum, const float* color, DebugDrawMode mode)
+{
+	DebugDrawRing* ring;
+	float corners[8][3];
+	int i;
+
+	ring = GetThreadRing();
+	if(!ring)
+	{
+		return;
+	}
+
+	for(i=0; i<8; i++)
+	{
+		corners[i][0] = (i & 1) ? maximum[0] : minimum[0];
+		corners[i][1] = (i & 2) ? maximum[1] : minimum[1];
+		corners[i][2] = (i & 4) ? maximum[2] : minimum[2];
+	}
+
+	for(i=0; i<12; i++)
+	{
+		AddLine(ring, mode, corners[BoxEdges[i][0]][0], corners[BoxEdges[i][0]][1], corners[BoxEdges[i][0]][2],
+			corners[BoxEdges[i][1]][0], corners[BoxEdges[i][1]][1], corners[BoxEdges[i][1]][2], color);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws a sphere as three circles, one around each axis. </summary>
+///
+/// <param name="center"> The center, 3 floats. </param>
+/// <param name="radius"> The radius. </param>
+/// <param name="color">  The color, 4 floats. </param>
+/// <param name="mode">   Whether the sphere is hidden by the scene or drawn over it. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawClass::Sphere(const float* center, float radius, const float* color, DebugDrawMode mode)
+{
+	DebugDrawRing* ring;
+	float cosines[DEBUG_DRAW_SPHERE_SEGMENTS + 1], sines[DEBUG_DRAW_SPHERE_SEGMENTS + 1];
+	float angle;
+	int i;
+
+	ring = GetThreadRing();
+	if(!ring)
+	{
+		return;
+	}
+
+	for(i=0; i<=DEBUG_DRAW_SPHERE_SEGMENTS; i++)
+	{
+		angle = 6.2831853f * (float)(i % DEBUG_DRAW_SPHERE_SEGMENTS) / (float)DEBUG_DRAW_SPHERE_SEGMENTS;
+		cosines[i] = cosf(angle) * radius;
+		sines[i] = sinf(angle) * radius;
+	}
+
+	for(i=0; i<DEBUG_DRAW_SPHERE_SEGMENTS; i++)
+	{
+		AddLine(ring, mode, center[0] + cosines[i], center[1] + sines[i], center[2],
+			center[0] + cosines[i + 1], center[1] + sines[i + 1], center[2], color);
+		AddLine(ring, mode, center[0] + cosines[i], center[1], center[2] + sines[i],
+			center[0] + cosines[i + 1], center[1], center[2] + sines[i + 1], color);
+		AddLine(ring, mode, center[0], center[1] + cosines[i], center[2] + sines[i],
+			center[0], center[1] + cosines[i + 1], center[2] + sines[i + 1], color);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Draws the edges of the frustum of a view and projection: the corners of the clip space
+/// 	taken back to the world through the inverse of the matrix.
+/// </summary>
+///
+/// <param name="viewProjection"> The view matrix times the projection matrix, 16 floats, row major. </param>
+/// <param name="color">		  The color, 4 floats. </param>
+/// <param name="mode">			  Whether the frustum is hidden by the scene or drawn over it. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawClass::Frustum(const float* viewProjection, const float* color, DebugDrawMode mode)
+{
+	DebugDrawRing* ring;
+	float inverse[16], corners[8][3];
+	float x, y, z, w;
+	int i, j;
+
+	ring = GetThreadRing();
+	if(!ring || !InvertMatrix(viewProjection, inverse))
+	{
+		return;
+	}
+
+	for(i=0; i<8; i++)
+	{
+		x = (i & 1) ? 1.0f : -1.0f;
+		y = (i & 2) ? 1.0f : -1.0f;
+		z = (i & 4) ? 1.0f : 0.0f;
+
+		w = x * inverse[3] + y * inverse[7] + z * inverse[11] + inverse[15];
+		for(j=0; j<3; j++)
+		{
+			corners[i][j] = (x * inverse[j] + y * inverse[4 + j] + z * inverse[8 + j] + inverse[12 + j]) / w;
+		}
+	}
+
+	for(i=0; i<12; i++)
+	{
+		AddLine(ring, mode, corners[BoxEdges[i][0]][0], corners[BoxEdges[i][0]][1], corners[BoxEdges[i][0]][2],
+			corners[BoxEdges[i][1]][0], corners[BoxEdges[i][1]][1], corners[BoxEdges[i][1]][2], color);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws the axes of a world matrix from its origin, x red, y green and z blue. </summary>
+///
+/// <param name="world"> The world matrix, 16 floats, row major. </param>
+/// <param name="size">  The length of the axes. </param>
+/// <param name="mode">  Whether the axes are hidden by the scene or drawn over it. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawClass::Axes(const float* world, float size, DebugDrawMode mode)
+{
+	DebugDrawRing* ring;
+	int i;
+
+	ring = GetThreadRing();
+	if(!ring)
+	{
+		return;
+	}
+
+	for(i=0; i<3; i++)
+	{
+		AddLine(ring, mode, world[12], world[13], world[14],
+			world[12] + world[i * 4] * size, world[13] + world[i * 4 + 1] * size, world[14] + world[i * 4 + 2] * size, AxisColors[i]);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Moves the lines of every thread into a vertex buffer, those tested against the depth
+/// 	first, then those drawn over the scene, and empties the rings. Called once a frame, once
+/// 	the lines of the frame are all drawn. What doesn't fit is dropped.
+/// </summary>
+///
+/// <param name="vertices"> [out] The vertex buffer. </param>
+/// <param name="capacity"> The number of vertices it holds. </param>
+/// <param name="u">		The texture coordinate every vertex gets, where the texture is white. </param>
+/// <param name="v">		The texture coordinate every vertex gets, where the texture is white. </param>
+/// <param name="counts">   [out] The number of vertices of each mode, DEBUG_DRAW_MODE_COUNT ints. </param>
+///
+/// <returns> The number of vertices written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int DebugDrawClass::Merge(DebugDrawVertex* vertices, int capacity, float u, float v, int* counts)
+{
+	DebugDrawVertex* destination;
+	unsigned int read, write;
+	size_t i;
+	int mode, total;
+
+	lock_guard<mutex> lock(DebugDrawLock);
+
+	// Lines take two vertices, never split one.
+	capacity &= ~1;
+
+	total = 0;
+	for(mode=0; mode<DEBUG_DRAW_MODE_COUNT; mode++)
+	{
+		counts[mode] = 0;
+		for(i=0; i<DebugDrawRings.size(); i++)
+		{
+			write = DebugDrawRings[i]->write[mode].load(memory_order_acquire);
+			read = DebugDrawRings[i]->read[mode].load(memory_order_relaxed);
+			for(; read != write && total < capacity; read++)
+			{
+				destination = &vertices[total];
+				*destination = DebugDrawRings[i]->vertices[mode][read & (DEBUG_DRAW_RING_VERTICES - 1)];
+				destination->u = u;
+				destination->v = v;
+				total++;
+				counts[mode]++;
+			}
+			DebugDrawDropped += (write - read) / 2;
+
+			// Hand the slots back to the writer.
+			DebugDrawRings[i]->read[mode].store(write, memory_order_release);
+		}
+		DebugDrawLastLines[mode] = counts[mode] / 2;
+	}
+
+	for(i=0; i<DebugDrawRings.size(); i++)
+	{
+		DebugDrawDropped += DebugDrawRings[i]->dropped.exchange(0, memory_order_relaxed);
+	}
+
+	return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the lines of the last merge and the lines dropped so far. </summary>
+///
+/// <param name="stats"> [out] The stats. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawClass::GetStats(DebugDrawStats& stats)
+{
+	int mode;
+
+	lock_guard<mutex> lock(DebugDrawLock);
+
+	for(mode=0; mode<DEBUG_DRAW_MODE_COUNT; mode++)
+	{
+		stats.lines[mode] = DebugDrawLastLines[mode];
+	}
+	stats.threads = (int)DebugDrawRings.size();
+	stats.dropped = DebugDrawDropped;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Measures DEBUG_DRAW_BENCHMARK_THREADS threads each drawing DEBUG_DRAW_BENCHMARK_BOXES
+/// 	boxes, DEBUG_DRAW_BENCHMARK_SPHERES spheres and DEBUG_DRAW_BENCHMARK_FRUSTA frusta a
+/// 	frame, half of each tested against the depth, and the merge of their rings at the end
+/// 	of the frame.
+/// </summary>
+///
+/// <param name="benchmark"> [out] The measures. </param>
+///
+/// <returns> false if a line was dropped or the merge didn't get all of them. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool DebugDrawClass::Benchmark(DebugDrawBenchmark& benchmark)
+{
+	vector<DebugDrawVertex> vertices;
+	thread threads[DEBUG_DRAW_BENCHMARK_THREADS];
+	unsigned long long elapsed[DEBUG_DRAW_BENCHMARK_THREADS];
+	unsigned long long draw, merge, start;
+	DebugDrawStats stats;
+	int counts[DEBUG_DRAW_MODE_COUNT];
+	int frame, i, expected, total;
+	bool result;
+
+	memset(&benchmark, 0, sizeof(DebugDrawBenchmark));
+	benchmark.threads = DEBUG_DRAW_BENCHMARK_THREADS;
+	benchmark.boxes = DEBUG_DRAW_BENCHMARK_BOXES;
+	benchmark.spheres = DEBUG_DRAW_BENCHMARK_SPHERES;
+	benchmark.frusta = DEBUG_DRAW_BENCHMARK_FRUSTA;
+	benchmark.frames = DEBUG_DRAW_BENCHMARK_FRAMES;
+
+	if(!Initialize())
+	{
+		return false;
+	}
+
+	expected = DEBUG_DRAW_BENCHMARK_THREADS * (DEBUG_DRAW_BENCHMARK_BOXES * 12 + DEBUG_DRAW_BENCHMARK_SPHERES * DEBUG_DRAW_SPHERE_SEGMENTS * 3 +
+		DEBUG_DRAW_BENCHMARK_FRUSTA * 12) * 2;
+	vertices.resize(DEBUG_DRAW_MAX_VERTICES);
+
+	result = true;
+	draw = 0;
+	merge = 0;
+	for(frame=0; frame<DEBUG_DRAW_BENCHMARK_FRAMES; frame++)
+	{
+		for(i=0; i<DEBUG_DRAW_BENCHMARK_THREADS; i++)
+		{
+			threads[i] = thread([i, &elapsed]()
+			{
+				const float Color[4] = { 1.0f, 1.0f, 0.0f, 1.0f };
+				float minimum[3], maximum[3], center[3], viewProjection[16];
+				unsigned long long start;
+				int j;
+
+				start = ProfilerClass::GetTimestamp();
+
+				for(j=0; j<DEBUG_DRAW_BENCHMARK_BOXES; j++)
+				{
+					minimum[0] = (float)(j % 100);
+					minimum[1] = (float)i;
+					minimum[2] = (float)(j / 100);
+					maximum[0] = minimum[0] + 0.5f;
+					maximum[1] = minimum[1] + 0.5f;
+					maximum[2] = minimum[2] + 0.5f;
+					Box(minimum, maximum, Color, (DebugDrawMode)(j % DEBUG_DRAW_MODE_COUNT));
+				}
+
+				for(j=0; j<DEBUG_DRAW_BENCHMARK_SPHERES; j++)
+				{
+					center[0] = (float)j;
+					center[1] = (float)i;
+					center[2] = 0.0f;
+					Sphere(center, 0.5f, Color, (DebugDrawMode)(j % DEBUG_DRAW_MODE_COUNT));
+				}
+
+				// A perspective projection with 90 degrees of field of view, from a camera moved along x.
+				memset(viewProjection, 0, sizeof(viewProjection));
+				viewProjection[0] = 1.0f;
+				viewProjection[5] = 1.0f;
+				viewProjection[10] = 100.0f / 99.9f;
+				viewProjection[11] = 1.0f;
+				viewProjection[14] = -0.1f * 100.0f / 99.9f;
+				for(j=0; j<DEBUG_DRAW_BENCHMARK_FRUSTA; j++)
+				{
+					viewProjection[12] = -(float)j;
+					Frustum(viewProjection, Color, (DebugDrawMode)(j % DEBUG_DRAW_MODE_COUNT));
+				}
+
+				elapsed[i] = ProfilerClass::GetTimestamp() - start;
+
+				// The next frame's threads take the ring over.
+				UnregisterThread();
+			});
+		}
+
+		for(i=0; i<DEBUG_DRAW_BENCHMARK_THREADS; i++)
+		{
+			threads[i].join();
+			draw += elapsed[i];
+		}
+
+		start = ProfilerClass::GetTimestamp();
+		total = Merge(&vertices[0], DEBUG_DRAW_MAX_VERTICES, 0.0f, 0.0f, counts);
+		merge += ProfilerClass::GetTimestamp() - start;
+
+		if(total != expected || counts[DEBUG_DRAW_DEPTH_TEST] + counts[DEBUG_DRAW_OVERLAY] != total)
+		{
+			result = false;
+		}
+		benchmark.vertices = total;
+	}
+
+	GetStats(stats);
+	benchmark.dropped = stats.dropped;
+	benchmark.drawMs = ProfilerClass::TicksToMilliseconds(draw) / (DEBUG_DRAW_BENCHMARK_FRAMES * DEBUG_DRAW_BENCHMARK_THREADS);
+	benchmark.mergeMs = ProfilerClass::TicksToMilliseconds(merge) / DEBUG_DRAW_BENCHMARK_FRAMES;
+
+	Shutdown();
+
+	return result && stats.dropped == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the ring of the calling thread, creating it the first time. </summary>
+///
+/// <returns> The ring, or null if the debug draw isn't running. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+DebugDrawRing* DebugDrawClass::GetThreadRing()
+{
+	if(DebugDrawThreadGeneration != m_generation)
+	{
+		return RegisterThread();
+	}
+
+	return DebugDrawThreadRing;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives the calling thread the ring of a thread that ended, or creates one. </summary>
+///
+/// <returns> The ring, or null if the debug draw isn't running. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+DebugDrawRing* DebugDrawClass::RegisterThread()
+{
+	DebugDrawRing* ring;
+	size_t i;
+	bool drained;
+	int mode;
+
+	lock_guard<mutex> lock(DebugDrawLock);
+
+	DebugDrawThreadGeneration = m_generation;
+	DebugDrawThreadRing = 0;
+	if(!m_generation)
+	{
+		return 0;
+	}
+
+	// Only a ring Merge emptied is taken over, so the new thread gets the whole of it for its frame.
+	for(i=0; i<DebugDrawFreeRings.size(); i++)
+	{
+		ring = DebugDrawFreeRings[i];
+
+		drained = true;
+		for(mode=0; mode<DEBUG_DRAW_MODE_COUNT; mode++)
+		{
+			drained = drained && ring->write[mode].load(memory_order_relaxed) == ring->read[mode].load(memory_order_acquire);
+		}
+
+		if(drained)
+		{
+			DebugDrawFreeRings.erase(DebugDrawFreeRings.begin() + i);
+			DebugDrawThreadRing = ring;
+			return ring;
+		}
+	}
+
+	ring = new DebugDrawRing;
+	if(!ring)
+	{
+		return 0;
+	}
+
+	for(mode=0; mode<DEBUG_DRAW_MODE_COUNT; mode++)
+	{
+		ring->write[mode].store(0);
+		ring->read[mode].store(0);
+	}
+	ring->dropped.store(0);
+
+	DebugDrawRings.push_back(ring);
+	DebugDrawThreadRing = ring;
+
+	return ring;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Hands the ring of the calling thread back for the next thread that registers. Call it before a thread ends. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawClass::UnregisterThread()
+{
+	lock_guard<mutex> lock(DebugDrawLock);
+
+	if(m_generation && DebugDrawThreadGeneration == m_generation && DebugDrawThreadRing)
+	{
+		DebugDrawFreeRings.push_back(DebugDrawThreadRing);
+	}
+
+	DebugDrawThreadGeneration = 0;
+	DebugDrawThreadRing = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a line to a ring, or counts it as dropped if the ring is full. </summary>
+///
+/// <param name="ring">  The ring of the calling thread. </param>
+/// <param name="mode">  The mode. </param>
+/// <param name="x0">	 The x of the start. </param>
+/// <param name="y0">	 The y of the start. </param>
+/// <param name="z0">	 The z of the start. </param>
+/// <param name="x1">	 The x of the end. </param>
+/// <param name="y1">	 The y of the end. </param>
+/// <param name="z1">	 The z of the end. </param>
+/// <param name="color"> The color, 4 floats. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawClass::AddLine(DebugDrawRing* ring, DebugDrawMode mode, float x0, float y0, float z0, float x1, float y1, float z1, const float* color)
+{
+	DebugDrawVertex* vertex;
+	unsigned int write;
+
+	write = ring->write[mode].load(memory_order_relaxed);
+	if(write - ring->read[mode].load(memory_order_acquire) + 2 > DEBUG_DRAW_RING_VERTICES)
+	{
+		ring->dropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+
+	// The write position is always even and the ring size a power of two, so the two ends are next to each other.
+	vertex = &ring->vertices[mode][write & (DEBUG_DRAW_RING_VERTICES - 1)];
+	vertex[0].x = x0;
+	vertex[0].y = y0;
+	vertex[0].z = z0;
+	vertex[1].x = x1;
+	vertex[1].y = y1;
+	vertex[1].z = z1;
+	vertex[0].r = vertex[1].r = color[0];
+	vertex[0].g = vertex[1].g = color[1];
+	vertex[0].b = vertex[1].b = color[2];
+	vertex[0].a = vertex[1].a = color[3];
+
+	ring->write[mode].store(write + 2, memory_order_release);
+
+	return;
+}
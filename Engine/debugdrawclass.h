@@ -0,0 +1,163 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	debugdrawclass.h
+//
+// summary:	Declares the debugdrawclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DEBUGDRAWCLASS_H_
+#define _DEBUGDRAWCLASS_H_
+
+// System Includes.
+#include <atomic>
+using namespace std;
+
+// Includes.
+#include "threadlocal.h"
+
+// Pre-processing directives.
+// The DEBUG_DRAW_* macros are compiled out, arguments included, unless this is 1. On by default in debug builds.
+#ifndef DEBUG_DRAW_ENABLED
+#ifdef _DEBUG
+#define DEBUG_DRAW_ENABLED 1
+#else
+#define DEBUG_DRAW_ENABLED 0
+#endif
+#endif
+
+// Globals.
+const unsigned int DEBUG_DRAW_RING_VERTICES = 32768;
+const int DEBUG_DRAW_MAX_VERTICES = 262144;
+const int DEBUG_DRAW_SPHERE_SEGMENTS = 24;
+const int DEBUG_DRAW_BENCHMARK_THREADS = 4;
+const int DEBUG_DRAW_BENCHMARK_BOXES = 1000;
+const int DEBUG_DRAW_BENCHMARK_SPHERES = 100;
+const int DEBUG_DRAW_BENCHMARK_FRUSTA = 10;
+const int DEBUG_DRAW_BENCHMARK_FRAMES = 100;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent how the debug lines are drawn against the scene. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum DebugDrawMode
+{
+	DEBUG_DRAW_DEPTH_TEST,
+	DEBUG_DRAW_OVERLAY,
+	DEBUG_DRAW_MODE_COUNT
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> An end of a debug line, laid out as the vertices of the color shader. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct DebugDrawVertex
+{
+	float x;
+	float y;
+	float z;
+	float r;
+	float g;
+	float b;
+	float a;
+	float u;
+	float v;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The lines of one thread, for each mode a ring of DEBUG_DRAW_RING_VERTICES vertices,
+/// 	two per line. Only the owning thread writes and only Merge reads, so the two counters
+/// 	are enough to share it without a lock.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct DebugDrawRing
+{
+	DebugDrawVertex vertices[DEBUG_DRAW_MODE_COUNT][DEBUG_DRAW_RING_VERTICES];
+	atomic<unsigned int> write[DEBUG_DRAW_MODE_COUNT];
+	atomic<unsigned int> read[DEBUG_DRAW_MODE_COUNT];
+	atomic<unsigned int> dropped;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> What the last Merge took, and the lines lost since Initialize. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct DebugDrawStats
+{
+	int lines[DEBUG_DRAW_MODE_COUNT];
+	int threads;
+	unsigned int dropped;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> What the debug draw benchmark measured, the milliseconds of an average frame. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct DebugDrawBenchmark
+{
+	int threads;
+	int boxes;
+	int spheres;
+	int frusta;
+	int frames;
+	int vertices;
+	double drawMs;
+	double mergeMs;
+	unsigned int dropped;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Immediate mode debug lines, for looking at the culling, the bounding volumes and the
+/// 	queries. Any thread draws whenever it wants during a frame:
+///
+/// 	DEBUG_DRAW_BOX(boundsMin, boundsMax, color, DEBUG_DRAW_DEPTH_TEST);
+///
+/// 	The lines go to the ring of the calling thread, created the first time it draws, with no
+/// 	lock and no allocation. When a ring is full its lines are dropped and counted. Once the
+/// 	frame is done, the renderer merges every ring into a single vertex buffer, the lines
+/// 	tested against the depth first and those drawn over everything after, and draws each
+/// 	mode with a single line list.
+///
+/// 	Nothing is kept from a frame to the next: a line is drawn once, in the frame it was added.
+/// 	With DEBUG_DRAW_ENABLED off the macros are empty, so the release builds pay nothing, not
+/// 	even for their arguments.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class DebugDrawClass
+{
+public:
+	static bool Initialize();
+	static void Shutdown();
+	static void UnregisterThread();
+
+	static void Line(const float*, const float*, const float*, DebugDrawMode = DEBUG_DRAW_DEPTH_TEST);
+	static void Box(const float*, const float*, const float*, DebugDrawMode = DEBUG_DRAW_DEPTH_TEST);
+	static void Sphere(const float*, float, const float*, DebugDrawMode = DEBUG_DRAW_DEPTH_TEST);
+	static void Frustum(const float*, const float*, DebugDrawMode = DEBUG_DRAW_DEPTH_TEST);
+	static void Axes(const float*, float, DebugDrawMode = DEBUG_DRAW_DEPTH_TEST);
+
+	static int Merge(DebugDrawVertex*, int, float, float, int*);
+	static void GetStats(DebugDrawStats&);
+
+	static bool Benchmark(DebugDrawBenchmark&);
+
+private:
+	static DebugDrawRing* GetThreadRing();
+	static DebugDrawRing* RegisterThread();
+	static void AddLine(DebugDrawRing*, DebugDrawMode, float, float, float, float, float, float, const float*);
+
+private:
+	static unsigned int m_generation;
+};
+
+// Pre-processing directives.
+#if DEBUG_DRAW_ENABLED
+#define DEBUG_DRAW_LINE(...) DebugDrawClass::Line(__VA_ARGS__)
+#define DEBUG_DRAW_BOX(...) DebugDrawClass::Box(__VA_ARGS__)
+#define DEBUG_DRAW_SPHERE(...) DebugDrawClass::Sphere(__VA_ARGS__)
+#define DEBUG_DRAW_FRUSTUM(...) DebugDrawClass::Frustum(__VA_ARGS__)
+#define DEBUG_DRAW_AXES(...) DebugDrawClass::Axes(__VA_ARGS__)
+#else
+#define DEBUG_DRAW_LINE(...) ((void)0)
+#define DEBUG_DRAW_BOX(...) ((void)0)
+#define DEBUG_DRAW_SPHERE(...) ((void)0)
+#define DEBUG_DRAW_FRUSTUM(...) ((void)0)
+#define DEBUG_DRAW_AXES(...) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,242 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	debugdrawrendererclass.cpp
+//
+// summary:	Implements the debugdrawrendererclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "debugdrawrendererclass.h"
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+DebugDrawRendererClass::DebugDrawRendererClass()
+{
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_residencyManager = 0;
+	m_vertexHandle = -1;
+	m_indexHandle = -1;
+	m_vertexCount = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+DebugDrawRendererClass::DebugDrawRendererClass(const DebugDrawRendererClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+DebugDrawRendererClass::~DebugDrawRendererClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Creates the vertex buffer the lines are merged into, and an index buffer that counts up
+/// 	from 0, since the color shader draws indexed.
+/// </summary>
+///
+/// <param name="device">			The device. </param>
+/// <param name="residencyManager"> The residency manager the buffers are accounted in. </param>
+/// <param name="vertexCount">		The most vertices a frame can draw. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool DebugDrawRendererClass::Initialize(ID3D11Device* device, ResidencyManagerClass* residencyManager, int vertexCount)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	D3D11_SUBRESOURCE_DATA indexData;
+	vector<unsigned long> indices;
+	HRESULT result;
+	int i;
+
+	if(!device || vertexCount <= 0)
+	{
+		return false;
+	}
+
+	m_vertexCount = vertexCount;
+
+	// Set up the description of the vertex buffer. (Dynamic so the CPU writes it every frame.)
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = m_vertexCount * sizeof(DebugDrawVertex);
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	result = device->CreateBuffer(&bufferDesc, NULL, &m_vertexBuffer);
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	indices.resize(m_vertexCount);
+	for(i=0; i<m_vertexCount; i++)
+	{
+		indices[i] = i;
+	}
+
+	// Set up the description of the index buffer. (It never changes.)
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	bufferDesc.ByteWidth = m_vertexCount * sizeof(unsigned long);
+	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	bufferDesc.CPUAccessFlags = 0;
+
+	indexData.pSysMem = &indices[0];
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+
+	result = device->CreateBuffer(&bufferDesc, &indexData, &m_indexBuffer);
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS, 2);
+	RenderStatsClass::Add(RENDER_COUNTER_UPLOAD_BYTES, (unsigned long long)m_vertexCount * sizeof(unsigned long));
+
+	// Account for the buffers. (They are in use every frame, so they can't be evicted.)
+	m_residencyManager = residencyManager;
+	if(m_residencyManager)
+	{
+		m_vertexHandle = m_residencyManager->Register(RESOURCE_VERTEX_BUFFER, (unsigned long long)m_vertexCount * sizeof(DebugDrawVertex), NULL);
+		m_indexHandle = m_residencyManager->Register(RESOURCE_INDEX_BUFFER, (unsigned long long)m_vertexCount * sizeof(unsigned long), NULL);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the buffers. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void DebugDrawRendererClass::Shutdown()
+{
+	if(m_residencyManager)
+	{
+		m_residencyManager->Unregister(m_vertexHandle);
+		m_residencyManager->Unregister(m_indexHandle);
+		m_vertexHandle = -1;
+		m_indexHandle = -1;
+		m_residencyManager = 0;
+	}
+
+	if(m_indexBuffer)
+	{
+		m_indexBuffer->Release();
+		m_indexBuffer = 0;
+	}
+
+	if(m_vertexBuffer)
+	{
+		m_vertexBuffer->Release();
+		m_vertexBuffer = 0;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Merges the lines every thread drew this frame and draws them, those tested against the
+/// 	depth, then the others with the depth test off. This binds its own buffers, so whatever
+/// 	draws next must bind its own.
+/// </summary>
+///
+/// <param name="direct3D">			The Direct3D object, to turn the depth test off and on. </param>
+/// <param name="shader">			The color shader. </param>
+/// <param name="viewMatrix">		The view matrix. </param>
+/// <param name="projectionMatrix"> The projection matrix. </param>
+/// <param name="texture">			A texture with a white texel. </param>
+/// <param name="u">				The u of the white texel. </param>
+/// <param name="v">				The v of the white texel. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool DebugDrawRendererClass::Render(D3DClass* direct3D, ColorShaderClass* shader, D3DXMATRIX viewMatrix, D3DXMATRIX projectionMatrix,
+									ID3D11ShaderResourceView* texture, float u, float v)
+{
+	ID3D11DeviceContext* deviceContext;
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	D3DXMATRIX worldMatrix;
+	unsigned int stride, offset;
+	int counts[DEBUG_DRAW_MODE_COUNT];
+	int mode, first, total;
+	HRESULT result;
+	bool drawn;
+
+	if(!m_vertexBuffer)
+	{
+		return false;
+	}
+
+	deviceContext = direct3D->GetDeviceContext();
+
+	// Merge every ring straight into the vertex buffer, whatever the last frame drew is thrown away.
+	result = deviceContext->Map(m_vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource);
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	total = DebugDrawClass::Merge((DebugDrawVertex*)mappedResource.pData, m_vertexCount, u, v, counts);
+
+	deviceContext->Unmap(m_vertexBuffer, 0);
+	RenderStatsClass::Add(RENDER_COUNTER_MAP_CALLS);
+	RenderStatsClass::Add(RENDER_COUNTER_MAP_BYTES, (unsigned long long)total * sizeof(DebugDrawVertex));
+
+	if(total == 0)
+	{
+		return true;
+	}
+
+	// Bind the lines.
+	stride = sizeof(DebugDrawVertex);
+	offset = 0;
+	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+	RenderStatsClass::Add(RENDER_COUNTER_BUFFER_BINDS, 2);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
+
+	// The lines are already in the world.
+	D3DXMatrixIdentity(&worldMatrix);
+
+	first = 0;
+	for(mode=0; mode<DEBUG_DRAW_MODE_COUNT; mode++)
+	{
+		if(counts[mode] == 0)
+		{
+			continue;
+		}
+
+		if(mode == DEBUG_DRAW_OVERLAY)
+		{
+			direct3D->TurnZBufferOff();
+		}
+
+		drawn = shader->Render(deviceContext, counts[mode], 0, first, worldMatrix, viewMatrix, projectionMatrix, texture);
+
+		if(mode == DEBUG_DRAW_OVERLAY)
+		{
+			direct3D->TurnZBufferOn();
+		}
+
+		if(!drawn)
+		{
+			return false;
+		}
+
+		first += counts[mode];
+	}
+
+	return true;
+}
@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	debugdrawrendererclass.h
+//
+// summary:	Declares the debugdrawrendererclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _DEBUGDRAWRENDERERCLASS_H_
+#define _DEBUGDRAWRENDERERCLASS_H_
+
+// DirectX Includes.
+#include <d3d11.h>
+#include <d3dx10math.h>
+
+// Includes.
+#include "debugdrawclass.h"
+#include "d3dclass.h"
+#include "colorshaderclass.h"
+#include "residencymanagerclass.h"
+#include "renderstatsclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Draws the debug lines of a frame. Every thread's lines are merged straight into a
+/// 	dynamic vertex buffer, discarded once a frame, and drawn with the color shader as a line
+/// 	list: one draw with the depth test, one over the scene. The color shader samples a
+/// 	texture, every vertex points at a white texel of it.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class DebugDrawRendererClass
+{
+public:
+	DebugDrawRendererClass();
+	DebugDrawRendererClass(const DebugDrawRendererClass&);
+	~DebugDrawRendererClass();
+
+	bool Initialize(ID3D11Device*, ResidencyManagerClass*, int = DEBUG_DRAW_MAX_VERTICES);
+	void Shutdown();
+
+	bool Render(D3DClass*, ColorShaderClass*, D3DXMATRIX, D3DXMATRIX, ID3D11ShaderResourceView*, float, float);
+
+private:
+	ID3D11Buffer* m_vertexBuffer;
+	ID3D11Buffer* m_indexBuffer;
+	ResidencyManagerClass* m_residencyManager;
+	int m_vertexHandle;
+	int m_indexHandle;
+	int m_vertexCount;
+};
+
+#endif
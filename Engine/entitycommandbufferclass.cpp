@@ -0,0 +1,227 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	entitycommandbufferclass.cpp
+//
+// summary:	Implements the entitycommandbufferclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "entitycommandbufferclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EntityCommandBufferClass::EntityCommandBufferClass()
+{
+	m_created = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EntityCommandBufferClass::EntityCommandBufferClass(const EntityCommandBufferClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EntityCommandBufferClass::~EntityCommandBufferClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Records the creation of an entity. </summary>
+///
+/// <param name="mask"> The components of the entity. </param>
+///
+/// <returns> The deferred handle of the entity, for the changes recorded after this one. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EntityId EntityCommandBufferClass::CreateEntity(ComponentMask mask)
+{
+	EntityCommand command;
+
+	lock_guard<mutex> guard(m_lock);
+
+	command.type = ENTITY_COMMAND_CREATE;
+	command.entity = ENTITY_DEFERRED_BIT | m_created++;
+	command.component = -1;
+	command.mask = mask;
+	command.offset = 0;
+	command.size = 0;
+	m_commands.push_back(command);
+
+	return command.entity;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Records the destruction of an entity. </summary>
+///
+/// <param name="entity"> The entity, or the deferred handle of one created by this buffer. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityCommandBufferClass::DestroyEntity(EntityId entity)
+{
+	Record(ENTITY_COMMAND_DESTROY, entity, -1, 0, 0, 0);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Records adding a component to an entity. </summary>
+///
+/// <param name="entity">    The entity, or the deferred handle of one created by this buffer. </param>
+/// <param name="component"> The id of the component. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityCommandBufferClass::AddComponent(EntityId entity, int component)
+{
+	Record(ENTITY_COMMAND_ADD, entity, component, 0, 0, 0);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Records removing a component from an entity. </summary>
+///
+/// <param name="entity">    The entity, or the deferred handle of one created by this buffer. </param>
+/// <param name="component"> The id of the component. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityCommandBufferClass::RemoveComponent(EntityId entity, int component)
+{
+	Record(ENTITY_COMMAND_REMOVE, entity, component, 0, 0, 0);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Records setting a component of an entity, the value is copied. </summary>
+///
+/// <param name="entity">    The entity, or the deferred handle of one created by this buffer. </param>
+/// <param name="component"> The id of the component. </param>
+/// <param name="data">	     The value. </param>
+/// <param name="size">	     The size of the value, the size the component was registered with. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityCommandBufferClass::SetComponent(EntityId entity, int component, const void* data, unsigned int size)
+{
+	Record(ENTITY_COMMAND_SET, entity, component, 0, data, size);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Makes the recorded changes, in order, and empties the buffer. </summary>
+///
+/// <param name="entities"> The entities to change. </param>
+///
+/// <returns> true if every change was made, false if one failed or was dropped. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityCommandBufferClass::Playback(EntityManagerClass* entities)
+{
+	vector<EntityId> created;
+	EntityCommand* command;
+	EntityId entity;
+	unsigned int i;
+	bool result;
+
+	lock_guard<mutex> guard(m_lock);
+
+	result = true;
+	created.assign(m_created, ENTITY_NONE);
+	for(i=0; i<m_commands.size(); i++)
+	{
+		command = &m_commands[i];
+
+		// Swap a deferred handle for the entity it was created as.
+		entity = command->entity;
+		if(command->type != ENTITY_COMMAND_CREATE && entity != ENTITY_NONE && (entity & ENTITY_DEFERRED_BIT))
+		{
+			entity = (entity & ~ENTITY_DEFERRED_BIT) < created.size() ? created[entity & ~ENTITY_DEFERRED_BIT] : ENTITY_NONE;
+		}
+
+		switch(command->type)
+		{
+			case ENTITY_COMMAND_CREATE:
+				created[entity & ~ENTITY_DEFERRED_BIT] = entities->CreateEntity(command->mask);
+				result = created[entity & ~ENTITY_DEFERRED_BIT] != ENTITY_NONE && result;
+				break;
+			case ENTITY_COMMAND_DESTROY:
+				result = entities->DestroyEntity(entity) && result;
+				break;
+			case ENTITY_COMMAND_ADD:
+				result = entities->AddComponent(entity, command->component) && result;
+				break;
+			case ENTITY_COMMAND_REMOVE:
+				result = entities->RemoveComponent(entity, command->component) && result;
+				break;
+			case ENTITY_COMMAND_SET:
+				if(command->size != entities->GetComponentSize(command->component))
+				{
+					result = false;
+					break;
+				}
+				result = entities->SetComponent(entity, command->component, command->size > 0 ? &m_data[command->offset] : 0) && result;
+				break;
+		}
+	}
+
+	m_commands.clear();
+	m_data.clear();
+	m_created = 0;
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Throws the recorded changes away. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityCommandBufferClass::Clear()
+{
+	lock_guard<mutex> guard(m_lock);
+
+	m_commands.clear();
+	m_data.clear();
+	m_created = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of changes recorded. </summary>
+///
+/// <returns> The command count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int EntityCommandBufferClass::GetCommandCount()
+{
+	lock_guard<mutex> guard(m_lock);
+
+	return (int)m_commands.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Records a change, copying its value after the values recorded before. </summary>
+///
+/// <param name="type">		 The change. </param>
+/// <param name="entity">    The entity. </param>
+/// <param name="component"> The id of the component, -1 if none. </param>
+/// <param name="mask">		 The components of a created entity. </param>
+/// <param name="data">		 The value of a set, null if none. </param>
+/// <param name="size">		 The size of the value. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityCommandBufferClass::Record(EntityCommandType type, EntityId entity, int component, ComponentMask mask, const void* data, unsigned int size)
+{
+	EntityCommand command;
+
+	lock_guard<mutex> guard(m_lock);
+
+	command.type = type;
+	command.entity = entity;
+	command.component = component;
+	command.mask = mask;
+	command.offset = (unsigned int)m_data.size();
+	command.size = data ? size : 0;
+	if(command.size > 0)
+	{
+		m_data.insert(m_data.end(), (const char*)data, (const char*)data + size);
+	}
+	m_commands.push_back(command);
+
+	return;
+}
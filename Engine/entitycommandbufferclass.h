@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	entitycommandbufferclass.h
+//
+// summary:	Declares the entitycommandbufferclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _ENTITYCOMMANDBUFFERCLASS_H_
+#define _ENTITYCOMMANDBUFFERCLASS_H_
+
+// System Includes.
+#include <mutex>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "entitymanagerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the structural changes a command buffer records. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum EntityCommandType
+{
+	ENTITY_COMMAND_CREATE,
+	ENTITY_COMMAND_DESTROY,
+	ENTITY_COMMAND_ADD,
+	ENTITY_COMMAND_REMOVE,
+	ENTITY_COMMAND_SET
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A recorded change. Mask is the components of a created entity; the value of a set is
+/// 	size bytes at offset in the data of the buffer.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct EntityCommand
+{
+	EntityCommandType type;
+	EntityId entity;
+	int component;
+	ComponentMask mask;
+	unsigned int offset;
+	unsigned int size;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Records the structural changes made while a query runs, creating and destroying entities
+/// 	and adding and removing components, and makes them once the query is done, in the order
+/// 	they were recorded. Recording is thread safe, so the chunks of a parallel query can share
+/// 	a buffer; the order of the changes made from different threads is whatever it was.
+///
+/// 	Create gives back a deferred handle, with ENTITY_DEFERRED_BIT set, that the other changes
+/// 	of the same buffer can use on the entity; Playback swaps it for the real one. A change
+/// 	to an entity that is gone by then, destroyed by an earlier change for example, is dropped.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class EntityCommandBufferClass
+{
+public:
+	EntityCommandBufferClass();
+	EntityCommandBufferClass(const EntityCommandBufferClass&);
+	~EntityCommandBufferClass();
+
+	EntityId CreateEntity(ComponentMask);
+	void DestroyEntity(EntityId);
+	void AddComponent(EntityId, int);
+	void RemoveComponent(EntityId, int);
+	void SetComponent(EntityId, int, const void*, unsigned int);
+
+	bool Playback(EntityManagerClass*);
+	void Clear();
+	int GetCommandCount();
+
+private:
+	void Record(EntityCommandType, EntityId, int, ComponentMask, const void*, unsigned int);
+
+private:
+	vector<EntityCommand> m_commands;
+	vector<char> m_data;
+	mutex m_lock;
+	unsigned int m_created;
+};
+
+#endif
@@ -0,0 +1,990 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	entitymanagerclass.cpp
+//
+// summary:	Implements the entitymanagerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "entitymanagerclass.h"
+
+// System Includes.
+#include <cstring>
+
+// Includes.
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The position and velocity of the benchmark. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct BenchmarkVector
+{
+	float x;
+	float y;
+	float z;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A game object the way it would be written without the entities: allocated on its own,
+/// 	updated through a virtual call, with its other state sitting next to the fields the
+/// 	benchmark touches.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class BenchmarkObjectClass
+{
+public:
+	virtual ~BenchmarkObjectClass()
+	{
+	}
+
+	virtual void Update(float step)
+	{
+		position.x += velocity.x * step;
+		position.y += velocity.y * step;
+		position.z += velocity.z * step;
+	}
+
+	BenchmarkVector position;
+	BenchmarkVector velocity;
+	char name[32];
+	int health;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The next number of a small random generator, between 0 and 1. </summary>
+///
+/// <param name="seed"> [in,out] The state of the generator. </param>
+///
+/// <returns> The number. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float NextRandom(unsigned int& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+
+	return (seed >> 8) / 16777216.0f;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EntityManagerClass::EntityManagerClass()
+{
+	m_entityCount = 0;
+	m_lastArchetype = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EntityManagerClass::EntityManagerClass(const EntityManagerClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EntityManagerClass::~EntityManagerClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts without components or entities. </summary>
+///
+/// <returns> true. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::Initialize()
+{
+	m_entityCount = 0;
+	m_lastArchetype = -1;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Destroys every entity and releases the chunks. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityManagerClass::Shutdown()
+{
+	unsigned int i;
+
+	for(i=0; i<m_archetypes.size(); i++)
+	{
+		delete m_archetypes[i];
+	}
+	m_archetypes.clear();
+
+	for(i=0; i<m_chunkPools.size(); i++)
+	{
+		m_chunkPools[i]->Shutdown();
+		delete m_chunkPools[i];
+	}
+	m_chunkPools.clear();
+
+	m_componentNames.clear();
+	m_componentSizes.clear();
+	m_records.clear();
+	m_freeRecords.clear();
+	m_entityCount = 0;
+	m_lastArchetype = -1;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Registers a component. Registering a name again gives back the same id, as long as the
+/// 	size is the same.
+/// </summary>
+///
+/// <param name="name"> The name of the component. </param>
+/// <param name="size"> The size of the component in bytes, 0 for a tag. </param>
+///
+/// <returns> The id of the component, -1 if there is no room for it. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int EntityManagerClass::RegisterComponent(const char* name, unsigned int size)
+{
+	int component;
+
+	component = FindComponent(name);
+	if(component >= 0)
+	{
+		return m_componentSizes[component] == size ? component : -1;
+	}
+
+	if((int)m_componentNames.size() >= ENTITY_MAX_COMPONENTS)
+	{
+		return -1;
+	}
+
+	m_componentNames.push_back(name);
+	m_componentSizes.push_back(size);
+
+	return (int)m_componentNames.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds a component by name. </summary>
+///
+/// <param name="name"> The name of the component. </param>
+///
+/// <returns> The id of the component, -1 if it isn't registered. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int EntityManagerClass::FindComponent(const char* name)
+{
+	unsigned int i;
+
+	for(i=0; i<m_componentNames.size(); i++)
+	{
+		if(m_componentNames[i] == name)
+		{
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the size a component was registered with. </summary>
+///
+/// <param name="component"> The id of the component. </param>
+///
+/// <returns> The size in bytes, 0 for a tag or a component that isn't registered. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned int EntityManagerClass::GetComponentSize(int component)
+{
+	if(component < 0 || component >= (int)m_componentSizes.size())
+	{
+		return 0;
+	}
+
+	return m_componentSizes[component];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates an entity with a set of components, all zeroed. </summary>
+///
+/// <param name="mask"> The components of the entity. </param>
+///
+/// <returns> The entity, ENTITY_NONE if it couldn't be created. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EntityId EntityManagerClass::CreateEntity(ComponentMask mask)
+{
+	RecordType record;
+	EntityId entity;
+	int archetype, index;
+
+	archetype = GetArchetype(mask);
+	if(archetype < 0)
+	{
+		return ENTITY_NONE;
+	}
+
+	// Take a free record, or a new one while there are indices left.
+	if(!m_freeRecords.empty())
+	{
+		index = m_freeRecords.back();
+		m_freeRecords.pop_back();
+	}
+	else
+	{
+		if(m_records.size() >= ENTITY_INDEX_MASK)
+		{
+			return ENTITY_NONE;
+		}
+
+		record.archetype = -1;
+		record.row = -1;
+		record.generation = 0;
+		m_records.push_back(record);
+		index = (int)m_records.size() - 1;
+	}
+
+	entity = (EntityId)index | (m_records[index].generation << ENTITY_INDEX_BITS);
+
+	m_records[index].row = AddRow(archetype, entity);
+	if(m_records[index].row < 0)
+	{
+		m_freeRecords.push_back(index);
+		return ENTITY_NONE;
+	}
+	m_records[index].archetype = archetype;
+	m_entityCount++;
+
+	return entity;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Destroys an entity and its components. </summary>
+///
+/// <param name="entity"> The entity. </param>
+///
+/// <returns> true if it succeeds, false if the entity was already gone. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::DestroyEntity(EntityId entity)
+{
+	RecordType* record;
+
+	if(!IsAlive(entity))
+	{
+		return false;
+	}
+
+	record = &m_records[entity & ENTITY_INDEX_MASK];
+	RemoveRow(record->archetype, record->row);
+
+	// A new generation makes the handles still around miss the record when it is used again.
+	record->archetype = -1;
+	record->row = -1;
+	record->generation = (record->generation + 1) & ENTITY_GENERATION_MASK;
+	m_freeRecords.push_back(entity & ENTITY_INDEX_MASK);
+	m_entityCount--;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a component to an entity, zeroed. The entity moves to another archetype. </summary>
+///
+/// <param name="entity">    The entity. </param>
+/// <param name="component"> The id of the component. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::AddComponent(EntityId entity, int component)
+{
+	if(!IsAlive(entity) || component < 0 || component >= (int)m_componentSizes.size())
+	{
+		return false;
+	}
+
+	if(HasComponent(entity, component))
+	{
+		return true;
+	}
+
+	return MoveEntity(entity, m_archetypes[m_records[entity & ENTITY_INDEX_MASK].archetype]->mask | GetMask(component));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Removes a component from an entity. The entity moves to another archetype. </summary>
+///
+/// <param name="entity">    The entity. </param>
+/// <param name="component"> The id of the component. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::RemoveComponent(EntityId entity, int component)
+{
+	if(!IsAlive(entity) || component < 0 || component >= (int)m_componentSizes.size())
+	{
+		return false;
+	}
+
+	if(!HasComponent(entity, component))
+	{
+		return true;
+	}
+
+	return MoveEntity(entity, m_archetypes[m_records[entity & ENTITY_INDEX_MASK].archetype]->mask & ~GetMask(component));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies the value of a component of an entity. </summary>
+///
+/// <param name="entity">    The entity. </param>
+/// <param name="component"> The id of the component. </param>
+/// <param name="data">	     The value, the size the component was registered with. </param>
+///
+/// <returns> true if it succeeds, false if the entity doesn't have the component. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::SetComponent(EntityId entity, int component, const void* data)
+{
+	void* destination;
+
+	if(!HasComponent(entity, component))
+	{
+		return false;
+	}
+
+	destination = GetComponent(entity, component);
+	if(destination && data)
+	{
+		memcpy(destination, data, m_componentSizes[component]);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets a component of an entity. The pointer is good until the next structural change, it
+/// 	moves with the entity.
+/// </summary>
+///
+/// <param name="entity">    The entity. </param>
+/// <param name="component"> The id of the component. </param>
+///
+/// <returns> The component, null if the entity doesn't have it or it is a tag. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void* EntityManagerClass::GetComponent(EntityId entity, int component)
+{
+	RecordType* record;
+
+	if(!HasComponent(entity, component) || m_componentSizes[component] == 0)
+	{
+		return 0;
+	}
+
+	record = &m_records[entity & ENTITY_INDEX_MASK];
+
+	return GetRow(record->archetype, record->row, component);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if an entity has a component. </summary>
+///
+/// <param name="entity">    The entity. </param>
+/// <param name="component"> The id of the component. </param>
+///
+/// <returns> true if the entity is alive and has the component, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::HasComponent(EntityId entity, int component)
+{
+	if(!IsAlive(entity) || component < 0 || component >= (int)m_componentSizes.size())
+	{
+		return false;
+	}
+
+	return (m_archetypes[m_records[entity & ENTITY_INDEX_MASK].archetype]->mask & GetMask(component)) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if an entity is alive, the handle of a destroyed one is not. </summary>
+///
+/// <param name="entity"> The entity. </param>
+///
+/// <returns> true if alive, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::IsAlive(EntityId entity)
+{
+	unsigned int index;
+
+	if(entity & ENTITY_DEFERRED_BIT)
+	{
+		return false;
+	}
+
+	index = entity & ENTITY_INDEX_MASK;
+	if(index >= m_records.size() || m_records[index].archetype < 0)
+	{
+		return false;
+	}
+
+	return m_records[index].generation == (entity >> ENTITY_INDEX_BITS);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets the chunks of the entities having every component of include and none of exclude.
+/// 	The chunks are good until the next structural change.
+/// </summary>
+///
+/// <param name="include"> The components the entities must have. </param>
+/// <param name="exclude"> The components the entities must not have. </param>
+/// <param name="chunks">  [out] The chunks. </param>
+///
+/// <returns> The number of chunks. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int EntityManagerClass::GetChunks(ComponentMask include, ComponentMask exclude, vector<EntityChunk>& chunks)
+{
+	ArchetypeType* archetype;
+	EntityChunk chunk;
+	unsigned int i, j;
+
+	chunks.clear();
+	for(i=0; i<m_archetypes.size(); i++)
+	{
+		archetype = m_archetypes[i];
+		if((archetype->mask & include) != include || (archetype->mask & exclude) != 0)
+		{
+			continue;
+		}
+
+		// Every chunk is full but the last one.
+		for(j=0; j<archetype->chunks.size(); j++)
+		{
+			chunk.memory = archetype->chunks[j];
+			chunk.offsets = archetype->offsets;
+			chunk.entities = (const EntityId*)archetype->chunks[j];
+			chunk.count = archetype->entityCount - (int)j * archetype->capacity;
+			chunk.count = chunk.count < archetype->capacity ? chunk.count : archetype->capacity;
+			chunks.push_back(chunk);
+		}
+	}
+
+	return (int)chunks.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Runs a function on every chunk of a query, in order, on this thread. </summary>
+///
+/// <param name="include">  The components the entities must have. </param>
+/// <param name="exclude">  The components the entities must not have. </param>
+/// <param name="function"> The function, it may change the components but not add or remove any. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityManagerClass::ForEach(ComponentMask include, ComponentMask exclude, const function<void(const EntityChunk&)>& function)
+{
+	vector<EntityChunk> chunks;
+	unsigned int i;
+
+	GetChunks(include, exclude, chunks);
+	for(i=0; i<chunks.size(); i++)
+	{
+		function(chunks[i]);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Runs a function on every chunk of a query, ENTITY_CHUNKS_PER_TASK chunks per task on the
+/// 	workers. The function runs on several threads at once, each on its own chunks; structural
+/// 	changes go to a command buffer. A query of a few chunks runs on this thread.
+/// </summary>
+///
+/// <param name="include">  The components the entities must have. </param>
+/// <param name="exclude">  The components the entities must not have. </param>
+/// <param name="function"> The function, it may change the components but not add or remove any. </param>
+/// <param name="workers">  The number of workers, 0 to run on this thread, -1 for the default. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::ForEachParallel(ComponentMask include, ComponentMask exclude, const function<void(const EntityChunk&)>& function, int workers)
+{
+	vector<EntityChunk> chunks;
+	int i, count, first;
+
+	PROFILE_FUNCTION();
+
+	count = GetChunks(include, exclude, chunks);
+	if(workers == 0 || count < ENTITY_PARALLEL_CHUNKS)
+	{
+		for(i=0; i<count; i++)
+		{
+			function(chunks[i]);
+		}
+
+		return true;
+	}
+
+	TaskGraphClass tasks;
+
+	for(first=0; first<count; first+=ENTITY_CHUNKS_PER_TASK)
+	{
+		tasks.AddTask("EntityManagerClass::ForEachChunks", [&chunks, &function, first, count]() -> bool
+		{
+			int i;
+
+			for(i=first; i<first + ENTITY_CHUNKS_PER_TASK && i<count; i++)
+			{
+				function(chunks[i]);
+			}
+			return true;
+		});
+	}
+
+	return tasks.Run(workers);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of entities alive. </summary>
+///
+/// <returns> The entity count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int EntityManagerClass::GetEntityCount()
+{
+	return m_entityCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of chunks holding entities. </summary>
+///
+/// <returns> The chunk count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int EntityManagerClass::GetChunkCount()
+{
+	unsigned int i;
+	int count;
+
+	count = 0;
+	for(i=0; i<m_archetypes.size(); i++)
+	{
+		count += (int)m_archetypes[i]->chunks.size();
+	}
+
+	return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the mask of one component, masks are or'ed together into a set. </summary>
+///
+/// <param name="component"> The id of the component. </param>
+///
+/// <returns> The mask. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ComponentMask EntityManagerClass::GetMask(int component)
+{
+	return (ComponentMask)1 << component;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times a system moving the position of every entity by its velocity against the same work
+/// 	over plain arrays and over objects reached through pointers. Half the entities have one
+/// 	more component, so the query walks two archetypes. Every time is the best of
+/// 	ENTITY_BENCHMARK_PASSES passes.
+/// </summary>
+///
+/// <param name="entities"> The number of entities. </param>
+/// <param name="result">   [out] The times. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::Benchmark(int entities, EntityBenchmark& result)
+{
+	const float Step = 1.0f / 60.0f;
+	EntityManagerClass manager;
+	vector<BenchmarkVector> positions, velocities;
+	vector<BenchmarkObjectClass*> objects;
+	vector<char*> gaps;
+	function<void(const EntityChunk&)> update;
+	BenchmarkVector velocity;
+	BenchmarkObjectClass* object;
+	unsigned long long start;
+	unsigned int seed;
+	int position, speed, health, i, j, pass;
+	double milliseconds;
+	EntityId entity;
+	bool succeeded;
+
+	memset(&result, 0, sizeof(EntityBenchmark));
+	if(entities <= 0)
+	{
+		return false;
+	}
+
+	manager.Initialize();
+	position = manager.RegisterComponent("Position", sizeof(BenchmarkVector));
+	speed = manager.RegisterComponent("Velocity", sizeof(BenchmarkVector));
+	health = manager.RegisterComponent("Health", sizeof(int));
+
+	// The objects are allocated in between blocks of other sizes and visited out of order, the way
+	// they end up after a while of objects coming and going.
+	seed = 12345;
+	positions.resize(entities);
+	velocities.resize(entities);
+	objects.resize(entities);
+	succeeded = true;
+	for(i=0; i<entities; i++)
+	{
+		velocity.x = NextRandom(seed);
+		velocity.y = NextRandom(seed);
+		velocity.z = NextRandom(seed);
+
+		entity = manager.CreateEntity(GetMask(position) | GetMask(speed) | (i % 2 ? GetMask(health) : 0));
+		succeeded = manager.SetComponent(entity, speed, &velocity) && succeeded;
+
+		positions[i].x = positions[i].y = positions[i].z = 0.0f;
+		velocities[i] = velocity;
+
+		objects[i] = new BenchmarkObjectClass;
+		memset(objects[i]->name, 0, sizeof(objects[i]->name));
+		objects[i]->position = positions[i];
+		objects[i]->velocity = velocity;
+		objects[i]->health = 100;
+		gaps.push_back(new char[16 + (int)(NextRandom(seed) * 256)]);
+	}
+	for(i=entities - 1; i>0; i--)
+	{
+		j = (int)(NextRandom(seed) * (i + 1));
+		object = objects[i];
+		objects[i] = objects[j];
+		objects[j] = object;
+	}
+
+	result.entities = manager.GetEntityCount();
+	result.chunks = manager.GetChunkCount();
+
+	update = [position, speed, Step](const EntityChunk& chunk)
+	{
+		BenchmarkVector* positions;
+		const BenchmarkVector* velocities;
+		int i;
+
+		positions = GetArray<BenchmarkVector>(chunk, position);
+		velocities = GetArray<BenchmarkVector>(chunk, speed);
+		for(i=0; i<chunk.count; i++)
+		{
+			positions[i].x += velocities[i].x * Step;
+			positions[i].y += velocities[i].y * Step;
+			positions[i].z += velocities[i].z * Step;
+		}
+	};
+
+	for(pass=0; pass<ENTITY_BENCHMARK_PASSES; pass++)
+	{
+		start = ProfilerClass::GetTimestamp();
+		manager.ForEach(GetMask(position) | GetMask(speed), 0, update);
+		milliseconds = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+		result.querySerialMs = pass == 0 || milliseconds < result.querySerialMs ? milliseconds : result.querySerialMs;
+
+		start = ProfilerClass::GetTimestamp();
+		succeeded = manager.ForEachParallel(GetMask(position) | GetMask(speed), 0, update) && succeeded;
+		milliseconds = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+		result.queryParallelMs = pass == 0 || milliseconds < result.queryParallelMs ? milliseconds : result.queryParallelMs;
+
+		start = ProfilerClass::GetTimestamp();
+		for(i=0; i<entities; i++)
+		{
+			positions[i].x += velocities[i].x * Step;
+			positions[i].y += velocities[i].y * Step;
+			positions[i].z += velocities[i].z * Step;
+		}
+		milliseconds = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+		result.arrayMs = pass == 0 || milliseconds < result.arrayMs ? milliseconds : result.arrayMs;
+
+		start = ProfilerClass::GetTimestamp();
+		for(i=0; i<entities; i++)
+		{
+			objects[i]->Update(Step);
+		}
+		milliseconds = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+		result.objectMs = pass == 0 || milliseconds < result.objectMs ? milliseconds : result.objectMs;
+	}
+
+	for(i=0; i<entities; i++)
+	{
+		delete objects[i];
+		delete [] gaps[i];
+	}
+
+	manager.Shutdown();
+
+	return succeeded;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Finds the archetype of a set of components, or creates it. The entity ids come first in a
+/// 	chunk, then the array of every stored component, each aligned, as many entities as fit.
+/// </summary>
+///
+/// <param name="mask"> The components. </param>
+///
+/// <returns> The index of the archetype, -1 if a component isn't registered or too big. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int EntityManagerClass::GetArchetype(ComponentMask mask)
+{
+	ArchetypeType* archetype;
+	unsigned int i, entitySize, arrays, offset;
+	int component;
+
+	// Entities tend to be created in runs of the same kind.
+	if(m_lastArchetype >= 0 && m_archetypes[m_lastArchetype]->mask == mask)
+	{
+		return m_lastArchetype;
+	}
+
+	for(i=0; i<m_archetypes.size(); i++)
+	{
+		if(m_archetypes[i]->mask == mask)
+		{
+			m_lastArchetype = (int)i;
+			return m_lastArchetype;
+		}
+	}
+
+	if(m_componentSizes.size() < ENTITY_MAX_COMPONENTS && (mask >> m_componentSizes.size()) != 0)
+	{
+		return -1;
+	}
+
+	// Count what an entity takes, and the most padding the arrays can need.
+	entitySize = sizeof(EntityId);
+	arrays = 1;
+	for(component=0; component<(int)m_componentSizes.size(); component++)
+	{
+		if((mask & GetMask(component)) && m_componentSizes[component] > 0)
+		{
+			entitySize += m_componentSizes[component];
+			arrays++;
+		}
+	}
+
+	if(arrays * ENTITY_ARRAY_ALIGNMENT + entitySize > ENTITY_CHUNK_SIZE)
+	{
+		return -1;
+	}
+
+	archetype = new ArchetypeType;
+	archetype->mask = mask;
+	archetype->capacity = (int)((ENTITY_CHUNK_SIZE - arrays * ENTITY_ARRAY_ALIGNMENT) / entitySize);
+	archetype->entityCount = 0;
+
+	offset = archetype->capacity * sizeof(EntityId);
+	for(component=0; component<ENTITY_MAX_COMPONENTS; component++)
+	{
+		archetype->offsets[component] = 0;
+		if(component < (int)m_componentSizes.size() && (mask & GetMask(component)) && m_componentSizes[component] > 0)
+		{
+			offset = (offset + ENTITY_ARRAY_ALIGNMENT - 1) & ~(ENTITY_ARRAY_ALIGNMENT - 1);
+			archetype->offsets[component] = offset;
+			offset += archetype->capacity * m_componentSizes[component];
+		}
+	}
+
+	m_archetypes.push_back(archetype);
+	m_lastArchetype = (int)m_archetypes.size() - 1;
+
+	return m_lastArchetype;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Puts an entity at the end of an archetype, with zeroed components. </summary>
+///
+/// <param name="archetype"> The index of the archetype. </param>
+/// <param name="entity">    The entity. </param>
+///
+/// <returns> The row of the entity in the archetype, -1 if no chunk could be allocated. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int EntityManagerClass::AddRow(int archetype, EntityId entity)
+{
+	ArchetypeType* type;
+	char* chunk;
+	int row, component;
+
+	type = m_archetypes[archetype];
+	row = type->entityCount;
+	if(row / type->capacity == (int)type->chunks.size())
+	{
+		chunk = AllocateChunk();
+		if(!chunk)
+		{
+			return -1;
+		}
+		type->chunks.push_back(chunk);
+	}
+
+	chunk = type->chunks[row / type->capacity];
+	((EntityId*)chunk)[row % type->capacity] = entity;
+	for(component=0; component<(int)m_componentSizes.size(); component++)
+	{
+		if((type->mask & GetMask(component)) && m_componentSizes[component] > 0)
+		{
+			memset(GetRow(archetype, row, component), 0, m_componentSizes[component]);
+		}
+	}
+
+	type->entityCount++;
+
+	return row;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Takes a row out of an archetype, moving the last entity into it so the chunks stay packed,
+/// 	and frees the last chunk once it is empty.
+/// </summary>
+///
+/// <param name="archetype"> The index of the archetype. </param>
+/// <param name="row">		 The row. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityManagerClass::RemoveRow(int archetype, int row)
+{
+	ArchetypeType* type;
+	EntityId moved;
+	int last, component;
+
+	type = m_archetypes[archetype];
+	last = type->entityCount - 1;
+	if(row != last)
+	{
+		moved = ((EntityId*)type->chunks[last / type->capacity])[last % type->capacity];
+		((EntityId*)type->chunks[row / type->capacity])[row % type->capacity] = moved;
+		for(component=0; component<(int)m_componentSizes.size(); component++)
+		{
+			if((type->mask & GetMask(component)) && m_componentSizes[component] > 0)
+			{
+				memcpy(GetRow(archetype, row, component), GetRow(archetype, last, component), m_componentSizes[component]);
+			}
+		}
+
+		m_records[moved & ENTITY_INDEX_MASK].row = row;
+	}
+
+	type->entityCount--;
+	if(type->entityCount <= ((int)type->chunks.size() - 1) * type->capacity)
+	{
+		FreeChunk(type->chunks.back());
+		type->chunks.pop_back();
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Moves an entity to the archetype of another set of components, keeping the ones in both. </summary>
+///
+/// <param name="entity"> The entity. </param>
+/// <param name="mask">   The new components of the entity. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool EntityManagerClass::MoveEntity(EntityId entity, ComponentMask mask)
+{
+	RecordType* record;
+	ComponentMask kept;
+	int archetype, row, component;
+
+	archetype = GetArchetype(mask);
+	if(archetype < 0)
+	{
+		return false;
+	}
+
+	row = AddRow(archetype, entity);
+	if(row < 0)
+	{
+		return false;
+	}
+
+	record = &m_records[entity & ENTITY_INDEX_MASK];
+	kept = m_archetypes[record->archetype]->mask & mask;
+	for(component=0; component<(int)m_componentSizes.size(); component++)
+	{
+		if((kept & GetMask(component)) && m_componentSizes[component] > 0)
+		{
+			memcpy(GetRow(archetype, row, component), GetRow(record->archetype, record->row, component), m_componentSizes[component]);
+		}
+	}
+
+	RemoveRow(record->archetype, record->row);
+	record->archetype = archetype;
+	record->row = row;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets where a component of a row is stored. </summary>
+///
+/// <param name="archetype"> The index of the archetype. </param>
+/// <param name="row">		 The row. </param>
+/// <param name="component"> The id of the component. </param>
+///
+/// <returns> The component. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+char* EntityManagerClass::GetRow(int archetype, int row, int component)
+{
+	ArchetypeType* type;
+
+	type = m_archetypes[archetype];
+
+	return type->chunks[row / type->capacity] + type->offsets[component] + (row % type->capacity) * m_componentSizes[component];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Allocates a chunk, adding a pool when every pool is full. </summary>
+///
+/// <returns> The chunk, null if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+char* EntityManagerClass::AllocateChunk()
+{
+	PoolAllocatorClass* pool;
+	void* chunk;
+	int i;
+
+	// The newest pool is the one most likely to have room.
+	for(i=(int)m_chunkPools.size() - 1; i>=0; i--)
+	{
+		chunk = m_chunkPools[i]->Allocate();
+		if(chunk)
+		{
+			return (char*)chunk;
+		}
+	}
+
+	pool = new PoolAllocatorClass;
+	if(!pool->Initialize(ENTITY_CHUNK_SIZE, ENTITY_CHUNKS_PER_POOL, ENTITY_CHUNK_ALIGNMENT))
+	{
+		delete pool;
+		return 0;
+	}
+	m_chunkPools.push_back(pool);
+
+	return (char*)pool->Allocate();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives a chunk back to its pool. </summary>
+///
+/// <param name="chunk"> The chunk. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void EntityManagerClass::FreeChunk(char* chunk)
+{
+	unsigned int i;
+
+	for(i=0; i<m_chunkPools.size(); i++)
+	{
+		if(m_chunkPools[i]->Owns(chunk))
+		{
+			m_chunkPools[i]->Free(chunk);
+			return;
+		}
+	}
+
+	return;
+}
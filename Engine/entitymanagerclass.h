@@ -0,0 +1,162 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	entitymanagerclass.h
+//
+// summary:	Declares the entitymanagerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _ENTITYMANAGERCLASS_H_
+#define _ENTITYMANAGERCLASS_H_
+
+// System Includes.
+#include <functional>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "poolallocatorclass.h"
+
+// Globals.
+const int ENTITY_MAX_COMPONENTS = 64;
+const size_t ENTITY_CHUNK_SIZE = 16 * 1024;
+const size_t ENTITY_CHUNK_ALIGNMENT = 64;
+const size_t ENTITY_CHUNKS_PER_POOL = 64;
+const unsigned int ENTITY_ARRAY_ALIGNMENT = 16;
+const int ENTITY_INDEX_BITS = 24;
+const unsigned int ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+const unsigned int ENTITY_GENERATION_MASK = 0x7f;
+const unsigned int ENTITY_DEFERRED_BIT = 0x80000000;
+const unsigned int ENTITY_NONE = 0xffffffff;
+const int ENTITY_CHUNKS_PER_TASK = 8;
+const int ENTITY_PARALLEL_CHUNKS = 32;
+const int ENTITY_BENCHMARK_SMALL = 100000;
+const int ENTITY_BENCHMARK_LARGE = 1000000;
+const int ENTITY_BENCHMARK_PASSES = 5;
+
+// An entity is the index of its record in the low bits and the generation of the record above them,
+// so a handle kept after the entity was destroyed doesn't find whatever took its record. The top bit
+// is left for the handles a command buffer gives out before the entity exists.
+typedef unsigned int EntityId;
+typedef unsigned long long ComponentMask;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A chunk handed to a query. The entities and every component of the archetype are arrays
+/// 	of count elements in the memory of the chunk, at the offsets given per component id.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct EntityChunk
+{
+	char* memory;
+	const unsigned int* offsets;
+	const EntityId* entities;
+	int count;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	What one benchmark measured, in ms for one pass over every entity: moving the position by
+/// 	the velocity through a query on one thread and on the workers, over two plain arrays, and
+/// 	over objects allocated one by one and reached through pointers.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct EntityBenchmark
+{
+	int entities;
+	int chunks;
+	double querySerialMs;
+	double queryParallelMs;
+	double arrayMs;
+	double objectMs;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The entities and their components, stored by archetype: the entities that have the same
+/// 	set of components share an archetype, and an archetype keeps them in chunks of
+/// 	ENTITY_CHUNK_SIZE bytes. A chunk holds the ids of its entities and one array per
+/// 	component, so a system walking a component reads it as a plain array. Components are
+/// 	plain data, registered with their size; a size of 0 is a tag, in the set but not stored.
+///
+/// 	An archetype fills its chunks in order and moves its last entity into the hole of one
+/// 	that leaves, so every chunk but the last is full. Adding or removing a component moves
+/// 	the entity to another archetype. Those structural changes move entities around, so they
+/// 	can't happen while a query runs; systems record them in an EntityCommandBufferClass and
+/// 	play it back afterwards. The chunks come from pools of fixed size blocks.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class EntityManagerClass
+{
+private:
+	struct ArchetypeType
+	{
+		ComponentMask mask;
+		int capacity;
+		int entityCount;
+		unsigned int offsets[ENTITY_MAX_COMPONENTS];
+		vector<char*> chunks;
+	};
+
+	struct RecordType
+	{
+		int archetype;
+		int row;
+		unsigned int generation;
+	};
+
+public:
+	EntityManagerClass();
+	EntityManagerClass(const EntityManagerClass&);
+	~EntityManagerClass();
+
+	bool Initialize();
+	void Shutdown();
+
+	int RegisterComponent(const char*, unsigned int);
+	int FindComponent(const char*);
+	unsigned int GetComponentSize(int);
+
+	EntityId CreateEntity(ComponentMask);
+	bool DestroyEntity(EntityId);
+	bool AddComponent(EntityId, int);
+	bool RemoveComponent(EntityId, int);
+	bool SetComponent(EntityId, int, const void*);
+	void* GetComponent(EntityId, int);
+	bool HasComponent(EntityId, int);
+	bool IsAlive(EntityId);
+
+	int GetChunks(ComponentMask, ComponentMask, vector<EntityChunk>&);
+	void ForEach(ComponentMask, ComponentMask, const function<void(const EntityChunk&)>&);
+	bool ForEachParallel(ComponentMask, ComponentMask, const function<void(const EntityChunk&)>&, int = -1);
+
+	int GetEntityCount();
+	int GetChunkCount();
+
+	static ComponentMask GetMask(int);
+	static bool Benchmark(int, EntityBenchmark&);
+
+	template<class T> static T* GetArray(const EntityChunk& chunk, int component)
+	{
+		return (T*)(chunk.memory + chunk.offsets[component]);
+	}
+
+private:
+	int GetArchetype(ComponentMask);
+	int AddRow(int, EntityId);
+	void RemoveRow(int, int);
+	bool MoveEntity(EntityId, ComponentMask);
+	char* GetRow(int, int, int);
+	char* AllocateChunk();
+	void FreeChunk(char*);
+
+private:
+	vector<string> m_componentNames;
+	vector<unsigned int> m_componentSizes;
+	vector<ArchetypeType*> m_archetypes;
+	vector<RecordType> m_records;
+	vector<int> m_freeRecords;
+	vector<PoolAllocatorClass*> m_chunkPools;
+	int m_entityCount;
+	int m_lastArchetype;
+};
+
+#endif
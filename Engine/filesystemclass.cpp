@@ -0,0 +1,299 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	filesystemclass.cpp
+//
+// summary:	Implements the filesystemclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "filesystemclass.h"
+
+// System Includes.
+#include <fstream>
+
+// Includes.
+#include "platformclass.h"
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FileSystemClass::FileSystemClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FileSystemClass::FileSystemClass(const FileSystemClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FileSystemClass::~FileSystemClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Unmounts everything. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FileSystemClass::Shutdown()
+{
+	unsigned int i;
+
+	for(i=0; i<m_mounts.size(); i++)
+	{
+		if(m_mounts[i].pack)
+		{
+			m_mounts[i].pack->Shutdown();
+			delete m_mounts[i].pack;
+			m_mounts[i].pack = 0;
+		}
+	}
+	m_mounts.clear();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Mounts a pack. </summary>
+///
+/// <param name="filename"> Filename of the pack. </param>
+///
+/// <returns> true if it succeeds, false if the pack is missing or damaged. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FileSystemClass::MountPack(const char* filename)
+{
+	MountType mount;
+	bool result;
+
+	mount.pack = new PackFileClass;
+	if(!mount.pack)
+	{
+		return false;
+	}
+
+	result = mount.pack->Initialize(filename);
+	if(!result)
+	{
+		delete mount.pack;
+		return false;
+	}
+
+	m_mounts.push_back(mount);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Mounts a directory of loose files. </summary>
+///
+/// <param name="path"> The path of the directory. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FileSystemClass::MountDirectory(const char* path)
+{
+	MountType mount;
+
+	if(!path)
+	{
+		return false;
+	}
+
+	mount.pack = 0;
+	mount.directory = path;
+	if(!mount.directory.empty() && mount.directory[mount.directory.size() - 1] != '/' && mount.directory[mount.directory.size() - 1] != '\\')
+	{
+		mount.directory += '/';
+	}
+	m_mounts.push_back(mount);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if a mount has a file. </summary>
+///
+/// <param name="name"> The name of the file. </param>
+///
+/// <returns> true if it exists, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FileSystemClass::Exists(const char* name)
+{
+	ifstream fin;
+	unsigned int i;
+
+	for(i=0; i<m_mounts.size(); i++)
+	{
+		if(m_mounts[i].pack)
+		{
+			if(m_mounts[i].pack->Contains(name))
+			{
+				return true;
+			}
+			continue;
+		}
+
+		fin.open((m_mounts[i].directory + name).c_str(), ios::in | ios::binary);
+		if(!fin.fail())
+		{
+			return true;
+		}
+		fin.clear();
+	}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads a whole file from the first mount that has it. </summary>
+///
+/// <param name="name"> The name of the file. </param>
+/// <param name="data"> [out] The contents. </param>
+///
+/// <returns> true if it succeeds, false if no mount has it. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FileSystemClass::ReadFile(const char* name, vector<char>& data)
+{
+	unsigned int i;
+
+	PROFILE_FUNCTION();
+
+	if(!name)
+	{
+		return false;
+	}
+
+	for(i=0; i<m_mounts.size(); i++)
+	{
+		if(m_mounts[i].pack)
+		{
+			if(m_mounts[i].pack->Contains(name))
+			{
+				return m_mounts[i].pack->Read(name, data);
+			}
+			continue;
+		}
+
+		if(ReadLooseFile(m_mounts[i].directory + name, data))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets a file without copying it, when the first mount that has it is a pack storing it
+/// 	uncompressed. Otherwise the file has to be read with ReadFile.
+/// </summary>
+///
+/// <param name="name"> The name of the file. </param>
+/// <param name="size"> [out] The size of the file. </param>
+///
+/// <returns> The contents, valid until Shutdown; 0 if it can't be mapped. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* FileSystemClass::GetMappedData(const char* name, size_t& size)
+{
+	unsigned int i;
+
+	size = 0;
+
+	for(i=0; i<m_mounts.size(); i++)
+	{
+		if(m_mounts[i].pack && m_mounts[i].pack->Contains(name))
+		{
+			return m_mounts[i].pack->GetMappedData(name, size);
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets a file without copying it from the first mount that has it: a loose file is mapped
+/// 	for the caller, a file stored uncompressed in a pack is where the pack is mapped. A
+/// 	compressed one can't be mapped, it has to be read with ReadFile.
+/// </summary>
+///
+/// <param name="name">   The name of the file. </param>
+/// <param name="size">   [out] The size of the file. </param>
+/// <param name="mapped"> [out] true if the file was mapped for the caller, who gives it back to PlatformClass::UnmapFile. </param>
+///
+/// <returns> The contents, 0 if the file can't be mapped. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* FileSystemClass::MapFile(const char* name, size_t& size, bool& mapped)
+{
+	const char* data;
+	unsigned int i;
+
+	size = 0;
+	mapped = false;
+
+	if(!name)
+	{
+		return 0;
+	}
+
+	for(i=0; i<m_mounts.size(); i++)
+	{
+		if(m_mounts[i].pack)
+		{
+			if(m_mounts[i].pack->Contains(name))
+			{
+				return m_mounts[i].pack->GetMappedData(name, size);
+			}
+			continue;
+		}
+
+		data = PlatformClass::MapFile((m_mounts[i].directory + name).c_str(), size);
+		if(data)
+		{
+			mapped = true;
+			return data;
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads a whole file from the disk. </summary>
+///
+/// <param name="filename"> Filename of the file. </param>
+/// <param name="data">		[out] The contents. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FileSystemClass::ReadLooseFile(const string& filename, vector<char>& data)
+{
+	ifstream fin;
+	streamoff size;
+
+	fin.open(filename.c_str(), ios::in | ios::binary);
+	if(fin.fail())
+	{
+		return false;
+	}
+
+	fin.seekg(0, ios::end);
+	size = fin.tellg();
+	fin.seekg(0, ios::beg);
+	if(size < 0)
+	{
+		return false;
+	}
+
+	data.resize((size_t)size);
+	if(size > 0)
+	{
+		fin.read(&data[0], size);
+	}
+
+	return !fin.fail();
+}
@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	filesystemclass.h
+//
+// summary:	Declares the filesystemclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _FILESYSTEMCLASS_H_
+#define _FILESYSTEMCLASS_H_
+
+// System Includes.
+#include <string>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "packfileclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The virtual file system the loaders find their files through. Packs and directories are
+/// 	mounted at startup, and a file is looked for in each of them in the order they were
+/// 	mounted; the first that has it wins. So with the pack mounted before the asset directory
+/// 	the game reads from the pack, and a file missing from it still comes from the disk.
+///
+/// 	The mounts don't change once the frames start, so any thread can read.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class FileSystemClass
+{
+private:
+	struct MountType
+	{
+		PackFileClass* pack;
+		string directory;
+	};
+
+public:
+	FileSystemClass();
+	FileSystemClass(const FileSystemClass&);
+	~FileSystemClass();
+
+	void Shutdown();
+
+	bool MountPack(const char*);
+	bool MountDirectory(const char*);
+
+	bool Exists(const char*);
+	bool ReadFile(const char*, vector<char>&);
+	const char* GetMappedData(const char*, size_t&);
+	const char* MapFile(const char*, size_t&, bool&);
+
+private:
+	bool ReadLooseFile(const string&, vector<char>&);
+
+private:
+	vector<MountType> m_mounts;
+};
+
+#endif
@@ -0,0 +1,402 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	fontclass.cpp
+//
+// summary:	Implements the fontclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "fontclass.h"
+
+// Globals.
+// The printable ASCII characters, a row of 8 pixels a byte from the top, the lowest bit on the left.
+static const unsigned char FontGlyphs[FONT_CHARACTER_COUNT][FONT_GLYPH_SIZE] =
+{
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// space
+	{ 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 },	// !
+	{ 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },	// "
+	{ 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 },	// #
+	{ 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 },	// $
+	{ 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 },	// %
+	{ 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 },	// &
+	{ 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 },	// '
+	{ 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 },	// (
+	{ 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 },	// )
+	{ 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 },	// *
+	{ 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 },	// +
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 },	// ,
+	{ 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 },	// -
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 },	// .
+	{ 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 },	// /
+	{ 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 },	// 0
+	{ 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 },	// 1
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 },	// 2
+	{ 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 },	// 3
+	{ 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 },	// 4
+	{ 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 },	// 5
+	{ 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 },	// 6
+	{ 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 },	// 7
+	{ 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 },	// 8
+	{ 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 },	// 9
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 },	// :
+	{ 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 },	// ;
+	{ 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 },	// <
+	{ 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 },	// =
+	{ 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 },	// >
+	{ 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 },	// ?
+	{ 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 },	// @
+	{ 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 },	// A
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 },	// B
+	{ 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 },	// C
+	{ 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 },	// D
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 },	// E
+	{ 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 },	// F
+	{ 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 },	// G
+	{ 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 },	// H
+	{ 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// I
+	{ 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 },	// J
+	{ 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 },	// K
+	{ 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 },	// L
+	{ 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 },	// M
+	{ 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 },	// N
+	{ 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 },	// O
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 },	// P
+	{ 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 },	// Q
+	{ 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 },	// R
+	{ 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 },	// S
+	{ 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// T
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 },	// U
+	{ 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },	// V
+	{ 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },	// W
+	{ 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 },	// X
+	{ 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 },	// Y
+	{ 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 },	// Z
+	{ 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 },	// [
+	{ 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 },	// backslash
+	{ 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 },	// ]
+	{ 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 },	// ^
+	{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },	// _
+	{ 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },	// `
+	{ 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 },	// a
+	{ 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 },	// b
+	{ 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 },	// c
+	{ 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 },	// d
+	{ 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 },	// e
+	{ 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 },	// f
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F },	// g
+	{ 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 },	// h
+	{ 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// i
+	{ 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E },	// j
+	{ 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 },	// k
+	{ 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },	// l
+	{ 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 },	// m
+	{ 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 },	// n
+	{ 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 },	// o
+	{ 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F },	// p
+	{ 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 },	// q
+	{ 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 },	// r
+	{ 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 },	// s
+	{ 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 },	// t
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 },	// u
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },	// v
+	{ 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 },	// w
+	{ 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 },	// x
+	{ 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F },	// y
+	{ 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 },	// z
+	{ 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 },	// {
+	{ 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 },	// |
+	{ 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 },	// }
+	{ 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }	// ~
+};
+
+// Each glyph takes a cell of its scaled size and a pixel of padding all around, the white cell comes after the glyphs.
+static const int FontCellSize = FONT_GLYPH_SIZE * FONT_GLYPH_SCALE + 2;
+static const int FontWhiteCell = FONT_CHARACTER_COUNT;
+static const int FontAtlasRows = (FONT_CHARACTER_COUNT + 1 + FONT_ATLAS_COLUMNS - 1) / FONT_ATLAS_COLUMNS;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FontClass::FontClass()
+{
+	m_texture = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FontClass::FontClass(const FontClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FontClass::~FontClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds the atlas. It is white all over and the glyphs are in the alpha, so the vertex
+/// 	colour the shader multiplies the texture with is the colour of the text, and the
+/// 	filtering at the edge of a glyph never blends in a dark colour.
+/// </summary>
+///
+/// <returns> true. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FontClass::Initialize()
+{
+	TextureMip mip;
+	unsigned char* pixel;
+	int i, x, y, cellX, cellY;
+
+	Shutdown();
+
+	m_atlas.format = TEXTURE_FORMAT_RGBA8;
+	m_atlas.srgb = true;
+	m_atlas.width = FONT_ATLAS_COLUMNS * FontCellSize;
+	m_atlas.height = FontAtlasRows * FontCellSize;
+	m_atlas.data.assign((size_t)m_atlas.width * m_atlas.height * 4, 255);
+
+	// Clear the alpha, then set it where the glyphs are, every bit of the font a square of FONT_GLYPH_SCALE pixels.
+	for(i=3; i<(int)m_atlas.data.size(); i+=4)
+	{
+		m_atlas.data[i] = 0;
+	}
+
+	for(i=0; i<FONT_CHARACTER_COUNT; i++)
+	{
+		cellX = (i % FONT_ATLAS_COLUMNS) * FontCellSize + 1;
+		cellY = (i / FONT_ATLAS_COLUMNS) * FontCellSize + 1;
+		for(y=0; y<FONT_GLYPH_SIZE * FONT_GLYPH_SCALE; y++)
+		{
+			for(x=0; x<FONT_GLYPH_SIZE * FONT_GLYPH_SCALE; x++)
+			{
+				if(FontGlyphs[i][y / FONT_GLYPH_SCALE] >> (x / FONT_GLYPH_SCALE) & 1)
+				{
+					pixel = &m_atlas.data[((size_t)(cellY + y) * m_atlas.width + cellX + x) * 4];
+					pixel[3] = 255;
+				}
+			}
+		}
+	}
+
+	// The white cell is solid, padding included.
+	cellX = (FontWhiteCell % FONT_ATLAS_COLUMNS) * FontCellSize;
+	cellY = (FontWhiteCell / FONT_ATLAS_COLUMNS) * FontCellSize;
+	for(y=0; y<FontCellSize; y++)
+	{
+		for(x=0; x<FontCellSize; x++)
+		{
+			m_atlas.data[((size_t)(cellY + y) * m_atlas.width + cellX + x) * 4 + 3] = 255;
+		}
+	}
+
+	mip.width = m_atlas.width;
+	mip.height = m_atlas.height;
+	mip.rowPitch = m_atlas.width * 4;
+	mip.offset = 0;
+	mip.size = m_atlas.data.size();
+	m_atlas.mips.push_back(mip);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the atlas and the layouts. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FontClass::Shutdown()
+{
+	m_atlas.width = 0;
+	m_atlas.height = 0;
+	m_atlas.mips.clear();
+	m_atlas.data.clear();
+	m_texture = 0;
+	m_layouts.clear();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the atlas, to create the texture from. </summary>
+///
+/// <returns> The atlas, RGBA8 in a single mip. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const TextureData& FontClass::GetAtlas()
+{
+	return m_atlas;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets the texture created from the atlas, the text is drawn with it. </summary>
+///
+/// <param name="texture"> The texture, as the renderer binds it. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FontClass::SetTexture(const void* texture)
+{
+	m_texture = texture;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the texture created from the atlas. </summary>
+///
+/// <returns> The texture, null until it is set. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const void* FontClass::GetTexture()
+{
+	return m_texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the texture coordinates of the middle of the white cell, to draw solid rectangles with the atlas. </summary>
+///
+/// <param name="u"> [out] The u coordinate. </param>
+/// <param name="v"> [out] The v coordinate. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FontClass::GetWhiteTexel(float& u, float& v)
+{
+	u = ((FontWhiteCell % FONT_ATLAS_COLUMNS) + 0.5f) * FontCellSize / m_atlas.width;
+	v = ((FontWhiteCell / FONT_ATLAS_COLUMNS) + 0.5f) * FontCellSize / m_atlas.height;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the distance from a line of text to the next. </summary>
+///
+/// <returns> The distance in pixels. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+float FontClass::GetLineHeight()
+{
+	return (float)(FONT_GLYPH_SIZE * FONT_GLYPH_SCALE + FONT_LINE_SPACING);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets the layout of a string, from the cache or laid out now and cached. The glyphs go
+/// 	left to right from the top left corner of the string, a new line starts below the first
+/// 	character, and the characters outside the font are drawn as '?'.
+/// </summary>
+///
+/// <param name="text"> The string. </param>
+///
+/// <returns> The layout, valid until the EndFrame after the last frame it is asked for. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const TextLayout& FontClass::GetLayout(const char* text)
+{
+	map<string, TextLayout>::iterator found;
+	FontGlyph glyph;
+	float x, y, advance;
+	int character;
+	const char* next;
+
+	found = m_layouts.find(text);
+	if(found != m_layouts.end())
+	{
+		found->second.used = true;
+		return found->second;
+	}
+
+	TextLayout& layout = m_layouts[text];
+	layout.width = 0.0f;
+	layout.height = 0.0f;
+	layout.used = true;
+
+	advance = (float)(FONT_GLYPH_SIZE * FONT_GLYPH_SCALE);
+	x = 0.0f;
+	y = 0.0f;
+	for(next=text; *next; next++)
+	{
+		if(*next == '\n')
+		{
+			x = 0.0f;
+			y += GetLineHeight();
+			continue;
+		}
+
+		character = (unsigned char)*next;
+		if(character < FONT_FIRST_CHARACTER || character >= FONT_FIRST_CHARACTER + FONT_CHARACTER_COUNT)
+		{
+			character = '?';
+		}
+
+		// Spaces only move the pen.
+		if(character != ' ')
+		{
+			glyph.x = x;
+			glyph.y = y;
+			glyph.width = advance;
+			glyph.height = advance;
+			GetCell(character - FONT_FIRST_CHARACTER, glyph.u0, glyph.v0, glyph.u1, glyph.v1);
+			layout.glyphs.push_back(glyph);
+		}
+
+		x += advance;
+		if(x > layout.width)
+		{
+			layout.width = x;
+		}
+		layout.height = y + advance;
+	}
+
+	return layout;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of layouts in the cache. </summary>
+///
+/// <returns> The number of layouts. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int FontClass::GetLayoutCount()
+{
+	return (int)m_layouts.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Drops the layouts no one asked for since the last call, once the frame is drawn. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FontClass::EndFrame()
+{
+	map<string, TextLayout>::iterator layout;
+
+	layout = m_layouts.begin();
+	while(layout != m_layouts.end())
+	{
+		if(!layout->second.used)
+		{
+			m_layouts.erase(layout++);
+			continue;
+		}
+
+		layout->second.used = false;
+		++layout;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the texture coordinates of the glyph in a cell of the atlas, without the padding. </summary>
+///
+/// <param name="cell"> The cell, the index of the character from FONT_FIRST_CHARACTER. </param>
+/// <param name="u0">   [out] The left. </param>
+/// <param name="v0">   [out] The top. </param>
+/// <param name="u1">   [out] The right. </param>
+/// <param name="v1">   [out] The bottom. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FontClass::GetCell(int cell, float& u0, float& v0, float& u1, float& v1)
+{
+	int x, y;
+
+	x = (cell % FONT_ATLAS_COLUMNS) * FontCellSize + 1;
+	y = (cell / FONT_ATLAS_COLUMNS) * FontCellSize + 1;
+
+	u0 = (float)x / m_atlas.width;
+	v0 = (float)y / m_atlas.height;
+	u1 = (float)(x + FONT_GLYPH_SIZE * FONT_GLYPH_SCALE) / m_atlas.width;
+	v1 = (float)(y + FONT_GLYPH_SIZE * FONT_GLYPH_SCALE) / m_atlas.height;
+
+	return;
+}
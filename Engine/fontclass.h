@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	fontclass.h
+//
+// summary:	Declares the fontclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _FONTCLASS_H_
+#define _FONTCLASS_H_
+
+// System Includes.
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "texturebuilderclass.h"
+
+// Globals.
+const int FONT_FIRST_CHARACTER = 32;
+const int FONT_CHARACTER_COUNT = 95;
+const int FONT_GLYPH_SIZE = 8;
+const int FONT_GLYPH_SCALE = 2;
+const int FONT_ATLAS_COLUMNS = 16;
+const int FONT_LINE_SPACING = 2;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> One glyph of a laid out string: where it goes from the origin of the string, in pixels, and where it is in the atlas. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct FontGlyph
+{
+	float x;
+	float y;
+	float width;
+	float height;
+	float u0;
+	float v0;
+	float u1;
+	float v1;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> A string laid out in glyphs, with the size of the box around it. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextLayout
+{
+	vector<FontGlyph> glyphs;
+	float width;
+	float height;
+	bool used;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A bitmap font for the HUD and the debug text. The glyphs of the printable ASCII
+/// 	characters are built into the code, 8x8 and scaled up by FONT_GLYPH_SCALE, and packed at
+/// 	Initialize in a single atlas with a pixel of padding around each one so the filtering
+/// 	never reaches a neighbour. The atlas also holds a white cell, so solid rectangles are
+/// 	drawn with the same texture as the text and batch with it.
+///
+/// 	A string is laid out once and the layout is kept: the HUD draws the same strings every
+/// 	frame. EndFrame drops the layouts that weren't used since the last EndFrame, so the cache
+/// 	only holds what is on the screen. The glyphs are placed on whole pixels, drawn at the
+/// 	scale of the atlas they come out sharp.
+///
+/// 	Nothing here touches the GPU: whoever creates the texture from the atlas hands it back
+/// 	with SetTexture, and the sprite batch draws the text with it.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class FontClass
+{
+public:
+	FontClass();
+	FontClass(const FontClass&);
+	~FontClass();
+
+	bool Initialize();
+	void Shutdown();
+
+	const TextureData& GetAtlas();
+	void SetTexture(const void*);
+	const void* GetTexture();
+	void GetWhiteTexel(float&, float&);
+	float GetLineHeight();
+
+	const TextLayout& GetLayout(const char*);
+	int GetLayoutCount();
+	void EndFrame();
+
+private:
+	void GetCell(int, float&, float&, float&, float&);
+
+private:
+	TextureData m_atlas;
+	const void* m_texture;
+	map<string, TextLayout> m_layouts;
+};
+
+#endif
@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	frameclockclass.cpp
+//
+// summary:	Implements the frameclockclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "frameclockclass.h"
+
+// Includes.
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrameClockClass::FrameClockClass()
+{
+	m_lastTimestamp = 0;
+	m_fixedStep = 0.0;
+	m_delta = 0.0;
+	m_total = 0.0;
+	m_frameIndex = 0;
+	m_started = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrameClockClass::FrameClockClass(const FrameClockClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrameClockClass::~FrameClockClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Resets the clock. The first Tick is frame 0. </summary>
+///
+/// <param name="fixedStep"> The fixed step in seconds, 0 to follow the real time. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameClockClass::Initialize(double fixedStep)
+{
+	m_lastTimestamp = 0;
+	m_fixedStep = fixedStep > 0.0 ? fixedStep : 0.0;
+	m_delta = 0.0;
+	m_total = 0.0;
+	m_frameIndex = 0;
+	m_started = false;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts a new frame. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameClockClass::Tick()
+{
+	unsigned long long now;
+
+	now = ProfilerClass::GetTimestamp();
+
+	if(!m_started)
+	{
+		// The first frame has nothing before it, a fixed clock still moves by its step.
+		m_started = true;
+		m_frameIndex = 0;
+		m_delta = m_fixedStep;
+	}
+	else
+	{
+		m_frameIndex++;
+
+		if(m_fixedStep > 0.0)
+		{
+			m_delta = m_fixedStep;
+		}
+		else
+		{
+			m_delta = now > m_lastTimestamp ? ProfilerClass::TicksToMilliseconds(now - m_lastTimestamp) / 1000.0 : 0.0;
+			if(m_delta > FRAME_CLOCK_MAX_DELTA)
+			{
+				m_delta = FRAME_CLOCK_MAX_DELTA;
+			}
+		}
+	}
+
+	m_total += m_delta;
+	m_lastTimestamp = now;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Switches between a fixed step and the real time, from the next Tick on. </summary>
+///
+/// <param name="fixedStep"> The fixed step in seconds, 0 to follow the real time. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameClockClass::SetFixedStep(double fixedStep)
+{
+	m_fixedStep = fixedStep > 0.0 ? fixedStep : 0.0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the fixed step. </summary>
+///
+/// <returns> The fixed step in seconds, 0 when following the real time. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double FrameClockClass::GetFixedStep()
+{
+	return m_fixedStep;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if the clock moves by a fixed step. </summary>
+///
+/// <returns> true if fixed step, false if it follows the real time. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameClockClass::IsFixedStep()
+{
+	return m_fixedStep > 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the index of the current frame. </summary>
+///
+/// <returns> The frame index. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned int FrameClockClass::GetFrameIndex()
+{
+	return m_frameIndex;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the simulation time the current frame covers. </summary>
+///
+/// <returns> The delta in seconds. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double FrameClockClass::GetDeltaSeconds()
+{
+	return m_delta;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the simulation time at the end of the current frame. </summary>
+///
+/// <returns> The total in seconds. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double FrameClockClass::GetTotalSeconds()
+{
+	return m_total;
+}
@@ -0,0 +1,49 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	frameclockclass.h
+//
+// summary:	Declares the frameclockclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _FRAMECLOCKCLASS_H_
+#define _FRAMECLOCKCLASS_H_
+
+// Globals.
+const double FRAME_CLOCK_FIXED_STEP = 1.0 / 60.0;
+const double FRAME_CLOCK_MAX_DELTA = 0.25;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The simulation clock. Tick is called once at the start of every frame and advances the
+/// 	frame index and the simulation time. With a fixed step the time advances by exactly that
+/// 	step no matter how long the frame took, so a recorded input stream replays the same
+/// 	simulation on any machine; otherwise it follows the real time, clamped so a stall (a
+/// 	breakpoint, a window drag) doesn't turn into one huge step.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class FrameClockClass
+{
+public:
+	FrameClockClass();
+	FrameClockClass(const FrameClockClass&);
+	~FrameClockClass();
+
+	void Initialize(double = 0.0);
+	void Tick();
+
+	void SetFixedStep(double);
+	double GetFixedStep();
+	bool IsFixedStep();
+
+	unsigned int GetFrameIndex();
+	double GetDeltaSeconds();
+	double GetTotalSeconds();
+
+private:
+	unsigned long long m_lastTimestamp;
+	double m_fixedStep;
+	double m_delta;
+	double m_total;
+	unsigned int m_frameIndex;
+	bool m_started;
+};
+
+#endif
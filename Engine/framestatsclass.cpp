@@ -0,0 +1,636 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	framestatsclass.cpp
+//
+// summary:	Implements the framestatsclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "framestatsclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+// Includes.
+#include "scratchallocatorclass.h"
+#include "profilerclass.h"
+#include "renderstatsclass.h"
+#include "logclass.h"
+
+// Globals.
+static const char* FrameStageNames[FRAME_STAGE_COUNT] =
+{
+	"messages",
+	"input",
+	"graphics",
+	"profiler"
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sort order of the profiler events in a hitch dump, by thread and then by start. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool EventLess(const ProfilerEvent& a, const ProfilerEvent& b)
+{
+	if(a.thread != b.thread)
+	{
+		return a.thread < b.thread;
+	}
+
+	if(a.start != b.start)
+	{
+		return a.start < b.start;
+	}
+
+	return a.depth < b.depth;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the nearest rank percentile of sorted values. </summary>
+///
+/// <param name="values">	  The values, sorted ascending. </param>
+/// <param name="count">	  The number of values. </param>
+/// <param name="percentile"> The percentile, from 0 to 1. </param>
+///
+/// <returns> The value at the percentile. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float Percentile(const float* values, int count, float percentile)
+{
+	int rank;
+
+	rank = (int)ceil(percentile * (float)count) - 1;
+	rank = max(0, min(rank, count - 1));
+
+	return values[rank];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrameStatsClass::FrameStatsClass()
+{
+	m_frames = 0;
+	m_frameCount.store(0);
+	m_hitches.store(0);
+	m_hitchMultiple = FRAME_STATS_HITCH_MULTIPLE;
+	m_dumpPrefix = 0;
+	m_dumps = 0;
+	m_frameStart = 0;
+	m_stageStart = 0;
+	memset(m_stageMs, 0, sizeof(m_stageMs));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrameStatsClass::FrameStatsClass(const FrameStatsClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrameStatsClass::~FrameStatsClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates the frame history. </summary>
+///
+/// <param name="hitchMultiple"> How many times the median a frame must take to be a hitch. </param>
+/// <param name="dumpPrefix">	 The prefix of the hitch dump files, null to not write any. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameStatsClass::Initialize(float hitchMultiple, const char* dumpPrefix)
+{
+	m_frames = new FrameTime[FRAME_STATS_HISTORY];
+	if(!m_frames)
+	{
+		return false;
+	}
+
+	memset(m_frames, 0, sizeof(FrameTime) * FRAME_STATS_HISTORY);
+	m_frameCount.store(0);
+	m_hitches.store(0);
+	m_hitchMultiple = hitchMultiple;
+	m_dumpPrefix = dumpPrefix;
+	m_dumps = 0;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the frame history. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameStatsClass::Shutdown()
+{
+	if(m_frames)
+	{
+		delete [] m_frames;
+		m_frames = 0;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Starts timing a frame. The profiler clock is used, so the profiler must be initialized
+/// 	for the times to be in milliseconds.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameStatsClass::BeginFrame()
+{
+	m_frameStart = ProfilerClass::GetTimestamp();
+	m_stageStart = m_frameStart;
+	memset(m_stageMs, 0, sizeof(m_stageMs));
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds the time since the previous mark (or BeginFrame) to a stage. </summary>
+///
+/// <param name="stage"> The stage that just finished. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameStatsClass::MarkStage(FrameStage stage)
+{
+	unsigned long long now;
+
+	now = ProfilerClass::GetTimestamp();
+	m_stageMs[stage] += (float)ProfilerClass::TicksToMilliseconds(now - m_stageStart);
+	m_stageStart = now;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Ends the frame started by BeginFrame and adds it to the history. </summary>
+///
+/// <returns> true if the frame was a hitch, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameStatsClass::EndFrame()
+{
+	unsigned long long now;
+
+	now = ProfilerClass::GetTimestamp();
+
+	return AddFrame((float)ProfilerClass::TicksToMilliseconds(now - m_frameStart), m_stageMs);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Adds a finished frame to the history and checks it against the median of the frames
+/// 	before it.
+/// </summary>
+///
+/// <param name="totalMs"> The frame time in milliseconds. </param>
+/// <param name="stageMs"> The time of each stage in milliseconds, or null. </param>
+///
+/// <returns> true if the frame was a hitch, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameStatsClass::AddFrame(float totalMs, const float* stageMs)
+{
+	unsigned long long index;
+	FrameTime* frame;
+	float median;
+	bool hitch;
+
+	if(!m_frames)
+	{
+		return false;
+	}
+
+	// The median is taken before the frame goes in, a hitch shouldn't raise its own bar.
+	median = 0.0f;
+	if(m_frameCount.load(memory_order_relaxed) >= FRAME_STATS_MIN_FRAMES)
+	{
+		median = GetMedian();
+	}
+
+	index = m_frameCount.load(memory_order_relaxed);
+	frame = &m_frames[index % FRAME_STATS_HISTORY];
+	frame->frame = index;
+	frame->totalMs = totalMs;
+	if(stageMs)
+	{
+		memcpy(frame->stageMs, stageMs, sizeof(frame->stageMs));
+	}
+	else
+	{
+		memset(frame->stageMs, 0, sizeof(frame->stageMs));
+	}
+
+	// Publish the frame to the readers.
+	m_frameCount.store(index + 1, memory_order_release);
+
+	// Below a millisecond the spread is timer noise (a headless frame takes microseconds), never a hitch.
+	hitch = median > 0.0f && totalMs > median * m_hitchMultiple && totalMs >= FRAME_STATS_MIN_HITCH_MS;
+	if(hitch)
+	{
+		m_hitches.fetch_add(1);
+		LOG_WARNING(LOG_CATEGORY_SYSTEM, "Hitch at frame %llu: %.2f ms, %.1fx the median of %.2f ms.", frame->frame, totalMs, totalMs / median, median);
+
+		// Only the first hitches are dumped, a slow machine shouldn't fill the disk.
+		if(m_dumpPrefix && m_dumps < FRAME_STATS_MAX_DUMPS)
+		{
+			WriteHitch(*frame, median);
+			m_dumps++;
+		}
+	}
+
+	return hitch;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies the most recent frames, oldest first. Safe to call from any thread. </summary>
+///
+/// <param name="frames">	 [out] The frames. </param>
+/// <param name="maxFrames"> The maximum number of frames to copy. </param>
+///
+/// <returns> The number of frames copied. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int FrameStatsClass::GetFrames(FrameTime* frames, int maxFrames)
+{
+	unsigned long long start, end, after, firstValid, i;
+	int count, skip;
+
+	if(!m_frames || maxFrames <= 0)
+	{
+		return 0;
+	}
+
+	end = m_frameCount.load(memory_order_acquire);
+	count = (int)min(end, (unsigned long long)min(maxFrames, FRAME_STATS_HISTORY));
+	start = end - count;
+
+	for(i=start; i<end; i++)
+	{
+		frames[i - start] = m_frames[i % FRAME_STATS_HISTORY];
+	}
+
+	// The writer may have reused the oldest slots while they were copied, drop those.
+	after = m_frameCount.load(memory_order_acquire);
+	firstValid = after + 1 > FRAME_STATS_HISTORY ? after + 1 - FRAME_STATS_HISTORY : 0;
+	if(firstValid > start)
+	{
+		skip = (int)min(firstValid - start, (unsigned long long)count);
+		count -= skip;
+		memmove(frames, frames + skip, sizeof(FrameTime) * count);
+	}
+
+	return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Computes the statistics of the frames in the history. </summary>
+///
+/// <param name="summary"> [out] The summary. </param>
+///
+/// <returns> true if it succeeds, false if there are no frames yet. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameStatsClass::GetSummary(FrameStatsSummary& summary)
+{
+	ScratchAllocatorClass scratch;
+	FrameTime* frames;
+	float* totals;
+	float total;
+	int i, j, count, bucket;
+
+	memset(&summary, 0, sizeof(FrameStatsSummary));
+	summary.hitches = m_hitches.load();
+
+	frames = (FrameTime*)scratch.Allocate(sizeof(FrameTime) * FRAME_STATS_HISTORY);
+	totals = (float*)scratch.Allocate(sizeof(float) * FRAME_STATS_HISTORY);
+	if(!frames || !totals)
+	{
+		return false;
+	}
+
+	count = GetFrames(frames, FRAME_STATS_HISTORY);
+	if(count == 0)
+	{
+		return false;
+	}
+
+	total = 0.0f;
+	for(i=0; i<count; i++)
+	{
+		totals[i] = frames[i].totalMs;
+		total += frames[i].totalMs;
+
+		for(j=0; j<FRAME_STAGE_COUNT; j++)
+		{
+			summary.stageAverageMs[j] += frames[i].stageMs[j];
+		}
+
+		bucket = min((int)(frames[i].totalMs / FRAME_STATS_BUCKET_MS), FRAME_STATS_BUCKETS - 1);
+		summary.histogram[max(bucket, 0)]++;
+	}
+
+	sort(totals, totals + count);
+
+	summary.frames = count;
+	summary.averageMs = total / (float)count;
+	summary.minMs = totals[0];
+	summary.p50Ms = Percentile(totals, count, 0.50f);
+	summary.p90Ms = Percentile(totals, count, 0.90f);
+	summary.p99Ms = Percentile(totals, count, 0.99f);
+	summary.maxMs = totals[count - 1];
+
+	for(j=0; j<FRAME_STAGE_COUNT; j++)
+	{
+		summary.stageAverageMs[j] /= (float)count;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes the statistics and the histogram of the history as text. </summary>
+///
+/// <param name="filename"> The file to write. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameStatsClass::WriteSummary(const char* filename)
+{
+	FrameStatsSummary summary;
+	ofstream fout;
+	int i;
+
+	if(!GetSummary(summary))
+	{
+		return false;
+	}
+
+	fout.open(filename);
+	if(fout.fail())
+	{
+		return false;
+	}
+
+	fout << fixed << setprecision(3);
+	fout << "Frame times over the last " << summary.frames << " frames, in ms.\n";
+	fout << "avg " << summary.averageMs << "  min " << summary.minMs << "  p50 " << summary.p50Ms;
+	fout << "  p90 " << summary.p90Ms << "  p99 " << summary.p99Ms << "  max " << summary.maxMs << "\n";
+	fout << "hitches " << summary.hitches << " (over " << m_hitchMultiple << "x the median)\n\n";
+
+	fout << "Stage averages:\n";
+	for(i=0; i<FRAME_STAGE_COUNT; i++)
+	{
+		fout << "  " << left << setw(12) << FrameStageNames[i] << right << setw(10) << summary.stageAverageMs[i] << "\n";
+	}
+
+	fout << "\nHistogram:\n" << setprecision(0);
+	for(i=0; i<FRAME_STATS_BUCKETS; i++)
+	{
+		fout << "  " << setw(3) << (float)i * FRAME_STATS_BUCKET_MS;
+		if(i < FRAME_STATS_BUCKETS - 1)
+		{
+			fout << " - " << setw(3) << (float)(i + 1) * FRAME_STATS_BUCKET_MS;
+		}
+		else
+		{
+			fout << " +    ";
+		}
+		fout << setw(8) << summary.histogram[i] << "\n";
+	}
+
+	fout.close();
+
+	return !fout.fail();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of hitches seen since Initialize. </summary>
+///
+/// <returns> The hitch count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int FrameStatsClass::GetHitchCount()
+{
+	return m_hitches.load();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets how many times the median a frame must take to be a hitch. </summary>
+///
+/// <returns> The hitch multiple. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+float FrameStatsClass::GetHitchMultiple()
+{
+	return m_hitchMultiple;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets how many times the median a frame must take to be a hitch. </summary>
+///
+/// <param name="hitchMultiple"> The hitch multiple. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrameStatsClass::SetHitchMultiple(float hitchMultiple)
+{
+	m_hitchMultiple = hitchMultiple;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Feeds synthetic frame times through AddFrame and checks what comes out, no clock
+/// 	involved. FRAME_STATS_TEST_FRAMES frames from 4 to 8.5 ms in 0.5 ms steps, ten of each,
+/// 	give known percentiles and buckets and no hitch; one FRAME_STATS_TEST_HITCH_MS frame
+/// 	after them is a hitch and is dumped. A spike under FRAME_STATS_MIN_HITCH_MS, and one
+/// 	before FRAME_STATS_MIN_FRAMES frames, are not hitches.
+/// </summary>
+///
+/// <param name="result"> [out] The number of checks, those that failed and the final summary. </param>
+///
+/// <returns> true if every check passed, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameStatsClass::Test(FrameStatsTestResult& result)
+{
+	FrameStatsClass stats, quiet;
+	AllocatorStats scratchStats;
+	float stageMs[FRAME_STAGE_COUNT];
+	ostringstream filename;
+	ifstream fin;
+	string line;
+	bool scratchCreated, passed, hitch;
+	int i;
+
+	memset(&result, 0, sizeof(FrameStatsTestResult));
+
+	// The summaries use the scratch of the thread, only release it if it is created here.
+	ScratchAllocatorClass::GetThreadStats(scratchStats);
+	scratchCreated = scratchStats.capacity == 0;
+
+	if(!stats.Initialize(FRAME_STATS_HITCH_MULTIPLE, FRAME_STATS_TEST_PREFIX) || !quiet.Initialize(FRAME_STATS_HITCH_MULTIPLE, 0))
+	{
+		quiet.Shutdown();
+		stats.Shutdown();
+		return false;
+	}
+
+	// Ten frames of each time, the graphics stage takes half of every frame.
+	memset(stageMs, 0, sizeof(stageMs));
+	hitch = false;
+	for(i=0; i<FRAME_STATS_TEST_FRAMES; i++)
+	{
+		stageMs[FRAME_STAGE_GRAPHICS] = (4.0f + (float)(i % 10) * 0.5f) * 0.5f;
+		hitch = stats.AddFrame(4.0f + (float)(i % 10) * 0.5f, stageMs) || hitch;
+	}
+	result.frames = FRAME_STATS_TEST_FRAMES;
+
+	passed = !hitch && stats.GetHitchCount() == 0;
+	result.checks++;
+	result.failures += passed ? 0 : 1;
+
+	// The 50th, 90th and 99th frames of the sorted times.
+	passed = stats.GetSummary(result.summary) && result.summary.frames == FRAME_STATS_TEST_FRAMES && result.summary.minMs == 4.0f && 
+		result.summary.p50Ms == 6.0f && result.summary.p90Ms == 8.0f && result.summary.p99Ms == 8.5f && result.summary.maxMs == 8.5f &&
+		fabs(result.summary.averageMs - 6.25f) < 0.001f && fabs(result.summary.stageAverageMs[FRAME_STAGE_GRAPHICS] - 3.125f) < 0.001f;
+	result.checks++;
+	result.failures += passed ? 0 : 1;
+
+	// 4 to 5.5 ms in the 4-6 ms bucket, 6 to 7.5 in the next, 8 and 8.5 in the one after.
+	passed = result.summary.histogram[2] == 40 && result.summary.histogram[3] == 40 && result.summary.histogram[4] == 20;
+	for(i=0; i<FRAME_STATS_BUCKETS; i++)
+	{
+		passed = passed && ((i >= 2 && i <= 4) || result.summary.histogram[i] == 0);
+	}
+	result.checks++;
+	result.failures += passed ? 0 : 1;
+
+	// A frame far over the median is a hitch, goes in the last bucket and is dumped.
+	hitch = stats.AddFrame(FRAME_STATS_TEST_HITCH_MS, 0);
+	passed = hitch && stats.GetHitchCount() == 1 && stats.GetSummary(result.summary) && result.summary.hitches == 1 &&
+		result.summary.maxMs == FRAME_STATS_TEST_HITCH_MS && result.summary.p99Ms == 8.5f && result.summary.histogram[FRAME_STATS_BUCKETS - 1] == 1;
+	result.checks++;
+	result.failures += passed ? 0 : 1;
+
+	filename << FRAME_STATS_TEST_PREFIX << "-" << FRAME_STATS_TEST_FRAMES << ".txt";
+	fin.open(filename.str().c_str());
+	passed = !fin.fail() && getline(fin, line) && line.compare(0, 15, "Hitch at frame ") == 0;
+	fin.close();
+	remove(filename.str().c_str());
+	result.checks++;
+	result.failures += passed ? 0 : 1;
+
+	// A spike before the history is long enough has no median to compare to, and one under a millisecond is timer noise.
+	passed = !quiet.AddFrame(FRAME_STATS_TEST_HITCH_MS, 0);
+	for(i=1; i<FRAME_STATS_MIN_FRAMES * 2; i++)
+	{
+		passed = !quiet.AddFrame(0.2f, 0) && passed;
+	}
+	passed = !quiet.AddFrame(0.9f, 0) && quiet.GetHitchCount() == 0 && passed;
+	result.checks++;
+	result.failures += passed ? 0 : 1;
+
+	quiet.Shutdown();
+	stats.Shutdown();
+
+	if(scratchCreated)
+	{
+		ScratchAllocatorClass::ShutdownThread();
+	}
+
+	return result.failures == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the median frame time of the history. Only called by the writer. </summary>
+///
+/// <returns> The median in milliseconds, 0 if the history is empty. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+float FrameStatsClass::GetMedian()
+{
+	ScratchAllocatorClass scratch;
+	float* totals;
+	int i, count;
+
+	count = (int)min(m_frameCount.load(memory_order_relaxed), (unsigned long long)FRAME_STATS_HISTORY);
+	totals = (float*)scratch.Allocate(sizeof(float) * FRAME_STATS_HISTORY);
+	if(!totals || count == 0)
+	{
+		return 0.0f;
+	}
+
+	for(i=0; i<count; i++)
+	{
+		totals[i] = m_frames[i].totalMs;
+	}
+
+	nth_element(totals, totals + count / 2, totals + count);
+
+	return totals[count / 2];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Writes a hitch dump with the stage times, the render counters and the profiler zones of
+/// 	the frame. It relies on the profiler and the render counters having ended the frame
+/// 	already, which the main loop does before EndFrame.
+/// </summary>
+///
+/// <param name="frame">  The hitch frame. </param>
+/// <param name="median"> The median it was compared to. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrameStatsClass::WriteHitch(const FrameTime& frame, float median)
+{
+	vector<ProfilerEvent> events;
+	RenderStats counters;
+	ostringstream filename;
+	ofstream fout;
+	unsigned int depth;
+	size_t i;
+
+	filename << m_dumpPrefix << "-" << frame.frame << ".txt";
+
+	fout.open(filename.str().c_str());
+	if(fout.fail())
+	{
+		return false;
+	}
+
+	fout << fixed << setprecision(3);
+	fout << "Hitch at frame " << frame.frame << ": " << frame.totalMs << " ms, median " << median << " ms (";
+	fout << frame.totalMs / median << "x)\n\nStages:\n";
+	for(i=0; i<FRAME_STAGE_COUNT; i++)
+	{
+		fout << "  " << left << setw(24) << FrameStageNames[i] << right << setw(12) << frame.stageMs[i] << "\n";
+	}
+
+	RenderStatsClass::GetFrameStats(counters);
+	fout << "\nRender counters:\n";
+	for(i=0; i<RENDER_COUNTER_COUNT; i++)
+	{
+		fout << "  " << left << setw(24) << RenderStatsClass::GetCounterName((int)i) << right << setw(12) << counters.values[i] << "\n";
+	}
+
+	// Show the zones as a tree per thread.
+	events = ProfilerClass::GetFrameEvents();
+	sort(events.begin(), events.end(), EventLess);
+
+	fout << "\nProfiler zones (ms):\n";
+	for(i=0; i<events.size(); i++)
+	{
+		fout << "  [" << events[i].thread << "] ";
+		for(depth=0; depth<events[i].depth; depth++)
+		{
+			fout << "  ";
+		}
+		fout << events[i].name << "  " << ProfilerClass::TicksToMilliseconds(events[i].end - events[i].start) << "\n";
+	}
+
+	fout.close();
+
+	return !fout.fail();
+}
@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	framestatsclass.h
+//
+// summary:	Declares the framestatsclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _FRAMESTATSCLASS_H_
+#define _FRAMESTATSCLASS_H_
+
+// System Includes.
+#include <atomic>
+using namespace std;
+
+// Globals.
+const int FRAME_STATS_HISTORY = 512;
+const int FRAME_STATS_MIN_FRAMES = 30;
+const int FRAME_STATS_BUCKETS = 17;
+const float FRAME_STATS_BUCKET_MS = 2.0f;
+const float FRAME_STATS_HITCH_MULTIPLE = 2.5f;
+const float FRAME_STATS_MIN_HITCH_MS = 1.0f;
+const int FRAME_STATS_MAX_DUMPS = 16;
+const char* const FRAME_STATS_DUMP_PREFIX = "hitch";
+const char* const FRAME_STATS_TEST_PREFIX = "framestats-test";
+const int FRAME_STATS_TEST_FRAMES = 100;
+const float FRAME_STATS_TEST_HITCH_MS = 40.0f;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the stages of the main loop. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum FrameStage
+{
+	FRAME_STAGE_MESSAGES,
+	FRAME_STAGE_INPUT,
+	FRAME_STAGE_GRAPHICS,
+	FRAME_STAGE_PROFILER,
+	FRAME_STAGE_COUNT
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The timings of one frame. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct FrameTime
+{
+	unsigned long long frame;
+	float totalMs;
+	float stageMs[FRAME_STAGE_COUNT];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The rolling statistics over the frames in the history. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct FrameStatsSummary
+{
+	int frames;
+	float averageMs;
+	float minMs;
+	float p50Ms;
+	float p90Ms;
+	float p99Ms;
+	float maxMs;
+	float stageAverageMs[FRAME_STAGE_COUNT];
+	unsigned int histogram[FRAME_STATS_BUCKETS];
+	int hitches;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Keeps the timings of the last FRAME_STATS_HISTORY frames. The main loop calls BeginFrame,
+/// 	MarkStage after each stage and EndFrame; AddFrame takes finished timings instead, which
+/// 	is how tests feed it synthetic frames without a window or a clock.
+///
+/// 	Only the main loop writes, any thread can read: the ring is published through an atomic
+/// 	frame counter and readers drop the entries that were overwritten while they copied.
+///
+/// 	A frame slower than the hitch multiple times the median of the history is a hitch. The
+/// 	zones the profiler drained for that frame and the render counters are then written to
+/// 	"<prefix>-<frame>.txt", so the frame can be looked at after the fact.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> What the frame stats test checked, and the summary it ended with. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct FrameStatsTestResult
+{
+	int frames;
+	int checks;
+	int failures;
+	FrameStatsSummary summary;
+};
+
+class FrameStatsClass
+{
+public:
+	FrameStatsClass();
+	FrameStatsClass(const FrameStatsClass&);
+	~FrameStatsClass();
+
+	bool Initialize(float = FRAME_STATS_HITCH_MULTIPLE, const char* = FRAME_STATS_DUMP_PREFIX);
+	void Shutdown();
+
+	void BeginFrame();
+	void MarkStage(FrameStage);
+	bool EndFrame();
+	bool AddFrame(float, const float*);
+
+	int GetFrames(FrameTime*, int);
+	bool GetSummary(FrameStatsSummary&);
+	bool WriteSummary(const char*);
+	int GetHitchCount();
+	float GetHitchMultiple();
+	void SetHitchMultiple(float);
+
+	static bool Test(FrameStatsTestResult&);
+
+private:
+	float GetMedian();
+	bool WriteHitch(const FrameTime&, float);
+
+private:
+	FrameTime* m_frames;
+	atomic<unsigned long long> m_frameCount;
+	atomic<int> m_hitches;
+	float m_hitchMultiple;
+	const char* m_dumpPrefix;
+	int m_dumps;
+
+	unsigned long long m_frameStart;
+	unsigned long long m_stageStart;
+	float m_stageMs[FRAME_STAGE_COUNT];
+};
+
+#endif
@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	frustumclass.cpp
+//
+// summary:	Implements the frustumclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "frustumclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrustumClass::FrustumClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrustumClass::FrustumClass(const FrustumClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+FrustumClass::~FrustumClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds the six planes from the view and projection matrices. The projection is first
+/// 	adjusted so its far plane is the screen depth, then the planes are taken straight from
+/// 	the rows of the combined view-projection matrix and normalized.
+/// </summary>
+///
+/// <param name="screenDepth">	    The depth of the far plane. </param>
+/// <param name="projectionMatrix"> The projection matrix. </param>
+/// <param name="viewMatrix">	    The view matrix. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrustumClass::ConstructFrustum(float screenDepth, D3DXMATRIX projectionMatrix, D3DXMATRIX viewMatrix)
+{
+	float zMinimum, r;
+	D3DXMATRIX matrix;
+	int i;
+
+	// Calculate the minimum Z distance in the frustum.
+	zMinimum = -projectionMatrix._43 / projectionMatrix._33;
+	r = screenDepth / (screenDepth - zMinimum);
+	projectionMatrix._33 = r;
+	projectionMatrix._43 = -r * zMinimum;
+
+	// Create the frustum matrix from the view matrix and updated projection matrix.
+	D3DXMatrixMultiply(&matrix, &viewMatrix, &projectionMatrix);
+
+	// Near plane.
+	m_planes[0].a = matrix._14 + matrix._13;
+	m_planes[0].b = matrix._24 + matrix._23;
+	m_planes[0].c = matrix._34 + matrix._33;
+	m_planes[0].d = matrix._44 + matrix._43;
+
+	// Far plane.
+	m_planes[1].a = matrix._14 - matrix._13;
+	m_planes[1].b = matrix._24 - matrix._23;
+	m_planes[1].c = matrix._34 - matrix._33;
+	m_planes[1].d = matrix._44 - matrix._43;
+
+	// Left plane.
+	m_planes[2].a = matrix._14 + matrix._11;
+	m_planes[2].b = matrix._24 + matrix._21;
+	m_planes[2].c = matrix._34 + matrix._31;
+	m_planes[2].d = matrix._44 + matrix._41;
+
+	// Right plane.
+	m_planes[3].a = matrix._14 - matrix._11;
+	m_planes[3].b = matrix._24 - matrix._21;
+	m_planes[3].c = matrix._34 - matrix._31;
+	m_planes[3].d = matrix._44 - matrix._41;
+
+	// Top plane.
+	m_planes[4].a = matrix._14 - matrix._12;
+	m_planes[4].b = matrix._24 - matrix._22;
+	m_planes[4].c = matrix._34 - matrix._32;
+	m_planes[4].d = matrix._44 - matrix._42;
+
+	// Bottom plane.
+	m_planes[5].a = matrix._14 + matrix._12;
+	m_planes[5].b = matrix._24 + matrix._22;
+	m_planes[5].c = matrix._34 + matrix._32;
+	m_planes[5].d = matrix._44 + matrix._42;
+
+	for(i=0; i<6; i++)
+	{
+		D3DXPlaneNormalize(&m_planes[i], &m_planes[i]);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks if a point is inside the frustum. </summary>
+///
+/// <param name="x"> The x coordinate. </param>
+/// <param name="y"> The y coordinate. </param>
+/// <param name="z"> The z coordinate. </param>
+///
+/// <returns> true if inside, false if outside. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrustumClass::CheckPoint(float x, float y, float z)
+{
+	D3DXVECTOR3 point(x, y, z);
+	int i;
+
+	for(i=0; i<6; i++)
+	{
+		if(D3DXPlaneDotCoord(&m_planes[i], &point) < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks if any part of a sphere is inside the frustum. </summary>
+///
+/// <param name="xCenter"> The x coordinate of the center. </param>
+/// <param name="yCenter"> The y coordinate of the center. </param>
+/// <param name="zCenter"> The z coordinate of the center. </param>
+/// <param name="radius">  The radius. </param>
+///
+/// <returns> true if inside, false if outside. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrustumClass::CheckSphere(float xCenter, float yCenter, float zCenter, float radius)
+{
+	D3DXVECTOR3 center(xCenter, yCenter, zCenter);
+	int i;
+
+	for(i=0; i<6; i++)
+	{
+		if(D3DXPlaneDotCoord(&m_planes[i], &center) < -radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Checks if any part of an axis aligned box is inside the frustum. For each plane only the
+/// 	corner furthest along the plane normal is tested: if even that corner is behind the plane
+/// 	the whole box is.
+/// </summary>
+///
+/// <param name="minimum"> The minimum corner of the box. </param>
+/// <param name="maximum"> The maximum corner of the box. </param>
+///
+/// <returns> true if inside, false if outside. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool FrustumClass::CheckBox(const D3DXVECTOR3& minimum, const D3DXVECTOR3& maximum)
+{
+	D3DXVECTOR3 corner;
+	int i;
+
+	for(i=0; i<6; i++)
+	{
+		corner.x = m_planes[i].a >= 0.0f ? maximum.x : minimum.x;
+		corner.y = m_planes[i].b >= 0.0f ? maximum.y : minimum.y;
+		corner.z = m_planes[i].c >= 0.0f ? maximum.z : minimum.z;
+
+		if(D3DXPlaneDotCoord(&m_planes[i], &corner) < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies the six planes. (Near, far, left, right, top, bottom.) </summary>
+///
+/// <param name="planes"> [out] Room for six planes. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void FrustumClass::GetPlanes(D3DXPLANE* planes)
+{
+	int i;
+
+	for(i=0; i<6; i++)
+	{
+		planes[i] = m_planes[i];
+	}
+}
@@ -0,0 +1,38 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	frustumclass.h
+//
+// summary:	Declares the frustumclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _FRUSTUMCLASS_H_
+#define _FRUSTUMCLASS_H_
+
+// DirectX Includes.
+#include <d3dx10math.h>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The six planes of the view frustum, rebuilt every frame from the view and projection
+/// 	matrices. Objects are tested against the planes by their bounding volume, anything that
+/// 	is completely behind one plane is outside the view and doesn't need to be drawn.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class FrustumClass
+{
+public:
+	FrustumClass();
+	FrustumClass(const FrustumClass&);
+	~FrustumClass();
+
+	void ConstructFrustum(float, D3DXMATRIX, D3DXMATRIX);
+
+	bool CheckPoint(float, float, float);
+	bool CheckSphere(float, float, float, float);
+	bool CheckBox(const D3DXVECTOR3&, const D3DXVECTOR3&);
+
+	void GetPlanes(D3DXPLANE*);
+
+private:
+	D3DXPLANE m_planes[6];
+};
+
+#endif
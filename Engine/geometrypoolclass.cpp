@@ -0,0 +1,634 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	geometrypoolclass.cpp
+//
+// summary:	Implements the geometrypoolclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "geometrypoolclass.h"
+
+// System Includes.
+#include <cstring>
+#include <vector>
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+GeometryPoolClass::GeometryPoolClass()
+{
+	m_device = 0;
+	m_deviceContext = 0;
+	m_residencyManager = 0;
+	m_pageVertices = 0;
+	m_pageIndices = 0;
+	m_boundPage = -1;
+	m_defragmentations = 0;
+	m_bufferBinds = 0;
+	m_bindsSkipped = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+GeometryPoolClass::GeometryPoolClass(const GeometryPoolClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+GeometryPoolClass::~GeometryPoolClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Stores the device and the page size. No buffer is created until the first mesh of a
+/// 	given stride is allocated.
+/// </summary>
+///
+/// <param name="device">			The device. </param>
+/// <param name="deviceContext">	The device context, used to upload and copy geometry. </param>
+/// <param name="residencyManager"> The residency manager the pages are accounted in. </param>
+/// <param name="pageVertices">		The number of vertices in a page. </param>
+/// <param name="pageIndices">		The number of indices in a page. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool GeometryPoolClass::Initialize(ID3D11Device* device, ID3D11DeviceContext* deviceContext, ResidencyManagerClass* residencyManager, 
+								   unsigned int pageVertices, unsigned int pageIndices)
+{
+	if(!device || !deviceContext || pageVertices == 0 || pageIndices == 0)
+	{
+		return false;
+	}
+
+	m_device = device;
+	m_deviceContext = deviceContext;
+	m_residencyManager = residencyManager;
+	m_pageVertices = pageVertices;
+	m_pageIndices = pageIndices;
+	m_boundPage = -1;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases every page and forgets every allocation. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void GeometryPoolClass::Shutdown()
+{
+	unsigned int i;
+
+	for(i=0; i<m_pages.size(); i++)
+	{
+		ReleasePage(m_pages[i]);
+		delete m_pages[i];
+	}
+
+	m_pages.clear();
+	m_allocations.clear();
+	m_freeHandles.clear();
+	m_boundPage = -1;
+
+	m_device = 0;
+	m_deviceContext = 0;
+	m_residencyManager = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Copies a mesh into the pool. The first page of the same stride with room for both the
+/// 	vertices and the indices is used, and a new page is created if none has. The indices
+/// 	come relative to the first vertex of the mesh and are stored relative to the page, so
+/// 	the base vertex is 0 and meshes stored one after the other can be drawn with one call.
+/// </summary>
+///
+/// <param name="vertices">    The vertex data. </param>
+/// <param name="vertexCount"> The number of vertices. </param>
+/// <param name="stride">	   The size of one vertex in bytes. </param>
+/// <param name="indices">	   The index data. </param>
+/// <param name="indexCount">  The number of indices. </param>
+///
+/// <returns> The handle of the mesh, or -1 if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int GeometryPoolClass::Allocate(const void* vertices, unsigned int vertexCount, unsigned int stride, const unsigned long* indices, unsigned int indexCount)
+{
+	AllocationType allocation;
+	vector<unsigned long> pageIndices;
+	PageType* page;
+	D3D11_BOX box;
+	unsigned int i;
+	int pageIndex, handle;
+	bool result;
+
+	if(!m_device || !vertices || !indices || vertexCount == 0 || indexCount == 0 || stride == 0)
+	{
+		return -1;
+	}
+
+	// Find a page of the same stride that has room for the mesh.
+	pageIndex = -1;
+	for(i=0; i<m_pages.size() && pageIndex < 0; i++)
+	{
+		page = m_pages[i];
+		if(page->stride != stride)
+		{
+			continue;
+		}
+
+		result = page->vertexRanges.Allocate(vertexCount, allocation.vertexOffset);
+		if(!result)
+		{
+			continue;
+		}
+
+		result = page->indexRanges.Allocate(indexCount, allocation.indexOffset);
+		if(!result)
+		{
+			page->vertexRanges.Free(allocation.vertexOffset, vertexCount);
+			continue;
+		}
+
+		pageIndex = (int)i;
+	}
+
+	// Otherwise start a new page, big enough for the mesh if it's larger than a normal page.
+	if(pageIndex < 0)
+	{
+		pageIndex = CreatePage(stride, vertexCount > m_pageVertices ? vertexCount : m_pageVertices, indexCount > m_pageIndices ? indexCount : m_pageIndices);
+		if(pageIndex < 0)
+		{
+			return -1;
+		}
+
+		m_pages[pageIndex]->vertexRanges.Allocate(vertexCount, allocation.vertexOffset);
+		m_pages[pageIndex]->indexRanges.Allocate(indexCount, allocation.indexOffset);
+	}
+
+	page = m_pages[pageIndex];
+
+	// Upload the vertices into their range.
+	box.left = allocation.vertexOffset * stride;
+	box.right = (allocation.vertexOffset + vertexCount) * stride;
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+	m_deviceContext->UpdateSubresource(page->vertexBuffer, 0, &box, vertices, 0, 0);
+
+	// Move the indices to where the vertices landed in the page, and upload them into their range.
+	pageIndices.resize(indexCount);
+	for(i=0; i<indexCount; i++)
+	{
+		pageIndices[i] = indices[i] + allocation.vertexOffset;
+	}
+
+	box.left = allocation.indexOffset * sizeof(unsigned long);
+	box.right = (allocation.indexOffset + indexCount) * sizeof(unsigned long);
+	m_deviceContext->UpdateSubresource(page->indexBuffer, 0, &box, &pageIndices[0], 0, 0);
+
+	RenderStatsClass::Add(RENDER_COUNTER_UPLOAD_BYTES, (unsigned long long)vertexCount * stride + (unsigned long long)indexCount * sizeof(unsigned long));
+
+	allocation.page = pageIndex;
+	allocation.vertexCount = vertexCount;
+	allocation.indexCount = indexCount;
+	allocation.baseVertex = 0;
+	allocation.used = true;
+
+	// Reuse a released handle before growing the table.
+	if(!m_freeHandles.empty())
+	{
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+		m_allocations[handle] = allocation;
+	}
+	else
+	{
+		handle = (int)m_allocations.size();
+		m_allocations.push_back(allocation);
+	}
+
+	return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives the ranges of a mesh back to its page. </summary>
+///
+/// <param name="handle"> The handle returned by Allocate. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void GeometryPoolClass::Free(int handle)
+{
+	AllocationType* allocation;
+	PageType* page;
+
+	if(handle < 0 || handle >= (int)m_allocations.size() || !m_allocations[handle].used)
+	{
+		return;
+	}
+
+	allocation = &m_allocations[handle];
+	page = m_pages[allocation->page];
+
+	page->vertexRanges.Free(allocation->vertexOffset, allocation->vertexCount);
+	page->indexRanges.Free(allocation->indexOffset, allocation->indexCount);
+
+	allocation->used = false;
+	m_freeHandles.push_back(handle);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the draw arguments of a mesh. </summary>
+///
+/// <param name="handle"> The handle returned by Allocate. </param>
+/// <param name="draw">   [out] The draw arguments. </param>
+///
+/// <returns> true if it succeeds, false if the handle is not valid. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool GeometryPoolClass::GetDraw(int handle, GeometryDraw& draw)
+{
+	AllocationType* allocation;
+
+	if(handle < 0 || handle >= (int)m_allocations.size() || !m_allocations[handle].used)
+	{
+		return false;
+	}
+
+	allocation = &m_allocations[handle];
+	draw.page = allocation->page;
+	draw.startIndex = allocation->indexOffset;
+	draw.indexCount = allocation->indexCount;
+	draw.baseVertex = allocation->baseVertex;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Turns a list of meshes into as few draws as possible. A mesh is merged into the draw
+/// 	before it when they are in the same page, share the base vertex and its indices start
+/// 	right where the previous ones ended. The indices are stored relative to the page, so
+/// 	every mesh allocated after another in the same page continues it. The meshes must share
+/// 	the same shader constants, since a merged draw is a single DrawIndexed call.
+/// </summary>
+///
+/// <param name="handles"> The mesh handles, in submission order. </param>
+/// <param name="count">   The number of handles. </param>
+/// <param name="draws">   [out] The draws, room for count entries is needed. </param>
+///
+/// <returns> The number of draws written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int GeometryPoolClass::BuildDrawList(const int* handles, int count, GeometryDraw* draws)
+{
+	GeometryDraw draw;
+	GeometryDraw* previous;
+	int i, drawCount;
+	bool result;
+
+	drawCount = 0;
+	for(i=0; i<count; i++)
+	{
+		result = GetDraw(handles[i], draw);
+		if(!result)
+		{
+			continue;
+		}
+
+		// Extend the previous draw if this one continues it.
+		if(drawCount > 0)
+		{
+			previous = &draws[drawCount - 1];
+			if(previous->page == draw.page && previous->baseVertex == draw.baseVertex && previous->startIndex + previous->indexCount == draw.startIndex)
+			{
+				previous->indexCount += draw.indexCount;
+				continue;
+			}
+		}
+
+		draws[drawCount] = draw;
+		drawCount++;
+	}
+
+	return drawCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Binds the buffers of a page to the input assembler, unless they already are. </summary>
+///
+/// <param name="deviceContext"> The device context. </param>
+/// <param name="page">			 The page, from GeometryDraw::page. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void GeometryPoolClass::Bind(ID3D11DeviceContext* deviceContext, int page)
+{
+	unsigned int stride;
+	unsigned int offset;
+
+	if(page < 0 || page >= (int)m_pages.size())
+	{
+		return;
+	}
+
+	if(page == m_boundPage)
+	{
+		m_bindsSkipped++;
+		return;
+	}
+
+	stride = m_pages[page]->stride;
+	offset = 0;
+
+	deviceContext->IASetVertexBuffers(0, 1, &m_pages[page]->vertexBuffer, &stride, &offset);
+	deviceContext->IASetIndexBuffer(m_pages[page]->indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	RenderStatsClass::Add(RENDER_COUNTER_BUFFER_BINDS, 2);
+
+	if(m_residencyManager)
+	{
+		m_residencyManager->Touch(m_pages[page]->vertexHandle);
+		m_residencyManager->Touch(m_pages[page]->indexHandle);
+	}
+
+	m_boundPage = page;
+	m_bufferBinds++;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Forgets which page is bound. Must be called whenever something else may have changed
+/// 	the input assembler buffers, and at the start of every frame.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void GeometryPoolClass::InvalidateBindings()
+{
+	m_boundPage = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Packs the live ranges of every fragmented page at the start of a fresh pair of buffers.
+/// 	The copies are done on the GPU with CopySubresourceRegion, and the old buffers are
+/// 	released once every range was moved.
+/// </summary>
+///
+/// <returns> true if it succeeds, false if new buffers could not be created. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool GeometryPoolClass::Defragment()
+{
+	RangeAllocatorStats vertexStats, indexStats;
+	ID3D11Buffer* vertexBuffer;
+	ID3D11Buffer* indexBuffer;
+	AllocationType* allocation;
+	PageType* page;
+	D3D11_BOX box;
+	unsigned int i, j, vertexOffset, indexOffset;
+	bool result;
+
+	for(i=0; i<m_pages.size(); i++)
+	{
+		page = m_pages[i];
+
+		// A page whose free space is a single range at the end is already packed.
+		page->vertexRanges.GetStats(vertexStats);
+		page->indexRanges.GetStats(indexStats);
+		if(vertexStats.freeRanges <= 1 && indexStats.freeRanges <= 1 && vertexStats.largestFree == vertexStats.free && indexStats.largestFree == indexStats.free)
+		{
+			continue;
+		}
+
+		result = CreateBuffers(page, &vertexBuffer, &indexBuffer);
+		if(!result)
+		{
+			// The pages packed before this one may have had their buffers bound.
+			m_boundPage = -1;
+			return false;
+		}
+
+		// Copy every live range of this page to the next free spot of the new buffers.
+		box.top = 0;
+		box.bottom = 1;
+		box.front = 0;
+		box.back = 1;
+		vertexOffset = 0;
+		indexOffset = 0;
+		for(j=0; j<m_allocations.size(); j++)
+		{
+			allocation = &m_allocations[j];
+			if(!allocation->used || allocation->page != (int)i)
+			{
+				continue;
+			}
+
+			box.left = allocation->vertexOffset * page->stride;
+			box.right = (allocation->vertexOffset + allocation->vertexCount) * page->stride;
+			m_deviceContext->CopySubresourceRegion(vertexBuffer, 0, vertexOffset * page->stride, 0, 0, page->vertexBuffer, 0, &box);
+
+			box.left = allocation->indexOffset * sizeof(unsigned long);
+			box.right = (allocation->indexOffset + allocation->indexCount) * sizeof(unsigned long);
+			m_deviceContext->CopySubresourceRegion(indexBuffer, 0, indexOffset * sizeof(unsigned long), 0, 0, page->indexBuffer, 0, &box);
+
+			// The indices were copied as they are, so the base vertex makes up for how far the vertices moved.
+			// Meshes that move together keep sharing it, and still merge.
+			allocation->baseVertex += (int)vertexOffset - (int)allocation->vertexOffset;
+			allocation->vertexOffset = vertexOffset;
+			allocation->indexOffset = indexOffset;
+			vertexOffset += allocation->vertexCount;
+			indexOffset += allocation->indexCount;
+		}
+
+		// Swap in the packed buffers. (Same size, so the residency accounting doesn't change.)
+		page->vertexBuffer->Release();
+		page->indexBuffer->Release();
+		page->vertexBuffer = vertexBuffer;
+		page->indexBuffer = indexBuffer;
+
+		page->vertexRanges.Reset(vertexOffset);
+		page->indexRanges.Reset(indexOffset);
+
+		m_defragmentations++;
+	}
+
+	// The old buffers may still be bound.
+	m_boundPage = -1;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets the occupancy statistics. The fragmentation is the share of the free space that is
+/// 	not in the largest free range of its page: 0 when every page is packed, close to 1 when
+/// 	the free space is scattered in many small holes.
+/// </summary>
+///
+/// <param name="stats"> [out] The statistics. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void GeometryPoolClass::GetStats(GeometryPoolStats& stats)
+{
+	RangeAllocatorStats vertexStats, indexStats;
+	unsigned long long vertexLargest, indexLargest;
+	unsigned int i;
+
+	memset(&stats, 0, sizeof(GeometryPoolStats));
+
+	vertexLargest = 0;
+	indexLargest = 0;
+	for(i=0; i<m_pages.size(); i++)
+	{
+		m_pages[i]->vertexRanges.GetStats(vertexStats);
+		m_pages[i]->indexRanges.GetStats(indexStats);
+
+		stats.vertexBytesUsed += (unsigned long long)vertexStats.used * m_pages[i]->stride;
+		stats.vertexBytesFree += (unsigned long long)vertexStats.free * m_pages[i]->stride;
+		stats.indexBytesUsed += (unsigned long long)indexStats.used * sizeof(unsigned long);
+		stats.indexBytesFree += (unsigned long long)indexStats.free * sizeof(unsigned long);
+		stats.freeRanges += vertexStats.freeRanges + indexStats.freeRanges;
+
+		vertexLargest += (unsigned long long)vertexStats.largestFree * m_pages[i]->stride;
+		indexLargest += (unsigned long long)indexStats.largestFree * sizeof(unsigned long);
+	}
+
+	if(stats.vertexBytesFree > 0)
+	{
+		stats.vertexFragmentation = 1.0f - (float)((double)vertexLargest / (double)stats.vertexBytesFree);
+	}
+	if(stats.indexBytesFree > 0)
+	{
+		stats.indexFragmentation = 1.0f - (float)((double)indexLargest / (double)stats.indexBytesFree);
+	}
+
+	stats.pages = (unsigned int)m_pages.size();
+	stats.allocations = (unsigned int)(m_allocations.size() - m_freeHandles.size());
+	stats.defragmentations = m_defragmentations;
+	stats.bufferBinds = m_bufferBinds;
+	stats.bindsSkipped = m_bindsSkipped;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates a page and its buffers. </summary>
+///
+/// <param name="stride">		  The size of one vertex in bytes. </param>
+/// <param name="vertexCapacity"> The number of vertices. </param>
+/// <param name="indexCapacity">  The number of indices. </param>
+///
+/// <returns> The index of the page, or -1 if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int GeometryPoolClass::CreatePage(unsigned int stride, unsigned int vertexCapacity, unsigned int indexCapacity)
+{
+	PageType* page;
+	bool result;
+
+	page = new PageType;
+	if(!page)
+	{
+		return -1;
+	}
+
+	page->stride = stride;
+	page->vertexCapacity = vertexCapacity;
+	page->indexCapacity = indexCapacity;
+	page->vertexHandle = -1;
+	page->indexHandle = -1;
+
+	result = CreateBuffers(page, &page->vertexBuffer, &page->indexBuffer);
+	if(!result)
+	{
+		delete page;
+		return -1;
+	}
+
+	page->vertexRanges.Initialize(vertexCapacity);
+	page->indexRanges.Initialize(indexCapacity);
+
+	// Account for the page memory. (Geometry can't be evicted.)
+	if(m_residencyManager)
+	{
+		page->vertexHandle = m_residencyManager->Register(RESOURCE_VERTEX_BUFFER, (unsigned long long)vertexCapacity * stride, NULL);
+		page->indexHandle = m_residencyManager->Register(RESOURCE_INDEX_BUFFER, (unsigned long long)indexCapacity * sizeof(unsigned long), NULL);
+	}
+
+	m_pages.push_back(page);
+
+	return (int)m_pages.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates an empty vertex and index buffer sized for a page. </summary>
+///
+/// <param name="page">			The page. </param>
+/// <param name="vertexBuffer"> [out] The vertex buffer. </param>
+/// <param name="indexBuffer">  [out] The index buffer. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool GeometryPoolClass::CreateBuffers(PageType* page, ID3D11Buffer** vertexBuffer, ID3D11Buffer** indexBuffer)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	HRESULT result;
+
+	// Set up the description of the vertex buffer. (Default usage so it can be updated in ranges and copied.)
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.ByteWidth = page->vertexCapacity * page->stride;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	result = m_device->CreateBuffer(&bufferDesc, NULL, vertexBuffer);
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	// Set up the description of the index buffer.
+	bufferDesc.ByteWidth = page->indexCapacity * sizeof(unsigned long);
+	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+	result = m_device->CreateBuffer(&bufferDesc, NULL, indexBuffer);
+	if(FAILED(result))
+	{
+		(*vertexBuffer)->Release();
+		*vertexBuffer = 0;
+		return false;
+	}
+
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS, 2);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the buffers of a page. </summary>
+///
+/// <param name="page"> The page. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void GeometryPoolClass::ReleasePage(PageType* page)
+{
+	if(m_residencyManager)
+	{
+		m_residencyManager->Unregister(page->vertexHandle);
+		m_residencyManager->Unregister(page->indexHandle);
+	}
+
+	if(page->indexBuffer)
+	{
+		page->indexBuffer->Release();
+		page->indexBuffer = 0;
+	}
+
+	if(page->vertexBuffer)
+	{
+		page->vertexBuffer->Release();
+		page->vertexBuffer = 0;
+	}
+
+	page->vertexRanges.Shutdown();
+	page->indexRanges.Shutdown();
+
+	return;
+}
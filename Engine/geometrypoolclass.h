@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	geometrypoolclass.h
+//
+// summary:	Declares the geometrypoolclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _GEOMETRYPOOLCLASS_H_
+#define _GEOMETRYPOOLCLASS_H_
+
+// DirectX Includes.
+#include <d3d11.h>
+
+// System Includes.
+#include <vector>
+
+// Includes.
+#include "rangeallocatorclass.h"
+#include "residencymanagerclass.h"
+#include "renderstatsclass.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The arguments of one DrawIndexed call into a pool page. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct GeometryDraw
+{
+	int page;
+	unsigned int startIndex;
+	unsigned int indexCount;
+	int baseVertex;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Occupancy of the whole pool. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct GeometryPoolStats
+{
+	unsigned int pages;
+	unsigned int allocations;
+	unsigned long long vertexBytesUsed;
+	unsigned long long vertexBytesFree;
+	unsigned long long indexBytesUsed;
+	unsigned long long indexBytesFree;
+	unsigned int freeRanges;
+	float vertexFragmentation;
+	float indexFragmentation;
+	unsigned long defragmentations;
+	unsigned long bufferBinds;
+	unsigned long bindsSkipped;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Holds the geometry of every model in a few large vertex and index buffers instead of a
+/// 	pair per model. The buffers are grouped in pages, one or more per vertex stride, and the
+/// 	vertices and indices of a mesh are suballocated inside a page with range allocators. A
+/// 	mesh is known by a handle, and is drawn with DrawIndexed using the start index and base
+/// 	vertex of its ranges. Binding is skipped when the page is already bound, so consecutive
+/// 	meshes in one page cost one bind, and BuildDrawList merges draws whose ranges follow
+/// 	each other into a single call. Defragment packs the live ranges of every page at the
+/// 	start of new buffers; handles stay valid since they are looked up on every draw.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class GeometryPoolClass
+{
+private:
+	struct PageType
+	{
+		unsigned int stride;
+		unsigned int vertexCapacity;
+		unsigned int indexCapacity;
+		ID3D11Buffer* vertexBuffer;
+		ID3D11Buffer* indexBuffer;
+		RangeAllocatorClass vertexRanges;
+		RangeAllocatorClass indexRanges;
+		int vertexHandle;
+		int indexHandle;
+	};
+
+	struct AllocationType
+	{
+		int page;
+		unsigned int vertexOffset;
+		unsigned int vertexCount;
+		unsigned int indexOffset;
+		unsigned int indexCount;
+		int baseVertex;
+		bool used;
+	};
+
+public:
+	GeometryPoolClass();
+	GeometryPoolClass(const GeometryPoolClass&);
+	~GeometryPoolClass();
+
+	bool Initialize(ID3D11Device*, ID3D11DeviceContext*, ResidencyManagerClass*, unsigned int, unsigned int);
+	void Shutdown();
+
+	int Allocate(const void*, unsigned int, unsigned int, const unsigned long*, unsigned int);
+	void Free(int);
+
+	bool GetDraw(int, GeometryDraw&);
+	int BuildDrawList(const int*, int, GeometryDraw*);
+	void Bind(ID3D11DeviceContext*, int);
+	void InvalidateBindings();
+
+	bool Defragment();
+	void GetStats(GeometryPoolStats&);
+
+private:
+	int CreatePage(unsigned int, unsigned int, unsigned int);
+	bool CreateBuffers(PageType*, ID3D11Buffer**, ID3D11Buffer**);
+	void ReleasePage(PageType*);
+
+private:
+	ID3D11Device* m_device;
+	ID3D11DeviceContext* m_deviceContext;
+	ResidencyManagerClass* m_residencyManager;
+	unsigned int m_pageVertices;
+	unsigned int m_pageIndices;
+	vector<PageType*> m_pages;
+	vector<AllocationType> m_allocations;
+	vector<int> m_freeHandles;
+	int m_boundPage;
+	unsigned long m_defragmentations;
+	unsigned long m_bufferBinds;
+	unsigned long m_bindsSkipped;
+};
+
+#endif
@@ -5,6 +5,9 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 #include "graphicsclass.h"
 
+// System Includes.
+#include <cassert>
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// <summary> Default constructor. </summary>
 ///
@@ -13,9 +16,24 @@
 GraphicsClass::GraphicsClass()
 {
 	m_D3D = 0;
+	m_GeometryPool = 0;
 	m_Camera = 0;
 	m_Model = 0;
+	m_Texture = 0;
 	m_ColorShader = 0;
+	m_Frustum = 0;
+	m_StaticBatch = 0;
+	m_Scene = 0;
+	m_Entities = 0;
+	m_RenderSystem = 0;
+	m_Occlusion = 0;
+	m_SceneQuery = 0;
+	m_FontTexture = 0;
+	m_SpriteRenderer = 0;
+	m_DebugDrawRenderer = 0;
+	m_Shaders[COLOR_SHADER_ID] = 0;
+	m_modelAsset = -1;
+	m_modelEntity = ENTITY_NONE;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -44,6 +62,18 @@ GraphicsClass::~GraphicsClass()
 /// 	send this function the screen width, screen height, handle to the window, and the four
 /// 	global variables from the Graphicsclass.h file. The D3DClass will use all these variables
 /// 	to setup the Direct3D system.
+/// 	
+/// 	The graphics objects are not created on the heap, they are constructed inside a pool of
+/// 	fixed size blocks, each big enough for the largest of them.
+/// 	
+/// 	The initialization runs as a task graph, so the shaders compile and the model loads on
+/// 	worker threads while Direct3D is being set up. The timeline of the startup is written to
+/// 	STARTUP_TIMELINE_FILE. The model built at startup is only a placeholder, the real one is
+/// 	loaded from MODEL_FILE by the asset loader and swapped in by a later frame. Its texture is
+/// 	created from the lower mips of TEXTURE_FILE, and the rest stream in once the model is in.
+/// 	
+/// 	What gets drawn is not wired in here: the model is an entity placed by a scene node, and
+/// 	the render system turns the entities into draws every frame.
 /// </summary>
 ///
 /// <remarks> Filipe, 25 Nov 2012. </remarks>
@@ -51,68 +81,306 @@ GraphicsClass::~GraphicsClass()
 /// <param name="screenWidth">  Width of the screen. </param>
 /// <param name="screenHeight"> Height of the screen. </param>
 /// <param name="hwnd">		    Handle of the window. </param>
+/// <param name="fileSystem">   The file system the assets are read through. </param>
 ///
 /// <returns> true if it succeeds, false if it fails. </returns>
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-bool GraphicsClass::Initialize(int screenWidth, int screenHeight, HWND hwnd)
+bool GraphicsClass::Initialize(int screenWidth, int screenHeight, HWND hwnd, FileSystemClass* fileSystem)
 {
+	TaskGraphClass startup;
+	AllocatorStats poolStats;
 	bool result;
-		
-	// Create the Direct3D object.
-	m_D3D = new D3DClass;
-	if(!m_D3D)
-	{
-		return false;
-	}
+	size_t blockSize;
+	int direct3D, geometryPool, compileShaders, colorShader, loadModel, uploadModel, texture, scene, entities, staticBatch, sprites;
+#if DEBUG_DRAW_ENABLED
+	int debugDraw;
+#endif
+
+	// Find the size of the largest graphics object, every block of the pool must be able to hold any of them.
+	blockSize = sizeof(D3DClass);
+	blockSize = sizeof(GeometryPoolClass) > blockSize ? sizeof(GeometryPoolClass) : blockSize;
+	blockSize = sizeof(CameraClass) > blockSize ? sizeof(CameraClass) : blockSize;
+	blockSize = sizeof(ModelClass) > blockSize ? sizeof(ModelClass) : blockSize;
+	blockSize = sizeof(TextureClass) > blockSize ? sizeof(TextureClass) : blockSize;
+	blockSize = sizeof(ColorShaderClass) > blockSize ? sizeof(ColorShaderClass) : blockSize;
+	blockSize = sizeof(FrustumClass) > blockSize ? sizeof(FrustumClass) : blockSize;
+	blockSize = sizeof(StaticBatchClass) > blockSize ? sizeof(StaticBatchClass) : blockSize;
+	blockSize = sizeof(SceneClass) > blockSize ? sizeof(SceneClass) : blockSize;
+	blockSize = sizeof(EntityManagerClass) > blockSize ? sizeof(EntityManagerClass) : blockSize;
+	blockSize = sizeof(RenderSystemClass) > blockSize ? sizeof(RenderSystemClass) : blockSize;
+	blockSize = sizeof(OcclusionCullerClass) > blockSize ? sizeof(OcclusionCullerClass) : blockSize;
+	blockSize = sizeof(SceneQueryClass) > blockSize ? sizeof(SceneQueryClass) : blockSize;
+	blockSize = sizeof(SpriteRendererClass) > blockSize ? sizeof(SpriteRendererClass) : blockSize;
+	blockSize = sizeof(DebugDrawRendererClass) > blockSize ? sizeof(DebugDrawRendererClass) : blockSize;
 
-	// Initialize the Direct3D object.
-	result = m_D3D->Initialize(screenWidth, screenHeight, VSYNC_ENABLED, hwnd, FULL_SCREEN, SCREEN_DEPTH, SCREEN_NEAR);
+	// Create the pool the graphics objects are constructed in.
+	result = m_ObjectPool.Initialize(blockSize, OBJECT_POOL_SIZE);
 	if(!result)
 	{
-		MessageBox(hwnd, L"Could not initialize Direct3D", L"Error", MB_OK);
 		return false;
 	}
+		
+	// Create every object up front, the pool isn't thread safe and the tasks only initialize them.
+	m_D3D = m_ObjectPool.New<D3DClass>();
+	m_GeometryPool = m_ObjectPool.New<GeometryPoolClass>();
+	m_Camera = m_ObjectPool.New<CameraClass>();
+	m_Model = m_ObjectPool.New<ModelClass>();
+	m_Texture = m_ObjectPool.New<TextureClass>();
+	m_ColorShader = m_ObjectPool.New<ColorShaderClass>();
+	m_Frustum = m_ObjectPool.New<FrustumClass>();
+	m_StaticBatch = m_ObjectPool.New<StaticBatchClass>();
+	m_Scene = m_ObjectPool.New<SceneClass>();
+	m_Entities = m_ObjectPool.New<EntityManagerClass>();
+	m_RenderSystem = m_ObjectPool.New<RenderSystemClass>();
+	m_Occlusion = m_ObjectPool.New<OcclusionCullerClass>();
+	m_SceneQuery = m_ObjectPool.New<SceneQueryClass>();
+	m_FontTexture = m_ObjectPool.New<TextureClass>();
+	m_SpriteRenderer = m_ObjectPool.New<SpriteRendererClass>();
+#if DEBUG_DRAW_ENABLED
+	m_DebugDrawRenderer = m_ObjectPool.New<DebugDrawRendererClass>();
+#endif
 
-	// Create the camera object.
-	m_Camera = new CameraClass;
-	if(!m_Camera)
+	// The pool only runs out when an object was added without raising its size.
+	m_ObjectPool.GetStats(poolStats);
+	if(poolStats.failedAllocations > 0)
 	{
+		LOG_FATAL(LOG_CATEGORY_RENDER, "The graphics object pool is full at %d objects, %lu more didn't fit. Raise OBJECT_POOL_SIZE.", OBJECT_POOL_SIZE, poolStats.failedAllocations);
+		assert(!"The graphics object pool is full, raise OBJECT_POOL_SIZE.");
 		return false;
 	}
 
-	// Set the initial position of the camera.
-	m_Camera->SetPosition(0.0f, 0.0f, -10.0f);
-	
-	// Create the model object.
-	m_Model = new ModelClass;
-	if(!m_Model)
+	if(!m_D3D || !m_GeometryPool || !m_Camera || !m_Model || !m_Texture || !m_ColorShader || !m_Frustum || !m_StaticBatch || !m_Scene || !m_Entities || !m_RenderSystem || !m_Occlusion || !m_SceneQuery || 
+	   !m_FontTexture || !m_SpriteRenderer)
 	{
 		return false;
 	}
 
-	// Initialize the model object.
-	result = m_Model->Initialize(m_D3D->GetDevice());
-	if(!result)
+#if DEBUG_DRAW_ENABLED
+	if(!m_DebugDrawRenderer)
 	{
-		MessageBox(hwnd, L"Could not initialize the model object.", L"Error", MB_OK);
 		return false;
 	}
+#endif
+
+	// The draws name their shader by id.
+	m_Shaders[COLOR_SHADER_ID] = m_ColorShader;
+
+	// The startup is a graph of tasks. Compiling the shaders and loading the model only touch the CPU, so
+	// they run on the workers while the device is created; whatever uses the device context or the
+	// residency manager runs on this thread.
+	direct3D = startup.AddTask("Direct3D", [&]() -> bool
+	{
+		// Initialize the Direct3D object.
+		if(!m_D3D->Initialize(screenWidth, screenHeight, VSYNC_ENABLED, hwnd, FULL_SCREEN, SCREEN_DEPTH, SCREEN_NEAR))
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "Could not initialize Direct3D.");
+			return false;
+		}
+		return true;
+	}, true);
+
+	geometryPool = startup.AddTask("Geometry pool", [&]() -> bool
+	{
+		// Initialize the geometry pool object. Every model keeps its vertices and indices in its shared buffers.
+		if(!m_GeometryPool->Initialize(m_D3D->GetDevice(), m_D3D->GetDeviceContext(), m_D3D->GetResidencyManager(), GEOMETRY_PAGE_VERTICES, GEOMETRY_PAGE_INDICES))
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "Could not initialize the geometry pool object.");
+			return false;
+		}
+		return true;
+	}, true);
+
+	compileShaders = startup.AddTask("Compile shaders", [&]() -> bool
+	{
+		return m_ColorShader->Compile(fileSystem, hwnd);
+	});
+
+	colorShader = startup.AddTask("Color shader", [&]() -> bool
+	{
+		// Initialize the color shader object, the shaders are already compiled.
+		if(!m_ColorShader->Initialize(m_D3D->GetDevice(), hwnd, m_D3D->GetResidencyManager(), fileSystem))
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "Could not initialize the color shader object.");
+			return false;
+		}
+		return true;
+	}, true);
+
+	loadModel = startup.AddTask("Load model", [&]() -> bool
+	{
+		return m_Model->Load();
+	});
+
+	uploadModel = startup.AddTask("Upload model", [&]() -> bool
+	{
+		// Initialize the model object, its geometry is already loaded.
+		if(!m_Model->Initialize(m_GeometryPool))
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "Could not initialize the model object.");
+			return false;
+		}
+		return true;
+	}, true);
+
+	texture = startup.AddTask("Texture", [&]() -> bool
+	{
+		TextureData placeholder;
+		TextureMip mip;
+
+		// Initialize the texture object from the lower mips of its file, mapped so the others aren't read before they are used.
+		if(m_TextureFile.Initialize(fileSystem, TEXTURE_FILE) && m_Texture->Initialize(m_D3D->GetDevice(), m_TextureFile, TEXTURE_STREAMING_SKIP_MIPS, m_D3D->GetResidencyManager()))
+		{
+			m_Model->SetTexture(m_Texture);
+			return true;
+		}
+		m_TextureFile.Shutdown();
+
+		// Without the file one white pixel leaves the vertex colors as they are.
+		LOG_WARNING(LOG_CATEGORY_RESOURCE, "Could not load the texture %s, drawing without it.", TEXTURE_FILE);
+		mip.width = 1;
+		mip.height = 1;
+		mip.rowPitch = 4;
+		mip.offset = 0;
+		mip.size = 4;
+		placeholder.format = TEXTURE_FORMAT_RGBA8;
+		placeholder.srgb = true;
+		placeholder.width = 1;
+		placeholder.height = 1;
+		placeholder.mips.push_back(mip);
+		placeholder.data.assign(4, 255);
+
+		if(!m_Texture->Initialize(m_D3D->GetDevice(), placeholder, m_D3D->GetResidencyManager()))
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "Could not initialize the texture object.");
+			return false;
+		}
+
+		m_Model->SetTexture(m_Texture);
+		return true;
+	}, true);
 
-	// Create the color shader object.
-	m_ColorShader = new ColorShaderClass;
-	if(!m_ColorShader)
+	startup.AddTask("Camera", [&]() -> bool
+	{
+		// Set the initial position of the camera.
+		m_Camera->SetPosition(0.0f, 0.0f, -10.0f);
+		return true;
+	});
+
+	startup.AddTask("Occlusion", [&]() -> bool
+	{
+		// Initialize the occlusion culler, it only needs its depth buffer.
+		return m_Occlusion->Initialize();
+	});
+
+	scene = startup.AddTask("Scene", [&]() -> bool
+	{
+		// Initialize the scene object.
+		return m_Scene->Initialize();
+	});
+
+	entities = startup.AddTask("Entities", [&]() -> bool
+	{
+		// Initialize the entities, the render system and the queries on it, then create the model as static scenery hiding what is behind it at a node at the origin.
+		if(!m_Entities->Initialize() || !m_RenderSystem->Initialize(m_Entities, m_GeometryPool) || !m_SceneQuery->Initialize(m_Entities, m_RenderSystem))
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "Could not initialize the entities.");
+			return false;
+		}
+
+		m_modelEntity = m_RenderSystem->CreateMesh(m_Scene, m_Scene->AddNode(), m_Model, COLOR_SHADER_ID, true, true);
+		if(m_modelEntity == ENTITY_NONE || !m_Scene->Update(0))
+		{
+			return false;
+		}
+		m_RenderSystem->Update(m_Scene);
+		return true;
+	});
+
+	staticBatch = startup.AddTask("Static batch", [&]() -> bool
+	{
+		return BuildStaticBatch();
+	}, true);
+
+	sprites = startup.AddTask("Sprites", [&]() -> bool
+	{
+		// Build the font atlas and upload it, then create the ring the overlay sprites are drawn from.
+		if(!m_Font.Initialize() || !m_FontTexture->Initialize(m_D3D->GetDevice(), m_Font.GetAtlas(), m_D3D->GetResidencyManager()))
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "Could not initialize the font.");
+			return false;
+		}
+		m_Font.SetTexture(m_FontTexture->GetTexture());
+
+		if(!m_SpriteRenderer->Initialize(m_D3D->GetDevice(), m_D3D->GetResidencyManager()) || !m_SpriteBatch.Initialize())
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "Could not initialize the sprite renderer.");
+			return false;
+		}
+		return true;
+	}, true);
+
+	startup.AddDependency(geometryPool, direct3D);
+	startup.AddDependency(colorShader, direct3D);
+	startup.AddDependency(colorShader, compileShaders);
+	startup.AddDependency(uploadModel, geometryPool);
+	startup.AddDependency(uploadModel, loadModel);
+	startup.AddDependency(texture, direct3D);
+	startup.AddDependency(entities, scene);
+	startup.AddDependency(entities, geometryPool);
+	startup.AddDependency(entities, loadModel);
+	startup.AddDependency(staticBatch, uploadModel);
+	startup.AddDependency(staticBatch, entities);
+	startup.AddDependency(staticBatch, texture);
+	startup.AddDependency(sprites, direct3D);
+
+#if DEBUG_DRAW_ENABLED
+	debugDraw = startup.AddTask("Debug draw", [&]() -> bool
+	{
+		// Start taking debug lines and create the buffer they are merged into, drawn with the white of the font atlas.
+		if(!DebugDrawClass::Initialize() || !m_DebugDrawRenderer->Initialize(m_D3D->GetDevice(), m_D3D->GetResidencyManager()))
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "Could not initialize the debug draw.");
+			return false;
+		}
+		return true;
+	}, true);
+
+	startup.AddDependency(debugDraw, sprites);
+#endif
+
+	result = startup.Run();
+
+	// Write the startup timeline even when it failed, it shows what was left undone.
+	startup.WriteTimeline(STARTUP_TIMELINE_FILE);
+	LOG_INFO(LOG_CATEGORY_RENDER, "Graphics startup took %.1f ms, %.1f ms of work, %.1f ms critical path.", startup.GetWallMilliseconds(), startup.GetWorkMilliseconds(), startup.GetCriticalPathMilliseconds());
+	if(!result)
 	{
 		return false;
 	}
 
-	// Initialize the color shader object.
-	result = m_ColorShader->Initialize(m_D3D->GetDevice(), hwnd);
+	// Start the asset loader. The model drawn so far is a placeholder, the real one streams in while the frames go on.
+	result = m_AssetLoader.Initialize(fileSystem);
 	if(!result)
 	{
-		MessageBox(hwnd, L"Could not initialize the color shader object.", L"Error", MB_OK);
 		return false;
 	}
 
+	m_modelAsset = m_AssetLoader.Load(MODEL_FILE, [this](const vector<char>& data) -> bool
+	{
+		return m_Model->Decode(data);
+	}, [this]() -> bool
+	{
+		// Swap the geometry in, give the entities drawing it its bounds, then merge the batch again, it holds a copy of the placeholder.
+		if(!m_Model->Upload())
+		{
+			return false;
+		}
+
+		m_RenderSystem->RefreshBounds(m_Scene, m_Model);
+
+		return BuildStaticBatch();
+	});
+
 	return true;
 }
 
@@ -128,36 +396,169 @@ bool GraphicsClass::Initialize(int screenWidth, int screenHeight, HWND hwnd)
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 void GraphicsClass::Shutdown()
 {
+	const double Megabyte = 1024.0 * 1024.0;
+	ResidencyStats residency;
+	AllocatorStats frameAllocator;
+	GeometryPoolStats geometryPool;
+
+	// Report how the video memory was used, while everything is still accounted for.
+	if(m_D3D)
+	{
+		m_D3D->GetResidencyManager()->GetStats(residency);
+		LOG_INFO(LOG_CATEGORY_RENDER, "Video memory: %.1f MB resident of a %.1f MB budget, peak %.1f MB, textures %.1f MB resident and %.1f MB evicted.",
+			residency.residentBytes / Megabyte, residency.budget / Megabyte, residency.peakResidentBytes / Megabyte,
+			residency.categories[RESOURCE_TEXTURE].residentBytes / Megabyte, residency.categories[RESOURCE_TEXTURE].evictedBytes / Megabyte);
+		LOG_INFO(LOG_CATEGORY_RENDER, "Video memory: %lu evictions, %lu restores, %lu failed restores.", residency.evictions, residency.restores, residency.failedRestores);
+
+		m_D3D->GetFrameAllocator()->GetStats(frameAllocator);
+		LOG_INFO(LOG_CATEGORY_RENDER, "Frame allocator: %.1f KB at most of %.1f KB, %lu failed allocations.",
+			frameAllocator.highWaterMark / 1024.0, frameAllocator.capacity / 1024.0, frameAllocator.failedAllocations);
+	}
+
+	// Report how the geometry pool was used, and how often its pages were bound.
+	if(m_GeometryPool)
+	{
+		m_GeometryPool->GetStats(geometryPool);
+		LOG_INFO(LOG_CATEGORY_RENDER, "Geometry pool: %.1f MB of vertices and %.1f MB of indices used, %.1f%% and %.1f%% of the free space fragmented in %u ranges.",
+			geometryPool.vertexBytesUsed / Megabyte, geometryPool.indexBytesUsed / Megabyte, geometryPool.vertexFragmentation * 100.0f, geometryPool.indexFragmentation * 100.0f, geometryPool.freeRanges);
+		LOG_INFO(LOG_CATEGORY_RENDER, "Geometry pool: %lu defragmentations, %lu buffer binds, %lu skipped.", geometryPool.defragmentations, geometryPool.bufferBinds, geometryPool.bindsSkipped);
+	}
+
+	// Stop the asset loader first, its threads may be decoding into the objects below.
+	m_AssetLoader.Shutdown();
+	m_modelAsset = -1;
+
+	// Release the scene queries, the render system and the entities.
+	if(m_SceneQuery)
+	{
+		m_SceneQuery->Shutdown();
+		m_ObjectPool.Delete(m_SceneQuery);
+		m_SceneQuery = 0;
+	}
+
+	if(m_RenderSystem)
+	{
+		m_RenderSystem->Shutdown();
+		m_ObjectPool.Delete(m_RenderSystem);
+		m_RenderSystem = 0;
+	}
+
+	if(m_Entities)
+	{
+		m_Entities->Shutdown();
+		m_ObjectPool.Delete(m_Entities);
+		m_Entities = 0;
+	}
+	m_modelEntity = ENTITY_NONE;
+
+	// Release the scene object.
+	if(m_Scene)
+	{
+		m_Scene->Shutdown();
+		m_ObjectPool.Delete(m_Scene);
+		m_Scene = 0;
+	}
+
+	// Release the static batch object.
+	if(m_StaticBatch)
+	{
+		m_StaticBatch->Shutdown();
+		m_ObjectPool.Delete(m_StaticBatch);
+		m_StaticBatch = 0;
+	}
+
+	// Release the occlusion culler.
+	if(m_Occlusion)
+	{
+		m_Occlusion->Shutdown();
+		m_ObjectPool.Delete(m_Occlusion);
+		m_Occlusion = 0;
+	}
+
+	// Release the frustum object.
+	if(m_Frustum)
+	{
+		m_ObjectPool.Delete(m_Frustum);
+		m_Frustum = 0;
+	}
+
 	// Release the color shader object.
 	if(m_ColorShader)
 	{
 		m_ColorShader->Shutdown();
-		delete m_ColorShader;
+		m_ObjectPool.Delete(m_ColorShader);
 		m_ColorShader = 0;
 	}
+	m_Shaders[COLOR_SHADER_ID] = 0;
+
+	// Release the debug draw, every thread drawing lines is gone.
+	if(m_DebugDrawRenderer)
+	{
+		m_DebugDrawRenderer->Shutdown();
+		m_ObjectPool.Delete(m_DebugDrawRenderer);
+		m_DebugDrawRenderer = 0;
+	}
+	DebugDrawClass::Shutdown();
+
+	// Release the sprite renderer and the font texture it draws the text with.
+	m_SpriteBatch.Shutdown();
+	if(m_SpriteRenderer)
+	{
+		m_SpriteRenderer->Shutdown();
+		m_ObjectPool.Delete(m_SpriteRenderer);
+		m_SpriteRenderer = 0;
+	}
+
+	if(m_FontTexture)
+	{
+		m_FontTexture->Shutdown();
+		m_ObjectPool.Delete(m_FontTexture);
+		m_FontTexture = 0;
+	}
+	m_Font.Shutdown();
 
 	// Release the model object.
 	if(m_Model)
 	{
 		m_Model->Shutdown();
-		delete m_Model;
+		m_ObjectPool.Delete(m_Model);
 		m_Model = 0;
 	}
 
+	// Release the texture object, after the model drawn with it.
+	if(m_Texture)
+	{
+		m_Texture->Shutdown();
+		m_ObjectPool.Delete(m_Texture);
+		m_Texture = 0;
+	}
+	m_TextureFile.Shutdown();
+
 	// Release the camera object.
 	if(m_Camera)
 	{
-		delete m_Camera;
+		m_ObjectPool.Delete(m_Camera);
 		m_Camera = 0;
 	}
 
+	// Release the geometry pool object, after every model that had geometry in it.
+	if(m_GeometryPool)
+	{
+		m_GeometryPool->Shutdown();
+		m_ObjectPool.Delete(m_GeometryPool);
+		m_GeometryPool = 0;
+	}
+
 	if(m_D3D)
 	{
 		m_D3D->Shutdown();
-		delete m_D3D;
+		m_ObjectPool.Delete(m_D3D);
 		m_D3D = 0;
 	}
 
+	// Release the object pool now that every object in it is gone.
+	m_ObjectPool.Shutdown();
+
 	return;
 }
 
@@ -172,6 +573,30 @@ bool GraphicsClass::Frame()
 {
 	bool result;
 
+	// Swap in the assets that finished loading, within the upload budget of the frame.
+	m_AssetLoader.Update(ASSET_LOADER_UPLOAD_BUDGET_MS);
+
+	// Once nothing else is loading, stream in the high mips of the texture. The file stays mapped, the texture is created again from it if it is evicted.
+	if(m_TextureFile.GetMipCount() > 0 && m_Texture->GetFirstMip() > 0 && m_AssetLoader.GetPendingCount() == 0)
+	{
+		if(!m_Texture->Initialize(m_D3D->GetDevice(), m_TextureFile, 0, m_D3D->GetResidencyManager()))
+		{
+			// Keep the low mips, but without the file they can't come back if they are evicted.
+			LOG_WARNING(LOG_CATEGORY_RESOURCE, "Could not stream in the high mips of %s, keeping the low ones.", TEXTURE_FILE);
+			m_TextureFile.Shutdown();
+		}
+	}
+
+	// Bring the world matrices of the nodes that moved up to date.
+	result = m_Scene->Update();
+	if(!result)
+	{
+		return false;
+	}
+
+	// Hand the nodes that moved to the entities they place.
+	m_RenderSystem->Update(m_Scene);
+
 	// Render the graphics scene.
 	result = Render();
 	if(!result)
@@ -194,26 +619,81 @@ bool GraphicsClass::Frame()
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 bool GraphicsClass::Render()
 {
-	D3DXMATRIX viewMatrix, projectionMatrix, worldMatrix;
+	D3DXMATRIX viewMatrix, projectionMatrix, viewProjectionMatrix;
+	ID3D11ShaderResourceView* textureView;
+	RenderDraw* draws;
+	int i, drawCount;
 	bool result;
 
+	PROFILE_FUNCTION();
 
 	// Clear the buffers to begin the scene.
 	m_D3D->BeginScene(0.0f, 0.0f, 0.0f, 1.0f);
 
+	// Nothing is known to be bound at the start of a frame.
+	m_GeometryPool->InvalidateBindings();
+
 	// Generate the view matrix based on the camera's position.
 	m_Camera->Render();
 
-	// Get the world, view, and projection matrices from the camera and d3d objects.
+	// Get the view and projection matrices from the camera and d3d objects, every draw brings its world matrix.
 	m_Camera->GetViewMatrix(viewMatrix);
-	m_D3D->GetWorldMatrix(worldMatrix);
 	m_D3D->GetProjectionMatrix(projectionMatrix);
 
-	// Put the model vertex and index buffers on the graphics pipeline to prepare them for drawing.
-	m_Model->Render(m_D3D->GetDeviceContext());
+	// Build the frustum of this frame and rasterize the occluders as the camera sees them, then let the
+	// render system walk its hierarchy for what is inside the frustum and not hidden behind them.
+	{
+		PROFILE_ZONE("GraphicsClass::Cull");
+
+		m_Frustum->ConstructFrustum(SCREEN_DEPTH, projectionMatrix, viewMatrix);
+
+		D3DXMatrixMultiply(&viewProjectionMatrix, &viewMatrix, &projectionMatrix);
+		m_Occlusion->BeginFrame((const float*)&viewProjectionMatrix);
+		m_RenderSystem->RenderOccluders(m_Occlusion);
+		m_Occlusion->Finish();
 
-	// Render the model using the color shader.
-	result = m_ColorShader->Render(m_D3D->GetDeviceContext(), m_Model->GetIndexCount(), worldMatrix, viewMatrix, projectionMatrix);
+		drawCount = m_RenderSystem->Submit(m_Frustum, m_Occlusion, m_StaticBatch, m_D3D->GetFrameAllocator(), draws);
+		if(drawCount < 0)
+		{
+			LOG_ERROR(LOG_CATEGORY_RENDER, "The frame allocator ran out while culling, FRAME_ALLOCATOR_SIZE is too small.");
+			return false;
+		}
+	}
+
+	// Render the draws with the shader each one names.
+	for(i=0; i<drawCount; i++)
+	{
+		if(draws[i].shaderId < 0 || draws[i].shaderId >= SHADER_COUNT || !m_Shaders[draws[i].shaderId])
+		{
+			continue;
+		}
+
+		// Put the pool buffers holding the geometry on the graphics pipeline.
+		m_GeometryPool->Bind(m_D3D->GetDeviceContext(), draws[i].geometry.page);
+		m_D3D->GetDeviceContext()->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
+
+		// Asking for the view keeps the texture resident, and creates it again if it was evicted.
+		textureView = draws[i].texture ? draws[i].texture->GetTexture() : 0;
+
+		result = m_Shaders[draws[i].shaderId]->Render(m_D3D->GetDeviceContext(), draws[i].geometry.indexCount, draws[i].geometry.startIndex, draws[i].geometry.baseVertex, draws[i].world, viewMatrix, projectionMatrix, textureView);
+		if(!result)
+		{
+			return false;
+		}
+	}
+
+#if DEBUG_DRAW_ENABLED
+	// Draw the debug lines of every thread.
+	result = RenderDebugDraw(viewMatrix, projectionMatrix);
+	if(!result)
+	{
+		return false;
+	}
+#endif
+
+	// Draw the overlay over the scene.
+	result = RenderOverlay();
 	if(!result)
 	{
 		return false;
@@ -222,5 +702,183 @@ bool GraphicsClass::Render()
 	// Present the rendered scene to the screen.
 	m_D3D->EndScene();
 
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Draws the debug lines of the frame: the world axes and, with DEBUG_DRAW_BVH, the boxes of
+/// 	both hierarchies of the render system, then every line any thread drew during the frame.
+/// </summary>
+///
+/// <param name="viewMatrix">		The view matrix. </param>
+/// <param name="projectionMatrix"> The projection matrix. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool GraphicsClass::RenderDebugDraw(D3DXMATRIX viewMatrix, D3DXMATRIX projectionMatrix)
+{
+	D3DXMATRIX worldMatrix;
+	float u, v;
+	bool result;
+
+	PROFILE_FUNCTION();
+
+	D3DXMatrixIdentity(&worldMatrix);
+	DEBUG_DRAW_AXES((const float*)&worldMatrix, DEBUG_DRAW_AXES_SIZE, DEBUG_DRAW_OVERLAY);
+
+	if(DEBUG_DRAW_BVH)
+	{
+		m_RenderSystem->GetBvh()->DrawDebug(DEBUG_DRAW_NODE_COLOR, DEBUG_DRAW_OBJECT_COLOR);
+		m_RenderSystem->GetStaticBvh()->DrawDebug(DEBUG_DRAW_STATIC_NODE_COLOR, DEBUG_DRAW_STATIC_OBJECT_COLOR);
+	}
+
+	m_Font.GetWhiteTexel(u, v);
+	result = m_DebugDrawRenderer->Render(m_D3D, m_ColorShader, viewMatrix, projectionMatrix, m_FontTexture->GetTexture(), u, v);
+
+	// The debug lines replaced the pool buffers on the pipeline.
+	m_GeometryPool->InvalidateBindings();
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Draws the 2D overlay with the orthographic matrix: a panel with the draws and triangles of
+/// 	the last frame. Every sprite of the overlay goes through the sprite batch, the panel is
+/// 	drawn with the white cell of the font atlas, so it all takes a single draw.
+/// </summary>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool GraphicsClass::RenderOverlay()
+{
+	D3DXMATRIX orthoMatrix;
+	D3D11_VIEWPORT viewport;
+	RenderStats stats;
+	const TextLayout* layout;
+	char text[128];
+	bool result;
+
+	PROFILE_FUNCTION();
+
+	// The counters of this frame are still being added, show those of the last one.
+	RenderStatsClass::GetFrameStats(stats);
+	LOG_SNPRINTF(text, sizeof(text), "Draws %llu\nTriangles %llu", stats.values[RENDER_COUNTER_DRAW_CALLS], stats.values[RENDER_COUNTER_PRIMITIVES]);
+
+	layout = &m_Font.GetLayout(text);
+
+	m_SpriteBatch.Begin();
+	m_SpriteBatch.DrawRectangle(&m_Font, OVERLAY_MARGIN, OVERLAY_MARGIN, layout->width + OVERLAY_PADDING * 2.0f, layout->height + OVERLAY_PADDING * 2.0f, OVERLAY_PANEL_COLOR);
+	m_SpriteBatch.DrawString(&m_Font, text, OVERLAY_MARGIN + OVERLAY_PADDING, OVERLAY_MARGIN + OVERLAY_PADDING, OVERLAY_TEXT_COLOR, 1);
+	m_SpriteBatch.End();
+
+	// Draw over the scene, whatever its depth, blended by the alpha of the sprites.
+	m_D3D->GetOrthoMatrix(orthoMatrix);
+	m_D3D->GetViewport(viewport);
+	m_D3D->TurnZBufferOff();
+	m_D3D->TurnOnAlphaBlending();
+
+	result = m_SpriteRenderer->Render(m_D3D->GetDeviceContext(), &m_SpriteBatch, m_ColorShader, orthoMatrix, (int)viewport.Width, (int)viewport.Height);
+
+	m_D3D->TurnOffAlphaBlending();
+	m_D3D->TurnZBufferOn();
+
+	// The sprite ring replaced the pool buffers on the pipeline.
+	m_GeometryPool->InvalidateBindings();
+
+	// Forget the strings that weren't drawn this frame.
+	m_Font.EndFrame();
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the nearest entity under a point of the screen, seen from the camera of the last frame. </summary>
+///
+/// <param name="screenX"> The x of the point, in pixels from the left. </param>
+/// <param name="screenY"> The y of the point, in pixels from the top. </param>
+/// <param name="hit">	   [out] The hit. </param>
+///
+/// <returns> true if there is an entity under the point. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool GraphicsClass::Pick(int screenX, int screenY, SceneQueryHit& hit)
+{
+	PROFILE_FUNCTION();
+
+	return m_SceneQuery->Pick((float)screenX, (float)screenY, m_D3D, m_Camera, hit);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the ray casts against the entities, for the rays of the game. </summary>
+///
+/// <returns> The scene queries. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneQueryClass* GraphicsClass::GetSceneQuery()
+{
+	return m_SceneQuery;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Merges the static scenery into the batch, throwing away what was merged before. Runs at
+/// 	startup and again every time a model it holds a copy of is swapped in.
+/// </summary>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool GraphicsClass::BuildStaticBatch()
+{
+	StaticBatchStats stats;
+	GeometryPoolStats poolStats;
+	bool result;
+
+	// Release the chunks of the previous build.
+	m_StaticBatch->Shutdown();
+
+	// Initialize the static batch object. The scenery that never moves is merged into chunks at load time.
+	result = m_StaticBatch->Initialize(m_GeometryPool, STATIC_BATCH_CELL_SIZE, GEOMETRY_PAGE_VERTICES);
+	if(!result)
+	{
+		return false;
+	}
+
+	// Add every entity tagged static and merge.
+	result = m_RenderSystem->BuildStaticBatch(m_StaticBatch);
+	if(!result)
+	{
+		LOG_ERROR(LOG_CATEGORY_RENDER, "Could not batch the static models.");
+		return false;
+	}
+
+	result = m_StaticBatch->Build();
+	if(!result)
+	{
+		LOG_ERROR(LOG_CATEGORY_RENDER, "Could not batch the static models.");
+		return false;
+	}
+
+	// Report what the merge saves in draws and what it costs in duplicated geometry.
+	m_StaticBatch->GetStats(stats);
+	LOG_INFO(LOG_CATEGORY_RENDER, "Static batch merged %d instances, %d draws, into %d chunks: %llu bytes of source geometry, %llu batched, %llu duplicated.",
+		stats.instances, stats.drawsBefore, stats.chunks, stats.sourceBytes, stats.batchedBytes, stats.duplicatedBytes);
+
+	// The chunks of the previous build and the geometry swapped out leave holes in the pool, pack it once they are most of its free space.
+	m_GeometryPool->GetStats(poolStats);
+	if(poolStats.vertexFragmentation > GEOMETRY_DEFRAGMENT_THRESHOLD || poolStats.indexFragmentation > GEOMETRY_DEFRAGMENT_THRESHOLD)
+	{
+		if(m_GeometryPool->Defragment())
+		{
+			m_GeometryPool->GetStats(poolStats);
+		}
+		else
+		{
+			LOG_WARNING(LOG_CATEGORY_RENDER, "Could not defragment the geometry pool.");
+		}
+	}
+
+	LOG_INFO(LOG_CATEGORY_RENDER, "Geometry pool: %u meshes in %u pages, %.1f%% of the free vertices and %.1f%% of the free indices fragmented, %lu defragmentations.",
+		poolStats.allocations, poolStats.pages, poolStats.vertexFragmentation * 100.0f, poolStats.indexFragmentation * 100.0f, poolStats.defragmentations);
+
 	return true;
 }
\ No newline at end of file
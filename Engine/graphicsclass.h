@@ -10,7 +10,29 @@
 #include "d3dclass.h"
 #include "cameraclass.h"
 #include "modelclass.h"
+#include "textureclass.h"
 #include "colorshaderclass.h"
+#include "poolallocatorclass.h"
+#include "geometrypoolclass.h"
+#include "frustumclass.h"
+#include "staticbatchclass.h"
+#include "sceneclass.h"
+#include "entitymanagerclass.h"
+#include "rendersystemclass.h"
+#include "occlusioncullerclass.h"
+#include "scenequeryclass.h"
+#include "taskgraphclass.h"
+#include "assetloaderclass.h"
+#include "fontclass.h"
+#include "spritebatchclass.h"
+#include "spriterendererclass.h"
+#include "debugdrawrendererclass.h"
+#include "profilerclass.h"
+#include "logclass.h"
+
+// Globals.
+const int SHADER_COUNT = 1;
+const int COLOR_SHADER_ID = 0;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// <summary>
@@ -28,18 +50,43 @@ public:
 	GraphicsClass(const GraphicsClass&);
 	~GraphicsClass();
 
-	bool Initialize(int, int, HWND);
+	bool Initialize(int, int, HWND, FileSystemClass*);
 	void Shutdown();
 	bool Frame();
+	bool Pick(int, int, SceneQueryHit&);
+	SceneQueryClass* GetSceneQuery();
 
 private:
 	bool Render();
+	bool BuildStaticBatch();
+	bool RenderOverlay();
+	bool RenderDebugDraw(D3DXMATRIX, D3DXMATRIX);
 
 private:
+	PoolAllocatorClass m_ObjectPool;
 	D3DClass* m_D3D;
+	GeometryPoolClass* m_GeometryPool;
 	CameraClass* m_Camera;
 	ModelClass* m_Model;
+	TextureClass* m_Texture;
 	ColorShaderClass* m_ColorShader;
+	FrustumClass* m_Frustum;
+	StaticBatchClass* m_StaticBatch;
+	SceneClass* m_Scene;
+	EntityManagerClass* m_Entities;
+	RenderSystemClass* m_RenderSystem;
+	OcclusionCullerClass* m_Occlusion;
+	SceneQueryClass* m_SceneQuery;
+	TextureClass* m_FontTexture;
+	SpriteRendererClass* m_SpriteRenderer;
+	DebugDrawRendererClass* m_DebugDrawRenderer;
+	ColorShaderClass* m_Shaders[SHADER_COUNT];
+	AssetLoaderClass m_AssetLoader;
+	int m_modelAsset;
+	TextureFileClass m_TextureFile;
+	EntityId m_modelEntity;
+	FontClass m_Font;
+	SpriteBatchClass m_SpriteBatch;
 
 };
 
@@ -48,5 +95,23 @@ const bool FULL_SCREEN = false;
 const bool VSYNC_ENABLED = true;
 const float SCREEN_DEPTH = 1000.0f;
 const float SCREEN_NEAR = 0.1f;
+const int OBJECT_POOL_SIZE = 24; // 16 objects in a debug build, the rest is room to add more.
+const unsigned int GEOMETRY_PAGE_VERTICES = 256 * 1024;
+const unsigned int GEOMETRY_PAGE_INDICES = 768 * 1024;
+const float GEOMETRY_DEFRAGMENT_THRESHOLD = 0.5f;
+const float STATIC_BATCH_CELL_SIZE = 64.0f;
+const char* const STARTUP_TIMELINE_FILE = "startup-timeline.txt";
+const char* const MODEL_FILE = "cube.txt";
+const char* const TEXTURE_FILE = "cube.dds";
+const float OVERLAY_MARGIN = 8.0f;
+const float OVERLAY_PADDING = 6.0f;
+const float OVERLAY_PANEL_COLOR[4] = { 0.0f, 0.0f, 0.0f, 0.5f };
+const float OVERLAY_TEXT_COLOR[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+const bool DEBUG_DRAW_BVH = true;
+const float DEBUG_DRAW_AXES_SIZE = 2.0f;
+const float DEBUG_DRAW_NODE_COLOR[4] = { 1.0f, 1.0f, 0.0f, 1.0f };
+const float DEBUG_DRAW_OBJECT_COLOR[4] = { 0.0f, 1.0f, 1.0f, 1.0f };
+const float DEBUG_DRAW_STATIC_NODE_COLOR[4] = { 1.0f, 0.5f, 0.0f, 1.0f };
+const float DEBUG_DRAW_STATIC_OBJECT_COLOR[4] = { 1.0f, 0.0f, 1.0f, 1.0f };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	headlessplatformclass.cpp
+//
+// summary:	Implements the headlessplatformclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "headlessplatformclass.h"
+
+// System Includes.
+#include <cmath>
+
+// Globals.
+// The keys the script taps in turn, what a user moving the camera would press.
+static const unsigned int HeadlessKeys[] = { 'W', 'A', 'S', 'D', PLATFORM_KEY_LEFT, PLATFORM_KEY_UP, PLATFORM_KEY_RIGHT, PLATFORM_KEY_DOWN, PLATFORM_KEY_SPACE };
+static const unsigned int HeadlessKeyCount = sizeof(HeadlessKeys) / sizeof(HeadlessKeys[0]);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+HeadlessPlatformClass::HeadlessPlatformClass()
+{
+	m_frameLimit = HEADLESS_DEFAULT_FRAMES;
+	m_frame = 0;
+	m_frameStarted = false;
+	m_width = 0;
+	m_height = 0;
+	m_baseWidth = 0;
+	m_baseHeight = 0;
+	m_heldKey = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+HeadlessPlatformClass::HeadlessPlatformClass(const HeadlessPlatformClass& other) : PlatformClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+HeadlessPlatformClass::~HeadlessPlatformClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets how many frames run before the quit event. </summary>
+///
+/// <param name="frames"> The frame count, 0 to run until something else ends the loop. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void HeadlessPlatformClass::SetFrameLimit(unsigned int frames)
+{
+	m_frameLimit = frames;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Picks the size of the imaginary window and queues its first resize and focus. </summary>
+///
+/// <param name="fullScreen">   true to use a desktop sized window. </param>
+/// <param name="screenWidth">  [out] Width of the screen. </param>
+/// <param name="screenHeight"> [out] Height of the screen. </param>
+///
+/// <returns> true. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HeadlessPlatformClass::Initialize(bool fullScreen, int& screenWidth, int& screenHeight)
+{
+	m_baseWidth = fullScreen ? HEADLESS_FULL_SCREEN_WIDTH : HEADLESS_WIDTH;
+	m_baseHeight = fullScreen ? HEADLESS_FULL_SCREEN_HEIGHT : HEADLESS_HEIGHT;
+	m_width = m_baseWidth;
+	m_height = m_baseHeight;
+	m_frame = 0;
+	m_frameStarted = false;
+	m_heldKey = 0;
+
+	// A real window gets these when it is created.
+	PushEvent(PLATFORM_EVENT_RESIZE, 0, m_width, m_height);
+	PushEvent(PLATFORM_EVENT_FOCUS, 1, 0, 0);
+
+	screenWidth = m_width;
+	screenHeight = m_height;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Nothing to release. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void HeadlessPlatformClass::Shutdown()
+{
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the next event, making up the events of the frame on its first call. </summary>
+///
+/// <param name="event"> [out] The event. </param>
+///
+/// <returns> true if there was an event, false when the frame has none left. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool HeadlessPlatformClass::PollEvent(PlatformEvent& event)
+{
+	if(!m_frameStarted)
+	{
+		SynthesizeFrame();
+		m_frameStarted = true;
+	}
+
+	if(PopEvent(event))
+	{
+		return true;
+	}
+
+	// The frame is drained, the next call starts the next one.
+	m_frameStarted = false;
+	m_frame++;
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> There is no window to render to. </summary>
+///
+/// <returns> Always 0. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void* HeadlessPlatformClass::GetWindowHandle()
+{
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Queues the events of the current frame. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void HeadlessPlatformClass::SynthesizeFrame()
+{
+	float angle;
+
+	if(m_frameLimit && m_frame >= m_frameLimit)
+	{
+		PushEvent(PLATFORM_EVENT_QUIT, 0, 0, 0);
+		return;
+	}
+
+	// Lose the focus for one frame every now and then, like an alt-tab.
+	if(m_frame > 0 && m_frame % HEADLESS_FOCUS_PERIOD == 0)
+	{
+		PushEvent(PLATFORM_EVENT_FOCUS, 0, 0, 0);
+	}
+	else if(m_frame > 1 && m_frame % HEADLESS_FOCUS_PERIOD == 1)
+	{
+		PushEvent(PLATFORM_EVENT_FOCUS, 1, 0, 0);
+	}
+
+	// Shrink and restore the window.
+	if(m_frame > 0 && m_frame % HEADLESS_RESIZE_PERIOD == 0)
+	{
+		m_width = m_width == m_baseWidth ? m_baseWidth * 3 / 4 : m_baseWidth;
+		m_height = m_height == m_baseHeight ? m_baseHeight * 3 / 4 : m_baseHeight;
+		PushEvent(PLATFORM_EVENT_RESIZE, 0, m_width, m_height);
+	}
+
+	// The cursor circles the middle of the client area.
+	angle = (float)m_frame * 0.05f;
+	PushEvent(PLATFORM_EVENT_MOUSE_MOVE, 0, m_width / 2 + (int)((float)(m_width / 3) * cosf(angle)), m_height / 2 + (int)((float)(m_height / 3) * sinf(angle)));
+
+	// Hold a key for a few frames. Windows repeats the down message while a key is held, so do the same.
+	if(m_frame % HEADLESS_KEY_PERIOD == 0)
+	{
+		m_heldKey = HeadlessKeys[(m_frame / HEADLESS_KEY_PERIOD) % HeadlessKeyCount];
+	}
+
+	if(m_heldKey)
+	{
+		if(m_frame % HEADLESS_KEY_PERIOD == HEADLESS_KEY_HOLD)
+		{
+			PushEvent(PLATFORM_EVENT_KEY_UP, m_heldKey, 0, 0);
+			m_heldKey = 0;
+		}
+		else
+		{
+			PushEvent(PLATFORM_EVENT_KEY_DOWN, m_heldKey, 0, 0);
+		}
+	}
+
+	// A click, down and up inside the same frame.
+	if(m_frame % HEADLESS_CLICK_PERIOD == HEADLESS_CLICK_PERIOD - 1)
+	{
+		PushEvent(PLATFORM_EVENT_KEY_DOWN, PLATFORM_KEY_LBUTTON, 0, 0);
+		PushEvent(PLATFORM_EVENT_KEY_UP, PLATFORM_KEY_LBUTTON, 0, 0);
+	}
+
+	// A notch of the wheel, away and back.
+	if(m_frame % HEADLESS_WHEEL_PERIOD == HEADLESS_WHEEL_PERIOD / 2)
+	{
+		PushEvent(PLATFORM_EVENT_MOUSE_WHEEL, 0, (m_frame / HEADLESS_WHEEL_PERIOD) % 2 ? -120 : 120, 0);
+	}
+
+	return;
+}
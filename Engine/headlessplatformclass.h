@@ -0,0 +1,62 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	headlessplatformclass.h
+//
+// summary:	Declares the headlessplatformclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _HEADLESSPLATFORMCLASS_H_
+#define _HEADLESSPLATFORMCLASS_H_
+
+// Includes.
+#include "platformclass.h"
+
+// Globals.
+const int HEADLESS_WIDTH = 800;
+const int HEADLESS_HEIGHT = 600;
+const int HEADLESS_FULL_SCREEN_WIDTH = 1920;
+const int HEADLESS_FULL_SCREEN_HEIGHT = 1080;
+const unsigned int HEADLESS_DEFAULT_FRAMES = 1000;
+const unsigned int HEADLESS_KEY_PERIOD = 30;
+const unsigned int HEADLESS_KEY_HOLD = 10;
+const unsigned int HEADLESS_CLICK_PERIOD = 45;
+const unsigned int HEADLESS_WHEEL_PERIOD = 60;
+const unsigned int HEADLESS_RESIZE_PERIOD = 600;
+const unsigned int HEADLESS_FOCUS_PERIOD = 900;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The headless backend of the platform layer, for the perf machines and the CI, where
+/// 	there is no display. It has no window; instead every frame it makes up the events a
+/// 	user would cause: the cursor circling the client area, keys tapped and held, clicks,
+/// 	wheel turns, and now and then a resize or a focus loss. The script only depends on the
+/// 	frame number, so every run gets the same events. After the frame limit it sends a quit.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class HeadlessPlatformClass : public PlatformClass
+{
+public:
+	HeadlessPlatformClass();
+	HeadlessPlatformClass(const HeadlessPlatformClass&);
+	~HeadlessPlatformClass();
+
+	void SetFrameLimit(unsigned int);
+
+	bool Initialize(bool, int&, int&);
+	void Shutdown();
+	bool PollEvent(PlatformEvent&);
+	void* GetWindowHandle();
+
+private:
+	void SynthesizeFrame();
+
+private:
+	unsigned int m_frameLimit;
+	unsigned int m_frame;
+	bool m_frameStarted;
+	int m_width;
+	int m_height;
+	int m_baseWidth;
+	int m_baseHeight;
+	unsigned int m_heldKey;
+};
+
+#endif
@@ -5,6 +5,12 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 #include "inputclass.h"
 
+// System Includes.
+#include <cstring>
+
+// Includes.
+#include "profilerclass.h"
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// <summary> Default constructor. </summary>
 ///
@@ -12,6 +18,11 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 InputClass::InputClass()
 {
+	m_write.store(0);
+	m_read.store(0);
+	m_dropped.store(0);
+	m_frameEventCount = 0;
+	m_latencyTotalMs = 0.0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -35,50 +46,195 @@ InputClass::~InputClass()
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-/// <summary> Initialize all the keys to being released and not pressed. </summary>
+/// <summary> Initialize all the keys to being released and not pressed, and empty the queue. </summary>
 ///
 /// <remarks> Filipe, 25 Nov 2012. </remarks>
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 void InputClass::Initialize()
 {
-	int i;
-	
-	for(i=0; i<256; i++)
-	{
-		m_keys[i] = false;
-	}
+	memset(&m_state, 0, sizeof(InputState));
+	memset(&m_latency, 0, sizeof(InputLatency));
+	m_latencyTotalMs = 0.0;
+	m_frameEventCount = 0;
+
+	m_write.store(0);
+	m_read.store(0);
+	m_dropped.store(0);
 
 	return;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-/// <summary> If a key is pressed then save that state in the key array. </summary>
+/// <summary> Queues a key (or mouse button) press. </summary>
 ///
 /// <remarks> Filipe, 25 Nov 2012. </remarks>
 ///
-/// <param name="input"> The input. </param>
+/// <param name="input"> The virtual key code. </param>
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 void InputClass::KeyDown(unsigned int input)
 {
-	m_keys[input] = true;
+	InputEvent event;
+
+	memset(&event, 0, sizeof(InputEvent));
+	event.timestamp = ProfilerClass::GetTimestamp();
+	event.type = INPUT_EVENT_KEY_DOWN;
+	event.code = (unsigned short)input;
+	PushEvent(event);
+
 	return;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-/// <summary> If a key is released then clear that state in the key array. </summary>
+/// <summary> Queues a key (or mouse button) release. </summary>
 ///
 /// <remarks> Filipe, 25 Nov 2012. </remarks>
 ///
-/// <param name="input"> The input. </param>
+/// <param name="input"> The virtual key code. </param>
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 void InputClass::KeyUp(unsigned int input)
 {
-	m_keys[input] = false;
+	InputEvent event;
+
+	memset(&event, 0, sizeof(InputEvent));
+	event.timestamp = ProfilerClass::GetTimestamp();
+	event.type = INPUT_EVENT_KEY_UP;
+	event.code = (unsigned short)input;
+	PushEvent(event);
+
 	return;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-/// <summary> Return what state the key is in (pressed/not pressed). </summary>
+/// <summary> Queues a new cursor position. </summary>
+///
+/// <param name="x"> The x coordinate in client pixels. </param>
+/// <param name="y"> The y coordinate in client pixels. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputClass::MouseMove(int x, int y)
+{
+	InputEvent event;
+
+	memset(&event, 0, sizeof(InputEvent));
+	event.timestamp = ProfilerClass::GetTimestamp();
+	event.type = INPUT_EVENT_MOUSE_MOVE;
+	event.x = x;
+	event.y = y;
+	PushEvent(event);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Queues a mouse wheel turn. </summary>
+///
+/// <param name="delta"> The wheel delta, 120 per notch. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputClass::MouseWheel(int delta)
+{
+	InputEvent event;
+
+	memset(&event, 0, sizeof(InputEvent));
+	event.timestamp = ProfilerClass::GetTimestamp();
+	event.type = INPUT_EVENT_MOUSE_WHEEL;
+	event.x = delta;
+	PushEvent(event);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Queues a new value for an analog axis. </summary>
+///
+/// <param name="axis">  The axis, below INPUT_MAX_AXES. </param>
+/// <param name="value"> The value. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputClass::SetAxis(unsigned int axis, float value)
+{
+	InputEvent event;
+
+	memset(&event, 0, sizeof(InputEvent));
+	event.timestamp = ProfilerClass::GetTimestamp();
+	event.type = INPUT_EVENT_AXIS;
+	event.code = (unsigned short)axis;
+	event.value = value;
+	PushEvent(event);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Puts an event in the queue. Only the producer thread may call this. </summary>
+///
+/// <param name="event"> The event. </param>
+///
+/// <returns> true if it succeeds, false if the queue is full and the event was dropped. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputClass::PushEvent(const InputEvent& event)
+{
+	unsigned int write;
+
+	write = m_write.load(memory_order_relaxed);
+	if(write - m_read.load(memory_order_acquire) >= INPUT_QUEUE_SIZE)
+	{
+		m_dropped.fetch_add(1, memory_order_relaxed);
+		return false;
+	}
+
+	m_queue[write & (INPUT_QUEUE_SIZE - 1)] = event;
+
+	// Publish the event to the consumer.
+	m_write.store(write + 1, memory_order_release);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Starts a new input frame. Clears the edges and deltas of the last frame, then consumes
+/// 	every queued event in order. Only the consumer thread may call this.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputClass::Update()
+{
+	unsigned long long now;
+	unsigned int read, write;
+	float latency;
+
+	memset(m_state.pressed, 0, sizeof(m_state.pressed));
+	memset(m_state.released, 0, sizeof(m_state.released));
+	m_state.mouseDeltaX = 0;
+	m_state.mouseDeltaY = 0;
+	m_state.wheelDelta = 0;
+	m_frameEventCount = 0;
+	m_latency.lastFrameMaxMs = 0.0f;
+
+	now = ProfilerClass::GetTimestamp();
+
+	write = m_write.load(memory_order_acquire);
+	read = m_read.load(memory_order_relaxed);
+	for(; read != write; read++)
+	{
+		const InputEvent& event = m_queue[read & (INPUT_QUEUE_SIZE - 1)];
+
+		ApplyEvent(event);
+		m_frameEvents[m_frameEventCount++] = event;
+
+		// The time the event spent waiting for the simulation.
+		latency = now > event.timestamp ? (float)ProfilerClass::TicksToMilliseconds(now - event.timestamp) : 0.0f;
+		m_latency.lastFrameMaxMs = latency > m_latency.lastFrameMaxMs ? latency : m_latency.lastFrameMaxMs;
+		m_latency.maxMs = latency > m_latency.maxMs ? latency : m_latency.maxMs;
+		m_latencyTotalMs += latency;
+		m_latency.events++;
+	}
+
+	// Hand the slots back to the producer.
+	m_read.store(write, memory_order_release);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Return if the key was down at the end of the last Update. </summary>
 ///
 /// <remarks> Filipe, 25 Nov 2012. </remarks>
 ///
@@ -88,5 +244,198 @@ void InputClass::KeyUp(unsigned int input)
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 bool InputClass::IsKeyDown(unsigned int key)
 {
-	return m_keys[key];
-}
\ No newline at end of file
+	if(key >= INPUT_KEY_COUNT)
+	{
+		return false;
+	}
+
+	return (m_state.down[key >> 5] & (1u << (key & 31))) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Return if the key went down during the frame. Key repeats don't count. </summary>
+///
+/// <param name="key"> The key. </param>
+///
+/// <returns> true if key pressed this frame, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputClass::IsKeyPressed(unsigned int key)
+{
+	if(key >= INPUT_KEY_COUNT)
+	{
+		return false;
+	}
+
+	return (m_state.pressed[key >> 5] & (1u << (key & 31))) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Return if the key went up during the frame. </summary>
+///
+/// <param name="key"> The key. </param>
+///
+/// <returns> true if key released this frame, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputClass::IsKeyReleased(unsigned int key)
+{
+	if(key >= INPUT_KEY_COUNT)
+	{
+		return false;
+	}
+
+	return (m_state.released[key >> 5] & (1u << (key & 31))) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the cursor position at the end of the frame. </summary>
+///
+/// <param name="x"> [out] The x coordinate. </param>
+/// <param name="y"> [out] The y coordinate. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputClass::GetMousePosition(int& x, int& y)
+{
+	x = m_state.mouseX;
+	y = m_state.mouseY;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets how far the cursor moved during the frame. </summary>
+///
+/// <param name="x"> [out] The x movement. </param>
+/// <param name="y"> [out] The y movement. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputClass::GetMouseDelta(int& x, int& y)
+{
+	x = m_state.mouseDeltaX;
+	y = m_state.mouseDeltaY;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets how far the wheel turned during the frame. </summary>
+///
+/// <returns> The wheel delta, 120 per notch. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int InputClass::GetWheelDelta()
+{
+	return m_state.wheelDelta;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the value of an axis at the end of the frame. </summary>
+///
+/// <param name="axis"> The axis. </param>
+///
+/// <returns> The value, 0 for unknown axes. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+float InputClass::GetAxis(unsigned int axis)
+{
+	if(axis >= INPUT_MAX_AXES)
+	{
+		return 0.0f;
+	}
+
+	return m_state.axes[axis];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies the whole input state of the frame, to hand it to another system. </summary>
+///
+/// <param name="state"> [out] The state. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputClass::GetState(InputState& state)
+{
+	state = m_state;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the events consumed by the last Update, in the order they happened. </summary>
+///
+/// <param name="count"> [out] The number of events. </param>
+///
+/// <returns> The events. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const InputEvent* InputClass::GetFrameEvents(int& count)
+{
+	count = m_frameEventCount;
+
+	return m_frameEvents;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the time events waited between the producer and Update. </summary>
+///
+/// <param name="latency"> [out] The latency statistics. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputClass::GetLatency(InputLatency& latency)
+{
+	latency = m_latency;
+	latency.averageMs = m_latency.events ? (float)(m_latencyTotalMs / (double)m_latency.events) : 0.0f;
+	latency.dropped = m_dropped.load(memory_order_relaxed);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Applies one event to the frame state. </summary>
+///
+/// <param name="event"> The event. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputClass::ApplyEvent(const InputEvent& event)
+{
+	unsigned int word, bit;
+
+	word = (event.code >> 5) & (INPUT_KEY_WORDS - 1);
+	bit = 1u << (event.code & 31);
+
+	switch(event.type)
+	{
+		case INPUT_EVENT_KEY_DOWN:
+			if(event.code < INPUT_KEY_COUNT)
+			{
+				// Held keys repeat their down message, only the first one is an edge.
+				if(!(m_state.down[word] & bit))
+				{
+					m_state.pressed[word] |= bit;
+				}
+				m_state.down[word] |= bit;
+			}
+			break;
+
+		case INPUT_EVENT_KEY_UP:
+			if(event.code < INPUT_KEY_COUNT)
+			{
+				if(m_state.down[word] & bit)
+				{
+					m_state.released[word] |= bit;
+				}
+				m_state.down[word] &= ~bit;
+			}
+			break;
+
+		case INPUT_EVENT_MOUSE_MOVE:
+			m_state.mouseDeltaX += event.x - m_state.mouseX;
+			m_state.mouseDeltaY += event.y - m_state.mouseY;
+			m_state.mouseX = event.x;
+			m_state.mouseY = event.y;
+			break;
+
+		case INPUT_EVENT_MOUSE_WHEEL:
+			m_state.wheelDelta += event.x;
+			break;
+
+		case INPUT_EVENT_AXIS:
+			if(event.code < INPUT_MAX_AXES)
+			{
+				m_state.axes[event.code] = event.value;
+			}
+			break;
+	}
+
+	return;
+}
@@ -6,12 +6,83 @@
 #ifndef _INPUTCLASS_H_
 #define _INPUTCLASS_H_
 
+// System Includes.
+#include <atomic>
+using namespace std;
+
+// Globals.
+const int INPUT_KEY_COUNT = 256;
+const int INPUT_KEY_WORDS = INPUT_KEY_COUNT / 32;
+const int INPUT_MAX_AXES = 8;
+const unsigned int INPUT_QUEUE_SIZE = 256;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the input event types. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum InputEventType
+{
+	INPUT_EVENT_KEY_DOWN,
+	INPUT_EVENT_KEY_UP,
+	INPUT_EVENT_MOUSE_MOVE,
+	INPUT_EVENT_MOUSE_WHEEL,
+	INPUT_EVENT_AXIS
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	One input event. Keys and mouse buttons use the windows virtual key codes, a mouse move
+/// 	keeps the cursor position in x and y, a wheel event its delta in x, and an axis event
+/// 	the axis in code and its value.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct InputEvent
+{
+	unsigned long long timestamp;
+	unsigned short type;
+	unsigned short code;
+	int x;
+	int y;
+	float value;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The input of one frame. Keys are packed one bit each: down is the state at the end of the
+/// 	frame, pressed and released are the edges seen during it, so a key tapped inside a single
+/// 	frame is pressed and released without ever being down.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct InputState
+{
+	unsigned int down[INPUT_KEY_WORDS];
+	unsigned int pressed[INPUT_KEY_WORDS];
+	unsigned int released[INPUT_KEY_WORDS];
+	int mouseX;
+	int mouseY;
+	int mouseDeltaX;
+	int mouseDeltaY;
+	int wheelDelta;
+	float axes[INPUT_MAX_AXES];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> How long events waited in the queue before the simulation consumed them. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct InputLatency
+{
+	float lastFrameMaxMs;
+	float averageMs;
+	float maxMs;
+	unsigned long long events;
+	unsigned long dropped;
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// <summary>
-/// 	The input class handles the user input from the keyboard. This class is given input from
-/// 	the SystemClass::MessageHandler function. The input object will store the state of each
-/// 	key in a keyboard array. When queried it will tell the calling functions if a certain key
-/// 	is pressed.
+/// 	The input class handles the user input from the keyboard and mouse. The
+/// 	SystemClass::MessageHandler function pushes time stamped events into a single producer,
+/// 	single consumer queue, and the simulation calls Update once per frame to consume them into
+/// 	the InputState of that frame. The producer and the consumer may be different threads.
 /// </summary>
 ///
 /// <remarks> Filipe, 25 Nov 2012. </remarks>
@@ -25,13 +96,42 @@ public:
 
 	void Initialize();
 
+	// Producer side, the thread pumping the os messages.
 	void KeyDown(unsigned int);
 	void KeyUp(unsigned int);
+	void MouseMove(int, int);
+	void MouseWheel(int);
+	void SetAxis(unsigned int, float);
+	bool PushEvent(const InputEvent&);
 
+	// Consumer side, the simulation.
+	void Update();
 	bool IsKeyDown(unsigned int);
+	bool IsKeyPressed(unsigned int);
+	bool IsKeyReleased(unsigned int);
+	void GetMousePosition(int&, int&);
+	void GetMouseDelta(int&, int&);
+	int GetWheelDelta();
+	float GetAxis(unsigned int);
+	void GetState(InputState&);
+	const InputEvent* GetFrameEvents(int&);
+	void GetLatency(InputLatency&);
 
 private:
-	bool m_keys[256];
+	void ApplyEvent(const InputEvent&);
+
+private:
+	InputEvent m_queue[INPUT_QUEUE_SIZE];
+	atomic<unsigned int> m_write;
+	atomic<unsigned int> m_read;
+	atomic<unsigned long> m_dropped;
+
+	InputState m_state;
+	InputEvent m_frameEvents[INPUT_QUEUE_SIZE];
+	int m_frameEventCount;
+
+	InputLatency m_latency;
+	double m_latencyTotalMs;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,299 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	inputrecorderclass.cpp
+//
+// summary:	Implements the inputrecorderclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "inputrecorderclass.h"
+
+// System Includes.
+#include <cstring>
+
+// Includes.
+#include "profilerclass.h"
+#include "logclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+InputRecorderClass::InputRecorderClass()
+{
+	m_mode = INPUT_RECORDER_OFF;
+	memset(&m_header, 0, sizeof(InputRecordHeader));
+	m_startTimestamp = 0;
+	m_nextRecord = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+InputRecorderClass::InputRecorderClass(const InputRecorderClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+InputRecorderClass::~InputRecorderClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Opens the recording, or does nothing when the recorder is off. </summary>
+///
+/// <param name="mode">		 The mode. </param>
+/// <param name="filename">  The recording file. </param>
+/// <param name="fixedStep"> The step the frame clock uses while recording, a replay takes it from the file. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputRecorderClass::Initialize(InputRecorderMode mode, const char* filename, double fixedStep)
+{
+	bool result;
+
+	m_mode = INPUT_RECORDER_OFF;
+	m_nextRecord = 0;
+	m_records.clear();
+
+	if(mode == INPUT_RECORDER_RECORD)
+	{
+		result = OpenRecording(filename, fixedStep);
+	}
+	else if(mode == INPUT_RECORDER_REPLAY)
+	{
+		result = OpenReplay(filename);
+	}
+	else
+	{
+		return true;
+	}
+
+	if(!result)
+	{
+		return false;
+	}
+
+	m_mode = mode;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Closes the recording. A recording gets its final frame and event counts. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void InputRecorderClass::Shutdown()
+{
+	if(m_mode == INPUT_RECORDER_RECORD)
+	{
+		m_file.seekp(0, ios::beg);
+		m_file.write((const char*)&m_header, sizeof(InputRecordHeader));
+		m_file.close();
+
+		LOG_INFO(LOG_CATEGORY_INPUT, "Recorded %u input events over %u frames.", m_header.events, m_header.frames);
+	}
+
+	m_records.clear();
+	m_mode = INPUT_RECORDER_OFF;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Appends the events the input object consumed in its last Update. </summary>
+///
+/// <param name="input"> The input object. </param>
+/// <param name="frame"> The index of the frame. </param>
+///
+/// <returns> true if it succeeds, false if the file could not be written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputRecorderClass::RecordFrame(InputClass* input, unsigned int frame)
+{
+	const InputEvent* events;
+	InputRecord record;
+	int count, i;
+
+	if(m_mode != INPUT_RECORDER_RECORD)
+	{
+		return true;
+	}
+
+	events = input->GetFrameEvents(count);
+	for(i=0; i<count; i++)
+	{
+		record.frame = frame;
+		record.time = events[i].timestamp > m_startTimestamp ? (unsigned int)(ProfilerClass::TicksToMilliseconds(events[i].timestamp - m_startTimestamp) * 1000.0) : 0;
+		record.type = (unsigned char)events[i].type;
+		record.code = events[i].code;
+		record.x = events[i].x;
+		record.y = events[i].y;
+		record.value = events[i].value;
+
+		m_file.write((const char*)&record, sizeof(InputRecord));
+	}
+
+	if(m_file.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_INPUT, "Could not write the input recording.");
+		return false;
+	}
+
+	m_header.frames = frame + 1;
+	m_header.events += count;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Pushes the recorded events of a frame into the input queue. </summary>
+///
+/// <param name="input"> The input object. </param>
+/// <param name="frame"> The index of the frame. </param>
+///
+/// <returns> true if the frame was replayed, false once the recording is over. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputRecorderClass::ReplayFrame(InputClass* input, unsigned int frame)
+{
+	InputEvent event;
+
+	if(m_mode != INPUT_RECORDER_REPLAY)
+	{
+		return true;
+	}
+
+	if(frame >= m_header.frames)
+	{
+		return false;
+	}
+
+	while(m_nextRecord < m_records.size() && m_records[m_nextRecord].frame <= frame)
+	{
+		const InputRecord& record = m_records[m_nextRecord++];
+
+		// Stamp it now, the latency is measured from when the event entered the queue.
+		event.timestamp = ProfilerClass::GetTimestamp();
+		event.type = record.type;
+		event.code = record.code;
+		event.x = record.x;
+		event.y = record.y;
+		event.value = record.value;
+
+		if(!input->PushEvent(event))
+		{
+			LOG_WARNING(LOG_CATEGORY_INPUT, "Replay dropped an input event in frame %u.", frame);
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if the input is being recorded. </summary>
+///
+/// <returns> true if recording, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputRecorderClass::IsRecording()
+{
+	return m_mode == INPUT_RECORDER_RECORD;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if a recording is being played back. </summary>
+///
+/// <returns> true if replaying, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputRecorderClass::IsReplaying()
+{
+	return m_mode == INPUT_RECORDER_REPLAY;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the step the frame clock must use. </summary>
+///
+/// <returns> The fixed step in seconds, 0 when the recorder is off. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double InputRecorderClass::GetFixedStep()
+{
+	return m_mode == INPUT_RECORDER_OFF ? 0.0 : m_header.fixedStep;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of frames recorded so far, or in the recording being replayed. </summary>
+///
+/// <returns> The frame count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned int InputRecorderClass::GetFrameCount()
+{
+	return m_header.frames;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates the recording file and writes a header to fill in later. </summary>
+///
+/// <param name="filename">  The recording file. </param>
+/// <param name="fixedStep"> The step of the frame clock. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputRecorderClass::OpenRecording(const char* filename, double fixedStep)
+{
+	memset(&m_header, 0, sizeof(InputRecordHeader));
+	memcpy(m_header.magic, INPUT_RECORD_MAGIC, sizeof(m_header.magic));
+	m_header.version = INPUT_RECORD_VERSION;
+	m_header.fixedStep = fixedStep;
+
+	m_file.open(filename, ios::out | ios::binary | ios::trunc);
+	if(m_file.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_INPUT, "Could not create the input recording %s.", filename);
+		return false;
+	}
+
+	m_file.write((const char*)&m_header, sizeof(InputRecordHeader));
+	m_startTimestamp = ProfilerClass::GetTimestamp();
+
+	LOG_INFO(LOG_CATEGORY_INPUT, "Recording input to %s at a %.2f ms step.", filename, fixedStep * 1000.0);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads a whole recording, so the replay never touches the disk during a frame. </summary>
+///
+/// <param name="filename"> The recording file. </param>
+///
+/// <returns> true if it succeeds, false if the file is missing or not a recording. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool InputRecorderClass::OpenReplay(const char* filename)
+{
+	ifstream fin;
+
+	fin.open(filename, ios::in | ios::binary);
+	if(fin.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_INPUT, "Could not open the input recording %s.", filename);
+		return false;
+	}
+
+	fin.read((char*)&m_header, sizeof(InputRecordHeader));
+	if(fin.fail() || memcmp(m_header.magic, INPUT_RECORD_MAGIC, sizeof(m_header.magic)) != 0 || m_header.version != INPUT_RECORD_VERSION || m_header.fixedStep <= 0.0)
+	{
+		LOG_ERROR(LOG_CATEGORY_INPUT, "%s is not an input recording this build can replay.", filename);
+		return false;
+	}
+
+	m_records.resize(m_header.events);
+	if(m_header.events > 0)
+	{
+		fin.read((char*)&m_records[0], m_header.events * sizeof(InputRecord));
+		if(fin.fail())
+		{
+			LOG_ERROR(LOG_CATEGORY_INPUT, "The input recording %s is cut short.", filename);
+			return false;
+		}
+	}
+
+	LOG_INFO(LOG_CATEGORY_INPUT, "Replaying %u input events over %u frames from %s.", m_header.events, m_header.frames, filename);
+
+	return true;
+}
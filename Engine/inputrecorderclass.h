@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	inputrecorderclass.h
+//
+// summary:	Declares the inputrecorderclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _INPUTRECORDERCLASS_H_
+#define _INPUTRECORDERCLASS_H_
+
+// System Includes.
+#include <fstream>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "inputclass.h"
+
+// Globals.
+const char INPUT_RECORD_MAGIC[4] = { 'E', 'I', 'N', 'R' };
+const unsigned int INPUT_RECORD_VERSION = 1;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent what the input recorder does. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum InputRecorderMode
+{
+	INPUT_RECORDER_OFF,
+	INPUT_RECORDER_RECORD,
+	INPUT_RECORDER_REPLAY
+};
+
+// The file layout, written as is (little endian, no padding).
+#pragma pack(push, 1)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The start of an input recording. Frames and events are filled in on Shutdown. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct InputRecordHeader
+{
+	char magic[4];
+	unsigned int version;
+	double fixedStep;
+	unsigned int frames;
+	unsigned int events;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	One recorded event, in the order they were consumed. Time is in microseconds since the
+/// 	recording started, kept to look at the original pacing; the replay only uses the frame.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct InputRecord
+{
+	unsigned int frame;
+	unsigned int time;
+	unsigned char type;
+	unsigned short code;
+	int x;
+	int y;
+	float value;
+};
+
+#pragma pack(pop)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Records the input of every frame to a file, or plays a recording back. Recording saves
+/// 	what InputClass::Update consumed in each frame, tagged with the frame index; the replay
+/// 	pushes the events of each frame back into the input queue right before Update, in place
+/// 	of the window messages. Both run the frame clock at the fixed step kept in the header,
+/// 	so a replay does the same work in every run and only the engine build changes the
+/// 	frame times.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class InputRecorderClass
+{
+public:
+	InputRecorderClass();
+	InputRecorderClass(const InputRecorderClass&);
+	~InputRecorderClass();
+
+	bool Initialize(InputRecorderMode, const char*, double);
+	void Shutdown();
+
+	bool RecordFrame(InputClass*, unsigned int);
+	bool ReplayFrame(InputClass*, unsigned int);
+
+	bool IsRecording();
+	bool IsReplaying();
+	double GetFixedStep();
+	unsigned int GetFrameCount();
+
+private:
+	bool OpenRecording(const char*, double);
+	bool OpenReplay(const char*);
+
+private:
+	InputRecorderMode m_mode;
+	InputRecordHeader m_header;
+	ofstream m_file;
+	unsigned long long m_startTimestamp;
+	vector<InputRecord> m_records;
+	unsigned int m_nextRecord;
+};
+
+#endif
@@ -0,0 +1,290 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	linearallocatorclass.cpp
+//
+// summary:	Implements the linearallocatorclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "linearallocatorclass.h"
+
+// System Includes.
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+LinearAllocatorClass::LinearAllocatorClass()
+{
+	m_memory = 0;
+	m_base = 0;
+	m_capacity = 0;
+	m_offset = 0;
+	memset(&m_stats, 0, sizeof(AllocatorStats));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+LinearAllocatorClass::LinearAllocatorClass(const LinearAllocatorClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+LinearAllocatorClass::~LinearAllocatorClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Reserves the backing block. This is the only time the allocator touches the general
+/// 	purpose heap, every Allocate after this is served from the block.
+/// </summary>
+///
+/// <param name="capacity"> The size of the block in bytes. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LinearAllocatorClass::Initialize(size_t capacity)
+{
+	size_t misalignment;
+
+	// Over allocate so the base can be moved up to the default alignment.
+	m_memory = new char[capacity + DEFAULT_ALIGNMENT];
+	if(!m_memory)
+	{
+		return false;
+	}
+
+	misalignment = (size_t)m_memory & (DEFAULT_ALIGNMENT - 1);
+	m_base = m_memory + (misalignment ? DEFAULT_ALIGNMENT - misalignment : 0);
+
+	m_capacity = capacity;
+	m_offset = 0;
+
+	// Start the statistics from scratch.
+	memset(&m_stats, 0, sizeof(AllocatorStats));
+	m_stats.capacity = capacity;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the backing block. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinearAllocatorClass::Shutdown()
+{
+	if(m_memory)
+	{
+		delete [] m_memory;
+		m_memory = 0;
+	}
+
+	m_base = 0;
+	m_capacity = 0;
+	m_offset = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Hands out the next aligned slice of the block. </summary>
+///
+/// <param name="size">		 The size in bytes. </param>
+/// <param name="alignment"> The alignment, must be a power of two. </param>
+///
+/// <returns> The memory, or null if the block is exhausted. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void* LinearAllocatorClass::Allocate(size_t size, size_t alignment)
+{
+	size_t start;
+
+	// Round the current offset up to the requested alignment.
+	start = (m_offset + (alignment - 1)) & ~(alignment - 1);
+	if(!m_base || start + size > m_capacity)
+	{
+		m_stats.failedAllocations++;
+		return 0;
+	}
+
+	m_offset = start + size;
+
+	// Update the statistics.
+	m_stats.used = m_offset;
+	m_stats.allocationCount++;
+	m_stats.totalAllocations++;
+	if(m_offset > m_stats.peak)
+	{
+		m_stats.peak = m_offset;
+	}
+	if(m_offset > m_stats.highWaterMark)
+	{
+		m_stats.highWaterMark = m_offset;
+	}
+
+	return m_base + start;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gives back everything that was allocated. The per reset counters (peak and allocation
+/// 	count) start again, the high water mark is kept.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinearAllocatorClass::Reset()
+{
+	m_offset = 0;
+
+	m_stats.used = 0;
+	m_stats.peak = 0;
+	m_stats.allocationCount = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Returns the current position, to be later passed to FreeToMarker. </summary>
+///
+/// <returns> The marker. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t LinearAllocatorClass::GetMarker()
+{
+	return m_offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives back everything allocated after the marker was taken. </summary>
+///
+/// <param name="marker"> The marker. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinearAllocatorClass::FreeToMarker(size_t marker)
+{
+	if(marker < m_offset)
+	{
+		m_offset = marker;
+		m_stats.used = marker;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the usage statistics. </summary>
+///
+/// <param name="stats"> [out] The statistics. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LinearAllocatorClass::GetStats(AllocatorStats& stats)
+{
+	stats = m_stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Checks an allocator of ALLOCATOR_BENCHMARK_ALLOCATIONS blocks: they are aligned and packed
+/// 	one after the other, one more is refused, a marker gives back what came after it and a
+/// 	reset gives back everything. Then times rounds of allocations and a reset against new and
+/// 	delete of the same size.
+/// </summary>
+///
+/// <param name="benchmark"> [out] The checks and the timings. </param>
+///
+/// <returns> true if every check passed, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LinearAllocatorClass::Benchmark(AllocatorBenchmark& benchmark)
+{
+	LinearAllocatorClass allocator;
+	vector<char*> blocks;
+	AllocatorStats stats;
+	unsigned long long start, elapsed;
+	size_t marker;
+	char* block;
+	int round, i;
+	bool result;
+
+	memset(&benchmark, 0, sizeof(AllocatorBenchmark));
+	benchmark.allocations = ALLOCATOR_BENCHMARK_ALLOCATIONS;
+	benchmark.rounds = ALLOCATOR_BENCHMARK_ROUNDS;
+
+	if(!allocator.Initialize(ALLOCATOR_BENCHMARK_SIZE * ALLOCATOR_BENCHMARK_ALLOCATIONS))
+	{
+		return false;
+	}
+
+	blocks.resize(ALLOCATOR_BENCHMARK_ALLOCATIONS);
+
+	// The blocks fill the allocator exactly, each aligned and right after the one before it.
+	result = true;
+	for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+	{
+		blocks[i] = (char*)allocator.Allocate(ALLOCATOR_BENCHMARK_SIZE);
+		if(!blocks[i] || ((size_t)blocks[i] & (DEFAULT_ALIGNMENT - 1)) != 0 || (i > 0 && blocks[i] != blocks[i - 1] + ALLOCATOR_BENCHMARK_SIZE))
+		{
+			result = false;
+		}
+	}
+	benchmark.checks++;
+	benchmark.failures += result ? 0 : 1;
+
+	// A full allocator refuses, and counts it.
+	result = allocator.Allocate(1) == 0;
+	allocator.GetStats(stats);
+	result = result && stats.failedAllocations == 1 && stats.used == stats.capacity;
+	benchmark.checks++;
+	benchmark.failures += result ? 0 : 1;
+
+	// A reset starts again from the beginning, a marker gives back only what came after it.
+	allocator.Reset();
+	allocator.Allocate(1);
+	marker = allocator.GetMarker();
+	block = (char*)allocator.Allocate(ALLOCATOR_BENCHMARK_SIZE);
+	allocator.FreeToMarker(marker);
+	result = block == blocks[0] + DEFAULT_ALIGNMENT && allocator.Allocate(ALLOCATOR_BENCHMARK_SIZE) == block;
+	benchmark.checks++;
+	benchmark.failures += result ? 0 : 1;
+
+	allocator.Reset();
+	allocator.GetStats(stats);
+	result = stats.used == 0 && stats.allocationCount == 0 && stats.highWaterMark == stats.capacity;
+	benchmark.checks++;
+	benchmark.failures += result ? 0 : 1;
+
+	// Time the allocations of a frame and its reset, the blocks are written so nothing is optimized away.
+	start = ProfilerClass::GetTimestamp();
+	for(round=0; round<ALLOCATOR_BENCHMARK_ROUNDS; round++)
+	{
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			blocks[i] = (char*)allocator.Allocate(ALLOCATOR_BENCHMARK_SIZE);
+			blocks[i][0] = (char)i;
+		}
+		allocator.Reset();
+	}
+	elapsed = ProfilerClass::GetTimestamp() - start;
+	benchmark.allocatorMs = ProfilerClass::TicksToMilliseconds(elapsed) / ALLOCATOR_BENCHMARK_ROUNDS;
+
+	start = ProfilerClass::GetTimestamp();
+	for(round=0; round<ALLOCATOR_BENCHMARK_ROUNDS; round++)
+	{
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			blocks[i] = new char[ALLOCATOR_BENCHMARK_SIZE];
+			blocks[i][0] = (char)i;
+		}
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			delete [] blocks[i];
+		}
+	}
+	elapsed = ProfilerClass::GetTimestamp() - start;
+	benchmark.heapMs = ProfilerClass::TicksToMilliseconds(elapsed) / ALLOCATOR_BENCHMARK_ROUNDS;
+
+	allocator.Shutdown();
+
+	return benchmark.failures == 0;
+}
@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	linearallocatorclass.h
+//
+// summary:	Declares the linearallocatorclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _LINEARALLOCATORCLASS_H_
+#define _LINEARALLOCATORCLASS_H_
+
+// Includes.
+#include "allocatorstats.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A linear (bump pointer) allocator over a single block reserved in Initialize. Allocating
+/// 	just moves an offset forward, and the memory is given back all at once with Reset, or
+/// 	back to a previously taken marker with FreeToMarker. There is no per-allocation free and
+/// 	no destructors are called, so it should only hold plain data.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class LinearAllocatorClass
+{
+public:
+	LinearAllocatorClass();
+	LinearAllocatorClass(const LinearAllocatorClass&);
+	~LinearAllocatorClass();
+
+	bool Initialize(size_t);
+	void Shutdown();
+
+	void* Allocate(size_t, size_t = DEFAULT_ALIGNMENT);
+	void Reset();
+
+	size_t GetMarker();
+	void FreeToMarker(size_t);
+
+	void GetStats(AllocatorStats&);
+
+	static bool Benchmark(AllocatorBenchmark&);
+
+private:
+	char* m_memory;
+	char* m_base;
+	size_t m_capacity;
+	size_t m_offset;
+	AllocatorStats m_stats;
+};
+
+#endif
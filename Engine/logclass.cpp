@@ -0,0 +1,732 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	logclass.cpp
+//
+// summary:	Implements the logclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "logclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+// Includes.
+#include "profilerclass.h"
+
+// Globals.
+const int LOG_LINE_SIZE = 1024;
+
+THREAD_LOCAL LogRing* LogThreadRing = 0;
+THREAD_LOCAL unsigned int LogThreadGeneration = 0;
+unsigned int LogClass::m_generation = 0;
+
+// The ring list lock is taken when a thread registers and while the rings are drained.
+static mutex LogLock;
+static vector<LogRing*> LogRings;
+static vector<LogRing*> LogFreeRings;
+static unsigned int LogGenerationCounter = 0;
+static FILE* LogFile = 0;
+static unsigned long long LogStart = 0;
+static unsigned long LogDropped = 0;
+static vector<LogRecord> LogBatch;
+
+static thread LogWriter;
+static mutex LogWriterLock;
+static condition_variable LogWriterSignal;
+static bool LogWriterRunning = false;
+
+static const char* LogSeverityNames[LOG_SEVERITY_COUNT] =
+{
+	"DEBUG",
+	"INFO",
+	"WARNING",
+	"ERROR",
+	"FATAL"
+};
+
+static const char* LogCategoryNames[LOG_CATEGORY_COUNT] =
+{
+	"system",
+	"render",
+	"shader",
+	"resource",
+	"input"
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sort order of the records of a batch, by time stamp. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool RecordLess(const LogRecord& a, const LogRecord& b)
+{
+	return a.timestamp < b.timestamp;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies a string argument into the text of a record, cutting it if it doesn't fit. </summary>
+///
+/// <param name="record"> The record. </param>
+/// <param name="arg">	  The string argument. </param>
+///
+/// <returns> The offset of the copy in the record text. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned short CopyString(LogRecord* record, const LogArg& arg)
+{
+	unsigned short offset;
+	int i, room;
+
+	offset = record->textUsed;
+	room = LOG_TEXT_SIZE - offset - 1;
+
+	// Wide strings are narrowed on the way in, anything outside ascii becomes '?'.
+	i = 0;
+	if(arg.type == LOG_ARG_STRING)
+	{
+		for(; arg.s && arg.s[i] && i < room; i++)
+		{
+			record->text[offset + i] = arg.s[i];
+		}
+	}
+	else
+	{
+		for(; arg.w && arg.w[i] && i < room; i++)
+		{
+			record->text[offset + i] = arg.w[i] < 128 ? (char)arg.w[i] : '?';
+		}
+	}
+
+	record->text[offset + i] = '\0';
+	record->textUsed = (unsigned short)(offset + i + 1);
+
+	return offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Formats one printf conversion. The length modifiers of the format are ignored and the
+/// 	value is printed the way its stored type needs, so a %d given a 64 bit value still works.
+/// </summary>
+///
+/// <param name="out">		  The output buffer. </param>
+/// <param name="size">		  The output size. </param>
+/// <param name="spec">		  The conversion without length modifiers, like "%-8.3f". </param>
+/// <param name="conversion"> The conversion character. </param>
+/// <param name="record">	  The record. </param>
+/// <param name="arg">		  The argument index. </param>
+///
+/// <returns> The number of characters written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int FormatArg(char* out, int size, const char* spec, char conversion, const LogRecord& record, int arg)
+{
+	char full[32];
+	int length, written;
+	bool floating;
+
+	length = (int)strlen(spec);
+	floating = strchr("eEfFgGaA", conversion) != 0;
+
+	switch(record.types[arg])
+	{
+		case LOG_ARG_STRING:
+		case LOG_ARG_WIDE_STRING:
+			LOG_SNPRINTF(full, sizeof(full), "%.*ss", length, spec);
+			written = LOG_SNPRINTF(out, size, full, record.text + record.values[arg].u);
+			break;
+
+		case LOG_ARG_POINTER:
+			written = LOG_SNPRINTF(out, size, "%p", record.values[arg].p);
+			break;
+
+		case LOG_ARG_DOUBLE:
+			if(floating)
+			{
+				LOG_SNPRINTF(full, sizeof(full), "%.*s%c", length, spec, conversion);
+				written = LOG_SNPRINTF(out, size, full, record.values[arg].d);
+			}
+			else
+			{
+				written = LOG_SNPRINTF(out, size, "%g", record.values[arg].d);
+			}
+			break;
+
+		default:
+			if(floating)
+			{
+				LOG_SNPRINTF(full, sizeof(full), "%.*s%c", length, spec, conversion);
+				written = LOG_SNPRINTF(out, size, full, record.types[arg] == LOG_ARG_INT ? (double)record.values[arg].i : (double)record.values[arg].u);
+			}
+			else if(conversion == 'c')
+			{
+				LOG_SNPRINTF(full, sizeof(full), "%.*sc", length, spec);
+				written = LOG_SNPRINTF(out, size, full, (int)record.values[arg].i);
+			}
+			else if(conversion == 'd' || conversion == 'i')
+			{
+				LOG_SNPRINTF(full, sizeof(full), "%.*slld", length, spec);
+				written = LOG_SNPRINTF(out, size, full, record.values[arg].i);
+			}
+			else
+			{
+				LOG_SNPRINTF(full, sizeof(full), "%.*sll%c", length, spec, strchr("ouxX", conversion) ? conversion : 'u');
+				written = LOG_SNPRINTF(out, size, full, record.values[arg].u);
+			}
+			break;
+	}
+
+	if(written < 0 || written >= size)
+	{
+		written = size - 1;
+	}
+
+	return written;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Formats a record into a log line. </summary>
+///
+/// <param name="record"> The record. </param>
+/// <param name="line">	  [out] The line. </param>
+/// <param name="size">	  The line size. </param>
+///
+/// <returns> The length of the line. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int FormatRecord(const LogRecord& record, char* line, int size)
+{
+	const char* format;
+	char spec[16];
+	int used, length, arg;
+
+	used = LOG_SNPRINTF(line, size, "[%10.3f] %-7s %-8s ", ProfilerClass::TicksToMilliseconds(record.timestamp - LogStart) / 1000.0,
+						LogSeverityNames[record.severity], LogCategoryNames[record.category]);
+	if(used < 0)
+	{
+		used = 0;
+	}
+
+	arg = 0;
+	format = record.format;
+	while(*format && used < size - 2)
+	{
+		if(*format != '%')
+		{
+			line[used++] = *format++;
+			continue;
+		}
+
+		if(format[1] == '%')
+		{
+			line[used++] = '%';
+			format += 2;
+			continue;
+		}
+
+		// Keep the flags, width and precision, drop the length modifiers.
+		length = 0;
+		spec[length++] = *format++;
+		while(*format && strchr("-+ #0123456789.", *format) && length < (int)sizeof(spec) - 1)
+		{
+			spec[length++] = *format++;
+		}
+		while(*format && strchr("hlLqjzt", *format))
+		{
+			format++;
+		}
+		spec[length] = '\0';
+
+		if(!*format)
+		{
+			break;
+		}
+
+		if(arg < record.argCount)
+		{
+			used += FormatArg(line + used, size - used - 1, spec, *format, record, arg);
+			arg++;
+		}
+		else
+		{
+			// Not enough arguments, show the conversion as it was written.
+			used += LOG_SNPRINTF(line + used, size - used - 1, "%s%c", spec, *format);
+		}
+
+		format++;
+	}
+
+	line[used++] = '\n';
+	line[used] = '\0';
+
+	return used;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes a line to the debugger output, used for warnings and worse. </summary>
+///
+/// <param name="line"> The line. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void WriteDebugOutput(const char* line)
+{
+#ifdef _WIN32
+	OutputDebugStringA(line);
+#else
+	fputs(line, stderr);
+#endif
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Flushes what it can and lets the crash go on. </summary>
+///
+/// <param name="signal"> The signal. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void CrashSignalHandler(int signal)
+{
+	LogClass::Flush(false);
+
+	std::signal(signal, SIG_DFL);
+	raise(signal);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Flushes before std::terminate aborts. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void CrashTerminateHandler()
+{
+	LogClass::Flush(false);
+
+	abort();
+}
+
+#ifdef _WIN32
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Flushes on an unhandled structured exception, like an access violation. </summary>
+///
+/// <param name="exception"> The exception. </param>
+///
+/// <returns> EXCEPTION_CONTINUE_SEARCH, so the crash still reaches the debugger or reporter. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static LONG WINAPI CrashExceptionFilter(EXCEPTION_POINTERS* exception)
+{
+	LogClass::Flush(false);
+
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Opens the log file and starts the writer thread. </summary>
+///
+/// <param name="filename"> The log file. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LogClass::Initialize(const char* filename)
+{
+	if(m_generation)
+	{
+		return true;
+	}
+
+	LogFile = fopen(filename, "w");
+	if(!LogFile)
+	{
+		return false;
+	}
+
+	LogStart = ProfilerClass::GetTimestamp();
+	LogDropped = 0;
+	LogBatch.reserve(LOG_RING_SIZE);
+
+	// A new generation makes every thread register again, 0 is kept for "not running".
+	LogGenerationCounter++;
+	if(LogGenerationCounter == 0)
+	{
+		LogGenerationCounter++;
+	}
+
+	{
+		lock_guard<mutex> lock(LogLock);
+		m_generation = LogGenerationCounter;
+	}
+
+	LogWriterRunning = true;
+	LogWriter = thread(WriterThread);
+
+	InstallCrashHandlers();
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Stops the writer thread, writes what is left and closes the log file. Must only be
+/// 	called once the other threads stopped logging.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LogClass::Shutdown()
+{
+	size_t i;
+
+	if(!m_generation)
+	{
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(LogWriterLock);
+		LogWriterRunning = false;
+	}
+	LogWriterSignal.notify_one();
+	LogWriter.join();
+
+	// The writer is gone, drain whatever came in since its last pass.
+	Drain(true);
+
+	lock_guard<mutex> lock(LogLock);
+
+	m_generation = 0;
+
+	for(i=0; i<LogRings.size(); i++)
+	{
+		delete LogRings[i];
+	}
+	vector<LogRing*>().swap(LogRings);
+	vector<LogRing*>().swap(LogFreeRings);
+	vector<LogRecord>().swap(LogBatch);
+
+	fclose(LogFile);
+	LogFile = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes every record logged so far, from the calling thread. </summary>
+///
+/// <param name="wait">
+/// 	false to skip the drain if another thread is in the middle of one. The crash handlers
+/// 	use this, the crash may have happened while the lock was held.
+/// </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LogClass::Flush(bool wait)
+{
+	if(!m_generation)
+	{
+		return;
+	}
+
+	Drain(wait);
+	fflush(LogFile);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Measures the cost of logging from the calling thread. The records go through the same
+/// 	path as any other, but the rings stay locked while they are written and they are then
+/// 	marked so the writer throws them away unformatted.
+/// </summary>
+///
+/// <param name="count"> The number of records, capped to half a ring so none are dropped. </param>
+///
+/// <returns> The average cost of one record in nanoseconds, or 0 if the logger isn't running. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double LogClass::Benchmark(int count)
+{
+	LogRing* ring;
+	unsigned long long start, end;
+	unsigned int first, i;
+	int j;
+
+	ring = GetThreadRing();
+	if(!ring || count <= 0)
+	{
+		return 0.0;
+	}
+
+	count = min(count, (int)LOG_RING_SIZE / 2);
+
+	// Make room so every record of the run fits.
+	Flush();
+
+	lock_guard<mutex> lock(LogLock);
+
+	first = ring->write.load(memory_order_relaxed);
+
+	start = ProfilerClass::GetTimestamp();
+	for(j=0; j<count; j++)
+	{
+		Write(LOG_SEVERITY_DEBUG, LOG_CATEGORY_SYSTEM, "benchmark %d %f %s", j, 0.5, "text");
+	}
+	end = ProfilerClass::GetTimestamp();
+
+	for(i=first; i!=ring->write.load(memory_order_relaxed); i++)
+	{
+		ring->records[i & (LOG_RING_SIZE - 1)].discard = 1;
+	}
+
+	return ProfilerClass::TicksToMilliseconds(end - start) * 1000000.0 / (double)count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Captures a record into the ring of the calling thread. Use the LOG_* macros. </summary>
+///
+/// <param name="severity"> The severity. </param>
+/// <param name="category"> The category. </param>
+/// <param name="format">   The printf format, it must be a string literal. </param>
+/// <param name="arg0">	    The arguments, LOG_ARG_NONE for the unused ones. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LogClass::Write(int severity, int category, const char* format, const LogArg& arg0, const LogArg& arg1,
+					 const LogArg& arg2, const LogArg& arg3, const LogArg& arg4, const LogArg& arg5)
+{
+	const LogArg* args[LOG_MAX_ARGS] = { &arg0, &arg1, &arg2, &arg3, &arg4, &arg5 };
+	LogRing* ring;
+	LogRecord* record;
+	unsigned int write;
+	int i;
+
+	ring = GetThreadRing();
+	if(!ring)
+	{
+		return;
+	}
+
+	write = ring->write.load(memory_order_relaxed);
+	if(write - ring->read.load(memory_order_acquire) >= LOG_RING_SIZE)
+	{
+		ring->dropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+
+	record = &ring->records[write & (LOG_RING_SIZE - 1)];
+	record->timestamp = ProfilerClass::GetTimestamp();
+	record->format = format;
+	record->severity = (unsigned char)severity;
+	record->category = (unsigned char)category;
+	record->discard = 0;
+	record->textUsed = 0;
+
+	for(i=0; i<LOG_MAX_ARGS && args[i]->type != LOG_ARG_NONE; i++)
+	{
+		record->types[i] = (unsigned char)args[i]->type;
+		if(args[i]->type == LOG_ARG_STRING || args[i]->type == LOG_ARG_WIDE_STRING)
+		{
+			record->values[i].u = CopyString(record, *args[i]);
+		}
+		else
+		{
+			record->values[i].i = args[i]->i;
+		}
+	}
+	record->argCount = (unsigned char)i;
+
+	// Publish the record to the writer.
+	ring->write.store(write + 1, memory_order_release);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the ring of the calling thread, registering it when needed. </summary>
+///
+/// <returns> The ring, or null if the logger isn't running. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+LogRing* LogClass::GetThreadRing()
+{
+	if(LogThreadGeneration != m_generation)
+	{
+		return RegisterThread();
+	}
+
+	return LogThreadRing;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives the calling thread the ring of a thread that ended, or creates one. </summary>
+///
+/// <returns> The ring, or null if the logger isn't running. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+LogRing* LogClass::RegisterThread()
+{
+	LogRing* ring;
+	size_t i;
+
+	lock_guard<mutex> lock(LogLock);
+
+	LogThreadGeneration = m_generation;
+	LogThreadRing = 0;
+	if(!m_generation)
+	{
+		return 0;
+	}
+
+	// Only a ring the writer emptied is taken over, so the new thread gets the whole of it.
+	for(i=0; i<LogFreeRings.size(); i++)
+	{
+		ring = LogFreeRings[i];
+		if(ring->write.load(memory_order_relaxed) == ring->read.load(memory_order_acquire))
+		{
+			LogFreeRings.erase(LogFreeRings.begin() + i);
+			LogThreadRing = ring;
+			return ring;
+		}
+	}
+
+	ring = new LogRing;
+	if(!ring)
+	{
+		return 0;
+	}
+
+	// Touch every record now, so the first lap around the ring doesn't take page faults in Write.
+	memset(ring->records, 0, sizeof(ring->records));
+
+	ring->write.store(0);
+	ring->read.store(0);
+	ring->dropped.store(0);
+
+	LogRings.push_back(ring);
+	LogThreadRing = ring;
+
+	return ring;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Hands the ring of the calling thread back for the next thread that registers. Call it before a thread ends. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LogClass::UnregisterThread()
+{
+	lock_guard<mutex> lock(LogLock);
+
+	if(m_generation && LogThreadGeneration == m_generation && LogThreadRing)
+	{
+		LogFreeRings.push_back(LogThreadRing);
+	}
+
+	LogThreadGeneration = 0;
+	LogThreadRing = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The writer thread, drains the rings until the logger shuts down. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LogClass::WriterThread()
+{
+	unique_lock<mutex> lock(LogWriterLock);
+
+	while(LogWriterRunning)
+	{
+		lock.unlock();
+		if(Drain(true))
+		{
+			fflush(LogFile);
+		}
+		lock.lock();
+
+		LogWriterSignal.wait_for(lock, chrono::milliseconds(LOG_WRITER_INTERVAL_MS));
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Moves the records of every ring to the log file, in time stamp order. </summary>
+///
+/// <param name="wait"> false to give up when another thread is draining, the crash path uses this. </param>
+///
+/// <returns> true if anything was written, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool LogClass::Drain(bool wait)
+{
+	char line[LOG_LINE_SIZE];
+	unsigned int read, write, dropped;
+	size_t i;
+	int length;
+
+	unique_lock<mutex> lock(LogLock, defer_lock);
+	if(wait)
+	{
+		lock.lock();
+	}
+	else if(!lock.try_lock())
+	{
+		return false;
+	}
+
+	LogBatch.clear();
+	dropped = 0;
+
+	for(i=0; i<LogRings.size(); i++)
+	{
+		write = LogRings[i]->write.load(memory_order_acquire);
+		read = LogRings[i]->read.load(memory_order_relaxed);
+		for(; read != write; read++)
+		{
+			LogBatch.push_back(LogRings[i]->records[read & (LOG_RING_SIZE - 1)]);
+		}
+
+		// Hand the slots back to the writer.
+		LogRings[i]->read.store(write, memory_order_release);
+
+		dropped += LogRings[i]->dropped.exchange(0, memory_order_relaxed);
+	}
+
+	// Each ring is already in order, merging the threads only needs a stable sort.
+	stable_sort(LogBatch.begin(), LogBatch.end(), RecordLess);
+
+	for(i=0; i<LogBatch.size(); i++)
+	{
+		if(LogBatch[i].discard)
+		{
+			continue;
+		}
+
+		length = FormatRecord(LogBatch[i], line, LOG_LINE_SIZE);
+		fwrite(line, 1, length, LogFile);
+
+		if(LogBatch[i].severity >= LOG_SEVERITY_WARNING)
+		{
+			WriteDebugOutput(line);
+		}
+	}
+
+	if(dropped)
+	{
+		LogDropped += dropped;
+		fprintf(LogFile, "%u records dropped, the log ring was full (%lu in total).\n", dropped, LogDropped);
+	}
+
+	return !LogBatch.empty() || dropped;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Makes crashes flush the log before the process goes down. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void LogClass::InstallCrashHandlers()
+{
+	std::signal(SIGSEGV, CrashSignalHandler);
+	std::signal(SIGABRT, CrashSignalHandler);
+	std::signal(SIGFPE, CrashSignalHandler);
+	std::signal(SIGILL, CrashSignalHandler);
+	set_terminate(CrashTerminateHandler);
+
+#ifdef _WIN32
+	SetUnhandledExceptionFilter(CrashExceptionFilter);
+#endif
+
+	return;
+}
@@ -0,0 +1,224 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	logclass.h
+//
+// summary:	Declares the logclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _LOGCLASS_H_
+#define _LOGCLASS_H_
+
+// System Includes.
+#include <atomic>
+using namespace std;
+
+// Includes.
+#include "threadlocal.h"
+
+// Pre-processing directives.
+// Records below LOG_MIN_SEVERITY are compiled out, arguments included (0 debug, 1 info, 2 warning, 3 error, 4 fatal).
+#ifndef LOG_MIN_SEVERITY
+#ifdef _DEBUG
+#define LOG_MIN_SEVERITY 0
+#else
+#define LOG_MIN_SEVERITY 1
+#endif
+#endif
+
+// One bit per LogCategory. The test is a constant, so the compiler drops the masked out records.
+#ifndef LOG_CATEGORY_MASK
+#define LOG_CATEGORY_MASK 0xFFFFFFFF
+#endif
+
+// The older microsoft runtimes only have the underscored version, which doesn't always terminate the string.
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define LOG_SNPRINTF(buffer, size, ...) _snprintf_s(buffer, size, _TRUNCATE, __VA_ARGS__)
+#else
+#define LOG_SNPRINTF(buffer, size, ...) snprintf(buffer, size, __VA_ARGS__)
+#endif
+
+// Globals.
+const int LOG_MAX_ARGS = 6;
+const int LOG_TEXT_SIZE = 176;
+const unsigned int LOG_RING_SIZE = 1024;
+const int LOG_WRITER_INTERVAL_MS = 5;
+const int LOG_BENCHMARK_RECORDS = 256;
+const char* const LOG_FILENAME = "engine.log";
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the log severities. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum LogSeverity
+{
+	LOG_SEVERITY_DEBUG,
+	LOG_SEVERITY_INFO,
+	LOG_SEVERITY_WARNING,
+	LOG_SEVERITY_ERROR,
+	LOG_SEVERITY_FATAL,
+	LOG_SEVERITY_COUNT
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the log categories. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum LogCategory
+{
+	LOG_CATEGORY_SYSTEM,
+	LOG_CATEGORY_RENDER,
+	LOG_CATEGORY_SHADER,
+	LOG_CATEGORY_RESOURCE,
+	LOG_CATEGORY_INPUT,
+	LOG_CATEGORY_COUNT
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the types a log argument can hold. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum LogArgType
+{
+	LOG_ARG_NONE,
+	LOG_ARG_INT,
+	LOG_ARG_UINT,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_STRING,
+	LOG_ARG_WIDE_STRING,
+	LOG_ARG_POINTER
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	One argument of a log record. It converts implicitly from every type the logger knows,
+/// 	which lets Write take its arguments without formatting them.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct LogArg
+{
+	LogArg() { type = LOG_ARG_NONE; i = 0; }
+	LogArg(int value) { type = LOG_ARG_INT; i = value; }
+	LogArg(long value) { type = LOG_ARG_INT; i = value; }
+	LogArg(long long value) { type = LOG_ARG_INT; i = value; }
+	LogArg(unsigned int value) { type = LOG_ARG_UINT; u = value; }
+	LogArg(unsigned long value) { type = LOG_ARG_UINT; u = value; }
+	LogArg(unsigned long long value) { type = LOG_ARG_UINT; u = value; }
+	LogArg(double value) { type = LOG_ARG_DOUBLE; d = value; }
+	LogArg(const char* value) { type = LOG_ARG_STRING; s = value; }
+	LogArg(const wchar_t* value) { type = LOG_ARG_WIDE_STRING; w = value; }
+	LogArg(const void* value) { type = LOG_ARG_POINTER; p = value; }
+
+	LogArgType type;
+	union
+	{
+		long long i;
+		unsigned long long u;
+		double d;
+		const char* s;
+		const wchar_t* w;
+		const void* p;
+	};
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A log record as it sits in a ring. Numbers are kept as they were passed, strings are
+/// 	copied into text (and cut if they don't fit) since they may not outlive the call. The
+/// 	value of a string argument is its offset in text.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct LogRecord
+{
+	unsigned long long timestamp;
+	const char* format;
+	unsigned char severity;
+	unsigned char category;
+	unsigned char argCount;
+	unsigned char discard;
+	unsigned char types[LOG_MAX_ARGS];
+	unsigned short textUsed;
+	union
+	{
+		long long i;
+		unsigned long long u;
+		double d;
+		const void* p;
+	} values[LOG_MAX_ARGS];
+	char text[LOG_TEXT_SIZE];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The record ring of one thread, the same single writer / single reader scheme as the profiler. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct LogRing
+{
+	LogRecord records[LOG_RING_SIZE];
+	atomic<unsigned int> write;
+	atomic<unsigned int> read;
+	atomic<unsigned int> dropped;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Asynchronous logger. The LOG_* macros capture the format string, the arguments and a
+/// 	time stamp into the ring of the calling thread and return; a writer thread drains the
+/// 	rings every few milliseconds, puts the records in time order, formats them and writes
+/// 	them to engine.log (warnings and worse also go to the debugger output).
+///
+/// 	LOG_ERROR(LOG_CATEGORY_RENDER, "Could not create the %s buffer (%u bytes).", name, size);
+///
+/// 	The format must be a string literal, only its address is stored. Up to LOG_MAX_ARGS
+/// 	arguments are kept, using printf conversions. A full ring drops the record and counts
+/// 	it. LOG_FATAL and crashes (signals, unhandled exceptions, std::terminate) flush every
+/// 	ring from the calling thread before going on.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class LogClass
+{
+public:
+	static bool Initialize(const char* = LOG_FILENAME);
+	static void Shutdown();
+	static void Flush(bool = true);
+	static double Benchmark(int);
+	static void UnregisterThread();
+
+	static void Write(int, int, const char*, const LogArg& = LogArg(), const LogArg& = LogArg(), const LogArg& = LogArg(),
+					  const LogArg& = LogArg(), const LogArg& = LogArg(), const LogArg& = LogArg());
+
+private:
+	static LogRing* GetThreadRing();
+	static LogRing* RegisterThread();
+	static void WriterThread();
+	static bool Drain(bool);
+	static void InstallCrashHandlers();
+
+private:
+	static unsigned int m_generation;
+};
+
+// Pre-processing directives.
+#define LOG_WRITE(severity, category, ...) do { if(LOG_CATEGORY_MASK & (1u << (category))) { LogClass::Write(severity, category, __VA_ARGS__); } } while(0)
+
+#if LOG_MIN_SEVERITY <= 0
+#define LOG_DEBUG(category, ...) LOG_WRITE(LOG_SEVERITY_DEBUG, category, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) ((void)0)
+#endif
+
+#if LOG_MIN_SEVERITY <= 1
+#define LOG_INFO(category, ...) LOG_WRITE(LOG_SEVERITY_INFO, category, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) ((void)0)
+#endif
+
+#if LOG_MIN_SEVERITY <= 2
+#define LOG_WARNING(category, ...) LOG_WRITE(LOG_SEVERITY_WARNING, category, __VA_ARGS__)
+#else
+#define LOG_WARNING(category, ...) ((void)0)
+#endif
+
+#if LOG_MIN_SEVERITY <= 3
+#define LOG_ERROR(category, ...) LOG_WRITE(LOG_SEVERITY_ERROR, category, __VA_ARGS__)
+#else
+#define LOG_ERROR(category, ...) ((void)0)
+#endif
+
+// Fatal records are never compiled out and are on disk when the macro returns.
+#define LOG_FATAL(category, ...) do { LogClass::Write(LOG_SEVERITY_FATAL, category, __VA_ARGS__); LogClass::Flush(); } while(0)
+
+#endif
@@ -4,20 +4,36 @@
 // summary:	Implements the main class
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 #include "systemclass.h"
+#include "packbuilderclass.h"
+#include "sceneclass.h"
+#include "entitymanagerclass.h"
+#include "bvhclass.h"
+#include "occlusioncullerclass.h"
+#include "meshbvhclass.h"
+#include "texturebuilderclass.h"
+#include "texturefileclass.h"
+#include "spritebatchclass.h"
+#include "debugdrawclass.h"
+#include "residencymanagerclass.h"
+#include "poolallocatorclass.h"
+#include "scratchallocatorclass.h"
+
+// System Includes.
+#include <cstdio>
+#include <cstring>
+#include <string>
+using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-/// <summary> The application entry point. </summary>
+/// <summary> Creates, runs and releases the system object. </summary>
 ///
 /// <remarks> Filipe, 25 Nov 2012. </remarks>
 ///
-/// <param name="hInstance">	 A handle to the current instance of the application. </param>
-/// <param name="hPrevInstance"> A handle to the previous instance of the application. </param>
-/// <param name="pScmdline">	 The command line for the application, excluding the program name. </param>
-/// <param name="iCmdshow">		 Controls how the window is to be shown. </param>
+/// <param name="commandLine"> The command line, excluding the program name. </param>
 ///
 /// <returns> . </returns>
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline, int iCmdshow)
+static int RunSystem(const char* commandLine)
 {
 	SystemClass* System;
 	bool result;
@@ -30,7 +46,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline,
 	}
 
 	// Initialize and run the system object.
-	result = System->Initialize();
+	result = System->Initialize(commandLine);
 	if(result)
 	{
 		System->Run();
@@ -42,4 +58,678 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline,
 	System = 0;
 
 	return 0;
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds an asset pack instead of running, for "-buildpack list [pack]". The pack goes to
+/// 	the asset pack the engine mounts when no name is given.
+/// </summary>
+///
+/// <param name="commandLine"> The command line, excluding the program name. </param>
+///
+/// <returns> 0 if the pack was built, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BuildPack(const char* commandLine)
+{
+	PackBuilderClass builder;
+	char list[COMMAND_LINE_VALUE_SIZE], pack[COMMAND_LINE_VALUE_SIZE];
+	bool result;
+
+	list[0] = 0;
+	pack[0] = 0;
+	if(sscanf(strstr(commandLine, PACK_BUILD_SWITCH) + strlen(PACK_BUILD_SWITCH), "%259s %259s", list, pack) < 1)
+	{
+		return 1;
+	}
+
+	// The builder logs what it does.
+	result = ProfilerClass::Initialize() && LogClass::Initialize() && TaskGraphClass::InitializeWorkers();
+	if(result)
+	{
+		result = builder.AddList(list) && builder.Write(pack[0] ? pack : ASSET_PACK_FILE);
+	}
+
+	TaskGraphClass::ShutdownWorkers();
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Imports an image into a texture instead of running, for "-buildtexture image texture
+/// 	[bc1|bc3|bc7|rgba8] [linear]". The image is a TGA and the texture a KTX2 file when its
+/// 	name ends in .ktx2, a DDS otherwise, in BC7 when no format is given, with sRGB colours
+/// 	unless "linear" is.
+/// </summary>
+///
+/// <param name="commandLine"> The command line, excluding the program name. </param>
+///
+/// <returns> 0 if the texture was built, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BuildTexture(const char* commandLine)
+{
+	const char* const FormatNames[4] = { "rgba8", "bc1", "bc3", "bc7" };
+	const TextureFormat Formats[4] = { TEXTURE_FORMAT_RGBA8, TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC3, TEXTURE_FORMAT_BC7 };
+	TextureImage image;
+	TextureData texture;
+	TextureFormat format;
+	char source[COMMAND_LINE_VALUE_SIZE], target[COMMAND_LINE_VALUE_SIZE], formatName[COMMAND_LINE_VALUE_SIZE], space[COMMAND_LINE_VALUE_SIZE];
+	unsigned long long start;
+	size_t length;
+	bool result, ktx2;
+	int i;
+
+	formatName[0] = 0;
+	space[0] = 0;
+	if(sscanf(strstr(commandLine, TEXTURE_BUILD_SWITCH) + strlen(TEXTURE_BUILD_SWITCH), "%259s %259s %259s %259s", source, target, formatName, space) < 2)
+	{
+		return 1;
+	}
+
+	length = strlen(target);
+	ktx2 = length > 5 && strcmp(target + length - 5, ".ktx2") == 0;
+
+	format = TEXTURE_FORMAT_BC7;
+	for(i=0; i<4; i++)
+	{
+		if(strcmp(formatName, FormatNames[i]) == 0)
+		{
+			format = Formats[i];
+		}
+	}
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize() && TaskGraphClass::InitializeWorkers();
+	if(result)
+	{
+		start = ProfilerClass::GetTimestamp();
+		result = TextureBuilderClass::LoadTga(source, image) && TextureBuilderClass::Build(image, format, strcmp(space, "linear") != 0, texture) &&
+			(ktx2 ? TextureBuilderClass::WriteKtx2(target, texture) : TextureBuilderClass::WriteDds(target, texture));
+		if(result)
+		{
+			LOG_INFO(LOG_CATEGORY_RESOURCE, "Built %s, %dx%d in %d mips of %u bytes, in %.1f ms.", target, texture.width, texture.height, (int)texture.mips.size(), (unsigned int)texture.data.size(), ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start));
+		}
+	}
+
+	TaskGraphClass::ShutdownWorkers();
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Times the scene update instead of running, for "-scenebench". The times are logged. </summary>
+///
+/// <returns> 0 if the benchmarks ran, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkScene()
+{
+	const int Sizes[2] = { SCENE_BENCHMARK_SMALL, SCENE_BENCHMARK_LARGE };
+	SceneBenchmark benchmark;
+	bool result;
+	int i;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize() && TaskGraphClass::InitializeWorkers();
+	for(i=0; i<2 && result; i++)
+	{
+		result = SceneClass::Benchmark(Sizes[i], benchmark);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Scene of %d nodes in %d levels: sort %.2f ms, update %.2f ms on one thread, %.2f ms on the workers.", benchmark.nodes, benchmark.levels, benchmark.sortMs, benchmark.serialMs, benchmark.parallelMs);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Scene of %d nodes: %d moved by %.0f%% of the subtrees in %.2f ms, %.3f ms with nothing moved.", benchmark.nodes, benchmark.partialNodes, SCENE_BENCHMARK_DIRTY * 100.0f, benchmark.partialMs, benchmark.cleanMs);
+	}
+
+	TaskGraphClass::ShutdownWorkers();
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times a query over the entities against plain arrays and objects behind pointers instead
+/// 	of running, for "-ecsbench". The times are logged.
+/// </summary>
+///
+/// <returns> 0 if the benchmarks ran, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkEntities()
+{
+	const int Sizes[2] = { ENTITY_BENCHMARK_SMALL, ENTITY_BENCHMARK_LARGE };
+	EntityBenchmark benchmark;
+	bool result;
+	int i;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize() && TaskGraphClass::InitializeWorkers();
+	for(i=0; i<2 && result; i++)
+	{
+		result = EntityManagerClass::Benchmark(Sizes[i], benchmark);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Entities: %d in %d chunks, query %.2f ms on one thread, %.2f ms on the workers.", benchmark.entities, benchmark.chunks, benchmark.querySerialMs, benchmark.queryParallelMs);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Entities: %d as plain arrays %.2f ms, as objects behind pointers %.2f ms.", benchmark.entities, benchmark.arrayMs, benchmark.objectMs);
+	}
+
+	TaskGraphClass::ShutdownWorkers();
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the build, the queries and the refits of the bounding volume hierarchy instead of
+/// 	running, for "-bvhbench". The times are logged.
+/// </summary>
+///
+/// <returns> 0 if the benchmarks ran and the queries were right, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkBvh()
+{
+	const int Sizes[2] = { BVH_BENCHMARK_SMALL, BVH_BENCHMARK_LARGE };
+	BvhBenchmark benchmark;
+	bool result;
+	int i;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize() && TaskGraphClass::InitializeWorkers();
+	for(i=0; i<2 && result; i++)
+	{
+		result = BvhClass::Benchmark(Sizes[i], benchmark);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "BVH of %d objects in %d nodes: build %.2f ms, cost %.1f.", benchmark.objects, benchmark.nodes, benchmark.buildMs, benchmark.builtCost);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "BVH of %d objects: frustum of %d objects %.3f ms, %.2f ms testing them one by one.", benchmark.objects, benchmark.visible, benchmark.frustumMs, benchmark.bruteForceMs);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "BVH of %d objects: %d rays %.2f ms, %d boxes %.2f ms.", benchmark.objects, BVH_BENCHMARK_QUERIES, benchmark.raysMs, BVH_BENCHMARK_QUERIES, benchmark.boxesMs);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "BVH of %d objects: refit after %.0f%% moved %.3f ms, after %.0f%% teleported %.2f ms.", benchmark.objects, BVH_BENCHMARK_MOVED * 100.0f, benchmark.refitMs, BVH_BENCHMARK_TELEPORTED * 100.0f, benchmark.repairMs);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "BVH of %d objects: cost %.1f after the refits repaired it, %.1f built again.", benchmark.objects, benchmark.repairedCost, benchmark.rebuiltCost);
+	}
+
+	TaskGraphClass::ShutdownWorkers();
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the occlusion culling of a city seen from a street instead of running, for
+/// 	"-occlusionbench". The share of the objects in the frustum it hides and the times are
+/// 	logged.
+/// </summary>
+///
+/// <returns> 0 if the benchmarks ran, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkOcclusion()
+{
+	const int Sizes[2] = { OCCLUSION_BENCHMARK_SMALL, OCCLUSION_BENCHMARK_LARGE };
+	OcclusionBenchmark benchmark;
+	bool result;
+	int i;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize() && TaskGraphClass::InitializeWorkers();
+	for(i=0; i<2 && result; i++)
+	{
+		result = OcclusionCullerClass::Benchmark(Sizes[i], benchmark);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Occlusion: %d objects, %d in the frustum, %d occluded (%.1f%%).", benchmark.objects, benchmark.inFrustum, benchmark.occluded, benchmark.inFrustum > 0 ? benchmark.occluded * 100.0f / benchmark.inFrustum : 0.0f);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Occlusion: %d occluders of %d triangles rasterized in %.3f ms.", benchmark.occluders, benchmark.triangles, benchmark.rasterMs);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Occlusion: %d objects tested in %.3f ms on one thread, %.3f ms on the workers.", benchmark.objects, benchmark.testSerialMs, benchmark.testParallelMs);
+	}
+
+	TaskGraphClass::ShutdownWorkers();
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the rays cast at the triangle tree of a terrain instead of running, for
+/// 	"-raybench". The build time and the rays per second each way are logged.
+/// </summary>
+///
+/// <returns> 0 if the benchmarks ran, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkRays()
+{
+	const int Sizes[2] = { MESH_BVH_BENCHMARK_SMALL, MESH_BVH_BENCHMARK_LARGE };
+	MeshBvhBenchmark benchmark;
+	bool result;
+	int i;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize() && TaskGraphClass::InitializeWorkers();
+	for(i=0; i<2 && result; i++)
+	{
+		result = MeshBvhClass::Benchmark(Sizes[i], benchmark);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Mesh BVH of %d triangles in %d nodes and %d leaves: build %.2f ms.", benchmark.triangles, benchmark.nodes, benchmark.leaves, benchmark.buildMs);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Mesh BVH of %d triangles: %.2f M rays/s down on it, %.2f M rays/s across it.", benchmark.triangles, benchmark.downRaysPerSecond * 1e-6, benchmark.acrossRaysPerSecond * 1e-6);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Mesh BVH of %d triangles: %.2f M rays/s for any hit, %.2f M rays/s down on the workers.", benchmark.triangles, benchmark.anyRaysPerSecond * 1e-6, benchmark.parallelRaysPerSecond * 1e-6);
+	}
+
+	TaskGraphClass::ShutdownWorkers();
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the import of a texture instead of running, for "-texturebench". The time of the
+/// 	mip chain, and the speed and PSNR of each compressed format are logged.
+/// </summary>
+///
+/// <returns> 0 if the benchmarks ran, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkTextures()
+{
+	const int Sizes[2] = { TEXTURE_BENCHMARK_SMALL, TEXTURE_BENCHMARK_LARGE };
+	TextureBenchmark benchmark;
+	bool result;
+	int i;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize() && TaskGraphClass::InitializeWorkers();
+	for(i=0; i<2 && result; i++)
+	{
+		result = TextureBuilderClass::Benchmark(Sizes[i], benchmark);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Texture of %d: %d mips in %.2f ms on one thread, %.2f ms on the workers.", benchmark.size, benchmark.mips, benchmark.mipSerialMs, benchmark.mipParallelMs);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Texture of %d in BC1 at %d:1: %.1f MB/s on one thread, %.1f MB/s on the workers, PSNR %.2f dB.", benchmark.size, benchmark.bc1.ratio, benchmark.bc1.serialMegabytesPerSecond, benchmark.bc1.parallelMegabytesPerSecond, benchmark.bc1.psnr);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Texture of %d in BC3 at %d:1: %.1f MB/s on one thread, %.1f MB/s on the workers, PSNR %.2f dB.", benchmark.size, benchmark.bc3.ratio, benchmark.bc3.serialMegabytesPerSecond, benchmark.bc3.parallelMegabytesPerSecond, benchmark.bc3.psnr);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Texture of %d in BC7 at %d:1: %.1f MB/s on one thread, %.1f MB/s on the workers, PSNR %.2f dB.", benchmark.size, benchmark.bc7.ratio, benchmark.bc7.serialMegabytesPerSecond, benchmark.bc7.parallelMegabytesPerSecond, benchmark.bc7.psnr);
+	}
+
+	TaskGraphClass::ShutdownWorkers();
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the loading of a set of texture files instead of running, for "-textureloadbench".
+/// 	The speed and the peak memory of reading them, of mapping them, and of mapping only
+/// 	their lower mips are logged.
+/// </summary>
+///
+/// <returns> 0 if the benchmark ran, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkTextureLoads()
+{
+	const double Megabyte = 1024.0 * 1024.0;
+	TextureLoadBenchmark benchmark;
+	bool result;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize();
+	if(result)
+	{
+		result = TextureFileClass::Benchmark(benchmark);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "%d textures of %d read: %.1f MB in %.1f ms, %.0f MB/s, %.1f MB more private memory.", benchmark.textures, benchmark.size, benchmark.copied.bytes / Megabyte, benchmark.copied.ms, benchmark.copied.megabytesPerSecond, benchmark.copied.peakPrivateBytes / Megabyte);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "%d textures of %d mapped: %.1f MB in %.1f ms, %.0f MB/s, %.1f MB more private memory.", benchmark.textures, benchmark.size, benchmark.mapped.bytes / Megabyte, benchmark.mapped.ms, benchmark.mapped.megabytesPerSecond, benchmark.mapped.peakPrivateBytes / Megabyte);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "%d textures of %d mapped from mip %d: %.1f MB in %.1f ms, %.1f MB more private memory.", benchmark.textures, benchmark.size, TEXTURE_STREAMING_SKIP_MIPS, benchmark.lowMips.bytes / Megabyte, benchmark.lowMips.ms, benchmark.lowMips.peakPrivateBytes / Megabyte);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Peak resident memory, with the pages of the files: %.1f MB read, %.1f MB mapped, %.1f MB mapped from mip %d.", benchmark.copied.peakResidentBytes / Megabyte, benchmark.mapped.peakResidentBytes / Megabyte, benchmark.lowMips.peakResidentBytes / Megabyte, TEXTURE_STREAMING_SKIP_MIPS);
+	}
+
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the sprite batch on a frame of many sprites and strings instead of running, for
+/// 	"-spritebench". The draws go to a ring in memory, so only the CPU side is measured: the
+/// 	time to add, sort and write the sprites, and the number of draws and maps it takes.
+/// </summary>
+///
+/// <returns> 0 if the benchmark ran and every sprite was drawn once, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkSprites()
+{
+	SpriteBatchBenchmark benchmark;
+	bool result;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize();
+	if(result)
+	{
+		result = SpriteBatchClass::Benchmark(benchmark);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "%d sprites with %d textures in %d layers and %d strings, over %d frames.", benchmark.sprites, benchmark.textures, benchmark.layers, benchmark.strings, benchmark.frames);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "A frame takes %.2f ms to add the sprites, %.2f ms to sort them and %.2f ms to write them.", benchmark.submitMs, benchmark.sortMs, benchmark.writeMs);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "A frame takes %d draws and %d maps of a ring of %d quads, %d string layouts are cached.", benchmark.draws, benchmark.maps, SPRITE_RING_QUADS, benchmark.layouts);
+		if(!result)
+		{
+			LOG_ERROR(LOG_CATEGORY_SYSTEM, "The sprite batch drew out of its ring or lost sprites.");
+		}
+	}
+
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the debug draw instead of running, for "-debugdrawbench": threads drawing boxes,
+/// 	spheres and frusta into their rings, then the merge of every ring at the end of a frame.
+/// </summary>
+///
+/// <returns> 0 if the benchmark ran and every line was merged, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkDebugDraw()
+{
+	DebugDrawBenchmark benchmark;
+	bool result;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize();
+	if(result)
+	{
+		result = DebugDrawClass::Benchmark(benchmark);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "%d threads drawing %d boxes, %d spheres and %d frusta each, over %d frames.", benchmark.threads, benchmark.boxes, benchmark.spheres, benchmark.frusta, benchmark.frames);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "A thread takes %.3f ms to draw its lines, the merge of %d vertices takes %.3f ms.", benchmark.drawMs, benchmark.vertices, benchmark.mergeMs);
+		if(!result)
+		{
+			LOG_ERROR(LOG_CATEGORY_SYSTEM, "The debug draw lost lines, %u were dropped.", benchmark.dropped);
+		}
+	}
+
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Checks the residency manager instead of running, for "-residencytest": fake resources
+/// 	with no device are evicted over the budget and restored when touched.
+/// </summary>
+///
+/// <returns> 0 if every check passed, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int TestResidency()
+{
+	ResidencyTest test;
+	bool result;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize();
+	if(result)
+	{
+		result = ResidencyManagerClass::Test(test);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Residency of %d resources under a budget of %d: %lu evictions, %lu restores, %lu failed restores.", test.resources, RESIDENCY_TEST_BUDGET, test.stats.evictions, test.stats.restores, test.stats.failedRestores);
+		if(!result)
+		{
+			LOG_ERROR(LOG_CATEGORY_SYSTEM, "The residency test failed %d of %d checks.", test.failures, test.checks);
+		}
+		else
+		{
+			LOG_INFO(LOG_CATEGORY_SYSTEM, "The residency test passed %d checks.", test.checks);
+		}
+	}
+
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Checks the frame stats instead of running, for "-framestatstest": synthetic frame times
+/// 	with known percentiles, buckets and hitches, no clock involved.
+/// </summary>
+///
+/// <returns> 0 if every check passed, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int TestFrameStats()
+{
+	FrameStatsTestResult test;
+	bool result;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize();
+	if(result)
+	{
+		result = FrameStatsClass::Test(test);
+		LOG_INFO(LOG_CATEGORY_SYSTEM, "Frame stats of %d frames: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms, %d hitches.", test.summary.frames, test.summary.p50Ms, test.summary.p90Ms, test.summary.p99Ms, test.summary.maxMs, test.summary.hitches);
+		if(!result)
+		{
+			LOG_ERROR(LOG_CATEGORY_SYSTEM, "The frame stats test failed %d of %d checks.", test.failures, test.checks);
+		}
+		else
+		{
+			LOG_INFO(LOG_CATEGORY_SYSTEM, "The frame stats test passed %d checks.", test.checks);
+		}
+	}
+
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Checks and times the allocators instead of running, for "-allocbench": the pool, the
+/// 	linear allocator and the thread scratch, each against new and delete.
+/// </summary>
+///
+/// <returns> 0 if every check passed, 1 if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int BenchmarkAllocators()
+{
+	const char* Names[3] = { "Pool", "Linear", "Scratch" };
+	AllocatorBenchmark benchmarks[3];
+	bool passed[3];
+	bool result;
+	int i;
+
+	result = ProfilerClass::Initialize() && LogClass::Initialize();
+	if(result)
+	{
+		passed[0] = PoolAllocatorClass::Benchmark(benchmarks[0]);
+		passed[1] = LinearAllocatorClass::Benchmark(benchmarks[1]);
+		passed[2] = ScratchAllocatorClass::Benchmark(benchmarks[2]);
+
+		for(i=0; i<3; i++)
+		{
+			LOG_INFO(LOG_CATEGORY_SYSTEM, "%s: %d allocations of %d bytes take %.3f ms, %.3f ms with new and delete.", Names[i], benchmarks[i].allocations, (int)ALLOCATOR_BENCHMARK_SIZE, benchmarks[i].allocatorMs, benchmarks[i].heapMs);
+			if(!passed[i])
+			{
+				LOG_ERROR(LOG_CATEGORY_SYSTEM, "%s: failed %d of %d checks.", Names[i], benchmarks[i].failures, benchmarks[i].checks);
+				result = false;
+			}
+			else
+			{
+				LOG_INFO(LOG_CATEGORY_SYSTEM, "%s: passed %d checks.", Names[i], benchmarks[i].checks);
+			}
+		}
+	}
+
+	LogClass::Shutdown();
+	ProfilerClass::Shutdown();
+
+	return result ? 0 : 1;
+}
+
+#ifdef _WIN32
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The application entry point. </summary>
+///
+/// <remarks> Filipe, 25 Nov 2012. </remarks>
+///
+/// <param name="hInstance">	 A handle to the current instance of the application. </param>
+/// <param name="hPrevInstance"> A handle to the previous instance of the application. </param>
+/// <param name="pScmdline">	 The command line for the application, excluding the program name. </param>
+/// <param name="iCmdshow">		 Controls how the window is to be shown. </param>
+///
+/// <returns> . </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR pScmdline, int iCmdshow)
+{
+	if(pScmdline && strstr(pScmdline, PACK_BUILD_SWITCH))
+	{
+		return BuildPack(pScmdline);
+	}
+
+	if(pScmdline && strstr(pScmdline, SCENE_BENCHMARK_SWITCH))
+	{
+		return BenchmarkScene();
+	}
+
+	if(pScmdline && strstr(pScmdline, ENTITY_BENCHMARK_SWITCH))
+	{
+		return BenchmarkEntities();
+	}
+
+	if(pScmdline && strstr(pScmdline, BVH_BENCHMARK_SWITCH))
+	{
+		return BenchmarkBvh();
+	}
+
+	if(pScmdline && strstr(pScmdline, OCCLUSION_BENCHMARK_SWITCH))
+	{
+		return BenchmarkOcclusion();
+	}
+
+	if(pScmdline && strstr(pScmdline, RAY_BENCHMARK_SWITCH))
+	{
+		return BenchmarkRays();
+	}
+
+	if(pScmdline && strstr(pScmdline, TEXTURE_BENCHMARK_SWITCH))
+	{
+		return BenchmarkTextures();
+	}
+
+	if(pScmdline && strstr(pScmdline, TEXTURE_LOAD_BENCHMARK_SWITCH))
+	{
+		return BenchmarkTextureLoads();
+	}
+
+	if(pScmdline && strstr(pScmdline, DEBUG_DRAW_BENCHMARK_SWITCH))
+	{
+		return BenchmarkDebugDraw();
+	}
+
+	if(pScmdline && strstr(pScmdline, SPRITE_BENCHMARK_SWITCH))
+	{
+		return BenchmarkSprites();
+	}
+
+	if(pScmdline && strstr(pScmdline, RESIDENCY_TEST_SWITCH))
+	{
+		return TestResidency();
+	}
+
+	if(pScmdline && strstr(pScmdline, ALLOCATOR_BENCHMARK_SWITCH))
+	{
+		return BenchmarkAllocators();
+	}
+
+	if(pScmdline && strstr(pScmdline, FRAME_STATS_TEST_SWITCH))
+	{
+		return TestFrameStats();
+	}
+
+	if(pScmdline && strstr(pScmdline, TEXTURE_BUILD_SWITCH))
+	{
+		return BuildTexture(pScmdline);
+	}
+
+	return RunSystem(pScmdline);
+}
+#else
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The entry point of the headless build. </summary>
+///
+/// <param name="argc"> Number of arguments. </param>
+/// <param name="argv"> The arguments, the first is the program name. </param>
+///
+/// <returns> . </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+	string commandLine;
+	int i;
+
+	// Join the arguments back into one line, the way windows passes it.
+	for(i=1; i<argc; i++)
+	{
+		commandLine += i > 1 ? " " : "";
+		commandLine += argv[i];
+	}
+
+	if(strstr(commandLine.c_str(), PACK_BUILD_SWITCH))
+	{
+		return BuildPack(commandLine.c_str());
+	}
+
+	if(strstr(commandLine.c_str(), SCENE_BENCHMARK_SWITCH))
+	{
+		return BenchmarkScene();
+	}
+
+	if(strstr(commandLine.c_str(), ENTITY_BENCHMARK_SWITCH))
+	{
+		return BenchmarkEntities();
+	}
+
+	if(strstr(commandLine.c_str(), BVH_BENCHMARK_SWITCH))
+	{
+		return BenchmarkBvh();
+	}
+
+	if(strstr(commandLine.c_str(), OCCLUSION_BENCHMARK_SWITCH))
+	{
+		return BenchmarkOcclusion();
+	}
+
+	if(strstr(commandLine.c_str(), RAY_BENCHMARK_SWITCH))
+	{
+		return BenchmarkRays();
+	}
+
+	if(strstr(commandLine.c_str(), TEXTURE_BENCHMARK_SWITCH))
+	{
+		return BenchmarkTextures();
+	}
+
+	if(strstr(commandLine.c_str(), TEXTURE_LOAD_BENCHMARK_SWITCH))
+	{
+		return BenchmarkTextureLoads();
+	}
+
+	if(strstr(commandLine.c_str(), DEBUG_DRAW_BENCHMARK_SWITCH))
+	{
+		return BenchmarkDebugDraw();
+	}
+
+	if(strstr(commandLine.c_str(), SPRITE_BENCHMARK_SWITCH))
+	{
+		return BenchmarkSprites();
+	}
+
+	if(strstr(commandLine.c_str(), RESIDENCY_TEST_SWITCH))
+	{
+		return TestResidency();
+	}
+
+	if(strstr(commandLine.c_str(), ALLOCATOR_BENCHMARK_SWITCH))
+	{
+		return BenchmarkAllocators();
+	}
+
+	if(strstr(commandLine.c_str(), FRAME_STATS_TEST_SWITCH))
+	{
+		return TestFrameStats();
+	}
+
+	if(strstr(commandLine.c_str(), TEXTURE_BUILD_SWITCH))
+	{
+		return BuildTexture(commandLine.c_str());
+	}
+
+	return RunSystem(commandLine.c_str());
+}
+#endif
@@ -0,0 +1,1097 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	meshbvhclass.cpp
+//
+// summary:	Implements the meshbvhclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "meshbvhclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#ifdef MESH_BVH_SIMD
+#include <xmmintrin.h>
+#endif
+
+// Includes.
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Turns a leaf into the child of a node, and a child back into its leaf. </summary>
+///
+/// <param name="value"> The leaf, or the child. </param>
+///
+/// <returns> The child, or the leaf. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int FlipLeaf(int value)
+{
+	return -2 - value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the surface area of a box given by its corners. </summary>
+///
+/// <param name="minimum"> The lowest corner. </param>
+/// <param name="maximum"> The highest corner. </param>
+///
+/// <returns> The area. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float GetArea(const float* minimum, const float* maximum)
+{
+	float x, y, z;
+
+	x = maximum[0] - minimum[0];
+	y = maximum[1] - minimum[1];
+	z = maximum[2] - minimum[2];
+
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Tests a ray against the four boxes of a node with the slab test. </summary>
+///
+/// <param name="node">		   The node. </param>
+/// <param name="origin">	   The start of the ray. </param>
+/// <param name="inverse">	   One over the direction of the ray, per axis. </param>
+/// <param name="maxDistance"> How far the ray goes, in lengths of the direction. </param>
+/// <param name="distances">   [out] Where the ray enters each box it hits. </param>
+///
+/// <returns> A bit for each box hit. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int TestNode(const MeshBvhNode& node, const SceneVector& origin, const SceneVector& inverse, float maxDistance, float* distances)
+{
+#ifdef MESH_BVH_SIMD
+	__m128 low, high, entry, exit, start, scale;
+
+	start = _mm_set1_ps(origin.x);
+	scale = _mm_set1_ps(inverse.x);
+	low = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minimumX), start), scale);
+	high = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maximumX), start), scale);
+	entry = _mm_min_ps(low, high);
+	exit = _mm_max_ps(low, high);
+
+	start = _mm_set1_ps(origin.y);
+	scale = _mm_set1_ps(inverse.y);
+	low = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minimumY), start), scale);
+	high = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maximumY), start), scale);
+	entry = _mm_max_ps(entry, _mm_min_ps(low, high));
+	exit = _mm_min_ps(exit, _mm_max_ps(low, high));
+
+	start = _mm_set1_ps(origin.z);
+	scale = _mm_set1_ps(inverse.z);
+	low = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minimumZ), start), scale);
+	high = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maximumZ), start), scale);
+	entry = _mm_max_ps(_mm_max_ps(entry, _mm_min_ps(low, high)), _mm_setzero_ps());
+	exit = _mm_min_ps(_mm_min_ps(exit, _mm_max_ps(low, high)), _mm_set1_ps(maxDistance));
+
+	_mm_storeu_ps(distances, entry);
+
+	return _mm_movemask_ps(_mm_cmple_ps(entry, exit));
+#else
+	float low, high, entry, exit;
+	int hits, i;
+
+	hits = 0;
+	for(i=0; i<MESH_BVH_WIDTH; i++)
+	{
+		low = (node.minimumX[i] - origin.x) * inverse.x;
+		high = (node.maximumX[i] - origin.x) * inverse.x;
+		entry = min(low, high);
+		exit = max(low, high);
+
+		low = (node.minimumY[i] - origin.y) * inverse.y;
+		high = (node.maximumY[i] - origin.y) * inverse.y;
+		entry = max(entry, min(low, high));
+		exit = min(exit, max(low, high));
+
+		low = (node.minimumZ[i] - origin.z) * inverse.z;
+		high = (node.maximumZ[i] - origin.z) * inverse.z;
+		entry = max(max(entry, min(low, high)), 0.0f);
+		exit = min(min(exit, max(low, high)), maxDistance);
+
+		distances[i] = entry;
+		hits |= entry <= exit ? 1 << i : 0;
+	}
+
+	return hits;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Tests a ray against the four triangles of a leaf with the Moller-Trumbore test, from
+/// 	either side. An unused triangle has no edges, so its determinant is 0 and it is never hit.
+/// </summary>
+///
+/// <param name="leaf">		   The leaf. </param>
+/// <param name="ray">		   The ray. </param>
+/// <param name="maxDistance"> The nearest hit so far, only nearer ones count. </param>
+/// <param name="hit">		   [out] The nearest hit in the leaf, left alone if there is none. </param>
+///
+/// <returns> true if a triangle was hit nearer than maxDistance. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool TestLeaf(const MeshBvhLeaf& leaf, const MeshRay& ray, float maxDistance, MeshHit& hit)
+{
+	float distances[MESH_BVH_WIDTH], us[MESH_BVH_WIDTH], vs[MESH_BVH_WIDTH];
+	int hits, best, i;
+
+#ifdef MESH_BVH_SIMD
+	__m128 directionX, directionY, directionZ, edge1X, edge1Y, edge1Z, edge2X, edge2Y, edge2Z;
+	__m128 pX, pY, pZ, sX, sY, sZ, qX, qY, qZ, determinant, inverse, u, v, t, zero, valid;
+
+	directionX = _mm_set1_ps(ray.direction.x);
+	directionY = _mm_set1_ps(ray.direction.y);
+	directionZ = _mm_set1_ps(ray.direction.z);
+	edge1X = _mm_loadu_ps(leaf.edge1X);
+	edge1Y = _mm_loadu_ps(leaf.edge1Y);
+	edge1Z = _mm_loadu_ps(leaf.edge1Z);
+	edge2X = _mm_loadu_ps(leaf.edge2X);
+	edge2Y = _mm_loadu_ps(leaf.edge2Y);
+	edge2Z = _mm_loadu_ps(leaf.edge2Z);
+
+	// p = direction x edge2, and the determinant is edge1 . p.
+	pX = _mm_sub_ps(_mm_mul_ps(directionY, edge2Z), _mm_mul_ps(directionZ, edge2Y));
+	pY = _mm_sub_ps(_mm_mul_ps(directionZ, edge2X), _mm_mul_ps(directionX, edge2Z));
+	pZ = _mm_sub_ps(_mm_mul_ps(directionX, edge2Y), _mm_mul_ps(directionY, edge2X));
+	determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edge1X, pX), _mm_mul_ps(edge1Y, pY)), _mm_mul_ps(edge1Z, pZ));
+	inverse = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+	// s goes from the first corner to the origin, q = s x edge1.
+	sX = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_loadu_ps(leaf.cornerX));
+	sY = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_loadu_ps(leaf.cornerY));
+	sZ = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_loadu_ps(leaf.cornerZ));
+	u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sX, pX), _mm_mul_ps(sY, pY)), _mm_mul_ps(sZ, pZ)), inverse);
+
+	qX = _mm_sub_ps(_mm_mul_ps(sY, edge1Z), _mm_mul_ps(sZ, edge1Y));
+	qY = _mm_sub_ps(_mm_mul_ps(sZ, edge1X), _mm_mul_ps(sX, edge1Z));
+	qZ = _mm_sub_ps(_mm_mul_ps(sX, edge1Y), _mm_mul_ps(sY, edge1X));
+	v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(directionX, qX), _mm_mul_ps(directionY, qY)), _mm_mul_ps(directionZ, qZ)), inverse);
+	t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(edge2X, qX), _mm_mul_ps(edge2Y, qY)), _mm_mul_ps(edge2Z, qZ)), inverse);
+
+	// A determinant of 0 makes u not a number, and every comparison with it false.
+	zero = _mm_setzero_ps();
+	valid = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+	valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+	valid = _mm_and_ps(valid, _mm_cmpge_ps(t, zero));
+	valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(maxDistance)));
+
+	hits = _mm_movemask_ps(valid);
+	if(!hits)
+	{
+		return false;
+	}
+
+	_mm_storeu_ps(distances, t);
+	_mm_storeu_ps(us, u);
+	_mm_storeu_ps(vs, v);
+#else
+	float pX, pY, pZ, sX, sY, sZ, qX, qY, qZ, determinant, inverse;
+
+	hits = 0;
+	for(i=0; i<MESH_BVH_WIDTH; i++)
+	{
+		if(leaf.triangles[i] < 0)
+		{
+			continue;
+		}
+
+		pX = ray.direction.y * leaf.edge2Z[i] - ray.direction.z * leaf.edge2Y[i];
+		pY = ray.direction.z * leaf.edge2X[i] - ray.direction.x * leaf.edge2Z[i];
+		pZ = ray.direction.x * leaf.edge2Y[i] - ray.direction.y * leaf.edge2X[i];
+		determinant = leaf.edge1X[i] * pX + leaf.edge1Y[i] * pY + leaf.edge1Z[i] * pZ;
+		if(determinant == 0.0f)
+		{
+			continue;
+		}
+		inverse = 1.0f / determinant;
+
+		sX = ray.origin.x - leaf.cornerX[i];
+		sY = ray.origin.y - leaf.cornerY[i];
+		sZ = ray.origin.z - leaf.cornerZ[i];
+		us[i] = (sX * pX + sY * pY + sZ * pZ) * inverse;
+
+		qX = sY * leaf.edge1Z[i] - sZ * leaf.edge1Y[i];
+		qY = sZ * leaf.edge1X[i] - sX * leaf.edge1Z[i];
+		qZ = sX * leaf.edge1Y[i] - sY * leaf.edge1X[i];
+		vs[i] = (ray.direction.x * qX + ray.direction.y * qY + ray.direction.z * qZ) * inverse;
+		distances[i] = (leaf.edge2X[i] * qX + leaf.edge2Y[i] * qY + leaf.edge2Z[i] * qZ) * inverse;
+
+		if(us[i] >= 0.0f && vs[i] >= 0.0f && us[i] + vs[i] <= 1.0f && distances[i] >= 0.0f && distances[i] < maxDistance)
+		{
+			hits |= 1 << i;
+		}
+	}
+
+	if(!hits)
+	{
+		return false;
+	}
+#endif
+
+	// Keep the nearest of the triangles hit.
+	best = -1;
+	for(i=0; i<MESH_BVH_WIDTH; i++)
+	{
+		if((hits & (1 << i)) && (best < 0 || distances[i] < distances[best]))
+		{
+			best = i;
+		}
+	}
+
+	hit.triangle = leaf.triangles[best];
+	hit.distance = distances[best];
+	hit.u = us[best];
+	hit.v = vs[best];
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The next number of a small random generator, between 0 and 1. </summary>
+///
+/// <param name="seed"> [in,out] The state of the generator. </param>
+///
+/// <returns> The number. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float NextRandom(unsigned int& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+
+	return (seed >> 8) / 16777216.0f;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+MeshBvhClass::MeshBvhClass()
+{
+	memset(&m_bounds, 0, sizeof(SceneBounds));
+	m_triangleCount = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+MeshBvhClass::MeshBvhClass(const MeshBvhClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+MeshBvhClass::~MeshBvhClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds the tree over the triangles of a mesh, replacing the one there was. The triangles
+/// 	are split with the surface area heuristic down to MESH_BVH_SAH_DEPTH levels, and by
+/// 	halves below that so a bad mesh can't make the tree deeper than the stack of a cast.
+/// </summary>
+///
+/// <param name="positions">   The position of the first vertex, three floats. </param>
+/// <param name="stride">	   The bytes from one vertex to the next. </param>
+/// <param name="vertexCount"> The number of vertices. </param>
+/// <param name="indices">	   The indices, three to a triangle. </param>
+/// <param name="indexCount">  The number of indices. </param>
+///
+/// <returns> true if it succeeds, false if the mesh has no triangles or an index out of range. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MeshBvhClass::Build(const float* positions, int stride, int vertexCount, const unsigned long* indices, int indexCount)
+{
+	vector<TriangleType> triangles;
+	vector<int> order;
+	const float* corner;
+	int count, i, j, k;
+
+	PROFILE_FUNCTION();
+
+	Shutdown();
+
+	count = indexCount / 3;
+	if(!positions || !indices || stride < (int)(3 * sizeof(float)) || count <= 0)
+	{
+		return false;
+	}
+
+	triangles.resize(count);
+	order.resize(count);
+	for(i=0; i<count; i++)
+	{
+		for(k=0; k<3; k++)
+		{
+			triangles[i].minimum[k] = FLT_MAX;
+			triangles[i].maximum[k] = -FLT_MAX;
+		}
+
+		for(j=0; j<3; j++)
+		{
+			if(indices[i * 3 + j] >= (unsigned long)vertexCount)
+			{
+				return false;
+			}
+
+			corner = (const float*)((const char*)positions + indices[i * 3 + j] * stride);
+			for(k=0; k<3; k++)
+			{
+				triangles[i].corners[j][k] = corner[k];
+				triangles[i].minimum[k] = min(triangles[i].minimum[k], corner[k]);
+				triangles[i].maximum[k] = max(triangles[i].maximum[k], corner[k]);
+			}
+		}
+
+		for(k=0; k<3; k++)
+		{
+			triangles[i].center[k] = (triangles[i].minimum[k] + triangles[i].maximum[k]) * 0.5f;
+		}
+		order[i] = i;
+	}
+
+	m_nodes.reserve(count / 2 + 1);
+	m_leaves.reserve(count / 2 + 1);
+	BuildNode(triangles, &order[0], count, 0);
+	m_triangleCount = count;
+
+	// The box of the mesh is the box of the children of the root.
+	m_bounds.center.x = (*min_element(m_nodes[0].minimumX, m_nodes[0].minimumX + MESH_BVH_WIDTH) + *max_element(m_nodes[0].maximumX, m_nodes[0].maximumX + MESH_BVH_WIDTH)) * 0.5f;
+	m_bounds.center.y = (*min_element(m_nodes[0].minimumY, m_nodes[0].minimumY + MESH_BVH_WIDTH) + *max_element(m_nodes[0].maximumY, m_nodes[0].maximumY + MESH_BVH_WIDTH)) * 0.5f;
+	m_bounds.center.z = (*min_element(m_nodes[0].minimumZ, m_nodes[0].minimumZ + MESH_BVH_WIDTH) + *max_element(m_nodes[0].maximumZ, m_nodes[0].maximumZ + MESH_BVH_WIDTH)) * 0.5f;
+	m_bounds.center.w = 0.0f;
+	m_bounds.extents.x = *max_element(m_nodes[0].maximumX, m_nodes[0].maximumX + MESH_BVH_WIDTH) - m_bounds.center.x;
+	m_bounds.extents.y = *max_element(m_nodes[0].maximumY, m_nodes[0].maximumY + MESH_BVH_WIDTH) - m_bounds.center.y;
+	m_bounds.extents.z = *max_element(m_nodes[0].maximumZ, m_nodes[0].maximumZ + MESH_BVH_WIDTH) - m_bounds.center.z;
+	m_bounds.extents.w = 0.0f;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the tree. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void MeshBvhClass::Shutdown()
+{
+	vector<MeshBvhNode>().swap(m_nodes);
+	vector<MeshBvhLeaf>().swap(m_leaves);
+	memset(&m_bounds, 0, sizeof(SceneBounds));
+	m_triangleCount = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Trades trees with another one, so a tree built on a worker is put in place at once. </summary>
+///
+/// <param name="other"> [in,out] The other tree. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void MeshBvhClass::Swap(MeshBvhClass& other)
+{
+	m_nodes.swap(other.m_nodes);
+	m_leaves.swap(other.m_leaves);
+	swap(m_bounds, other.m_bounds);
+	swap(m_triangleCount, other.m_triangleCount);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the nearest triangle a ray hits. </summary>
+///
+/// <param name="ray"> The ray, in the space of the mesh. </param>
+/// <param name="hit"> [out] The hit, with a triangle of -1 if there is none. </param>
+///
+/// <returns> true if the ray hits the mesh. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MeshBvhClass::Intersect(const MeshRay& ray, MeshHit& hit)
+{
+	return Cast(ray, hit, false);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds if a ray hits the mesh at all, stopping at the first triangle it finds. </summary>
+///
+/// <param name="ray"> The ray, in the space of the mesh. </param>
+///
+/// <returns> true if the ray hits the mesh. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MeshBvhClass::IntersectAny(const MeshRay& ray)
+{
+	MeshHit hit;
+
+	return Cast(ray, hit, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the nearest triangle many rays hit, split between the workers when there are enough of them. </summary>
+///
+/// <param name="rays">	   The rays. </param>
+/// <param name="count">   The number of rays. </param>
+/// <param name="hits">	   [out] The hit of each ray, with a triangle of -1 for a miss. </param>
+/// <param name="workers"> The number of workers to run on, 0 runs on the calling thread, -1 on every core. </param>
+///
+/// <returns> The number of rays that hit the mesh. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int MeshBvhClass::IntersectBatch(const MeshRay* rays, int count, MeshHit* hits, int workers)
+{
+	int first, result, i;
+	bool done;
+
+	PROFILE_FUNCTION();
+
+	done = false;
+	if(workers != 0 && count >= MESH_BVH_PARALLEL_RAYS)
+	{
+		TaskGraphClass tasks;
+
+		for(first=0; first<count; first+=MESH_BVH_RAYS_PER_TASK)
+		{
+			tasks.AddTask("MeshBvhClass::IntersectBatch", [this, rays, hits, first, count]() -> bool
+			{
+				int i;
+
+				for(i=first; i<first + MESH_BVH_RAYS_PER_TASK && i<count; i++)
+				{
+					Cast(rays[i], hits[i], false);
+				}
+				return true;
+			});
+		}
+
+		done = tasks.Run(workers);
+	}
+
+	// Without the workers the rays are cast here.
+	if(!done)
+	{
+		for(i=0; i<count; i++)
+		{
+			Cast(rays[i], hits[i], false);
+		}
+	}
+
+	result = 0;
+	for(i=0; i<count; i++)
+	{
+		result += hits[i].triangle >= 0 ? 1 : 0;
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the box around the mesh. </summary>
+///
+/// <param name="bounds"> [out] The box. </param>
+///
+/// <returns> false if there is no tree. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MeshBvhClass::GetBounds(SceneBounds& bounds)
+{
+	bounds = m_bounds;
+
+	return !m_nodes.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of triangles in the tree. </summary>
+///
+/// <returns> The number of triangles. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int MeshBvhClass::GetTriangleCount()
+{
+	return m_triangleCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of nodes in the tree. </summary>
+///
+/// <returns> The number of nodes. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int MeshBvhClass::GetNodeCount()
+{
+	return (int)m_nodes.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of leaves in the tree. </summary>
+///
+/// <returns> The number of leaves. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int MeshBvhClass::GetLeafCount()
+{
+	return (int)m_leaves.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds a tree over a rolling terrain of about as many triangles as asked and casts a
+/// 	million rays at it each way. The hits of the first rays are checked against testing
+/// 	every leaf, and the hits on the workers against the ones on one thread.
+/// </summary>
+///
+/// <param name="triangles"> The number of triangles of the terrain. </param>
+/// <param name="result">	 [out] The times. </param>
+///
+/// <returns> true if the casts found what they should, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MeshBvhClass::Benchmark(int triangles, MeshBvhBenchmark& result)
+{
+	const float Spacing = 1.0f;
+	const float Height = 50.0f;
+	MeshBvhClass bvh;
+	vector<float> positions;
+	vector<unsigned long> indices;
+	vector<MeshRay> downRays, acrossRays;
+	vector<MeshHit> hits, parallelHits;
+	MeshHit expected;
+	unsigned long long start;
+	unsigned int seed;
+	float x, z, length, size;
+	int side, count, found, i, j;
+	bool correct;
+
+	memset(&result, 0, sizeof(MeshBvhBenchmark));
+
+	side = (int)sqrtf(triangles * 0.5f);
+	if(side <= 0)
+	{
+		return false;
+	}
+
+	// A grid of two triangles to a square, with hills and a little noise on them.
+	size = side * Spacing;
+	positions.resize((side + 1) * (side + 1) * 3);
+	for(i=0; i<=side; i++)
+	{
+		for(j=0; j<=side; j++)
+		{
+			x = j * Spacing;
+			z = i * Spacing;
+			positions[(i * (side + 1) + j) * 3] = x;
+			positions[(i * (side + 1) + j) * 3 + 1] = sinf(x * 0.05f) * cosf(z * 0.07f) * 8.0f + sinf(x * 0.31f + z * 0.17f) * 1.5f;
+			positions[(i * (side + 1) + j) * 3 + 2] = z;
+		}
+	}
+
+	indices.reserve(side * side * 6);
+	for(i=0; i<side; i++)
+	{
+		for(j=0; j<side; j++)
+		{
+			indices.push_back(i * (side + 1) + j);
+			indices.push_back((i + 1) * (side + 1) + j);
+			indices.push_back(i * (side + 1) + j + 1);
+			indices.push_back(i * (side + 1) + j + 1);
+			indices.push_back((i + 1) * (side + 1) + j);
+			indices.push_back((i + 1) * (side + 1) + j + 1);
+		}
+	}
+
+	start = ProfilerClass::GetTimestamp();
+	if(!bvh.Build(&positions[0], 3 * sizeof(float), (side + 1) * (side + 1), &indices[0], (int)indices.size()))
+	{
+		return false;
+	}
+	result.buildMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+	result.triangles = bvh.GetTriangleCount();
+	result.nodes = bvh.GetNodeCount();
+	result.leaves = bvh.GetLeafCount();
+
+	// Rays down on the terrain from above, a little slanted, and rays across it close to the ground.
+	seed = 8765;
+	count = MESH_BVH_BENCHMARK_RAYS;
+	downRays.resize(count);
+	acrossRays.resize(count);
+	for(i=0; i<count; i++)
+	{
+		downRays[i].origin.x = NextRandom(seed) * size;
+		downRays[i].origin.y = Height;
+		downRays[i].origin.z = NextRandom(seed) * size;
+		downRays[i].origin.w = 1.0f;
+		downRays[i].direction.x = (NextRandom(seed) * 2.0f - 1.0f) * 0.2f;
+		downRays[i].direction.y = -1.0f;
+		downRays[i].direction.z = (NextRandom(seed) * 2.0f - 1.0f) * 0.2f;
+		downRays[i].direction.w = 0.0f;
+		downRays[i].maxDistance = Height * 2.0f;
+
+		acrossRays[i].origin.x = NextRandom(seed) * size;
+		acrossRays[i].origin.y = 10.0f + NextRandom(seed) * 10.0f;
+		acrossRays[i].origin.z = NextRandom(seed) * size;
+		acrossRays[i].origin.w = 1.0f;
+		acrossRays[i].direction.x = NextRandom(seed) * 2.0f - 1.0f;
+		acrossRays[i].direction.y = -0.3f + NextRandom(seed) * 0.4f;
+		acrossRays[i].direction.z = NextRandom(seed) * 2.0f - 1.0f;
+		acrossRays[i].direction.w = 0.0f;
+		length = sqrtf(acrossRays[i].direction.x * acrossRays[i].direction.x + acrossRays[i].direction.y * acrossRays[i].direction.y + acrossRays[i].direction.z * acrossRays[i].direction.z);
+		acrossRays[i].direction.x /= length;
+		acrossRays[i].direction.y /= length;
+		acrossRays[i].direction.z /= length;
+		acrossRays[i].maxDistance = size;
+	}
+
+	hits.resize(count);
+	parallelHits.resize(count);
+	correct = true;
+
+	start = ProfilerClass::GetTimestamp();
+	for(i=0; i<count; i++)
+	{
+		bvh.Intersect(downRays[i], hits[i]);
+	}
+	result.downRaysPerSecond = count / (ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start) * 0.001);
+
+	start = ProfilerClass::GetTimestamp();
+	bvh.IntersectBatch(&downRays[0], count, &parallelHits[0]);
+	result.parallelRaysPerSecond = count / (ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start) * 0.001);
+
+	for(i=0; i<count; i++)
+	{
+		correct = correct && hits[i].triangle == parallelHits[i].triangle && hits[i].distance == parallelHits[i].distance;
+	}
+
+	// Check the first ones against every leaf; the slanted rays near the edges miss the terrain.
+	for(i=0; i<MESH_BVH_BENCHMARK_CHECKED; i++)
+	{
+		expected.triangle = -1;
+		expected.distance = downRays[i].maxDistance;
+		for(j=0; j<(int)bvh.m_leaves.size(); j++)
+		{
+			TestLeaf(bvh.m_leaves[j], downRays[i], expected.distance, expected);
+		}
+		if(expected.triangle < 0)
+		{
+			correct = correct && hits[i].triangle < 0;
+		}
+		else
+		{
+			correct = correct && hits[i].triangle >= 0 && fabsf(expected.distance - hits[i].distance) <= 1e-4f * max(1.0f, expected.distance);
+		}
+	}
+
+	start = ProfilerClass::GetTimestamp();
+	for(i=0; i<count; i++)
+	{
+		bvh.Intersect(acrossRays[i], hits[i]);
+	}
+	result.acrossRaysPerSecond = count / (ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start) * 0.001);
+
+	found = 0;
+	start = ProfilerClass::GetTimestamp();
+	for(i=0; i<count; i++)
+	{
+		found += bvh.IntersectAny(acrossRays[i]) ? 1 : 0;
+	}
+	result.anyRaysPerSecond = count / (ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start) * 0.001);
+
+	// Any hit must agree with the nearest one on whether there is a hit at all.
+	for(i=0; i<count; i++)
+	{
+		found -= hits[i].triangle >= 0 ? 1 : 0;
+	}
+	correct = correct && found == 0;
+
+	for(i=0; i<MESH_BVH_BENCHMARK_CHECKED; i++)
+	{
+		expected.triangle = -1;
+		expected.distance = acrossRays[i].maxDistance;
+		for(j=0; j<(int)bvh.m_leaves.size(); j++)
+		{
+			TestLeaf(bvh.m_leaves[j], acrossRays[i], expected.distance, expected);
+		}
+		if(expected.triangle < 0)
+		{
+			correct = correct && hits[i].triangle < 0;
+		}
+		else
+		{
+			correct = correct && hits[i].triangle >= 0 && fabsf(expected.distance - hits[i].distance) <= 1e-4f * max(1.0f, expected.distance);
+		}
+	}
+
+	bvh.Shutdown();
+
+	return correct;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds a subtree over some triangles. The triangles are split in two, then the larger part
+/// 	again, until there are four parts or none left of more than four triangles; every part
+/// 	of four triangles or less is a leaf, every other one a child node built the same way.
+/// </summary>
+///
+/// <param name="triangles"> The triangles of the mesh. </param>
+/// <param name="order">	 [in,out] The triangles of the subtree, reordered. </param>
+/// <param name="count">	 The number of triangles. </param>
+/// <param name="depth">	 The depth of the subtree. </param>
+///
+/// <returns> The root node of the subtree. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int MeshBvhClass::BuildNode(vector<TriangleType>& triangles, int* order, int count, int depth)
+{
+	MeshBvhNode empty;
+	float minimum[3], maximum[3];
+	int starts[MESH_BVH_WIDTH], counts[MESH_BVH_WIDTH];
+	int node, parts, largest, split, child, i, j, k;
+
+	memset(&empty, 0, sizeof(MeshBvhNode));
+	for(i=0; i<MESH_BVH_WIDTH; i++)
+	{
+		empty.children[i] = MESH_BVH_EMPTY_SLOT;
+	}
+
+	node = (int)m_nodes.size();
+	m_nodes.push_back(empty);
+
+	parts = 1;
+	starts[0] = 0;
+	counts[0] = count;
+	while(parts < MESH_BVH_WIDTH)
+	{
+		largest = -1;
+		for(i=0; i<parts; i++)
+		{
+			if(counts[i] > MESH_BVH_WIDTH && (largest < 0 || counts[i] > counts[largest]))
+			{
+				largest = i;
+			}
+		}
+		if(largest < 0)
+		{
+			break;
+		}
+
+		split = SplitTriangles(triangles, order + starts[largest], counts[largest], depth);
+		starts[parts] = starts[largest] + split;
+		counts[parts] = counts[largest] - split;
+		counts[largest] = split;
+		parts++;
+	}
+
+	for(i=0; i<parts; i++)
+	{
+		for(k=0; k<3; k++)
+		{
+			minimum[k] = FLT_MAX;
+			maximum[k] = -FLT_MAX;
+		}
+		for(j=starts[i]; j<starts[i] + counts[i]; j++)
+		{
+			for(k=0; k<3; k++)
+			{
+				minimum[k] = min(minimum[k], triangles[order[j]].minimum[k]);
+				maximum[k] = max(maximum[k], triangles[order[j]].maximum[k]);
+			}
+		}
+
+		// The nodes move as the children are added, so the node is only looked up after.
+		if(counts[i] <= MESH_BVH_WIDTH)
+		{
+			child = FlipLeaf(BuildLeaf(triangles, order + starts[i], counts[i]));
+		}
+		else
+		{
+			child = BuildNode(triangles, order + starts[i], counts[i], depth + 1);
+		}
+
+		m_nodes[node].minimumX[i] = minimum[0];
+		m_nodes[node].minimumY[i] = minimum[1];
+		m_nodes[node].minimumZ[i] = minimum[2];
+		m_nodes[node].maximumX[i] = maximum[0];
+		m_nodes[node].maximumY[i] = maximum[1];
+		m_nodes[node].maximumZ[i] = maximum[2];
+		m_nodes[node].children[i] = child;
+	}
+
+	return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Splits triangles in two along the longest axis of their centers. Above MESH_BVH_SAH_DEPTH
+/// 	the split is at the bin boundary with the lowest surface area cost, below it in halves
+/// 	by count; halves too when every center is in one bin.
+/// </summary>
+///
+/// <param name="triangles"> The triangles of the mesh. </param>
+/// <param name="order">	 [in,out] The triangles to split, reordered so the first part comes first. </param>
+/// <param name="count">	 The number of triangles, 2 or more. </param>
+/// <param name="depth">	 The depth of the node being built. </param>
+///
+/// <returns> The number of triangles in the first part, between 1 and count - 1. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int MeshBvhClass::SplitTriangles(vector<TriangleType>& triangles, int* order, int count, int depth)
+{
+	float binMinimum[MESH_BVH_BINS][3], binMaximum[MESH_BVH_BINS][3], leftAreas[MESH_BVH_BINS];
+	float minimum[3], maximum[3], scale, origin, cost, bestCost;
+	int binCounts[MESH_BVH_BINS], leftCounts[MESH_BVH_BINS];
+	int axis, bin, best, split, total, i, k;
+	const TriangleType* triangle;
+	int* middle;
+
+	// Find the spread of the centers.
+	for(k=0; k<3; k++)
+	{
+		minimum[k] = FLT_MAX;
+		maximum[k] = -FLT_MAX;
+	}
+	for(i=0; i<count; i++)
+	{
+		triangle = &triangles[order[i]];
+		for(k=0; k<3; k++)
+		{
+			minimum[k] = min(minimum[k], triangle->center[k]);
+			maximum[k] = max(maximum[k], triangle->center[k]);
+		}
+	}
+
+	axis = 0;
+	for(k=1; k<3; k++)
+	{
+		if(maximum[k] - minimum[k] > maximum[axis] - minimum[axis])
+		{
+			axis = k;
+		}
+	}
+
+	if(depth >= MESH_BVH_SAH_DEPTH || maximum[axis] - minimum[axis] <= 0.0f)
+	{
+		nth_element(order, order + count / 2, order + count, [&triangles, axis](int first, int second) -> bool
+		{
+			return triangles[first].center[axis] < triangles[second].center[axis];
+		});
+		return count / 2;
+	}
+
+	// Drop every triangle in the bin of its center, growing the box of the bin.
+	for(bin=0; bin<MESH_BVH_BINS; bin++)
+	{
+		binCounts[bin] = 0;
+		for(k=0; k<3; k++)
+		{
+			binMinimum[bin][k] = FLT_MAX;
+			binMaximum[bin][k] = -FLT_MAX;
+		}
+	}
+
+	origin = minimum[axis];
+	scale = MESH_BVH_BINS / (maximum[axis] - origin);
+	for(i=0; i<count; i++)
+	{
+		triangle = &triangles[order[i]];
+		bin = min((int)((triangle->center[axis] - origin) * scale), MESH_BVH_BINS - 1);
+
+		binCounts[bin]++;
+		for(k=0; k<3; k++)
+		{
+			binMinimum[bin][k] = min(binMinimum[bin][k], triangle->minimum[k]);
+			binMaximum[bin][k] = max(binMaximum[bin][k], triangle->maximum[k]);
+		}
+	}
+
+	// Sweep from the left for the area and count left of every boundary, then from the right for the cost.
+	for(k=0; k<3; k++)
+	{
+		minimum[k] = FLT_MAX;
+		maximum[k] = -FLT_MAX;
+	}
+	total = 0;
+	for(bin=0; bin<MESH_BVH_BINS - 1; bin++)
+	{
+		total += binCounts[bin];
+		for(k=0; k<3; k++)
+		{
+			minimum[k] = min(minimum[k], binMinimum[bin][k]);
+			maximum[k] = max(maximum[k], binMaximum[bin][k]);
+		}
+		leftCounts[bin] = total;
+		leftAreas[bin] = total > 0 ? GetArea(minimum, maximum) : 0.0f;
+	}
+
+	for(k=0; k<3; k++)
+	{
+		minimum[k] = FLT_MAX;
+		maximum[k] = -FLT_MAX;
+	}
+	total = 0;
+	best = -1;
+	bestCost = FLT_MAX;
+	for(bin=MESH_BVH_BINS - 1; bin>0; bin--)
+	{
+		total += binCounts[bin];
+		for(k=0; k<3; k++)
+		{
+			minimum[k] = min(minimum[k], binMinimum[bin][k]);
+			maximum[k] = max(maximum[k], binMaximum[bin][k]);
+		}
+
+		if(total == 0 || leftCounts[bin - 1] == 0)
+		{
+			continue;
+		}
+
+		cost = leftAreas[bin - 1] * leftCounts[bin - 1] + GetArea(minimum, maximum) * total;
+		if(cost < bestCost)
+		{
+			bestCost = cost;
+			best = bin;
+		}
+	}
+
+	if(best < 0)
+	{
+		return count / 2;
+	}
+
+	// Everything in the bins left of the best boundary goes first.
+	middle = partition(order, order + count, [&triangles, axis, origin, scale, best](int index) -> bool
+	{
+		return min((int)((triangles[index].center[axis] - origin) * scale), MESH_BVH_BINS - 1) < best;
+	});
+	split = (int)(middle - order);
+
+	return split > 0 && split < count ? split : count / 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Makes a leaf of up to four triangles, keeping their first corner and their edges. </summary>
+///
+/// <param name="triangles"> The triangles of the mesh. </param>
+/// <param name="order">	 The triangles of the leaf. </param>
+/// <param name="count">	 The number of triangles, 1 to 4. </param>
+///
+/// <returns> The leaf. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int MeshBvhClass::BuildLeaf(vector<TriangleType>& triangles, int* order, int count)
+{
+	MeshBvhLeaf leaf;
+	const TriangleType* triangle;
+	int i;
+
+	// The unused triangles are left at 0, with no edges.
+	memset(&leaf, 0, sizeof(MeshBvhLeaf));
+	for(i=0; i<MESH_BVH_WIDTH; i++)
+	{
+		leaf.triangles[i] = -1;
+	}
+
+	for(i=0; i<count; i++)
+	{
+		triangle = &triangles[order[i]];
+		leaf.cornerX[i] = triangle->corners[0][0];
+		leaf.cornerY[i] = triangle->corners[0][1];
+		leaf.cornerZ[i] = triangle->corners[0][2];
+		leaf.edge1X[i] = triangle->corners[1][0] - triangle->corners[0][0];
+		leaf.edge1Y[i] = triangle->corners[1][1] - triangle->corners[0][1];
+		leaf.edge1Z[i] = triangle->corners[1][2] - triangle->corners[0][2];
+		leaf.edge2X[i] = triangle->corners[2][0] - triangle->corners[0][0];
+		leaf.edge2Y[i] = triangle->corners[2][1] - triangle->corners[0][1];
+		leaf.edge2Z[i] = triangle->corners[2][2] - triangle->corners[0][2];
+		leaf.triangles[i] = order[i];
+	}
+
+	m_leaves.push_back(leaf);
+
+	return (int)m_leaves.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Casts a ray down the tree. The leaves of a node are tested as soon as it is, so the
+/// 	nearest hit so far shrinks the ray before its child nodes are; those go on the stack
+/// 	farthest first, and one that starts past the nearest hit is dropped when it comes off.
+/// </summary>
+///
+/// <param name="ray"> The ray, in the space of the mesh. </param>
+/// <param name="hit"> [out] The nearest hit, with a triangle of -1 if there is none. </param>
+/// <param name="any"> true to stop at the first hit, which might not be the nearest. </param>
+///
+/// <returns> true if the ray hits the mesh. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool MeshBvhClass::Cast(const MeshRay& ray, MeshHit& hit, bool any)
+{
+	int stack[MESH_BVH_STACK_SIZE], nearNodes[MESH_BVH_WIDTH];
+	float entries[MESH_BVH_STACK_SIZE], nearEntries[MESH_BVH_WIDTH], distances[MESH_BVH_WIDTH];
+	SceneVector inverse;
+	float best, entry;
+	int count, node, hits, child, nearCount, slot, i, j;
+
+	hit.triangle = -1;
+	hit.distance = ray.maxDistance;
+	hit.u = 0.0f;
+	hit.v = 0.0f;
+	if(m_nodes.empty())
+	{
+		return false;
+	}
+
+	// A direction of 0 on an axis gives an infinite slab, the ray never leaves it if it starts in it.
+	inverse.x = ray.direction.x != 0.0f ? 1.0f / ray.direction.x : FLT_MAX;
+	inverse.y = ray.direction.y != 0.0f ? 1.0f / ray.direction.y : FLT_MAX;
+	inverse.z = ray.direction.z != 0.0f ? 1.0f / ray.direction.z : FLT_MAX;
+	inverse.w = 0.0f;
+
+	best = ray.maxDistance;
+	stack[0] = 0;
+	entries[0] = 0.0f;
+	count = 1;
+	while(count > 0)
+	{
+		count--;
+		if(entries[count] > best)
+		{
+			continue;
+		}
+		node = stack[count];
+
+		hits = TestNode(m_nodes[node], ray.origin, inverse, best, distances);
+		nearCount = 0;
+		for(slot=0; slot<MESH_BVH_WIDTH; slot++)
+		{
+			child = m_nodes[node].children[slot];
+			if(child == MESH_BVH_EMPTY_SLOT || !(hits & (1 << slot)))
+			{
+				continue;
+			}
+
+			if(child < MESH_BVH_EMPTY_SLOT)
+			{
+				if(TestLeaf(m_leaves[FlipLeaf(child)], ray, best, hit))
+				{
+					if(any)
+					{
+						return true;
+					}
+					best = hit.distance;
+				}
+			}
+			else
+			{
+				// Keep the child nodes sorted farthest first.
+				entry = distances[slot];
+				for(i=nearCount; i>0 && nearEntries[i - 1] < entry; i--)
+				{
+					nearNodes[i] = nearNodes[i - 1];
+					nearEntries[i] = nearEntries[i - 1];
+				}
+				nearNodes[i] = child;
+				nearEntries[i] = entry;
+				nearCount++;
+			}
+		}
+
+		for(j=0; j<nearCount; j++)
+		{
+			stack[count] = nearNodes[j];
+			entries[count] = nearEntries[j];
+			count++;
+		}
+	}
+
+	return hit.triangle >= 0;
+}
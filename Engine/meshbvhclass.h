@@ -0,0 +1,174 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	meshbvhclass.h
+//
+// summary:	Declares the meshbvhclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _MESHBVHCLASS_H_
+#define _MESHBVHCLASS_H_
+
+// Pre-processing directives.
+// Four boxes, or four triangles, are tested against a ray at once with SSE where the compiler has it, one by one elsewhere.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#define MESH_BVH_SIMD
+#endif
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "sceneclass.h"
+
+// Globals.
+const int MESH_BVH_WIDTH = 4;
+const int MESH_BVH_BINS = 16;
+const int MESH_BVH_EMPTY_SLOT = -1;
+const int MESH_BVH_SAH_DEPTH = 40;
+const int MESH_BVH_STACK_SIZE = 256;
+const int MESH_BVH_RAYS_PER_TASK = 1024;
+const int MESH_BVH_PARALLEL_RAYS = 4096;
+const int MESH_BVH_BENCHMARK_SMALL = 100000;
+const int MESH_BVH_BENCHMARK_LARGE = 1000000;
+const int MESH_BVH_BENCHMARK_RAYS = 1000000;
+const int MESH_BVH_BENCHMARK_CHECKED = 500;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A node: the boxes of its four children, as corners with one array per axis so the four
+/// 	are tested in one go, and what each child is. A child is a node if it is 0 or more, a
+/// 	leaf if it is below MESH_BVH_EMPTY_SLOT (-2 is leaf 0, -3 leaf 1...).
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshBvhNode
+{
+	float minimumX[MESH_BVH_WIDTH];
+	float minimumY[MESH_BVH_WIDTH];
+	float minimumZ[MESH_BVH_WIDTH];
+	float maximumX[MESH_BVH_WIDTH];
+	float maximumY[MESH_BVH_WIDTH];
+	float maximumZ[MESH_BVH_WIDTH];
+	int children[MESH_BVH_WIDTH];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A leaf: up to four triangles, as their first corner and the two edges from it with one
+/// 	array per axis, and the index of each triangle in the mesh, -1 for an unused one.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshBvhLeaf
+{
+	float cornerX[MESH_BVH_WIDTH];
+	float cornerY[MESH_BVH_WIDTH];
+	float cornerZ[MESH_BVH_WIDTH];
+	float edge1X[MESH_BVH_WIDTH];
+	float edge1Y[MESH_BVH_WIDTH];
+	float edge1Z[MESH_BVH_WIDTH];
+	float edge2X[MESH_BVH_WIDTH];
+	float edge2Y[MESH_BVH_WIDTH];
+	float edge2Z[MESH_BVH_WIDTH];
+	int triangles[MESH_BVH_WIDTH];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> A ray: where it starts, where it goes and how far, in lengths of the direction. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshRay
+{
+	SceneVector origin;
+	SceneVector direction;
+	float maxDistance;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Where a ray hits a mesh: the index of the triangle, -1 for a miss, how far along the ray
+/// 	and where on the triangle, as the weights of its second and third corners.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshHit
+{
+	int triangle;
+	float distance;
+	float u;
+	float v;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	What one benchmark measured on a rolling terrain: the build in ms, and in rays per second
+/// 	on one thread the closest hit of rays cast down on it from above, of rays cast across it
+/// 	from anywhere and of the same rays only looking for any hit, then the closest hits of the
+/// 	rays from above on the workers.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshBvhBenchmark
+{
+	int triangles;
+	int nodes;
+	int leaves;
+	double buildMs;
+	double downRaysPerSecond;
+	double acrossRaysPerSecond;
+	double anyRaysPerSecond;
+	double parallelRaysPerSecond;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A bounding volume hierarchy over the triangles of one mesh, four children to a node and
+/// 	up to four triangles to a leaf, built once with the surface area heuristic when the mesh
+/// 	is loaded. The mesh never changes afterwards, so there is nothing to refit; a new mesh
+/// 	builds a new tree.
+///
+/// 	Intersect finds the nearest triangle a ray hits, going down the nearest child first and
+/// 	skipping every box that starts past the nearest hit so far; IntersectAny stops at the
+/// 	first one, for the line of sight. Both sides of a triangle are hit. IntersectBatch casts
+/// 	many rays on the workers. Nothing is written while casting, so any thread can cast.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class MeshBvhClass
+{
+private:
+	struct TriangleType
+	{
+		float corners[3][3];
+		float minimum[3];
+		float maximum[3];
+		float center[3];
+	};
+
+public:
+	MeshBvhClass();
+	MeshBvhClass(const MeshBvhClass&);
+	~MeshBvhClass();
+
+	bool Build(const float*, int, int, const unsigned long*, int);
+	void Shutdown();
+	void Swap(MeshBvhClass&);
+
+	bool Intersect(const MeshRay&, MeshHit&);
+	bool IntersectAny(const MeshRay&);
+	int IntersectBatch(const MeshRay*, int, MeshHit*, int = -1);
+
+	bool GetBounds(SceneBounds&);
+	int GetTriangleCount();
+	int GetNodeCount();
+	int GetLeafCount();
+
+	static bool Benchmark(int, MeshBvhBenchmark&);
+
+private:
+	int BuildNode(vector<TriangleType>&, int*, int, int);
+	int SplitTriangles(vector<TriangleType>&, int*, int, int);
+	int BuildLeaf(vector<TriangleType>&, int*, int);
+	bool Cast(const MeshRay&, MeshHit&, bool);
+
+private:
+	vector<MeshBvhNode> m_nodes;
+	vector<MeshBvhLeaf> m_leaves;
+	SceneBounds m_bounds;
+	int m_triangleCount;
+};
+
+#endif
@@ -1,9 +1,22 @@
 #include "modelclass.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
 ModelClass::ModelClass()
 {
-	m_vertexBuffer = 0;
-	m_indexBuffer = 0;
+	m_geometryPool = 0;
+	m_geometryHandle = -1;
+	m_vertices = 0;
+	m_indices = 0;
+	m_vertexCount = 0;
+	m_indexCount = 0;
+	m_decodedVertices = 0;
+	m_decodedIndices = 0;
+	m_decodedVertexCount = 0;
+	m_decodedIndexCount = 0;
+	m_texture = 0;
 }
 
 ModelClass::ModelClass(const ModelClass& other)
@@ -15,12 +28,19 @@ ModelClass::~ModelClass()
 {
 }
 
-bool ModelClass::Initialize(ID3D11Device* device)
+bool ModelClass::Initialize(GeometryPoolClass* geometryPool)
 {
 	bool result;
 
+	// Keep the geometry pool, the model geometry lives in its shared buffers.
+	m_geometryPool = geometryPool;
+	if(!m_geometryPool)
+	{
+		return false;
+	}
+
 	// Initialize the vertex and index buffer that hold the geometry for the triangle.
-	result = InitializeBuffers(device);
+	result = InitializeBuffers();
 	if(!result)
 	{
 		return false;
@@ -56,15 +76,148 @@ int ModelClass::GetIndexCount()
 	return m_indexCount;
 }
 
-bool ModelClass::InitializeBuffers(ID3D11Device* device)
+/*
+	The model shares its buffers with other models, so the draw also needs to know where its indices start and where its vertices start. 
+	They are asked to the pool every time since a defragmentation may have moved them.
+*/
+int ModelClass::GetStartIndex()
+{
+	GeometryDraw draw;
+
+	if(!m_geometryPool || !m_geometryPool->GetDraw(m_geometryHandle, draw))
+	{
+		return 0;
+	}
+
+	return (int)draw.startIndex;
+}
+
+int ModelClass::GetBaseVertex()
+{
+	GeometryDraw draw;
+
+	if(!m_geometryPool || !m_geometryPool->GetDraw(m_geometryHandle, draw))
+	{
+		return 0;
+	}
+
+	return draw.baseVertex;
+}
+
+int ModelClass::GetGeometryHandle()
+{
+	return m_geometryHandle;
+}
+
+int ModelClass::GetVertexCount()
+{
+	return m_vertexCount;
+}
+
+int ModelClass::GetVertexStride()
+{
+	return sizeof(VertexType);
+}
+
+/*
+	Copies the model geometry into arrays provided by the caller, used by the static batcher to merge models at load time. 
+	The vertices must have room for GetVertexCount() * GetVertexStride() bytes and the indices for GetIndexCount() entries. 
+	Every vertex starts with its position, so the caller can transform it without knowing the rest of the layout.
+*/
+bool ModelClass::CopyGeometry(void* vertices, unsigned long* indices)
+{
+	if(!vertices || !indices || !m_vertices || !m_indices)
+	{
+		return false;
+	}
+
+	memcpy(vertices, m_vertices, m_vertexCount * sizeof(VertexType));
+	memcpy(indices, m_indices, m_indexCount * sizeof(unsigned long));
+
+	return true;
+}
+
+/*
+	Gets the box around the model in its own space, the entities cull with it. 
+	It is measured from the geometry kept in memory, so it follows the model when the real geometry is swapped in.
+*/
+bool ModelClass::GetBounds(D3DXVECTOR3& minimum, D3DXVECTOR3& maximum)
+{
+	int i;
+
+	if(!m_vertices || m_vertexCount <= 0)
+	{
+		return false;
+	}
+
+	minimum = m_vertices[0].position;
+	maximum = m_vertices[0].position;
+	for(i=1; i<m_vertexCount; i++)
+	{
+		D3DXVec3Minimize(&minimum, &minimum, &m_vertices[i].position);
+		D3DXVec3Maximize(&maximum, &maximum, &m_vertices[i].position);
+	}
+
+	return true;
+}
+
+/*
+	Gets the position of the first vertex kept in memory, the next ones are GetVertexStride() bytes apart. 
+	The occlusion culler rasterizes them, it must not keep them: they are released when the real geometry is swapped in.
+*/
+const float* ModelClass::GetPositions()
+{
+	if(!m_vertices)
+	{
+		return 0;
+	}
+
+	return (const float*)&m_vertices[0].position;
+}
+
+/*
+	Gets the indices kept in memory, GetIndexCount() of them. 
+*/
+const unsigned long* ModelClass::GetIndices()
 {
-	VertexType *vertices;
-	unsigned long *indices;
-	D3D11_BUFFER_DESC vertexBufferDesc;
-	D3D11_BUFFER_DESC indexBufferDesc;
-	D3D11_SUBRESOURCE_DATA vertexData;
-	D3D11_SUBRESOURCE_DATA indexData;
-	HRESULT result;
+	return m_indices;
+}
+
+/*
+	Gets the triangle tree of the model, built with the geometry, for the rays of the scene queries. 
+	It is swapped with the geometry on the render thread, so the queries must not run while Upload does.
+*/
+MeshBvhClass* ModelClass::GetMeshBvh()
+{
+	return &m_meshBvh;
+}
+
+/*
+	Sets the texture the model is drawn with, the model doesn't own it. 
+	The draws and the static batch keep the texture object, not its view, so they follow it when it is created again.
+*/
+void ModelClass::SetTexture(TextureClass* texture)
+{
+	m_texture = texture;
+
+	return;
+}
+
+/*
+	Gets the texture the model is drawn with, or null when the model has no texture.
+*/
+TextureClass* ModelClass::GetTexture()
+{
+	return m_texture;
+}
+
+/*
+	Builds the model geometry in memory. It doesn't touch the device, so the startup can run it on any thread while the device is being created. 
+	The arrays are kept after Initialize copies them into the geometry pool, the static batcher copies them too.
+*/
+bool ModelClass::Load()
+{
+	PROFILE_FUNCTION();
 
 	// Set the number of vertices in the vertex array.
 	m_vertexCount = 6;
@@ -72,20 +225,219 @@ bool ModelClass::InitializeBuffers(ID3D11Device* device)
 	// Set the number of indices in the index array.
 	m_indexCount = 6;
 
+	/*
+		The arrays are made on one thread and copied on another, so they can't come from the thread's scratch stack. 
+	*/
+
 	// Create the vertex array.
-	vertices = new VertexType[m_vertexCount];
-	if(!vertices)
+	m_vertices = new VertexType[m_vertexCount];
+	if(!m_vertices)
 	{
 		return false;
 	}
 
 	// Create the index array.
-	indices = new unsigned long[m_indexCount];
-	if(!indices)
+	m_indices = new unsigned long[m_indexCount];
+	if(!m_indices)
+	{
+		return false;
+	}
+
+	// Load the arrays with the model geometry.
+	LoadGeometry(m_vertices, m_indices);
+
+	// Build the triangle tree the rays are cast against.
+	if(!m_meshBvh.Build((const float*)&m_vertices[0].position, sizeof(VertexType), m_vertexCount, m_indices, m_indexCount))
 	{
 		return false;
 	}
 
+	return true;
+}
+
+bool ModelClass::InitializeBuffers()
+{
+	bool result;
+
+	// Load the geometry, unless the startup already did it on a worker thread.
+	if(!m_vertices || !m_indices)
+	{
+		result = Load();
+		if(!result)
+		{
+			return false;
+		}
+	}
+
+	//--------------------------------------------------------------------------------------
+
+	// Copy the vertices and indices into the shared buffers of the geometry pool. (The arrays are kept for the static batcher.)
+	m_geometryHandle = m_geometryPool->Allocate(m_vertices, m_vertexCount, sizeof(VertexType), m_indices, m_indexCount);
+	if(m_geometryHandle < 0)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+/*
+	Reads a model file into a second set of arrays, while the current geometry keeps being drawn. 
+	It doesn't touch the device or the current geometry, so the asset loader runs it on a worker. 
+	The file has the vertex count and then the vertices, one a line, position, color then texture coordinates; the vertices are listed in triangle order:
+
+		Vertex Count: 36
+
+		Data:
+
+		-1.0 1.0 -1.0 1.0 0.0 0.0 1.0 0.0 0.0
+		...
+*/
+bool ModelClass::Decode(const vector<char>& data)
+{
+	string file;
+	const char* text;
+	char* next;
+	int i, j, count;
+	float values[9];
+
+	PROFILE_FUNCTION();
+
+	if(data.empty() || m_decodedVertices)
+	{
+		return false;
+	}
+
+	// The file isn't terminated, the parse needs a copy that is.
+	file.assign(data.begin(), data.end());
+
+	// Read up to the value of the vertex count, and read it in.
+	text = strchr(file.c_str(), ':');
+	if(!text)
+	{
+		return false;
+	}
+	count = (int)strtol(text + 1, &next, 10);
+	if(count <= 0 || count % 3 != 0)
+	{
+		return false;
+	}
+
+	// Read up to the beginning of the data.
+	text = strchr(next, ':');
+	if(!text)
+	{
+		return false;
+	}
+	text++;
+
+	m_decodedVertices = new VertexType[count];
+	m_decodedIndices = new unsigned long[count];
+
+	// Read in the vertex data.
+	for(i=0; i<count; i++)
+	{
+		for(j=0; j<9; j++)
+		{
+			values[j] = (float)strtod(text, &next);
+			if(next == text)
+			{
+				delete [] m_decodedVertices;
+				delete [] m_decodedIndices;
+				m_decodedVertices = 0;
+				m_decodedIndices = 0;
+				return false;
+			}
+			text = next;
+		}
+
+		m_decodedVertices[i].position = D3DXVECTOR3(values[0], values[1], values[2]);
+		m_decodedVertices[i].color = D3DXVECTOR4(values[3], values[4], values[5], values[6]);
+		m_decodedVertices[i].texture = D3DXVECTOR2(values[7], values[8]);
+		m_decodedIndices[i] = i;
+	}
+
+	// The triangle tree is built here too, on the worker, and swapped in with the geometry.
+	if(!m_decodedMeshBvh.Build((const float*)&m_decodedVertices[0].position, sizeof(VertexType), count, m_decodedIndices, count))
+	{
+		delete [] m_decodedVertices;
+		delete [] m_decodedIndices;
+		m_decodedVertices = 0;
+		m_decodedIndices = 0;
+		return false;
+	}
+
+	m_decodedVertexCount = count;
+	m_decodedIndexCount = count;
+
+	return true;
+}
+
+/*
+	Swaps the decoded geometry in, on the render thread. 
+	The new geometry is copied into the pool before the old one is given back, so the model never has nothing to draw.
+*/
+bool ModelClass::Upload()
+{
+	int handle;
+
+	PROFILE_FUNCTION();
+
+	if(!m_geometryPool || !m_decodedVertices || !m_decodedIndices)
+	{
+		return false;
+	}
+
+	// Copy the decoded vertices and indices into the shared buffers of the geometry pool.
+	handle = m_geometryPool->Allocate(m_decodedVertices, m_decodedVertexCount, sizeof(VertexType), m_decodedIndices, m_decodedIndexCount);
+	if(handle < 0)
+	{
+		return false;
+	}
+
+	// Release the old geometry and keep the new one.
+	ReleaseGeometry();
+	m_geometryPool->Free(m_geometryHandle);
+
+	m_geometryHandle = handle;
+	m_vertices = m_decodedVertices;
+	m_indices = m_decodedIndices;
+	m_vertexCount = m_decodedVertexCount;
+	m_indexCount = m_decodedIndexCount;
+	m_meshBvh.Swap(m_decodedMeshBvh);
+	m_decodedMeshBvh.Shutdown();
+
+	m_decodedVertices = 0;
+	m_decodedIndices = 0;
+	m_decodedVertexCount = 0;
+	m_decodedIndexCount = 0;
+
+	return true;
+}
+
+void ModelClass::ReleaseGeometry()
+{
+	// Release the index array.
+	if(m_indices)
+	{
+		delete [] m_indices;
+		m_indices = 0;
+	}
+
+	// Release the vertex array.
+	if(m_vertices)
+	{
+		delete [] m_vertices;
+		m_vertices = 0;
+	}
+}
+
+/*
+	Fills the arrays with the vertices and indices of the model. 
+	The vertex and index counts must already be set.
+*/
+void ModelClass::LoadGeometry(VertexType* vertices, unsigned long* indices)
+{
 	// Load the vertex array with data.
 
 	vertices[0].color = D3DXVECTOR4(1.0f, 0.0f, 0.0f, 1.0f);
@@ -101,7 +453,14 @@ bool ModelClass::InitializeBuffers(ID3D11Device* device)
 	vertices[3].position = D3DXVECTOR3(-1.0f, 1.0f, 0.0f);  // Top left.
 	vertices[4].position = D3DXVECTOR3(1.0f, 1.0f, 0.0f);  // Top right.
 	vertices[5].position = D3DXVECTOR3(1.0f, -1.0f, 0.0f);  // Bottom right.
-	
+
+	vertices[0].texture = D3DXVECTOR2(0.0f, 1.0f);
+	vertices[1].texture = D3DXVECTOR2(0.0f, 0.0f);
+	vertices[2].texture = D3DXVECTOR2(1.0f, 1.0f);
+	vertices[3].texture = D3DXVECTOR2(0.0f, 0.0f);
+	vertices[4].texture = D3DXVECTOR2(1.0f, 0.0f);
+	vertices[5].texture = D3DXVECTOR2(1.0f, 1.0f);
+
 
 	// Load the index array with data.
 	indices[0] = 0;  // Bottom left.
@@ -110,104 +469,54 @@ bool ModelClass::InitializeBuffers(ID3D11Device* device)
 	indices[3] = 3;
 	indices[4] = 4;
 	indices[5] = 5;
+}
 
-	//--------------------------------------------------------------------------------------
-
-	// Set up the description of the static vertex buffer.
-	vertexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	vertexBufferDesc.ByteWidth = sizeof(VertexType) * m_vertexCount;
-	vertexBufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vertexBufferDesc.CPUAccessFlags = 0;
-	vertexBufferDesc.MiscFlags = 0;
-	vertexBufferDesc.StructureByteStride = 0;
-
-	// Give the subresource structure a pointer to the vertex data.
-	vertexData.pSysMem = vertices;
-	vertexData.SysMemPitch = 0;
-	vertexData.SysMemSlicePitch = 0;
+void ModelClass::ShutdownBuffers()
+{
+	// Release the arrays, and the decoded ones if they were never swapped in.
+	ReleaseGeometry();
 
-	// Now create the vertex buffer.
-	result = device->CreateBuffer(&vertexBufferDesc, &vertexData, &m_vertexBuffer);
-	if(FAILED(result))
+	if(m_decodedIndices)
 	{
-		return false;
+		delete [] m_decodedIndices;
+		m_decodedIndices = 0;
 	}
 
-	//--------------------------------------------------------------------------------------
-
-	// Set up the description of the static index buffer.
-	indexBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	indexBufferDesc.ByteWidth = sizeof(unsigned long) * m_indexCount;
-	indexBufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	indexBufferDesc.CPUAccessFlags = 0;
-	indexBufferDesc.MiscFlags = 0;
-	indexBufferDesc.StructureByteStride = 0;
-
-	// Give the subresource structure a pointer to the index data.
-	indexData.pSysMem = indices;
-	indexData.SysMemPitch = 0;
-	indexData.SysMemSlicePitch = 0;
-
-	// Create the index buffer.
-	result = device->CreateBuffer(&indexBufferDesc, &indexData, &m_indexBuffer);
-	if(FAILED(result))
+	if(m_decodedVertices)
 	{
-		return false;
+		delete [] m_decodedVertices;
+		m_decodedVertices = 0;
 	}
 
-	//--------------------------------------------------------------------------------------
-
-	/*
-		THIS IS WRONG, if the buffer fails, the vertices and indices arent deleted.
-	*/
-
-	// Release the arrays now that the vertex and index buffers have been created and loaded.
-	delete [] vertices;
-	vertices = 0;
+	// Release the triangle trees.
+	m_meshBvh.Shutdown();
+	m_decodedMeshBvh.Shutdown();
 
-	delete [] indices;
-	indices = 0;
-
-	return true;
-}
-
-void ModelClass::ShutdownBuffers()
-{
-	// Release the index buffer.
-	if(m_indexBuffer)
+	// Give the vertex and index ranges back to the pool.
+	if(m_geometryPool)
 	{
-		m_indexBuffer->Release();
-		m_indexBuffer = 0;
-	}
-
-	// Release the vertex buffer.
-	if(m_vertexBuffer)
-	{
-		m_vertexBuffer->Release();
-		m_vertexBuffer = 0;
+		m_geometryPool->Free(m_geometryHandle);
 	}
+	m_geometryHandle = -1;
 }
 
 /*
 	The purpose of this function is to set the vertex buffer and index buffer as active on the input assembler in the GPU. 
 	Once the GPU has an active vertex buffer it can then use the shader to render that buffer. This function also defines how those buffers should be drawn such as triangles, lines, fans, and so forth.
+	The buffers are those of the pool page holding the model, and the pool skips the bind if that page is already bound.
 */
 
 void ModelClass::RenderBuffers(ID3D11DeviceContext* deviceContext)
 {
-	unsigned int stride;
-	unsigned int offset;
-
-	// Set vertex buffer stride and offset.
-	stride = sizeof(VertexType);
-	offset = 0;
+	GeometryDraw draw;
 
-	// Set the vertex buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
-
-	// Set the index buffer to active in the input assembler so it can be rendered.
-	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, offset);
+	// Set the vertex and index buffers to active in the input assembler so they can be rendered.
+	if(m_geometryPool->GetDraw(m_geometryHandle, draw))
+	{
+		m_geometryPool->Bind(deviceContext, draw.page);
+	}
 
 	// Set the type of primitive that should be rendered from this vertex buffer, in this case triangles.
 	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
 }
\ No newline at end of file
@@ -3,6 +3,15 @@
 
 #include <d3d11.h>
 #include <d3dx10math.h>
+#include <vector>
+
+#include "scratchallocatorclass.h"
+#include "geometrypoolclass.h"
+#include "profilerclass.h"
+#include "meshbvhclass.h"
+#include "textureclass.h"
+
+using namespace std;
 
 class ModelClass
 {
@@ -11,6 +20,7 @@ private:
 	{
 		D3DXVECTOR3 position;
 		D3DXVECTOR4 color;
+		D3DXVECTOR2 texture;
 	};
 
 public:
@@ -18,22 +28,49 @@ public:
 	ModelClass(const ModelClass&);
 	~ModelClass();
 
-	bool Initialize(ID3D11Device*);
+	bool Load();
+	bool Decode(const vector<char>&);
+	bool Upload();
+	bool Initialize(GeometryPoolClass*);
 	void Shutdown();
 	void Render(ID3D11DeviceContext*);
 
 	int GetIndexCount();
+	int GetStartIndex();
+	int GetBaseVertex();
+	int GetGeometryHandle();
+
+	int GetVertexCount();
+	int GetVertexStride();
+	bool CopyGeometry(void*, unsigned long*);
+	bool GetBounds(D3DXVECTOR3&, D3DXVECTOR3&);
+	const float* GetPositions();
+	const unsigned long* GetIndices();
+	MeshBvhClass* GetMeshBvh();
+	void SetTexture(TextureClass*);
+	TextureClass* GetTexture();
 
 private:
-	bool InitializeBuffers(ID3D11Device*);
+	bool InitializeBuffers();
+	void LoadGeometry(VertexType*, unsigned long*);
+	void ReleaseGeometry();
 	void ShutdownBuffers();
 	void RenderBuffers(ID3D11DeviceContext*);
 
 private:
-	ID3D11Buffer *m_vertexBuffer;
-	ID3D11Buffer *m_indexBuffer;
+	GeometryPoolClass* m_geometryPool;
+	int m_geometryHandle;
+	VertexType* m_vertices;
+	unsigned long* m_indices;
 	int m_vertexCount;
 	int m_indexCount;
+	VertexType* m_decodedVertices;
+	unsigned long* m_decodedIndices;
+	int m_decodedVertexCount;
+	int m_decodedIndexCount;
+	MeshBvhClass m_meshBvh;
+	MeshBvhClass m_decodedMeshBvh;
+	TextureClass* m_texture;
 
 };
 
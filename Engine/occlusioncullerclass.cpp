@@ -0,0 +1,995 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	occlusioncullerclass.cpp
+//
+// summary:	Implements the occlusioncullerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "occlusioncullerclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#ifdef OCCLUSION_SIMD
+#include <xmmintrin.h>
+#endif
+
+// Includes.
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+
+// Globals.
+static const int BOX_OUTSIDE = 0;
+static const int BOX_NEAR = 1;
+static const int BOX_ON_SCREEN = 2;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Multiplies two matrices, the first is applied first. </summary>
+///
+/// <param name="first">  The first matrix. </param>
+/// <param name="second"> The second matrix. </param>
+/// <param name="result"> [out] The product, not one of the two. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void MultiplyMatrix(const float* first, const float* second, float* result)
+{
+	int row, column;
+
+	for(row=0; row<4; row++)
+	{
+		for(column=0; column<4; column++)
+		{
+			result[row * 4 + column] = first[row * 4] * second[column] + first[row * 4 + 1] * second[4 + column] + first[row * 4 + 2] * second[8 + column] + first[row * 4 + 3] * second[12 + column];
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Transforms a point into clip space. </summary>
+///
+/// <param name="matrix"> The matrix. </param>
+/// <param name="x">	  The x coordinate. </param>
+/// <param name="y">	  The y coordinate. </param>
+/// <param name="z">	  The z coordinate. </param>
+/// <param name="clip">   [out] The point in clip space, x y z w. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void TransformPoint(const float* matrix, float x, float y, float z, float* clip)
+{
+	clip[0] = x * matrix[0] + y * matrix[4] + z * matrix[8] + matrix[12];
+	clip[1] = x * matrix[1] + y * matrix[5] + z * matrix[9] + matrix[13];
+	clip[2] = x * matrix[2] + y * matrix[6] + z * matrix[10] + matrix[14];
+	clip[3] = x * matrix[3] + y * matrix[7] + z * matrix[11] + matrix[15];
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the planes of the frustum a point in clip space is outside of, one bit each. </summary>
+///
+/// <param name="clip"> The point in clip space. </param>
+///
+/// <returns> The bits: left, right, bottom, top, near and far. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int GetOutcode(const float* clip)
+{
+	int outcode;
+
+	outcode = clip[0] < -clip[3] ? 1 : 0;
+	outcode |= clip[0] > clip[3] ? 2 : 0;
+	outcode |= clip[1] < -clip[3] ? 4 : 0;
+	outcode |= clip[1] > clip[3] ? 8 : 0;
+	outcode |= clip[2] < 0.0f ? 16 : 0;
+	outcode |= clip[2] > clip[3] ? 32 : 0;
+
+	return outcode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Turns a point in clip space, in front of the near plane, into pixels and depth. </summary>
+///
+/// <param name="clip">	  The point in clip space. </param>
+/// <param name="width">  The width of the buffer. </param>
+/// <param name="height"> The height of the buffer. </param>
+/// <param name="screen"> [out] x and y in pixels, down from the top, and the depth. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void ProjectPoint(const float* clip, int width, int height, float* screen)
+{
+	float inverse;
+
+	inverse = 1.0f / clip[3];
+	screen[0] = (clip[0] * inverse * 0.5f + 0.5f) * width;
+	screen[1] = (0.5f - clip[1] * inverse * 0.5f) * height;
+	screen[2] = clip[2] * inverse;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Projects a box to the screen: the pixels it may cover and its nearest depth, unless it
+/// 	is off screen or crosses the near plane, where it can't be said to be behind anything.
+/// </summary>
+///
+/// <param name="matrix">  The view projection matrix. </param>
+/// <param name="bounds">  The box. </param>
+/// <param name="width">   The width of the buffer. </param>
+/// <param name="height">  The height of the buffer. </param>
+/// <param name="rect">	   [out] The first and last pixel it covers, x0 y0 x1 y1. </param>
+/// <param name="nearest"> [out] The nearest depth of the box. </param>
+///
+/// <returns> BOX_OUTSIDE, BOX_NEAR or BOX_ON_SCREEN. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int ProjectBox(const float* matrix, const SceneBounds& bounds, int width, int height, int* rect, float& nearest)
+{
+	float center[4], axes[3][4], minimum[2], maximum[2];
+	int k;
+
+	// A corner is the center plus or minus the extent along each axis, all of them already in clip space.
+	TransformPoint(matrix, bounds.center.x, bounds.center.y, bounds.center.z, center);
+	for(k=0; k<4; k++)
+	{
+		axes[0][k] = bounds.extents.x * matrix[k];
+		axes[1][k] = bounds.extents.y * matrix[4 + k];
+		axes[2][k] = bounds.extents.z * matrix[8 + k];
+	}
+
+#ifdef OCCLUSION_SIMD
+	__m128 signX, signY, signZ, clip[2][4], inverse, lanes[4];
+	float values[4];
+	int outside[6], behind, half, plane;
+
+	// The eight corners as two sets of four, one register per clip space coordinate.
+	signX = _mm_set_ps(1.0f, -1.0f, 1.0f, -1.0f);
+	signY = _mm_set_ps(1.0f, 1.0f, -1.0f, -1.0f);
+	for(half=0; half<2; half++)
+	{
+		signZ = _mm_set1_ps(half ? 1.0f : -1.0f);
+		for(k=0; k<4; k++)
+		{
+			clip[half][k] = _mm_add_ps(_mm_add_ps(_mm_set1_ps(center[k]), _mm_mul_ps(signX, _mm_set1_ps(axes[0][k]))), _mm_add_ps(_mm_mul_ps(signY, _mm_set1_ps(axes[1][k])), _mm_mul_ps(signZ, _mm_set1_ps(axes[2][k]))));
+		}
+	}
+
+	// Outside if all the corners are outside one plane.
+	for(plane=0; plane<6; plane++)
+	{
+		outside[plane] = 0xff;
+	}
+	behind = 0;
+	for(half=0; half<2; half++)
+	{
+		outside[0] &= _mm_movemask_ps(_mm_cmplt_ps(clip[half][0], _mm_sub_ps(_mm_setzero_ps(), clip[half][3]))) << (half * 4) | (half ? 0x0f : 0xf0);
+		outside[1] &= _mm_movemask_ps(_mm_cmpgt_ps(clip[half][0], clip[half][3])) << (half * 4) | (half ? 0x0f : 0xf0);
+		outside[2] &= _mm_movemask_ps(_mm_cmplt_ps(clip[half][1], _mm_sub_ps(_mm_setzero_ps(), clip[half][3]))) << (half * 4) | (half ? 0x0f : 0xf0);
+		outside[3] &= _mm_movemask_ps(_mm_cmpgt_ps(clip[half][1], clip[half][3])) << (half * 4) | (half ? 0x0f : 0xf0);
+		outside[4] &= _mm_movemask_ps(_mm_cmplt_ps(clip[half][2], _mm_setzero_ps())) << (half * 4) | (half ? 0x0f : 0xf0);
+		outside[5] &= _mm_movemask_ps(_mm_cmpgt_ps(clip[half][2], clip[half][3])) << (half * 4) | (half ? 0x0f : 0xf0);
+		behind |= _mm_movemask_ps(_mm_cmplt_ps(clip[half][2], _mm_setzero_ps()));
+	}
+	for(plane=0; plane<6; plane++)
+	{
+		if(outside[plane] == 0xff)
+		{
+			return BOX_OUTSIDE;
+		}
+	}
+
+	if(behind)
+	{
+		return BOX_NEAR;
+	}
+
+	for(half=0; half<2; half++)
+	{
+		inverse = _mm_div_ps(_mm_set1_ps(1.0f), clip[half][3]);
+		clip[half][0] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(clip[half][0], inverse), _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f)), _mm_set1_ps((float)width));
+		clip[half][1] = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(_mm_mul_ps(clip[half][1], inverse), _mm_set1_ps(0.5f))), _mm_set1_ps((float)height));
+		clip[half][2] = _mm_mul_ps(clip[half][2], inverse);
+	}
+	lanes[0] = _mm_min_ps(clip[0][0], clip[1][0]);
+	lanes[1] = _mm_min_ps(clip[0][1], clip[1][1]);
+	lanes[2] = _mm_max_ps(clip[0][0], clip[1][0]);
+	lanes[3] = _mm_max_ps(clip[0][1], clip[1][1]);
+
+	_mm_storeu_ps(values, lanes[0]);
+	minimum[0] = min(min(values[0], values[1]), min(values[2], values[3]));
+	_mm_storeu_ps(values, lanes[1]);
+	minimum[1] = min(min(values[0], values[1]), min(values[2], values[3]));
+	_mm_storeu_ps(values, lanes[2]);
+	maximum[0] = max(max(values[0], values[1]), max(values[2], values[3]));
+	_mm_storeu_ps(values, lanes[3]);
+	maximum[1] = max(max(values[0], values[1]), max(values[2], values[3]));
+	_mm_storeu_ps(values, _mm_min_ps(clip[0][2], clip[1][2]));
+	nearest = min(min(values[0], values[1]), min(values[2], values[3]));
+#else
+	float clip[4], screen[3];
+	int inside, behind, corner;
+
+	minimum[0] = minimum[1] = 1e30f;
+	maximum[0] = maximum[1] = -1e30f;
+	nearest = 1e30f;
+	inside = 0x3f;
+	behind = 0;
+	for(corner=0; corner<8; corner++)
+	{
+		for(k=0; k<4; k++)
+		{
+			clip[k] = center[k] + (corner & 1 ? axes[0][k] : -axes[0][k]) + (corner & 2 ? axes[1][k] : -axes[1][k]) + (corner & 4 ? axes[2][k] : -axes[2][k]);
+		}
+
+		// Outside if all the corners are outside one plane.
+		inside &= GetOutcode(clip);
+		behind |= clip[2] < 0.0f ? 1 : 0;
+		if(clip[2] < 0.0f)
+		{
+			continue;
+		}
+
+		ProjectPoint(clip, width, height, screen);
+		minimum[0] = min(minimum[0], screen[0]);
+		minimum[1] = min(minimum[1], screen[1]);
+		maximum[0] = max(maximum[0], screen[0]);
+		maximum[1] = max(maximum[1], screen[1]);
+		nearest = min(nearest, screen[2]);
+	}
+
+	if(inside != 0)
+	{
+		return BOX_OUTSIDE;
+	}
+
+	if(behind != 0)
+	{
+		return BOX_NEAR;
+	}
+#endif
+
+	rect[0] = max((int)floorf(minimum[0]), 0);
+	rect[1] = max((int)floorf(minimum[1]), 0);
+	rect[2] = min((int)maximum[0], width - 1);
+	rect[3] = min((int)maximum[1], height - 1);
+	if(rect[0] > rect[2] || rect[1] > rect[3])
+	{
+		return BOX_OUTSIDE;
+	}
+
+	return BOX_ON_SCREEN;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Cuts the part of a polygon in clip space behind the near plane away. </summary>
+///
+/// <param name="input">  The corners of the polygon, 4 floats each. </param>
+/// <param name="count">  The number of corners. </param>
+/// <param name="output"> [out] The corners left, room for count + 1. </param>
+///
+/// <returns> The number of corners left. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int ClipNear(const float* input, int count, float* output)
+{
+	const float* current;
+	const float* next;
+	float t;
+	int result, i, k;
+
+	result = 0;
+	for(i=0; i<count; i++)
+	{
+		current = input + i * 4;
+		next = input + ((i + 1) % count) * 4;
+
+		if(current[2] >= 0.0f)
+		{
+			memcpy(output + result * 4, current, sizeof(float) * 4);
+			result++;
+		}
+
+		if((current[2] >= 0.0f) != (next[2] >= 0.0f))
+		{
+			t = current[2] / (current[2] - next[2]);
+			for(k=0; k<4; k++)
+			{
+				output[result * 4 + k] = current[k] + (next[k] - current[k]) * t;
+			}
+			output[result * 4 + 2] = 0.0f;
+			result++;
+		}
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+OcclusionCullerClass::OcclusionCullerClass()
+{
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	memset(m_viewProjection, 0, sizeof(m_viewProjection));
+	memset(&m_stats, 0, sizeof(OcclusionStats));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+OcclusionCullerClass::OcclusionCullerClass(const OcclusionCullerClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+OcclusionCullerClass::~OcclusionCullerClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates the depth buffer, cleared to the far plane. </summary>
+///
+/// <param name="width">  The width in pixels, a multiple of the tile size. </param>
+/// <param name="height"> The height in pixels, a multiple of the tile size. </param>
+///
+/// <returns> true if it succeeds, false if the size is not valid. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool OcclusionCullerClass::Initialize(int width, int height)
+{
+	if(width <= 0 || height <= 0 || width % OCCLUSION_TILE_SIZE != 0 || height % OCCLUSION_TILE_SIZE != 0)
+	{
+		return false;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = width / OCCLUSION_TILE_SIZE;
+	m_tilesY = height / OCCLUSION_TILE_SIZE;
+	m_depth.assign(m_width * m_height, 1.0f);
+	m_tileDepth.assign(m_tilesX * m_tilesY, 1.0f);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the depth buffer. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void OcclusionCullerClass::Shutdown()
+{
+	vector<float>().swap(m_depth);
+	vector<float>().swap(m_tileDepth);
+	vector<float>().swap(m_clipVertices);
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Clears the depth buffer for a new frame seen through a camera. </summary>
+///
+/// <param name="viewProjection"> The view matrix times the projection matrix of the camera, 16 floats. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void OcclusionCullerClass::BeginFrame(const float* viewProjection)
+{
+	memcpy(m_viewProjection, viewProjection, sizeof(m_viewProjection));
+	fill(m_depth.begin(), m_depth.end(), 1.0f);
+	fill(m_tileDepth.begin(), m_tileDepth.end(), 1.0f);
+	memset(&m_stats, 0, sizeof(OcclusionStats));
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Rasterizes an occluder into the depth buffer. The triangles off screen are skipped, the
+/// 	ones crossing the near plane are cut at it. Both faces are drawn, so the winding of the
+/// 	mesh doesn't matter.
+/// </summary>
+///
+/// <param name="positions">   The position of the first vertex, 3 floats. </param>
+/// <param name="stride">	   The bytes from one vertex to the next. </param>
+/// <param name="vertexCount"> The number of vertices. </param>
+/// <param name="indices">	   The indices, three to a triangle. </param>
+/// <param name="indexCount">  The number of indices. </param>
+/// <param name="world">	   The world matrix of the occluder, 16 floats, or 0 if the positions are in world space. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void OcclusionCullerClass::RenderOccluder(const float* positions, int stride, int vertexCount, const unsigned long* indices, int indexCount, const float* world)
+{
+	float matrix[16], polygon[3 * 4], clipped[4 * 4], screen[4][3];
+	const float* position;
+	const float* corners[3];
+	int outcodes[3], i, k, count;
+
+	PROFILE_FUNCTION();
+
+	if(world)
+	{
+		MultiplyMatrix(world, m_viewProjection, matrix);
+	}
+	else
+	{
+		memcpy(matrix, m_viewProjection, sizeof(matrix));
+	}
+
+	// Every vertex is transformed once, the triangles share them.
+	m_clipVertices.resize(vertexCount * 4);
+	for(i=0; i<vertexCount; i++)
+	{
+		position = (const float*)((const char*)positions + i * stride);
+		TransformPoint(matrix, position[0], position[1], position[2], &m_clipVertices[i * 4]);
+	}
+
+	for(i=0; i+2<indexCount; i+=3)
+	{
+		if(indices[i] >= (unsigned long)vertexCount || indices[i + 1] >= (unsigned long)vertexCount || indices[i + 2] >= (unsigned long)vertexCount)
+		{
+			continue;
+		}
+
+		for(k=0; k<3; k++)
+		{
+			corners[k] = &m_clipVertices[indices[i + k] * 4];
+			outcodes[k] = GetOutcode(corners[k]);
+		}
+
+		if(outcodes[0] & outcodes[1] & outcodes[2])
+		{
+			continue;
+		}
+
+		if(!((outcodes[0] | outcodes[1] | outcodes[2]) & 16))
+		{
+			for(k=0; k<3; k++)
+			{
+				ProjectPoint(corners[k], m_width, m_height, screen[k]);
+			}
+			RasterizeTriangle(screen[0], screen[1], screen[2]);
+			continue;
+		}
+
+		// Crossing the near plane, cut it and draw what is left as a fan.
+		for(k=0; k<3; k++)
+		{
+			memcpy(polygon + k * 4, corners[k], sizeof(float) * 4);
+		}
+		count = ClipNear(polygon, 3, clipped);
+		for(k=0; k<count; k++)
+		{
+			ProjectPoint(clipped + k * 4, m_width, m_height, screen[k]);
+		}
+		for(k=2; k<count; k++)
+		{
+			RasterizeTriangle(screen[0], screen[k - 1], screen[k]);
+		}
+	}
+
+	m_stats.occluders++;
+	m_stats.triangles += indexCount / 3;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Stores the farthest depth of every tile, once the occluders are rasterized. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void OcclusionCullerClass::Finish()
+{
+	const float* row;
+	float farthest;
+	int tileX, tileY, y;
+
+	PROFILE_FUNCTION();
+
+	for(tileY=0; tileY<m_tilesY; tileY++)
+	{
+		for(tileX=0; tileX<m_tilesX; tileX++)
+		{
+#ifdef OCCLUSION_SIMD
+			__m128 maximum;
+			float lanes[4];
+
+			maximum = _mm_setzero_ps();
+			for(y=0; y<OCCLUSION_TILE_SIZE; y++)
+			{
+				row = &m_depth[(tileY * OCCLUSION_TILE_SIZE + y) * m_width + tileX * OCCLUSION_TILE_SIZE];
+				maximum = _mm_max_ps(maximum, _mm_max_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4)));
+			}
+			_mm_storeu_ps(lanes, maximum);
+			farthest = max(max(lanes[0], lanes[1]), max(lanes[2], lanes[3]));
+#else
+			int x;
+
+			farthest = 0.0f;
+			for(y=0; y<OCCLUSION_TILE_SIZE; y++)
+			{
+				row = &m_depth[(tileY * OCCLUSION_TILE_SIZE + y) * m_width + tileX * OCCLUSION_TILE_SIZE];
+				for(x=0; x<OCCLUSION_TILE_SIZE; x++)
+				{
+					farthest = max(farthest, row[x]);
+				}
+			}
+#endif
+			m_tileDepth[tileY * m_tilesX + tileX] = farthest;
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Tests whether a box can be seen. It can't if it is off screen, or if its nearest depth is
+/// 	behind the depth of every pixel it covers; a box crossing the near plane always can.
+/// 	Only reads the buffer, any thread may call it between Finish and the next BeginFrame.
+/// </summary>
+///
+/// <param name="bounds"> The box in world space. </param>
+///
+/// <returns> true if it may be seen, false if it is hidden. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool OcclusionCullerClass::TestBox(const SceneBounds& bounds)
+{
+	const float* row;
+	float nearest;
+	int rect[4], tileX, tileY, first, last, y, result;
+
+	result = ProjectBox(m_viewProjection, bounds, m_width, m_height, rect, nearest);
+	if(result != BOX_ON_SCREEN)
+	{
+		return result == BOX_NEAR;
+	}
+
+	for(tileY=rect[1] / OCCLUSION_TILE_SIZE; tileY<=rect[3] / OCCLUSION_TILE_SIZE; tileY++)
+	{
+		for(tileX=rect[0] / OCCLUSION_TILE_SIZE; tileX<=rect[2] / OCCLUSION_TILE_SIZE; tileX++)
+		{
+			// Behind the farthest pixel of the tile, hidden there whatever pixels it covers.
+			if(nearest > m_tileDepth[tileY * m_tilesX + tileX])
+			{
+				continue;
+			}
+
+			first = max(rect[0], tileX * OCCLUSION_TILE_SIZE);
+			last = min(rect[2], tileX * OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1);
+			for(y=max(rect[1], tileY * OCCLUSION_TILE_SIZE); y<=min(rect[3], tileY * OCCLUSION_TILE_SIZE + OCCLUSION_TILE_SIZE - 1); y++)
+			{
+				row = &m_depth[y * m_width + tileX * OCCLUSION_TILE_SIZE];
+#ifdef OCCLUSION_SIMD
+				int mask;
+
+				// One bit per pixel of the tile row, kept for the pixels the box covers.
+				mask = _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row), _mm_set1_ps(nearest)));
+				mask |= _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + 4), _mm_set1_ps(nearest))) << 4;
+				mask &= ((1 << (last - tileX * OCCLUSION_TILE_SIZE + 1)) - 1) & ~((1 << (first - tileX * OCCLUSION_TILE_SIZE)) - 1);
+				if(mask)
+				{
+					return true;
+				}
+#else
+				int x;
+
+				for(x=first; x<=last; x++)
+				{
+					if(row[x - tileX * OCCLUSION_TILE_SIZE] >= nearest)
+					{
+						return true;
+					}
+				}
+#endif
+			}
+		}
+	}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Tests many boxes, split between the workers when there are enough of them. </summary>
+///
+/// <param name="boxes">   The boxes in world space. </param>
+/// <param name="count">   The number of boxes. </param>
+/// <param name="visible"> [out] For every box, 1 if it may be seen, 0 if it is hidden. </param>
+/// <param name="workers"> The number of workers to run on, 0 runs on the calling thread, -1 on every core. </param>
+///
+/// <returns> The number of boxes that may be seen. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int OcclusionCullerClass::TestBoxes(const SceneBounds* boxes, int count, unsigned char* visible, int workers)
+{
+	int first, result, i;
+
+	PROFILE_FUNCTION();
+
+	if(workers == 0 || count < OCCLUSION_PARALLEL_BOXES)
+	{
+		for(i=0; i<count; i++)
+		{
+			visible[i] = TestBox(boxes[i]) ? 1 : 0;
+		}
+	}
+	else
+	{
+		TaskGraphClass tasks;
+
+		for(first=0; first<count; first+=OCCLUSION_BOXES_PER_TASK)
+		{
+			tasks.AddTask("OcclusionCullerClass::TestBoxes", [this, boxes, visible, first, count]() -> bool
+			{
+				int i;
+
+				for(i=first; i<first + OCCLUSION_BOXES_PER_TASK && i<count; i++)
+				{
+					visible[i] = TestBox(boxes[i]) ? 1 : 0;
+				}
+				return true;
+			});
+		}
+
+		// Without the workers nothing is known to be hidden.
+		if(!tasks.Run(workers))
+		{
+			memset(visible, 1, count);
+		}
+	}
+
+	result = 0;
+	for(i=0; i<count; i++)
+	{
+		result += visible[i];
+	}
+
+	m_stats.tested += count;
+	m_stats.occluded += count - result;
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets what the culler did since the last BeginFrame. </summary>
+///
+/// <param name="stats"> [out] The stats. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void OcclusionCullerClass::GetStats(OcclusionStats& stats)
+{
+	stats = m_stats;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the width of the depth buffer. </summary>
+///
+/// <returns> The width in pixels. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int OcclusionCullerClass::GetWidth()
+{
+	return m_width;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the height of the depth buffer. </summary>
+///
+/// <returns> The height in pixels. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int OcclusionCullerClass::GetHeight()
+{
+	return m_height;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the depth of one pixel, to look at the buffer. </summary>
+///
+/// <param name="x"> The column. </param>
+/// <param name="y"> The row, down from the top. </param>
+///
+/// <returns> The depth, 1 where nothing was rasterized or outside the buffer. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+float OcclusionCullerClass::GetDepth(int x, int y)
+{
+	if(x < 0 || y < 0 || x >= m_width || y >= m_height)
+	{
+		return 1.0f;
+	}
+
+	return m_depth[y * m_width + x];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the culler on a city of blocks by blocks, 40 m apart: each block a building from 10
+/// 	to 80 m high and props of one to three meters in the streets around it. The camera stands
+/// 	in a street near the middle, looking along it. Every building is an occluder and every
+/// 	building and prop is tested; the tests on one thread and on the workers must agree.
+/// </summary>
+///
+/// <param name="blocks"> The number of blocks along each side. </param>
+/// <param name="result"> [out] The times. </param>
+///
+/// <returns> true if the benchmark ran and the tests agreed, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool OcclusionCullerClass::Benchmark(int blocks, OcclusionBenchmark& result)
+{
+	const float BlockSize = 40.0f;
+	const float BuildingSize = 14.0f;
+	const float Street = 37.0f;
+	const float FieldOfView = 0.7853982f;
+	const float Near = 0.1f;
+	const float Far = 1000.0f;
+	const float CubePositions[8 * 3] = { -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f };
+	const unsigned long CubeIndices[36] = { 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+	OcclusionCullerClass culler;
+	vector<SceneBounds> boxes;
+	vector<SceneMatrix> buildings;
+	vector<unsigned char> serial, parallel;
+	SceneBounds bounds;
+	SceneMatrix world;
+	float view[16], projection[16], viewProjection[16], eye[3], axisX[3], axisY[3], axisZ[3], length, scale, nearest, milliseconds;
+	unsigned long long start;
+	unsigned int seed;
+	int rect[4], blockX, blockZ, pass, i;
+	bool succeeded;
+
+	memset(&result, 0, sizeof(OcclusionBenchmark));
+	if(blocks <= 0 || !culler.Initialize())
+	{
+		return false;
+	}
+
+	// The buildings, then the props along the two streets of each block.
+	seed = 777;
+	for(blockZ=0; blockZ<blocks; blockZ++)
+	{
+		for(blockX=0; blockX<blocks; blockX++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			bounds.center.x = blockX * BlockSize + BuildingSize + 3.0f;
+			bounds.center.z = blockZ * BlockSize + BuildingSize + 3.0f;
+			bounds.extents.x = BuildingSize;
+			bounds.extents.z = BuildingSize;
+			bounds.extents.y = 5.0f + (seed >> 8) / 16777216.0f * 35.0f;
+			bounds.center.y = bounds.extents.y;
+			bounds.center.w = bounds.extents.w = 0.0f;
+			boxes.push_back(bounds);
+
+			memset(&world, 0, sizeof(SceneMatrix));
+			world.m[0] = bounds.extents.x;
+			world.m[5] = bounds.extents.y;
+			world.m[10] = bounds.extents.z;
+			world.m[12] = bounds.center.x;
+			world.m[13] = bounds.center.y;
+			world.m[14] = bounds.center.z;
+			world.m[15] = 1.0f;
+			buildings.push_back(world);
+		}
+	}
+
+	for(blockZ=0; blockZ<blocks; blockZ++)
+	{
+		for(blockX=0; blockX<blocks; blockX++)
+		{
+			for(i=0; i<OCCLUSION_BENCHMARK_PROPS; i++)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				scale = (seed >> 8) / 16777216.0f;
+				seed = seed * 1664525u + 1013904223u;
+				bounds.extents.x = bounds.extents.y = bounds.extents.z = 0.5f + (seed >> 8) / 16777216.0f;
+				bounds.center.y = bounds.extents.y;
+				if(i % 2 == 0)
+				{
+					bounds.center.x = blockX * BlockSize + scale * BlockSize;
+					bounds.center.z = blockZ * BlockSize + Street + (i % 4 == 0 ? -3.0f : 3.0f);
+				}
+				else
+				{
+					bounds.center.x = blockX * BlockSize + Street + (i % 4 == 1 ? -3.0f : 3.0f);
+					bounds.center.z = blockZ * BlockSize + scale * BlockSize;
+				}
+				boxes.push_back(bounds);
+			}
+		}
+	}
+
+	// A camera at eye height in a street, looking along it and a little to the side.
+	eye[0] = (blocks / 2) * BlockSize + Street;
+	eye[1] = 1.7f;
+	eye[2] = (blocks / 4) * BlockSize + Street;
+	axisZ[0] = 0.3f;
+	axisZ[1] = 0.0f;
+	axisZ[2] = 1.0f;
+	length = sqrtf(axisZ[0] * axisZ[0] + axisZ[2] * axisZ[2]);
+	axisZ[0] /= length;
+	axisZ[2] /= length;
+	axisX[0] = axisZ[2];
+	axisX[1] = 0.0f;
+	axisX[2] = -axisZ[0];
+	axisY[0] = 0.0f;
+	axisY[1] = 1.0f;
+	axisY[2] = 0.0f;
+
+	memset(view, 0, sizeof(view));
+	for(i=0; i<3; i++)
+	{
+		view[i * 4] = axisX[i];
+		view[i * 4 + 1] = axisY[i];
+		view[i * 4 + 2] = axisZ[i];
+	}
+	view[12] = -(axisX[0] * eye[0] + axisX[1] * eye[1] + axisX[2] * eye[2]);
+	view[13] = -(axisY[0] * eye[0] + axisY[1] * eye[1] + axisY[2] * eye[2]);
+	view[14] = -(axisZ[0] * eye[0] + axisZ[1] * eye[1] + axisZ[2] * eye[2]);
+	view[15] = 1.0f;
+
+	// The projection of D3DXMatrixPerspectiveFovLH.
+	memset(projection, 0, sizeof(projection));
+	scale = 1.0f / tanf(FieldOfView * 0.5f);
+	projection[0] = scale * OCCLUSION_HEIGHT / OCCLUSION_WIDTH;
+	projection[5] = scale;
+	projection[10] = Far / (Far - Near);
+	projection[11] = 1.0f;
+	projection[14] = -Near * Far / (Far - Near);
+	MultiplyMatrix(view, projection, viewProjection);
+
+	result.occluders = (int)buildings.size();
+	result.objects = (int)boxes.size();
+	for(i=0; i<result.objects; i++)
+	{
+		result.inFrustum += ProjectBox(viewProjection, boxes[i], OCCLUSION_WIDTH, OCCLUSION_HEIGHT, rect, nearest) != BOX_OUTSIDE ? 1 : 0;
+	}
+
+	serial.resize(boxes.size());
+	parallel.resize(boxes.size());
+	succeeded = true;
+	for(pass=0; pass<OCCLUSION_BENCHMARK_PASSES; pass++)
+	{
+		start = ProfilerClass::GetTimestamp();
+		culler.BeginFrame(viewProjection);
+		for(i=0; i<result.occluders; i++)
+		{
+			culler.RenderOccluder(CubePositions, sizeof(float) * 3, 8, CubeIndices, 36, buildings[i].m);
+		}
+		culler.Finish();
+		milliseconds = (float)ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+		result.rasterMs = pass == 0 || milliseconds < result.rasterMs ? milliseconds : result.rasterMs;
+
+		start = ProfilerClass::GetTimestamp();
+		culler.TestBoxes(&boxes[0], result.objects, &serial[0], 0);
+		milliseconds = (float)ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+		result.testSerialMs = pass == 0 || milliseconds < result.testSerialMs ? milliseconds : result.testSerialMs;
+
+		start = ProfilerClass::GetTimestamp();
+		culler.TestBoxes(&boxes[0], result.objects, &parallel[0]);
+		milliseconds = (float)ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+		result.testParallelMs = pass == 0 || milliseconds < result.testParallelMs ? milliseconds : result.testParallelMs;
+
+		succeeded = succeeded && serial == parallel;
+	}
+
+	result.triangles = culler.m_stats.triangles;
+	result.occluded = result.inFrustum;
+	for(i=0; i<result.objects; i++)
+	{
+		result.occluded -= serial[i];
+	}
+
+	culler.Shutdown();
+
+	return succeeded && result.occluded >= 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Rasterizes a triangle on screen, keeping the nearest depth of every pixel whose center
+/// 	it covers. The pixels go four at a time along each row of the box around the triangle,
+/// 	stepping the three edge functions and the depth plane.
+/// </summary>
+///
+/// <param name="first">  The first corner, x and y in pixels and the depth. </param>
+/// <param name="second"> The second corner. </param>
+/// <param name="third">  The third corner. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void OcclusionCullerClass::RasterizeTriangle(const float* first, const float* second, const float* third)
+{
+	const float* corners[3];
+	const float* swap;
+	float edgeX[3], edgeY[3], edgeC[3], area, depthX, depthY, depthC, pixelY;
+	int minimumX, minimumY, maximumX, maximumY, x, y, i, next;
+	float* row;
+
+	// Make the corners turn the same way, so the inside is where every edge function is positive.
+	corners[0] = first;
+	corners[1] = second;
+	corners[2] = third;
+	area = (second[0] - first[0]) * (third[1] - first[1]) - (second[1] - first[1]) * (third[0] - first[0]);
+	if(area == 0.0f)
+	{
+		return;
+	}
+	if(area < 0.0f)
+	{
+		swap = corners[1];
+		corners[1] = corners[2];
+		corners[2] = swap;
+		area = -area;
+	}
+
+	minimumX = max((int)floorf(min(min(first[0], second[0]), third[0])), 0);
+	minimumY = max((int)floorf(min(min(first[1], second[1]), third[1])), 0);
+	maximumX = min((int)ceilf(max(max(first[0], second[0]), third[0])), m_width - 1);
+	maximumY = min((int)ceilf(max(max(first[1], second[1]), third[1])), m_height - 1);
+	if(minimumX > maximumX || minimumY > maximumY)
+	{
+		return;
+	}
+
+	// The edge across from each corner, as a x + b y + c, and the depth as a plane over the screen.
+	for(i=0; i<3; i++)
+	{
+		next = (i + 1) % 3;
+		edgeX[(i + 2) % 3] = corners[i][1] - corners[next][1];
+		edgeY[(i + 2) % 3] = corners[next][0] - corners[i][0];
+		edgeC[(i + 2) % 3] = corners[i][0] * corners[next][1] - corners[i][1] * corners[next][0];
+	}
+	depthX = (edgeX[0] * corners[0][2] + edgeX[1] * corners[1][2] + edgeX[2] * corners[2][2]) / area;
+	depthY = (edgeY[0] * corners[0][2] + edgeY[1] * corners[1][2] + edgeY[2] * corners[2][2]) / area;
+	depthC = (edgeC[0] * corners[0][2] + edgeC[1] * corners[1][2] + edgeC[2] * corners[2][2]) / area;
+
+	// Start on a multiple of four, the buffer rows are.
+	minimumX &= ~3;
+
+	for(y=minimumY; y<=maximumY; y++)
+	{
+		pixelY = y + 0.5f;
+		row = &m_depth[y * m_width];
+
+#ifdef OCCLUSION_SIMD
+		__m128 offsets, pixelX, edge0, edge1, edge2, step0, step1, step2, depth, depthStep, inside, nearest;
+
+		offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		pixelX = _mm_add_ps(_mm_set1_ps((float)minimumX), offsets);
+		edge0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeX[0]), pixelX), _mm_set1_ps(edgeY[0] * pixelY + edgeC[0]));
+		edge1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeX[1]), pixelX), _mm_set1_ps(edgeY[1] * pixelY + edgeC[1]));
+		edge2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeX[2]), pixelX), _mm_set1_ps(edgeY[2] * pixelY + edgeC[2]));
+		depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthX), pixelX), _mm_set1_ps(depthY * pixelY + depthC));
+		step0 = _mm_set1_ps(edgeX[0] * 4.0f);
+		step1 = _mm_set1_ps(edgeX[1] * 4.0f);
+		step2 = _mm_set1_ps(edgeX[2] * 4.0f);
+		depthStep = _mm_set1_ps(depthX * 4.0f);
+
+		for(x=minimumX; x<=maximumX; x+=4)
+		{
+			inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, _mm_setzero_ps()), _mm_cmpge_ps(edge1, _mm_setzero_ps())), _mm_cmpge_ps(edge2, _mm_setzero_ps()));
+			if(_mm_movemask_ps(inside))
+			{
+				// Depths below 0 are clamped so a clipped corner can't win over the near plane.
+				nearest = _mm_loadu_ps(row + x);
+				nearest = _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(nearest, _mm_max_ps(depth, _mm_setzero_ps()))), _mm_andnot_ps(inside, nearest));
+				_mm_storeu_ps(row + x, nearest);
+			}
+
+			edge0 = _mm_add_ps(edge0, step0);
+			edge1 = _mm_add_ps(edge1, step1);
+			edge2 = _mm_add_ps(edge2, step2);
+			depth = _mm_add_ps(depth, depthStep);
+		}
+#else
+		float pixelX, depth;
+
+		for(x=minimumX; x<=maximumX; x++)
+		{
+			pixelX = x + 0.5f;
+			if(edgeX[0] * pixelX + edgeY[0] * pixelY + edgeC[0] >= 0.0f &&
+			   edgeX[1] * pixelX + edgeY[1] * pixelY + edgeC[1] >= 0.0f &&
+			   edgeX[2] * pixelX + edgeY[2] * pixelY + edgeC[2] >= 0.0f)
+			{
+				depth = max(depthX * pixelX + depthY * pixelY + depthC, 0.0f);
+				row[x] = min(row[x], depth);
+			}
+		}
+#endif
+	}
+
+	return;
+}
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	occlusioncullerclass.h
+//
+// summary:	Declares the occlusioncullerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _OCCLUSIONCULLERCLASS_H_
+#define _OCCLUSIONCULLERCLASS_H_
+
+// Pre-processing directives.
+// Four pixels are rasterized and tested at once with SSE where the compiler has it, one by one elsewhere.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#define OCCLUSION_SIMD
+#endif
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "sceneclass.h"
+
+// Globals.
+const int OCCLUSION_WIDTH = 256;
+const int OCCLUSION_HEIGHT = 144;
+const int OCCLUSION_TILE_SIZE = 8;
+const int OCCLUSION_BOXES_PER_TASK = 256;
+const int OCCLUSION_PARALLEL_BOXES = 1024;
+const int OCCLUSION_BENCHMARK_SMALL = 32;
+const int OCCLUSION_BENCHMARK_LARGE = 64;
+const int OCCLUSION_BENCHMARK_PROPS = 16;
+const int OCCLUSION_BENCHMARK_PASSES = 5;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> What the culler did since the last BeginFrame. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct OcclusionStats
+{
+	int occluders;
+	int triangles;
+	int tested;
+	int occluded;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	What one benchmark measured on a city of blocks, each a building and props in the streets
+/// 	around it, seen from a street: the objects inside the frustum and the ones of them hidden,
+/// 	and in ms the rasterization of the buildings and the test of every object on one thread
+/// 	and on the workers.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct OcclusionBenchmark
+{
+	int occluders;
+	int triangles;
+	int objects;
+	int inFrustum;
+	int occluded;
+	double rasterMs;
+	double testSerialMs;
+	double testParallelMs;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Culls what is hidden behind other things on the CPU, so it never reaches the GPU. Every
+/// 	frame starts with BeginFrame and the view projection matrix of the camera, then the big
+/// 	meshes that hide the most are rasterized with RenderOccluder into a small depth buffer
+/// 	keeping the nearest depth of each pixel, and Finish stores the farthest depth of every
+/// 	tile of 8 by 8 pixels. TestBox and TestBoxes then project a box to the screen and find
+/// 	it hidden if it is behind the tiles it covers, looking at the pixels only of the tiles it
+/// 	isn't behind as a whole.
+///
+/// 	The matrices are in the D3DX layout, a row vector times the matrix, and the depth goes
+/// 	from 0 at the near plane to 1 at the far one. Nothing here touches the device, the tests
+/// 	only read the buffer and run on the workers.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class OcclusionCullerClass
+{
+public:
+	OcclusionCullerClass();
+	OcclusionCullerClass(const OcclusionCullerClass&);
+	~OcclusionCullerClass();
+
+	bool Initialize(int = OCCLUSION_WIDTH, int = OCCLUSION_HEIGHT);
+	void Shutdown();
+
+	void BeginFrame(const float*);
+	void RenderOccluder(const float*, int, int, const unsigned long*, int, const float*);
+	void Finish();
+
+	bool TestBox(const SceneBounds&);
+	int TestBoxes(const SceneBounds*, int, unsigned char*, int = -1);
+
+	void GetStats(OcclusionStats&);
+	int GetWidth();
+	int GetHeight();
+	float GetDepth(int, int);
+
+	static bool Benchmark(int, OcclusionBenchmark&);
+
+private:
+	void RasterizeTriangle(const float*, const float*, const float*);
+
+private:
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	float m_viewProjection[16];
+	vector<float> m_depth;
+	vector<float> m_tileDepth;
+	vector<float> m_clipVertices;
+	OcclusionStats m_stats;
+};
+
+#endif
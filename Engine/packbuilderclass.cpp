@@ -0,0 +1,389 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	packbuilderclass.cpp
+//
+// summary:	Implements the packbuilderclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "packbuilderclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+// Includes.
+#include "compressionclass.h"
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+#include "logclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes zeros up to the next multiple of an alignment. </summary>
+///
+/// <param name="fout">		 The file. </param>
+/// <param name="offset">	 [in,out] The position in the file. </param>
+/// <param name="alignment"> The alignment. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void WritePadding(ofstream& fout, unsigned long long& offset, unsigned int alignment)
+{
+	static const char Zeros[PACK_ALIGNMENT] = { 0 };
+	unsigned int padding;
+
+	padding = (unsigned int)((alignment - offset % alignment) % alignment);
+	fout.write(Zeros, padding);
+	offset += padding;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads a whole file. </summary>
+///
+/// <param name="filename"> Filename of the file. </param>
+/// <param name="data">		[out] The contents. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool ReadSourceFile(const string& filename, vector<char>& data)
+{
+	ifstream fin;
+	streamoff size;
+
+	fin.open(filename.c_str(), ios::in | ios::binary);
+	if(fin.fail())
+	{
+		return false;
+	}
+
+	fin.seekg(0, ios::end);
+	size = fin.tellg();
+	fin.seekg(0, ios::beg);
+	if(size < 0)
+	{
+		return false;
+	}
+
+	data.resize((size_t)size);
+	if(size > 0)
+	{
+		fin.read(&data[0], size);
+	}
+
+	return !fin.fail();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PackBuilderClass::PackBuilderClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PackBuilderClass::PackBuilderClass(const PackBuilderClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PackBuilderClass::~PackBuilderClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a file to the pack, it is only read by Write. </summary>
+///
+/// <param name="source">	   The path of the file. </param>
+/// <param name="name">		   The name of the file in the pack. </param>
+/// <param name="compression"> How it is stored. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PackBuilderClass::AddFile(const char* source, const char* name, PackCompression compression)
+{
+	FileType file;
+
+	if(!source || !name || !name[0])
+	{
+		return false;
+	}
+
+	file.source = source;
+	file.name = PackFileClass::NormalizeName(name);
+	file.hash = PackFileClass::HashName(file.name);
+	file.compression = compression;
+	m_files.push_back(file);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds the files of a list, empty lines and lines starting with # are skipped. </summary>
+///
+/// <param name="filename"> Filename of the list. </param>
+///
+/// <returns> true if it succeeds, false if the list is missing or has a bad line. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PackBuilderClass::AddList(const char* filename)
+{
+	ifstream fin;
+	string line, source, name, mode;
+	PackCompression compression;
+	int number;
+
+	fin.open(filename);
+	if(fin.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not open the pack list %s.", filename);
+		return false;
+	}
+
+	number = 0;
+	while(getline(fin, line))
+	{
+		number++;
+
+		istringstream words(line);
+		source.clear();
+		name.clear();
+		mode = "fast";
+		words >> source >> name >> mode;
+		if(source.empty() || source[0] == '#')
+		{
+			continue;
+		}
+
+		if(mode == "store")
+		{
+			compression = PACK_STORE;
+		}
+		else if(mode == "fast")
+		{
+			compression = PACK_FAST;
+		}
+		else if(mode == "high")
+		{
+			compression = PACK_HIGH;
+		}
+		else
+		{
+			LOG_ERROR(LOG_CATEGORY_RESOURCE, "%s(%d): unknown compression %s.", filename, number, mode.c_str());
+			return false;
+		}
+
+		if(!AddFile(source.c_str(), name.c_str(), compression))
+		{
+			LOG_ERROR(LOG_CATEGORY_RESOURCE, "%s(%d): a file needs a path and a name.", filename, number);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Reads the files, compresses them and writes the pack: the header, the data of the files,
+/// 	the block table, the entries sorted by hash and the names. A pack that fails is removed.
+/// </summary>
+///
+/// <param name="filename"> Filename of the pack. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PackBuilderClass::Write(const char* filename)
+{
+	PackHeader header;
+	PackEntry entry;
+	PackBlock block;
+	vector<PackEntry> entries;
+	vector<PackBlock> blocks;
+	vector<vector<char> > compressed;
+	vector<char> data, names;
+	ofstream fout;
+	unsigned long long offset, sourceBytes;
+	unsigned int i, j, blockCount;
+	bool result;
+
+	PROFILE_FUNCTION();
+
+	// Sort by hash, the order the reader searches in. The same name twice is a mistake in the list.
+	sort(m_files.begin(), m_files.end(), CompareFiles);
+	for(i=1; i<m_files.size(); i++)
+	{
+		if(m_files[i].name == m_files[i - 1].name)
+		{
+			LOG_ERROR(LOG_CATEGORY_RESOURCE, "The pack has two files named %s.", m_files[i].name.c_str());
+			return false;
+		}
+	}
+
+	fout.open(filename, ios::out | ios::binary | ios::trunc);
+	if(fout.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not create the pack %s.", filename);
+		return false;
+	}
+
+	// Leave room for the header, it is written last.
+	memset(&header, 0, sizeof(PackHeader));
+	fout.write((const char*)&header, sizeof(PackHeader));
+	offset = sizeof(PackHeader);
+	sourceBytes = 0;
+
+	for(i=0; i<m_files.size(); i++)
+	{
+		if(!ReadSourceFile(m_files[i].source, data))
+		{
+			LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not read %s.", m_files[i].source.c_str());
+			fout.close();
+			remove(filename);
+			return false;
+		}
+
+		memset(&entry, 0, sizeof(PackEntry));
+		entry.hash = m_files[i].hash;
+		entry.size = data.size();
+		entry.nameOffset = (unsigned int)names.size();
+		entry.compression = (unsigned char)(data.empty() ? PACK_STORE : m_files[i].compression);
+		names.insert(names.end(), m_files[i].name.begin(), m_files[i].name.end());
+		names.push_back(0);
+		sourceBytes += data.size();
+
+		// A stored file is aligned, it is used where it is mapped.
+		if(entry.compression == PACK_STORE)
+		{
+			WritePadding(fout, offset, PACK_ALIGNMENT);
+			entry.offset = offset;
+			if(!data.empty())
+			{
+				fout.write(&data[0], data.size());
+			}
+			offset += data.size();
+			entries.push_back(entry);
+			continue;
+		}
+
+		// Compress the blocks on the workers. A block that doesn't get smaller is kept as it is.
+		blockCount = (unsigned int)((data.size() + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE);
+		compressed.assign(blockCount, vector<char>());
+		{
+			TaskGraphClass tasks;
+
+			for(j=0; j<blockCount; j++)
+			{
+				tasks.AddTask("PackBuilderClass::CompressBlock", [&data, &compressed, &entry, j]() -> bool
+				{
+					const char* source;
+					size_t size, compressedSize;
+
+					source = &data[(size_t)j * PACK_BLOCK_SIZE];
+					size = data.size() - (size_t)j * PACK_BLOCK_SIZE < PACK_BLOCK_SIZE ? data.size() - (size_t)j * PACK_BLOCK_SIZE : PACK_BLOCK_SIZE;
+
+					compressed[j].resize(CompressionClass::GetCompressBound(size));
+					compressedSize = CompressionClass::Compress(source, size, &compressed[j][0], compressed[j].size(), entry.compression == PACK_HIGH ? COMPRESSION_HIGH : COMPRESSION_FAST);
+					if(compressedSize == 0 || compressedSize >= size)
+					{
+						compressed[j].assign(source, source + size);
+					}
+					else
+					{
+						compressed[j].resize(compressedSize);
+					}
+
+					return true;
+				});
+			}
+
+			result = tasks.Run();
+			if(!result)
+			{
+				fout.close();
+				remove(filename);
+				return false;
+			}
+		}
+
+		entry.offset = offset;
+		entry.firstBlock = (unsigned int)blocks.size();
+		entry.blockCount = blockCount;
+		for(j=0; j<blockCount; j++)
+		{
+			block.offset = offset;
+			block.compressedSize = (unsigned int)compressed[j].size();
+			blocks.push_back(block);
+
+			fout.write(&compressed[j][0], compressed[j].size());
+			offset += compressed[j].size();
+		}
+		entries.push_back(entry);
+	}
+
+	// The tables.
+	WritePadding(fout, offset, 8);
+	header.blocksOffset = offset;
+	header.blockCount = (unsigned int)blocks.size();
+	if(!blocks.empty())
+	{
+		fout.write((const char*)&blocks[0], blocks.size() * sizeof(PackBlock));
+	}
+	offset += blocks.size() * sizeof(PackBlock);
+
+	WritePadding(fout, offset, 8);
+	header.entriesOffset = offset;
+	header.entryCount = (unsigned int)entries.size();
+	if(!entries.empty())
+	{
+		fout.write((const char*)&entries[0], entries.size() * sizeof(PackEntry));
+	}
+	offset += entries.size() * sizeof(PackEntry);
+
+	// Even a pack with no files has a name table, the reader checks it ends with a null.
+	names.push_back(0);
+	header.namesOffset = offset;
+	header.namesSize = names.size();
+	fout.write(&names[0], names.size());
+	offset += names.size();
+
+	memcpy(header.magic, "EPAK", 4);
+	header.version = PACK_VERSION;
+	header.blockSize = PACK_BLOCK_SIZE;
+	fout.seekp(0, ios::beg);
+	fout.write((const char*)&header, sizeof(PackHeader));
+
+	fout.close();
+	if(fout.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not write the pack %s.", filename);
+		remove(filename);
+		return false;
+	}
+
+	LOG_INFO(LOG_CATEGORY_RESOURCE, "Wrote %s, %u files, %llu bytes packed into %llu.", filename, header.entryCount, sourceBytes, offset);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sort order of the files, by hash and then by name. </summary>
+///
+/// <param name="a"> The first file. </param>
+/// <param name="b"> The second file. </param>
+///
+/// <returns> true if a goes before b. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PackBuilderClass::CompareFiles(const FileType& a, const FileType& b)
+{
+	if(a.hash != b.hash)
+	{
+		return a.hash < b.hash;
+	}
+
+	return a.name < b.name;
+}
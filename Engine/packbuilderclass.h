@@ -0,0 +1,58 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	packbuilderclass.h
+//
+// summary:	Declares the packbuilderclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _PACKBUILDERCLASS_H_
+#define _PACKBUILDERCLASS_H_
+
+// System Includes.
+#include <string>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "packfileclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds the packs read by PackFileClass. The files are added one by one or from a list,
+/// 	a text file with a line per file:
+///
+/// 	../Engine/color.vs color.vs store
+/// 	../Engine/cube.txt cube.txt high
+///
+/// 	The path of the file, the name it gets in the pack, and how it is stored: store keeps it
+/// 	as it is so it can be used straight from the mapped pack, fast and high compress it in
+/// 	blocks, high taking longer to get it smaller. Write compresses the blocks on several
+/// 	threads and writes the pack.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class PackBuilderClass
+{
+private:
+	struct FileType
+	{
+		string source;
+		string name;
+		unsigned long long hash;
+		PackCompression compression;
+	};
+
+public:
+	PackBuilderClass();
+	PackBuilderClass(const PackBuilderClass&);
+	~PackBuilderClass();
+
+	bool AddFile(const char*, const char*, PackCompression);
+	bool AddList(const char*);
+	bool Write(const char*);
+
+private:
+	static bool CompareFiles(const FileType&, const FileType&);
+
+private:
+	vector<FileType> m_files;
+};
+
+#endif
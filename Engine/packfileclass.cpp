@@ -0,0 +1,400 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	packfileclass.cpp
+//
+// summary:	Implements the packfileclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "packfileclass.h"
+
+// System Includes.
+#include <cstring>
+
+// Includes.
+#include "platformclass.h"
+#include "compressionclass.h"
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+#include "logclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PackFileClass::PackFileClass()
+{
+	m_data = 0;
+	m_size = 0;
+	m_header = 0;
+	m_entries = 0;
+	m_blocks = 0;
+	m_names = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PackFileClass::PackFileClass(const PackFileClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PackFileClass::~PackFileClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Maps a pack and checks its tables, so the reads after this can trust every offset in
+/// 	them. The data of the files isn't touched.
+/// </summary>
+///
+/// <param name="filename"> Filename of the pack. </param>
+///
+/// <returns> true if it succeeds, false if the pack is missing or damaged. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PackFileClass::Initialize(const char* filename)
+{
+	const PackEntry* entry;
+	const PackBlock* block;
+	unsigned long long blocks;
+	unsigned int i, j;
+
+	PROFILE_FUNCTION();
+
+	m_data = PlatformClass::MapFile(filename, m_size);
+	if(!m_data)
+	{
+		return false;
+	}
+
+	// Check the header and that every table is inside the file.
+	m_header = (const PackHeader*)m_data;
+	if(m_size < sizeof(PackHeader) || memcmp(m_header->magic, "EPAK", 4) != 0 || m_header->version != PACK_VERSION || m_header->blockSize == 0 ||
+	   m_header->entriesOffset > m_size || m_header->entryCount > (m_size - m_header->entriesOffset) / sizeof(PackEntry) ||
+	   m_header->blocksOffset > m_size || m_header->blockCount > (m_size - m_header->blocksOffset) / sizeof(PackBlock) ||
+	   m_header->namesOffset > m_size || m_header->namesSize > m_size - m_header->namesOffset ||
+	   m_header->namesSize == 0 || m_data[m_header->namesOffset + m_header->namesSize - 1] != 0)
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "%s is not a pack of version %u.", filename, PACK_VERSION);
+		Shutdown();
+		return false;
+	}
+
+	m_entries = (const PackEntry*)(m_data + m_header->entriesOffset);
+	m_blocks = (const PackBlock*)(m_data + m_header->blocksOffset);
+	m_names = m_data + m_header->namesOffset;
+
+	// Check every entry and block.
+	for(i=0; i<m_header->entryCount; i++)
+	{
+		entry = &m_entries[i];
+		blocks = (entry->size + m_header->blockSize - 1) / m_header->blockSize;
+
+		if(entry->nameOffset >= m_header->namesSize || (i > 0 && entry->hash < m_entries[i - 1].hash))
+		{
+			break;
+		}
+
+		if(entry->compression == PACK_STORE)
+		{
+			if(entry->offset > m_size || entry->size > m_size - entry->offset)
+			{
+				break;
+			}
+			continue;
+		}
+
+		if(entry->blockCount != blocks || entry->firstBlock > m_header->blockCount || entry->blockCount > m_header->blockCount - entry->firstBlock)
+		{
+			break;
+		}
+
+		for(j=0; j<entry->blockCount; j++)
+		{
+			block = &m_blocks[entry->firstBlock + j];
+			if(block->offset > m_size || block->compressedSize > m_size - block->offset)
+			{
+				break;
+			}
+		}
+		if(j < entry->blockCount)
+		{
+			break;
+		}
+	}
+
+	if(i < m_header->entryCount)
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "The entry %u of the pack %s is damaged.", i, filename);
+		Shutdown();
+		return false;
+	}
+
+	LOG_INFO(LOG_CATEGORY_RESOURCE, "Mounted pack %s, %u files in %u blocks.", filename, m_header->entryCount, m_header->blockCount);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Unmaps the pack. The data handed out by GetMappedData goes with it. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PackFileClass::Shutdown()
+{
+	PlatformClass::UnmapFile(m_data, m_size);
+
+	m_data = 0;
+	m_size = 0;
+	m_header = 0;
+	m_entries = 0;
+	m_blocks = 0;
+	m_names = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if the pack has a file. </summary>
+///
+/// <param name="name"> The name of the file. </param>
+///
+/// <returns> true if it has it, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PackFileClass::Contains(const char* name)
+{
+	return FindEntry(name) != 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads a file, decompressing it if needed. </summary>
+///
+/// <param name="name"> The name of the file. </param>
+/// <param name="data"> [out] The contents of the file. </param>
+///
+/// <returns> true if it succeeds, false if the pack doesn't have it or it is damaged. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PackFileClass::Read(const char* name, vector<char>& data)
+{
+	const PackEntry* entry;
+	TaskGraphClass blocks;
+	bool result;
+	unsigned int i;
+	char* output;
+
+	PROFILE_FUNCTION();
+
+	entry = FindEntry(name);
+	if(!entry)
+	{
+		return false;
+	}
+
+	data.resize((size_t)entry->size);
+	if(entry->size == 0)
+	{
+		return true;
+	}
+	output = &data[0];
+
+	if(entry->compression == PACK_STORE)
+	{
+		memcpy(output, m_data + entry->offset, (size_t)entry->size);
+		return true;
+	}
+
+	// The blocks are independent, a big file decompresses them all at the same time.
+	if(entry->blockCount >= PACK_PARALLEL_BLOCKS)
+	{
+		for(i=0; i<entry->blockCount; i++)
+		{
+			blocks.AddTask("PackFileClass::ReadBlock", [this, entry, i, output]() -> bool
+			{
+				return ReadBlock(entry, i, output + (size_t)i * m_header->blockSize);
+			});
+		}
+
+		result = blocks.Run();
+	}
+	else
+	{
+		result = true;
+		for(i=0; i<entry->blockCount && result; i++)
+		{
+			result = ReadBlock(entry, i, output + (size_t)i * m_header->blockSize);
+		}
+	}
+
+	if(!result)
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "The file %s of the pack is damaged.", name);
+		data.clear();
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets a stored file where it is mapped, without copying it. </summary>
+///
+/// <param name="name"> The name of the file. </param>
+/// <param name="size"> [out] The size of the file. </param>
+///
+/// <returns> The contents, valid until Shutdown; 0 if the pack doesn't have it or it is compressed. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* PackFileClass::GetMappedData(const char* name, size_t& size)
+{
+	const PackEntry* entry;
+
+	size = 0;
+
+	entry = FindEntry(name);
+	if(!entry || entry->compression != PACK_STORE)
+	{
+		return 0;
+	}
+
+	size = (size_t)entry->size;
+
+	return m_data + entry->offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets the name a file has in a pack: lower case, with forward slashes and without a
+/// 	leading "./", so the way a path is written doesn't matter.
+/// </summary>
+///
+/// <param name="name"> The name. </param>
+///
+/// <returns> The normalized name. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+string PackFileClass::NormalizeName(const char* name)
+{
+	string normalized;
+	unsigned int i;
+
+	normalized = name ? name : "";
+	for(i=0; i<normalized.size(); i++)
+	{
+		if(normalized[i] == '\\')
+		{
+			normalized[i] = '/';
+		}
+		else if(normalized[i] >= 'A' && normalized[i] <= 'Z')
+		{
+			normalized[i] = normalized[i] - 'A' + 'a';
+		}
+	}
+
+	while(normalized.compare(0, 2, "./") == 0)
+	{
+		normalized.erase(0, 2);
+	}
+
+	return normalized;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Hashes a normalized name, 64 bit FNV-1a. </summary>
+///
+/// <param name="name"> The normalized name. </param>
+///
+/// <returns> The hash. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned long long PackFileClass::HashName(const string& name)
+{
+	unsigned long long hash;
+	unsigned int i;
+
+	hash = 14695981039346656037ULL;
+	for(i=0; i<name.size(); i++)
+	{
+		hash ^= (unsigned char)name[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the entry of a file, by a binary search of the hashes. </summary>
+///
+/// <param name="name"> The name of the file. </param>
+///
+/// <returns> The entry, 0 if the pack doesn't have the file. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const PackEntry* PackFileClass::FindEntry(const char* name)
+{
+	string normalized;
+	unsigned long long hash;
+	unsigned int first, count, step;
+
+	if(!m_data || !name)
+	{
+		return 0;
+	}
+
+	normalized = NormalizeName(name);
+	hash = HashName(normalized);
+
+	// Find the first entry with the hash.
+	first = 0;
+	count = m_header->entryCount;
+	while(count > 0)
+	{
+		step = count / 2;
+		if(m_entries[first + step].hash < hash)
+		{
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+		{
+			count = step;
+		}
+	}
+
+	// Compare the names, two names can share a hash.
+	for(; first<m_header->entryCount && m_entries[first].hash == hash; first++)
+	{
+		if(normalized == m_names + m_entries[first].nameOffset)
+		{
+			return &m_entries[first];
+		}
+	}
+
+	return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Decompresses one block of a file. </summary>
+///
+/// <param name="entry">  The entry of the file. </param>
+/// <param name="index">  The block of the file. </param>
+/// <param name="output"> [out] Where the block goes in the file. </param>
+///
+/// <returns> true if it succeeds, false if the block is damaged. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PackFileClass::ReadBlock(const PackEntry* entry, unsigned int index, char* output)
+{
+	const PackBlock* block;
+	unsigned long long start;
+	size_t size;
+
+	block = &m_blocks[entry->firstBlock + index];
+
+	// Every block is full but the last.
+	start = (unsigned long long)index * m_header->blockSize;
+	size = (size_t)(entry->size - start < m_header->blockSize ? entry->size - start : m_header->blockSize);
+
+	// A block that didn't compress is stored as it is.
+	if(block->compressedSize == size)
+	{
+		memcpy(output, m_data + block->offset, size);
+		return true;
+	}
+
+	return CompressionClass::Decompress(m_data + block->offset, block->compressedSize, output, size);
+}
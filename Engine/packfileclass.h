@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	packfileclass.h
+//
+// summary:	Declares the packfileclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _PACKFILECLASS_H_
+#define _PACKFILECLASS_H_
+
+// System Includes.
+#include <string>
+#include <vector>
+using namespace std;
+
+// Globals.
+const unsigned int PACK_VERSION = 1;
+const unsigned int PACK_BLOCK_SIZE = 64 * 1024;
+const unsigned int PACK_ALIGNMENT = 16;
+const unsigned int PACK_PARALLEL_BLOCKS = 4;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent how an entry is stored. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum PackCompression
+{
+	PACK_STORE,
+	PACK_FAST,
+	PACK_HIGH
+};
+
+// The structures below are the file layout, so they have no padding.
+#pragma pack(push, 1)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The start of the file. The entries are sorted by the hash of their name, each compressed
+/// 	entry owns a run of the block table, and the names are null terminated strings.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct PackHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int blockSize;
+	unsigned int entryCount;
+	unsigned int blockCount;
+	unsigned long long entriesOffset;
+	unsigned long long blocksOffset;
+	unsigned long long namesOffset;
+	unsigned long long namesSize;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	One file of the pack. A stored entry is size bytes at offset, aligned so it can be used
+/// 	where it is mapped; a compressed one is blockCount blocks starting at firstBlock, each
+/// 	holding blockSize bytes of the file (the last one the rest).
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct PackEntry
+{
+	unsigned long long hash;
+	unsigned long long offset;
+	unsigned long long size;
+	unsigned int firstBlock;
+	unsigned int blockCount;
+	unsigned int nameOffset;
+	unsigned char compression;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> One compressed block. A block that didn't get smaller is stored as it is, with its own size. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct PackBlock
+{
+	unsigned long long offset;
+	unsigned int compressedSize;
+};
+
+#pragma pack(pop)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Reads the files of a pack built by PackBuilderClass. The whole pack is mapped, so opening
+/// 	it is one open and finding a file is a binary search of the hashes; nothing is read from
+/// 	the disk until it is used. A stored file is handed out where it is mapped, without a
+/// 	copy; a compressed one is decompressed a block at a time, on several threads when it has
+/// 	enough blocks. The pack is read only once open, so any thread can read from it.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class PackFileClass
+{
+public:
+	PackFileClass();
+	PackFileClass(const PackFileClass&);
+	~PackFileClass();
+
+	bool Initialize(const char*);
+	void Shutdown();
+
+	bool Contains(const char*);
+	bool Read(const char*, vector<char>&);
+	const char* GetMappedData(const char*, size_t&);
+
+	static string NormalizeName(const char*);
+	static unsigned long long HashName(const string&);
+
+private:
+	const PackEntry* FindEntry(const char*);
+	bool ReadBlock(const PackEntry*, unsigned int, char*);
+
+private:
+	const char* m_data;
+	size_t m_size;
+	const PackHeader* m_header;
+	const PackEntry* m_entries;
+	const PackBlock* m_blocks;
+	const char* m_names;
+};
+
+#endif
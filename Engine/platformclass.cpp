@@ -0,0 +1,449 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	platformclass.cpp
+//
+// summary:	Implements the platformclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "platformclass.h"
+
+// System Includes.
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <cstdio>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PlatformClass::PlatformClass()
+{
+	m_eventRead = 0;
+	m_eventWrite = 0;
+	m_droppedEvents = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PlatformClass::PlatformClass(const PlatformClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PlatformClass::~PlatformClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of events lost because the frame loop didn't poll them in time. </summary>
+///
+/// <returns> The dropped events. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned long PlatformClass::GetDroppedEvents()
+{
+	return m_droppedEvents;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads the high resolution clock of the operating system. </summary>
+///
+/// <returns> The current time in ticks. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned long long PlatformClass::GetTicks()
+{
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+
+	QueryPerformanceCounter(&counter);
+
+	return (unsigned long long)counter.QuadPart;
+#else
+	timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (unsigned long long)now.tv_sec * 1000000000ull + (unsigned long long)now.tv_nsec;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the frequency of the high resolution clock. </summary>
+///
+/// <returns> The ticks per second. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned long long PlatformClass::GetTicksPerSecond()
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceFrequency(&frequency);
+
+	return (unsigned long long)frequency.QuadPart;
+#else
+	return 1000000000ull;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of logical processors. </summary>
+///
+/// <returns> The processor count, at least 1. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int PlatformClass::GetProcessorCount()
+{
+	int count;
+
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	count = (int)info.dwNumberOfProcessors;
+#else
+	count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	return count > 0 ? count : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Pins the calling thread to one logical processor. </summary>
+///
+/// <param name="processor"> The processor, below GetProcessorCount. </param>
+///
+/// <returns> true if it succeeds, false if it fails or the platform can't do it. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PlatformClass::SetThreadAffinity(int processor)
+{
+	if(processor < 0 || processor >= GetProcessorCount() || processor >= 64)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << processor) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(processor, &set);
+
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the size of a virtual memory page, what Commit and Decommit work in. </summary>
+///
+/// <returns> The page size in bytes. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t PlatformClass::GetPageSize()
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+
+	return (size_t)info.dwPageSize;
+#else
+	return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reserves address space without backing it with memory. </summary>
+///
+/// <param name="size"> The size in bytes. </param>
+///
+/// <returns> The start of the range, null if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void* PlatformClass::ReserveMemory(size_t size)
+{
+#ifdef _WIN32
+	return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+	void* memory;
+
+	memory = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	return memory == MAP_FAILED ? 0 : memory;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Backs part of a reserved range with zeroed, read / write memory. </summary>
+///
+/// <param name="memory"> The start, page aligned. </param>
+/// <param name="size">   The size in bytes. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PlatformClass::CommitMemory(void* memory, size_t size)
+{
+#ifdef _WIN32
+	return VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+	return mprotect(memory, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives the memory of part of a range back, keeping the address space reserved. </summary>
+///
+/// <param name="memory"> The start, page aligned. </param>
+/// <param name="size">   The size in bytes. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PlatformClass::DecommitMemory(void* memory, size_t size)
+{
+#ifdef _WIN32
+	VirtualFree(memory, size, MEM_DECOMMIT);
+#else
+	madvise(memory, size, MADV_DONTNEED);
+	mprotect(memory, size, PROT_NONE);
+#endif
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases a whole range returned by ReserveMemory. </summary>
+///
+/// <param name="memory"> The start of the range. </param>
+/// <param name="size">   The size given to ReserveMemory. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PlatformClass::ReleaseMemory(void* memory, size_t size)
+{
+	if(!memory)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	VirtualFree(memory, 0, MEM_RELEASE);
+#else
+	munmap(memory, size);
+#endif
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Maps a whole file read only. The pages are read from the disk the first time they are
+/// 	touched and are shared with the file cache, so nothing is copied.
+/// </summary>
+///
+/// <param name="filename"> Filename of the file. </param>
+/// <param name="size">		[out] The size of the file. </param>
+///
+/// <returns> The start of the mapped file, 0 if it fails or the file is empty. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* PlatformClass::MapFile(const char* filename, size_t& size)
+{
+	void* memory;
+
+	size = 0;
+
+#ifdef _WIN32
+	HANDLE file, mapping;
+	LARGE_INTEGER fileSize;
+
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		return 0;
+	}
+
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return 0;
+	}
+
+	mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if(!mapping)
+	{
+		return 0;
+	}
+
+	// The view keeps the mapping alive.
+	memory = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if(!memory)
+	{
+		return 0;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+#else
+	struct stat status;
+	int file;
+
+	file = open(filename, O_RDONLY);
+	if(file < 0)
+	{
+		return 0;
+	}
+
+	if(fstat(file, &status) != 0 || status.st_size == 0)
+	{
+		close(file);
+		return 0;
+	}
+
+	// The mapping keeps the file alive.
+	memory = mmap(0, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if(memory == MAP_FAILED)
+	{
+		return 0;
+	}
+
+	size = (size_t)status.st_size;
+#endif
+
+	return (const char*)memory;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Unmaps a file mapped by MapFile. </summary>
+///
+/// <param name="memory"> The start of the mapped file. </param>
+/// <param name="size">   The size of the file. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PlatformClass::UnmapFile(const char* memory, size_t size)
+{
+	if(!memory)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(memory);
+#else
+	munmap((void*)memory, size);
+#endif
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets the memory of the process. The resident bytes count the pages of mapped files it
+/// 	touched, which the system can drop and read again; the private bytes only count what
+/// 	the process allocated, what it really costs the machine.
+/// </summary>
+///
+/// <param name="residentBytes"> [out] The bytes of physical memory the process is using. </param>
+/// <param name="privateBytes">  [out] The bytes of them that belong to the process alone. </param>
+///
+/// <returns> true if it succeeds, false if the system can't tell. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PlatformClass::GetMemoryUsage(unsigned long long& residentBytes, unsigned long long& privateBytes)
+{
+	residentBytes = 0;
+	privateBytes = 0;
+
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS_EX counters;
+
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters)))
+	{
+		return false;
+	}
+
+	residentBytes = counters.WorkingSetSize;
+	privateBytes = counters.PrivateUsage;
+
+	return true;
+#else
+	FILE* file;
+	unsigned long long pages, resident, shared;
+	int count;
+
+	// The sizes are in pages: the whole address space, what is resident, and what of that is shared with files.
+	file = fopen("/proc/self/statm", "r");
+	if(!file)
+	{
+		return false;
+	}
+
+	count = fscanf(file, "%llu %llu %llu", &pages, &resident, &shared);
+	fclose(file);
+	if(count != 3)
+	{
+		return false;
+	}
+
+	residentBytes = resident * GetPageSize();
+	privateBytes = (resident - shared) * GetPageSize();
+
+	return true;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Queues an event for PollEvent. </summary>
+///
+/// <param name="type"> The type. </param>
+/// <param name="code"> The key code or the focus. </param>
+/// <param name="x">    The x value. </param>
+/// <param name="y">    The y value. </param>
+///
+/// <returns> true if it succeeds, false if the queue is full and the event was dropped. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PlatformClass::PushEvent(unsigned int type, unsigned int code, int x, int y)
+{
+	PlatformEvent* event;
+
+	if(m_eventWrite - m_eventRead >= (unsigned int)PLATFORM_EVENT_QUEUE_SIZE)
+	{
+		m_droppedEvents++;
+		return false;
+	}
+
+	event = &m_events[m_eventWrite % PLATFORM_EVENT_QUEUE_SIZE];
+	event->type = type;
+	event->code = code;
+	event->x = x;
+	event->y = y;
+	m_eventWrite++;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Takes the oldest queued event. </summary>
+///
+/// <param name="event"> [out] The event. </param>
+///
+/// <returns> true if there was one, false if the queue is empty. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PlatformClass::PopEvent(PlatformEvent& event)
+{
+	if(m_eventRead == m_eventWrite)
+	{
+		return false;
+	}
+
+	event = m_events[m_eventRead % PLATFORM_EVENT_QUEUE_SIZE];
+	m_eventRead++;
+
+	return true;
+}
@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	platformclass.h
+//
+// summary:	Declares the platformclass interface
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _PLATFORMCLASS_H_
+#define _PLATFORMCLASS_H_
+
+// System Includes.
+#include <cstddef>
+
+// Globals.
+const int PLATFORM_EVENT_QUEUE_SIZE = 256;
+
+// Key codes, the windows virtual key codes on every platform (letters and digits are their ascii code).
+const unsigned int PLATFORM_KEY_LBUTTON = 0x01;
+const unsigned int PLATFORM_KEY_RBUTTON = 0x02;
+const unsigned int PLATFORM_KEY_MBUTTON = 0x04;
+const unsigned int PLATFORM_KEY_ESCAPE = 0x1B;
+const unsigned int PLATFORM_KEY_SPACE = 0x20;
+const unsigned int PLATFORM_KEY_LEFT = 0x25;
+const unsigned int PLATFORM_KEY_UP = 0x26;
+const unsigned int PLATFORM_KEY_RIGHT = 0x27;
+const unsigned int PLATFORM_KEY_DOWN = 0x28;
+const unsigned int PLATFORM_KEY_F11 = 0x7A;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the platform event types. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum PlatformEventType
+{
+	PLATFORM_EVENT_QUIT,
+	PLATFORM_EVENT_RESIZE,
+	PLATFORM_EVENT_FOCUS,
+	PLATFORM_EVENT_KEY_DOWN,
+	PLATFORM_EVENT_KEY_UP,
+	PLATFORM_EVENT_MOUSE_MOVE,
+	PLATFORM_EVENT_MOUSE_WHEEL
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	One event from the platform. Keys and mouse buttons keep their key code in code, a resize
+/// 	the new client size in x and y, a focus change 1 (gained) or 0 (lost) in code, a mouse
+/// 	move the cursor position in x and y, and a wheel turn its delta in x.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct PlatformEvent
+{
+	unsigned int type;
+	unsigned int code;
+	int x;
+	int y;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The platform layer, everything the frame loop needs from the operating system. The
+/// 	window and the event pump are implemented by a backend: Win32PlatformClass opens a real
+/// 	window, HeadlessPlatformClass makes up the events of a user so the loop can run where
+/// 	there is no window at all. The clock, the thread affinity, the virtual memory and the
+/// 	file mapping functions only depend on the operating system and are shared by every backend.
+///
+/// 	The frame loop calls PollEvent until it returns false, which drains what the platform
+/// 	has for that frame.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class PlatformClass
+{
+public:
+	PlatformClass();
+	PlatformClass(const PlatformClass&);
+	virtual ~PlatformClass();
+
+	// Open the window (full screen or not) and return the size of its client area.
+	virtual bool Initialize(bool, int&, int&) = 0;
+	virtual void Shutdown() = 0;
+
+	// Get the next event, returns false when there is none left for this frame.
+	virtual bool PollEvent(PlatformEvent&) = 0;
+
+	// The native window (a HWND on windows), 0 when there is no window to render to.
+	virtual void* GetWindowHandle() = 0;
+
+	unsigned long GetDroppedEvents();
+
+	static unsigned long long GetTicks();
+	static unsigned long long GetTicksPerSecond();
+
+	static int GetProcessorCount();
+	static bool SetThreadAffinity(int);
+
+	static size_t GetPageSize();
+	static void* ReserveMemory(size_t);
+	static bool CommitMemory(void*, size_t);
+	static void DecommitMemory(void*, size_t);
+	static void ReleaseMemory(void*, size_t);
+
+	static const char* MapFile(const char*, size_t&);
+	static void UnmapFile(const char*, size_t);
+
+	static bool GetMemoryUsage(unsigned long long&, unsigned long long&);
+
+protected:
+	bool PushEvent(unsigned int, unsigned int, int, int);
+	bool PopEvent(PlatformEvent&);
+
+private:
+	PlatformEvent m_events[PLATFORM_EVENT_QUEUE_SIZE];
+	unsigned int m_eventRead;
+	unsigned int m_eventWrite;
+	unsigned long m_droppedEvents;
+};
+
+#endif
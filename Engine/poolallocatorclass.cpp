@@ -0,0 +1,308 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	poolallocatorclass.cpp
+//
+// summary:	Implements the poolallocatorclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "poolallocatorclass.h"
+
+// System Includes.
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PoolAllocatorClass::PoolAllocatorClass()
+{
+	m_memory = 0;
+	m_base = 0;
+	m_freeList = 0;
+	m_blockSize = 0;
+	m_blockCount = 0;
+	memset(&m_stats, 0, sizeof(AllocatorStats));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PoolAllocatorClass::PoolAllocatorClass(const PoolAllocatorClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+PoolAllocatorClass::~PoolAllocatorClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reserves the blocks and threads all of them into the free list. </summary>
+///
+/// <param name="blockSize">  The size of each block in bytes. </param>
+/// <param name="blockCount"> The number of blocks. </param>
+/// <param name="alignment">  The alignment of each block, must be a power of two. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PoolAllocatorClass::Initialize(size_t blockSize, size_t blockCount, size_t alignment)
+{
+	size_t misalignment, i;
+	char* block;
+
+	// A free block must at least be able to hold the next pointer, and every block must stay aligned.
+	if(blockSize < sizeof(void*))
+	{
+		blockSize = sizeof(void*);
+	}
+	blockSize = (blockSize + (alignment - 1)) & ~(alignment - 1);
+
+	m_memory = new char[blockSize * blockCount + alignment];
+	if(!m_memory)
+	{
+		return false;
+	}
+
+	misalignment = (size_t)m_memory & (alignment - 1);
+	m_base = m_memory + (misalignment ? alignment - misalignment : 0);
+
+	m_blockSize = blockSize;
+	m_blockCount = blockCount;
+
+	// Link every block to the one after it, the last one ends the list.
+	m_freeList = 0;
+	for(i=blockCount; i>0; i--)
+	{
+		block = m_base + (i - 1) * blockSize;
+		*(void**)block = m_freeList;
+		m_freeList = block;
+	}
+
+	memset(&m_stats, 0, sizeof(AllocatorStats));
+	m_stats.capacity = blockSize * blockCount;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Releases the blocks. Objects still living in the pool are not destroyed, so every
+/// 	New must have had its Delete before this.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PoolAllocatorClass::Shutdown()
+{
+	if(m_memory)
+	{
+		delete [] m_memory;
+		m_memory = 0;
+	}
+
+	m_base = 0;
+	m_freeList = 0;
+	m_blockSize = 0;
+	m_blockCount = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Pops a block from the free list. </summary>
+///
+/// <returns> The block, or null if the pool is exhausted. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void* PoolAllocatorClass::Allocate()
+{
+	void* block;
+
+	if(!m_freeList)
+	{
+		m_stats.failedAllocations++;
+		return 0;
+	}
+
+	block = m_freeList;
+	m_freeList = *(void**)block;
+
+	// Update the statistics.
+	m_stats.used += m_blockSize;
+	m_stats.allocationCount++;
+	m_stats.totalAllocations++;
+	if(m_stats.used > m_stats.peak)
+	{
+		m_stats.peak = m_stats.used;
+	}
+	if(m_stats.used > m_stats.highWaterMark)
+	{
+		m_stats.highWaterMark = m_stats.used;
+	}
+
+	return block;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Pushes a block back into the free list. </summary>
+///
+/// <param name="block"> The block, must come from this pool. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PoolAllocatorClass::Free(void* block)
+{
+	if(!block || !Owns(block))
+	{
+		return;
+	}
+
+	*(void**)block = m_freeList;
+	m_freeList = block;
+
+	m_stats.used -= m_blockSize;
+	m_stats.allocationCount--;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks if a pointer is the start of one of the blocks of this pool. </summary>
+///
+/// <param name="block"> The pointer. </param>
+///
+/// <returns> true if the pool owns it, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PoolAllocatorClass::Owns(void* block)
+{
+	char* pointer;
+
+	pointer = (char*)block;
+	if(pointer < m_base || pointer >= m_base + m_blockSize * m_blockCount)
+	{
+		return false;
+	}
+
+	return ((size_t)(pointer - m_base) % m_blockSize) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets the usage statistics. For a pool the allocation count is the number of blocks
+/// 	currently in use.
+/// </summary>
+///
+/// <param name="stats"> [out] The statistics. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void PoolAllocatorClass::GetStats(AllocatorStats& stats)
+{
+	stats = m_stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Checks a pool of ALLOCATOR_BENCHMARK_ALLOCATIONS blocks: every block is aligned and
+/// 	distinct, the pool refuses one more, and freed blocks come back last in, first out. Then
+/// 	times rounds of filling and emptying it against new and delete of the same size.
+/// </summary>
+///
+/// <param name="benchmark"> [out] The checks and the timings. </param>
+///
+/// <returns> true if every check passed, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool PoolAllocatorClass::Benchmark(AllocatorBenchmark& benchmark)
+{
+	PoolAllocatorClass pool;
+	vector<char*> blocks;
+	AllocatorStats stats;
+	unsigned long long start, elapsed;
+	int round, i;
+	bool result;
+
+	memset(&benchmark, 0, sizeof(AllocatorBenchmark));
+	benchmark.allocations = ALLOCATOR_BENCHMARK_ALLOCATIONS;
+	benchmark.rounds = ALLOCATOR_BENCHMARK_ROUNDS;
+
+	if(!pool.Initialize(ALLOCATOR_BENCHMARK_SIZE, ALLOCATOR_BENCHMARK_ALLOCATIONS))
+	{
+		return false;
+	}
+
+	blocks.resize(ALLOCATOR_BENCHMARK_ALLOCATIONS);
+
+	// Every block comes out aligned, owned and apart from the one before it.
+	result = true;
+	for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+	{
+		blocks[i] = (char*)pool.Allocate();
+		if(!blocks[i] || ((size_t)blocks[i] & (DEFAULT_ALIGNMENT - 1)) != 0 || !pool.Owns(blocks[i]) ||
+			(i > 0 && blocks[i] - blocks[i - 1] < (ptrdiff_t)ALLOCATOR_BENCHMARK_SIZE))
+		{
+			result = false;
+		}
+	}
+	benchmark.checks++;
+	benchmark.failures += result ? 0 : 1;
+
+	// A full pool refuses, and counts it.
+	result = pool.Allocate() == 0;
+	pool.GetStats(stats);
+	result = result && stats.failedAllocations == 1 && stats.allocationCount == ALLOCATOR_BENCHMARK_ALLOCATIONS;
+	benchmark.checks++;
+	benchmark.failures += result ? 0 : 1;
+
+	// What is freed last is handed out first, and a pointer the pool doesn't own is ignored.
+	pool.Free(blocks[3]);
+	pool.Free(blocks[7]);
+	pool.Free(&stats);
+	result = pool.Allocate() == blocks[7] && pool.Allocate() == blocks[3];
+	benchmark.checks++;
+	benchmark.failures += result ? 0 : 1;
+
+	for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+	{
+		pool.Free(blocks[i]);
+	}
+	pool.GetStats(stats);
+	result = stats.used == 0 && stats.allocationCount == 0 && stats.highWaterMark == stats.capacity;
+	benchmark.checks++;
+	benchmark.failures += result ? 0 : 1;
+
+	// Time filling and emptying the pool, the blocks are written so nothing is optimized away.
+	start = ProfilerClass::GetTimestamp();
+	for(round=0; round<ALLOCATOR_BENCHMARK_ROUNDS; round++)
+	{
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			blocks[i] = (char*)pool.Allocate();
+			blocks[i][0] = (char)i;
+		}
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			pool.Free(blocks[i]);
+		}
+	}
+	elapsed = ProfilerClass::GetTimestamp() - start;
+	benchmark.allocatorMs = ProfilerClass::TicksToMilliseconds(elapsed) / ALLOCATOR_BENCHMARK_ROUNDS;
+
+	start = ProfilerClass::GetTimestamp();
+	for(round=0; round<ALLOCATOR_BENCHMARK_ROUNDS; round++)
+	{
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			blocks[i] = new char[ALLOCATOR_BENCHMARK_SIZE];
+			blocks[i][0] = (char)i;
+		}
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			delete [] blocks[i];
+		}
+	}
+	elapsed = ProfilerClass::GetTimestamp() - start;
+	benchmark.heapMs = ProfilerClass::TicksToMilliseconds(elapsed) / ALLOCATOR_BENCHMARK_ROUNDS;
+
+	pool.Shutdown();
+
+	return benchmark.failures == 0;
+}
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	poolallocatorclass.h
+//
+// summary:	Declares the poolallocatorclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _POOLALLOCATORCLASS_H_
+#define _POOLALLOCATORCLASS_H_
+
+// System Includes.
+#include <new>
+
+// Includes.
+#include "allocatorstats.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A pool of fixed size blocks carved out of one allocation. Free blocks are kept in an
+/// 	intrusive list (the first bytes of a free block point to the next one), so allocating
+/// 	and freeing are both a couple of pointer moves. New and Delete construct and destroy
+/// 	engine objects inside the pool the same way new and delete would on the heap.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class PoolAllocatorClass
+{
+public:
+	PoolAllocatorClass();
+	PoolAllocatorClass(const PoolAllocatorClass&);
+	~PoolAllocatorClass();
+
+	bool Initialize(size_t, size_t, size_t = DEFAULT_ALIGNMENT);
+	void Shutdown();
+
+	void* Allocate();
+	void Free(void*);
+	bool Owns(void*);
+
+	void GetStats(AllocatorStats&);
+
+	static bool Benchmark(AllocatorBenchmark&);
+
+	template<class T> T* New()
+	{
+		void* memory;
+
+		if(sizeof(T) > m_blockSize)
+		{
+			m_stats.failedAllocations++;
+			return 0;
+		}
+
+		memory = Allocate();
+		if(!memory)
+		{
+			return 0;
+		}
+
+		return new(memory) T;
+	}
+
+	template<class T> void Delete(T* object)
+	{
+		if(object)
+		{
+			object->~T();
+			Free(object);
+		}
+	}
+
+private:
+	char* m_memory;
+	char* m_base;
+	void* m_freeList;
+	size_t m_blockSize;
+	size_t m_blockCount;
+	AllocatorStats m_stats;
+};
+
+#endif
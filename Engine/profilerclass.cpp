@@ -0,0 +1,690 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	profilerclass.cpp
+//
+// summary:	Implements the profilerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "profilerclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+// Globals.
+const double PROFILER_CALIBRATION_MS = 20.0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The per frame totals and history of one zone name. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct ProfilerZoneType
+{
+	const char* name;
+	unsigned long long frameTicks;
+	unsigned long long frameSelfTicks;
+	unsigned int frameCalls;
+	unsigned long long totalCalls;
+	float history[PROFILER_HISTORY];
+	float selfHistory[PROFILER_HISTORY];
+	unsigned int callHistory[PROFILER_HISTORY];
+};
+
+THREAD_LOCAL ProfilerThreadBuffer* ProfilerThreadData = 0;
+THREAD_LOCAL unsigned int ProfilerThreadGeneration = 0;
+unsigned int ProfilerClass::m_generation = 0;
+
+// The thread list is only locked when a thread registers and while EndFrame drains the rings.
+static mutex ProfilerLock;
+static vector<ProfilerThreadBuffer*> ProfilerThreads;
+static vector<ProfilerThreadBuffer*> ProfilerFreeThreads;
+static unsigned int ProfilerGenerationCounter = 0;
+static double ProfilerTicksPerMs = 1.0;
+
+static vector<ProfilerZoneType> ProfilerZones;
+static int ProfilerHistoryIndex = 0;
+static int ProfilerHistoryCount = 0;
+static vector<ProfilerEvent> ProfilerFrameEvents;
+static unsigned long ProfilerDropped = 0;
+
+static vector<ProfilerEvent> ProfilerCapture;
+static vector<unsigned long long> ProfilerCaptureFrames;
+static unsigned long long ProfilerCaptureStart = 0;
+static int ProfilerCaptureFramesLeft = 0;
+static bool ProfilerCaptureReady = false;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Measures how many profiler ticks pass in one millisecond. </summary>
+///
+/// <returns> The ticks per millisecond. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static double CalibrateTicks()
+{
+#ifdef PROFILER_USE_RDTSC
+	unsigned long long tscStart, tscEnd;
+	double elapsedMs;
+
+	// Spin against the os clock for a short while and see how far the counter moved.
+#ifdef _WIN32
+	LARGE_INTEGER frequency, start, now;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&start);
+	tscStart = __rdtsc();
+	do
+	{
+		QueryPerformanceCounter(&now);
+		elapsedMs = (double)(now.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+	}
+	while(elapsedMs < PROFILER_CALIBRATION_MS);
+	tscEnd = __rdtsc();
+#else
+	chrono::steady_clock::time_point start;
+
+	start = chrono::steady_clock::now();
+	tscStart = __rdtsc();
+	do
+	{
+		elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+	}
+	while(elapsedMs < PROFILER_CALIBRATION_MS);
+	tscEnd = __rdtsc();
+#endif
+
+	return (double)(tscEnd - tscStart) / elapsedMs;
+#else
+	return (double)chrono::steady_clock::period::den / ((double)chrono::steady_clock::period::num * 1000.0);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the zone with the given name, adding it the first time it is seen. </summary>
+///
+/// <param name="name"> The zone name. </param>
+///
+/// <returns> The zone, or null if the zone table is full. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static ProfilerZoneType* FindZone(const char* name)
+{
+	ProfilerZoneType zone;
+	size_t i;
+
+	// The same literal almost always has the same address, only compare strings when it doesn't.
+	for(i=0; i<ProfilerZones.size(); i++)
+	{
+		if(ProfilerZones[i].name == name)
+		{
+			return &ProfilerZones[i];
+		}
+	}
+
+	for(i=0; i<ProfilerZones.size(); i++)
+	{
+		if(strcmp(ProfilerZones[i].name, name) == 0)
+		{
+			return &ProfilerZones[i];
+		}
+	}
+
+	if(ProfilerZones.size() >= PROFILER_MAX_ZONES)
+	{
+		return 0;
+	}
+
+	memset(&zone, 0, sizeof(ProfilerZoneType));
+	zone.name = name;
+	ProfilerZones.push_back(zone);
+
+	return &ProfilerZones.back();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Adds one event to the totals of its zone. Children always finish before their parent,
+/// 	so the time of finished children is summed per depth and taken off the parent when it
+/// 	arrives, which gives the self time of every zone.
+/// </summary>
+///
+/// <param name="buffer"> The ring the event came from. </param>
+/// <param name="event">  The event. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void AccumulateEvent(ProfilerThreadBuffer* buffer, const ProfilerEvent& event)
+{
+	ProfilerZoneType* zone;
+	unsigned long long duration, children;
+	unsigned int depth;
+
+	depth = event.depth < PROFILER_MAX_DEPTH ? event.depth : PROFILER_MAX_DEPTH - 1;
+	duration = event.end - event.start;
+
+	children = buffer->childTicks[depth + 1];
+	buffer->childTicks[depth + 1] = 0;
+	if(depth > 0)
+	{
+		buffer->childTicks[depth] += duration;
+	}
+
+	zone = FindZone(event.name);
+	if(!zone)
+	{
+		return;
+	}
+
+	zone->frameTicks += duration;
+	zone->frameSelfTicks += duration > children ? duration - children : 0;
+	zone->frameCalls++;
+	zone->totalCalls++;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes a zone name as a json string. </summary>
+///
+/// <param name="fout"> The output stream. </param>
+/// <param name="name"> The name. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void WriteJsonString(ofstream& fout, const char* name)
+{
+	fout << '"';
+	for(; *name; name++)
+	{
+		if(*name == '"' || *name == '\\')
+		{
+			fout << '\\';
+		}
+		fout << *name;
+	}
+	fout << '"';
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts the profiler. Threads register themselves the first time they record. </summary>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProfilerClass::Initialize()
+{
+	if(m_generation)
+	{
+		return true;
+	}
+
+	ProfilerTicksPerMs = CalibrateTicks();
+	if(ProfilerTicksPerMs <= 0.0)
+	{
+		return false;
+	}
+
+	ProfilerZones.reserve(PROFILER_MAX_ZONES);
+	ProfilerHistoryIndex = 0;
+	ProfilerHistoryCount = 0;
+	ProfilerDropped = 0;
+	ProfilerCaptureFramesLeft = 0;
+	ProfilerCaptureReady = false;
+
+	// A new generation makes every thread register again, 0 is kept for "not running".
+	ProfilerGenerationCounter++;
+	if(ProfilerGenerationCounter == 0)
+	{
+		ProfilerGenerationCounter++;
+	}
+
+	lock_guard<mutex> lock(ProfilerLock);
+	m_generation = ProfilerGenerationCounter;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Stops the profiler and releases the rings of every thread. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ProfilerClass::Shutdown()
+{
+	size_t i;
+
+	lock_guard<mutex> lock(ProfilerLock);
+
+	m_generation = 0;
+
+	for(i=0; i<ProfilerThreads.size(); i++)
+	{
+		delete ProfilerThreads[i];
+	}
+
+	vector<ProfilerThreadBuffer*>().swap(ProfilerThreads);
+	vector<ProfilerThreadBuffer*>().swap(ProfilerFreeThreads);
+	vector<ProfilerZoneType>().swap(ProfilerZones);
+	vector<ProfilerEvent>().swap(ProfilerFrameEvents);
+	vector<ProfilerEvent>().swap(ProfilerCapture);
+	vector<unsigned long long>().swap(ProfilerCaptureFrames);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gives the calling thread a ring, the drained one of a thread that ended if there is one,
+/// 	or a new one. Called from GetThreadBuffer the first time a thread records, or when the
+/// 	profiler was restarted since it last did.
+/// </summary>
+///
+/// <returns> The ring, or null if the profiler is not running. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ProfilerThreadBuffer* ProfilerClass::RegisterThread()
+{
+	ProfilerThreadBuffer* buffer;
+	size_t i;
+
+	lock_guard<mutex> lock(ProfilerLock);
+
+	ProfilerThreadGeneration = m_generation;
+	ProfilerThreadData = 0;
+	if(!m_generation)
+	{
+		return 0;
+	}
+
+	// Only a ring EndFrame emptied is taken over, so the new thread gets the whole of it.
+	for(i=0; i<ProfilerFreeThreads.size(); i++)
+	{
+		buffer = ProfilerFreeThreads[i];
+		if(buffer->write.load(memory_order_relaxed) == buffer->read.load(memory_order_acquire))
+		{
+			ProfilerFreeThreads.erase(ProfilerFreeThreads.begin() + i);
+			ProfilerThreadData = buffer;
+			return buffer;
+		}
+	}
+
+	buffer = new ProfilerThreadBuffer;
+	if(!buffer)
+	{
+		return 0;
+	}
+
+	buffer->write.store(0);
+	buffer->read.store(0);
+	buffer->dropped.store(0);
+	buffer->thread = (unsigned int)ProfilerThreads.size();
+	buffer->depth = 0;
+	memset(buffer->childTicks, 0, sizeof(buffer->childTicks));
+
+	ProfilerThreads.push_back(buffer);
+	ProfilerThreadData = buffer;
+
+	return buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Hands the ring of the calling thread back for the next thread that registers. Call it
+/// 	before a thread ends, with no zone open.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ProfilerClass::UnregisterThread()
+{
+	lock_guard<mutex> lock(ProfilerLock);
+
+	if(m_generation && ProfilerThreadGeneration == m_generation && ProfilerThreadData)
+	{
+		ProfilerFreeThreads.push_back(ProfilerThreadData);
+	}
+
+	ProfilerThreadGeneration = 0;
+	ProfilerThreadData = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Ends the profiler frame. Drains the ring of every thread, adds the frame to the zone
+/// 	history and to the capture when one is running. Call it once per frame from the main
+/// 	loop.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ProfilerClass::EndFrame()
+{
+	ProfilerThreadBuffer* buffer;
+	unsigned int read, write;
+	size_t i, count;
+	float ticksToMs;
+
+	if(!m_generation)
+	{
+		return;
+	}
+
+	ProfilerFrameEvents.clear();
+
+	{
+		lock_guard<mutex> lock(ProfilerLock);
+
+		for(i=0; i<ProfilerThreads.size(); i++)
+		{
+			buffer = ProfilerThreads[i];
+
+			write = buffer->write.load(memory_order_acquire);
+			read = buffer->read.load(memory_order_relaxed);
+			for(; read != write; read++)
+			{
+				const ProfilerEvent& event = buffer->events[read & (PROFILER_RING_SIZE - 1)];
+
+				AccumulateEvent(buffer, event);
+				ProfilerFrameEvents.push_back(event);
+			}
+
+			// Hand the slots back to the writer.
+			buffer->read.store(write, memory_order_release);
+
+			ProfilerDropped += buffer->dropped.exchange(0, memory_order_relaxed);
+		}
+	}
+
+	// Move the frame totals into the history.
+	ticksToMs = (float)(1.0 / ProfilerTicksPerMs);
+	for(i=0; i<ProfilerZones.size(); i++)
+	{
+		ProfilerZoneType& zone = ProfilerZones[i];
+
+		zone.history[ProfilerHistoryIndex] = (float)zone.frameTicks * ticksToMs;
+		zone.selfHistory[ProfilerHistoryIndex] = (float)zone.frameSelfTicks * ticksToMs;
+		zone.callHistory[ProfilerHistoryIndex] = zone.frameCalls;
+		zone.frameTicks = 0;
+		zone.frameSelfTicks = 0;
+		zone.frameCalls = 0;
+	}
+
+	ProfilerHistoryIndex = (ProfilerHistoryIndex + 1) % PROFILER_HISTORY;
+	if(ProfilerHistoryCount < PROFILER_HISTORY)
+	{
+		ProfilerHistoryCount++;
+	}
+
+	// Keep the events of the frame while a capture is running.
+	if(ProfilerCaptureFramesLeft > 0)
+	{
+		count = min(ProfilerFrameEvents.size(), PROFILER_MAX_CAPTURE_EVENTS - ProfilerCapture.size());
+		ProfilerCapture.insert(ProfilerCapture.end(), ProfilerFrameEvents.begin(), ProfilerFrameEvents.begin() + count);
+		ProfilerCaptureFrames.push_back(GetTimestamp());
+
+		ProfilerCaptureFramesLeft--;
+		if(ProfilerCaptureFramesLeft == 0)
+		{
+			ProfilerCaptureReady = true;
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts capturing every event of the next frames for a Chrome trace. </summary>
+///
+/// <param name="frames"> The number of frames to capture. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ProfilerClass::BeginCapture(int frames)
+{
+	if(!m_generation || ProfilerCaptureFramesLeft > 0 || frames <= 0)
+	{
+		return;
+	}
+
+	ProfilerCapture.clear();
+	ProfilerCaptureFrames.clear();
+	ProfilerCaptureStart = GetTimestamp();
+	ProfilerCaptureFramesLeft = frames;
+	ProfilerCaptureReady = false;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if a capture is running. </summary>
+///
+/// <returns> true if capturing, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProfilerClass::IsCapturing()
+{
+	return ProfilerCaptureFramesLeft > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if a capture finished and was not written yet. </summary>
+///
+/// <returns> true if a capture is ready, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProfilerClass::IsCaptureReady()
+{
+	return ProfilerCaptureReady;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Writes the captured frames in the Chrome trace event format. Each zone is a complete
+/// 	("X") event on the row of its thread and every frame boundary is a global instant event.
+/// </summary>
+///
+/// <param name="filename"> The file to write. </param>
+///
+/// <returns> true if it succeeds, false if there is nothing captured or the file can't be written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProfilerClass::WriteChromeTrace(const char* filename)
+{
+	ofstream fout;
+	unsigned long long start;
+	size_t i, threads;
+	double ticksToUs;
+
+	if(ProfilerCaptureFrames.empty())
+	{
+		return false;
+	}
+
+	fout.open(filename);
+	if(fout.fail())
+	{
+		return false;
+	}
+
+	{
+		lock_guard<mutex> lock(ProfilerLock);
+		threads = ProfilerThreads.size();
+	}
+
+	ticksToUs = 1000.0 / ProfilerTicksPerMs;
+	fout << fixed << setprecision(3);
+	fout << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	for(i=0; i<threads; i++)
+	{
+		fout << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i;
+		fout << ",\"args\":{\"name\":\"Thread " << i << "\"}},\n";
+	}
+
+	for(i=0; i<ProfilerCapture.size(); i++)
+	{
+		const ProfilerEvent& event = ProfilerCapture[i];
+
+		// Zones that were already open when the capture started are cut at its start.
+		start = event.start > ProfilerCaptureStart ? event.start : ProfilerCaptureStart;
+
+		fout << "{\"name\":";
+		WriteJsonString(fout, event.name);
+		fout << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread;
+		fout << ",\"ts\":" << (double)(start - ProfilerCaptureStart) * ticksToUs;
+		fout << ",\"dur\":" << (double)(event.end > start ? event.end - start : 0) * ticksToUs << "},\n";
+	}
+
+	for(i=0; i<ProfilerCaptureFrames.size(); i++)
+	{
+		fout << "{\"name\":\"Frame " << i << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0";
+		fout << ",\"ts\":" << (double)(ProfilerCaptureFrames[i] - ProfilerCaptureStart) * ticksToUs << "}";
+		fout << (i + 1 < ProfilerCaptureFrames.size() ? ",\n" : "\n");
+	}
+
+	fout << "]}\n";
+	fout.close();
+
+	ProfilerCaptureReady = false;
+
+	return !fout.fail();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes the rolling summary of every zone as a text table, slowest first. </summary>
+///
+/// <param name="filename"> The file to write. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProfilerClass::WriteSummary(const char* filename)
+{
+	vector<ProfilerZoneSummary> summaries;
+	ProfilerZoneSummary summary;
+	ofstream fout;
+	int i, j;
+
+	for(i=0; i<GetZoneCount(); i++)
+	{
+		GetZoneSummary(i, summary);
+		summaries.push_back(summary);
+	}
+
+	// Sort by the average time, slowest zone on top.
+	for(i=1; i<(int)summaries.size(); i++)
+	{
+		summary = summaries[i];
+		for(j=i; j>0 && summaries[j - 1].averageMs < summary.averageMs; j--)
+		{
+			summaries[j] = summaries[j - 1];
+		}
+		summaries[j] = summary;
+	}
+
+	fout.open(filename);
+	if(fout.fail())
+	{
+		return false;
+	}
+
+	fout << "Zone summary over the last " << ProfilerHistoryCount << " frames, times in ms.\n";
+	fout << "Dropped events: " << ProfilerDropped << "\n\n";
+	fout << left << setw(40) << "zone" << right << setw(10) << "last" << setw(10) << "avg" << setw(10) << "min";
+	fout << setw(10) << "max" << setw(10) << "self" << setw(10) << "calls" << "\n";
+	fout << fixed << setprecision(3);
+
+	for(i=0; i<(int)summaries.size(); i++)
+	{
+		fout << left << setw(40) << summaries[i].name << right;
+		fout << setw(10) << summaries[i].lastMs << setw(10) << summaries[i].averageMs;
+		fout << setw(10) << summaries[i].minMs << setw(10) << summaries[i].maxMs;
+		fout << setw(10) << summaries[i].averageSelfMs << setw(10) << summaries[i].callsPerFrame << "\n";
+	}
+
+	fout.close();
+
+	return !fout.fail();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of zones seen so far. </summary>
+///
+/// <returns> The zone count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int ProfilerClass::GetZoneCount()
+{
+	return (int)ProfilerZones.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the rolling summary of a zone. </summary>
+///
+/// <param name="index">   The zone index. </param>
+/// <param name="summary"> [out] The summary. </param>
+///
+/// <returns> true if it succeeds, false if the index is out of range. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ProfilerClass::GetZoneSummary(int index, ProfilerZoneSummary& summary)
+{
+	float total, selfTotal, calls;
+	int i, slot;
+
+	if(index < 0 || index >= (int)ProfilerZones.size())
+	{
+		return false;
+	}
+
+	const ProfilerZoneType& zone = ProfilerZones[index];
+
+	memset(&summary, 0, sizeof(ProfilerZoneSummary));
+	summary.name = zone.name;
+	summary.totalCalls = zone.totalCalls;
+	if(ProfilerHistoryCount == 0)
+	{
+		return true;
+	}
+
+	total = 0.0f;
+	selfTotal = 0.0f;
+	calls = 0.0f;
+	summary.minMs = zone.history[(ProfilerHistoryIndex + PROFILER_HISTORY - 1) % PROFILER_HISTORY];
+	summary.lastMs = summary.minMs;
+
+	for(i=0; i<ProfilerHistoryCount; i++)
+	{
+		slot = (ProfilerHistoryIndex + PROFILER_HISTORY - 1 - i) % PROFILER_HISTORY;
+
+		total += zone.history[slot];
+		selfTotal += zone.selfHistory[slot];
+		calls += (float)zone.callHistory[slot];
+		summary.minMs = min(summary.minMs, zone.history[slot]);
+		summary.maxMs = max(summary.maxMs, zone.history[slot]);
+	}
+
+	summary.averageMs = total / (float)ProfilerHistoryCount;
+	summary.averageSelfMs = selfTotal / (float)ProfilerHistoryCount;
+	summary.callsPerFrame = calls / (float)ProfilerHistoryCount;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets every event drained by the last EndFrame, in per thread order. </summary>
+///
+/// <returns> The events of the last frame. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const vector<ProfilerEvent>& ProfilerClass::GetFrameEvents()
+{
+	return ProfilerFrameEvents;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of events lost because a ring was full. </summary>
+///
+/// <returns> The dropped event count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned long ProfilerClass::GetDroppedEvents()
+{
+	return ProfilerDropped;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Converts profiler ticks to milliseconds. </summary>
+///
+/// <param name="ticks"> The ticks. </param>
+///
+/// <returns> The milliseconds. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double ProfilerClass::TicksToMilliseconds(unsigned long long ticks)
+{
+	return (double)ticks / ProfilerTicksPerMs;
+}
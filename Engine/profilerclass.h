@@ -0,0 +1,254 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	profilerclass.h
+//
+// summary:	Declares the profilerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _PROFILERCLASS_H_
+#define _PROFILERCLASS_H_
+
+// Pre-processing directives.
+// Define PROFILER_ENABLED as 0 in the project settings to compile every zone out of the build.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// The time stamp counter is the cheapest clock there is, use it whenever the cpu has one.
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define PROFILER_USE_RDTSC
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define PROFILER_USE_RDTSC
+#include <x86intrin.h>
+#endif
+
+// System Includes.
+#include <atomic>
+#include <chrono>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "threadlocal.h"
+
+// Globals.
+const unsigned int PROFILER_RING_SIZE = 16384;
+const unsigned int PROFILER_MAX_DEPTH = 32;
+const unsigned int PROFILER_MAX_ZONES = 256;
+const int PROFILER_HISTORY = 120;
+const int PROFILER_CAPTURE_FRAMES = 120;
+const size_t PROFILER_MAX_CAPTURE_EVENTS = 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> One finished zone, as written by the thread that ran it. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct ProfilerEvent
+{
+	const char* name;
+	unsigned long long start;
+	unsigned long long end;
+	unsigned int depth;
+	unsigned int thread;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The event ring of one thread. Only the owning thread writes events and moves the write
+/// 	index, only the profiler moves the read index, so the two never need a lock. When the
+/// 	ring is full new events are dropped and counted instead of overwriting unread ones.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct ProfilerThreadBuffer
+{
+	ProfilerEvent events[PROFILER_RING_SIZE];
+	atomic<unsigned int> write;
+	atomic<unsigned int> read;
+	atomic<unsigned int> dropped;
+	unsigned int thread;
+	unsigned int depth;
+
+	// Reader side only, the time spent in finished children of each open depth.
+	unsigned long long childTicks[PROFILER_MAX_DEPTH + 1];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The rolling summary of one zone over the last PROFILER_HISTORY frames. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct ProfilerZoneSummary
+{
+	const char* name;
+	float lastMs;
+	float averageMs;
+	float minMs;
+	float maxMs;
+	float averageSelfMs;
+	float callsPerFrame;
+	unsigned long long totalCalls;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Hierarchical cpu profiler. Code is measured with scoped zones:
+///
+/// 	PROFILE_FUNCTION();
+/// 	PROFILE_ZONE("Cull");
+///
+/// 	A zone reads the time stamp counter when it is created and again when it goes out of
+/// 	scope, then writes a single event into the ring of its thread. Once per frame EndFrame
+/// 	drains every ring, folds the events into a per zone history and, while a capture is
+/// 	running, keeps them so they can be written as a Chrome trace (chrome://tracing or
+/// 	ui.perfetto.dev). With PROFILER_ENABLED set to 0 the zone macros expand to nothing.
+///
+/// 	Shutdown must only be called once the other threads stopped recording.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class ProfilerClass
+{
+public:
+	static bool Initialize();
+	static void Shutdown();
+	static void EndFrame();
+	static void UnregisterThread();
+
+	static void BeginCapture(int = PROFILER_CAPTURE_FRAMES);
+	static bool IsCapturing();
+	static bool IsCaptureReady();
+	static bool WriteChromeTrace(const char*);
+	static bool WriteSummary(const char*);
+
+	static int GetZoneCount();
+	static bool GetZoneSummary(int, ProfilerZoneSummary&);
+	static const vector<ProfilerEvent>& GetFrameEvents();
+	static unsigned long GetDroppedEvents();
+	static double TicksToMilliseconds(unsigned long long);
+
+	static inline unsigned long long GetTimestamp();
+	static inline ProfilerThreadBuffer* GetThreadBuffer();
+	static inline void Record(ProfilerThreadBuffer*, const char*, unsigned long long, unsigned long long, unsigned int);
+
+private:
+	static ProfilerThreadBuffer* RegisterThread();
+
+private:
+	static unsigned int m_generation;
+};
+
+// Globals.
+// The ring of the calling thread and the profiler generation it was registered with.
+extern THREAD_LOCAL ProfilerThreadBuffer* ProfilerThreadData;
+extern THREAD_LOCAL unsigned int ProfilerThreadGeneration;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads the profiler clock. </summary>
+///
+/// <returns> The current time in profiler ticks. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+inline unsigned long long ProfilerClass::GetTimestamp()
+{
+#ifdef PROFILER_USE_RDTSC
+	return __rdtsc();
+#else
+	return (unsigned long long)chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets the ring of the calling thread, registering the thread the first time it records
+/// 	and again after the profiler was restarted.
+/// </summary>
+///
+/// <returns> The ring, or null if the profiler is not running. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+inline ProfilerThreadBuffer* ProfilerClass::GetThreadBuffer()
+{
+	if(ProfilerThreadGeneration != m_generation)
+	{
+		return RegisterThread();
+	}
+
+	return ProfilerThreadData;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes a finished zone into the ring of the calling thread. </summary>
+///
+/// <param name="buffer"> The ring of the calling thread. </param>
+/// <param name="name">   The zone name, it must outlive the profiler (a string literal). </param>
+/// <param name="start">  The start time in ticks. </param>
+/// <param name="end">    The end time in ticks. </param>
+/// <param name="depth">  The nesting depth of the zone. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+inline void ProfilerClass::Record(ProfilerThreadBuffer* buffer, const char* name, unsigned long long start,
+								  unsigned long long end, unsigned int depth)
+{
+	unsigned int write;
+	ProfilerEvent* event;
+
+	write = buffer->write.load(memory_order_relaxed);
+	if(write - buffer->read.load(memory_order_acquire) >= PROFILER_RING_SIZE)
+	{
+		buffer->dropped.fetch_add(1, memory_order_relaxed);
+		return;
+	}
+
+	event = &buffer->events[write & (PROFILER_RING_SIZE - 1)];
+	event->name = name;
+	event->start = start;
+	event->end = end;
+	event->depth = depth;
+	event->thread = buffer->thread;
+
+	// Publish the event to the reader.
+	buffer->write.store(write + 1, memory_order_release);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> A scoped zone, use the PROFILE_ZONE and PROFILE_FUNCTION macros to create one. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class ProfilerZoneClass
+{
+public:
+	ProfilerZoneClass(const char* name)
+	{
+		m_name = name;
+		m_buffer = ProfilerClass::GetThreadBuffer();
+		m_depth = m_buffer ? m_buffer->depth++ : 0;
+		m_start = ProfilerClass::GetTimestamp();
+	}
+
+	~ProfilerZoneClass()
+	{
+		unsigned long long end;
+
+		end = ProfilerClass::GetTimestamp();
+		if(m_buffer)
+		{
+			m_buffer->depth--;
+			ProfilerClass::Record(m_buffer, m_name, m_start, end, m_depth);
+		}
+	}
+
+private:
+	ProfilerZoneClass(const ProfilerZoneClass&);
+
+private:
+	const char* m_name;
+	ProfilerThreadBuffer* m_buffer;
+	unsigned int m_depth;
+	unsigned long long m_start;
+};
+
+// Pre-processing directives.
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) ProfilerZoneClass PROFILE_CONCAT(profilerZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#endif
+
+#endif
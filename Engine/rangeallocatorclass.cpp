@@ -0,0 +1,236 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	rangeallocatorclass.cpp
+//
+// summary:	Implements the rangeallocatorclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "rangeallocatorclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+RangeAllocatorClass::RangeAllocatorClass()
+{
+	m_capacity = 0;
+	m_used = 0;
+	m_allocationCount = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copy constructor, copies the free list so pages can be kept in containers. </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+RangeAllocatorClass::RangeAllocatorClass(const RangeAllocatorClass& other)
+{
+	m_freeRanges = other.m_freeRanges;
+	m_capacity = other.m_capacity;
+	m_used = other.m_used;
+	m_allocationCount = other.m_allocationCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+RangeAllocatorClass::~RangeAllocatorClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts with the whole space as one free range. </summary>
+///
+/// <param name="capacity"> The number of elements in the space. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RangeAllocatorClass::Initialize(unsigned int capacity)
+{
+	m_capacity = capacity;
+	Reset(0);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Forgets every range. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RangeAllocatorClass::Shutdown()
+{
+	m_freeRanges.clear();
+	m_capacity = 0;
+	m_used = 0;
+	m_allocationCount = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Takes a range from the smallest free range it fits in. </summary>
+///
+/// <param name="count">  The number of elements. </param>
+/// <param name="offset"> [out] The first element of the range. </param>
+///
+/// <returns> true if it succeeds, false if no free range is big enough. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RangeAllocatorClass::Allocate(unsigned int count, unsigned int& offset)
+{
+	unsigned int i;
+	int best;
+
+	if(count == 0)
+	{
+		return false;
+	}
+
+	// Find the best fitting free range, stopping early on an exact fit.
+	best = -1;
+	for(i=0; i<m_freeRanges.size(); i++)
+	{
+		if(m_freeRanges[i].count >= count && (best < 0 || m_freeRanges[i].count < m_freeRanges[best].count))
+		{
+			best = (int)i;
+			if(m_freeRanges[i].count == count)
+			{
+				break;
+			}
+		}
+	}
+
+	if(best < 0)
+	{
+		return false;
+	}
+
+	// Take the front of the free range.
+	offset = m_freeRanges[best].offset;
+	m_freeRanges[best].offset += count;
+	m_freeRanges[best].count -= count;
+	if(m_freeRanges[best].count == 0)
+	{
+		m_freeRanges.erase(m_freeRanges.begin() + best);
+	}
+
+	m_used += count;
+	m_allocationCount++;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives a range back, merging it with the free ranges next to it. </summary>
+///
+/// <param name="offset"> The first element of the range. </param>
+/// <param name="count">  The number of elements. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RangeAllocatorClass::Free(unsigned int offset, unsigned int count)
+{
+	unsigned int low, high, middle;
+	RangeType range;
+	bool mergedPrevious;
+
+	if(count == 0)
+	{
+		return;
+	}
+
+	// Binary search for the first free range after this one.
+	low = 0;
+	high = (unsigned int)m_freeRanges.size();
+	while(low < high)
+	{
+		middle = (low + high) / 2;
+		if(m_freeRanges[middle].offset < offset)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	// Merge with the free range before it.
+	mergedPrevious = false;
+	if(low > 0 && m_freeRanges[low - 1].offset + m_freeRanges[low - 1].count == offset)
+	{
+		m_freeRanges[low - 1].count += count;
+		mergedPrevious = true;
+	}
+
+	// Merge with the free range after it.
+	if(low < m_freeRanges.size() && offset + count == m_freeRanges[low].offset)
+	{
+		if(mergedPrevious)
+		{
+			m_freeRanges[low - 1].count += m_freeRanges[low].count;
+			m_freeRanges.erase(m_freeRanges.begin() + low);
+		}
+		else
+		{
+			m_freeRanges[low].offset = offset;
+			m_freeRanges[low].count += count;
+		}
+	}
+	else if(!mergedPrevious)
+	{
+		range.offset = offset;
+		range.count = count;
+		m_freeRanges.insert(m_freeRanges.begin() + low, range);
+	}
+
+	m_used -= count;
+	m_allocationCount--;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Marks the first elements as used and the rest as one free range. Used after the owner
+/// 	has packed every live range at the start of the space.
+/// </summary>
+///
+/// <param name="used"> The number of elements packed at the start. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RangeAllocatorClass::Reset(unsigned int used)
+{
+	RangeType range;
+
+	m_freeRanges.clear();
+	if(used < m_capacity)
+	{
+		range.offset = used;
+		range.count = m_capacity - used;
+		m_freeRanges.push_back(range);
+	}
+
+	m_used = used;
+	if(used == 0)
+	{
+		m_allocationCount = 0;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the occupancy statistics. </summary>
+///
+/// <param name="stats"> [out] The statistics. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RangeAllocatorClass::GetStats(RangeAllocatorStats& stats)
+{
+	unsigned int i;
+
+	stats.capacity = m_capacity;
+	stats.used = m_used;
+	stats.free = m_capacity - m_used;
+	stats.freeRanges = (unsigned int)m_freeRanges.size();
+	stats.allocationCount = m_allocationCount;
+
+	stats.largestFree = 0;
+	for(i=0; i<m_freeRanges.size(); i++)
+	{
+		if(m_freeRanges[i].count > stats.largestFree)
+		{
+			stats.largestFree = m_freeRanges[i].count;
+		}
+	}
+}
@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	rangeallocatorclass.h
+//
+// summary:	Declares the rangeallocatorclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _RANGEALLOCATORCLASS_H_
+#define _RANGEALLOCATORCLASS_H_
+
+// System Includes.
+#include <vector>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Occupancy of a range allocator, in elements. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct RangeAllocatorStats
+{
+	unsigned int capacity;
+	unsigned int used;
+	unsigned int free;
+	unsigned int largestFree;
+	unsigned int freeRanges;
+	unsigned int allocationCount;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Hands out ranges of elements (vertices, indices) from a fixed size space without owning
+/// 	any memory itself, so it can be used to suballocate a GPU buffer. The free ranges are
+/// 	kept sorted by offset: allocating takes the best fitting one and splits it, freeing puts
+/// 	the range back and merges it with its free neighbours.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class RangeAllocatorClass
+{
+private:
+	struct RangeType
+	{
+		unsigned int offset;
+		unsigned int count;
+	};
+
+public:
+	RangeAllocatorClass();
+	RangeAllocatorClass(const RangeAllocatorClass&);
+	~RangeAllocatorClass();
+
+	void Initialize(unsigned int);
+	void Shutdown();
+
+	bool Allocate(unsigned int, unsigned int&);
+	void Free(unsigned int, unsigned int);
+	void Reset(unsigned int);
+
+	void GetStats(RangeAllocatorStats&);
+
+private:
+	vector<RangeType> m_freeRanges;
+	unsigned int m_capacity;
+	unsigned int m_used;
+	unsigned int m_allocationCount;
+};
+
+#endif
@@ -0,0 +1,320 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	renderstatsclass.cpp
+//
+// summary:	Implements the renderstatsclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "renderstatsclass.h"
+
+// System Includes.
+#include <cstring>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Globals.
+THREAD_LOCAL RenderCounterBlock* RenderStatsThreadBlock = 0;
+
+// A thread that ends hands its block back, the counts it made stay and the next thread adds to them.
+static RenderCounterBlock RenderStatsBlocks[RENDER_STATS_MAX_THREADS];
+static atomic<unsigned int> RenderStatsBlockCount(0);
+static mutex RenderStatsFreeLock;
+static vector<RenderCounterBlock*> RenderStatsFreeBlocks;
+
+static RenderStats RenderStatsFrame;
+static RenderStats RenderStatsTotal;
+
+static RenderStatsShared* RenderStatsSegment = 0;
+#ifdef _WIN32
+static HANDLE RenderStatsMapping = 0;
+#endif
+
+static const char* RenderCounterNames[RENDER_COUNTER_COUNT] =
+{
+	"draw calls",
+	"instances",
+	"primitives",
+	"shader binds",
+	"state binds",
+	"buffer binds",
+	"map calls",
+	"map bytes",
+	"upload bytes",
+	"resource creations"
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Clears the counters and creates the shared memory segment. </summary>
+///
+/// <param name="shared"> true to publish the counters in shared memory. </param>
+///
+/// <returns>
+/// 	true if it succeeds, false if the segment was asked for and couldn't be created. The
+/// 	counters keep working either way.
+/// </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RenderStatsClass::Initialize(bool shared)
+{
+	memset(&RenderStatsFrame, 0, sizeof(RenderStats));
+	memset(&RenderStatsTotal, 0, sizeof(RenderStats));
+
+	if(shared && !RenderStatsSegment)
+	{
+		return CreateSharedSegment();
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the shared memory segment. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderStatsClass::Shutdown()
+{
+	ReleaseSharedSegment();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives the calling thread its counter block, the one of a thread that ended if there is one. </summary>
+///
+/// <returns> The block, or null if every block is taken. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+RenderCounterBlock* RenderStatsClass::RegisterThread()
+{
+	unsigned int slot;
+
+	{
+		lock_guard<mutex> lock(RenderStatsFreeLock);
+		if(!RenderStatsFreeBlocks.empty())
+		{
+			RenderStatsThreadBlock = RenderStatsFreeBlocks.back();
+			RenderStatsFreeBlocks.pop_back();
+			return RenderStatsThreadBlock;
+		}
+	}
+
+	slot = RenderStatsBlockCount.fetch_add(1);
+	if(slot >= RENDER_STATS_MAX_THREADS)
+	{
+		RenderStatsBlockCount.store(RENDER_STATS_MAX_THREADS);
+		return 0;
+	}
+
+	RenderStatsThreadBlock = &RenderStatsBlocks[slot];
+
+	return RenderStatsThreadBlock;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Hands the block of the calling thread back for the next thread that registers. Call it before a thread ends. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderStatsClass::UnregisterThread()
+{
+	if(RenderStatsThreadBlock)
+	{
+		lock_guard<mutex> lock(RenderStatsFreeLock);
+		RenderStatsFreeBlocks.push_back(RenderStatsThreadBlock);
+		RenderStatsThreadBlock = 0;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Ends the counter frame. Whatever every thread counted since the last call becomes the
+/// 	counters of this frame, which are then added to the totals and published.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderStatsClass::EndFrame()
+{
+	unsigned long long value;
+	unsigned int i, count;
+	int j;
+
+	memset(RenderStatsFrame.values, 0, sizeof(RenderStatsFrame.values));
+
+	count = RenderStatsBlockCount.load(memory_order_acquire);
+	if(count > RENDER_STATS_MAX_THREADS)
+	{
+		count = RENDER_STATS_MAX_THREADS;
+	}
+
+	for(i=0; i<count; i++)
+	{
+		RenderCounterBlock& block = RenderStatsBlocks[i];
+
+		for(j=0; j<RENDER_COUNTER_COUNT; j++)
+		{
+			value = block.values[j].load(memory_order_relaxed);
+			RenderStatsFrame.values[j] += value - block.merged[j];
+			block.merged[j] = value;
+		}
+	}
+
+	for(j=0; j<RENDER_COUNTER_COUNT; j++)
+	{
+		RenderStatsTotal.values[j] += RenderStatsFrame.values[j];
+	}
+
+	RenderStatsTotal.frame++;
+	RenderStatsFrame.frame = RenderStatsTotal.frame;
+
+	PublishShared();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the counters of the last finished frame. </summary>
+///
+/// <param name="stats"> [out] The counters. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderStatsClass::GetFrameStats(RenderStats& stats)
+{
+	stats = RenderStatsFrame;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the counters summed over every finished frame. </summary>
+///
+/// <param name="stats"> [out] The counters. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderStatsClass::GetTotalStats(RenderStats& stats)
+{
+	stats = RenderStatsTotal;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the display name of a counter. </summary>
+///
+/// <param name="counter"> The counter. </param>
+///
+/// <returns> The name, or null if the counter is out of range. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const char* RenderStatsClass::GetCounterName(int counter)
+{
+	if(counter < 0 || counter >= RENDER_COUNTER_COUNT)
+	{
+		return 0;
+	}
+
+	return RenderCounterNames[counter];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates and maps the shared memory segment. </summary>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RenderStatsClass::CreateSharedSegment()
+{
+	void* view;
+
+#ifdef _WIN32
+	RenderStatsMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(RenderStatsShared), "Local\\" RENDER_STATS_SEGMENT_NAME);
+	if(!RenderStatsMapping)
+	{
+		return false;
+	}
+
+	view = MapViewOfFile(RenderStatsMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(RenderStatsShared));
+	if(!view)
+	{
+		CloseHandle(RenderStatsMapping);
+		RenderStatsMapping = 0;
+		return false;
+	}
+#else
+	int file;
+
+	file = shm_open("/" RENDER_STATS_SEGMENT_NAME, O_CREAT | O_RDWR, 0644);
+	if(file < 0)
+	{
+		return false;
+	}
+
+	if(ftruncate(file, sizeof(RenderStatsShared)) != 0)
+	{
+		close(file);
+		return false;
+	}
+
+	view = mmap(0, sizeof(RenderStatsShared), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+	if(view == MAP_FAILED)
+	{
+		return false;
+	}
+#endif
+
+	RenderStatsSegment = (RenderStatsShared*)view;
+	memset(RenderStatsSegment, 0, sizeof(RenderStatsShared));
+	RenderStatsSegment->magic = RENDER_STATS_MAGIC;
+	RenderStatsSegment->version = RENDER_STATS_VERSION;
+	RenderStatsSegment->counterCount = RENDER_COUNTER_COUNT;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Unmaps the shared memory segment. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderStatsClass::ReleaseSharedSegment()
+{
+	if(!RenderStatsSegment)
+	{
+		return;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(RenderStatsSegment);
+	CloseHandle(RenderStatsMapping);
+	RenderStatsMapping = 0;
+#else
+	munmap(RenderStatsSegment, sizeof(RenderStatsShared));
+	shm_unlink("/" RENDER_STATS_SEGMENT_NAME);
+#endif
+
+	RenderStatsSegment = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies the frame and total counters into the shared memory segment. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderStatsClass::PublishShared()
+{
+	if(!RenderStatsSegment)
+	{
+		return;
+	}
+
+	// An odd sequence tells readers the values are being changed.
+	RenderStatsSegment->sequence = RenderStatsSegment->sequence + 1;
+	atomic_thread_fence(memory_order_release);
+
+	RenderStatsSegment->frame = RenderStatsFrame.frame;
+	memcpy(RenderStatsSegment->frameValues, RenderStatsFrame.values, sizeof(RenderStatsFrame.values));
+	memcpy(RenderStatsSegment->totalValues, RenderStatsTotal.values, sizeof(RenderStatsTotal.values));
+
+	atomic_thread_fence(memory_order_release);
+	RenderStatsSegment->sequence = RenderStatsSegment->sequence + 1;
+
+	return;
+}
@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	renderstatsclass.h
+//
+// summary:	Declares the renderstatsclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _RENDERSTATSCLASS_H_
+#define _RENDERSTATSCLASS_H_
+
+// System Includes.
+#include <atomic>
+using namespace std;
+
+// Includes.
+#include "threadlocal.h"
+
+// Globals.
+const unsigned int RENDER_STATS_MAX_THREADS = 32;
+const unsigned int RENDER_STATS_MAGIC = 0x53544552;
+const unsigned int RENDER_STATS_VERSION = 1;
+
+// The name of the shared memory segment, "Local\EngineRenderStats" on windows and "/EngineRenderStats" elsewhere.
+#define RENDER_STATS_SEGMENT_NAME "EngineRenderStats"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the render counters. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum RenderCounter
+{
+	RENDER_COUNTER_DRAW_CALLS,
+	RENDER_COUNTER_INSTANCES,
+	RENDER_COUNTER_PRIMITIVES,
+	RENDER_COUNTER_SHADER_BINDS,
+	RENDER_COUNTER_STATE_BINDS,
+	RENDER_COUNTER_BUFFER_BINDS,
+	RENDER_COUNTER_MAP_CALLS,
+	RENDER_COUNTER_MAP_BYTES,
+	RENDER_COUNTER_UPLOAD_BYTES,
+	RENDER_COUNTER_RESOURCE_CREATIONS,
+	RENDER_COUNTER_COUNT
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The counters of one frame, or the totals since startup. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct RenderStats
+{
+	unsigned long long frame;
+	unsigned long long values[RENDER_COUNTER_COUNT];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The layout of the shared memory segment. A reader copies the segment and keeps the copy
+/// 	only if sequence was even and unchanged before and after, the writer makes it odd while
+/// 	it updates the values.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct RenderStatsShared
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int counterCount;
+	volatile unsigned int sequence;
+	unsigned long long frame;
+	unsigned long long frameValues[RENDER_COUNTER_COUNT];
+	unsigned long long totalValues[RENDER_COUNTER_COUNT];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The counters of one thread. Only the owning thread writes them and they only ever grow,
+/// 	so the merge reads them without a lock and works with the difference to the last merge.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct RenderCounterBlock
+{
+	atomic<unsigned long long> values[RENDER_COUNTER_COUNT];
+	unsigned long long merged[RENDER_COUNTER_COUNT];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Counts the work the renderer hands to the gpu. The code issuing the d3d calls adds to
+/// 	the counters of its own thread:
+///
+/// 	RenderStatsClass::Add(RENDER_COUNTER_DRAW_CALLS);
+///
+/// 	D3DClass::EndScene calls EndFrame, which merges every thread into the counters of the
+/// 	frame, adds them to the totals and publishes both to the shared memory segment so an
+/// 	external tool can read them while the engine runs.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class RenderStatsClass
+{
+public:
+	static bool Initialize(bool = true);
+	static void Shutdown();
+	static void EndFrame();
+	static void UnregisterThread();
+
+	static void GetFrameStats(RenderStats&);
+	static void GetTotalStats(RenderStats&);
+	static const char* GetCounterName(int);
+
+	static inline void Add(RenderCounter, unsigned long long = 1);
+
+private:
+	static RenderCounterBlock* RegisterThread();
+	static bool CreateSharedSegment();
+	static void ReleaseSharedSegment();
+	static void PublishShared();
+};
+
+// Globals.
+extern THREAD_LOCAL RenderCounterBlock* RenderStatsThreadBlock;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds to a counter of the calling thread. </summary>
+///
+/// <param name="counter"> The counter. </param>
+/// <param name="amount">  The amount to add. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+inline void RenderStatsClass::Add(RenderCounter counter, unsigned long long amount)
+{
+	RenderCounterBlock* block;
+
+	block = RenderStatsThreadBlock;
+	if(!block)
+	{
+		block = RegisterThread();
+		if(!block)
+		{
+			return;
+		}
+	}
+
+	// Single writer, a plain load and store is enough and avoids a locked add.
+	block->values[counter].store(block->values[counter].load(memory_order_relaxed) + amount, memory_order_relaxed);
+
+	return;
+}
+
+#endif
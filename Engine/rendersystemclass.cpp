@@ -0,0 +1,627 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	rendersystemclass.cpp
+//
+// summary:	Implements the rendersystemclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "rendersystemclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cstring>
+
+// Includes.
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+RenderSystemClass::RenderSystemClass()
+{
+	m_entities = 0;
+	m_geometryPool = 0;
+	m_transform = -1;
+	m_meshRef = -1;
+	m_bounds = -1;
+	m_static = -1;
+	m_occluder = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+RenderSystemClass::RenderSystemClass(const RenderSystemClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+RenderSystemClass::~RenderSystemClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Registers the components the rendering uses. </summary>
+///
+/// <param name="entities">	    The entities. </param>
+/// <param name="geometryPool"> The geometry pool the models are stored in. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RenderSystemClass::Initialize(EntityManagerClass* entities, GeometryPoolClass* geometryPool)
+{
+	m_entities = entities;
+	m_geometryPool = geometryPool;
+
+	m_transform = m_entities->RegisterComponent("Transform", sizeof(TransformComponent));
+	m_meshRef = m_entities->RegisterComponent("MeshRef", sizeof(MeshRefComponent));
+	m_bounds = m_entities->RegisterComponent("Bounds", sizeof(BoundsComponent));
+	m_static = m_entities->RegisterComponent("Static", 0);
+	m_occluder = m_entities->RegisterComponent("Occluder", 0);
+	if(m_transform < 0 || m_meshRef < 0 || m_bounds < 0 || m_static < 0 || m_occluder < 0)
+	{
+		return false;
+	}
+
+	if(!m_bvh.Initialize() || !m_staticBvh.Initialize())
+	{
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the hierarchies and forgets the entities, they belong to the entity manager. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderSystemClass::Shutdown()
+{
+	m_bvh.Shutdown();
+	m_staticBvh.Shutdown();
+	vector<int>().swap(m_visible);
+
+	m_entities = 0;
+	m_geometryPool = 0;
+	m_transform = -1;
+	m_meshRef = -1;
+	m_bounds = -1;
+	m_static = -1;
+	m_occluder = -1;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Creates an entity drawing a model at a scene node, and gives the node the bounds of the
+/// 	model. The entity goes in the bounding volume hierarchy of the entities that move, or in
+/// 	the one of the static entities. The node is dirty
+/// 	afterwards: the components hold its world matrix and bounds as of the last scene update
+/// 	until the next Update after a scene update.
+/// </summary>
+///
+/// <param name="scene">    The scene. </param>
+/// <param name="node">	    The handle of the scene node. </param>
+/// <param name="model">    The model. </param>
+/// <param name="shaderId"> The id of the shader drawing the model. </param>
+/// <param name="isStatic">	  true if the entity never moves and can be merged into the static batch. </param>
+/// <param name="isOccluder"> true if the model is rasterized for the occlusion culling. </param>
+///
+/// <returns> The entity, ENTITY_NONE if it couldn't be created. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+EntityId RenderSystemClass::CreateMesh(SceneClass* scene, int node, ModelClass* model, int shaderId, bool isStatic, bool isOccluder)
+{
+	TransformComponent transform;
+	MeshRefComponent meshRef;
+	BoundsComponent bounds;
+	SceneBounds localBounds;
+	ComponentMask mask;
+	EntityId entity;
+
+	if(GetLocalBounds(model, localBounds))
+	{
+		scene->SetBounds(node, localBounds);
+	}
+
+	mask = EntityManagerClass::GetMask(m_transform) | EntityManagerClass::GetMask(m_meshRef) | EntityManagerClass::GetMask(m_bounds);
+	if(isStatic)
+	{
+		mask |= EntityManagerClass::GetMask(m_static);
+	}
+	if(isOccluder)
+	{
+		mask |= EntityManagerClass::GetMask(m_occluder);
+	}
+
+	entity = m_entities->CreateEntity(mask);
+	if(entity == ENTITY_NONE)
+	{
+		return ENTITY_NONE;
+	}
+
+	transform.node = node;
+	transform.world = scene->GetWorldMatrix(node);
+	meshRef.model = model;
+	meshRef.shaderId = shaderId;
+	bounds.world = scene->GetWorldBounds(node);
+	bounds.proxy = isStatic ? m_staticBvh.Insert(bounds.world, (int)entity) : m_bvh.Insert(bounds.world, (int)entity);
+
+	m_entities->SetComponent(entity, m_transform, &transform);
+	m_entities->SetComponent(entity, m_meshRef, &meshRef);
+	m_entities->SetComponent(entity, m_bounds, &bounds);
+
+	return entity;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Destroys an entity made by CreateMesh, taking it out of its hierarchy. </summary>
+///
+/// <param name="entity"> The entity. </param>
+///
+/// <returns> true if it succeeds, false if the entity was already destroyed. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RenderSystemClass::DestroyMesh(EntityId entity)
+{
+	BoundsComponent* bounds;
+
+	bounds = (BoundsComponent*)m_entities->GetComponent(entity, m_bounds);
+	if(bounds && m_entities->HasComponent(entity, m_static))
+	{
+		m_staticBvh.Remove(bounds->proxy);
+	}
+	else if(bounds)
+	{
+		m_bvh.Remove(bounds->proxy);
+	}
+
+	return m_entities->DestroyEntity(entity);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Copies the world matrix and bounds of every scene node changed by the last scene update
+/// 	into the entities placed by it, and refits the hierarchies to the new bounds. Call it after
+/// 	every scene update.
+/// </summary>
+///
+/// <param name="scene"> The scene. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderSystemClass::Update(SceneClass* scene)
+{
+	BvhClass* bvh;
+	BvhClass* staticBvh;
+	int transform, bounds;
+
+	PROFILE_FUNCTION();
+
+	bvh = &m_bvh;
+	staticBvh = &m_staticBvh;
+	transform = m_transform;
+	bounds = m_bounds;
+
+	m_entities->ForEach(EntityManagerClass::GetMask(transform), 0, [scene, transform](const EntityChunk& chunk)
+	{
+		TransformComponent* transforms;
+		int i;
+
+		transforms = EntityManagerClass::GetArray<TransformComponent>(chunk, transform);
+		for(i=0; i<chunk.count; i++)
+		{
+			if(scene->IsWorldChanged(transforms[i].node))
+			{
+				transforms[i].world = scene->GetWorldMatrix(transforms[i].node);
+			}
+		}
+	});
+
+	function<void(const EntityChunk&, BvhClass*)> updateBounds = [scene, transform, bounds](const EntityChunk& chunk, BvhClass* bvh)
+	{
+		const TransformComponent* transforms;
+		BoundsComponent* worldBounds;
+		int i;
+
+		transforms = EntityManagerClass::GetArray<TransformComponent>(chunk, transform);
+		worldBounds = EntityManagerClass::GetArray<BoundsComponent>(chunk, bounds);
+		for(i=0; i<chunk.count; i++)
+		{
+			if(scene->IsWorldChanged(transforms[i].node))
+			{
+				worldBounds[i].world = scene->GetWorldBounds(transforms[i].node);
+				bvh->Update(worldBounds[i].proxy, worldBounds[i].world);
+			}
+		}
+	};
+
+	// The entities that move, then the static ones, each in their own hierarchy.
+	m_entities->ForEach(EntityManagerClass::GetMask(transform) | EntityManagerClass::GetMask(bounds), EntityManagerClass::GetMask(m_static), [&updateBounds, bvh](const EntityChunk& chunk)
+	{
+		updateBounds(chunk, bvh);
+	});
+	m_entities->ForEach(EntityManagerClass::GetMask(transform) | EntityManagerClass::GetMask(bounds) | EntityManagerClass::GetMask(m_static), 0, [&updateBounds, staticBvh](const EntityChunk& chunk)
+	{
+		updateBounds(chunk, staticBvh);
+	});
+
+	m_bvh.Refit();
+	m_staticBvh.Refit();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gives the nodes of every entity drawing a model the bounds the model has now, and moves
+/// 	the entities to their new bounds in their hierarchy. Call it when the geometry of a model
+/// 	is swapped, since its nodes don't move and Update wouldn't see it.
+/// </summary>
+///
+/// <param name="scene"> The scene. </param>
+/// <param name="model"> The model whose geometry changed. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderSystemClass::RefreshBounds(SceneClass* scene, ModelClass* model)
+{
+	SceneBounds localBounds;
+	BvhClass* bvh;
+	BvhClass* staticBvh;
+	int transform, meshRef, bounds;
+
+	if(!GetLocalBounds(model, localBounds))
+	{
+		return;
+	}
+
+	bvh = &m_bvh;
+	staticBvh = &m_staticBvh;
+	transform = m_transform;
+	meshRef = m_meshRef;
+	bounds = m_bounds;
+
+	function<void(const EntityChunk&, BvhClass*)> refreshBounds = [scene, model, &localBounds, transform, meshRef, bounds](const EntityChunk& chunk, BvhClass* bvh)
+	{
+		const TransformComponent* transforms;
+		const MeshRefComponent* meshRefs;
+		BoundsComponent* worldBounds;
+		int i;
+
+		transforms = EntityManagerClass::GetArray<TransformComponent>(chunk, transform);
+		meshRefs = EntityManagerClass::GetArray<MeshRefComponent>(chunk, meshRef);
+		worldBounds = EntityManagerClass::GetArray<BoundsComponent>(chunk, bounds);
+		for(i=0; i<chunk.count; i++)
+		{
+			if(meshRefs[i].model == model)
+			{
+				scene->SetBounds(transforms[i].node, localBounds);
+				worldBounds[i].world = scene->GetWorldBounds(transforms[i].node);
+				bvh->Update(worldBounds[i].proxy, worldBounds[i].world);
+			}
+		}
+	};
+
+	// The entities that move, then the static ones, each in their own hierarchy.
+	m_entities->ForEach(EntityManagerClass::GetMask(transform) | EntityManagerClass::GetMask(meshRef) | EntityManagerClass::GetMask(bounds), EntityManagerClass::GetMask(m_static), [&refreshBounds, bvh](const EntityChunk& chunk)
+	{
+		refreshBounds(chunk, bvh);
+	});
+	m_entities->ForEach(EntityManagerClass::GetMask(transform) | EntityManagerClass::GetMask(meshRef) | EntityManagerClass::GetMask(bounds) | EntityManagerClass::GetMask(m_static), 0, [&refreshBounds, staticBvh](const EntityChunk& chunk)
+	{
+		refreshBounds(chunk, staticBvh);
+	});
+
+	m_bvh.Refit();
+	m_staticBvh.Refit();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Adds every static entity to a static batch, with the world matrix of its Transform. The
+/// 	batch is built by the caller.
+/// </summary>
+///
+/// <param name="staticBatch"> The static batch, initialized and empty. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RenderSystemClass::BuildStaticBatch(StaticBatchClass* staticBatch)
+{
+	int transform, meshRef;
+	bool result;
+
+	transform = m_transform;
+	meshRef = m_meshRef;
+	result = true;
+
+	m_entities->ForEach(EntityManagerClass::GetMask(transform) | EntityManagerClass::GetMask(meshRef) | EntityManagerClass::GetMask(m_static), 0, [staticBatch, transform, meshRef, &result](const EntityChunk& chunk)
+	{
+		const TransformComponent* transforms;
+		const MeshRefComponent* meshRefs;
+		int i;
+
+		transforms = EntityManagerClass::GetArray<TransformComponent>(chunk, transform);
+		meshRefs = EntityManagerClass::GetArray<MeshRefComponent>(chunk, meshRef);
+		for(i=0; i<chunk.count; i++)
+		{
+			result = staticBatch->AddInstance(meshRefs[i].model, D3DXMATRIX(transforms[i].world.m), meshRefs[i].shaderId) && result;
+		}
+	});
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Rasterizes every entity tagged Occluder into the occlusion culler, with the world matrix
+/// 	of its Transform. The frame of the culler is begun and finished by the caller.
+/// </summary>
+///
+/// <param name="occlusion"> The occlusion culler. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void RenderSystemClass::RenderOccluders(OcclusionCullerClass* occlusion)
+{
+	int transform, meshRef;
+
+	PROFILE_FUNCTION();
+
+	transform = m_transform;
+	meshRef = m_meshRef;
+
+	m_entities->ForEach(EntityManagerClass::GetMask(transform) | EntityManagerClass::GetMask(meshRef) | EntityManagerClass::GetMask(m_occluder), 0, [occlusion, transform, meshRef](const EntityChunk& chunk)
+	{
+		const TransformComponent* transforms;
+		const MeshRefComponent* meshRefs;
+		ModelClass* model;
+		int i;
+
+		transforms = EntityManagerClass::GetArray<TransformComponent>(chunk, transform);
+		meshRefs = EntityManagerClass::GetArray<MeshRefComponent>(chunk, meshRef);
+		for(i=0; i<chunk.count; i++)
+		{
+			model = meshRefs[i].model;
+			if(model->GetPositions() && model->GetIndices())
+			{
+				occlusion->RenderOccluder(model->GetPositions(), model->GetVertexStride(), model->GetVertexCount(), model->GetIndices(), model->GetIndexCount(), transforms[i].world.m);
+			}
+		}
+	});
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Finds what has to be drawn this frame. The draws and the culling lists live in the frame
+/// 	allocator, so they are gone once the next frame begins.
+/// </summary>
+///
+/// <param name="frustum">		  The frustum of the frame, already constructed. </param>
+/// <param name="occlusion">	  The occlusion culler with the occluders of the frame, or 0 to skip the occlusion culling. </param>
+/// <param name="staticBatch">	  The static batch. </param>
+/// <param name="frameAllocator"> The frame allocator. </param>
+/// <param name="draws">		  [out] The draws, sorted by shader, texture and geometry page. </param>
+///
+/// <returns> The number of draws, -1 if the frame allocator ran out. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int RenderSystemClass::Submit(FrustumClass* frustum, OcclusionCullerClass* occlusion, StaticBatchClass* staticBatch, LinearAllocatorClass* frameAllocator,
+							  RenderDraw*& draws)
+{
+	D3DXPLANE frustumPlanes[BVH_FRUSTUM_PLANES];
+	SceneVector planes[BVH_FRUSTUM_PLANES];
+	const TransformComponent* transform;
+	const MeshRefComponent* meshRef;
+	const BoundsComponent* bounds;
+	SceneBounds* visibleBounds;
+	unsigned char* unoccluded;
+	RenderDraw draw;
+	int visibleCount, staticDraws, drawCount, i;
+
+	PROFILE_FUNCTION();
+
+	draws = 0;
+
+	// The entities that move are culled through the hierarchy and drawn one by one.
+	frustum->GetPlanes(frustumPlanes);
+	for(i=0; i<BVH_FRUSTUM_PLANES; i++)
+	{
+		planes[i].x = frustumPlanes[i].a;
+		planes[i].y = frustumPlanes[i].b;
+		planes[i].z = frustumPlanes[i].c;
+		planes[i].w = frustumPlanes[i].d;
+	}
+
+	visibleCount = m_bvh.QueryFrustum(planes, m_visible);
+	staticDraws = staticBatch->Cull(frustum, occlusion);
+
+	// Every visible entity makes at most one draw, the static batch says how many it makes.
+	draws = (RenderDraw*)frameAllocator->Allocate((visibleCount + staticDraws) * sizeof(RenderDraw));
+	unoccluded = (unsigned char*)frameAllocator->Allocate(visibleCount);
+	if((visibleCount + staticDraws > 0 && !draws) || (visibleCount > 0 && !unoccluded))
+	{
+		return -1;
+	}
+
+	// Then the ones in the frustum are tested against the occluders, on the workers when there are many.
+	memset(unoccluded, 1, visibleCount);
+	if(occlusion && visibleCount > 0)
+	{
+		visibleBounds = (SceneBounds*)frameAllocator->Allocate(visibleCount * sizeof(SceneBounds));
+		if(!visibleBounds)
+		{
+			return -1;
+		}
+
+		for(i=0; i<visibleCount; i++)
+		{
+			bounds = (const BoundsComponent*)m_entities->GetComponent((EntityId)m_visible[i], m_bounds);
+			if(bounds)
+			{
+				visibleBounds[i] = bounds->world;
+			}
+			else
+			{
+				memset(&visibleBounds[i], 0, sizeof(SceneBounds));
+			}
+		}
+
+		occlusion->TestBoxes(visibleBounds, visibleCount, unoccluded);
+	}
+
+	drawCount = 0;
+	for(i=0; i<visibleCount; i++)
+	{
+		if(!unoccluded[i])
+		{
+			continue;
+		}
+
+		transform = (const TransformComponent*)m_entities->GetComponent((EntityId)m_visible[i], m_transform);
+		meshRef = (const MeshRefComponent*)m_entities->GetComponent((EntityId)m_visible[i], m_meshRef);
+		if(!transform || !meshRef || !m_geometryPool->GetDraw(meshRef->model->GetGeometryHandle(), draw.geometry))
+		{
+			continue;
+		}
+
+		draw.shaderId = meshRef->shaderId;
+		draw.texture = meshRef->model->GetTexture();
+		draw.world = D3DXMATRIX(transform->world.m);
+		draws[drawCount++] = draw;
+	}
+
+	// The static ones were merged into the batch, already in world space, and the chunks next to each other into single draws.
+	D3DXMatrixIdentity(&draw.world);
+	for(i=0; i<staticDraws; i++)
+	{
+		if(staticBatch->GetVisibleDraw(i, draw.geometry, draw.shaderId, draw.texture))
+		{
+			draws[drawCount++] = draw;
+		}
+	}
+
+	sort(draws, draws + drawCount, CompareDraws);
+
+	return drawCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the id of the Transform component. </summary>
+///
+/// <returns> The component id. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int RenderSystemClass::GetTransformComponent()
+{
+	return m_transform;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the id of the MeshRef component. </summary>
+///
+/// <returns> The component id. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int RenderSystemClass::GetMeshRefComponent()
+{
+	return m_meshRef;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the id of the Bounds component. </summary>
+///
+/// <returns> The component id. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int RenderSystemClass::GetBoundsComponent()
+{
+	return m_bounds;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the id of the Static tag. </summary>
+///
+/// <returns> The component id. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int RenderSystemClass::GetStaticComponent()
+{
+	return m_static;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the id of the Occluder tag. </summary>
+///
+/// <returns> The component id. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int RenderSystemClass::GetOccluderComponent()
+{
+	return m_occluder;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the hierarchy over the entities that move, their ids are the entities. </summary>
+///
+/// <returns> The hierarchy. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+BvhClass* RenderSystemClass::GetBvh()
+{
+	return &m_bvh;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the hierarchy over the static entities, their ids are the entities. </summary>
+///
+/// <returns> The hierarchy. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+BvhClass* RenderSystemClass::GetStaticBvh()
+{
+	return &m_staticBvh;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the bounds of a model, in its own space. </summary>
+///
+/// <param name="model">  The model. </param>
+/// <param name="bounds"> [out] The bounds. </param>
+///
+/// <returns> true if it succeeds, false if the model has no geometry. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RenderSystemClass::GetLocalBounds(ModelClass* model, SceneBounds& bounds)
+{
+	D3DXVECTOR3 minimum, maximum;
+
+	if(!model->GetBounds(minimum, maximum))
+	{
+		return false;
+	}
+
+	bounds.center.x = (minimum.x + maximum.x) * 0.5f;
+	bounds.center.y = (minimum.y + maximum.y) * 0.5f;
+	bounds.center.z = (minimum.z + maximum.z) * 0.5f;
+	bounds.center.w = 0.0f;
+	bounds.extents.x = (maximum.x - minimum.x) * 0.5f;
+	bounds.extents.y = (maximum.y - minimum.y) * 0.5f;
+	bounds.extents.z = (maximum.z - minimum.z) * 0.5f;
+	bounds.extents.w = 0.0f;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Orders the draws by shader, then by texture, then by geometry page. </summary>
+///
+/// <param name="first">  The first draw. </param>
+/// <param name="second"> The second draw. </param>
+///
+/// <returns> true if the first goes before the second. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool RenderSystemClass::CompareDraws(const RenderDraw& first, const RenderDraw& second)
+{
+	if(first.shaderId != second.shaderId)
+	{
+		return first.shaderId < second.shaderId;
+	}
+
+	if(first.texture != second.texture)
+	{
+		return first.texture < second.texture;
+	}
+
+	return first.geometry.page < second.geometry.page;
+}
@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	rendersystemclass.h
+//
+// summary:	Declares the rendersystemclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _RENDERSYSTEMCLASS_H_
+#define _RENDERSYSTEMCLASS_H_
+
+// DirectX Includes.
+#include <d3dx10math.h>
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "entitymanagerclass.h"
+#include "sceneclass.h"
+#include "modelclass.h"
+#include "geometrypoolclass.h"
+#include "frustumclass.h"
+#include "staticbatchclass.h"
+#include "bvhclass.h"
+#include "occlusioncullerclass.h"
+#include "linearallocatorclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Where an entity is: its scene node and a copy of the world matrix of the node. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TransformComponent
+{
+	int node;
+	SceneMatrix world;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> What an entity draws: a model and the id of the shader that draws it. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct MeshRefComponent
+{
+	ModelClass* model;
+	int shaderId;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The box around an entity in world space, a copy of the bounds of its node, and the handle
+/// 	of the entity in its bounding volume hierarchy: the one of the entities that move, or the
+/// 	one of the static entities.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct BoundsComponent
+{
+	SceneBounds world;
+	int proxy;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> A draw the renderer has to make: the geometry, the shader, the texture and the world matrix. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct RenderDraw
+{
+	GeometryDraw geometry;
+	int shaderId;
+	TextureClass* texture;
+	D3DXMATRIX world;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The systems that turn the entities into draws. Update copies the world matrices and bounds
+/// 	of the scene nodes that moved into the Transform and Bounds components, and refits the
+/// 	bounding volume hierarchy over the Bounds of the entities that move. Submit culls that
+/// 	hierarchy against the frustum, so whole groups of entities outside it are skipped with one
+/// 	test, drops the entities hidden behind the occluders, and emits a draw for each one left,
+/// 	then adds the visible chunks of the static batch, and sorts the draws by shader, texture
+/// 	and geometry page so the state changes as little as it can.
+///
+/// 	The entities tagged Occluder, static or not, are the ones RenderOccluders rasterizes into
+/// 	the occlusion culler before Submit; they should be big and simple, like walls and
+/// 	buildings.
+///
+/// 	The entities tagged Static aren't drawn one by one: BuildStaticBatch merges them into the
+/// 	static batch, which Submit draws. They have a hierarchy of their own, which only the scene
+/// 	queries go through.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class RenderSystemClass
+{
+public:
+	RenderSystemClass();
+	RenderSystemClass(const RenderSystemClass&);
+	~RenderSystemClass();
+
+	bool Initialize(EntityManagerClass*, GeometryPoolClass*);
+	void Shutdown();
+
+	EntityId CreateMesh(SceneClass*, int, ModelClass*, int, bool, bool);
+	bool DestroyMesh(EntityId);
+	void Update(SceneClass*);
+	void RefreshBounds(SceneClass*, ModelClass*);
+	bool BuildStaticBatch(StaticBatchClass*);
+	void RenderOccluders(OcclusionCullerClass*);
+	int Submit(FrustumClass*, OcclusionCullerClass*, StaticBatchClass*, LinearAllocatorClass*, RenderDraw*&);
+
+	int GetTransformComponent();
+	int GetMeshRefComponent();
+	int GetBoundsComponent();
+	int GetStaticComponent();
+	int GetOccluderComponent();
+	BvhClass* GetBvh();
+	BvhClass* GetStaticBvh();
+
+private:
+	static bool GetLocalBounds(ModelClass*, SceneBounds&);
+	static bool CompareDraws(const RenderDraw&, const RenderDraw&);
+
+private:
+	EntityManagerClass* m_entities;
+	GeometryPoolClass* m_geometryPool;
+	int m_transform;
+	int m_meshRef;
+	int m_bounds;
+	int m_static;
+	int m_occluder;
+	BvhClass m_bvh;
+	BvhClass m_staticBvh;
+	vector<int> m_visible;
+};
+
+#endif
@@ -0,0 +1,591 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	residencymanagerclass.cpp
+//
+// summary:	Implements the residencymanagerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "residencymanagerclass.h"
+
+// System Includes.
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A resource with no device behind it, for the test: it only remembers whether it is
+/// 	resident and counts what the manager asked of it. Restore fails while failRestore is set.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class FakeResourceClass : public StreamableResourceClass
+{
+public:
+	FakeResourceClass() : resident(true), failRestore(false), evictions(0), restores(0) {}
+
+	void Evict(int)
+	{
+		resident = false;
+		evictions++;
+	}
+
+	bool Restore(int)
+	{
+		if(failRestore)
+		{
+			return false;
+		}
+
+		resident = true;
+		restores++;
+		return true;
+	}
+
+	bool resident;
+	bool failRestore;
+	int evictions;
+	int restores;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ResidencyManagerClass::ResidencyManagerClass()
+{
+	m_lruHead = -1;
+	m_lruTail = -1;
+	m_frame = 0;
+	memset(&m_stats, 0, sizeof(ResidencyStats));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ResidencyManagerClass::ResidencyManagerClass(const ResidencyManagerClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ResidencyManagerClass::~ResidencyManagerClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts tracking with an empty resource table. </summary>
+///
+/// <param name="budget"> The number of bytes the resident resources may use. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ResidencyManagerClass::Initialize(unsigned long long budget)
+{
+	m_entries.clear();
+	m_freeHandles.clear();
+	m_lruHead = -1;
+	m_lruTail = -1;
+	m_frame = 0;
+
+	memset(&m_stats, 0, sizeof(ResidencyStats));
+	m_stats.budget = budget;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Forgets every resource. The resources themselves belong to their owners and are
+/// 	released by them.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ResidencyManagerClass::Shutdown()
+{
+	m_entries.clear();
+	m_freeHandles.clear();
+	m_lruHead = -1;
+	m_lruTail = -1;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Starts tracking a resource that was just created, so it starts resident and counts as
+/// 	used this frame.
+/// </summary>
+///
+/// <param name="category">   The kind of resource. </param>
+/// <param name="size">		  The size of the resource in bytes. </param>
+/// <param name="streamable"> The owner that can evict and restore it, or null if the resource
+/// 						  must stay resident. </param>
+///
+/// <returns> The handle of the resource, or -1 if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int ResidencyManagerClass::Register(ResourceCategory category, unsigned long long size, StreamableResourceClass* streamable)
+{
+	ResourceEntry entry;
+	int handle;
+
+	if(category < 0 || category >= RESOURCE_CATEGORY_COUNT)
+	{
+		return -1;
+	}
+
+	entry.size = size;
+	entry.category = category;
+	entry.streamable = streamable;
+	entry.lastUsedFrame = m_frame;
+	entry.registered = true;
+	entry.resident = true;
+	entry.previous = -1;
+	entry.next = -1;
+
+	// Reuse a released handle before growing the table.
+	if(!m_freeHandles.empty())
+	{
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+		m_entries[handle] = entry;
+	}
+	else
+	{
+		handle = (int)m_entries.size();
+		m_entries.push_back(entry);
+	}
+
+	// Count it as resident.
+	m_stats.residentBytes += size;
+	m_stats.categories[category].residentBytes += size;
+	m_stats.categories[category].residentCount++;
+	if(m_stats.residentBytes > m_stats.peakResidentBytes)
+	{
+		m_stats.peakResidentBytes = m_stats.residentBytes;
+	}
+
+	// Only the streamable resources can be picked for eviction.
+	if(streamable)
+	{
+		LinkFront(handle);
+	}
+
+	return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Stops tracking a resource, called by the owner when it releases it. </summary>
+///
+/// <param name="handle"> The handle returned by Register. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ResidencyManagerClass::Unregister(int handle)
+{
+	ResourceEntry* entry;
+
+	if(handle < 0 || handle >= (int)m_entries.size() || !m_entries[handle].registered)
+	{
+		return;
+	}
+
+	entry = &m_entries[handle];
+	if(entry->resident)
+	{
+		m_stats.residentBytes -= entry->size;
+		m_stats.categories[entry->category].residentBytes -= entry->size;
+		m_stats.categories[entry->category].residentCount--;
+
+		if(entry->streamable)
+		{
+			Unlink(handle);
+		}
+	}
+	else
+	{
+		m_stats.categories[entry->category].evictedBytes -= entry->size;
+		m_stats.categories[entry->category].evictedCount--;
+	}
+
+	entry->registered = false;
+	entry->streamable = 0;
+	m_freeHandles.push_back(handle);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Marks a resource as used by the current frame. If it had been evicted it is restored
+/// 	first, and then other resources are evicted if that took the total over the budget.
+/// </summary>
+///
+/// <param name="handle"> The handle returned by Register. </param>
+///
+/// <returns> true if the resource is resident and can be used, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ResidencyManagerClass::Touch(int handle)
+{
+	ResourceEntry* entry;
+	bool result;
+
+	if(handle < 0 || handle >= (int)m_entries.size() || !m_entries[handle].registered)
+	{
+		return false;
+	}
+
+	entry = &m_entries[handle];
+	entry->lastUsedFrame = m_frame;
+
+	// Resources that can't be streamed are always resident.
+	if(!entry->streamable)
+	{
+		return true;
+	}
+
+	if(entry->resident)
+	{
+		// Move it to the most recently used end.
+		Unlink(handle);
+		LinkFront(handle);
+		return true;
+	}
+
+	// Bring it back on demand and make room for it.
+	result = MakeResident(handle);
+	if(!result)
+	{
+		return false;
+	}
+
+	EnforceBudget();
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks if a resource currently has its GPU memory. </summary>
+///
+/// <param name="handle"> The handle returned by Register. </param>
+///
+/// <returns> true if resident, false if evicted or unknown. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ResidencyManagerClass::IsResident(int handle)
+{
+	if(handle < 0 || handle >= (int)m_entries.size() || !m_entries[handle].registered)
+	{
+		return false;
+	}
+
+	return m_entries[handle].resident;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Starts a new frame. Resources used in the previous frame become candidates for eviction
+/// 	again, and the budget is enforced.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ResidencyManagerClass::BeginFrame()
+{
+	m_frame++;
+
+	EnforceBudget();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Evicts the least recently used streamable resources until the resident total fits the
+/// 	budget. It stops at the first resource used in the current frame, since every resource
+/// 	in front of it in the list was used this frame too.
+/// </summary>
+///
+/// <returns> true if the resident total fits the budget, false if it couldn't be met. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ResidencyManagerClass::EnforceBudget()
+{
+	int handle;
+
+	while(m_stats.residentBytes > m_stats.budget)
+	{
+		handle = m_lruTail;
+		if(handle < 0 || m_entries[handle].lastUsedFrame == m_frame)
+		{
+			return false;
+		}
+
+		Evict(handle);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Changes the budget, evicting right away if it went down. </summary>
+///
+/// <param name="budget"> The number of bytes the resident resources may use. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ResidencyManagerClass::SetBudget(unsigned long long budget)
+{
+	m_stats.budget = budget;
+
+	EnforceBudget();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the budget. </summary>
+///
+/// <returns> The number of bytes the resident resources may use. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned long long ResidencyManagerClass::GetBudget()
+{
+	return m_stats.budget;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the memory statistics, in total and per category. </summary>
+///
+/// <param name="stats"> [out] The statistics. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ResidencyManagerClass::GetStats(ResidencyStats& stats)
+{
+	stats = m_stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Checks the eviction and the restores with fake resources, for "-residencytest". A budget
+/// 	of RESIDENCY_TEST_BUDGET resources is held with RESIDENCY_TEST_RESOURCES streamable ones
+/// 	and one that must stay resident: the least recently used are evicted, a touch brings one
+/// 	back, the resources used in the current frame are never evicted, a failed restore leaves
+/// 	the resource evicted, and after every step the owners and the counters must agree.
+/// </summary>
+///
+/// <param name="test"> [out] The number of checks, those that failed and the final counters. </param>
+///
+/// <returns> true if every check passed, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ResidencyManagerClass::Test(ResidencyTest& test)
+{
+	ResidencyManagerClass manager;
+	FakeResourceClass resources[RESIDENCY_TEST_RESOURCES];
+	int handles[RESIDENCY_TEST_RESOURCES];
+	unsigned long long residentBytes;
+	int i, fixed, resident, step;
+	bool result;
+
+	memset(&test, 0, sizeof(ResidencyTest));
+	test.resources = RESIDENCY_TEST_RESOURCES;
+
+	manager.Initialize(RESIDENCY_TEST_SIZE * RESIDENCY_TEST_BUDGET);
+
+	// Registered oldest first, so resource 0 is the least recently used.
+	fixed = manager.Register(RESOURCE_VERTEX_BUFFER, RESIDENCY_TEST_SIZE, NULL);
+	for(i=0; i<RESIDENCY_TEST_RESOURCES; i++)
+	{
+		handles[i] = manager.Register(RESOURCE_TEXTURE, RESIDENCY_TEST_SIZE, &resources[i]);
+	}
+
+	for(step=0; step<6; step++)
+	{
+		switch(step)
+		{
+			// Over the budget: the oldest are evicted until the fixed resource and the newest fit.
+			case 0:
+				manager.BeginFrame();
+				result = !resources[0].resident && !resources[RESIDENCY_TEST_BUDGET].resident && resources[RESIDENCY_TEST_BUDGET + 1].resident;
+				break;
+
+			// Touching an evicted resource restores it, and the least recently used one makes room.
+			case 1:
+				result = manager.Touch(handles[0]) && resources[0].resident && resources[0].restores == 1 && !resources[RESIDENCY_TEST_BUDGET + 1].resident;
+				break;
+
+			// Every resource used in one frame: none can be evicted, the budget can't be met.
+			case 2:
+				manager.BeginFrame();
+				result = true;
+				for(i=0; i<RESIDENCY_TEST_RESOURCES; i++)
+				{
+					result = manager.Touch(handles[i]) && resources[i].resident && result;
+				}
+				result = !manager.EnforceBudget() && result;
+				break;
+
+			// The next frame evicts those used first back down to the budget.
+			case 3:
+				manager.BeginFrame();
+				result = manager.EnforceBudget() && !resources[0].resident && resources[RESIDENCY_TEST_RESOURCES - 1].resident;
+				break;
+
+			// A restore that fails leaves the resource evicted.
+			case 4:
+				resources[0].failRestore = true;
+				result = !manager.Touch(handles[0]) && !resources[0].resident && !manager.IsResident(handles[0]);
+				resources[0].failRestore = false;
+				break;
+
+			// A restore that works again.
+			default:
+				result = manager.Touch(handles[0]) && resources[0].resident;
+				break;
+		}
+
+		// The owners and the counters must agree.
+		residentBytes = RESIDENCY_TEST_SIZE;
+		resident = 0;
+		for(i=0; i<RESIDENCY_TEST_RESOURCES; i++)
+		{
+			result = result && resources[i].resident == manager.IsResident(handles[i]);
+			residentBytes += resources[i].resident ? RESIDENCY_TEST_SIZE : 0;
+			resident += resources[i].resident ? 1 : 0;
+		}
+		result = result && manager.IsResident(fixed) && residentBytes == manager.m_stats.residentBytes;
+		result = result && (unsigned long)resident == manager.m_stats.categories[RESOURCE_TEXTURE].residentCount;
+		result = result && (unsigned long)(RESIDENCY_TEST_RESOURCES - resident) == manager.m_stats.categories[RESOURCE_TEXTURE].evictedCount;
+
+		test.checks++;
+		test.failures += result ? 0 : 1;
+	}
+
+	manager.GetStats(test.stats);
+
+	// Letting go of everything, resident or not, must leave nothing counted.
+	manager.Unregister(fixed);
+	for(i=0; i<RESIDENCY_TEST_RESOURCES; i++)
+	{
+		manager.Unregister(handles[i]);
+	}
+	result = manager.m_stats.residentBytes == 0 && manager.m_stats.categories[RESOURCE_TEXTURE].evictedBytes == 0 && manager.m_lruHead < 0 && manager.m_lruTail < 0;
+	test.checks++;
+	test.failures += result ? 0 : 1;
+
+	manager.Shutdown();
+
+	return test.failures == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Asks the owner to create an evicted resource again. </summary>
+///
+/// <param name="handle"> The handle. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ResidencyManagerClass::MakeResident(int handle)
+{
+	ResourceEntry* entry;
+	bool result;
+
+	entry = &m_entries[handle];
+
+	result = entry->streamable->Restore(handle);
+	if(!result)
+	{
+		m_stats.failedRestores++;
+		return false;
+	}
+
+	// The owner may have grown the table by registering something from Restore.
+	entry = &m_entries[handle];
+	entry->resident = true;
+
+	m_stats.restores++;
+	m_stats.residentBytes += entry->size;
+	m_stats.categories[entry->category].residentBytes += entry->size;
+	m_stats.categories[entry->category].residentCount++;
+	m_stats.categories[entry->category].evictedBytes -= entry->size;
+	m_stats.categories[entry->category].evictedCount--;
+	if(m_stats.residentBytes > m_stats.peakResidentBytes)
+	{
+		m_stats.peakResidentBytes = m_stats.residentBytes;
+	}
+
+	LinkFront(handle);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Asks the owner to release a resident resource. </summary>
+///
+/// <param name="handle"> The handle. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ResidencyManagerClass::Evict(int handle)
+{
+	ResourceEntry* entry;
+
+	Unlink(handle);
+
+	entry = &m_entries[handle];
+	entry->resident = false;
+
+	m_stats.evictions++;
+	m_stats.residentBytes -= entry->size;
+	m_stats.categories[entry->category].residentBytes -= entry->size;
+	m_stats.categories[entry->category].residentCount--;
+	m_stats.categories[entry->category].evictedBytes += entry->size;
+	m_stats.categories[entry->category].evictedCount++;
+
+	entry->streamable->Evict(handle);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Puts a resource at the most recently used end of the list. </summary>
+///
+/// <param name="handle"> The handle. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ResidencyManagerClass::LinkFront(int handle)
+{
+	m_entries[handle].previous = -1;
+	m_entries[handle].next = m_lruHead;
+
+	if(m_lruHead >= 0)
+	{
+		m_entries[m_lruHead].previous = handle;
+	}
+	m_lruHead = handle;
+
+	if(m_lruTail < 0)
+	{
+		m_lruTail = handle;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Takes a resource out of the list. </summary>
+///
+/// <param name="handle"> The handle. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ResidencyManagerClass::Unlink(int handle)
+{
+	ResourceEntry* entry;
+
+	entry = &m_entries[handle];
+
+	if(entry->previous >= 0)
+	{
+		m_entries[entry->previous].next = entry->next;
+	}
+	else
+	{
+		m_lruHead = entry->next;
+	}
+
+	if(entry->next >= 0)
+	{
+		m_entries[entry->next].previous = entry->previous;
+	}
+	else
+	{
+		m_lruTail = entry->previous;
+	}
+
+	entry->previous = -1;
+	entry->next = -1;
+
+	return;
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	residencymanagerclass.h
+//
+// summary:	Declares the residencymanagerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _RESIDENCYMANAGERCLASS_H_
+#define _RESIDENCYMANAGERCLASS_H_
+
+// System Includes.
+#include <vector>
+
+// Includes.
+#include "streamableresourceclass.h"
+
+using namespace std;
+
+// Globals.
+const int RESIDENCY_TEST_RESOURCES = 8;
+const unsigned long long RESIDENCY_TEST_SIZE = 1024 * 1024;
+const int RESIDENCY_TEST_BUDGET = 4;
+
+enum ResourceCategory
+{
+	RESOURCE_VERTEX_BUFFER,
+	RESOURCE_INDEX_BUFFER,
+	RESOURCE_CONSTANT_BUFFER,
+	RESOURCE_TEXTURE,
+	RESOURCE_CATEGORY_COUNT
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Memory counters of one resource category. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct ResidencyCategoryStats
+{
+	unsigned long long residentBytes;
+	unsigned long long evictedBytes;
+	unsigned long residentCount;
+	unsigned long evictedCount;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Memory counters of the whole residency manager. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct ResidencyStats
+{
+	unsigned long long budget;
+	unsigned long long residentBytes;
+	unsigned long long peakResidentBytes;
+	unsigned long evictions;
+	unsigned long restores;
+	unsigned long failedRestores;
+	ResidencyCategoryStats categories[RESOURCE_CATEGORY_COUNT];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> What the residency test checked, and the counters it ended with. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct ResidencyTest
+{
+	int resources;
+	int checks;
+	int failures;
+	ResidencyStats stats;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Keeps count of the video memory used by every buffer and texture the engine creates and
+/// 	holds it under a budget. Every registered resource is tracked by size and category, and
+/// 	the streamable ones are also kept in a least recently used list. Touch moves a resource
+/// 	to the front of that list (restoring it first if it had been evicted), and EnforceBudget
+/// 	evicts from the back until the resident total fits the budget again. Resources touched
+/// 	during the current frame are never evicted, since the GPU may still be using them.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class ResidencyManagerClass
+{
+private:
+	struct ResourceEntry
+	{
+		unsigned long long size;
+		ResourceCategory category;
+		StreamableResourceClass* streamable;
+		unsigned long lastUsedFrame;
+		bool registered;
+		bool resident;
+		int previous;
+		int next;
+	};
+
+public:
+	ResidencyManagerClass();
+	ResidencyManagerClass(const ResidencyManagerClass&);
+	~ResidencyManagerClass();
+
+	bool Initialize(unsigned long long);
+	void Shutdown();
+
+	int Register(ResourceCategory, unsigned long long, StreamableResourceClass*);
+	void Unregister(int);
+	bool Touch(int);
+	bool IsResident(int);
+
+	void BeginFrame();
+	bool EnforceBudget();
+
+	void SetBudget(unsigned long long);
+	unsigned long long GetBudget();
+	void GetStats(ResidencyStats&);
+
+	static bool Test(ResidencyTest&);
+
+private:
+	bool MakeResident(int);
+	void Evict(int);
+	void LinkFront(int);
+	void Unlink(int);
+
+private:
+	vector<ResourceEntry> m_entries;
+	vector<int> m_freeHandles;
+	int m_lruHead;
+	int m_lruTail;
+	unsigned long m_frame;
+	ResidencyStats m_stats;
+};
+
+#endif
@@ -0,0 +1,813 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	sceneclass.cpp
+//
+// summary:	Implements the sceneclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "sceneclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#ifdef SCENE_SIMD
+#include <xmmintrin.h>
+#endif
+
+// Includes.
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Moves every value of an array to its new index. </summary>
+///
+/// <param name="values">  [in,out] The array. </param>
+/// <param name="indices"> The new index of every value. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+template<class T> static void PermuteArray(vector<T>& values, const vector<int>& indices)
+{
+	vector<T> sorted(values.size());
+	unsigned int i;
+
+	for(i=0; i<values.size(); i++)
+	{
+		sorted[indices[i]] = values[i];
+	}
+	values.swap(sorted);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Builds the local matrix of a node, scale then rotation then translation. </summary>
+///
+/// <param name="position"> The position. </param>
+/// <param name="rotation"> The rotation quaternion. </param>
+/// <param name="scale">	The scale. </param>
+/// <param name="matrix">   [out] The matrix. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void ComposeMatrix(const SceneVector& position, const SceneVector& rotation, const SceneVector& scale, float* matrix)
+{
+	float xx, yy, zz, xy, xz, yz, wx, wy, wz;
+
+	xx = rotation.x * rotation.x * 2.0f;
+	yy = rotation.y * rotation.y * 2.0f;
+	zz = rotation.z * rotation.z * 2.0f;
+	xy = rotation.x * rotation.y * 2.0f;
+	xz = rotation.x * rotation.z * 2.0f;
+	yz = rotation.y * rotation.z * 2.0f;
+	wx = rotation.w * rotation.x * 2.0f;
+	wy = rotation.w * rotation.y * 2.0f;
+	wz = rotation.w * rotation.z * 2.0f;
+
+	matrix[0] = (1.0f - yy - zz) * scale.x;
+	matrix[1] = (xy + wz) * scale.x;
+	matrix[2] = (xz - wy) * scale.x;
+	matrix[3] = 0.0f;
+
+	matrix[4] = (xy - wz) * scale.y;
+	matrix[5] = (1.0f - xx - zz) * scale.y;
+	matrix[6] = (yz + wx) * scale.y;
+	matrix[7] = 0.0f;
+
+	matrix[8] = (xz + wy) * scale.z;
+	matrix[9] = (yz - wx) * scale.z;
+	matrix[10] = (1.0f - xx - yy) * scale.z;
+	matrix[11] = 0.0f;
+
+	matrix[12] = position.x;
+	matrix[13] = position.y;
+	matrix[14] = position.z;
+	matrix[15] = 1.0f;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Multiplies two matrices, a row of the result is a row of a times b. </summary>
+///
+/// <param name="a">	  The first matrix. </param>
+/// <param name="b">	  The second matrix. </param>
+/// <param name="result"> [out] The product, must not be a or b. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void MultiplyMatrix(const float* a, const float* b, float* result)
+{
+#ifdef SCENE_SIMD
+	__m128 row0, row1, row2, row3;
+	int i;
+
+	row0 = _mm_loadu_ps(b);
+	row1 = _mm_loadu_ps(b + 4);
+	row2 = _mm_loadu_ps(b + 8);
+	row3 = _mm_loadu_ps(b + 12);
+
+	for(i=0; i<16; i+=4)
+	{
+		_mm_storeu_ps(result + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[i]), row0), _mm_mul_ps(_mm_set1_ps(a[i + 1]), row1)),
+											 _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[i + 2]), row2), _mm_mul_ps(_mm_set1_ps(a[i + 3]), row3))));
+	}
+#else
+	int i, j;
+
+	for(i=0; i<16; i+=4)
+	{
+		for(j=0; j<4; j++)
+		{
+			result[i + j] = a[i] * b[j] + a[i + 1] * b[4 + j] + a[i + 2] * b[8 + j] + a[i + 3] * b[12 + j];
+		}
+	}
+#endif
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Transforms a box, the center goes through the matrix and the extents through its absolute
+/// 	value, which gives the box around the transformed box.
+/// </summary>
+///
+/// <param name="bounds"> The box. </param>
+/// <param name="matrix"> The matrix. </param>
+/// <param name="result"> [out] The transformed box. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void TransformBounds(const SceneBounds& bounds, const float* matrix, SceneBounds& result)
+{
+#ifdef SCENE_SIMD
+	__m128 row0, row1, row2, sign;
+
+	row0 = _mm_loadu_ps(matrix);
+	row1 = _mm_loadu_ps(matrix + 4);
+	row2 = _mm_loadu_ps(matrix + 8);
+
+	_mm_storeu_ps(&result.center.x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(bounds.center.x), row0), _mm_mul_ps(_mm_set1_ps(bounds.center.y), row1)),
+											   _mm_add_ps(_mm_mul_ps(_mm_set1_ps(bounds.center.z), row2), _mm_loadu_ps(matrix + 12))));
+
+	sign = _mm_set1_ps(-0.0f);
+	_mm_storeu_ps(&result.extents.x, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(bounds.extents.x), _mm_andnot_ps(sign, row0)), _mm_mul_ps(_mm_set1_ps(bounds.extents.y), _mm_andnot_ps(sign, row1))),
+												_mm_mul_ps(_mm_set1_ps(bounds.extents.z), _mm_andnot_ps(sign, row2))));
+#else
+	const float* center;
+	const float* extents;
+	float* resultCenter;
+	float* resultExtents;
+	int i;
+
+	center = &bounds.center.x;
+	extents = &bounds.extents.x;
+	resultCenter = &result.center.x;
+	resultExtents = &result.extents.x;
+
+	for(i=0; i<4; i++)
+	{
+		resultCenter[i] = center[0] * matrix[i] + center[1] * matrix[4 + i] + center[2] * matrix[8 + i] + matrix[12 + i];
+		resultExtents[i] = extents[0] * fabsf(matrix[i]) + extents[1] * fabsf(matrix[4 + i]) + extents[2] * fabsf(matrix[8 + i]);
+	}
+#endif
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The random numbers of the benchmark, the same on every machine. </summary>
+///
+/// <param name="seed"> [in,out] The state. </param>
+///
+/// <returns> A number from 0 to 1. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float NextRandom(unsigned int& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+
+	return (float)(seed >> 8) / 16777216.0f;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneClass::SceneClass()
+{
+	m_update = 0;
+	m_sorted = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneClass::SceneClass(const SceneClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneClass::~SceneClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empties the scene and makes room for the nodes to come. </summary>
+///
+/// <param name="capacity"> The number of nodes to reserve. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneClass::Initialize(int capacity)
+{
+	Shutdown();
+
+	if(capacity > 0)
+	{
+		m_positions.reserve(capacity);
+		m_rotations.reserve(capacity);
+		m_scales.reserve(capacity);
+		m_parents.reserve(capacity);
+		m_depths.reserve(capacity);
+		m_worldMatrices.reserve(capacity);
+		m_localBounds.reserve(capacity);
+		m_worldBounds.reserve(capacity);
+		m_dirty.reserve(capacity);
+		m_changedUpdate.reserve(capacity);
+		m_handleIndices.reserve(capacity);
+		m_indexHandles.reserve(capacity);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the arrays. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneClass::Shutdown()
+{
+	vector<SceneVector>().swap(m_positions);
+	vector<SceneVector>().swap(m_rotations);
+	vector<SceneVector>().swap(m_scales);
+	vector<int>().swap(m_parents);
+	vector<int>().swap(m_depths);
+	vector<SceneMatrix>().swap(m_worldMatrices);
+	vector<SceneBounds>().swap(m_localBounds);
+	vector<SceneBounds>().swap(m_worldBounds);
+	vector<unsigned char>().swap(m_dirty);
+	vector<unsigned int>().swap(m_changedUpdate);
+	vector<int>().swap(m_handleIndices);
+	vector<int>().swap(m_indexHandles);
+	m_levelStarts.clear();
+	m_levelDirty.clear();
+	m_update = 0;
+	m_sorted = true;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a node at the origin, unrotated and unscaled, with empty bounds. </summary>
+///
+/// <param name="parent"> The handle of the parent, -1 for a root. </param>
+///
+/// <returns> The handle of the node, -1 if the parent doesn't exist. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int SceneClass::AddNode(int parent)
+{
+	SceneVector zero = { 0.0f, 0.0f, 0.0f, 0.0f };
+	SceneVector identity = { 0.0f, 0.0f, 0.0f, 1.0f };
+	SceneVector one = { 1.0f, 1.0f, 1.0f, 0.0f };
+	SceneMatrix matrix;
+	SceneBounds bounds;
+	int index, handle, depth;
+
+	if(parent >= (int)m_handleIndices.size())
+	{
+		return -1;
+	}
+
+	depth = parent < 0 ? 0 : m_depths[m_handleIndices[parent]] + 1;
+
+	index = (int)m_positions.size();
+	handle = (int)m_handleIndices.size();
+
+	memset(&matrix, 0, sizeof(SceneMatrix));
+	matrix.m[0] = matrix.m[5] = matrix.m[10] = matrix.m[15] = 1.0f;
+	bounds.center = zero;
+	bounds.extents = zero;
+
+	m_positions.push_back(zero);
+	m_rotations.push_back(identity);
+	m_scales.push_back(one);
+	m_parents.push_back(parent < 0 ? -1 : m_handleIndices[parent]);
+	m_depths.push_back(depth);
+	m_worldMatrices.push_back(matrix);
+	m_localBounds.push_back(bounds);
+	m_worldBounds.push_back(bounds);
+	m_dirty.push_back(0);
+	m_changedUpdate.push_back(0);
+	m_handleIndices.push_back(index);
+	m_indexHandles.push_back(handle);
+
+	// The node goes at the end, which is only in order if nothing deeper was added before it.
+	if(depth >= (int)m_levelDirty.size())
+	{
+		m_levelDirty.resize(depth + 1, 0);
+	}
+	if(index > 0 && m_depths[index - 1] > depth)
+	{
+		m_sorted = false;
+	}
+	m_levelStarts.clear();
+
+	MarkDirty(index);
+
+	return handle;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets the position of a node relative to its parent. </summary>
+///
+/// <param name="node"> The handle of the node. </param>
+/// <param name="x">	The x coordinate. </param>
+/// <param name="y">	The y coordinate. </param>
+/// <param name="z">	The z coordinate. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneClass::SetPosition(int node, float x, float y, float z)
+{
+	SceneVector& position = m_positions[m_handleIndices[node]];
+
+	position.x = x;
+	position.y = y;
+	position.z = z;
+	MarkDirty(m_handleIndices[node]);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets the rotation of a node relative to its parent. </summary>
+///
+/// <param name="node"> The handle of the node. </param>
+/// <param name="x">	The x of the unit quaternion. </param>
+/// <param name="y">	The y of the unit quaternion. </param>
+/// <param name="z">	The z of the unit quaternion. </param>
+/// <param name="w">	The w of the unit quaternion. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneClass::SetRotation(int node, float x, float y, float z, float w)
+{
+	SceneVector& rotation = m_rotations[m_handleIndices[node]];
+
+	rotation.x = x;
+	rotation.y = y;
+	rotation.z = z;
+	rotation.w = w;
+	MarkDirty(m_handleIndices[node]);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets the scale of a node relative to its parent. </summary>
+///
+/// <param name="node"> The handle of the node. </param>
+/// <param name="x">	The scale along x. </param>
+/// <param name="y">	The scale along y. </param>
+/// <param name="z">	The scale along z. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneClass::SetScale(int node, float x, float y, float z)
+{
+	SceneVector& scale = m_scales[m_handleIndices[node]];
+
+	scale.x = x;
+	scale.y = y;
+	scale.z = z;
+	MarkDirty(m_handleIndices[node]);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Sets the bounds of a node in its own space. The world bounds follow right away through the
+/// 	world matrix of the last update, so a node that doesn't move can be queried without one.
+/// </summary>
+///
+/// <param name="node">   The handle of the node. </param>
+/// <param name="bounds"> The bounds. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneClass::SetBounds(int node, const SceneBounds& bounds)
+{
+	int index;
+
+	index = m_handleIndices[node];
+	m_localBounds[index] = bounds;
+	TransformBounds(m_localBounds[index], m_worldMatrices[index].m, m_worldBounds[index]);
+	MarkDirty(index);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Computes the world matrices and bounds of the dirty nodes and of everything below them,
+/// 	one level of the hierarchy after the other. A big scene splits each level into chunks
+/// 	that run on the workers, a level starting once the one above is done.
+/// </summary>
+///
+/// <param name="workers"> The number of workers, -1 for one per core, 0 to do it all here. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneClass::Update(int workers)
+{
+	vector<unsigned char> levelChanged, chunkChanged;
+	vector<int> chunkTasks;
+	int level, levels, first, last, chunk, firstChunk, endLevel, previousEndLevel;
+	unsigned int i;
+	bool changed;
+
+	PROFILE_FUNCTION();
+
+	if(!m_sorted || m_levelStarts.empty())
+	{
+		Sort();
+	}
+
+	// Nodes changed in this update are told apart by the number of the update, so nothing has to be cleared.
+	m_update++;
+	levels = (int)m_levelStarts.size() - 1;
+
+	// A small scene isn't worth the threads.
+	if(workers == 0 || (int)m_positions.size() < SCENE_PARALLEL_NODES)
+	{
+		changed = false;
+		for(level=0; level<levels; level++)
+		{
+			if(m_levelDirty[level] == 0 && !changed)
+			{
+				continue;
+			}
+
+			changed = UpdateRange(m_levelStarts[level], m_levelStarts[level + 1]);
+			m_levelDirty[level] = 0;
+		}
+
+		return true;
+	}
+
+	TaskGraphClass tasks;
+
+	// Every level is a set of chunks followed by a task that collects whether any of them changed a node.
+	levelChanged.assign(levels, 0);
+	chunkChanged.assign(m_positions.size() / SCENE_UPDATE_CHUNK + levels, 0);
+	chunk = 0;
+	previousEndLevel = -1;
+	for(level=0; level<levels; level++)
+	{
+		chunkTasks.clear();
+		firstChunk = chunk;
+		for(first=m_levelStarts[level]; first<m_levelStarts[level + 1]; first+=SCENE_UPDATE_CHUNK)
+		{
+			last = min(first + SCENE_UPDATE_CHUNK, m_levelStarts[level + 1]);
+			chunkTasks.push_back(tasks.AddTask("SceneClass::UpdateChunk", [this, &levelChanged, &chunkChanged, level, first, last, chunk]() -> bool
+			{
+				if(m_levelDirty[level] != 0 || (level > 0 && levelChanged[level - 1]))
+				{
+					chunkChanged[chunk] = UpdateRange(first, last) ? 1 : 0;
+				}
+				return true;
+			}));
+			chunk++;
+		}
+
+		endLevel = tasks.AddTask("SceneClass::EndLevel", [this, &levelChanged, &chunkChanged, level, firstChunk, chunk]() -> bool
+		{
+			int i;
+
+			for(i=firstChunk; i<chunk; i++)
+			{
+				levelChanged[level] |= chunkChanged[i];
+			}
+			m_levelDirty[level] = 0;
+			return true;
+		});
+
+		for(i=0; i<chunkTasks.size(); i++)
+		{
+			tasks.AddDependency(endLevel, chunkTasks[i]);
+			if(previousEndLevel >= 0)
+			{
+				tasks.AddDependency(chunkTasks[i], previousEndLevel);
+			}
+		}
+		previousEndLevel = endLevel;
+	}
+
+	return tasks.Run(workers);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the world matrix of a node, as of the last update. </summary>
+///
+/// <param name="node"> The handle of the node. </param>
+///
+/// <returns> The world matrix. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const SceneMatrix& SceneClass::GetWorldMatrix(int node)
+{
+	return m_worldMatrices[m_handleIndices[node]];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the bounds of a node in world space, as of the last update. </summary>
+///
+/// <param name="node"> The handle of the node. </param>
+///
+/// <returns> The world bounds. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const SceneBounds& SceneClass::GetWorldBounds(int node)
+{
+	return m_worldBounds[m_handleIndices[node]];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if the last update moved a node. </summary>
+///
+/// <param name="node"> The handle of the node. </param>
+///
+/// <returns> true if its world matrix was computed again, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneClass::IsWorldChanged(int node)
+{
+	return m_changedUpdate[m_handleIndices[node]] == m_update;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of nodes. </summary>
+///
+/// <returns> The node count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int SceneClass::GetNodeCount()
+{
+	return (int)m_positions.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the depth of the deepest node plus one. </summary>
+///
+/// <returns> The level count. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int SceneClass::GetLevelCount()
+{
+	return (int)m_levelDirty.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the scene on a made up forest of the given size: about one root every 64 nodes and
+/// 	every other node hanging off a random earlier one, which makes a tree as deep as the log
+/// 	of its size. The nodes are added in that order, so the first update has to sort them.
+/// </summary>
+///
+/// <param name="nodes">  The number of nodes. </param>
+/// <param name="result"> [out] The times. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneClass::Benchmark(int nodes, SceneBenchmark& result)
+{
+	SceneClass scene;
+	SceneBounds bounds;
+	unsigned long long start;
+	unsigned int seed;
+	float angle;
+	int i, node, moved;
+	bool updated;
+
+	memset(&result, 0, sizeof(SceneBenchmark));
+	if(nodes <= 0)
+	{
+		return false;
+	}
+
+	scene.Initialize(nodes);
+
+	seed = 12345;
+	for(i=0; i<nodes; i++)
+	{
+		node = scene.AddNode(i % 64 == 0 ? -1 : (int)(NextRandom(seed) * i));
+		angle = NextRandom(seed) * 3.1415926f;
+		scene.SetPosition(node, NextRandom(seed) * 10.0f, NextRandom(seed) * 10.0f, NextRandom(seed) * 10.0f);
+		scene.SetRotation(node, 0.0f, sinf(angle), 0.0f, cosf(angle));
+
+		bounds.center.x = bounds.center.y = bounds.center.z = bounds.center.w = 0.0f;
+		bounds.extents.x = bounds.extents.y = bounds.extents.z = 1.0f;
+		bounds.extents.w = 0.0f;
+		scene.SetBounds(node, bounds);
+	}
+
+	result.nodes = nodes;
+	result.levels = scene.GetLevelCount();
+
+	start = ProfilerClass::GetTimestamp();
+	scene.Sort();
+	result.sortMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+	// Every node is dirty after adding them.
+	start = ProfilerClass::GetTimestamp();
+	updated = scene.Update(0);
+	result.serialMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+	for(i=0; i<nodes; i++)
+	{
+		scene.MarkDirty(i);
+	}
+
+	start = ProfilerClass::GetTimestamp();
+	updated = scene.Update() && updated;
+	result.parallelMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+	// Turn a share of the nodes, the ones below them follow.
+	for(i=0; i<(int)(nodes * SCENE_BENCHMARK_DIRTY); i++)
+	{
+		angle = NextRandom(seed) * 3.1415926f;
+		scene.SetRotation((int)(NextRandom(seed) * nodes), 0.0f, sinf(angle), 0.0f, cosf(angle));
+	}
+
+	start = ProfilerClass::GetTimestamp();
+	updated = scene.Update() && updated;
+	result.partialMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+	moved = 0;
+	for(i=0; i<nodes; i++)
+	{
+		moved += scene.IsWorldChanged(i) ? 1 : 0;
+	}
+	result.partialNodes = moved;
+
+	start = ProfilerClass::GetTimestamp();
+	updated = scene.Update() && updated;
+	result.cleanMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+	scene.Shutdown();
+
+	return updated;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Marks a node for the next update. </summary>
+///
+/// <param name="index"> The index of the node. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneClass::MarkDirty(int index)
+{
+	if(!m_dirty[index])
+	{
+		m_dirty[index] = 1;
+		m_levelDirty[m_depths[index]]++;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Sorts the arrays by depth and finds where every level starts. Within a level the nodes are
+/// 	grouped by parent, in the order of the parents, so the update reads the level above in
+/// 	order and the siblings sit together.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneClass::Sort()
+{
+	vector<int> order, indices, next, counts;
+	unsigned int i;
+	int level, levels, first, count, node, j;
+
+	PROFILE_FUNCTION();
+
+	// Count the nodes of every level, then turn the counts into the start of every level.
+	levels = (int)m_levelDirty.size();
+	m_levelStarts.assign(levels + 1, 0);
+	for(i=0; i<m_depths.size(); i++)
+	{
+		m_levelStarts[m_depths[i] + 1]++;
+	}
+	for(level=0; level<levels; level++)
+	{
+		m_levelStarts[level + 1] += m_levelStarts[level];
+	}
+
+	if(m_sorted)
+	{
+		return;
+	}
+
+	// Put the nodes in the order of their depth.
+	next.assign(m_levelStarts.begin(), m_levelStarts.end() - 1);
+	order.resize(m_depths.size());
+	for(i=0; i<m_depths.size(); i++)
+	{
+		order[next[m_depths[i]]++] = i;
+	}
+
+	// The roots keep their order, then every level is counting sorted by the new index of the parents.
+	indices.resize(m_depths.size());
+	for(j=m_levelStarts[0]; j<m_levelStarts[1]; j++)
+	{
+		indices[order[j]] = j;
+	}
+
+	for(level=1; level<levels; level++)
+	{
+		first = m_levelStarts[level - 1];
+		count = m_levelStarts[level] - first;
+
+		counts.assign(count + 1, 0);
+		for(j=m_levelStarts[level]; j<m_levelStarts[level + 1]; j++)
+		{
+			counts[indices[m_parents[order[j]]] - first + 1]++;
+		}
+		for(j=0; j<count; j++)
+		{
+			counts[j + 1] += counts[j];
+		}
+
+		for(j=m_levelStarts[level]; j<m_levelStarts[level + 1]; j++)
+		{
+			node = order[j];
+			indices[node] = m_levelStarts[level] + counts[indices[m_parents[node]] - first]++;
+		}
+	}
+
+	// The parents point at the new indices.
+	for(i=0; i<m_parents.size(); i++)
+	{
+		if(m_parents[i] >= 0)
+		{
+			m_parents[i] = indices[m_parents[i]];
+		}
+	}
+
+	PermuteArray(m_positions, indices);
+	PermuteArray(m_rotations, indices);
+	PermuteArray(m_scales, indices);
+	PermuteArray(m_parents, indices);
+	PermuteArray(m_depths, indices);
+	PermuteArray(m_worldMatrices, indices);
+	PermuteArray(m_localBounds, indices);
+	PermuteArray(m_worldBounds, indices);
+	PermuteArray(m_dirty, indices);
+	PermuteArray(m_changedUpdate, indices);
+	PermuteArray(m_indexHandles, indices);
+
+	for(i=0; i<m_indexHandles.size(); i++)
+	{
+		m_handleIndices[m_indexHandles[i]] = i;
+	}
+
+	m_sorted = true;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Computes the world matrix and bounds of the nodes of a range that are dirty or whose
+/// 	parent changed in this update. The parents are in a level that is already done.
+/// </summary>
+///
+/// <param name="first"> The index of the first node. </param>
+/// <param name="last">  The index past the last node. </param>
+///
+/// <returns> true if a node changed. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneClass::UpdateRange(int first, int last)
+{
+	SceneMatrix local;
+	int i, parent;
+	bool changed;
+
+	changed = false;
+	for(i=first; i<last; i++)
+	{
+		parent = m_parents[i];
+		if(!m_dirty[i] && (parent < 0 || m_changedUpdate[parent] != m_update))
+		{
+			continue;
+		}
+
+		if(parent < 0)
+		{
+			ComposeMatrix(m_positions[i], m_rotations[i], m_scales[i], m_worldMatrices[i].m);
+		}
+		else
+		{
+			ComposeMatrix(m_positions[i], m_rotations[i], m_scales[i], local.m);
+			MultiplyMatrix(local.m, m_worldMatrices[parent].m, m_worldMatrices[i].m);
+		}
+		TransformBounds(m_localBounds[i], m_worldMatrices[i].m, m_worldBounds[i]);
+
+		m_dirty[i] = 0;
+		m_changedUpdate[i] = m_update;
+		changed = true;
+	}
+
+	return changed;
+}
@@ -0,0 +1,137 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	sceneclass.h
+//
+// summary:	Declares the sceneclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _SCENECLASS_H_
+#define _SCENECLASS_H_
+
+// Pre-processing directives.
+// The world matrices are computed with SSE where the compiler has it, with plain floats elsewhere.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#define SCENE_SIMD
+#endif
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Globals.
+const int SCENE_UPDATE_CHUNK = 8192;
+const int SCENE_PARALLEL_NODES = 32768;
+const int SCENE_BENCHMARK_SMALL = 100000;
+const int SCENE_BENCHMARK_LARGE = 1000000;
+const float SCENE_BENCHMARK_DIRTY = 0.01f;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> A position, a scale (w unused) or a rotation quaternion. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct SceneVector
+{
+	float x;
+	float y;
+	float z;
+	float w;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> A row major matrix for row vectors, laid out like a D3DXMATRIX. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct SceneMatrix
+{
+	float m[16];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> An axis aligned box as a center and half extents (w unused). </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct SceneBounds
+{
+	SceneVector center;
+	SceneVector extents;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	What one benchmark measured, in ms: sorting the nodes parents first, computing every
+/// 	world matrix on one thread and on the workers, updating after a share of the subtrees
+/// 	moved, and updating with nothing moved.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct SceneBenchmark
+{
+	int nodes;
+	int levels;
+	double sortMs;
+	double serialMs;
+	double parallelMs;
+	double partialMs;
+	double cleanMs;
+	int partialNodes;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The transforms of the scene, kept as a structure of arrays: the local position, rotation
+/// 	and scale, the parent, the world matrix and the local and world bounds of a node each live
+/// 	in their own array, so a pass only pulls the arrays it reads into the cache.
+///
+/// 	The arrays are sorted by depth, so every parent comes before its children and a level of
+/// 	the hierarchy is one contiguous range. Nodes are added with AddNode, which returns a handle
+/// 	that stays valid when the arrays are sorted again. Setting a local transform marks the
+/// 	node dirty, and Update computes the world matrices one level after the other: a node is
+/// 	recomputed only if it is dirty or its parent changed in this update, and a level with
+/// 	neither is skipped whole. Big scenes split every level into chunks run on the workers.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class SceneClass
+{
+public:
+	SceneClass();
+	SceneClass(const SceneClass&);
+	~SceneClass();
+
+	bool Initialize(int = 0);
+	void Shutdown();
+
+	int AddNode(int = -1);
+	void SetPosition(int, float, float, float);
+	void SetRotation(int, float, float, float, float);
+	void SetScale(int, float, float, float);
+	void SetBounds(int, const SceneBounds&);
+
+	bool Update(int = -1);
+
+	const SceneMatrix& GetWorldMatrix(int);
+	const SceneBounds& GetWorldBounds(int);
+	bool IsWorldChanged(int);
+	int GetNodeCount();
+	int GetLevelCount();
+
+	static bool Benchmark(int, SceneBenchmark&);
+
+private:
+	void MarkDirty(int);
+	void Sort();
+	bool UpdateRange(int, int);
+
+private:
+	vector<SceneVector> m_positions;
+	vector<SceneVector> m_rotations;
+	vector<SceneVector> m_scales;
+	vector<int> m_parents;
+	vector<int> m_depths;
+	vector<SceneMatrix> m_worldMatrices;
+	vector<SceneBounds> m_localBounds;
+	vector<SceneBounds> m_worldBounds;
+	vector<unsigned char> m_dirty;
+	vector<unsigned int> m_changedUpdate;
+	vector<int> m_handleIndices;
+	vector<int> m_indexHandles;
+	vector<int> m_levelStarts;
+	vector<int> m_levelDirty;
+	unsigned int m_update;
+	bool m_sorted;
+};
+
+#endif
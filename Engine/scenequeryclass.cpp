@@ -0,0 +1,362 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	scenequeryclass.cpp
+//
+// summary:	Implements the scenequeryclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "scenequeryclass.h"
+
+// System Includes.
+#include <algorithm>
+
+// Includes.
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Orders the entities a ray goes through by where it enters their box. </summary>
+///
+/// <param name="first">  The first entity. </param>
+/// <param name="second"> The second entity. </param>
+///
+/// <returns> true if the first is nearer. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool CompareCandidates(const BvhRayHit& first, const BvhRayHit& second)
+{
+	return first.distance < second.distance;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneQueryClass::SceneQueryClass()
+{
+	m_entities = 0;
+	m_renderSystem = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneQueryClass::SceneQueryClass(const SceneQueryClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SceneQueryClass::~SceneQueryClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Keeps the entities and the render system whose hierarchies the rays go down. </summary>
+///
+/// <param name="entities">		The entities. </param>
+/// <param name="renderSystem"> The render system, initialized. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneQueryClass::Initialize(EntityManagerClass* entities, RenderSystemClass* renderSystem)
+{
+	m_entities = entities;
+	m_renderSystem = renderSystem;
+	if(!m_entities || !m_renderSystem)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Forgets the entities and the render system, they belong to the caller. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneQueryClass::Shutdown()
+{
+	vector<BvhRayHit>().swap(m_candidates);
+	vector<BvhRayHit>().swap(m_staticCandidates);
+
+	m_entities = 0;
+	m_renderSystem = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Makes the ray through a point of the screen, from the near plane to the far one. The point
+/// 	is taken back through the viewport, then through the inverse of the view and projection
+/// 	matrices, at the depth of both planes.
+/// </summary>
+///
+/// <param name="screenX">  The x of the point, in pixels from the left. </param>
+/// <param name="screenY">  The y of the point, in pixels from the top. </param>
+/// <param name="direct3D"> The device, for the viewport and the projection. </param>
+/// <param name="camera">	The camera, rendered this frame. </param>
+/// <param name="ray">		[out] The ray, with a direction of length 1. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SceneQueryClass::GetPickRay(float screenX, float screenY, D3DClass* direct3D, CameraClass* camera, MeshRay& ray)
+{
+	D3D11_VIEWPORT viewport;
+	D3DXMATRIX viewMatrix, projectionMatrix, viewProjectionMatrix, inverseMatrix;
+	D3DXVECTOR3 point, nearPoint, farPoint, direction;
+	float length;
+
+	direct3D->GetViewport(viewport);
+	direct3D->GetProjectionMatrix(projectionMatrix);
+	camera->GetViewMatrix(viewMatrix);
+
+	D3DXMatrixMultiply(&viewProjectionMatrix, &viewMatrix, &projectionMatrix);
+	D3DXMatrixInverse(&inverseMatrix, 0, &viewProjectionMatrix);
+
+	// From pixels to -1 to 1, with y going up.
+	point.x = (screenX - viewport.TopLeftX) / viewport.Width * 2.0f - 1.0f;
+	point.y = 1.0f - (screenY - viewport.TopLeftY) / viewport.Height * 2.0f;
+
+	point.z = 0.0f;
+	D3DXVec3TransformCoord(&nearPoint, &point, &inverseMatrix);
+	point.z = 1.0f;
+	D3DXVec3TransformCoord(&farPoint, &point, &inverseMatrix);
+
+	direction = farPoint - nearPoint;
+	length = D3DXVec3Length(&direction);
+	D3DXVec3Normalize(&direction, &direction);
+
+	ray.origin.x = nearPoint.x;
+	ray.origin.y = nearPoint.y;
+	ray.origin.z = nearPoint.z;
+	ray.origin.w = 1.0f;
+	ray.direction.x = direction.x;
+	ray.direction.y = direction.y;
+	ray.direction.z = direction.z;
+	ray.direction.w = 0.0f;
+	ray.maxDistance = length;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the nearest entity under a point of the screen. </summary>
+///
+/// <param name="screenX">  The x of the point, in pixels from the left. </param>
+/// <param name="screenY">  The y of the point, in pixels from the top. </param>
+/// <param name="direct3D"> The device, for the viewport and the projection. </param>
+/// <param name="camera">	The camera, rendered this frame. </param>
+/// <param name="hit">		[out] The hit, its distance from the near plane. </param>
+///
+/// <returns> true if there is an entity under the point. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneQueryClass::Pick(float screenX, float screenY, D3DClass* direct3D, CameraClass* camera, SceneQueryHit& hit)
+{
+	MeshRay ray;
+
+	GetPickRay(screenX, screenY, direct3D, camera, ray);
+
+	return Raycast(ray, hit);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the nearest entity a ray hits. </summary>
+///
+/// <param name="ray"> The ray. </param>
+/// <param name="hit"> [out] The hit, with an entity of ENTITY_NONE if there is none. </param>
+///
+/// <returns> true if the ray hits an entity. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneQueryClass::Raycast(const MeshRay& ray, SceneQueryHit& hit)
+{
+	PROFILE_FUNCTION();
+
+	return Cast(ray, false, m_candidates, m_staticCandidates, hit);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds if nothing is between two points, stopping at the first triangle in the way. </summary>
+///
+/// <param name="from"> The first point. </param>
+/// <param name="to">   The second point. </param>
+///
+/// <returns> true if no entity is between them. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneQueryClass::HasLineOfSight(const SceneVector& from, const SceneVector& to)
+{
+	MeshRay ray;
+	SceneQueryHit hit;
+
+	PROFILE_FUNCTION();
+
+	// A direction from one point to the other makes the second one a distance of 1.
+	ray.origin = from;
+	ray.direction.x = to.x - from.x;
+	ray.direction.y = to.y - from.y;
+	ray.direction.z = to.z - from.z;
+	ray.direction.w = 0.0f;
+	ray.maxDistance = 1.0f;
+
+	return !Cast(ray, true, m_candidates, m_staticCandidates, hit);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the nearest entity many rays hit, split between the workers when there are enough of them. </summary>
+///
+/// <param name="rays">	   The rays. </param>
+/// <param name="count">   The number of rays. </param>
+/// <param name="hits">	   [out] The hit of each ray, with an entity of ENTITY_NONE for a miss. </param>
+/// <param name="workers"> The number of workers to run on, 0 runs on the calling thread, -1 on every core. </param>
+///
+/// <returns> The number of rays that hit an entity. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int SceneQueryClass::RaycastBatch(const MeshRay* rays, int count, SceneQueryHit* hits, int workers)
+{
+	int first, result, i;
+	bool done;
+
+	PROFILE_FUNCTION();
+
+	done = false;
+	if(workers != 0 && count >= SCENE_QUERY_PARALLEL_RAYS)
+	{
+		TaskGraphClass tasks;
+
+		for(first=0; first<count; first+=SCENE_QUERY_RAYS_PER_TASK)
+		{
+			tasks.AddTask("SceneQueryClass::RaycastBatch", [this, rays, hits, first, count]() -> bool
+			{
+				vector<BvhRayHit> candidates, staticCandidates;
+				int i;
+
+				for(i=first; i<first + SCENE_QUERY_RAYS_PER_TASK && i<count; i++)
+				{
+					Cast(rays[i], false, candidates, staticCandidates, hits[i]);
+				}
+				return true;
+			});
+		}
+
+		done = tasks.Run(workers);
+	}
+
+	// Without the workers the rays are cast here.
+	if(!done)
+	{
+		for(i=0; i<count; i++)
+		{
+			Cast(rays[i], false, m_candidates, m_staticCandidates, hits[i]);
+		}
+	}
+
+	result = 0;
+	for(i=0; i<count; i++)
+	{
+		result += hits[i].entity != ENTITY_NONE ? 1 : 0;
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Casts a ray at the entities whose box it goes through, nearest box first. The matrices
+/// 	keep the ray a line, so a distance along it is the same in the space of the model.
+/// </summary>
+///
+/// <param name="ray">				The ray. </param>
+/// <param name="any">				true to stop at the first hit, which might not be the nearest. </param>
+/// <param name="candidates">		[in,out] Room for the entities that move the ray goes through. </param>
+/// <param name="staticCandidates"> [in,out] Room for the static ones. </param>
+/// <param name="hit">				[out] The hit, with an entity of ENTITY_NONE if there is none. </param>
+///
+/// <returns> true if the ray hits an entity. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SceneQueryClass::Cast(const MeshRay& ray, bool any, vector<BvhRayHit>& candidates, vector<BvhRayHit>& staticCandidates, SceneQueryHit& hit)
+{
+	const TransformComponent* transform;
+	const MeshRefComponent* meshRef;
+	D3DXMATRIX worldMatrix, inverseMatrix;
+	D3DXVECTOR3 origin, direction, localOrigin, localDirection;
+	MeshRay localRay;
+	MeshHit meshHit;
+	EntityId entity;
+	float best;
+	int count, i;
+
+	hit.entity = ENTITY_NONE;
+	hit.triangle = -1;
+	hit.distance = ray.maxDistance;
+	hit.position = ray.origin;
+	if(!m_entities || !m_renderSystem)
+	{
+		return false;
+	}
+
+	// The entities of both hierarchies, in one list nearest first.
+	m_renderSystem->GetBvh()->QueryRay(ray.origin, ray.direction, ray.maxDistance, candidates);
+	m_renderSystem->GetStaticBvh()->QueryRay(ray.origin, ray.direction, ray.maxDistance, staticCandidates);
+	count = (int)candidates.size();
+	candidates.insert(candidates.end(), staticCandidates.begin(), staticCandidates.end());
+	inplace_merge(candidates.begin(), candidates.begin() + count, candidates.end(), CompareCandidates);
+
+	origin = D3DXVECTOR3(ray.origin.x, ray.origin.y, ray.origin.z);
+	direction = D3DXVECTOR3(ray.direction.x, ray.direction.y, ray.direction.z);
+
+	best = ray.maxDistance;
+	for(i=0; i<(int)candidates.size() && candidates[i].distance <= best; i++)
+	{
+		entity = (EntityId)candidates[i].id;
+		transform = (const TransformComponent*)m_entities->GetComponent(entity, m_renderSystem->GetTransformComponent());
+		meshRef = (const MeshRefComponent*)m_entities->GetComponent(entity, m_renderSystem->GetMeshRefComponent());
+		if(!transform || !meshRef)
+		{
+			continue;
+		}
+
+		// Take the ray into the space of the model, a flattened entity can't be hit.
+		worldMatrix = D3DXMATRIX(transform->world.m);
+		if(!D3DXMatrixInverse(&inverseMatrix, 0, &worldMatrix))
+		{
+			continue;
+		}
+		D3DXVec3TransformCoord(&localOrigin, &origin, &inverseMatrix);
+		D3DXVec3TransformNormal(&localDirection, &direction, &inverseMatrix);
+
+		localRay.origin.x = localOrigin.x;
+		localRay.origin.y = localOrigin.y;
+		localRay.origin.z = localOrigin.z;
+		localRay.origin.w = 1.0f;
+		localRay.direction.x = localDirection.x;
+		localRay.direction.y = localDirection.y;
+		localRay.direction.z = localDirection.z;
+		localRay.direction.w = 0.0f;
+		localRay.maxDistance = best;
+
+		if(any)
+		{
+			if(meshRef->model->GetMeshBvh()->IntersectAny(localRay))
+			{
+				hit.entity = entity;
+				return true;
+			}
+		}
+		else if(meshRef->model->GetMeshBvh()->Intersect(localRay, meshHit))
+		{
+			best = meshHit.distance;
+			hit.entity = entity;
+			hit.triangle = meshHit.triangle;
+		}
+	}
+
+	if(hit.entity == ENTITY_NONE)
+	{
+		return false;
+	}
+
+	hit.distance = best;
+	hit.position.x = ray.origin.x + ray.direction.x * best;
+	hit.position.y = ray.origin.y + ray.direction.y * best;
+	hit.position.z = ray.origin.z + ray.direction.z * best;
+	hit.position.w = 1.0f;
+
+	return true;
+}
@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	scenequeryclass.h
+//
+// summary:	Declares the scenequeryclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _SCENEQUERYCLASS_H_
+#define _SCENEQUERYCLASS_H_
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "d3dclass.h"
+#include "cameraclass.h"
+#include "entitymanagerclass.h"
+#include "rendersystemclass.h"
+#include "meshbvhclass.h"
+
+// Globals.
+const int SCENE_QUERY_RAYS_PER_TASK = 256;
+const int SCENE_QUERY_PARALLEL_RAYS = 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Where a ray hits the scene: the entity, ENTITY_NONE for a miss, the triangle of its model,
+/// 	how far along the ray and the point in world space.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct SceneQueryHit
+{
+	EntityId entity;
+	int triangle;
+	float distance;
+	SceneVector position;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Casts rays at the entities the render system draws, against the triangles of their
+/// 	models. The hierarchies of the render system give the entities whose box the ray goes
+/// 	through, nearest first; the ray is taken into the space of each one's model and cast at
+/// 	the triangle tree of the model, until the next box starts past the nearest hit.
+///
+/// 	The rays are in world space, their distances in lengths of their direction. Pick makes
+/// 	the ray under a point of the screen, HasLineOfSight tells if anything is between two
+/// 	points, and RaycastBatch casts many rays on the workers. Cast after the render system
+/// 	Update, and not while a model swaps its geometry in.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class SceneQueryClass
+{
+public:
+	SceneQueryClass();
+	SceneQueryClass(const SceneQueryClass&);
+	~SceneQueryClass();
+
+	bool Initialize(EntityManagerClass*, RenderSystemClass*);
+	void Shutdown();
+
+	static void GetPickRay(float, float, D3DClass*, CameraClass*, MeshRay&);
+	bool Pick(float, float, D3DClass*, CameraClass*, SceneQueryHit&);
+	bool Raycast(const MeshRay&, SceneQueryHit&);
+	bool HasLineOfSight(const SceneVector&, const SceneVector&);
+	int RaycastBatch(const MeshRay*, int, SceneQueryHit*, int = -1);
+
+private:
+	bool Cast(const MeshRay&, bool, vector<BvhRayHit>&, vector<BvhRayHit>&, SceneQueryHit&);
+
+private:
+	EntityManagerClass* m_entities;
+	RenderSystemClass* m_renderSystem;
+	vector<BvhRayHit> m_candidates;
+	vector<BvhRayHit> m_staticCandidates;
+};
+
+#endif
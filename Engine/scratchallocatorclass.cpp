@@ -0,0 +1,240 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	scratchallocatorclass.cpp
+//
+// summary:	Implements the scratchallocatorclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "scratchallocatorclass.h"
+
+// System Includes.
+#include <cstring>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "threadlocal.h"
+#include "profilerclass.h"
+
+// Globals.
+// Each thread gets its own scratch stack, so no locking is ever needed.
+static THREAD_LOCAL LinearAllocatorClass* ThreadScratch = 0;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Marks the top of the calling thread's scratch stack. If the thread never called
+/// 	InitializeThread the stack is created here with the default size.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ScratchAllocatorClass::ScratchAllocatorClass()
+{
+	if(!ThreadScratch)
+	{
+		InitializeThread();
+	}
+
+	m_stack = ThreadScratch;
+	m_marker = m_stack ? m_stack->GetMarker() : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Private copy constructor, a scope can't be shared. </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ScratchAllocatorClass::ScratchAllocatorClass(const ScratchAllocatorClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Pops everything allocated since this scope was created. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ScratchAllocatorClass::~ScratchAllocatorClass()
+{
+	if(m_stack)
+	{
+		m_stack->FreeToMarker(m_marker);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Allocates temporary memory that lives until this scope ends. </summary>
+///
+/// <param name="size">		 The size in bytes. </param>
+/// <param name="alignment"> The alignment, must be a power of two. </param>
+///
+/// <returns> The memory, or null if the scratch stack is exhausted. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void* ScratchAllocatorClass::Allocate(size_t size, size_t alignment)
+{
+	if(!m_stack)
+	{
+		return 0;
+	}
+
+	return m_stack->Allocate(size, alignment);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates the scratch stack of the calling thread. </summary>
+///
+/// <param name="size"> The size of the stack in bytes. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ScratchAllocatorClass::InitializeThread(size_t size)
+{
+	bool result;
+
+	// Already created for this thread.
+	if(ThreadScratch)
+	{
+		return true;
+	}
+
+	ThreadScratch = new LinearAllocatorClass;
+	if(!ThreadScratch)
+	{
+		return false;
+	}
+
+	result = ThreadScratch->Initialize(size);
+	if(!result)
+	{
+		delete ThreadScratch;
+		ThreadScratch = 0;
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the scratch stack of the calling thread. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ScratchAllocatorClass::ShutdownThread()
+{
+	if(ThreadScratch)
+	{
+		ThreadScratch->Shutdown();
+		delete ThreadScratch;
+		ThreadScratch = 0;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the usage statistics of the calling thread's scratch stack. </summary>
+///
+/// <param name="stats"> [out] The statistics, all zero if the thread has no stack. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void ScratchAllocatorClass::GetThreadStats(AllocatorStats& stats)
+{
+	if(ThreadScratch)
+	{
+		ThreadScratch->GetStats(stats);
+	}
+	else
+	{
+		memset(&stats, 0, sizeof(AllocatorStats));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Checks the scratch of the calling thread: an inner scope gives back its blocks when it
+/// 	ends, an outer one gives back everything it took, and more than the stack holds is
+/// 	refused. Then times rounds of ALLOCATOR_BENCHMARK_ALLOCATIONS blocks in a scope against
+/// 	new and delete of the same size.
+/// </summary>
+///
+/// <param name="benchmark"> [out] The checks and the timings. </param>
+///
+/// <returns> true if every check passed, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool ScratchAllocatorClass::Benchmark(AllocatorBenchmark& benchmark)
+{
+	vector<char*> blocks;
+	AllocatorStats before, after;
+	unsigned long long start, elapsed;
+	char *outer, *inner, *reused;
+	int round, i;
+	bool created, result;
+
+	memset(&benchmark, 0, sizeof(AllocatorBenchmark));
+	benchmark.allocations = ALLOCATOR_BENCHMARK_ALLOCATIONS;
+	benchmark.rounds = ALLOCATOR_BENCHMARK_ROUNDS;
+
+	// Use the scratch of the thread if it has one, what is already on it is left alone.
+	created = ThreadScratch == 0;
+	if(!InitializeThread())
+	{
+		return false;
+	}
+
+	blocks.resize(ALLOCATOR_BENCHMARK_ALLOCATIONS);
+	GetThreadStats(before);
+
+	{
+		ScratchAllocatorClass scratch;
+
+		outer = (char*)scratch.Allocate(ALLOCATOR_BENCHMARK_SIZE);
+		{
+			ScratchAllocatorClass nested;
+
+			inner = (char*)nested.Allocate(ALLOCATOR_BENCHMARK_SIZE);
+		}
+		reused = (char*)scratch.Allocate(ALLOCATOR_BENCHMARK_SIZE);
+
+		// The nested scope is stacked on the outer one, and its block is taken again once it ends.
+		result = outer && inner == outer + ALLOCATOR_BENCHMARK_SIZE && reused == inner;
+		benchmark.checks++;
+		benchmark.failures += result ? 0 : 1;
+
+		result = scratch.Allocate(before.capacity + 1) == 0;
+		benchmark.checks++;
+		benchmark.failures += result ? 0 : 1;
+	}
+
+	GetThreadStats(after);
+	result = after.used == before.used;
+	benchmark.checks++;
+	benchmark.failures += result ? 0 : 1;
+
+	// Time a scope full of blocks, they are written so nothing is optimized away.
+	start = ProfilerClass::GetTimestamp();
+	for(round=0; round<ALLOCATOR_BENCHMARK_ROUNDS; round++)
+	{
+		ScratchAllocatorClass scratch;
+
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			blocks[i] = (char*)scratch.Allocate(ALLOCATOR_BENCHMARK_SIZE);
+			blocks[i][0] = (char)i;
+		}
+	}
+	elapsed = ProfilerClass::GetTimestamp() - start;
+	benchmark.allocatorMs = ProfilerClass::TicksToMilliseconds(elapsed) / ALLOCATOR_BENCHMARK_ROUNDS;
+
+	start = ProfilerClass::GetTimestamp();
+	for(round=0; round<ALLOCATOR_BENCHMARK_ROUNDS; round++)
+	{
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			blocks[i] = new char[ALLOCATOR_BENCHMARK_SIZE];
+			blocks[i][0] = (char)i;
+		}
+		for(i=0; i<ALLOCATOR_BENCHMARK_ALLOCATIONS; i++)
+		{
+			delete [] blocks[i];
+		}
+	}
+	elapsed = ProfilerClass::GetTimestamp() - start;
+	benchmark.heapMs = ProfilerClass::TicksToMilliseconds(elapsed) / ALLOCATOR_BENCHMARK_ROUNDS;
+
+	if(created)
+	{
+		ShutdownThread();
+	}
+
+	return benchmark.failures == 0;
+}
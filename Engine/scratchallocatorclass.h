@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	scratchallocatorclass.h
+//
+// summary:	Declares the scratchallocatorclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _SCRATCHALLOCATORCLASS_H_
+#define _SCRATCHALLOCATORCLASS_H_
+
+// Includes.
+#include "linearallocatorclass.h"
+
+// Globals.
+const size_t SCRATCH_ALLOCATOR_SIZE = 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Scoped access to the calling thread's scratch stack. Every thread owns one linear
+/// 	allocator used as a stack; creating a ScratchAllocatorClass on the stack remembers where
+/// 	the top is, and destroying it pops everything allocated through it. This is meant for
+/// 	temporaries that only live inside one function, like the arrays used to fill a buffer:
+/// 	
+/// 	ScratchAllocatorClass scratch;
+/// 	vertices = (VertexType*)scratch.Allocate(sizeof(VertexType) * count);
+/// 	
+/// 	Since the memory is given back by the destructor, every early return frees it too.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class ScratchAllocatorClass
+{
+public:
+	ScratchAllocatorClass();
+	~ScratchAllocatorClass();
+
+	void* Allocate(size_t, size_t = DEFAULT_ALIGNMENT);
+
+	static bool InitializeThread(size_t = SCRATCH_ALLOCATOR_SIZE);
+	static void ShutdownThread();
+	static void GetThreadStats(AllocatorStats&);
+
+	static bool Benchmark(AllocatorBenchmark&);
+
+private:
+	ScratchAllocatorClass(const ScratchAllocatorClass&);
+
+private:
+	LinearAllocatorClass* m_stack;
+	size_t m_marker;
+};
+
+#endif
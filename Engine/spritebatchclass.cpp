@@ -0,0 +1,582 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	spritebatchclass.cpp
+//
+// summary:	Implements the spritebatchclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "spritebatchclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// Includes.
+#include "profilerclass.h"
+#include "logclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A ring of quads in memory, for the benchmark: it checks every draw stays in the ring and,
+/// 	until the next discard, past what was drawn before, as the GPU may still be reading it. It
+/// 	counts the draws and the quads.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class SpriteMemoryTarget : public SpriteTargetClass
+{
+public:
+	SpriteMemoryTarget(int quads) : vertices(quads * 4), drawnVertices(0), draws(0), quads(0), mistakes(0) {}
+
+	int GetCapacity()
+	{
+		return (int)vertices.size() / 4;
+	}
+
+	SpriteVertex* Map(bool discard)
+	{
+		if(discard)
+		{
+			drawnVertices = 0;
+		}
+
+		return &vertices[0];
+	}
+
+	void Unmap()
+	{
+	}
+
+	bool Draw(const void* texture, int firstVertex, int quadCount)
+	{
+		if(!texture || firstVertex < drawnVertices || quadCount <= 0 || firstVertex + quadCount * 4 > (int)vertices.size())
+		{
+			mistakes++;
+		}
+
+		drawnVertices = firstVertex + quadCount * 4;
+		draws++;
+		quads += quadCount;
+		return true;
+	}
+
+	vector<SpriteVertex> vertices;
+	int drawnVertices;
+	int draws;
+	int quads;
+	int mistakes;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SpriteBatchClass::SpriteBatchClass()
+{
+	m_lastGroup = -1;
+	m_ringQuad = -1;
+	memset(&m_stats, 0, sizeof(SpriteBatchStats));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SpriteBatchClass::SpriteBatchClass(const SpriteBatchClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SpriteBatchClass::~SpriteBatchClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Makes room for the sprites of a frame, more are made room for as they come. </summary>
+///
+/// <param name="sprites"> The number of sprites. </param>
+///
+/// <returns> true. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SpriteBatchClass::Initialize(int sprites)
+{
+	Shutdown();
+
+	m_sprites.reserve(sprites);
+	m_spriteGroups.reserve(sprites);
+	m_order.reserve(sprites);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the sprites, the next flush starts the ring again. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteBatchClass::Shutdown()
+{
+	vector<Sprite>().swap(m_sprites);
+	vector<int>().swap(m_spriteGroups);
+	vector<int>().swap(m_order);
+	m_groups.clear();
+	m_groupOrder.clear();
+	m_draws.clear();
+	m_chunks.clear();
+	m_lastGroup = -1;
+	m_ringQuad = -1;
+	memset(&m_stats, 0, sizeof(SpriteBatchStats));
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts the sprites of a frame, forgetting those of the last. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteBatchClass::Begin()
+{
+	m_sprites.clear();
+	m_spriteGroups.clear();
+	m_groups.clear();
+	m_draws.clear();
+	m_lastGroup = -1;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a sprite. </summary>
+///
+/// <param name="sprite"> The sprite. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteBatchClass::Draw(const Sprite& sprite)
+{
+	int group;
+
+	group = FindGroup(sprite.layer, sprite.texture);
+	m_groups[group].count++;
+
+	m_sprites.push_back(sprite);
+	m_spriteGroups.push_back(group);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a solid rectangle, drawn with the white cell of a font so it batches with the text. </summary>
+///
+/// <param name="font">   The font. </param>
+/// <param name="x">	  The left, in pixels. </param>
+/// <param name="y">	  The top, in pixels. </param>
+/// <param name="width">  The width, in pixels. </param>
+/// <param name="height"> The height, in pixels. </param>
+/// <param name="color">  The colour, red, green, blue and alpha. </param>
+/// <param name="layer">  The layer. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteBatchClass::DrawRectangle(FontClass* font, float x, float y, float width, float height, const float* color, int layer)
+{
+	Sprite sprite;
+
+	sprite.texture = font->GetTexture();
+	sprite.x = x;
+	sprite.y = y;
+	sprite.width = width;
+	sprite.height = height;
+	font->GetWhiteTexel(sprite.u0, sprite.v0);
+	sprite.u1 = sprite.u0;
+	sprite.v1 = sprite.v0;
+	memcpy(sprite.color, color, sizeof(sprite.color));
+	sprite.layer = layer;
+
+	Draw(sprite);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a string, a sprite for every glyph of its cached layout. </summary>
+///
+/// <param name="font">  The font. </param>
+/// <param name="text">  The string. </param>
+/// <param name="x">	 The left of the string, in pixels. </param>
+/// <param name="y">	 The top of the string, in pixels. </param>
+/// <param name="color"> The colour, red, green, blue and alpha. </param>
+/// <param name="layer"> The layer. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteBatchClass::DrawString(FontClass* font, const char* text, float x, float y, const float* color, int layer)
+{
+	Sprite sprite;
+	int i;
+
+	const TextLayout& layout = font->GetLayout(text);
+
+	sprite.texture = font->GetTexture();
+	memcpy(sprite.color, color, sizeof(sprite.color));
+	sprite.layer = layer;
+
+	for(i=0; i<(int)layout.glyphs.size(); i++)
+	{
+		sprite.x = x + layout.glyphs[i].x;
+		sprite.y = y + layout.glyphs[i].y;
+		sprite.width = layout.glyphs[i].width;
+		sprite.height = layout.glyphs[i].height;
+		sprite.u0 = layout.glyphs[i].u0;
+		sprite.v0 = layout.glyphs[i].v0;
+		sprite.u1 = layout.glyphs[i].u1;
+		sprite.v1 = layout.glyphs[i].v1;
+
+		Draw(sprite);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Puts the sprites of the frame in drawing order and merges them into draws. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteBatchClass::End()
+{
+	DrawType draw;
+	int i, first, group;
+
+	PROFILE_FUNCTION();
+
+	// Order the groups by layer, the groups of a layer stay in the order they were first drawn.
+	m_groupOrder.resize(m_groups.size());
+	for(i=0; i<(int)m_groups.size(); i++)
+	{
+		m_groupOrder[i] = i;
+	}
+	stable_sort(m_groupOrder.begin(), m_groupOrder.end(), [this](int a, int b) -> bool
+	{
+		return m_groups[a].layer < m_groups[b].layer;
+	});
+
+	// Find where the sprites of each group start, and merge the groups of one texture that follow each other.
+	first = 0;
+	for(i=0; i<(int)m_groupOrder.size(); i++)
+	{
+		group = m_groupOrder[i];
+		m_groups[group].first = first;
+
+		if(!m_draws.empty() && m_draws.back().texture == m_groups[group].texture)
+		{
+			m_draws.back().quadCount += m_groups[group].count;
+		}
+		else
+		{
+			draw.texture = m_groups[group].texture;
+			draw.firstQuad = first;
+			draw.quadCount = m_groups[group].count;
+			m_draws.push_back(draw);
+		}
+
+		first += m_groups[group].count;
+	}
+
+	// Put each sprite in the next place of its group, so the order they were drawn in holds within a group.
+	m_order.resize(m_sprites.size());
+	for(i=0; i<(int)m_sprites.size(); i++)
+	{
+		m_order[m_groups[m_spriteGroups[i]].first++] = i;
+	}
+
+	m_stats.sprites = (int)m_sprites.size();
+	m_stats.groups = (int)m_groups.size();
+	m_stats.draws = 0;
+	m_stats.maps = 0;
+	m_stats.discards = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Writes the quads into the ring of the target and draws them. As many quads as fit before
+/// 	the end of the ring are written with a single map, then drawn; the ring is discarded
+/// 	and written from the start again only when it is full.
+/// </summary>
+///
+/// <param name="target"> The target. </param>
+///
+/// <returns> false if the ring could not be mapped or a draw failed. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SpriteBatchClass::Flush(SpriteTargetClass* target)
+{
+	ChunkType chunk;
+	SpriteVertex* vertices;
+	int capacity, draw, drawQuad, count, i;
+	bool discard;
+
+	PROFILE_FUNCTION();
+
+	capacity = target->GetCapacity();
+	if(capacity <= 0)
+	{
+		return false;
+	}
+
+	draw = 0;
+	drawQuad = 0;
+	while(draw < (int)m_draws.size())
+	{
+		// Start the ring again once it is full, the first time as well.
+		discard = m_ringQuad < 0 || m_ringQuad >= capacity;
+		if(discard)
+		{
+			m_ringQuad = 0;
+			m_stats.discards++;
+		}
+
+		vertices = target->Map(discard);
+		if(!vertices)
+		{
+			m_ringQuad = -1;
+			return false;
+		}
+		m_stats.maps++;
+
+		// Write what fits, splitting the draw that reaches the end of the ring.
+		m_chunks.clear();
+		while(draw < (int)m_draws.size() && m_ringQuad < capacity)
+		{
+			count = m_draws[draw].quadCount - drawQuad;
+			if(count > capacity - m_ringQuad)
+			{
+				count = capacity - m_ringQuad;
+			}
+
+			WriteQuads(m_draws[draw].firstQuad + drawQuad, count, vertices + m_ringQuad * 4);
+
+			chunk.texture = m_draws[draw].texture;
+			chunk.firstVertex = m_ringQuad * 4;
+			chunk.quadCount = count;
+			m_chunks.push_back(chunk);
+
+			m_ringQuad += count;
+			drawQuad += count;
+			if(drawQuad == m_draws[draw].quadCount)
+			{
+				draw++;
+				drawQuad = 0;
+			}
+		}
+
+		target->Unmap();
+
+		for(i=0; i<(int)m_chunks.size(); i++)
+		{
+			if(!target->Draw(m_chunks[i].texture, m_chunks[i].firstVertex, m_chunks[i].quadCount))
+			{
+				return false;
+			}
+			m_stats.draws++;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the counters of the last frame. </summary>
+///
+/// <param name="stats"> [out] The counters. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteBatchClass::GetStats(SpriteBatchStats& stats)
+{
+	stats = m_stats;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Measures a frame of SPRITE_BENCHMARK_SPRITES sprites scattered over the screen in
+/// 	SPRITE_BENCHMARK_LAYERS layers, each drawn from its own atlases out of
+/// 	SPRITE_BENCHMARK_TEXTURES, as a game packs the sprites of a layer together, and
+/// 	SPRITE_BENCHMARK_STRINGS strings, half of them the same every frame, drawn into a ring in
+/// 	memory the size of the one on the GPU. The sprites come in random order.
+/// </summary>
+///
+/// <param name="benchmark"> [out] The measures. </param>
+///
+/// <returns> false if a draw went out of the ring or missed quads. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SpriteBatchClass::Benchmark(SpriteBatchBenchmark& benchmark)
+{
+	const float White[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	SpriteBatchClass batch;
+	SpriteMemoryTarget target(SPRITE_RING_QUADS);
+	FontClass font;
+	Sprite sprite;
+	char textures[SPRITE_BENCHMARK_TEXTURES];
+	char text[64];
+	unsigned long long start, submit, sort, write;
+	unsigned int hash;
+	int frame, i;
+	bool result;
+
+	memset(&benchmark, 0, sizeof(SpriteBatchBenchmark));
+	benchmark.sprites = SPRITE_BENCHMARK_SPRITES;
+	benchmark.textures = SPRITE_BENCHMARK_TEXTURES;
+	benchmark.layers = SPRITE_BENCHMARK_LAYERS;
+	benchmark.strings = SPRITE_BENCHMARK_STRINGS;
+	benchmark.frames = SPRITE_BENCHMARK_FRAMES;
+
+	if(!batch.Initialize(SPRITE_BENCHMARK_SPRITES) || !font.Initialize())
+	{
+		return false;
+	}
+	font.SetTexture(&font);
+
+	sprite.width = 16.0f;
+	sprite.height = 16.0f;
+	sprite.u0 = 0.0f;
+	sprite.v0 = 0.0f;
+	sprite.u1 = 1.0f;
+	sprite.v1 = 1.0f;
+	memcpy(sprite.color, White, sizeof(White));
+
+	result = true;
+	submit = 0;
+	sort = 0;
+	write = 0;
+	for(frame=0; frame<SPRITE_BENCHMARK_FRAMES; frame++)
+	{
+		start = ProfilerClass::GetTimestamp();
+
+		batch.Begin();
+		for(i=0; i<SPRITE_BENCHMARK_SPRITES; i++)
+		{
+			hash = (unsigned int)(i + frame * SPRITE_BENCHMARK_SPRITES) * 2654435761u;
+			hash ^= hash >> 15;
+
+			sprite.layer = hash % SPRITE_BENCHMARK_LAYERS;
+			sprite.texture = &textures[(sprite.layer + (hash >> 8) * SPRITE_BENCHMARK_LAYERS) % SPRITE_BENCHMARK_TEXTURES];
+			sprite.x = (float)(hash % 1904);
+			sprite.y = (float)((hash >> 11) % 1064);
+			batch.Draw(sprite);
+		}
+
+		for(i=0; i<SPRITE_BENCHMARK_STRINGS; i++)
+		{
+			if(i % 2 == 0)
+			{
+				LOG_SNPRINTF(text, sizeof(text), "Counter %d", i);
+			}
+			else
+			{
+				LOG_SNPRINTF(text, sizeof(text), "Frame %d, counter %d", frame, i);
+			}
+			batch.DrawString(&font, text, 8.0f, 8.0f + i * font.GetLineHeight(), White, SPRITE_BENCHMARK_LAYERS);
+		}
+		submit += ProfilerClass::GetTimestamp() - start;
+
+		start = ProfilerClass::GetTimestamp();
+		batch.End();
+		sort += ProfilerClass::GetTimestamp() - start;
+
+		start = ProfilerClass::GetTimestamp();
+		target.draws = 0;
+		target.quads = 0;
+		result = batch.Flush(&target) && result;
+		write += ProfilerClass::GetTimestamp() - start;
+
+		if(target.quads != (int)batch.m_sprites.size() || target.mistakes > 0)
+		{
+			result = false;
+		}
+
+		benchmark.draws = target.draws > benchmark.draws ? target.draws : benchmark.draws;
+		benchmark.maps = batch.m_stats.maps > benchmark.maps ? batch.m_stats.maps : benchmark.maps;
+		benchmark.layouts = font.GetLayoutCount();
+		font.EndFrame();
+	}
+
+	benchmark.submitMs = ProfilerClass::TicksToMilliseconds(submit) / SPRITE_BENCHMARK_FRAMES;
+	benchmark.sortMs = ProfilerClass::TicksToMilliseconds(sort) / SPRITE_BENCHMARK_FRAMES;
+	benchmark.writeMs = ProfilerClass::TicksToMilliseconds(write) / SPRITE_BENCHMARK_FRAMES;
+
+	font.Shutdown();
+	batch.Shutdown();
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Finds the group of a layer and a texture, or starts it. The sprites mostly come in runs
+/// 	of one texture, so the group of the last sprite is tried first; the rest is a search
+/// 	through the groups, of which a frame has a handful.
+/// </summary>
+///
+/// <param name="layer">   The layer. </param>
+/// <param name="texture"> The texture. </param>
+///
+/// <returns> The group. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int SpriteBatchClass::FindGroup(int layer, const void* texture)
+{
+	GroupType group;
+	int i;
+
+	if(m_lastGroup >= 0 && m_groups[m_lastGroup].layer == layer && m_groups[m_lastGroup].texture == texture)
+	{
+		return m_lastGroup;
+	}
+
+	for(i=0; i<(int)m_groups.size(); i++)
+	{
+		if(m_groups[i].layer == layer && m_groups[i].texture == texture)
+		{
+			m_lastGroup = i;
+			return i;
+		}
+	}
+
+	group.layer = layer;
+	group.texture = texture;
+	group.count = 0;
+	group.first = 0;
+	m_groups.push_back(group);
+
+	m_lastGroup = (int)m_groups.size() - 1;
+
+	return m_lastGroup;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Writes the corners of sprites in drawing order, top left, top right, bottom left and
+/// 	bottom right. The vertices may be mapped memory the CPU can't read back fast, so they
+/// 	are only ever written, one after the other.
+/// </summary>
+///
+/// <param name="firstQuad">  The first sprite, in drawing order. </param>
+/// <param name="quadCount">  The number of sprites. </param>
+/// <param name="vertices">   [out] The vertices, four for every sprite. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteBatchClass::WriteQuads(int firstQuad, int quadCount, SpriteVertex* vertices)
+{
+	const Sprite* sprite;
+	int i, corner;
+
+	for(i=0; i<quadCount; i++)
+	{
+		sprite = &m_sprites[m_order[firstQuad + i]];
+
+		for(corner=0; corner<4; corner++)
+		{
+			vertices->x = corner & 1 ? sprite->x + sprite->width : sprite->x;
+			vertices->y = corner & 2 ? sprite->y + sprite->height : sprite->y;
+			vertices->z = SPRITE_DEPTH;
+			vertices->r = sprite->color[0];
+			vertices->g = sprite->color[1];
+			vertices->b = sprite->color[2];
+			vertices->a = sprite->color[3];
+			vertices->u = corner & 1 ? sprite->u1 : sprite->u0;
+			vertices->v = corner & 2 ? sprite->v1 : sprite->v0;
+			vertices++;
+		}
+	}
+
+	return;
+}
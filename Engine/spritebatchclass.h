@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	spritebatchclass.h
+//
+// summary:	Declares the spritebatchclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _SPRITEBATCHCLASS_H_
+#define _SPRITEBATCHCLASS_H_
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "spritetargetclass.h"
+#include "fontclass.h"
+
+// Globals.
+const float SPRITE_DEPTH = 1.0f;
+const int SPRITE_RING_QUADS = 65536;
+const int SPRITE_BATCH_RESERVE = 4096;
+const int SPRITE_BENCHMARK_SPRITES = 50000;
+const int SPRITE_BENCHMARK_TEXTURES = 8;
+const int SPRITE_BENCHMARK_LAYERS = 4;
+const int SPRITE_BENCHMARK_STRINGS = 64;
+const int SPRITE_BENCHMARK_FRAMES = 100;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A rectangle of the screen to draw with a piece of a texture, in pixels from the top left
+/// 	corner. The sprites of a lower layer are drawn first, and under those of a higher one.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct Sprite
+{
+	const void* texture;
+	float x;
+	float y;
+	float width;
+	float height;
+	float u0;
+	float v0;
+	float u1;
+	float v1;
+	float color[4];
+	int layer;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Counters of the last frame of the sprite batch. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct SpriteBatchStats
+{
+	int sprites;
+	int groups;
+	int draws;
+	int maps;
+	int discards;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> What the sprite benchmark measured, the milliseconds of an average frame. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct SpriteBatchBenchmark
+{
+	int sprites;
+	int textures;
+	int layers;
+	int strings;
+	int frames;
+	double submitMs;
+	double sortMs;
+	double writeMs;
+	int draws;
+	int maps;
+	int layouts;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Batches the 2D drawing of a frame, the HUD, the debug text and the sprites, into as few
+/// 	draws as there are textures. Draw only stores the sprite, and groups it by layer and
+/// 	texture on the way. End puts the sprites in order: by layer, then by texture, in the
+/// 	order each texture was first drawn with in its layer, and in the order they were drawn
+/// 	within a group. There are few groups, so that is a counting sort and costs a pass over
+/// 	the sprites. Groups of one texture that follow each other merge into one draw.
+///
+/// 	Flush writes the quads straight into the vertex buffer of the target, a ring that is
+/// 	mapped once a frame and never rewritten under a draw that may still read it: it is only
+/// 	discarded when the quads of a frame reach its end. A draw is only split where the ring
+/// 	wraps, so a frame costs a draw per texture, and one more each time it wraps.
+///
+/// 	The positions are in pixels, y down; the target turns them into the orthographic space.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class SpriteBatchClass
+{
+private:
+	struct GroupType
+	{
+		int layer;
+		const void* texture;
+		int count;
+		int first;
+	};
+
+	struct DrawType
+	{
+		const void* texture;
+		int firstQuad;
+		int quadCount;
+	};
+
+	struct ChunkType
+	{
+		const void* texture;
+		int firstVertex;
+		int quadCount;
+	};
+
+public:
+	SpriteBatchClass();
+	SpriteBatchClass(const SpriteBatchClass&);
+	~SpriteBatchClass();
+
+	bool Initialize(int = SPRITE_BATCH_RESERVE);
+	void Shutdown();
+
+	void Begin();
+	void Draw(const Sprite&);
+	void DrawRectangle(FontClass*, float, float, float, float, const float*, int = 0);
+	void DrawString(FontClass*, const char*, float, float, const float*, int = 0);
+	void End();
+	bool Flush(SpriteTargetClass*);
+
+	void GetStats(SpriteBatchStats&);
+
+	static bool Benchmark(SpriteBatchBenchmark&);
+
+private:
+	int FindGroup(int, const void*);
+	void WriteQuads(int, int, SpriteVertex*);
+
+private:
+	vector<Sprite> m_sprites;
+	vector<int> m_spriteGroups;
+	vector<GroupType> m_groups;
+	vector<int> m_groupOrder;
+	vector<int> m_order;
+	vector<DrawType> m_draws;
+	vector<ChunkType> m_chunks;
+	int m_lastGroup;
+	int m_ringQuad;
+	SpriteBatchStats m_stats;
+};
+
+#endif
@@ -0,0 +1,267 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	spriterendererclass.cpp
+//
+// summary:	Implements the spriterendererclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "spriterendererclass.h"
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SpriteRendererClass::SpriteRendererClass()
+{
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_residencyManager = 0;
+	m_vertexHandle = -1;
+	m_indexHandle = -1;
+	m_quadCount = 0;
+	m_deviceContext = 0;
+	m_shader = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SpriteRendererClass::SpriteRendererClass(const SpriteRendererClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SpriteRendererClass::~SpriteRendererClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates the ring of quads and the index buffer that draws it. </summary>
+///
+/// <param name="device">			The device. </param>
+/// <param name="residencyManager"> The residency manager the buffers are accounted in. </param>
+/// <param name="quadCount">		The number of quads the ring holds. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SpriteRendererClass::Initialize(ID3D11Device* device, ResidencyManagerClass* residencyManager, int quadCount)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	D3D11_SUBRESOURCE_DATA indexData;
+	vector<unsigned long> indices;
+	HRESULT result;
+	int i;
+
+	if(!device || quadCount <= 0)
+	{
+		return false;
+	}
+
+	m_quadCount = quadCount;
+
+	// Set up the description of the vertex buffer. (Dynamic so the CPU writes it every frame.)
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = m_quadCount * 4 * sizeof(SpriteVertex);
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.MiscFlags = 0;
+	bufferDesc.StructureByteStride = 0;
+
+	result = device->CreateBuffer(&bufferDesc, NULL, &m_vertexBuffer);
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	// Two triangles a quad, over its corners in the order the batch writes them: top left, top right, bottom left, bottom right.
+	indices.resize(m_quadCount * 6);
+	for(i=0; i<m_quadCount; i++)
+	{
+		indices[i * 6 + 0] = i * 4 + 0;
+		indices[i * 6 + 1] = i * 4 + 1;
+		indices[i * 6 + 2] = i * 4 + 2;
+		indices[i * 6 + 3] = i * 4 + 2;
+		indices[i * 6 + 4] = i * 4 + 1;
+		indices[i * 6 + 5] = i * 4 + 3;
+	}
+
+	// Set up the description of the index buffer. (It never changes.)
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	bufferDesc.ByteWidth = m_quadCount * 6 * sizeof(unsigned long);
+	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	bufferDesc.CPUAccessFlags = 0;
+
+	indexData.pSysMem = &indices[0];
+	indexData.SysMemPitch = 0;
+	indexData.SysMemSlicePitch = 0;
+
+	result = device->CreateBuffer(&bufferDesc, &indexData, &m_indexBuffer);
+	if(FAILED(result))
+	{
+		return false;
+	}
+
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS, 2);
+	RenderStatsClass::Add(RENDER_COUNTER_UPLOAD_BYTES, (unsigned long long)m_quadCount * 6 * sizeof(unsigned long));
+
+	// Account for the buffers. (They are in use every frame, so they can't be evicted.)
+	m_residencyManager = residencyManager;
+	if(m_residencyManager)
+	{
+		m_vertexHandle = m_residencyManager->Register(RESOURCE_VERTEX_BUFFER, (unsigned long long)m_quadCount * 4 * sizeof(SpriteVertex), NULL);
+		m_indexHandle = m_residencyManager->Register(RESOURCE_INDEX_BUFFER, (unsigned long long)m_quadCount * 6 * sizeof(unsigned long), NULL);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the buffers. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteRendererClass::Shutdown()
+{
+	if(m_residencyManager)
+	{
+		m_residencyManager->Unregister(m_vertexHandle);
+		m_residencyManager->Unregister(m_indexHandle);
+		m_vertexHandle = -1;
+		m_indexHandle = -1;
+		m_residencyManager = 0;
+	}
+
+	if(m_indexBuffer)
+	{
+		m_indexBuffer->Release();
+		m_indexBuffer = 0;
+	}
+
+	if(m_vertexBuffer)
+	{
+		m_vertexBuffer->Release();
+		m_vertexBuffer = 0;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Draws the sprites of a batch, after its End. The depth and blend states are left to the
+/// 	caller: the HUD turns the depth off and the alpha blending on around it. This binds the
+/// 	ring and the index buffer, so whatever draws next must bind its own.
+/// </summary>
+///
+/// <param name="deviceContext"> The device context. </param>
+/// <param name="batch">		 The sprite batch. </param>
+/// <param name="shader">		 The color shader. </param>
+/// <param name="orthoMatrix">   The orthographic matrix. </param>
+/// <param name="screenWidth">   The width of the screen. </param>
+/// <param name="screenHeight">  The height of the screen. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SpriteRendererClass::Render(ID3D11DeviceContext* deviceContext, SpriteBatchClass* batch, ColorShaderClass* shader, D3DXMATRIX orthoMatrix,
+								 int screenWidth, int screenHeight)
+{
+	D3DXMATRIX translation;
+	unsigned int stride, offset;
+	bool result;
+
+	if(!m_vertexBuffer)
+	{
+		return false;
+	}
+
+	m_deviceContext = deviceContext;
+	m_shader = shader;
+	m_orthoMatrix = orthoMatrix;
+	D3DXMatrixIdentity(&m_viewMatrix);
+
+	// Flip y and move the origin from the centre of the screen to its top left corner.
+	D3DXMatrixScaling(&m_worldMatrix, 1.0f, -1.0f, 1.0f);
+	D3DXMatrixTranslation(&translation, -(float)screenWidth / 2.0f, (float)screenHeight / 2.0f, 0.0f);
+	D3DXMatrixMultiply(&m_worldMatrix, &m_worldMatrix, &translation);
+
+	// Bind the ring and the quad indices.
+	stride = sizeof(SpriteVertex);
+	offset = 0;
+	deviceContext->IASetVertexBuffers(0, 1, &m_vertexBuffer, &stride, &offset);
+	deviceContext->IASetIndexBuffer(m_indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	RenderStatsClass::Add(RENDER_COUNTER_BUFFER_BINDS, 2);
+	RenderStatsClass::Add(RENDER_COUNTER_STATE_BINDS);
+
+	result = batch->Flush(this);
+
+	m_deviceContext = 0;
+	m_shader = 0;
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of quads the ring holds. </summary>
+///
+/// <returns> The number of quads. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int SpriteRendererClass::GetCapacity()
+{
+	return m_quadCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Maps the ring. With no overwrite the driver hands back the same memory with no wait,
+/// 	trusting the quads still being drawn aren't touched; with discard it renames the buffer.
+/// </summary>
+///
+/// <param name="discard"> true to throw away what the ring holds. </param>
+///
+/// <returns> The first vertex of the ring, null if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+SpriteVertex* SpriteRendererClass::Map(bool discard)
+{
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	HRESULT result;
+
+	result = m_deviceContext->Map(m_vertexBuffer, 0, discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mappedResource);
+	if(FAILED(result))
+	{
+		return 0;
+	}
+	RenderStatsClass::Add(RENDER_COUNTER_MAP_CALLS);
+
+	return (SpriteVertex*)mappedResource.pData;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Unmaps the ring. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void SpriteRendererClass::Unmap()
+{
+	m_deviceContext->Unmap(m_vertexBuffer, 0);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws quads of the ring with a texture. </summary>
+///
+/// <param name="texture">	   The shader resource view of the texture. </param>
+/// <param name="firstVertex"> The first vertex of the quads in the ring. </param>
+/// <param name="quadCount">   The number of quads. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool SpriteRendererClass::Draw(const void* texture, int firstVertex, int quadCount)
+{
+	RenderStatsClass::Add(RENDER_COUNTER_MAP_BYTES, (unsigned long long)quadCount * 4 * sizeof(SpriteVertex));
+
+	return m_shader->Render(m_deviceContext, quadCount * 6, 0, firstVertex, m_worldMatrix, m_viewMatrix, m_orthoMatrix,
+		(ID3D11ShaderResourceView*)texture);
+}
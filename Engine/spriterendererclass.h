@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	spriterendererclass.h
+//
+// summary:	Declares the spriterendererclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _SPRITERENDERERCLASS_H_
+#define _SPRITERENDERERCLASS_H_
+
+// DirectX Includes.
+#include <d3d11.h>
+#include <d3dx10math.h>
+
+// Includes.
+#include "spritetargetclass.h"
+#include "spritebatchclass.h"
+#include "colorshaderclass.h"
+#include "residencymanagerclass.h"
+#include "renderstatsclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Draws a sprite batch with the color shader and the orthographic matrix. The quads go in
+/// 	a dynamic vertex buffer used as a ring: D3D11 can't keep a buffer mapped, so it is mapped
+/// 	with no overwrite to append after what the earlier draws read, and only discarded, to
+/// 	get a fresh one from the driver, when the ring is full. The index buffer never changes:
+/// 	it makes two triangles of every four vertices, and each draw starts it at the first
+/// 	vertex of its quads.
+///
+/// 	The sprites are in pixels from the top left corner of the screen, the world matrix of
+/// 	the draws moves them into the orthographic space, y up and centred on the screen.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class SpriteRendererClass : public SpriteTargetClass
+{
+public:
+	SpriteRendererClass();
+	SpriteRendererClass(const SpriteRendererClass&);
+	~SpriteRendererClass();
+
+	bool Initialize(ID3D11Device*, ResidencyManagerClass*, int = SPRITE_RING_QUADS);
+	void Shutdown();
+
+	bool Render(ID3D11DeviceContext*, SpriteBatchClass*, ColorShaderClass*, D3DXMATRIX, int, int);
+
+	int GetCapacity();
+	SpriteVertex* Map(bool);
+	void Unmap();
+	bool Draw(const void*, int, int);
+
+private:
+	ID3D11Buffer* m_vertexBuffer;
+	ID3D11Buffer* m_indexBuffer;
+	ResidencyManagerClass* m_residencyManager;
+	int m_vertexHandle;
+	int m_indexHandle;
+	int m_quadCount;
+	ID3D11DeviceContext* m_deviceContext;
+	ColorShaderClass* m_shader;
+	D3DXMATRIX m_worldMatrix;
+	D3DXMATRIX m_viewMatrix;
+	D3DXMATRIX m_orthoMatrix;
+};
+
+#endif
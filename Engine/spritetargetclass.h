@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	spritetargetclass.h
+//
+// summary:	Declares the spritetargetclass interface
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _SPRITETARGETCLASS_H_
+#define _SPRITETARGETCLASS_H_
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> A corner of a sprite, laid out as the vertices of the color shader. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct SpriteVertex
+{
+	float x;
+	float y;
+	float z;
+	float r;
+	float g;
+	float b;
+	float a;
+	float u;
+	float v;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Implemented by whatever the sprite batch draws into: a vertex buffer used as a ring of
+/// 	quads, four vertices each, with an index buffer that makes every four vertices two
+/// 	triangles. The batch keeps where it is in the ring, so it doesn't know the device and
+/// 	can be measured with no GPU behind it.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class SpriteTargetClass
+{
+public:
+	virtual ~SpriteTargetClass() {}
+
+	// Get the number of quads the ring holds, and the most a single draw can take.
+	virtual int GetCapacity() = 0;
+
+	// Map the ring to write quads into it. With discard, whatever it held is thrown away and
+	// it is written again from the start. Without, the quads written since are still being
+	// drawn and must be left alone. Returns null if it fails.
+	virtual SpriteVertex* Map(bool) = 0;
+	virtual void Unmap() = 0;
+
+	// Draw a number of quads from a vertex of the ring with a texture.
+	virtual bool Draw(const void*, int, int) = 0;
+};
+
+#endif
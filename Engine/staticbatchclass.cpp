@@ -0,0 +1,498 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	staticbatchclass.cpp
+//
+// summary:	Implements the staticbatchclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "staticbatchclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+StaticBatchClass::StaticBatchClass()
+{
+	m_geometryPool = 0;
+	m_cellSize = 0.0f;
+	m_maxChunkVertices = 0;
+	memset(&m_stats, 0, sizeof(StaticBatchStats));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+StaticBatchClass::StaticBatchClass(const StaticBatchClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+StaticBatchClass::~StaticBatchClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets up an empty batch. </summary>
+///
+/// <param name="geometryPool">		The pool the chunks are stored in. </param>
+/// <param name="cellSize">			The size of a grid cell in world units. </param>
+/// <param name="maxChunkVertices"> The most vertices a chunk may have. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StaticBatchClass::Initialize(GeometryPoolClass* geometryPool, float cellSize, unsigned int maxChunkVertices)
+{
+	if(!geometryPool || cellSize <= 0.0f || maxChunkVertices == 0)
+	{
+		return false;
+	}
+
+	m_geometryPool = geometryPool;
+	m_cellSize = cellSize;
+	m_maxChunkVertices = maxChunkVertices;
+
+	memset(&m_stats, 0, sizeof(StaticBatchStats));
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives the chunks back to the geometry pool. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void StaticBatchClass::Shutdown()
+{
+	unsigned int i;
+
+	if(m_geometryPool)
+	{
+		for(i=0; i<m_chunks.size(); i++)
+		{
+			m_geometryPool->Free(m_chunks[i].geometryHandle);
+		}
+	}
+
+	m_instances.clear();
+	m_chunks.clear();
+	m_visibleChunks.clear();
+	m_visibleHandles.clear();
+	m_mergedDraws.clear();
+	m_visibleDraws.clear();
+	m_geometryPool = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a static instance of a model to be merged by the next Build. </summary>
+///
+/// <param name="model">    The model. Its geometry must start every vertex with the position. </param>
+/// <param name="world">    The world matrix of the instance. </param>
+/// <param name="shaderId"> The shader that draws it, only instances with the same shader and texture are merged. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StaticBatchClass::AddInstance(ModelClass* model, const D3DXMATRIX& world, int shaderId)
+{
+	InstanceType instance;
+	bool result;
+
+	if(!model || model->GetVertexCount() <= 0 || model->GetIndexCount() <= 0)
+	{
+		return false;
+	}
+
+	instance.model = model;
+	instance.world = world;
+	instance.shaderId = shaderId;
+	instance.texture = model->GetTexture();
+	instance.stride = model->GetVertexStride();
+
+	// Find the cell the instance falls in.
+	result = ComputeCell(instance);
+	if(!result)
+	{
+		return false;
+	}
+
+	m_instances.push_back(instance);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Merges every instance added so far into chunks. The instances are sorted so those that
+/// 	can share a chunk (same shader, texture, stride and cell) are next to each other, then
+/// 	each run is transformed and appended into one vertex and index array that is flushed
+/// 	into the geometry pool when the run ends or the chunk is full.
+/// </summary>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StaticBatchClass::Build()
+{
+	vector<char> vertices;
+	vector<unsigned long> indices;
+	vector<ModelClass*> models;
+	D3DXVECTOR3 minimum, maximum, position;
+	InstanceType* instance;
+	InstanceType* first;
+	unsigned int i, j, vertexStart, indexStart, vertexCount, indexCount;
+	unsigned long swap;
+	bool result, flip;
+
+	if(!m_geometryPool)
+	{
+		return false;
+	}
+
+	// Put the instances that can be merged next to each other.
+	sort(m_instances.begin(), m_instances.end(), CompareInstances);
+
+	first = 0;
+	for(i=0; i<m_instances.size(); i++)
+	{
+		instance = &m_instances[i];
+		vertexCount = (unsigned int)instance->model->GetVertexCount();
+		indexCount = (unsigned int)instance->model->GetIndexCount();
+
+		// Close the current chunk when the group changes or it would go over the vertex limit.
+		if(first && (CompareInstances(*first, *instance) || vertices.size() / first->stride + vertexCount > m_maxChunkVertices))
+		{
+			result = FlushChunk(vertices, indices, first->stride, first->shaderId, first->texture, minimum, maximum);
+			if(!result)
+			{
+				return false;
+			}
+			first = 0;
+		}
+
+		if(!first)
+		{
+			first = instance;
+			minimum = D3DXVECTOR3(FLT_MAX, FLT_MAX, FLT_MAX);
+			maximum = D3DXVECTOR3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		}
+
+		// Append the geometry of the instance.
+		vertexStart = (unsigned int)(vertices.size() / instance->stride);
+		indexStart = (unsigned int)indices.size();
+		vertices.resize(vertices.size() + vertexCount * instance->stride);
+		indices.resize(indices.size() + indexCount);
+		instance->model->CopyGeometry(&vertices[vertexStart * instance->stride], &indices[indexStart]);
+
+		// Move the positions to world space and grow the chunk bounds.
+		for(j=0; j<vertexCount; j++)
+		{
+			memcpy(&position, &vertices[(vertexStart + j) * instance->stride], sizeof(D3DXVECTOR3));
+			D3DXVec3TransformCoord(&position, &position, &instance->world);
+			memcpy(&vertices[(vertexStart + j) * instance->stride], &position, sizeof(D3DXVECTOR3));
+
+			minimum.x = position.x < minimum.x ? position.x : minimum.x;
+			minimum.y = position.y < minimum.y ? position.y : minimum.y;
+			minimum.z = position.z < minimum.z ? position.z : minimum.z;
+			maximum.x = position.x > maximum.x ? position.x : maximum.x;
+			maximum.y = position.y > maximum.y ? position.y : maximum.y;
+			maximum.z = position.z > maximum.z ? position.z : maximum.z;
+		}
+
+		// A mirroring world matrix turns the triangles around, so swap the winding back.
+		flip = D3DXMatrixDeterminant(&instance->world) < 0.0f;
+
+		// Point the indices at the vertices of this instance inside the chunk.
+		for(j=0; j<indexCount; j++)
+		{
+			indices[indexStart + j] += vertexStart;
+		}
+		if(flip)
+		{
+			for(j=0; j+2<indexCount; j+=3)
+			{
+				swap = indices[indexStart + j + 1];
+				indices[indexStart + j + 1] = indices[indexStart + j + 2];
+				indices[indexStart + j + 2] = swap;
+			}
+		}
+
+		// Remember the distinct models, to know what the geometry cost without batching.
+		if(find(models.begin(), models.end(), instance->model) == models.end())
+		{
+			models.push_back(instance->model);
+			m_stats.sourceBytes += (unsigned long long)vertexCount * instance->stride + (unsigned long long)indexCount * sizeof(unsigned long);
+		}
+	}
+
+	// Close the last chunk.
+	if(first)
+	{
+		result = FlushChunk(vertices, indices, first->stride, first->shaderId, first->texture, minimum, maximum);
+		if(!result)
+		{
+			return false;
+		}
+	}
+
+	m_stats.instances += (int)m_instances.size();
+	m_stats.drawsBefore += (int)m_instances.size();
+	m_stats.chunks = (int)m_chunks.size();
+	m_stats.duplicatedBytes = m_stats.batchedBytes > m_stats.sourceBytes ? m_stats.batchedBytes - m_stats.sourceBytes : 0;
+
+	// The instances are merged, they are not needed anymore.
+	m_instances.clear();
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Finds the chunks whose bounds are inside the frustum, and not hidden behind the occluders
+/// 	if there is an occlusion culler. Visible chunks drawn alike that follow each other in
+/// 	their page are then merged into a single draw by the geometry pool.
+/// </summary>
+///
+/// <param name="frustum">   The frustum of the current frame. </param>
+/// <param name="occlusion"> The occlusion culler with the occluders of the frame, or 0. </param>
+///
+/// <returns> The number of visible draws. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int StaticBatchClass::Cull(FrustumClass* frustum, OcclusionCullerClass* occlusion)
+{
+	SceneBounds bounds;
+	ChunkType* chunk;
+	DrawType draw;
+	unsigned int i, last;
+	int j, mergedCount;
+
+	m_visibleChunks.clear();
+	for(i=0; i<m_chunks.size(); i++)
+	{
+		if(frustum && !frustum->CheckBox(m_chunks[i].minimum, m_chunks[i].maximum))
+		{
+			continue;
+		}
+
+		if(occlusion)
+		{
+			bounds.center.x = (m_chunks[i].minimum.x + m_chunks[i].maximum.x) * 0.5f;
+			bounds.center.y = (m_chunks[i].minimum.y + m_chunks[i].maximum.y) * 0.5f;
+			bounds.center.z = (m_chunks[i].minimum.z + m_chunks[i].maximum.z) * 0.5f;
+			bounds.center.w = 0.0f;
+			bounds.extents.x = (m_chunks[i].maximum.x - m_chunks[i].minimum.x) * 0.5f;
+			bounds.extents.y = (m_chunks[i].maximum.y - m_chunks[i].minimum.y) * 0.5f;
+			bounds.extents.z = (m_chunks[i].maximum.z - m_chunks[i].minimum.z) * 0.5f;
+			bounds.extents.w = 0.0f;
+			if(!occlusion->TestBox(bounds))
+			{
+				continue;
+			}
+		}
+
+		m_visibleChunks.push_back((int)i);
+	}
+
+	m_stats.visibleChunks = (int)m_visibleChunks.size();
+
+	// The chunks were built sorted by shader and texture, so each run of them is merged on its own.
+	m_visibleDraws.clear();
+	for(i=0; i<m_visibleChunks.size(); i=last)
+	{
+		chunk = &m_chunks[m_visibleChunks[i]];
+
+		m_visibleHandles.clear();
+		for(last=i; last<m_visibleChunks.size(); last++)
+		{
+			if(m_chunks[m_visibleChunks[last]].shaderId != chunk->shaderId || m_chunks[m_visibleChunks[last]].texture != chunk->texture)
+			{
+				break;
+			}
+
+			m_visibleHandles.push_back(m_chunks[m_visibleChunks[last]].geometryHandle);
+		}
+
+		m_mergedDraws.resize(m_visibleHandles.size());
+		mergedCount = m_geometryPool->BuildDrawList(&m_visibleHandles[0], (int)m_visibleHandles.size(), &m_mergedDraws[0]);
+
+		draw.shaderId = chunk->shaderId;
+		draw.texture = chunk->texture;
+		for(j=0; j<mergedCount; j++)
+		{
+			draw.geometry = m_mergedDraws[j];
+			m_visibleDraws.push_back(draw);
+		}
+	}
+
+	m_stats.visibleDraws = (int)m_visibleDraws.size();
+
+	return m_stats.visibleDraws;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets a draw of the chunks that passed the last Cull. The geometry is in world space, so
+/// 	it is drawn with an identity world matrix.
+/// </summary>
+///
+/// <param name="index">    The index of the draw, from 0 to the value Cull returned. </param>
+/// <param name="draw">	    [out] The draw arguments. </param>
+/// <param name="shaderId"> [out] The shader that draws it. </param>
+/// <param name="texture">  [out] The texture it is drawn with. </param>
+///
+/// <returns> true if it succeeds, false if the index is not valid. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StaticBatchClass::GetVisibleDraw(int index, GeometryDraw& draw, int& shaderId, TextureClass*& texture)
+{
+	if(index < 0 || index >= (int)m_visibleDraws.size())
+	{
+		return false;
+	}
+
+	draw = m_visibleDraws[index].geometry;
+	shaderId = m_visibleDraws[index].shaderId;
+	texture = m_visibleDraws[index].texture;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of chunks. </summary>
+///
+/// <returns> The number of chunks. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int StaticBatchClass::GetChunkCount()
+{
+	return (int)m_chunks.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the draw call savings and the memory cost of the batching. </summary>
+///
+/// <param name="stats"> [out] The statistics. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void StaticBatchClass::GetStats(StaticBatchStats& stats)
+{
+	stats = m_stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Finds the grid cell of an instance from the center of its world space bounds. The
+/// 	bounds are those of the model's vertices transformed by the world matrix, read where the
+/// 	model keeps them, so a model of any size is measured without a copy.
+/// </summary>
+///
+/// <param name="instance"> [in,out] The instance. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StaticBatchClass::ComputeCell(InstanceType& instance)
+{
+	D3DXVECTOR3 minimum, maximum, position;
+	const char* positions;
+	int i, stride;
+
+	positions = (const char*)instance.model->GetPositions();
+	stride = instance.model->GetVertexStride();
+	if(!positions || instance.model->GetVertexCount() <= 0)
+	{
+		return false;
+	}
+
+	minimum = D3DXVECTOR3(FLT_MAX, FLT_MAX, FLT_MAX);
+	maximum = D3DXVECTOR3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for(i=0; i<instance.model->GetVertexCount(); i++)
+	{
+		memcpy(&position, positions + i * stride, sizeof(D3DXVECTOR3));
+		D3DXVec3TransformCoord(&position, &position, &instance.world);
+
+		minimum.x = position.x < minimum.x ? position.x : minimum.x;
+		minimum.y = position.y < minimum.y ? position.y : minimum.y;
+		minimum.z = position.z < minimum.z ? position.z : minimum.z;
+		maximum.x = position.x > maximum.x ? position.x : maximum.x;
+		maximum.y = position.y > maximum.y ? position.y : maximum.y;
+		maximum.z = position.z > maximum.z ? position.z : maximum.z;
+	}
+
+	instance.cellX = (int)floorf((minimum.x + maximum.x) * 0.5f / m_cellSize);
+	instance.cellY = (int)floorf((minimum.y + maximum.y) * 0.5f / m_cellSize);
+	instance.cellZ = (int)floorf((minimum.z + maximum.z) * 0.5f / m_cellSize);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies the merged arrays into the geometry pool as a new chunk and empties them. </summary>
+///
+/// <param name="vertices"> [in,out] The merged vertices. </param>
+/// <param name="indices">  [in,out] The merged indices. </param>
+/// <param name="stride">   The size of one vertex in bytes. </param>
+/// <param name="shaderId"> The shader that draws the chunk. </param>
+/// <param name="texture">  The texture the chunk is drawn with. </param>
+/// <param name="minimum">  The minimum corner of the chunk bounds. </param>
+/// <param name="maximum">  The maximum corner of the chunk bounds. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StaticBatchClass::FlushChunk(vector<char>& vertices, vector<unsigned long>& indices, int stride, int shaderId, TextureClass* texture, const D3DXVECTOR3& minimum, const D3DXVECTOR3& maximum)
+{
+	ChunkType chunk;
+
+	chunk.geometryHandle = m_geometryPool->Allocate(&vertices[0], (unsigned int)(vertices.size() / stride), stride, &indices[0], (unsigned int)indices.size());
+	if(chunk.geometryHandle < 0)
+	{
+		return false;
+	}
+
+	chunk.shaderId = shaderId;
+	chunk.texture = texture;
+	chunk.minimum = minimum;
+	chunk.maximum = maximum;
+	m_chunks.push_back(chunk);
+
+	m_stats.batchedBytes += (unsigned long long)vertices.size() + (unsigned long long)indices.size() * sizeof(unsigned long);
+
+	vertices.clear();
+	indices.clear();
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Orders instances by shader, texture, stride and then cell. </summary>
+///
+/// <param name="a"> The first instance. </param>
+/// <param name="b"> The second instance. </param>
+///
+/// <returns> true if a goes before b. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StaticBatchClass::CompareInstances(const InstanceType& a, const InstanceType& b)
+{
+	if(a.shaderId != b.shaderId)
+	{
+		return a.shaderId < b.shaderId;
+	}
+	if(a.texture != b.texture)
+	{
+		return a.texture < b.texture;
+	}
+	if(a.stride != b.stride)
+	{
+		return a.stride < b.stride;
+	}
+	if(a.cellX != b.cellX)
+	{
+		return a.cellX < b.cellX;
+	}
+	if(a.cellY != b.cellY)
+	{
+		return a.cellY < b.cellY;
+	}
+
+	return a.cellZ < b.cellZ;
+}
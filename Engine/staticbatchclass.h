@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	staticbatchclass.h
+//
+// summary:	Declares the staticbatchclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _STATICBATCHCLASS_H_
+#define _STATICBATCHCLASS_H_
+
+// DirectX Includes.
+#include <d3dx10math.h>
+
+// System Includes.
+#include <vector>
+
+// Includes.
+#include "modelclass.h"
+#include "geometrypoolclass.h"
+#include "frustumclass.h"
+#include "occlusioncullerclass.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	What the batching saved and what it cost. Without batching every instance is one draw
+/// 	and the geometry of each distinct model is stored once; with batching there is one draw
+/// 	per chunk but the geometry is stored again for every instance, already in world space.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct StaticBatchStats
+{
+	int instances;
+	int drawsBefore;
+	int chunks;
+	int visibleChunks;
+	int visibleDraws;
+	unsigned long long sourceBytes;
+	unsigned long long batchedBytes;
+	unsigned long long duplicatedBytes;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Merges the scenery that never moves into a few large meshes at load time. Instances are
+/// 	added with their world matrix and the shader that draws them, then Build groups the ones
+/// 	sharing a shader, texture and vertex stride by the grid cell their bounds are centered
+/// 	in. Each group is transformed to world space and copied into the geometry pool as one
+/// 	chunk (or several, if it would go over the vertex limit), so a whole cell draws with one
+/// 	call and is still culled as a unit by its bounds.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class StaticBatchClass
+{
+private:
+	struct InstanceType
+	{
+		ModelClass* model;
+		D3DXMATRIX world;
+		int shaderId;
+		TextureClass* texture;
+		int stride;
+		int cellX;
+		int cellY;
+		int cellZ;
+	};
+
+	struct ChunkType
+	{
+		int geometryHandle;
+		int shaderId;
+		TextureClass* texture;
+		D3DXVECTOR3 minimum;
+		D3DXVECTOR3 maximum;
+	};
+
+	struct DrawType
+	{
+		GeometryDraw geometry;
+		int shaderId;
+		TextureClass* texture;
+	};
+
+public:
+	StaticBatchClass();
+	StaticBatchClass(const StaticBatchClass&);
+	~StaticBatchClass();
+
+	bool Initialize(GeometryPoolClass*, float, unsigned int);
+	void Shutdown();
+
+	bool AddInstance(ModelClass*, const D3DXMATRIX&, int);
+	bool Build();
+
+	int Cull(FrustumClass*, OcclusionCullerClass* = 0);
+	bool GetVisibleDraw(int, GeometryDraw&, int&, TextureClass*&);
+	int GetChunkCount();
+
+	void GetStats(StaticBatchStats&);
+
+private:
+	bool ComputeCell(InstanceType&);
+	bool FlushChunk(vector<char>&, vector<unsigned long>&, int, int, TextureClass*, const D3DXVECTOR3&, const D3DXVECTOR3&);
+	static bool CompareInstances(const InstanceType&, const InstanceType&);
+
+private:
+	GeometryPoolClass* m_geometryPool;
+	float m_cellSize;
+	unsigned int m_maxChunkVertices;
+	vector<InstanceType> m_instances;
+	vector<ChunkType> m_chunks;
+	vector<int> m_visibleChunks;
+	vector<int> m_visibleHandles;
+	vector<GeometryDraw> m_mergedDraws;
+	vector<DrawType> m_visibleDraws;
+	StaticBatchStats m_stats;
+};
+
+#endif
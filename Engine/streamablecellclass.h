@@ -0,0 +1,32 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	streamablecellclass.h
+//
+// summary:	Declares the streamablecellclass interface
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _STREAMABLECELLCLASS_H_
+#define _STREAMABLECELLCLASS_H_
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Implemented by whatever owns the contents of the world cells. The world streamer only
+/// 	decides which cells should be in memory and calls these functions, so it doesn't know
+/// 	what a cell holds and can be driven by a simulated disk with no assets behind it.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class StreamableCellClass
+{
+public:
+	virtual ~StreamableCellClass() {}
+
+	// The memory a cell takes once loaded, known before it is loaded (from the world layout).
+	virtual unsigned long long GetCellSize(int) = 0;
+
+	// Start loading a cell, returns false if it could not be started. When the load is over the
+	// owner calls WorldStreamerClass::CellLoaded, on the frame thread.
+	virtual bool LoadCell(int) = 0;
+
+	// Release the memory of a loaded cell.
+	virtual void UnloadCell(int) = 0;
+};
+
+#endif
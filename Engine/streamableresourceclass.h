@@ -0,0 +1,29 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	streamableresourceclass.h
+//
+// summary:	Declares the streamableresourceclass interface
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _STREAMABLERESOURCECLASS_H_
+#define _STREAMABLERESOURCECLASS_H_
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Implemented by the owners of GPU resources that can be thrown away and created again
+/// 	later, like textures that can be read back from disk. The residency manager never talks
+/// 	to the device itself, it only calls these two functions, which is also what lets it be
+/// 	driven by a fake device with no Direct3D behind it.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class StreamableResourceClass
+{
+public:
+	virtual ~StreamableResourceClass() {}
+
+	// Release the GPU memory of the resource, keeping enough information to restore it.
+	virtual void Evict(int) = 0;
+
+	// Create the GPU resource again, returns false if it could not be done.
+	virtual bool Restore(int) = 0;
+};
+
+#endif
@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	streamingtestclass.cpp
+//
+// summary:	Implements the streamingtestclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "streamingtestclass.h"
+
+// System Includes.
+#include <cmath>
+
+// Includes.
+#include "profilerclass.h"
+#include "logclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+StreamingTestClass::StreamingTestClass()
+{
+	m_time = 0.0;
+	m_diskFree = 0.0;
+	m_angle = 0.0f;
+	m_usedBytes = 0;
+	m_peakUsedBytes = 0;
+	m_mistakes = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+StreamingTestClass::StreamingTestClass(const StreamingTestClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+StreamingTestClass::~StreamingTestClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Lays out the world. </summary>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StreamingTestClass::Initialize()
+{
+	m_loaded.assign(STREAM_TEST_CELLS * STREAM_TEST_CELLS, false);
+	m_time = 0.0;
+	m_diskFree = 0.0;
+	m_angle = 0.0f;
+	m_usedBytes = 0;
+	m_peakUsedBytes = 0;
+	m_mistakes = 0;
+
+	return m_Streamer.Initialize(this, STREAM_TEST_CELLS, STREAM_TEST_CELLS, STREAM_TEST_CELL_SIZE, STREAM_TEST_BUDGET);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Stops the streaming and logs the report. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void StreamingTestClass::Shutdown()
+{
+	WorldStreamerStats stats;
+
+	m_Streamer.GetStats(stats);
+	m_Streamer.Shutdown();
+
+	// The loads still on the disk are dropped.
+	while(!m_loads.empty())
+	{
+		m_usedBytes -= GetCellSize(m_loads.front().cell);
+		m_loads.pop_front();
+	}
+
+	LOG_INFO(LOG_CATEGORY_RESOURCE, "Streaming test: %lu frames, %lu stalled (the longest for %lu), %lu waited on the budget.", stats.frames, stats.stallFrames, stats.longestStall, stats.budgetLimitedFrames);
+	LOG_INFO(LOG_CATEGORY_RESOURCE, "Streaming test: peak %.1f MB of a %.1f MB budget, %lu loads, %lu unloads, %lu evictions.", m_peakUsedBytes / (1024.0 * 1024.0), stats.budget / (1024.0 * 1024.0), stats.loads, stats.unloads, stats.evictions);
+
+	if(m_peakUsedBytes > stats.budget || m_usedBytes != 0 || m_mistakes > 0)
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Streaming test: the budget or the cell states were broken (%llu bytes left, %lu bad calls).", m_usedBytes, m_mistakes);
+	}
+
+	m_loaded.clear();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finishes the loads that are done, moves the camera one step and streams. </summary>
+///
+/// <param name="deltaSeconds"> The seconds the frame clock moved this frame. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void StreamingTestClass::Frame(double deltaSeconds)
+{
+	float speed, radius, x, z;
+	int cell;
+
+	PROFILE_FUNCTION();
+
+	m_time += deltaSeconds;
+
+	// Hand over the loads the disk is done with.
+	while(!m_loads.empty() && m_loads.front().finish <= m_time)
+	{
+		cell = m_loads.front().cell;
+		m_loads.pop_front();
+
+		m_loaded[cell] = true;
+		m_Streamer.CellLoaded(cell, true);
+	}
+
+	// Go round the loop, the radius waves so the camera turns both ways.
+	speed = STREAM_TEST_MIN_SPEED + (STREAM_TEST_MAX_SPEED - STREAM_TEST_MIN_SPEED) * 0.5f * (1.0f - cosf((float)m_time * 6.2831853f / STREAM_TEST_SPEED_PERIOD));
+	radius = STREAM_TEST_PATH_RADIUS * (0.75f + 0.25f * sinf(m_angle * 3.0f));
+	m_angle += speed * (float)deltaSeconds / radius;
+
+	x = STREAM_TEST_CELLS * STREAM_TEST_CELL_SIZE * 0.5f + radius * cosf(m_angle);
+	z = STREAM_TEST_CELLS * STREAM_TEST_CELL_SIZE * 0.5f + radius * sinf(m_angle);
+
+	m_Streamer.Update(x, z, (float)deltaSeconds);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the size of a cell, made up from its index. </summary>
+///
+/// <param name="cell"> The index of the cell. </param>
+///
+/// <returns> The size in bytes. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned long long StreamingTestClass::GetCellSize(int cell)
+{
+	unsigned int hash;
+
+	hash = (unsigned int)cell * 2654435761u;
+	hash ^= hash >> 15;
+
+	return STREAM_TEST_MIN_CELL_SIZE + hash % (STREAM_TEST_MAX_CELL_SIZE - STREAM_TEST_MIN_CELL_SIZE + 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Queues a cell on the disk, behind the loads already on it. </summary>
+///
+/// <param name="cell"> The index of the cell. </param>
+///
+/// <returns> true. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool StreamingTestClass::LoadCell(int cell)
+{
+	LoadType load;
+	unsigned long long size;
+
+	if(m_loaded[cell])
+	{
+		m_mistakes++;
+	}
+
+	size = GetCellSize(cell);
+
+	load.cell = cell;
+	load.finish = (m_diskFree > m_time ? m_diskFree : m_time) + STREAM_TEST_SEEK_SECONDS + size / STREAM_TEST_BYTES_PER_SECOND;
+	m_diskFree = load.finish;
+	m_loads.push_back(load);
+
+	// The memory is taken when the read starts.
+	m_usedBytes += size;
+	if(m_usedBytes > m_peakUsedBytes)
+	{
+		m_peakUsedBytes = m_usedBytes;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases a cell. </summary>
+///
+/// <param name="cell"> The index of the cell. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void StreamingTestClass::UnloadCell(int cell)
+{
+	if(!m_loaded[cell])
+	{
+		m_mistakes++;
+		return;
+	}
+
+	m_loaded[cell] = false;
+	m_usedBytes -= GetCellSize(cell);
+
+	return;
+}
@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	streamingtestclass.h
+//
+// summary:	Declares the streamingtestclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _STREAMINGTESTCLASS_H_
+#define _STREAMINGTESTCLASS_H_
+
+// System Includes.
+#include <deque>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "worldstreamerclass.h"
+
+// Globals.
+const int STREAM_TEST_CELLS = 64;
+const float STREAM_TEST_CELL_SIZE = 64.0f;
+const unsigned long long STREAM_TEST_BUDGET = 384 * 1024 * 1024;
+const unsigned long long STREAM_TEST_MIN_CELL_SIZE = 1024 * 1024;
+const unsigned long long STREAM_TEST_MAX_CELL_SIZE = 6 * 1024 * 1024;
+const double STREAM_TEST_SEEK_SECONDS = 0.005;
+const double STREAM_TEST_BYTES_PER_SECOND = 200.0 * 1024 * 1024;
+const float STREAM_TEST_PATH_RADIUS = 1200.0f;
+const float STREAM_TEST_MIN_SPEED = 10.0f;
+const float STREAM_TEST_MAX_SPEED = 150.0f;
+const float STREAM_TEST_SPEED_PERIOD = 12.0f;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Runs the world streamer on a made up world, for "-streamtest", so the streaming can be
+/// 	measured on the headless machines. The cells hold nothing and take a size of 1 to 6 MB;
+/// 	a load takes a seek and the read of its size on a single simulated disk, one load after
+/// 	the other. The camera goes round a wavy loop, speeding up and slowing down.
+///
+/// 	It steps by the frame clock, which the system locks to a fixed step, so every run streams the same. Shutdown
+/// 	logs the stalls, the peak memory and how much was loaded and evicted.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class StreamingTestClass : public StreamableCellClass
+{
+private:
+	struct LoadType
+	{
+		int cell;
+		double finish;
+	};
+
+public:
+	StreamingTestClass();
+	StreamingTestClass(const StreamingTestClass&);
+	~StreamingTestClass();
+
+	bool Initialize();
+	void Shutdown();
+	void Frame(double);
+
+	unsigned long long GetCellSize(int);
+	bool LoadCell(int);
+	void UnloadCell(int);
+
+private:
+	WorldStreamerClass m_Streamer;
+	deque<LoadType> m_loads;
+	vector<bool> m_loaded;
+	double m_time;
+	double m_diskFree;
+	float m_angle;
+	unsigned long long m_usedBytes;
+	unsigned long long m_peakUsedBytes;
+	unsigned long m_mistakes;
+};
+
+#endif
@@ -5,6 +5,48 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 #include "systemclass.h"
 
+// System Includes.
+#include <cstdlib>
+#include <cstring>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds a switch on the command line and copies the word after it. </summary>
+///
+/// <param name="commandLine"> The command line, may be null. </param>
+/// <param name="name">		   The switch. </param>
+/// <param name="value">	   [out] The word after the switch. </param>
+/// <param name="size">		   The size of value. </param>
+///
+/// <returns> true if the switch was found with a value, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool GetCommandLineValue(const char* commandLine, const char* name, char* value, int size)
+{
+	const char* found;
+	int length;
+
+	found = commandLine ? strstr(commandLine, name) : 0;
+	if(!found)
+	{
+		return false;
+	}
+
+	found += strlen(name);
+	while(*found == ' ')
+	{
+		found++;
+	}
+
+	length = 0;
+	while(found[length] && found[length] != ' ' && length < size - 1)
+	{
+		value[length] = found[length];
+		length++;
+	}
+	value[length] = 0;
+
+	return length > 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// <summary> Default constructor. </summary>
 ///
@@ -12,8 +54,16 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 SystemClass::SystemClass()
 {
+	m_Platform = 0;
 	m_Input = 0;
 	m_Graphics = 0;
+	m_FrameStats = 0;
+	m_Clock = 0;
+	m_InputRecorder = 0;
+	m_FileSystem = 0;
+	m_StreamingTest = 0;
+	m_VirtualTextureTest = 0;
+	m_startTimestamp = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -48,25 +98,108 @@ SystemClass::~SystemClass()
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// <summary>
 /// 	This function is responsible for all the application setup. First it calls
-/// 	InitializeWindows which will create the window for our application to use. Then creates
+/// 	the platform which will create the window for our application to use. Then creates
 /// 	and initializes both the input and graphics objects.
 /// </summary>
 ///
 /// <remarks> Filipe, 25 Nov 2012. </remarks>
 ///
+/// <param name="commandLine">
+/// 	The command line, "-record file" or "-replay file" to record or replay the input,
+/// 	"-headless" to run without a window and "-frames count" for how long it runs, and
+/// 	"-streamtest" to stream a made up world around a simulated camera.
+/// </param>
+///
 /// <returns> true if it succeeds, false if it fails. </returns>
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-bool SystemClass::Initialize()
+bool SystemClass::Initialize(const char* commandLine)
 {
+	HeadlessPlatformClass* headless;
+	char filename[COMMAND_LINE_VALUE_SIZE], frames[COMMAND_LINE_VALUE_SIZE];
 	int screenWidth, screenHeight;
-	bool result;
+	bool fullScreen, result;
 
 	// Initialize the width and height of the screen to zero before sending the variables into the function.
 	screenWidth = 0;
 	screenHeight = 0;
 
-	// Initialize the windows api.
-	InitializeWindows(screenWidth, screenHeight);
+	// Start the profiler first so the rest of the startup can be measured.
+	result = ProfilerClass::Initialize();
+	if(!result)
+	{
+		return false;
+	}
+
+	// The time to the first frame is measured from here.
+	m_startTimestamp = ProfilerClass::GetTimestamp();
+
+	// Start the logger, its writer thread keeps file writes out of the frame.
+	result = LogClass::Initialize();
+	if(!result)
+	{
+		return false;
+	}
+
+	LOG_INFO(LOG_CATEGORY_SYSTEM, "Logging costs %.1f ns per record.", LogClass::Benchmark(LOG_BENCHMARK_RECORDS));
+
+	// Create the frame stats object. It keeps the recent frame times and dumps the frames that hitch.
+	m_FrameStats = new FrameStatsClass;
+	if(!m_FrameStats)
+	{
+		return false;
+	}
+
+	// Initialize the frame stats object.
+	result = m_FrameStats->Initialize();
+	if(!result)
+	{
+		return false;
+	}
+
+	// Create the platform object. It owns the window and turns the os messages into events.
+	fullScreen = false;
+#ifdef _WIN32
+	if(!(commandLine && strstr(commandLine, HEADLESS_SWITCH)))
+	{
+		m_Platform = new Win32PlatformClass;
+		fullScreen = FULL_SCREEN;
+	}
+	else
+#endif
+	{
+		headless = new HeadlessPlatformClass;
+		if(headless && GetCommandLineValue(commandLine, HEADLESS_FRAMES_SWITCH, frames, COMMAND_LINE_VALUE_SIZE))
+		{
+			headless->SetFrameLimit((unsigned int)atoi(frames));
+		}
+		m_Platform = headless;
+	}
+	if(!m_Platform)
+	{
+		return false;
+	}
+
+	// Initialize the platform object, which opens the window.
+	result = m_Platform->Initialize(fullScreen, screenWidth, screenHeight);
+	if(!result)
+	{
+		LOG_ERROR(LOG_CATEGORY_SYSTEM, "Could not create the window.");
+		return false;
+	}
+
+	// Create the scratch stack of the main thread, used for temporary arrays during loading and rendering.
+	result = ScratchAllocatorClass::InitializeThread();
+	if(!result)
+	{
+		return false;
+	}
+
+	// Start the worker threads, every task graph from the loading to the frame update shares them.
+	result = TaskGraphClass::InitializeWorkers();
+	if(!result)
+	{
+		return false;
+	}
 
 	// Create the input object. This object will be used to handle reading the keyboard input from the user.
 	m_Input = new InputClass;
@@ -78,19 +211,122 @@ bool SystemClass::Initialize()
 	// Initialize the input object.
 	m_Input->Initialize();
 
-	// Create the graphics object. This object will handle rendering all the graphics for this application.
-	m_Graphics = new GraphicsClass;
-	if(!m_Graphics)
+	// Create the input recorder object. It saves the input of a run, or plays one back in place of the window messages.
+	m_InputRecorder = new InputRecorderClass;
+	if(!m_InputRecorder)
 	{
 		return false;
 	}
 
-	// Initialize the graphics object.
-	result = m_Graphics->Initialize(screenWidth, screenHeight, m_hwnd);
+	// Initialize the input recorder object from the command line.
+	if(GetCommandLineValue(commandLine, INPUT_REPLAY_SWITCH, filename, COMMAND_LINE_VALUE_SIZE))
+	{
+		result = m_InputRecorder->Initialize(INPUT_RECORDER_REPLAY, filename, FRAME_CLOCK_FIXED_STEP);
+	}
+	else if(GetCommandLineValue(commandLine, INPUT_RECORD_SWITCH, filename, COMMAND_LINE_VALUE_SIZE))
+	{
+		result = m_InputRecorder->Initialize(INPUT_RECORDER_RECORD, filename, FRAME_CLOCK_FIXED_STEP);
+	}
+	else
+	{
+		result = m_InputRecorder->Initialize(INPUT_RECORDER_OFF, 0, 0.0);
+	}
 	if(!result)
 	{
 		return false;
 	}
+
+	// Create the frame clock object. Recording and replaying lock it to a fixed step, so both runs simulate the same frames.
+	m_Clock = new FrameClockClass;
+	if(!m_Clock)
+	{
+		return false;
+	}
+
+	// Initialize the frame clock object.
+	m_Clock->Initialize(m_InputRecorder->GetFixedStep());
+
+	// Create the file system object, the assets are found through it.
+	m_FileSystem = new FileSystemClass;
+	if(!m_FileSystem)
+	{
+		return false;
+	}
+
+	// Mount the asset pack, then the asset directory for the files the pack doesn't have. A pack asked for on the command line must be there.
+	if(GetCommandLineValue(commandLine, PACK_SWITCH, filename, COMMAND_LINE_VALUE_SIZE))
+	{
+		result = m_FileSystem->MountPack(filename);
+		if(!result)
+		{
+			LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not mount the pack %s.", filename);
+			return false;
+		}
+	}
+	else if(!m_FileSystem->MountPack(ASSET_PACK_FILE))
+	{
+		LOG_INFO(LOG_CATEGORY_RESOURCE, "No asset pack, the assets are read from %s.", ASSET_DIRECTORY);
+	}
+	m_FileSystem->MountDirectory(ASSET_DIRECTORY);
+
+	// Create the streaming test object when asked for. It streams a made up world along a camera path and reports the stalls.
+	if(commandLine && strstr(commandLine, STREAM_TEST_SWITCH))
+	{
+		m_StreamingTest = new StreamingTestClass;
+		if(!m_StreamingTest)
+		{
+			return false;
+		}
+
+		// Initialize the streaming test object.
+		result = m_StreamingTest->Initialize();
+		if(!result)
+		{
+			return false;
+		}
+	}
+
+	// Create the virtual texture test object when asked for. It pages a made up texture under a moving view and reports the misses.
+	if(commandLine && strstr(commandLine, VIRTUAL_TEXTURE_TEST_SWITCH))
+	{
+		m_VirtualTextureTest = new VirtualTextureTestClass;
+		if(!m_VirtualTextureTest)
+		{
+			return false;
+		}
+
+		// Initialize the virtual texture test object.
+		result = m_VirtualTextureTest->Initialize();
+		if(!result)
+		{
+			return false;
+		}
+	}
+
+	// The tests are measured frame by frame, so without a recording to set it the clock still runs a fixed step.
+	if((m_StreamingTest || m_VirtualTextureTest) && !m_Clock->IsFixedStep())
+	{
+		m_Clock->SetFixedStep(FRAME_CLOCK_FIXED_STEP);
+	}
+
+#ifdef _WIN32
+	// Create the graphics object, when there is a window to render to. This object will handle rendering all the graphics for this application.
+	if(m_Platform->GetWindowHandle())
+	{
+		m_Graphics = new GraphicsClass;
+		if(!m_Graphics)
+		{
+			return false;
+		}
+
+		// Initialize the graphics object.
+		result = m_Graphics->Initialize(screenWidth, screenHeight, (HWND)m_Platform->GetWindowHandle(), m_FileSystem);
+		if(!result)
+		{
+			return false;
+		}
+	}
+#endif
 	
 	return true;
 }
@@ -106,6 +342,7 @@ bool SystemClass::Initialize()
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 void SystemClass::Shutdown()
 {
+#ifdef _WIN32
 	// Release the graphics object.
 	if(m_Graphics)
 	{
@@ -113,6 +350,46 @@ void SystemClass::Shutdown()
 		delete m_Graphics;
 		m_Graphics = 0;
 	}
+#endif
+
+	// Report the streaming and release the streaming test object.
+	if(m_StreamingTest)
+	{
+		m_StreamingTest->Shutdown();
+		delete m_StreamingTest;
+		m_StreamingTest = 0;
+	}
+
+	// Report the paging and release the virtual texture test object.
+	if(m_VirtualTextureTest)
+	{
+		m_VirtualTextureTest->Shutdown();
+		delete m_VirtualTextureTest;
+		m_VirtualTextureTest = 0;
+	}
+
+	// Unmount the packs and release the file system object.
+	if(m_FileSystem)
+	{
+		m_FileSystem->Shutdown();
+		delete m_FileSystem;
+		m_FileSystem = 0;
+	}
+
+	// Release the frame clock object.
+	if(m_Clock)
+	{
+		delete m_Clock;
+		m_Clock = 0;
+	}
+
+	// Close the input recording and release the input recorder object.
+	if(m_InputRecorder)
+	{
+		m_InputRecorder->Shutdown();
+		delete m_InputRecorder;
+		m_InputRecorder = 0;
+	}
 
 	// Release the input object.
 	if(m_Input)
@@ -121,8 +398,35 @@ void SystemClass::Shutdown()
 		m_Input = 0;
 	}
 
-	// Shutdown the window.
-	ShutdownWindows();
+	// Stop the worker threads.
+	TaskGraphClass::ShutdownWorkers();
+
+	// Release the scratch stack of the main thread.
+	ScratchAllocatorClass::ShutdownThread();
+
+	// Shutdown the window and release the platform object.
+	if(m_Platform)
+	{
+		m_Platform->Shutdown();
+		delete m_Platform;
+		m_Platform = 0;
+	}
+
+	// Keep the frame time statistics and release the frame stats object.
+	if(m_FrameStats)
+	{
+		m_FrameStats->WriteSummary("frame-summary.txt");
+		m_FrameStats->Shutdown();
+		delete m_FrameStats;
+		m_FrameStats = 0;
+	}
+
+	// Write what is left of the log and stop the writer thread.
+	LogClass::Shutdown();
+
+	// Keep the zone summary of the last frames and stop the profiler.
+	ProfilerClass::WriteSummary("profiler-summary.txt");
+	ProfilerClass::Shutdown();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -143,31 +447,38 @@ void SystemClass::Shutdown()
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 void SystemClass::Run()
 {
-	MSG msg;
-	bool done, result;
-
-	// Initialize the message structure.
-	// ZeroMemory is the same as: memset(&msg, 0, sizeof(MSG));
-	ZeroMemory(&msg, sizeof(MSG));
+	PlatformEvent event;
+	bool done, quit, result;
 	
 	// Loop until there is a quit message from the window or the user.
 	done = false;
+	quit = false;
 	while(!done)
 	{
-		// Handle the windows messages.
-		// GetMessage = wait for message
-		// PeekMessage = return the first message, or return nothing if there are no messages
-		if(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+		m_FrameStats->BeginFrame();
+
+		// Handle the platform events.
+		// Drain every pending event, so input queued behind the first one doesn't wait a frame.
 		{
-			// Translates virtual-key messages into character messages.
-			TranslateMessage(&msg); 
+			PROFILE_ZONE("SystemClass::Messages");
 
-			// Dispatches a message to a window procedure.
-			DispatchMessage(&msg); 
+			while(!quit && m_Platform->PollEvent(event))
+			{
+				if(event.type == PLATFORM_EVENT_QUIT)
+				{
+					quit = true;
+				}
+				else
+				{
+					HandleEvent(event);
+				}
+			}
 		}
 
-		// If windows signals to end the application then exit out.
-		if(msg.message == WM_QUIT)
+		m_FrameStats->MarkStage(FRAME_STAGE_MESSAGES);
+
+		// If the platform signals to end the application then exit out.
+		if(quit)
 		{
 			done = true;
 		}
@@ -179,6 +490,20 @@ void SystemClass::Run()
 			{
 				done = true;
 			}
+
+			// Collect the zones recorded by every thread during this frame.
+			ProfilerClass::EndFrame();
+			m_FrameStats->MarkStage(FRAME_STAGE_PROFILER);
+
+			// Add the frame time to the statistics. (Must come after the profiler so a hitch can dump its zones.)
+			m_FrameStats->EndFrame();
+
+			// Report how long the user waited for something on screen.
+			if(m_startTimestamp)
+			{
+				LOG_INFO(LOG_CATEGORY_SYSTEM, "First frame done %.1f ms after startup.", ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - m_startTimestamp));
+				m_startTimestamp = 0;
+			}
 		}
 	}
 }
@@ -195,328 +520,154 @@ void SystemClass::Run()
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 bool SystemClass::Frame()
 {
+#ifdef _WIN32
+	SceneQueryHit hit;
+	int mouseX, mouseY;
+#endif
 	bool result;
 
-	// Check if the user pressed escape and wants to exit the application.
-	if(m_Input->IsKeyDown(VK_ESCAPE))
+	PROFILE_FUNCTION();
+
+	// Start the frame on the simulation clock.
+	m_Clock->Tick();
+
+	// When replaying, queue the recorded events of this frame. The run ends with the recording.
+	if(!m_InputRecorder->ReplayFrame(m_Input, m_Clock->GetFrameIndex()))
 	{
+		LOG_INFO(LOG_CATEGORY_INPUT, "Replay finished after %u frames.", m_Clock->GetFrameIndex());
 		return false;
 	}
 
-	// Do the frame processing for the graphics object.
-	result = m_Graphics->Frame();
+	// Consume the input events queued since the last frame.
+	m_Input->Update();
+
+	// When recording, save what was consumed.
+	result = m_InputRecorder->RecordFrame(m_Input, m_Clock->GetFrameIndex());
 	if(!result)
 	{
 		return false;
 	}
 
-	return true;
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-/// <summary>
-/// 	This function is where we put the code to build the window we will use to render to. It
-/// 	returns screenWidth and screenHeight back to the calling function so we can make use of
-/// 	them throughout the application. We create the window using some default settings to
-/// 	initialize a plain black window with no borders. The function will make either a small
-/// 	window or make a full screen window depending on a global variable called FULL_SCREEN. If
-/// 	this is set to true then we make the screen cover the entire users desktop window. If it
-/// 	is set to false we just make a 800x600 window in the middle of the screen. I placed the
-/// 	FULL_SCREEN global variable at the top of the graphicsclass.h file in case you want to
-/// 	modify it. It will make sense later why I placed the global in that file instead of the
-/// 	header for this file.
-/// </summary>
-///
-/// <remarks> Filipe, 25 Nov 2012. </remarks>
-///
-/// <param name="screenWidth">  [in,out] Width of the screen. </param>
-/// <param name="screenHeight"> [in,out] Height of the screen. </param>
-////////////////////////////////////////////////////////////////////////////////////////////////////
-void SystemClass::InitializeWindows(int& screenWidth, int& screenHeight)
-{
-	WNDCLASSEX wc;
-	int posX, posY;
-	// DEVMODE dmScreenSettings;
-
-	// Get an external pointer to this object.
-	ApplicationHandle = this;
-
-	// Get the instance of this application.
-	m_hinstance = GetModuleHandle(NULL);
-	
-	// Give the application a name.
-	m_applicationName = L"Engine";
-
-	// Title of the window. (Only visible if the window has a frame, use WS_OVERLAPPEDWINDOW in CreateWindowEx to test it.)
-	m_windowTitle = L"Engine Test";
-
-	// Style of the window.
-	m_windowStyle = WS_OVERLAPPEDWINDOW;
-
-	// Initialize the window structure.
-	ZeroMemory(&wc, sizeof(WNDCLASSEX));
-
-	/* 
-		Setup the windows class with default settings. 
-	*/
-
-	// Set the size of the struct.
-	wc.cbSize = sizeof(WNDCLASSEX); 
-	// Defines the name of the function where windows will redirect the messages.
-	wc.lpfnWndProc = WndProc; 
-	// A handle to the instance that contains the window procedure for the class. 
-	wc.hInstance = m_hinstance;
-
-	// CS_HREDRAW = Redraws the entire window if a movement or size adjustment changes the width of the client area.
-	// CS_VREDRAW = Redraws the entire window if a movement or size adjustment changes the height of the client area.
-	// CS_OWNDC = Allocates a unique device context for each window in the class. 
-	wc.style = CS_HREDRAW | CS_VREDRAW | CS_OWNDC; 
-	// This member must be a handle to an icon resource.
-	wc.hIcon = LoadIcon(NULL, IDI_WINLOGO); 
-	// A handle to a small icon that is associated with the window class. 
-	// If this member is NULL, the system searches the icon resource specified by the hIcon member for an icon of the appropriate size to use as the small icon. 
-	wc.hIconSm = wc.hIcon; 
-	// A handle to the class cursor. This member must be a handle to a cursor resource. 
-	// If this member is NULL, an application must explicitly set the cursor shape whenever the mouse moves into the application's window. 
-	wc.hCursor = LoadCursor(NULL, IDC_ARROW); 
-	// This member can be a handle to the brush to be used for painting the background, or it can be a color value.
-	wc.hbrBackground = (HBRUSH)COLOR_WINDOW; 
-
-	// It specifies the window class name
-	wc.lpszClassName = m_applicationName; 
-	// Specifies the resource name of the class menu, as the name appears in the resource file. 
-	wc.lpszMenuName = NULL; 
-	// The number of extra bytes to allocate following the window-class structure. The system initializes the bytes to zero. 
-	wc.cbClsExtra = 0;
-	// The number of extra bytes to allocate following the window instance. The system initializes the bytes to zero. 
-	wc.cbWndExtra = 0; 
-	
-	// Registers a window class for subsequent use in calls to the CreateWindow or CreateWindowEx function.
-	RegisterClassEx(&wc);
-
-	// Setup the screen settings depending on whether it is running in full screen or in windowed mode.
-	if(FULL_SCREEN)
+	// Check if the user pressed escape and wants to exit the application.
+	if(m_Input->IsKeyDown(PLATFORM_KEY_ESCAPE))
 	{
-		//// Doesn't work, probably because of the monitor drivers
-		//// If full screen set the screen to maximum size of the users desktop and 32bit.
-		//memset(&dmScreenSettings, 0, sizeof(dmScreenSettings));
-		//dmScreenSettings.dmSize       = sizeof(dmScreenSettings);
-		//dmScreenSettings.dmPelsWidth  = (unsigned long)screenWidth;
-		//dmScreenSettings.dmPelsHeight = (unsigned long)screenHeight;
-		//dmScreenSettings.dmBitsPerPel = 32;			
-		//dmScreenSettings.dmFields     = DM_BITSPERPEL | DM_PELSWIDTH | DM_PELSHEIGHT;
-
-		//// This function changes the settings of the default display device to the specified graphics mode(full screen).
-		//ChangeDisplaySettings(&dmScreenSettings, CDS_FULLSCREEN);
-
-		// Determine the resolution of the clients desktop screen.
-		screenWidth  = GetSystemMetrics(SM_CXSCREEN);
-		screenHeight = GetSystemMetrics(SM_CYSCREEN);
-
-		// Set the position of the window to the top left corner.
-		posX = 0;
-		posY = 0;
+		return false;
 	}
-	else
-	{
-		// If windowed then set it to 800x600 resolution.
-		screenWidth  = 800;
-		screenHeight = 600;
-
-		// Place the window in the middle of the screen.
-		posX = (GetSystemMetrics(SM_CXSCREEN) - screenWidth)  / 2;
-		posY = (GetSystemMetrics(SM_CYSCREEN) - screenHeight) / 2;
-	}
-
-	// The size for the client-window
-	RECT wr = {0, 0, screenWidth, screenHeight}; 
-	// Calculates the required size of the window rectangle, based on the desired client-rectangle size.
-	AdjustWindowRect(&wr, m_windowStyle, FALSE); 
-
-	// Creates an overlapped, pop-up, or child window with an extended window style; otherwise, this function is identical to the CreateWindow function.
-	// It specifies the window class, window title, window style, and (optionally) the initial position and size of the window. 
-	// The function also specifies the window's parent or owner, if any, and the window's menu.
-	m_hwnd = CreateWindowEx(WS_EX_APPWINDOW, 
-							m_applicationName, 
-							m_windowTitle, 
-							m_windowStyle,
-							posX, 
-							posY, 
-							wr.right - wr.left, 
-							wr.bottom - wr.top,
-							NULL, 
-							NULL, 
-							m_hinstance, 
-							NULL);
-
-	// Sets the specified window's show state. 
-	ShowWindow(m_hwnd, SW_SHOW); 
-	// Brings the thread that created the specified window into the foreground and activates the window.
-	SetForegroundWindow(m_hwnd); 
-	// Sets the keyboard focus to the specified window. The window must be attached to the calling thread's message queue. 
-	SetFocus(m_hwnd); 
-
-	// Hide the mouse cursor.
-	// ShowCursor(false);
-}
-
-bool SystemClass::EnterFullscreen()
-{
-	// DEVMODE Struct.
-	DEVMODE newSettings;	
 
-	// Now fill the DEVMODE with standard settings, mainly monitor frequenzy.
-	EnumDisplaySettings(NULL, 0, &newSettings);
+	// Capture the next frames for chrome://tracing when asked, and save them once they are done.
+	if(m_Input->IsKeyPressed(PROFILER_CAPTURE_KEY))
+	{
+		ProfilerClass::BeginCapture();
+	}
 
-	// Set desired screen size and resolution	
-	newSettings.dmPelsWidth  = 1600;		
-	newSettings.dmPelsHeight = 900;		
-	newSettings.dmBitsPerPel = 32;		
+	if(ProfilerClass::IsCaptureReady())
+	{
+		ProfilerClass::WriteChromeTrace("profiler-trace.json");
+	}
 
-	// Set those flags to let the next function know what we want to change.
-	newSettings.dmFields = DM_BITSPERPEL | DM_PELSWIDTH | DM_PELSHEIGHT;
+	m_FrameStats->MarkStage(FRAME_STAGE_INPUT);
 
-	// And apply the new settings.
-	if (ChangeDisplaySettings(&newSettings, CDS_FULLSCREEN)!=DISP_CHANGE_SUCCESSFUL)
+	// Move the simulated camera and stream around it.
+	if(m_StreamingTest)
 	{
-		return false;
+		m_StreamingTest->Frame(m_Clock->GetDeltaSeconds());
 	}
-	else
+
+	// Move the simulated view and page the virtual texture under it.
+	if(m_VirtualTextureTest)
 	{
-		return true;
+		m_VirtualTextureTest->Frame(m_Clock->GetDeltaSeconds());
 	}
-}
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
-/// <summary>
-/// 	This function returns the screen settings back to normal and releases the window and the
-/// 	handles associated with it.
-/// </summary>
-///
-/// <remarks> Filipe, 25 Nov 2012. </remarks>
-////////////////////////////////////////////////////////////////////////////////////////////////////
-void SystemClass::ShutdownWindows()
-{
-	// Show the mouse cursor.
-	ShowCursor(true);
-
-	// Fix the display settings if leaving full screen mode.
-	//if(FULL_SCREEN)
-	//{
-	//	ChangeDisplaySettings(NULL, 0); // Doesn't Work
-	//}
-
-	// Destroys the specified window. 
-	// The function sends WM_DESTROY and WM_NCDESTROY messages to the window to deactivate it and remove the keyboard focus from it. 
-	// The function also destroys the window's menu, flushes the thread message queue, destroys timers, removes clipboard ownership, 
-	// and breaks the clipboard viewer chain (if the window is at the top of the viewer chain).
-	// 
-	// If the specified window is a parent or owner window, DestroyWindow automatically destroys the associated child or owned windows 
-	// when it destroys the parent or owner window. The function first destroys child or owned windows, and then it destroys the parent or owner window.
-	DestroyWindow(m_hwnd);
-	// Release the handler.
-	m_hwnd = NULL; 
-
-	// Unregisters a window class, freeing the memory required for the class. 
-	UnregisterClass(m_applicationName, m_hinstance); 
-	// Remove the application instance.
-	m_hinstance = NULL; 
-
-	// Release the pointer to this class.
-	ApplicationHandle = NULL; 
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
-/// <summary>
-/// 	This function is where windows sends its messages to. Notice that we tell windows the
-/// 	name of it when we initialize the window class (wc.lpfnWndProc = WndProc) in the
-/// 	InitializeWindows function. Basically this function and the ApplicationHandle pointer are
-/// 	used to re-direct the windows system messaging into our MessageHandler function.
-/// </summary>
-///
-/// <remarks> Filipe, 25 Nov 2012. </remarks>
-///
-/// <param name="hwnd">	    Handle of the. </param>
-/// <param name="umessage"> The message. </param>
-/// <param name="wparam">   Additional message information. The contents of this parameter depend
-/// 						on the value of the uMsg parameter. </param>
-/// <param name="lparam">   Additional message information. The contents of this parameter depend
-/// 						on the value of the uMsg parameter. </param>
-///
-/// <returns> . </returns>
-////////////////////////////////////////////////////////////////////////////////////////////////////
-LRESULT CALLBACK WndProc(HWND hwnd, UINT umessage, WPARAM wparam, LPARAM lparam)
-{
-	switch(umessage)
+#ifdef _WIN32
+	// Log the entity under the mouse when it is clicked.
+	if(m_Graphics && m_Input->IsKeyPressed(PICK_KEY))
 	{
-		// Check if the window is being destroyed.
-		case WM_DESTROY:
-		{
-			// Indicates to the system that a thread has made a request to terminate (quit). It is typically used in response to a WM_DESTROY message.
-			PostQuitMessage(0);
-			return 0;
-		}
-
-		// Check if the window is being closed.
-		case WM_CLOSE:
+		m_Input->GetMousePosition(mouseX, mouseY);
+		if(m_Graphics->Pick(mouseX, mouseY, hit))
 		{
-			PostQuitMessage(0);		
-			return 0;
+			LOG_INFO(LOG_CATEGORY_INPUT, "Picked entity %u, triangle %d, %.2f away.", hit.entity, hit.triangle, hit.distance);
 		}
+	}
 
-		// All other messages pass to the message handler in the system class.
-		default:
+	// Do the frame processing for the graphics object.
+	if(m_Graphics)
+	{
+		result = m_Graphics->Frame();
+		if(!result)
 		{
-			return ApplicationHandle->MessageHandler(hwnd, umessage, wparam, lparam);
+			return false;
 		}
 	}
+#endif
+
+	m_FrameStats->MarkStage(FRAME_STAGE_GRAPHICS);
+
+	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// <summary>
-/// 	This function is where we direct the windows system messages into. This way we can listen
-/// 	for certain information that we are interested in. Currently we will just read if a key
-/// 	is pressed or if a key is released and pass that information on to the input object. All
-/// 	other information we will pass back to the windows default message handler.
+/// 	This function is where the platform events are directed into. Currently the keys and the
+/// 	mouse are passed on to the input object, the rest is only logged.
 /// </summary>
 ///
-/// <remarks> Filipe, 25 Nov 2012. </remarks>
-///
-/// <param name="hwnd">   Handle of the window. </param>
-/// <param name="umsg">   The message. </param>
-/// <param name="wparam"> Additional message information. The contents of this parameter depend on
-/// 					  the value of the uMsg parameter. </param>
-/// <param name="lparam"> Additional message information. The contents of this parameter depend on
-/// 					  the value of the uMsg parameter. </param>
-///
-/// <returns> . </returns>
+/// <param name="event"> The event. </param>
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-LRESULT CALLBACK SystemClass::MessageHandler(HWND hwnd, UINT umsg, WPARAM wparam, LPARAM lparam)
+void SystemClass::HandleEvent(const PlatformEvent& event)
 {
-	switch(umsg)
+	unsigned int key;
+
+	// During a replay the recorded events stand in for the keyboard and the mouse.
+	if(m_InputRecorder && m_InputRecorder->IsReplaying())
 	{
-		// Check if a key has been pressed on the keyboard.
-		case WM_KEYDOWN:
+		if(event.type == PLATFORM_EVENT_KEY_DOWN || event.type == PLATFORM_EVENT_KEY_UP ||
+		   event.type == PLATFORM_EVENT_MOUSE_MOVE || event.type == PLATFORM_EVENT_MOUSE_WHEEL)
 		{
-			// If a key is pressed send it to the input object so it can record that state.
-			m_Input->KeyDown((unsigned int)wparam);
-			return 0;
+			return;
 		}
+	}
 
-		// Check if a key has been released on the keyboard.
-		case WM_KEYUP:
-		{
-			// If a key is released then send it to the input object so it can unset the state for that key.
-			m_Input->KeyUp((unsigned int)wparam);
-			return 0;
-		}
+	switch(event.type)
+	{
+		// If a key (or mouse button) is pressed send it to the input object so it can record that state.
+		case PLATFORM_EVENT_KEY_DOWN:
+			m_Input->KeyDown(event.code);
+			break;
+
+		// If a key is released then send it to the input object so it can unset the state for that key.
+		case PLATFORM_EVENT_KEY_UP:
+			m_Input->KeyUp(event.code);
+			break;
+
+		case PLATFORM_EVENT_MOUSE_MOVE:
+			m_Input->MouseMove(event.x, event.y);
+			break;
+
+		case PLATFORM_EVENT_MOUSE_WHEEL:
+			m_Input->MouseWheel(event.x);
+			break;
+
+		// The key up of a key held while the focus goes away is sent to the other window, so release them all here.
+		case PLATFORM_EVENT_FOCUS:
+			if(!event.code)
+			{
+				for(key=0; key<INPUT_KEY_COUNT; key++)
+				{
+					if(m_Input->IsKeyDown(key))
+					{
+						m_Input->KeyUp(key);
+					}
+				}
+			}
+			LOG_DEBUG(LOG_CATEGORY_SYSTEM, "Window focus %s.", event.code ? "gained" : "lost");
+			break;
 
-		// Any other messages send to the default message handler as our application won't make use of them.
-		default:
-		{
-			// Calls the default window procedure to provide default processing for any window messages that an application does not process. 
-			// This function ensures that every message is processed.
-			return DefWindowProc(hwnd, umsg, wparam, lparam);
-		}
+		// The swap chain keeps its size for now, the resize is only logged.
+		case PLATFORM_EVENT_RESIZE:
+			LOG_DEBUG(LOG_CATEGORY_SYSTEM, "Window resized to %dx%d.", event.x, event.y);
+			break;
 	}
-}
\ No newline at end of file
+
+	return;
+}
@@ -6,23 +6,62 @@
 #ifndef _SYSTEMCLASS_H_
 #define _SYSTEMCLASS_H_
 
-// Pre-processing directives.
-// Used to speed up the build process, it reduces the size of 
-// the Win32 header files by excluding some of the less used APIs. 
-#define WIN32_LEAN_AND_MEAN
-
-// System Includes.
-#include <windows.h>
-
 // Includes.
-#include "inputclass.h"
+// The window and the graphics need windows, the headless platform runs the frame loop anywhere.
+#ifdef _WIN32
+#include "win32platformclass.h"
 #include "graphicsclass.h"
+#else
+class GraphicsClass;
+#endif
+#include "headlessplatformclass.h"
+#include "inputclass.h"
+#include "scratchallocatorclass.h"
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+#include "framestatsclass.h"
+#include "logclass.h"
+#include "frameclockclass.h"
+#include "inputrecorderclass.h"
+#include "filesystemclass.h"
+#include "streamingtestclass.h"
+#include "virtualtexturetestclass.h"
+
+// Globals.
+const unsigned int PROFILER_CAPTURE_KEY = PLATFORM_KEY_F11;
+const unsigned int PICK_KEY = PLATFORM_KEY_LBUTTON;
+const char* const INPUT_RECORD_SWITCH = "-record";
+const char* const INPUT_REPLAY_SWITCH = "-replay";
+const char* const HEADLESS_SWITCH = "-headless";
+const char* const HEADLESS_FRAMES_SWITCH = "-frames";
+const char* const PACK_SWITCH = "-pack";
+const char* const PACK_BUILD_SWITCH = "-buildpack";
+const char* const STREAM_TEST_SWITCH = "-streamtest";
+const char* const VIRTUAL_TEXTURE_TEST_SWITCH = "-vttest";
+const char* const SCENE_BENCHMARK_SWITCH = "-scenebench";
+const char* const ENTITY_BENCHMARK_SWITCH = "-ecsbench";
+const char* const BVH_BENCHMARK_SWITCH = "-bvhbench";
+const char* const OCCLUSION_BENCHMARK_SWITCH = "-occlusionbench";
+const char* const RAY_BENCHMARK_SWITCH = "-raybench";
+const char* const TEXTURE_BENCHMARK_SWITCH = "-texturebench";
+const char* const TEXTURE_BUILD_SWITCH = "-buildtexture";
+const char* const TEXTURE_LOAD_BENCHMARK_SWITCH = "-textureloadbench";
+const char* const SPRITE_BENCHMARK_SWITCH = "-spritebench";
+const char* const DEBUG_DRAW_BENCHMARK_SWITCH = "-debugdrawbench";
+const char* const RESIDENCY_TEST_SWITCH = "-residencytest";
+const char* const ALLOCATOR_BENCHMARK_SWITCH = "-allocbench";
+const char* const FRAME_STATS_TEST_SWITCH = "-framestatstest";
+const char* const ASSET_PACK_FILE = "../Engine/assets.pak";
+const char* const ASSET_DIRECTORY = "../Engine/";
+const int COMMAND_LINE_VALUE_SIZE = 260;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 /// <summary>
 /// 	The System class is the system layer for this application. It contains the methods to
-/// 	initialize, run and shutdown the window itself as well as take care of the input messages
-/// 	for the inputclass and the grapics and grapicsclass.
+/// 	initialize, run and shutdown the application, gets the window and its events from the
+/// 	platform layer, passes the input events to the inputclass and drives the grapicsclass.
+/// 	With "-headless" (and always outside windows) there is no window and no graphics, the
+/// 	platform makes up the events and the rest of the frame loop runs as usual.
 /// </summary>
 ///
 /// <remarks> Filipe, 25 Nov 2012. </remarks>
@@ -34,33 +73,25 @@ public:
 	SystemClass(const SystemClass&);
 	~SystemClass();
 
-	bool Initialize();
+	bool Initialize(const char* = 0);
 	void Shutdown();
 	void Run();
 
-	LRESULT CALLBACK MessageHandler(HWND, UINT, WPARAM, LPARAM);
-
 private:
 	bool Frame();
-	void InitializeWindows(int&, int&);
-	void ShutdownWindows();
-	bool EnterFullscreen();
+	void HandleEvent(const PlatformEvent&);
 	
 private:
-	LPCWSTR m_applicationName;
-	LPCWSTR m_windowTitle;
-	DWORD m_windowStyle;
-	HINSTANCE m_hinstance;
-	HWND m_hwnd;
-
+	PlatformClass* m_Platform;
 	InputClass* m_Input;
 	GraphicsClass* m_Graphics;
+	FrameStatsClass* m_FrameStats;
+	FrameClockClass* m_Clock;
+	InputRecorderClass* m_InputRecorder;
+	FileSystemClass* m_FileSystem;
+	StreamingTestClass* m_StreamingTest;
+	VirtualTextureTestClass* m_VirtualTextureTest;
+	unsigned long long m_startTimestamp;
 };
 
-// Global Function Prototypes.
-static LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
-
-// Globals.
-static SystemClass* ApplicationHandle = 0;
-
 #endif
\ No newline at end of file
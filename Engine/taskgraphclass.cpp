@@ -0,0 +1,642 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	taskgraphclass.cpp
+//
+// summary:	Implements the taskgraphclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "taskgraphclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+
+// Includes.
+#include "profilerclass.h"
+#include "scratchallocatorclass.h"
+#include "logclass.h"
+#include "debugdrawclass.h"
+#include "renderstatsclass.h"
+
+// Globals.
+// The shared workers. A graph asking for help is queued once per worker it wants, the pool
+// lock guards the queue and the helper count of every graph.
+static vector<thread> TaskGraphWorkers;
+static vector<TaskGraphClass*> TaskGraphRequests;
+static mutex TaskGraphPoolLock;
+static condition_variable TaskGraphPoolWake;
+static condition_variable TaskGraphPoolDone;
+static bool TaskGraphPoolRunning = false;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskGraphClass::TaskGraphClass()
+{
+	m_unfinished = 0;
+	m_threads = 0;
+	m_helpers = 0;
+	m_start = 0;
+	m_end = 0;
+	m_criticalPathMs = 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskGraphClass::TaskGraphClass(const TaskGraphClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TaskGraphClass::~TaskGraphClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Starts the worker threads every graph shares. </summary>
+///
+/// <param name="workers"> The number of worker threads, -1 for one less than the processors. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TaskGraphClass::InitializeWorkers(int workers)
+{
+	int i;
+
+	if(TaskGraphPoolRunning)
+	{
+		return true;
+	}
+
+	if(workers < 0)
+	{
+		workers = (int)thread::hardware_concurrency() - 1;
+	}
+	workers = workers < 0 ? 0 : (workers > TASK_GRAPH_MAX_WORKERS ? TASK_GRAPH_MAX_WORKERS : workers);
+
+	TaskGraphPoolRunning = true;
+	for(i=0; i<workers; i++)
+	{
+		TaskGraphWorkers.push_back(thread(&TaskGraphClass::PoolThread, i + 1));
+	}
+
+	LOG_INFO(LOG_CATEGORY_SYSTEM, "Task graph workers started: %d threads.", workers);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Stops the worker threads. Must only be called once no graph is running. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskGraphClass::ShutdownWorkers()
+{
+	size_t i;
+
+	{
+		lock_guard<mutex> lock(TaskGraphPoolLock);
+		TaskGraphPoolRunning = false;
+	}
+	TaskGraphPoolWake.notify_all();
+
+	for(i=0; i<TaskGraphWorkers.size(); i++)
+	{
+		TaskGraphWorkers[i].join();
+	}
+	vector<thread>().swap(TaskGraphWorkers);
+	vector<TaskGraphClass*>().swap(TaskGraphRequests);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of worker threads the graphs share. </summary>
+///
+/// <returns> The number of workers, 0 if they weren't started. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int TaskGraphClass::GetWorkerCount()
+{
+	return (int)TaskGraphWorkers.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Hands back what the calling thread took: its scratch stack, if it has one, and its rings in
+/// 	the profiler, the log, the debug draw and the render stats, so a later thread reuses them.
+/// 	Every thread the engine starts calls it on its way out.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskGraphClass::ShutdownThread()
+{
+	ScratchAllocatorClass::ShutdownThread();
+	ProfilerClass::UnregisterThread();
+	LogClass::UnregisterThread();
+	DebugDrawClass::UnregisterThread();
+	RenderStatsClass::UnregisterThread();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a task to the graph. </summary>
+///
+/// <param name="name">		  The name, a string literal, used for the profiler and the timeline. </param>
+/// <param name="run">		  The work, returns false if it failed. </param>
+/// <param name="mainThread"> true if it must run on the thread that calls Run. </param>
+///
+/// <returns> The index of the task. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int TaskGraphClass::AddTask(const char* name, const function<bool()>& run, bool mainThread)
+{
+	TaskGraphTask task;
+
+	task.name = name;
+	task.run = run;
+	task.mainThread = mainThread;
+	task.dependencies = 0;
+	task.remaining = 0;
+	task.state = TASK_PENDING;
+	task.thread = 0;
+	task.start = 0;
+	task.end = 0;
+	task.critical = false;
+	m_tasks.push_back(task);
+
+	return (int)m_tasks.size() - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Makes a task wait for another. </summary>
+///
+/// <param name="task">		 The task that waits. </param>
+/// <param name="dependency"> The task it waits for. </param>
+///
+/// <returns> true if it succeeds, false if either task doesn't exist. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TaskGraphClass::AddDependency(int task, int dependency)
+{
+	if(task < 0 || task >= (int)m_tasks.size() || dependency < 0 || dependency >= (int)m_tasks.size() || task == dependency)
+	{
+		return false;
+	}
+
+	m_tasks[dependency].dependents.push_back(task);
+	m_tasks[task].dependencies++;
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Runs every task and waits for all of them. </summary>
+///
+/// <param name="workers"> The most workers that may help, -1 for all of them. </param>
+///
+/// <returns> true if every task succeeded, false if one failed or the graph has a cycle. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TaskGraphClass::Run(int workers)
+{
+	bool result;
+	int i, workerTasks;
+
+	result = SortTasks();
+	if(!result)
+	{
+		LOG_ERROR(LOG_CATEGORY_SYSTEM, "The task graph has a cycle.");
+		return false;
+	}
+
+	if(workers < 0 || workers > GetWorkerCount())
+	{
+		workers = GetWorkerCount();
+	}
+
+	// More workers than tasks they can take would only sleep.
+	workerTasks = 0;
+	for(i=0; i<(int)m_tasks.size(); i++)
+	{
+		workerTasks += m_tasks[i].mainThread ? 0 : 1;
+	}
+	workers = workers > workerTasks ? workerTasks : workers;
+	m_threads = workers + 1;
+
+	// Queue the tasks that wait for nothing.
+	m_ready.clear();
+	m_readyMain.clear();
+	for(i=0; i<(int)m_tasks.size(); i++)
+	{
+		m_tasks[i].remaining = m_tasks[i].dependencies;
+		m_tasks[i].start = 0;
+		m_tasks[i].end = 0;
+		m_tasks[i].state = TASK_PENDING;
+		if(m_tasks[i].remaining == 0)
+		{
+			(m_tasks[i].mainThread ? m_readyMain : m_ready).push_back(i);
+		}
+	}
+	m_unfinished = (int)m_tasks.size();
+
+	m_start = ProfilerClass::GetTimestamp();
+
+	// Ask the idle workers for help, then work on this thread until the graph is done.
+	if(workers > 0)
+	{
+		{
+			lock_guard<mutex> lock(TaskGraphPoolLock);
+			for(i=0; i<workers; i++)
+			{
+				TaskGraphRequests.push_back(this);
+			}
+		}
+		TaskGraphPoolWake.notify_all();
+	}
+
+	WorkerThread(0);
+
+	// Take back the help nobody came for and wait for the workers still leaving the graph.
+	if(workers > 0)
+	{
+		unique_lock<mutex> lock(TaskGraphPoolLock);
+		TaskGraphRequests.erase(remove(TaskGraphRequests.begin(), TaskGraphRequests.end(), this), TaskGraphRequests.end());
+		while(m_helpers > 0)
+		{
+			TaskGraphPoolDone.wait(lock);
+		}
+	}
+
+	m_end = ProfilerClass::GetTimestamp();
+
+	FindCriticalPath();
+
+	result = true;
+	for(i=0; i<(int)m_tasks.size(); i++)
+	{
+		result = result && m_tasks[i].state == TASK_DONE;
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes when each task ran and on which thread, with a bar chart of the startup. </summary>
+///
+/// <param name="filename"> Filename of the file. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TaskGraphClass::WriteTimeline(const char* filename)
+{
+	static const char* StateNames[] = { "pending", "running", "done", "failed", "skipped" };
+	ofstream fout;
+	double wallMs, startMs, endMs, workMs;
+	int i, j, from, to;
+
+	fout.open(filename);
+	if(fout.fail())
+	{
+		return false;
+	}
+
+	wallMs = GetWallMilliseconds();
+	workMs = GetWorkMilliseconds();
+
+	fout << fixed << setprecision(3);
+	fout << "Task graph timeline, " << m_tasks.size() << " tasks on " << m_threads << " threads, times in ms.\n";
+	fout << "wall " << wallMs << "  work " << workMs << "  critical path " << m_criticalPathMs;
+	fout << "  parallelism " << setprecision(2) << (wallMs > 0.0 ? workMs / wallMs : 0.0) << "x\n\n" << setprecision(3);
+
+	fout << left << setw(32) << "task" << right << setw(8) << "thread" << setw(10) << "start" << setw(10) << "end" << setw(10) << "duration" << "  " << left << setw(8) << "state" << right << "\n";
+	for(j=0; j<(int)m_order.size(); j++)
+	{
+		i = m_order[j];
+		startMs = m_tasks[i].start > m_start ? ProfilerClass::TicksToMilliseconds(m_tasks[i].start - m_start) : 0.0;
+		endMs = m_tasks[i].end > m_start ? ProfilerClass::TicksToMilliseconds(m_tasks[i].end - m_start) : startMs;
+
+		fout << (m_tasks[i].critical ? "*" : " ") << left << setw(31) << m_tasks[i].name << right;
+
+		// A skipped task never ran, it has no times.
+		if(m_tasks[i].state == TASK_SKIPPED || m_tasks[i].state == TASK_PENDING)
+		{
+			fout << setw(8) << "-" << setw(10) << "-" << setw(10) << "-" << setw(10) << "-" << "  " << left << setw(8) << StateNames[m_tasks[i].state] << right << " |" << string(TASK_GRAPH_TIMELINE_WIDTH, ' ') << "|\n";
+			continue;
+		}
+
+		if(m_tasks[i].thread == 0)
+		{
+			fout << setw(8) << "main";
+		}
+		else
+		{
+			fout << setw(8) << m_tasks[i].thread;
+		}
+		fout << setw(10) << startMs << setw(10) << endMs << setw(10) << endMs - startMs << "  " << left << setw(8) << StateNames[m_tasks[i].state] << right;
+
+		// A bar across the whole startup, the task is drawn where it ran.
+		from = wallMs > 0.0 ? (int)(startMs / wallMs * TASK_GRAPH_TIMELINE_WIDTH) : 0;
+		to = wallMs > 0.0 ? (int)(endMs / wallMs * TASK_GRAPH_TIMELINE_WIDTH) : 0;
+		fout << " |" << string(from, ' ') << string(to > from ? to - from : 1, '#') << string(TASK_GRAPH_TIMELINE_WIDTH - (to > from ? to : from + 1) > 0 ? TASK_GRAPH_TIMELINE_WIDTH - (to > from ? to : from + 1) : 0, ' ') << "|\n";
+	}
+
+	fout << "\n* on the critical path.\n";
+	fout.close();
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets how long the last Run took. </summary>
+///
+/// <returns> The time in ms. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double TaskGraphClass::GetWallMilliseconds()
+{
+	return m_end > m_start ? ProfilerClass::TicksToMilliseconds(m_end - m_start) : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the time of every task added up, what the last Run would have taken on one thread. </summary>
+///
+/// <returns> The time in ms. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double TaskGraphClass::GetWorkMilliseconds()
+{
+	double total;
+	int i;
+
+	total = 0.0;
+	for(i=0; i<(int)m_tasks.size(); i++)
+	{
+		if(m_tasks[i].end > m_tasks[i].start)
+		{
+			total += ProfilerClass::TicksToMilliseconds(m_tasks[i].end - m_tasks[i].start);
+		}
+	}
+
+	return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the longest chain of dependent tasks of the last Run, no thread count can beat it. </summary>
+///
+/// <returns> The time in ms. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double TaskGraphClass::GetCriticalPathMilliseconds()
+{
+	return m_criticalPathMs;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Puts the tasks in dependency order, which also finds the cycles. </summary>
+///
+/// <returns> true if it succeeds, false if the graph has a cycle. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TaskGraphClass::SortTasks()
+{
+	vector<int> remaining;
+	int i, j, task;
+
+	m_order.clear();
+	remaining.resize(m_tasks.size());
+	for(i=0; i<(int)m_tasks.size(); i++)
+	{
+		remaining[i] = m_tasks[i].dependencies;
+		if(remaining[i] == 0)
+		{
+			m_order.push_back(i);
+		}
+	}
+
+	// The order grows while it is walked, every task goes in once all it waits for is in.
+	for(i=0; i<(int)m_order.size(); i++)
+	{
+		task = m_order[i];
+		for(j=0; j<(int)m_tasks[task].dependents.size(); j++)
+		{
+			if(--remaining[m_tasks[task].dependents[j]] == 0)
+			{
+				m_order.push_back(m_tasks[task].dependents[j]);
+			}
+		}
+	}
+
+	return m_order.size() == m_tasks.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Takes ready tasks and runs them until every task is finished. </summary>
+///
+/// <param name="index"> The index of the thread, 0 for the one that called Run. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskGraphClass::WorkerThread(int index)
+{
+	TaskGraphTask* task;
+	bool result;
+	int taskIndex;
+
+	unique_lock<mutex> lock(m_lock);
+	while(m_unfinished > 0)
+	{
+		// The main thread tasks come first, nobody else can run them.
+		taskIndex = -1;
+		if(index == 0 && !m_readyMain.empty())
+		{
+			taskIndex = m_readyMain.back();
+			m_readyMain.pop_back();
+		}
+		else if(!m_ready.empty())
+		{
+			taskIndex = m_ready.back();
+			m_ready.pop_back();
+		}
+
+		if(taskIndex < 0)
+		{
+			m_wake.wait(lock);
+			continue;
+		}
+
+		task = &m_tasks[taskIndex];
+		task->state = TASK_RUNNING;
+		task->thread = index;
+		lock.unlock();
+
+		{
+			PROFILE_ZONE(task->name);
+
+			task->start = ProfilerClass::GetTimestamp();
+			result = task->run();
+			task->end = ProfilerClass::GetTimestamp();
+		}
+
+		if(!result)
+		{
+			LOG_ERROR(LOG_CATEGORY_SYSTEM, "Task %s failed, the tasks depending on it are skipped.", task->name);
+		}
+
+		lock.lock();
+		CompleteTask(taskIndex, result);
+		m_wake.notify_all();
+	}
+	lock.unlock();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A shared worker. Waits for a graph that asks for help, works on it until it is done and
+/// 	goes back to waiting. Its scratch stack and rings last as long as the thread.
+/// </summary>
+///
+/// <param name="index"> The index of the worker, from 1. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskGraphClass::PoolThread(int index)
+{
+	TaskGraphClass* graph;
+
+	// The tasks may use the scratch stack.
+	ScratchAllocatorClass::InitializeThread();
+
+	unique_lock<mutex> lock(TaskGraphPoolLock);
+	for(;;)
+	{
+		while(TaskGraphPoolRunning && TaskGraphRequests.empty())
+		{
+			TaskGraphPoolWake.wait(lock);
+		}
+
+		if(!TaskGraphPoolRunning)
+		{
+			break;
+		}
+
+		// Counted before the lock is let go, so Run can't return while this worker is in its graph.
+		graph = TaskGraphRequests.back();
+		TaskGraphRequests.pop_back();
+		graph->m_helpers++;
+		lock.unlock();
+
+		graph->WorkerThread(index);
+
+		lock.lock();
+		graph->m_helpers--;
+		TaskGraphPoolDone.notify_all();
+	}
+	lock.unlock();
+
+	// Hand the scratch stack and the rings of this thread back.
+	ShutdownThread();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Marks a task finished and queues the dependents it was the last wait of. The lock must be held. </summary>
+///
+/// <param name="index">  The task. </param>
+/// <param name="result"> true if it succeeded. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskGraphClass::CompleteTask(int index, bool result)
+{
+	TaskGraphTask* dependent;
+	int i;
+
+	m_tasks[index].state = result ? TASK_DONE : TASK_FAILED;
+	m_unfinished--;
+
+	for(i=0; i<(int)m_tasks[index].dependents.size(); i++)
+	{
+		dependent = &m_tasks[m_tasks[index].dependents[i]];
+		dependent->remaining--;
+
+		if(!result)
+		{
+			SkipTask(m_tasks[index].dependents[i]);
+		}
+		else if(dependent->remaining == 0 && dependent->state == TASK_PENDING)
+		{
+			(dependent->mainThread ? m_readyMain : m_ready).push_back(m_tasks[index].dependents[i]);
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Skips a task and everything depending on it. The lock must be held. </summary>
+///
+/// <param name="index"> The task. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskGraphClass::SkipTask(int index)
+{
+	int i;
+
+	if(m_tasks[index].state != TASK_PENDING)
+	{
+		return;
+	}
+
+	m_tasks[index].state = TASK_SKIPPED;
+	m_unfinished--;
+
+	for(i=0; i<(int)m_tasks[index].dependents.size(); i++)
+	{
+		SkipTask(m_tasks[index].dependents[i]);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the longest chain of dependent tasks and marks it. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TaskGraphClass::FindCriticalPath()
+{
+	vector<double> finish;
+	vector<int> previous;
+	double duration;
+	int i, j, task, dependent, last;
+
+	finish.assign(m_tasks.size(), 0.0);
+	previous.assign(m_tasks.size(), -1);
+
+	// Walk in dependency order, the chain ending at a task is its longest dependency chain plus itself.
+	last = -1;
+	for(i=0; i<(int)m_order.size(); i++)
+	{
+		task = m_order[i];
+		duration = m_tasks[task].end > m_tasks[task].start ? ProfilerClass::TicksToMilliseconds(m_tasks[task].end - m_tasks[task].start) : 0.0;
+		finish[task] += duration;
+
+		for(j=0; j<(int)m_tasks[task].dependents.size(); j++)
+		{
+			dependent = m_tasks[task].dependents[j];
+			if(finish[task] > finish[dependent])
+			{
+				finish[dependent] = finish[task];
+				previous[dependent] = task;
+			}
+		}
+
+		if(last < 0 || finish[task] > finish[last])
+		{
+			last = task;
+		}
+	}
+
+	for(i=0; i<(int)m_tasks.size(); i++)
+	{
+		m_tasks[i].critical = false;
+	}
+
+	m_criticalPathMs = last >= 0 ? finish[last] : 0.0;
+	for(task=last; task>=0; task=previous[task])
+	{
+		m_tasks[task].critical = true;
+	}
+
+	return;
+}
@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	taskgraphclass.h
+//
+// summary:	Declares the taskgraphclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _TASKGRAPHCLASS_H_
+#define _TASKGRAPHCLASS_H_
+
+// System Includes.
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+using namespace std;
+
+// Globals.
+const int TASK_GRAPH_MAX_WORKERS = 8;
+const int TASK_GRAPH_TIMELINE_WIDTH = 50;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the states of a task. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum TaskState
+{
+	TASK_PENDING,
+	TASK_RUNNING,
+	TASK_DONE,
+	TASK_FAILED,
+	TASK_SKIPPED
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A task of the graph. Dependencies counts the tasks it waits for, remaining how many of
+/// 	them are still not done; dependents are the tasks waiting for it. Thread is 0 for the
+/// 	thread that called Run, and start and end are profiler time stamps.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TaskGraphTask
+{
+	const char* name;
+	function<bool()> run;
+	bool mainThread;
+	vector<int> dependents;
+	int dependencies;
+	int remaining;
+	TaskState state;
+	int thread;
+	unsigned long long start;
+	unsigned long long end;
+	bool critical;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Runs a set of tasks in dependency order on a pool of worker threads. Tasks are added with
+/// 	AddTask, ordered with AddDependency, and Run executes the whole graph and returns once
+/// 	every task has finished. The calling thread works too: it is the only one that runs the
+/// 	tasks marked as main thread (the ones using the device context or anything else that
+/// 	isn't thread safe) and helps with the rest while it has none.
+///
+/// 	The workers are started once by InitializeWorkers and shared by every graph, Run only
+/// 	asks the idle ones to help, so a graph can run every frame without creating a thread.
+/// 	Without the workers, or while they are all busy with other graphs, the calling thread
+/// 	runs the whole graph by itself.
+///
+/// 	A task that fails skips every task depending on it, the independent ones still run, so
+/// 	the timeline shows all the work that could be done. Every task is a profiler zone on the
+/// 	thread that ran it, and WriteTimeline writes when each one ran, on which thread, and
+/// 	which of them make up the critical path.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class TaskGraphClass
+{
+public:
+	TaskGraphClass();
+	TaskGraphClass(const TaskGraphClass&);
+	~TaskGraphClass();
+
+	static bool InitializeWorkers(int = -1);
+	static void ShutdownWorkers();
+	static int GetWorkerCount();
+	static void ShutdownThread();
+
+	int AddTask(const char*, const function<bool()>&, bool = false);
+	bool AddDependency(int, int);
+	bool Run(int = -1);
+
+	bool WriteTimeline(const char*);
+	double GetWallMilliseconds();
+	double GetWorkMilliseconds();
+	double GetCriticalPathMilliseconds();
+
+private:
+	static void PoolThread(int);
+	bool SortTasks();
+	void WorkerThread(int);
+	void CompleteTask(int, bool);
+	void SkipTask(int);
+	void FindCriticalPath();
+
+private:
+	vector<TaskGraphTask> m_tasks;
+	vector<int> m_order;
+	vector<int> m_ready;
+	vector<int> m_readyMain;
+	mutex m_lock;
+	condition_variable m_wake;
+	int m_unfinished;
+	int m_threads;
+	int m_helpers;
+	unsigned long long m_start;
+	unsigned long long m_end;
+	double m_criticalPathMs;
+};
+
+#endif
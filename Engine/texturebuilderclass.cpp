@@ -0,0 +1,807 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	texturebuilderclass.cpp
+//
+// summary:	Implements the texturebuilderclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "texturebuilderclass.h"
+
+// System Includes.
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+// Includes.
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+#include "logclass.h"
+
+// Globals.
+static const int TgaHeaderSize = 18;
+static const int TgaTrueColor = 2;
+static const int TgaTrueColorRle = 10;
+static const unsigned int DdsFlagsTexture = 0x1 | 0x2 | 0x4 | 0x1000;
+static const unsigned int DdsFlagPitch = 0x8;
+static const unsigned int DdsFlagMipMapCount = 0x20000;
+static const unsigned int DdsFlagLinearSize = 0x80000;
+static const unsigned int DdsPixelFormatFourCC = 0x4;
+static const unsigned int DdsCapsTexture = 0x1000;
+static const unsigned int DdsCapsMipMap = 0x400000 | 0x8;
+static const unsigned int DdsDimensionTexture2D = 3;
+static const unsigned int Ktx2ModelRgbsda = 1;
+static const unsigned int Ktx2ModelBc1 = 128;
+static const unsigned int Ktx2ModelBc3 = 130;
+static const unsigned int Ktx2ModelBc7 = 135;
+static const unsigned int Ktx2PrimariesBt709 = 1;
+static const unsigned int Ktx2TransferLinear = 1;
+static const unsigned int Ktx2TransferSrgb = 2;
+static const unsigned int Ktx2ChannelAlpha = 15;
+static const unsigned int Ktx2SampleLinear = 0x10;
+static const unsigned int Ktx2BlockOf4x4 = 0x0303;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the next number of a simple random sequence. </summary>
+///
+/// <param name="seed"> [in,out] The state of the sequence. </param>
+///
+/// <returns> A number between 0 and 1. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float NextRandom(unsigned int& seed)
+{
+	seed = seed * 1664525u + 1013904223u;
+
+	return (seed >> 8) / 16777216.0f;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Fills the tables that take an 8 bit sRGB value into linear light, and linear light in
+/// 	TEXTURE_SRGB_TABLE_SIZE steps back to the nearest 8 bit sRGB value.
+/// </summary>
+///
+/// <param name="toLinear"> [out] The linear light of each sRGB value. </param>
+/// <param name="toSrgb">   [out] The sRGB value of each step of linear light. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void BuildSrgbTables(float toLinear[256], unsigned char toSrgb[TEXTURE_SRGB_TABLE_SIZE])
+{
+	float value;
+	int i;
+
+	for(i=0; i<256; i++)
+	{
+		value = i / 255.0f;
+		toLinear[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	for(i=0; i<TEXTURE_SRGB_TABLE_SIZE; i++)
+	{
+		value = i / (float)(TEXTURE_SRGB_TABLE_SIZE - 1);
+		value = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+		toSrgb[i] = (unsigned char)(value * 255.0f + 0.5f);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Makes some rows of a mip level from the level above it, each pixel the average of the
+/// 	2x2 pixels it covers. An odd last row or column is averaged with itself.
+/// </summary>
+///
+/// <param name="source">   The level above. </param>
+/// <param name="target">   [out] The level, already sized. </param>
+/// <param name="firstRow"> The first row. </param>
+/// <param name="lastRow">  The row after the last one. </param>
+/// <param name="toLinear"> The linear light of each sRGB value, null to average the values as they are. </param>
+/// <param name="toSrgb">   The sRGB value of each step of linear light. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void DownsampleRows(const TextureImage* source, TextureImage* target, int firstRow, int lastRow, const float* toLinear, const unsigned char* toSrgb)
+{
+	const unsigned char* corners[4];
+	unsigned char* pixel;
+	float sum;
+	int x, y, x0, x1, y0, y1, c, total;
+
+	for(y=firstRow; y<lastRow; y++)
+	{
+		y0 = y * 2;
+		y1 = y0 + 1 < source->height ? y0 + 1 : y0;
+		for(x=0; x<target->width; x++)
+		{
+			x0 = x * 2;
+			x1 = x0 + 1 < source->width ? x0 + 1 : x0;
+			corners[0] = &source->pixels[((size_t)y0 * source->width + x0) * 4];
+			corners[1] = &source->pixels[((size_t)y0 * source->width + x1) * 4];
+			corners[2] = &source->pixels[((size_t)y1 * source->width + x0) * 4];
+			corners[3] = &source->pixels[((size_t)y1 * source->width + x1) * 4];
+			pixel = &target->pixels[((size_t)y * target->width + x) * 4];
+
+			for(c=0; c<3; c++)
+			{
+				if(toLinear)
+				{
+					sum = toLinear[corners[0][c]] + toLinear[corners[1][c]] + toLinear[corners[2][c]] + toLinear[corners[3][c]];
+					pixel[c] = toSrgb[(int)(sum * 0.25f * (TEXTURE_SRGB_TABLE_SIZE - 1) + 0.5f)];
+				}
+				else
+				{
+					total = corners[0][c] + corners[1][c] + corners[2][c] + corners[3][c];
+					pixel[c] = (unsigned char)((total + 2) / 4);
+				}
+			}
+
+			total = corners[0][3] + corners[1][3] + corners[2][3] + corners[3][3];
+			pixel[3] = (unsigned char)((total + 2) / 4);
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Decodes a TGA image in memory: true colour, 24 or 32 bits, stored as is or run length encoded. </summary>
+///
+/// <param name="data">  The file. </param>
+/// <param name="image"> [out] The image, opaque if the file has no alpha. </param>
+///
+/// <returns> false if the file is cut short or in another kind of TGA. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureBuilderClass::DecodeTga(const vector<char>& data, TextureImage& image)
+{
+	const unsigned char* bytes;
+	unsigned char color[4], swap;
+	size_t position, count, i, row, rowBytes;
+	int type, depth, length, k;
+	bool run, topFirst;
+
+	if(data.size() < (size_t)TgaHeaderSize)
+	{
+		return false;
+	}
+
+	bytes = (const unsigned char*)&data[0];
+	type = bytes[2];
+	depth = bytes[16] / 8;
+	image.width = bytes[12] | (bytes[13] << 8);
+	image.height = bytes[14] | (bytes[15] << 8);
+	topFirst = (bytes[17] & 0x20) != 0;
+	if(bytes[1] != 0 || (type != TgaTrueColor && type != TgaTrueColorRle) || (depth != 3 && depth != 4) || image.width <= 0 || image.height <= 0)
+	{
+		return false;
+	}
+
+	position = TgaHeaderSize + bytes[0];
+	count = (size_t)image.width * image.height;
+	image.pixels.resize(count * 4);
+
+	// Raw images are one long packet of pixels, run length encoded ones a packet header before each run or packet.
+	color[3] = 255;
+	i = 0;
+	while(i < count)
+	{
+		run = false;
+		length = (int)(count - i < 0x7fffffff ? count - i : 0x7fffffff);
+		if(type == TgaTrueColorRle)
+		{
+			if(position >= data.size())
+			{
+				return false;
+			}
+			run = (bytes[position] & 0x80) != 0;
+			length = (bytes[position] & 0x7f) + 1;
+			position++;
+			if((size_t)length > count - i)
+			{
+				return false;
+			}
+		}
+
+		for(k=0; k<length; k++, i++)
+		{
+			if(!run || k == 0)
+			{
+				if(position + depth > data.size())
+				{
+					return false;
+				}
+
+				// The file has the channels the other way around.
+				color[0] = bytes[position + 2];
+				color[1] = bytes[position + 1];
+				color[2] = bytes[position];
+				color[3] = depth == 4 ? bytes[position + 3] : 255;
+				position += depth;
+			}
+			memcpy(&image.pixels[i * 4], color, 4);
+		}
+	}
+
+	// Most TGA files start at the bottom row.
+	if(!topFirst)
+	{
+		rowBytes = (size_t)image.width * 4;
+		for(row=0; row<(size_t)image.height / 2; row++)
+		{
+			for(i=0; i<rowBytes; i++)
+			{
+				swap = image.pixels[row * rowBytes + i];
+				image.pixels[row * rowBytes + i] = image.pixels[(image.height - 1 - row) * rowBytes + i];
+				image.pixels[(image.height - 1 - row) * rowBytes + i] = swap;
+			}
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads a TGA file from the disk, for the offline builder. </summary>
+///
+/// <param name="filename"> Filename of the file. </param>
+/// <param name="image">    [out] The image. </param>
+///
+/// <returns> false if the file is missing or can't be decoded. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureBuilderClass::LoadTga(const char* filename, TextureImage& image)
+{
+	ifstream fin;
+	vector<char> data;
+	streamoff size;
+
+	fin.open(filename, ios::in | ios::binary);
+	if(fin.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not open the image %s.", filename);
+		return false;
+	}
+
+	fin.seekg(0, ios::end);
+	size = fin.tellg();
+	fin.seekg(0, ios::beg);
+	data.resize((size_t)size);
+	if(size > 0)
+	{
+		fin.read(&data[0], size);
+	}
+
+	if(fin.fail() || !DecodeTga(data, image))
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not decode the image %s.", filename);
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Makes the mip chain of an image, down to one pixel, the rows of each level split between the workers when it is large enough. </summary>
+///
+/// <param name="image">   The image. </param>
+/// <param name="srgb">	   true to average the colours in linear light, for sRGB images. </param>
+/// <param name="mips">	   [out] The levels, the image itself first. </param>
+/// <param name="workers"> The number of workers to run on, 0 runs on the calling thread, -1 on every core. </param>
+///
+/// <returns> false if the image is empty. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureBuilderClass::GenerateMips(const TextureImage& image, bool srgb, vector<TextureImage>& mips, int workers)
+{
+	float toLinear[256];
+	unsigned char toSrgb[TEXTURE_SRGB_TABLE_SIZE];
+	const float* linearTable;
+	const TextureImage* source;
+	TextureImage* target;
+	int first, rows;
+	bool done;
+
+	PROFILE_FUNCTION();
+
+	mips.clear();
+	if(image.width <= 0 || image.height <= 0 || image.pixels.size() < (size_t)image.width * image.height * 4)
+	{
+		return false;
+	}
+
+	// The tables are filled here rather than once for good, a static would be filled by whichever thread comes first.
+	linearTable = 0;
+	if(srgb)
+	{
+		BuildSrgbTables(toLinear, toSrgb);
+		linearTable = toLinear;
+	}
+
+	mips.push_back(image);
+	while(mips.back().width > 1 || mips.back().height > 1)
+	{
+		mips.push_back(TextureImage());
+		source = &mips[mips.size() - 2];
+		target = &mips.back();
+		target->width = source->width > 1 ? source->width / 2 : 1;
+		target->height = source->height > 1 ? source->height / 2 : 1;
+		target->pixels.resize((size_t)target->width * target->height * 4);
+		rows = target->height;
+
+		done = false;
+		if(workers != 0 && target->width * target->height >= TEXTURE_PARALLEL_MIP_PIXELS)
+		{
+			TaskGraphClass tasks;
+
+			for(first=0; first<rows; first+=TEXTURE_MIP_ROWS_PER_TASK)
+			{
+				tasks.AddTask("TextureBuilderClass::GenerateMips", [source, target, first, rows, linearTable, &toSrgb]() -> bool
+				{
+					DownsampleRows(source, target, first, first + TEXTURE_MIP_ROWS_PER_TASK < rows ? first + TEXTURE_MIP_ROWS_PER_TASK : rows, linearTable, toSrgb);
+					return true;
+				});
+			}
+
+			done = tasks.Run(workers);
+		}
+
+		// Without the workers the level is made here.
+		if(!done)
+		{
+			DownsampleRows(source, target, 0, rows, linearTable, toSrgb);
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Imports an image into a texture: makes its mip chain and encodes every level into a format. </summary>
+///
+/// <param name="image">   The image. </param>
+/// <param name="format">  The format of the texture. </param>
+/// <param name="srgb">	   true if the colours of the image are sRGB, false for data such as normals. </param>
+/// <param name="texture"> [out] The texture. </param>
+/// <param name="workers"> The number of workers to run on, 0 runs on the calling thread, -1 on every core. </param>
+///
+/// <returns> false if the image is empty. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureBuilderClass::Build(const TextureImage& image, TextureFormat format, bool srgb, TextureData& texture, int workers)
+{
+	vector<TextureImage> levels;
+	TextureMip mip;
+	size_t offset;
+	unsigned int i;
+
+	PROFILE_FUNCTION();
+
+	if(!GenerateMips(image, srgb, levels, workers))
+	{
+		return false;
+	}
+
+	texture.format = format;
+	texture.srgb = srgb;
+	texture.width = image.width;
+	texture.height = image.height;
+	texture.mips.clear();
+
+	// The levels go one after the other, largest first.
+	offset = 0;
+	for(i=0; i<levels.size(); i++)
+	{
+		mip.width = levels[i].width;
+		mip.height = levels[i].height;
+		mip.rowPitch = TextureCompressionClass::GetRowPitch(format, mip.width);
+		mip.offset = offset;
+		mip.size = TextureCompressionClass::GetSize(format, mip.width, mip.height);
+		texture.mips.push_back(mip);
+		offset += mip.size;
+	}
+
+	texture.data.resize(offset);
+	for(i=0; i<levels.size(); i++)
+	{
+		if(!TextureCompressionClass::Encode(&levels[i].pixels[0], levels[i].width, levels[i].height, format, &texture.data[texture.mips[i].offset], workers))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes a texture to a DDS file, with the DX10 header so the format is named exactly. </summary>
+///
+/// <param name="filename"> Filename of the file. </param>
+/// <param name="texture">  The texture. </param>
+///
+/// <returns> false if there is no texture or the file can't be written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureBuilderClass::WriteDds(const char* filename, const TextureData& texture)
+{
+	ofstream fout;
+	DdsHeader header;
+	DdsHeaderDx10 extension;
+	bool compressed;
+
+	if(texture.mips.empty() || texture.data.empty())
+	{
+		return false;
+	}
+
+	compressed = TextureCompressionClass::IsCompressed(texture.format);
+
+	memset(&header, 0, sizeof(DdsHeader));
+	header.size = sizeof(DdsHeader);
+	header.flags = DdsFlagsTexture | DdsFlagMipMapCount | (compressed ? DdsFlagLinearSize : DdsFlagPitch);
+	header.height = texture.height;
+	header.width = texture.width;
+	header.pitchOrLinearSize = compressed ? (unsigned int)texture.mips[0].size : (unsigned int)texture.mips[0].rowPitch;
+	header.mipMapCount = (unsigned int)texture.mips.size();
+	header.pixelFormat.size = sizeof(DdsPixelFormat);
+	header.pixelFormat.flags = DdsPixelFormatFourCC;
+	header.pixelFormat.fourCC = DDS_FOURCC_DX10;
+	header.caps = DdsCapsTexture | (texture.mips.size() > 1 ? DdsCapsMipMap : 0);
+
+	memset(&extension, 0, sizeof(DdsHeaderDx10));
+	extension.dxgiFormat = GetDxgiFormat(texture.format, texture.srgb);
+	extension.resourceDimension = DdsDimensionTexture2D;
+	extension.arraySize = 1;
+
+	fout.open(filename, ios::out | ios::binary | ios::trunc);
+	if(fout.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not create the texture %s.", filename);
+		return false;
+	}
+
+	fout.write((const char*)&DDS_MAGIC, sizeof(DDS_MAGIC));
+	fout.write((const char*)&header, sizeof(DdsHeader));
+	fout.write((const char*)&extension, sizeof(DdsHeaderDx10));
+	fout.write((const char*)&texture.data[0], texture.data.size());
+	fout.close();
+
+	if(fout.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not write the texture %s.", filename);
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds a sample to a data format descriptor: where one channel is in a texel block. </summary>
+///
+/// <param name="descriptor"> [in,out] The descriptor. </param>
+/// <param name="bitOffset">  The first bit of the channel. </param>
+/// <param name="bitLength">  The bits of the channel. </param>
+/// <param name="channel">	  The channel, with its qualifiers. </param>
+/// <param name="upper">	  The value of the channel at 1. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void AddKtx2Sample(vector<unsigned int>& descriptor, int bitOffset, int bitLength, unsigned int channel, unsigned int upper)
+{
+	descriptor.push_back((unsigned int)bitOffset | (unsigned int)(bitLength - 1) << 16 | channel << 24);
+	descriptor.push_back(0);
+	descriptor.push_back(0);
+	descriptor.push_back(upper);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds the data format descriptor KTX2 requires, which says again what the format says:
+/// 	the colour model, the transfer function, the size of a texel block and its channels.
+/// </summary>
+///
+/// <param name="format">	  The format. </param>
+/// <param name="srgb">		  true for the sRGB variant. </param>
+/// <param name="descriptor"> [out] The descriptor, its total size first. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void BuildKtx2Descriptor(TextureFormat format, bool srgb, vector<unsigned int>& descriptor)
+{
+	unsigned int model, blockDimensions, alphaChannel;
+
+	switch(format)
+	{
+	case TEXTURE_FORMAT_BC1:
+		model = Ktx2ModelBc1;
+		blockDimensions = Ktx2BlockOf4x4;
+		break;
+	case TEXTURE_FORMAT_BC3:
+		model = Ktx2ModelBc3;
+		blockDimensions = Ktx2BlockOf4x4;
+		break;
+	case TEXTURE_FORMAT_BC7:
+		model = Ktx2ModelBc7;
+		blockDimensions = Ktx2BlockOf4x4;
+		break;
+	default:
+		model = Ktx2ModelRgbsda;
+		blockDimensions = 0;
+		break;
+	}
+
+	// The alpha of an sRGB texture is linear, which its sample has to say.
+	alphaChannel = Ktx2ChannelAlpha | (srgb ? Ktx2SampleLinear : 0);
+
+	// The basic descriptor block: its type and version, the colour model, the texel block and its bytes.
+	descriptor.clear();
+	descriptor.push_back(0);
+	descriptor.push_back(0);
+	descriptor.push_back(2);
+	descriptor.push_back(model | Ktx2PrimariesBt709 << 8 | (srgb ? Ktx2TransferSrgb : Ktx2TransferLinear) << 16);
+	descriptor.push_back(blockDimensions);
+	descriptor.push_back((unsigned int)TextureCompressionClass::GetRowPitch(format, 1));
+	descriptor.push_back(0);
+
+	switch(format)
+	{
+	case TEXTURE_FORMAT_BC1:
+		AddKtx2Sample(descriptor, 0, 64, 0, 0xFFFFFFFF);
+		break;
+	case TEXTURE_FORMAT_BC3:
+		AddKtx2Sample(descriptor, 0, 64, alphaChannel, 0xFFFFFFFF);
+		AddKtx2Sample(descriptor, 64, 64, 0, 0xFFFFFFFF);
+		break;
+	case TEXTURE_FORMAT_BC7:
+		AddKtx2Sample(descriptor, 0, 128, 0, 0xFFFFFFFF);
+		break;
+	default:
+		AddKtx2Sample(descriptor, 0, 8, 0, 255);
+		AddKtx2Sample(descriptor, 8, 8, 1, 255);
+		AddKtx2Sample(descriptor, 16, 8, 2, 255);
+		AddKtx2Sample(descriptor, 24, 8, alphaChannel, 255);
+		break;
+	}
+
+	// The sizes go in last: of the whole descriptor, and of the block after the total.
+	descriptor[0] = (unsigned int)(descriptor.size() * sizeof(unsigned int));
+	descriptor[2] |= (descriptor[0] - (unsigned int)sizeof(unsigned int)) << 16;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Writes a texture to a KTX2 file. The levels are stored smallest first, each aligned to
+/// 	its blocks, so a loader can read the small ones without going past them.
+/// </summary>
+///
+/// <param name="filename"> Filename of the file. </param>
+/// <param name="texture">  The texture. </param>
+///
+/// <returns> false if there is no texture or the file can't be written. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureBuilderClass::WriteKtx2(const char* filename, const TextureData& texture)
+{
+	ofstream fout;
+	Ktx2Header header;
+	vector<Ktx2Level> levels;
+	vector<unsigned int> descriptor;
+	vector<char> file;
+	size_t alignment, offset;
+	int i;
+
+	if(texture.mips.empty() || texture.data.empty())
+	{
+		return false;
+	}
+
+	BuildKtx2Descriptor(texture.format, texture.srgb, descriptor);
+
+	memset(&header, 0, sizeof(Ktx2Header));
+	memcpy(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+	header.vkFormat = GetVkFormat(texture.format, texture.srgb);
+	header.typeSize = 1;
+	header.pixelWidth = texture.width;
+	header.pixelHeight = texture.height;
+	header.faceCount = 1;
+	header.levelCount = (unsigned int)texture.mips.size();
+	header.dfdByteOffset = (unsigned int)(sizeof(Ktx2Header) + sizeof(Ktx2Level) * texture.mips.size());
+	header.dfdByteLength = (unsigned int)(descriptor.size() * sizeof(unsigned int));
+
+	// The bytes of a block are a multiple of 4, so they are all the alignment a level needs.
+	alignment = (size_t)TextureCompressionClass::GetRowPitch(texture.format, 1);
+	levels.resize(texture.mips.size());
+	offset = header.dfdByteOffset + header.dfdByteLength;
+	for(i=(int)texture.mips.size()-1; i>=0; i--)
+	{
+		offset = (offset + alignment - 1) / alignment * alignment;
+		levels[i].byteOffset = offset;
+		levels[i].byteLength = texture.mips[i].size;
+		levels[i].uncompressedByteLength = texture.mips[i].size;
+		offset += texture.mips[i].size;
+	}
+
+	file.assign(offset, 0);
+	memcpy(&file[0], &header, sizeof(Ktx2Header));
+	memcpy(&file[sizeof(Ktx2Header)], &levels[0], sizeof(Ktx2Level) * levels.size());
+	memcpy(&file[header.dfdByteOffset], &descriptor[0], header.dfdByteLength);
+	for(i=0; i<(int)texture.mips.size(); i++)
+	{
+		memcpy(&file[(size_t)levels[i].byteOffset], &texture.data[texture.mips[i].offset], texture.mips[i].size);
+	}
+
+	fout.open(filename, ios::out | ios::binary | ios::trunc);
+	if(fout.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not create the texture %s.", filename);
+		return false;
+	}
+
+	fout.write(&file[0], file.size());
+	fout.close();
+
+	if(fout.fail())
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not write the texture %s.", filename);
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the DXGI format a texture is created in, as its number so this builds without the SDK. </summary>
+///
+/// <param name="format"> The format. </param>
+/// <param name="srgb">   true for the sRGB variant, which the GPU takes back to linear light when sampling. </param>
+///
+/// <returns> The DXGI format. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned int TextureBuilderClass::GetDxgiFormat(TextureFormat format, bool srgb)
+{
+	switch(format)
+	{
+	case TEXTURE_FORMAT_BC1:
+		return srgb ? 72 : 71;
+	case TEXTURE_FORMAT_BC3:
+		return srgb ? 78 : 77;
+	case TEXTURE_FORMAT_BC7:
+		return srgb ? 99 : 98;
+	default:
+		return srgb ? 29 : 28;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the Vulkan format a KTX2 file names a texture by, as its number. BC1 is the opaque variant the encoder writes. </summary>
+///
+/// <param name="format"> The format. </param>
+/// <param name="srgb">   true for the sRGB variant. </param>
+///
+/// <returns> The Vulkan format. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned int TextureBuilderClass::GetVkFormat(TextureFormat format, bool srgb)
+{
+	switch(format)
+	{
+	case TEXTURE_FORMAT_BC1:
+		return srgb ? 132 : 131;
+	case TEXTURE_FORMAT_BC3:
+		return srgb ? 138 : 137;
+	case TEXTURE_FORMAT_BC7:
+		return srgb ? 146 : 145;
+	default:
+		return srgb ? 43 : 37;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Times the encoding of an image into one format, checks the workers wrote the same blocks and measures what was lost. </summary>
+///
+/// <param name="image">  The image. </param>
+/// <param name="format"> The format. </param>
+/// <param name="result"> [out] What was measured. </param>
+///
+/// <returns> false if the encoding or decoding failed, or the workers wrote other blocks. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool BenchmarkFormat(const TextureImage& image, TextureFormat format, TextureEncodeBenchmark& result)
+{
+	vector<unsigned char> serial, parallel, decoded;
+	unsigned long long start;
+	double megabytes;
+
+	serial.resize(TextureCompressionClass::GetSize(format, image.width, image.height));
+	parallel.resize(serial.size());
+	decoded.resize(image.pixels.size());
+	megabytes = image.pixels.size() / (1024.0 * 1024.0);
+
+	start = ProfilerClass::GetTimestamp();
+	if(!TextureCompressionClass::Encode(&image.pixels[0], image.width, image.height, format, &serial[0], 0))
+	{
+		return false;
+	}
+	result.serialMegabytesPerSecond = megabytes / (ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start) * 0.001);
+
+	start = ProfilerClass::GetTimestamp();
+	if(!TextureCompressionClass::Encode(&image.pixels[0], image.width, image.height, format, &parallel[0]))
+	{
+		return false;
+	}
+	result.parallelMegabytesPerSecond = megabytes / (ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start) * 0.001);
+
+	if(serial != parallel || !TextureCompressionClass::Decode(&serial[0], image.width, image.height, format, &decoded[0]))
+	{
+		return false;
+	}
+
+	// BC1 has no alpha to lose.
+	result.psnr = TextureCompressionClass::GetPsnr(&image.pixels[0], &decoded[0], image.width, image.height, format != TEXTURE_FORMAT_BC1);
+	result.ratio = (int)(image.pixels.size() / serial.size());
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Times the mip chain of a made up image of smooth gradients, hard edges and noise, on one
+/// 	thread and on the workers, then the encoding into each format, and measures the PSNR of
+/// 	each against the image.
+/// </summary>
+///
+/// <param name="size">   The width and height of the image. </param>
+/// <param name="result"> [out] What was measured. </param>
+///
+/// <returns> false if the image is empty or a step failed. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureBuilderClass::Benchmark(int size, TextureBenchmark& result)
+{
+	TextureImage image;
+	vector<TextureImage> serialMips, parallelMips;
+	unsigned long long start;
+	unsigned char* pixel;
+	unsigned int seed, i;
+	float u, v, noise, distance;
+	int x, y;
+
+	memset(&result, 0, sizeof(TextureBenchmark));
+	if(size <= 0)
+	{
+		return false;
+	}
+
+	image.width = size;
+	image.height = size;
+	image.pixels.resize((size_t)size * size * 4);
+	seed = 1;
+	for(y=0; y<size; y++)
+	{
+		for(x=0; x<size; x++)
+		{
+			u = x / (float)size;
+			v = y / (float)size;
+			noise = NextRandom(seed) * 24.0f - 12.0f;
+			distance = sqrtf((u - 0.5f) * (u - 0.5f) + (v - 0.5f) * (v - 0.5f)) * 2.0f;
+			pixel = &image.pixels[((size_t)y * size + x) * 4];
+			pixel[0] = (unsigned char)(128.0f + 100.0f * sinf(u * 12.0f + v * 3.0f) + noise);
+			pixel[1] = (unsigned char)(v * 200.0f + 20.0f + noise);
+			pixel[2] = (unsigned char)((((x / 16) + (y / 16)) & 1) ? 200.0f + noise : 40.0f + noise);
+			pixel[3] = (unsigned char)(distance < 1.0f ? 255.0f * (1.0f - distance) : 0.0f);
+		}
+	}
+
+	result.size = size;
+
+	start = ProfilerClass::GetTimestamp();
+	if(!GenerateMips(image, true, serialMips, 0))
+	{
+		return false;
+	}
+	result.mipSerialMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+
+	start = ProfilerClass::GetTimestamp();
+	if(!GenerateMips(image, true, parallelMips))
+	{
+		return false;
+	}
+	result.mipParallelMs = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+	result.mips = (int)serialMips.size();
+
+	// The workers must make the same levels.
+	for(i=0; i<serialMips.size(); i++)
+	{
+		if(serialMips[i].pixels != parallelMips[i].pixels)
+		{
+			return false;
+		}
+	}
+
+	return BenchmarkFormat(image, TEXTURE_FORMAT_BC1, result.bc1) && BenchmarkFormat(image, TEXTURE_FORMAT_BC3, result.bc3) && BenchmarkFormat(image, TEXTURE_FORMAT_BC7, result.bc7);
+}
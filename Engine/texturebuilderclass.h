@@ -0,0 +1,206 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	texturebuilderclass.h
+//
+// summary:	Declares the texturebuilderclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _TEXTUREBUILDERCLASS_H_
+#define _TEXTUREBUILDERCLASS_H_
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "texturecompressionclass.h"
+
+// Globals.
+const int TEXTURE_MIP_ROWS_PER_TASK = 32;
+const int TEXTURE_PARALLEL_MIP_PIXELS = 64 * 1024;
+const int TEXTURE_SRGB_TABLE_SIZE = 4096;
+const int TEXTURE_BENCHMARK_SMALL = 256;
+const int TEXTURE_BENCHMARK_LARGE = 1024;
+const unsigned int DDS_MAGIC = 0x20534444;
+const unsigned int DDS_FOURCC_DX10 = 0x30315844;
+const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The pixel format of a DDS file. With the DX10 four character code the format is in the header after it. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct DdsPixelFormat
+{
+	unsigned int size;
+	unsigned int flags;
+	unsigned int fourCC;
+	unsigned int rgbBitCount;
+	unsigned int rBitMask;
+	unsigned int gBitMask;
+	unsigned int bBitMask;
+	unsigned int aBitMask;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The header of a DDS file, after its magic number. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct DdsHeader
+{
+	unsigned int size;
+	unsigned int flags;
+	unsigned int height;
+	unsigned int width;
+	unsigned int pitchOrLinearSize;
+	unsigned int depth;
+	unsigned int mipMapCount;
+	unsigned int reserved1[11];
+	DdsPixelFormat pixelFormat;
+	unsigned int caps;
+	unsigned int caps2;
+	unsigned int caps3;
+	unsigned int caps4;
+	unsigned int reserved2;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> The DX10 header of a DDS file, which names its DXGI format. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct DdsHeaderDx10
+{
+	unsigned int dxgiFormat;
+	unsigned int resourceDimension;
+	unsigned int miscFlag;
+	unsigned int arraySize;
+	unsigned int miscFlags2;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The header of a KTX2 file. The level index follows it, then the data format descriptor,
+/// 	then the levels themselves, smallest first.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct Ktx2Header
+{
+	unsigned char identifier[12];
+	unsigned int vkFormat;
+	unsigned int typeSize;
+	unsigned int pixelWidth;
+	unsigned int pixelHeight;
+	unsigned int pixelDepth;
+	unsigned int layerCount;
+	unsigned int faceCount;
+	unsigned int levelCount;
+	unsigned int supercompressionScheme;
+	unsigned int dfdByteOffset;
+	unsigned int dfdByteLength;
+	unsigned int kvdByteOffset;
+	unsigned int kvdByteLength;
+	unsigned long long sgdByteOffset;
+	unsigned long long sgdByteLength;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Where one level of a KTX2 file is, the largest first. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct Ktx2Level
+{
+	unsigned long long byteOffset;
+	unsigned long long byteLength;
+	unsigned long long uncompressedByteLength;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> An image as it comes in: RGBA8 pixels, row by row from the top. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextureImage
+{
+	int width;
+	int height;
+	vector<unsigned char> pixels;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Where a mip level is in the data of a texture, and the bytes of one of its rows. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextureMip
+{
+	int width;
+	int height;
+	int rowPitch;
+	size_t offset;
+	size_t size;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A texture ready for the GPU: its format, whether its colours are sRGB, and every mip
+/// 	level from the largest one after the other in one block of data.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextureData
+{
+	TextureFormat format;
+	bool srgb;
+	int width;
+	int height;
+	vector<TextureMip> mips;
+	vector<unsigned char> data;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> What one format measured in a benchmark: the source megabytes encoded a second on one thread and on the workers, and the PSNR of the colour and alpha. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextureEncodeBenchmark
+{
+	double serialMegabytesPerSecond;
+	double parallelMegabytesPerSecond;
+	double psnr;
+	int ratio;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	What one benchmark measured on a made up image: the mip chain in ms on one thread and
+/// 	on the workers, then each compressed format.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextureBenchmark
+{
+	int size;
+	int mips;
+	double mipSerialMs;
+	double mipParallelMs;
+	TextureEncodeBenchmark bc1;
+	TextureEncodeBenchmark bc3;
+	TextureEncodeBenchmark bc7;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Imports images into textures, offline with "-buildtexture" or on a loader thread: reads a
+/// 	TGA, makes its mip chain and encodes every level into a block compressed format, which
+/// 	the GPU samples as it is at a quarter to an eighth of the memory and load bandwidth of
+/// 	the raw pixels. The result can be written to a DDS or a KTX2 file.
+///
+/// 	The mips are averaged 2x2 in linear light: an sRGB image is taken out of its curve
+/// 	through a table, averaged and put back through another, so the smaller levels don't get
+/// 	darker the way averaging the stored values does. The alpha is averaged as it is. Rows of
+/// 	each level are split between the workers, as are the blocks when encoding.
+///
+/// 	Nothing is kept between calls, so any thread can import at the same time.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class TextureBuilderClass
+{
+public:
+	static bool DecodeTga(const vector<char>&, TextureImage&);
+	static bool LoadTga(const char*, TextureImage&);
+	static bool GenerateMips(const TextureImage&, bool, vector<TextureImage>&, int = -1);
+	static bool Build(const TextureImage&, TextureFormat, bool, TextureData&, int = -1);
+	static bool WriteDds(const char*, const TextureData&);
+	static bool WriteKtx2(const char*, const TextureData&);
+	static unsigned int GetDxgiFormat(TextureFormat, bool);
+	static unsigned int GetVkFormat(TextureFormat, bool);
+
+	static bool Benchmark(int, TextureBenchmark&);
+};
+
+#endif
@@ -0,0 +1,352 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	textureclass.cpp
+//
+// summary:	Implements the textureclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "textureclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TextureClass::TextureClass()
+{
+	m_texture = 0;
+	m_textureView = 0;
+	m_residencyManager = 0;
+	m_residencyHandle = -1;
+	m_size = 0;
+	m_device = 0;
+	m_file = 0;
+	m_firstMip = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TextureClass::TextureClass(const TextureClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TextureClass::~TextureClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Creates the texture and its view from the data of every mip level, releasing the ones it
+/// 	had before. The data isn't kept, so the texture can't be evicted.
+/// </summary>
+///
+/// <param name="device">			The device. </param>
+/// <param name="data">				The texture, as the builder made it. </param>
+/// <param name="residencyManager"> The residency manager the video memory is accounted in, or 0. </param>
+///
+/// <returns> true if it succeeds, false if it fails, and then the old texture is kept. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureClass::Initialize(ID3D11Device* device, const TextureData& data, ResidencyManagerClass* residencyManager)
+{
+	vector<D3D11_SUBRESOURCE_DATA> levels;
+	unsigned int i;
+	bool result;
+
+	if(data.mips.empty() || data.data.empty())
+	{
+		return false;
+	}
+
+	// Every level is in the data already, one after the other, so the texture is created filled and immutable.
+	levels.resize(data.mips.size());
+	for(i=0; i<data.mips.size(); i++)
+	{
+		levels[i].pSysMem = &data.data[data.mips[i].offset];
+		levels[i].SysMemPitch = data.mips[i].rowPitch;
+		levels[i].SysMemSlicePitch = (UINT)data.mips[i].size;
+	}
+
+	result = Create(device, data.format, data.srgb, data.width, data.height, levels, data.data.size());
+	if(!result)
+	{
+		return false;
+	}
+
+	m_device = 0;
+	m_file = 0;
+	m_firstMip = 0;
+	Track(residencyManager, NULL);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Creates the texture and its view from the mips of a texture file, from one level to the
+/// 	smallest, releasing the ones it had before. The levels are handed to the device where
+/// 	they are in the file, which the driver copies from: the levels left out are never read.
+/// 	The texture keeps the file to create itself again after an eviction.
+/// </summary>
+///
+/// <param name="device">			The device. </param>
+/// <param name="file">				The texture file, it must stay open until Shutdown. </param>
+/// <param name="firstMip">			The largest mip created, later ones are kept when the file has fewer. </param>
+/// <param name="residencyManager"> The residency manager the video memory is accounted in, or 0. </param>
+///
+/// <returns> true if it succeeds, false if it fails, and then the old texture is kept. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureClass::Initialize(ID3D11Device* device, TextureFileClass& file, int firstMip, ResidencyManagerClass* residencyManager)
+{
+	bool result;
+
+	result = CreateFromFile(device, file, firstMip);
+	if(!result)
+	{
+		return false;
+	}
+
+	m_device = device;
+	m_file = &file;
+	m_firstMip = firstMip;
+	Track(residencyManager, this);
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the texture and its view. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TextureClass::Shutdown()
+{
+	if(m_residencyManager)
+	{
+		m_residencyManager->Unregister(m_residencyHandle);
+		m_residencyManager = 0;
+	}
+	m_residencyHandle = -1;
+	m_size = 0;
+	m_device = 0;
+	m_file = 0;
+	m_firstMip = 0;
+
+	Release();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Gets the view the pixel shader samples the texture through. This counts as a use of the
+/// 	texture for the residency manager, and creates it again first if it was evicted.
+/// </summary>
+///
+/// <returns> The view, 0 if there is no texture. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+ID3D11ShaderResourceView* TextureClass::GetTexture()
+{
+	if(m_residencyManager)
+	{
+		m_residencyManager->Touch(m_residencyHandle);
+	}
+
+	return m_textureView;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the bytes of video memory the texture takes. </summary>
+///
+/// <returns> The bytes of every mip level. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned long long TextureClass::GetSize()
+{
+	return m_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the largest mip of the file the texture was created from. </summary>
+///
+/// <returns> The mip, 0 if the texture has every level or wasn't made from a file. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int TextureClass::GetFirstMip()
+{
+	return m_firstMip;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the video memory of the texture, called by the residency manager. The file is kept. </summary>
+///
+/// <param name="handle"> The residency handle of the texture. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TextureClass::Evict(int handle)
+{
+	Release();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates the texture again from its file, called by the residency manager. </summary>
+///
+/// <param name="handle"> The residency handle of the texture. </param>
+///
+/// <returns> true if it succeeds, false if the file is gone or the device failed. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureClass::Restore(int handle)
+{
+	if(!m_file)
+	{
+		return false;
+	}
+
+	return CreateFromFile(m_device, *m_file, m_firstMip);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates the texture and its view from the mips of a texture file, from one level to the smallest. </summary>
+///
+/// <param name="device">   The device. </param>
+/// <param name="file">	    The texture file. </param>
+/// <param name="firstMip"> The largest mip created. </param>
+///
+/// <returns> true if it succeeds, false if it fails, and then the old texture is kept. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureClass::CreateFromFile(ID3D11Device* device, TextureFileClass& file, int firstMip)
+{
+	vector<D3D11_SUBRESOURCE_DATA> levels;
+	int i;
+
+	if(file.GetMipCount() == 0)
+	{
+		return false;
+	}
+
+	// At least the smallest mip is created.
+	firstMip = firstMip < file.GetMipCount() ? firstMip : file.GetMipCount() - 1;
+	firstMip = firstMip > 0 ? firstMip : 0;
+
+	levels.resize(file.GetMipCount() - firstMip);
+	for(i=firstMip; i<file.GetMipCount(); i++)
+	{
+		levels[i - firstMip].pSysMem = file.GetMip(i).data;
+		levels[i - firstMip].SysMemPitch = file.GetMip(i).rowPitch;
+		levels[i - firstMip].SysMemSlicePitch = (UINT)file.GetMip(i).size;
+	}
+
+	return Create(device, file.GetFormat(), file.IsSrgb(), file.GetMip(firstMip).width, file.GetMip(firstMip).height, levels, file.GetSize(firstMip));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Accounts for the texture in a residency manager, in place of what it was accounted as before. </summary>
+///
+/// <param name="residencyManager"> The residency manager, or 0. </param>
+/// <param name="streamable">		The texture if it can be evicted, or null. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TextureClass::Track(ResidencyManagerClass* residencyManager, StreamableResourceClass* streamable)
+{
+	if(m_residencyManager)
+	{
+		m_residencyManager->Unregister(m_residencyHandle);
+	}
+	m_residencyHandle = -1;
+
+	m_residencyManager = residencyManager;
+	if(m_residencyManager)
+	{
+		m_residencyHandle = m_residencyManager->Register(RESOURCE_TEXTURE, m_size, streamable);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the texture and its view. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TextureClass::Release()
+{
+	// Release the view.
+	if(m_textureView)
+	{
+		m_textureView->Release();
+		m_textureView = 0;
+	}
+
+	// Release the texture.
+	if(m_texture)
+	{
+		m_texture->Release();
+		m_texture = 0;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates an immutable texture filled with its mip levels and its view, then swaps them in for the ones it had. </summary>
+///
+/// <param name="device">			The device. </param>
+/// <param name="format">			The format. </param>
+/// <param name="srgb">				true for the sRGB variant of the format. </param>
+/// <param name="width">			The width of the largest level. </param>
+/// <param name="height">			The height of the largest level. </param>
+/// <param name="levels">			The data of every level, largest first. </param>
+/// <param name="size">				The bytes of all the levels. </param>
+///
+/// <returns> true if it succeeds, false if it fails, and then the old texture is kept. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureClass::Create(ID3D11Device* device, TextureFormat format, bool srgb, int width, int height, const vector<D3D11_SUBRESOURCE_DATA>& levels, size_t size)
+{
+	D3D11_TEXTURE2D_DESC textureDesc;
+	D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+	ID3D11Texture2D* texture;
+	ID3D11ShaderResourceView* textureView;
+	HRESULT result;
+
+	if(!device || levels.empty())
+	{
+		return false;
+	}
+
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.MipLevels = (UINT)levels.size();
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = (DXGI_FORMAT)TextureBuilderClass::GetDxgiFormat(format, srgb);
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.MiscFlags = 0;
+
+	result = device->CreateTexture2D(&textureDesc, &levels[0], &texture);
+	if(FAILED(result))
+	{
+		return false;
+	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
+	RenderStatsClass::Add(RENDER_COUNTER_UPLOAD_BYTES, size);
+
+	viewDesc.Format = textureDesc.Format;
+	viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	viewDesc.Texture2D.MostDetailedMip = 0;
+	viewDesc.Texture2D.MipLevels = textureDesc.MipLevels;
+
+	result = device->CreateShaderResourceView(texture, &viewDesc, &textureView);
+	if(FAILED(result))
+	{
+		texture->Release();
+		return false;
+	}
+	RenderStatsClass::Add(RENDER_COUNTER_RESOURCE_CREATIONS);
+
+	// Only now that the new texture exists is the old one released.
+	Release();
+
+	m_texture = texture;
+	m_textureView = textureView;
+	m_size = size;
+
+	return true;
+}
@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	textureclass.h
+//
+// summary:	Declares the textureclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _TEXTURECLASS_H_
+#define _TEXTURECLASS_H_
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// DirectX Includes.
+#include <d3d11.h>
+
+// Includes.
+#include "texturebuilderclass.h"
+#include "texturefileclass.h"
+#include "residencymanagerclass.h"
+#include "streamableresourceclass.h"
+#include "renderstatsclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A texture on the GPU, with every mip level of the data it was made from, and the view
+/// 	the pixel shader samples it through. The data is uploaded as it is, so a block
+/// 	compressed texture stays compressed in video memory.
+///
+/// 	Initializing a texture again swaps the new one in: the old texture and view are only
+/// 	released once the new ones exist, so whatever draws with it always has one. That is how
+/// 	a texture file streams in: created from its lower mips first, then again from all of
+/// 	them, each time straight from where the file is mapped.
+///
+/// 	A texture made from a file keeps it, so the residency manager may evict it when it is
+/// 	over the budget: the texture is released and created again from the file the next time
+/// 	GetTexture is called. The file must stay open until the texture is shut down. A texture
+/// 	made from data in memory doesn't keep it, and always stays resident.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class TextureClass : public StreamableResourceClass
+{
+public:
+	TextureClass();
+	TextureClass(const TextureClass&);
+	~TextureClass();
+
+	bool Initialize(ID3D11Device*, const TextureData&, ResidencyManagerClass*);
+	bool Initialize(ID3D11Device*, TextureFileClass&, int, ResidencyManagerClass*);
+	void Shutdown();
+
+	ID3D11ShaderResourceView* GetTexture();
+	unsigned long long GetSize();
+	int GetFirstMip();
+
+	void Evict(int);
+	bool Restore(int);
+
+private:
+	bool CreateFromFile(ID3D11Device*, TextureFileClass&, int);
+	bool Create(ID3D11Device*, TextureFormat, bool, int, int, const vector<D3D11_SUBRESOURCE_DATA>&, size_t);
+	void Track(ResidencyManagerClass*, StreamableResourceClass*);
+	void Release();
+
+private:
+	ID3D11Texture2D* m_texture;
+	ID3D11ShaderResourceView* m_textureView;
+	ResidencyManagerClass* m_residencyManager;
+	int m_residencyHandle;
+	unsigned long long m_size;
+	ID3D11Device* m_device;
+	TextureFileClass* m_file;
+	int m_firstMip;
+};
+
+#endif
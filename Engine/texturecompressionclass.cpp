@@ -0,0 +1,1174 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	texturecompressionclass.cpp
+//
+// summary:	Implements the texturecompressionclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "texturecompressionclass.h"
+
+// System Includes.
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#ifdef TEXTURE_COMPRESSION_SIMD
+#include <xmmintrin.h>
+#endif
+
+// Includes.
+#include "taskgraphclass.h"
+#include "profilerclass.h"
+
+// Globals.
+// How far each index of a palette is from the first end to the second: BC1 puts its two steps after
+// both ends, BC7 mode 6 has sixteen steps in 64ths.
+static const float Bc1Weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+static const int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+static const int BlockPixels = TEXTURE_BLOCK_SIZE * TEXTURE_BLOCK_SIZE;
+static const int PowerIterations = 8;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of bytes of one block of a compressed format. </summary>
+///
+/// <param name="format"> The format. </param>
+///
+/// <returns> The bytes of a block, 0 for the raw format. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static int GetBlockBytes(TextureFormat format)
+{
+	switch(format)
+	{
+	case TEXTURE_FORMAT_BC1:
+		return 8;
+	case TEXTURE_FORMAT_BC3:
+	case TEXTURE_FORMAT_BC7:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies a block of pixels out of an image, one array per channel, repeating the last row and column past the edges. </summary>
+///
+/// <param name="pixels"> The RGBA8 pixels of the image. </param>
+/// <param name="width">  The width of the image. </param>
+/// <param name="height"> The height of the image. </param>
+/// <param name="blockX"> The column of the block. </param>
+/// <param name="blockY"> The row of the block. </param>
+/// <param name="block">  [out] The channels of the sixteen pixels. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void FetchBlock(const unsigned char* pixels, int width, int height, int blockX, int blockY, float block[4][16])
+{
+	const unsigned char* pixel;
+	int x, y, i, c;
+
+	for(i=0; i<BlockPixels; i++)
+	{
+		x = blockX * TEXTURE_BLOCK_SIZE + i % TEXTURE_BLOCK_SIZE;
+		y = blockY * TEXTURE_BLOCK_SIZE + i / TEXTURE_BLOCK_SIZE;
+		x = x < width ? x : width - 1;
+		y = y < height ? y : height - 1;
+
+		pixel = pixels + ((size_t)y * width + x) * 4;
+		for(c=0; c<4; c++)
+		{
+			block[c][i] = (float)pixel[c];
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Finds the direction the pixels of a block spread along most, the principal axis of their
+/// 	covariance, by power iteration.
+/// </summary>
+///
+/// <param name="block">	The channels of the pixels. </param>
+/// <param name="channels"> How many channels to look at, 3 for the colour, 4 with the alpha. </param>
+/// <param name="mean">		[out] The mean of the pixels. </param>
+/// <param name="axis">		[out] The direction, of length one. </param>
+///
+/// <returns> false if the pixels are all the same, and there is no direction. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool GetPrincipalAxis(const float block[4][16], int channels, float mean[4], float axis[4])
+{
+	float covariance[4][4], next[4], length, largest;
+	int i, j, k, first;
+
+	for(j=0; j<4; j++)
+	{
+		mean[j] = 0.0f;
+		axis[j] = 0.0f;
+	}
+
+	for(j=0; j<channels; j++)
+	{
+		for(i=0; i<BlockPixels; i++)
+		{
+			mean[j] += block[j][i];
+		}
+		mean[j] /= (float)BlockPixels;
+	}
+
+	for(j=0; j<channels; j++)
+	{
+		for(k=j; k<channels; k++)
+		{
+			covariance[j][k] = 0.0f;
+			for(i=0; i<BlockPixels; i++)
+			{
+				covariance[j][k] += (block[j][i] - mean[j]) * (block[k][i] - mean[k]);
+			}
+			covariance[k][j] = covariance[j][k];
+		}
+	}
+
+	// Start from the channel that varies most, it can't be at right angles to the axis.
+	first = 0;
+	largest = covariance[0][0];
+	for(j=1; j<channels; j++)
+	{
+		if(covariance[j][j] > largest)
+		{
+			largest = covariance[j][j];
+			first = j;
+		}
+	}
+
+	if(largest < 1.0f)
+	{
+		return false;
+	}
+
+	for(j=0; j<channels; j++)
+	{
+		axis[j] = covariance[first][j];
+	}
+
+	for(i=0; i<PowerIterations; i++)
+	{
+		length = 0.0f;
+		for(j=0; j<channels; j++)
+		{
+			next[j] = 0.0f;
+			for(k=0; k<channels; k++)
+			{
+				next[j] += covariance[j][k] * axis[k];
+			}
+			length += next[j] * next[j];
+		}
+
+		if(length <= FLT_MIN)
+		{
+			return false;
+		}
+
+		length = 1.0f / sqrtf(length);
+		for(j=0; j<channels; j++)
+		{
+			axis[j] = next[j] * length;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the two ends of the line through the pixels of a block, along their principal axis. </summary>
+///
+/// <param name="block">	The channels of the pixels. </param>
+/// <param name="channels"> How many channels to look at. </param>
+/// <param name="end0">		[out] The end furthest along the axis. </param>
+/// <param name="end1">		[out] The other end. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void GetEnds(const float block[4][16], int channels, float end0[4], float end1[4])
+{
+	float mean[4], axis[4], minimum, maximum, t;
+	int i, c;
+
+	if(!GetPrincipalAxis(block, channels, mean, axis))
+	{
+		for(c=0; c<4; c++)
+		{
+			end0[c] = mean[c];
+			end1[c] = mean[c];
+		}
+		return;
+	}
+
+	minimum = FLT_MAX;
+	maximum = -FLT_MAX;
+	for(i=0; i<BlockPixels; i++)
+	{
+		t = 0.0f;
+		for(c=0; c<channels; c++)
+		{
+			t += (block[c][i] - mean[c]) * axis[c];
+		}
+		minimum = t < minimum ? t : minimum;
+		maximum = t > maximum ? t : maximum;
+	}
+
+	for(c=0; c<4; c++)
+	{
+		end0[c] = mean[c] + axis[c] * maximum;
+		end1[c] = mean[c] + axis[c] * minimum;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Fits the two ends of a palette to the entries the pixels chose, by least squares: each
+/// 	pixel is the mix of the ends its entry stands for, and the ends are the ones that get
+/// 	closest to all of them.
+/// </summary>
+///
+/// <param name="block">	The channels of the pixels. </param>
+/// <param name="channels"> How many channels to fit. </param>
+/// <param name="weights">  How far each pixel is from the first end to the second. </param>
+/// <param name="end0">		[out] The first end. </param>
+/// <param name="end1">		[out] The second end. </param>
+///
+/// <returns> false if every pixel chose the same mix, which fixes neither end. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool FitEnds(const float block[4][16], int channels, const float weights[16], float end0[4], float end1[4])
+{
+	float aa, ab, bb, a, b, determinant, ax[4], bx[4];
+	int i, c;
+
+	aa = 0.0f;
+	ab = 0.0f;
+	bb = 0.0f;
+	for(c=0; c<4; c++)
+	{
+		ax[c] = 0.0f;
+		bx[c] = 0.0f;
+	}
+
+	for(i=0; i<BlockPixels; i++)
+	{
+		a = 1.0f - weights[i];
+		b = weights[i];
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for(c=0; c<channels; c++)
+		{
+			ax[c] += a * block[c][i];
+			bx[c] += b * block[c][i];
+		}
+	}
+
+	determinant = aa * bb - ab * ab;
+	if(fabsf(determinant) < 1e-6f)
+	{
+		return false;
+	}
+
+	determinant = 1.0f / determinant;
+	for(c=0; c<channels; c++)
+	{
+		end0[c] = (ax[c] * bb - bx[c] * ab) * determinant;
+		end1[c] = (bx[c] * aa - ax[c] * ab) * determinant;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gives each pixel of a block the nearest entry of a palette. </summary>
+///
+/// <param name="block">	The channels of the pixels. </param>
+/// <param name="channels"> How many channels to compare. </param>
+/// <param name="palette">  The entries. </param>
+/// <param name="entries">  The number of entries. </param>
+/// <param name="indices">  [out] The entry of each pixel. </param>
+///
+/// <returns> The sum of the squared distances of the pixels to their entries. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float MatchPalette(const float block[4][16], int channels, const float palette[][4], int entries, int indices[16])
+{
+	float error;
+	int i, p, c;
+
+	error = 0.0f;
+
+#ifdef TEXTURE_COMPRESSION_SIMD
+	float distances[4], chosen[4];
+	__m128 best, bestIndex, distance, difference, closer;
+	int j;
+
+	// Four pixels at a time, against one entry after the other.
+	for(i=0; i<BlockPixels; i+=4)
+	{
+		best = _mm_set1_ps(FLT_MAX);
+		bestIndex = _mm_setzero_ps();
+		for(p=0; p<entries; p++)
+		{
+			distance = _mm_setzero_ps();
+			for(c=0; c<channels; c++)
+			{
+				difference = _mm_sub_ps(_mm_loadu_ps(&block[c][i]), _mm_set1_ps(palette[p][c]));
+				distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+			}
+
+			closer = _mm_cmplt_ps(distance, best);
+			best = _mm_min_ps(distance, best);
+			bestIndex = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps((float)p)), _mm_andnot_ps(closer, bestIndex));
+		}
+
+		_mm_storeu_ps(distances, best);
+		_mm_storeu_ps(chosen, bestIndex);
+		for(j=0; j<4; j++)
+		{
+			indices[i + j] = (int)chosen[j];
+			error += distances[j];
+		}
+	}
+#else
+	float best, distance, difference;
+
+	for(i=0; i<BlockPixels; i++)
+	{
+		best = FLT_MAX;
+		indices[i] = 0;
+		for(p=0; p<entries; p++)
+		{
+			distance = 0.0f;
+			for(c=0; c<channels; c++)
+			{
+				difference = block[c][i] - palette[p][c];
+				distance += difference * difference;
+			}
+
+			if(distance < best)
+			{
+				best = distance;
+				indices[i] = p;
+			}
+		}
+		error += best;
+	}
+#endif
+
+	return error;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Rounds a colour to 5, 6 and 5 bits. </summary>
+///
+/// <param name="color"> The colour, 0 to 255 a channel. </param>
+///
+/// <returns> The packed colour. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned short PackColor565(const float color[4])
+{
+	int r, g, b;
+
+	r = (int)(color[0] * (31.0f / 255.0f) + 0.5f);
+	g = (int)(color[1] * (63.0f / 255.0f) + 0.5f);
+	b = (int)(color[2] * (31.0f / 255.0f) + 0.5f);
+	r = r < 0 ? 0 : (r > 31 ? 31 : r);
+	g = g < 0 ? 0 : (g > 63 ? 63 : g);
+	b = b < 0 ? 0 : (b > 31 ? 31 : b);
+
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the palette of a BC1 colour block from its two packed ends, the way the GPU reads it. </summary>
+///
+/// <param name="color0">	 The first end. </param>
+/// <param name="color1">	 The second end. </param>
+/// <param name="fourColor"> true for the four colour palette, false for three colours and transparent black. </param>
+/// <param name="palette">	 [out] The four RGBA entries. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void GetColorPalette(unsigned short color0, unsigned short color1, bool fourColor, int palette[4][4])
+{
+	int c;
+
+	// The channels are widened to 8 bits by repeating their top bits below them.
+	palette[0][0] = ((color0 >> 8) & 0xf8) | ((color0 >> 13) & 7);
+	palette[0][1] = ((color0 >> 3) & 0xfc) | ((color0 >> 9) & 3);
+	palette[0][2] = ((color0 << 3) & 0xf8) | ((color0 >> 2) & 7);
+	palette[1][0] = ((color1 >> 8) & 0xf8) | ((color1 >> 13) & 7);
+	palette[1][1] = ((color1 >> 3) & 0xfc) | ((color1 >> 9) & 3);
+	palette[1][2] = ((color1 << 3) & 0xf8) | ((color1 >> 2) & 7);
+
+	for(c=0; c<3; c++)
+	{
+		if(fourColor)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		else
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+	}
+
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+	palette[2][3] = 255;
+	palette[3][3] = fourColor ? 255 : 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Packs two colour ends, first the larger so the block uses the four colour palette, and gets their palette. </summary>
+///
+/// <param name="end0">    The first end. </param>
+/// <param name="end1">    The second end. </param>
+/// <param name="color0">  [out] The first packed end. </param>
+/// <param name="color1">  [out] The second packed end. </param>
+/// <param name="palette"> [out] The palette the GPU will see. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void QuantizeColorEnds(const float end0[4], const float end1[4], unsigned short& color0, unsigned short& color1, float palette[4][4])
+{
+	int entries[4][4];
+	unsigned short swap;
+	int p, c;
+
+	color0 = PackColor565(end0);
+	color1 = PackColor565(end1);
+	if(color0 < color1)
+	{
+		swap = color0;
+		color0 = color1;
+		color1 = swap;
+	}
+
+	// Equal ends fall into the three colour palette, but every pixel then takes the first entry.
+	GetColorPalette(color0, color1, true, entries);
+	for(p=0; p<4; p++)
+	{
+		for(c=0; c<4; c++)
+		{
+			palette[p][c] = (float)entries[p][c];
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Encodes the colour of a block as BC1, which is also the second half of a BC3 block. </summary>
+///
+/// <param name="block">  The channels of the pixels. </param>
+/// <param name="output"> [out] The 8 bytes of the block. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void EncodeColorBlock(const float block[4][16], unsigned char* output)
+{
+	float end0[4], end1[4], palette[4][4], weights[16], error, refitError;
+	unsigned short color0, color1, refitColor0, refitColor1;
+	int indices[16], refitIndices[16], i;
+	unsigned int bits;
+
+	GetEnds(block, 3, end0, end1);
+	QuantizeColorEnds(end0, end1, color0, color1, palette);
+	error = MatchPalette(block, 3, palette, 4, indices);
+
+	// Fit the ends again to what the pixels chose, and keep them if the block got closer.
+	for(i=0; i<BlockPixels; i++)
+	{
+		weights[i] = Bc1Weights[indices[i]];
+	}
+
+	if(error > 0.0f && color0 != color1 && FitEnds(block, 3, weights, end0, end1))
+	{
+		QuantizeColorEnds(end0, end1, refitColor0, refitColor1, palette);
+		refitError = MatchPalette(block, 3, palette, 4, refitIndices);
+		if(refitError < error)
+		{
+			color0 = refitColor0;
+			color1 = refitColor1;
+			memcpy(indices, refitIndices, sizeof(indices));
+		}
+	}
+
+	bits = 0;
+	for(i=0; i<BlockPixels; i++)
+	{
+		bits |= (unsigned int)indices[i] << (i * 2);
+	}
+
+	output[0] = (unsigned char)(color0 & 0xff);
+	output[1] = (unsigned char)(color0 >> 8);
+	output[2] = (unsigned char)(color1 & 0xff);
+	output[3] = (unsigned char)(color1 >> 8);
+	output[4] = (unsigned char)(bits & 0xff);
+	output[5] = (unsigned char)((bits >> 8) & 0xff);
+	output[6] = (unsigned char)((bits >> 16) & 0xff);
+	output[7] = (unsigned char)(bits >> 24);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the palette of a BC3 alpha block from its two ends. </summary>
+///
+/// <param name="alpha0">  The first end. </param>
+/// <param name="alpha1">  The second end. </param>
+/// <param name="palette"> [out] The eight entries. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void GetAlphaPalette(int alpha0, int alpha1, int palette[8])
+{
+	int k;
+
+	palette[0] = alpha0;
+	palette[1] = alpha1;
+	if(alpha0 > alpha1)
+	{
+		// Six steps between the ends.
+		for(k=2; k<8; k++)
+		{
+			palette[k] = ((8 - k) * alpha0 + (k - 1) * alpha1) / 7;
+		}
+	}
+	else
+	{
+		// Four steps between the ends, then fully transparent and fully opaque.
+		for(k=2; k<6; k++)
+		{
+			palette[k] = ((6 - k) * alpha0 + (k - 1) * alpha1) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Encodes the alpha of a block as the first half of a BC3 block: the largest and smallest
+/// 	alpha as the ends, and each pixel the nearest of the six steps between them.
+/// </summary>
+///
+/// <param name="block">  The channels of the pixels. </param>
+/// <param name="output"> [out] The 8 bytes of the block. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void EncodeAlphaBlock(const float block[4][16], unsigned char* output)
+{
+	unsigned long long bits;
+	int alpha0, alpha1, step, code, i;
+
+	alpha0 = 0;
+	alpha1 = 255;
+	for(i=0; i<BlockPixels; i++)
+	{
+		alpha0 = (int)block[3][i] > alpha0 ? (int)block[3][i] : alpha0;
+		alpha1 = (int)block[3][i] < alpha1 ? (int)block[3][i] : alpha1;
+	}
+
+	// The step is how many sevenths of the way from the second end to the first, the code of step 7 is 0,
+	// of step 0 is 1 and of the steps between is 8 less the step.
+	bits = 0;
+	for(i=0; i<BlockPixels && alpha0 > alpha1; i++)
+	{
+		step = (int)(((int)block[3][i] - alpha1) * 7.0f / (float)(alpha0 - alpha1) + 0.5f);
+		code = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+		bits |= (unsigned long long)code << (i * 3);
+	}
+
+	output[0] = (unsigned char)alpha0;
+	output[1] = (unsigned char)alpha1;
+	for(i=0; i<6; i++)
+	{
+		output[2 + i] = (unsigned char)((bits >> (i * 8)) & 0xff);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes the lowest bits of a value into a block, lowest first. </summary>
+///
+/// <param name="output">   The block, cleared beforehand. </param>
+/// <param name="position"> [in,out] The bit to write at, moved past what was written. </param>
+/// <param name="value">    The value. </param>
+/// <param name="count">    The number of bits. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void WriteBits(unsigned char* output, int& position, unsigned int value, int count)
+{
+	int i;
+
+	for(i=0; i<count; i++, position++)
+	{
+		if((value >> i) & 1)
+		{
+			output[position >> 3] |= (unsigned char)(1 << (position & 7));
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads bits out of a block, lowest first. </summary>
+///
+/// <param name="input">    The block. </param>
+/// <param name="position"> [in,out] The bit to read at, moved past what was read. </param>
+/// <param name="count">    The number of bits. </param>
+///
+/// <returns> The value. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned int ReadBits(const unsigned char* input, int& position, int count)
+{
+	unsigned int value;
+	int i;
+
+	value = 0;
+	for(i=0; i<count; i++, position++)
+	{
+		value |= (unsigned int)((input[position >> 3] >> (position & 7)) & 1) << i;
+	}
+
+	return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Rounds an RGBA end of a BC7 mode 6 block to 7 bits a channel and the shared lowest bit
+/// 	that gives back the 8 bits closest to it.
+/// </summary>
+///
+/// <param name="end">    The end, 0 to 255 a channel. </param>
+/// <param name="values"> [out] The 7 bit channels. </param>
+/// <param name="pBit">   [out] The lowest bit. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void QuantizeBc7End(const float end[4], int values[4], int& pBit)
+{
+	int candidates[2][4], p, c;
+	float errors[2], difference;
+
+	for(p=0; p<2; p++)
+	{
+		errors[p] = 0.0f;
+		for(c=0; c<4; c++)
+		{
+			candidates[p][c] = (int)((end[c] - p) * 0.5f + 0.5f);
+			candidates[p][c] = candidates[p][c] < 0 ? 0 : (candidates[p][c] > 127 ? 127 : candidates[p][c]);
+			difference = (float)(candidates[p][c] * 2 + p) - end[c];
+			errors[p] += difference * difference;
+		}
+	}
+
+	pBit = errors[1] < errors[0] ? 1 : 0;
+	for(c=0; c<4; c++)
+	{
+		values[c] = candidates[pBit][c];
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the sixteen entry palette of a BC7 mode 6 block from its two 8 bit ends. </summary>
+///
+/// <param name="end0">    The first end. </param>
+/// <param name="end1">    The second end. </param>
+/// <param name="palette"> [out] The RGBA entries. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void GetBc7Palette(const int end0[4], const int end1[4], int palette[16][4])
+{
+	int k, c;
+
+	for(k=0; k<16; k++)
+	{
+		for(c=0; c<4; c++)
+		{
+			palette[k][c] = ((64 - Bc7Weights[k]) * end0[c] + Bc7Weights[k] * end1[c] + 32) >> 6;
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Quantizes the two ends of a BC7 mode 6 block and matches the pixels to their palette. </summary>
+///
+/// <param name="block">   The channels of the pixels. </param>
+/// <param name="end0">    The first end. </param>
+/// <param name="end1">    The second end. </param>
+/// <param name="values">  [out] The 7 bit channels of both ends. </param>
+/// <param name="pBits">   [out] The lowest bit of both ends. </param>
+/// <param name="indices"> [out] The entry of each pixel. </param>
+///
+/// <returns> The sum of the squared distances of the pixels to their entries. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static float QuantizeBc7Block(const float block[4][16], const float end0[4], const float end1[4], int values[2][4], int pBits[2], int indices[16])
+{
+	int ends[2][4], entries[16][4], k, c;
+	float palette[16][4];
+
+	QuantizeBc7End(end0, values[0], pBits[0]);
+	QuantizeBc7End(end1, values[1], pBits[1]);
+	for(c=0; c<4; c++)
+	{
+		ends[0][c] = values[0][c] * 2 + pBits[0];
+		ends[1][c] = values[1][c] * 2 + pBits[1];
+	}
+
+	GetBc7Palette(ends[0], ends[1], entries);
+	for(k=0; k<16; k++)
+	{
+		for(c=0; c<4; c++)
+		{
+			palette[k][c] = (float)entries[k][c];
+		}
+	}
+
+	return MatchPalette(block, 4, palette, 16, indices);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Encodes a block as BC7 mode 6, one pair of RGBA ends with sixteen steps between them. </summary>
+///
+/// <param name="block">  The channels of the pixels. </param>
+/// <param name="output"> [out] The 16 bytes of the block. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void EncodeBc7Block(const float block[4][16], unsigned char* output)
+{
+	float end0[4], end1[4], weights[16], error, refitError;
+	int values[2][4], pBits[2], indices[16];
+	int refitValues[2][4], refitPBits[2], refitIndices[16];
+	int position, swap, i, c;
+
+	GetEnds(block, 4, end0, end1);
+	error = QuantizeBc7Block(block, end0, end1, values, pBits, indices);
+
+	// Fit the ends again to what the pixels chose, and keep them if the block got closer.
+	for(i=0; i<BlockPixels; i++)
+	{
+		weights[i] = Bc7Weights[indices[i]] / 64.0f;
+	}
+
+	if(error > 0.0f && FitEnds(block, 4, weights, end0, end1))
+	{
+		refitError = QuantizeBc7Block(block, end0, end1, refitValues, refitPBits, refitIndices);
+		if(refitError < error)
+		{
+			memcpy(values, refitValues, sizeof(values));
+			memcpy(pBits, refitPBits, sizeof(pBits));
+			memcpy(indices, refitIndices, sizeof(indices));
+		}
+	}
+
+	// The top bit of the first index isn't stored, it must be 0: swap the ends and turn the indices around if it isn't.
+	if(indices[0] >= 8)
+	{
+		for(c=0; c<4; c++)
+		{
+			swap = values[0][c];
+			values[0][c] = values[1][c];
+			values[1][c] = swap;
+		}
+
+		swap = pBits[0];
+		pBits[0] = pBits[1];
+		pBits[1] = swap;
+
+		for(i=0; i<BlockPixels; i++)
+		{
+			indices[i] = 15 - indices[i];
+		}
+	}
+
+	// Mode 6 is six 0 bits and a 1, then each channel of both ends, the two lowest bits and the indices.
+	memset(output, 0, 16);
+	position = 0;
+	WriteBits(output, position, 1 << 6, 7);
+	for(c=0; c<4; c++)
+	{
+		WriteBits(output, position, values[0][c], 7);
+		WriteBits(output, position, values[1][c], 7);
+	}
+	WriteBits(output, position, pBits[0], 1);
+	WriteBits(output, position, pBits[1], 1);
+	WriteBits(output, position, indices[0], 3);
+	for(i=1; i<BlockPixels; i++)
+	{
+		WriteBits(output, position, indices[i], 4);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Decodes a BC7 block into its sixteen pixels, if it is in mode 6. </summary>
+///
+/// <param name="input">  The 16 bytes of the block. </param>
+/// <param name="pixels"> [out] The RGBA8 pixels, row by row. </param>
+///
+/// <returns> false if the block is in another mode. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool DecodeBc7Block(const unsigned char* input, unsigned char pixels[16][4])
+{
+	int ends[2][4], palette[16][4], position, index, i, c;
+
+	if((input[0] & 0x7f) != 0x40)
+	{
+		return false;
+	}
+
+	position = 7;
+	for(c=0; c<4; c++)
+	{
+		ends[0][c] = ReadBits(input, position, 7) << 1;
+		ends[1][c] = ReadBits(input, position, 7) << 1;
+	}
+
+	index = ReadBits(input, position, 1);
+	for(c=0; c<4; c++)
+	{
+		ends[0][c] |= index;
+	}
+
+	index = ReadBits(input, position, 1);
+	for(c=0; c<4; c++)
+	{
+		ends[1][c] |= index;
+	}
+
+	GetBc7Palette(ends[0], ends[1], palette);
+	for(i=0; i<BlockPixels; i++)
+	{
+		index = ReadBits(input, position, i == 0 ? 3 : 4);
+		for(c=0; c<4; c++)
+		{
+			pixels[i][c] = (unsigned char)palette[index][c];
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Decodes a BC1 block, or the colour half of a BC3 block, into its sixteen pixels. </summary>
+///
+/// <param name="input">	 The 8 bytes of the block. </param>
+/// <param name="fourColor"> true to always use the four colour palette, as BC3 does. </param>
+/// <param name="pixels">	 [out] The RGBA8 pixels, row by row. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void DecodeColorBlock(const unsigned char* input, bool fourColor, unsigned char pixels[16][4])
+{
+	unsigned short color0, color1;
+	unsigned int bits;
+	int palette[4][4], i, c;
+
+	color0 = (unsigned short)(input[0] | (input[1] << 8));
+	color1 = (unsigned short)(input[2] | (input[3] << 8));
+	bits = (unsigned int)input[4] | ((unsigned int)input[5] << 8) | ((unsigned int)input[6] << 16) | ((unsigned int)input[7] << 24);
+
+	GetColorPalette(color0, color1, fourColor || color0 > color1, palette);
+	for(i=0; i<BlockPixels; i++)
+	{
+		for(c=0; c<4; c++)
+		{
+			pixels[i][c] = (unsigned char)palette[(bits >> (i * 2)) & 3][c];
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Decodes the alpha half of a BC3 block into the alpha of its sixteen pixels. </summary>
+///
+/// <param name="input">  The 8 bytes of the block. </param>
+/// <param name="pixels"> [in,out] The RGBA8 pixels, row by row. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void DecodeAlphaBlock(const unsigned char* input, unsigned char pixels[16][4])
+{
+	unsigned long long bits;
+	int palette[8], i;
+
+	GetAlphaPalette(input[0], input[1], palette);
+
+	bits = 0;
+	for(i=0; i<6; i++)
+	{
+		bits |= (unsigned long long)input[2 + i] << (i * 8);
+	}
+
+	for(i=0; i<BlockPixels; i++)
+	{
+		pixels[i][3] = (unsigned char)palette[(bits >> (i * 3)) & 7];
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Encodes some rows of blocks of an image. </summary>
+///
+/// <param name="pixels">   The RGBA8 pixels of the image. </param>
+/// <param name="width">    The width of the image. </param>
+/// <param name="height">   The height of the image. </param>
+/// <param name="format">   The compressed format. </param>
+/// <param name="output">   [out] The blocks of the whole image. </param>
+/// <param name="firstRow"> The first row of blocks. </param>
+/// <param name="lastRow">  The row of blocks after the last one. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static void EncodeRows(const unsigned char* pixels, int width, int height, TextureFormat format, unsigned char* output, int firstRow, int lastRow)
+{
+	float block[4][16];
+	unsigned char* blockOutput;
+	int blocksX, blockBytes, x, y;
+
+	blocksX = (width + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+	blockBytes = GetBlockBytes(format);
+
+	for(y=firstRow; y<lastRow; y++)
+	{
+		for(x=0; x<blocksX; x++)
+		{
+			FetchBlock(pixels, width, height, x, y, block);
+			blockOutput = output + ((size_t)y * blocksX + x) * blockBytes;
+
+			switch(format)
+			{
+			case TEXTURE_FORMAT_BC1:
+				EncodeColorBlock(block, blockOutput);
+				break;
+			case TEXTURE_FORMAT_BC3:
+				EncodeAlphaBlock(block, blockOutput);
+				EncodeColorBlock(block, blockOutput + 8);
+				break;
+			case TEXTURE_FORMAT_BC7:
+				EncodeBc7Block(block, blockOutput);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Tells if a format is made of compressed blocks. </summary>
+///
+/// <param name="format"> The format. </param>
+///
+/// <returns> true for the BC formats. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureCompressionClass::IsCompressed(TextureFormat format)
+{
+	return GetBlockBytes(format) > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the bytes of one row of an image in a format, a row of blocks for the compressed ones. </summary>
+///
+/// <param name="format"> The format. </param>
+/// <param name="width">  The width of the image. </param>
+///
+/// <returns> The bytes of a row. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int TextureCompressionClass::GetRowPitch(TextureFormat format, int width)
+{
+	if(!IsCompressed(format))
+	{
+		return width * 4;
+	}
+
+	return (width + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE * GetBlockBytes(format);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the bytes of an image in a format. </summary>
+///
+/// <param name="format"> The format. </param>
+/// <param name="width">  The width of the image. </param>
+/// <param name="height"> The height of the image. </param>
+///
+/// <returns> The bytes of the image. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t TextureCompressionClass::GetSize(TextureFormat format, int width, int height)
+{
+	int rows;
+
+	rows = IsCompressed(format) ? (height + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE : height;
+
+	return (size_t)GetRowPitch(format, width) * rows;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Encodes an image into a format, the rows of blocks split between the workers when there are enough of them. </summary>
+///
+/// <param name="pixels">  The RGBA8 pixels of the image, row by row. </param>
+/// <param name="width">   The width of the image. </param>
+/// <param name="height">  The height of the image. </param>
+/// <param name="format">  The format to encode into. </param>
+/// <param name="output">  [out] Room for GetSize bytes. </param>
+/// <param name="workers"> The number of workers to run on, 0 runs on the calling thread, -1 on every core. </param>
+///
+/// <returns> false if the image is empty. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureCompressionClass::Encode(const unsigned char* pixels, int width, int height, TextureFormat format, unsigned char* output, int workers)
+{
+	int blocksY, first;
+	bool done;
+
+	PROFILE_FUNCTION();
+
+	if(width <= 0 || height <= 0 || !pixels || !output)
+	{
+		return false;
+	}
+
+	if(!IsCompressed(format))
+	{
+		memcpy(output, pixels, GetSize(format, width, height));
+		return true;
+	}
+
+	blocksY = (height + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+
+	done = false;
+	if(workers != 0 && blocksY >= TEXTURE_PARALLEL_BLOCK_ROWS)
+	{
+		TaskGraphClass tasks;
+
+		for(first=0; first<blocksY; first+=TEXTURE_BLOCK_ROWS_PER_TASK)
+		{
+			tasks.AddTask("TextureCompressionClass::Encode", [pixels, width, height, format, output, first, blocksY]() -> bool
+			{
+				EncodeRows(pixels, width, height, format, output, first, first + TEXTURE_BLOCK_ROWS_PER_TASK < blocksY ? first + TEXTURE_BLOCK_ROWS_PER_TASK : blocksY);
+				return true;
+			});
+		}
+
+		done = tasks.Run(workers);
+	}
+
+	// Without the workers the blocks are encoded here.
+	if(!done)
+	{
+		EncodeRows(pixels, width, height, format, output, 0, blocksY);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Decodes an image back into RGBA8 pixels, the way the GPU would sample it. </summary>
+///
+/// <param name="input">  The image in its format. </param>
+/// <param name="width">  The width of the image. </param>
+/// <param name="height"> The height of the image. </param>
+/// <param name="format"> The format of the image. </param>
+/// <param name="pixels"> [out] Room for the RGBA8 pixels, row by row. </param>
+///
+/// <returns> false if the image is empty, or a BC7 block isn't in mode 6. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureCompressionClass::Decode(const unsigned char* input, int width, int height, TextureFormat format, unsigned char* pixels)
+{
+	unsigned char decoded[16][4];
+	const unsigned char* block;
+	int blocksX, blocksY, blockBytes, bx, by, x, y, i;
+
+	if(width <= 0 || height <= 0 || !input || !pixels)
+	{
+		return false;
+	}
+
+	if(!IsCompressed(format))
+	{
+		memcpy(pixels, input, GetSize(format, width, height));
+		return true;
+	}
+
+	blocksX = (width + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+	blocksY = (height + TEXTURE_BLOCK_SIZE - 1) / TEXTURE_BLOCK_SIZE;
+	blockBytes = GetBlockBytes(format);
+
+	for(by=0; by<blocksY; by++)
+	{
+		for(bx=0; bx<blocksX; bx++)
+		{
+			block = input + ((size_t)by * blocksX + bx) * blockBytes;
+			switch(format)
+			{
+			case TEXTURE_FORMAT_BC1:
+				DecodeColorBlock(block, false, decoded);
+				break;
+			case TEXTURE_FORMAT_BC3:
+				DecodeColorBlock(block + 8, true, decoded);
+				DecodeAlphaBlock(block, decoded);
+				break;
+			default:
+				if(!DecodeBc7Block(block, decoded))
+				{
+					return false;
+				}
+				break;
+			}
+
+			// Only the pixels inside the image are kept.
+			for(i=0; i<BlockPixels; i++)
+			{
+				x = bx * TEXTURE_BLOCK_SIZE + i % TEXTURE_BLOCK_SIZE;
+				y = by * TEXTURE_BLOCK_SIZE + i / TEXTURE_BLOCK_SIZE;
+				if(x < width && y < height)
+				{
+					memcpy(pixels + ((size_t)y * width + x) * 4, decoded[i], 4);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Measures how close two images are, as the peak signal to noise ratio. </summary>
+///
+/// <param name="original"> The RGBA8 pixels of the first image. </param>
+/// <param name="decoded">  The RGBA8 pixels of the second image. </param>
+/// <param name="width">    The width of the images. </param>
+/// <param name="height">   The height of the images. </param>
+/// <param name="alpha">    true to count the alpha, false for the colour only. </param>
+///
+/// <returns> The ratio in dB, higher is closer, 100 for the same images. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+double TextureCompressionClass::GetPsnr(const unsigned char* original, const unsigned char* decoded, int width, int height, bool alpha)
+{
+	double error, difference;
+	size_t count, i;
+	int channels, c;
+
+	channels = alpha ? 4 : 3;
+	count = (size_t)width * height;
+	if(count == 0)
+	{
+		return 0.0;
+	}
+
+	error = 0.0;
+	for(i=0; i<count; i++)
+	{
+		for(c=0; c<channels; c++)
+		{
+			difference = (double)original[i * 4 + c] - (double)decoded[i * 4 + c];
+			error += difference * difference;
+		}
+	}
+
+	error /= (double)(count * channels);
+	if(error <= 0.0)
+	{
+		return 100.0;
+	}
+
+	return 10.0 * log10(255.0 * 255.0 / error);
+}
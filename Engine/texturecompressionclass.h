@@ -0,0 +1,66 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	texturecompressionclass.h
+//
+// summary:	Declares the texturecompressionclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _TEXTURECOMPRESSIONCLASS_H_
+#define _TEXTURECOMPRESSIONCLASS_H_
+
+// Pre-processing directives.
+// The palette of a block is matched against four pixels at once with SSE where the compiler has it, one by one elsewhere.
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE__)
+#define TEXTURE_COMPRESSION_SIMD
+#endif
+
+// System Includes.
+#include <cstddef>
+
+// Globals.
+const int TEXTURE_BLOCK_SIZE = 4;
+const int TEXTURE_BLOCK_ROWS_PER_TASK = 4;
+const int TEXTURE_PARALLEL_BLOCK_ROWS = 16;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Values that represent the formats a texture is kept in: the raw 8 bits a channel, or
+/// 	4x4 blocks of BC1 (opaque colour, 8 bytes), BC3 (colour and alpha, 16 bytes) or BC7
+/// 	(colour and alpha, 16 bytes, the best looking of the three).
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum TextureFormat
+{
+	TEXTURE_FORMAT_RGBA8,
+	TEXTURE_FORMAT_BC1,
+	TEXTURE_FORMAT_BC3,
+	TEXTURE_FORMAT_BC7
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Encodes RGBA8 pixels into the block compressed formats the GPU samples directly, and
+/// 	decodes them back to measure what was lost. A block takes the two ends of the line the
+/// 	pixels spread along most, found from their covariance, quantizes them, and gives each
+/// 	pixel the nearest point of the palette between them; the ends are then fitted again to
+/// 	those choices by least squares and kept if the block got closer.
+///
+/// 	BC1 and the colour of BC3 use the four colour palette, the alpha of BC3 the eight value
+/// 	one. BC7 is only written in mode 6, one pair of RGBA ends with sixteen steps between
+/// 	them, which is what most encoders fall back to and needs no partition search.
+///
+/// 	Images whose sides are not a multiple of four repeat their last row and column into
+/// 	the blocks. Nothing is kept between calls, so any thread can encode at the same time.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class TextureCompressionClass
+{
+public:
+	static bool IsCompressed(TextureFormat);
+	static int GetRowPitch(TextureFormat, int);
+	static size_t GetSize(TextureFormat, int, int);
+
+	static bool Encode(const unsigned char*, int, int, TextureFormat, unsigned char*, int = -1);
+	static bool Decode(const unsigned char*, int, int, TextureFormat, unsigned char*);
+	static double GetPsnr(const unsigned char*, const unsigned char*, int, int, bool);
+};
+
+#endif
@@ -0,0 +1,659 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	texturefileclass.cpp
+//
+// summary:	Implements the texturefileclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "texturefileclass.h"
+
+// System Includes.
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+// Includes.
+#include "platformclass.h"
+#include "profilerclass.h"
+#include "logclass.h"
+
+// Globals.
+static const unsigned int DdsFlagMipMapCount = 0x20000;
+static const unsigned int DdsPixelFormatFourCC = 0x4;
+static const unsigned int DdsPixelFormatRgb = 0x40;
+static const unsigned int DdsFourCCDxt1 = 0x31545844;
+static const unsigned int DdsFourCCDxt5 = 0x35545844;
+static const unsigned int DdsCaps2Cubemap = 0x200;
+static const unsigned int DdsCaps2Volume = 0x200000;
+static const unsigned int DdsDimensionTexture2D = 3;
+static const unsigned int DdsMiscTextureCube = 0x4;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the format a file names by its DXGI or Vulkan number. </summary>
+///
+/// <param name="value">  The number in the file. </param>
+/// <param name="vulkan"> true if it is a Vulkan format, false for DXGI. </param>
+/// <param name="format"> [out] The format. </param>
+/// <param name="srgb">   [out] true for the sRGB variant. </param>
+///
+/// <returns> false if the format is not one the engine has. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool FindFormat(unsigned int value, bool vulkan, TextureFormat& format, bool& srgb)
+{
+	const TextureFormat Formats[4] = { TEXTURE_FORMAT_RGBA8, TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC3, TEXTURE_FORMAT_BC7 };
+	int i, j;
+
+	for(i=0; i<4; i++)
+	{
+		for(j=0; j<2; j++)
+		{
+			if(value == (vulkan ? TextureBuilderClass::GetVkFormat(Formats[i], j == 1) : TextureBuilderClass::GetDxgiFormat(Formats[i], j == 1)))
+			{
+				format = Formats[i];
+				srgb = j == 1;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks the size of a texture, and that it has no more mips than its full chain. </summary>
+///
+/// <param name="width">	The width. </param>
+/// <param name="height">   The height. </param>
+/// <param name="mipCount"> The number of mips. </param>
+///
+/// <returns> true if the texture can be created. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool CheckSize(unsigned int width, unsigned int height, unsigned int mipCount)
+{
+	unsigned int size, chain;
+
+	if(width == 0 || height == 0 || width > TEXTURE_FILE_MAX_SIZE || height > TEXTURE_FILE_MAX_SIZE)
+	{
+		return false;
+	}
+
+	size = width > height ? width : height;
+	for(chain=1; size>1; chain++)
+	{
+		size /= 2;
+	}
+
+	return mipCount > 0 && mipCount <= chain;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads every byte of the mips of a texture once, what the creation of the texture does with them. </summary>
+///
+/// <param name="texture">  The texture. </param>
+/// <param name="firstMip"> The first mip read. </param>
+///
+/// <returns> The sum of the data, so the reads can't be left out and the passes can be compared. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static unsigned long long ReadMips(TextureFileClass& texture, int firstMip)
+{
+	const TextureFileMip* mip;
+	unsigned long long sum, word;
+	size_t i;
+	int level;
+
+	sum = 0;
+	for(level=firstMip; level<texture.GetMipCount(); level++)
+	{
+		mip = &texture.GetMip(level);
+		for(i=0; i+sizeof(word)<=mip->size; i+=sizeof(word))
+		{
+			memcpy(&word, mip->data + i, sizeof(word));
+			sum += word;
+		}
+		for(; i<mip->size; i++)
+		{
+			sum += mip->data[i];
+		}
+	}
+
+	return sum;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Runs one pass of the load benchmark: opens the whole set first, as a level load would
+/// 	before it creates the textures, then reads the data of each the way the creation does.
+/// 	Nothing is let go before the end, so the memory measured then is the peak of the pass.
+/// </summary>
+///
+/// <param name="fileSystem"> The file system the set is in. </param>
+/// <param name="names">	  The names of the files. </param>
+/// <param name="map">		  true to map the files, false to read them into memory. </param>
+/// <param name="firstMip">   The first mip created. </param>
+/// <param name="pass">		  [out] What was measured. </param>
+/// <param name="checksum">   [out] The sum of the data read. </param>
+///
+/// <returns> false if a file could not be opened. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+static bool RunLoadPass(FileSystemClass& fileSystem, const vector<string>& names, bool map, int firstMip, TextureLoadPass& pass, unsigned long long& checksum)
+{
+	TextureFileClass* textures;
+	vector<vector<char> > files;
+	unsigned long long residentBase, privateBase, residentBytes, privateBytes, start;
+	bool result;
+	unsigned int i;
+
+	memset(&pass, 0, sizeof(TextureLoadPass));
+	checksum = 0;
+	PlatformClass::GetMemoryUsage(residentBase, privateBase);
+
+	textures = new TextureFileClass[names.size()];
+	files.resize(names.size());
+	result = true;
+
+	start = ProfilerClass::GetTimestamp();
+	for(i=0; i<names.size() && result; i++)
+	{
+		if(map)
+		{
+			result = textures[i].Initialize(&fileSystem, names[i].c_str());
+		}
+		else
+		{
+			result = fileSystem.ReadFile(names[i].c_str(), files[i]) && !files[i].empty() && textures[i].Initialize(&files[i][0], files[i].size());
+		}
+	}
+
+	for(i=0; i<names.size() && result; i++)
+	{
+		checksum += ReadMips(textures[i], firstMip);
+		pass.bytes += textures[i].GetSize(firstMip);
+	}
+	pass.ms = ProfilerClass::TicksToMilliseconds(ProfilerClass::GetTimestamp() - start);
+	pass.megabytesPerSecond = pass.ms > 0.0 ? pass.bytes / (1024.0 * 1024.0) / (pass.ms / 1000.0) : 0.0;
+
+	if(PlatformClass::GetMemoryUsage(residentBytes, privateBytes))
+	{
+		pass.peakResidentBytes = residentBytes > residentBase ? residentBytes - residentBase : 0;
+		pass.peakPrivateBytes = privateBytes > privateBase ? privateBytes - privateBase : 0;
+	}
+
+	for(i=0; i<names.size(); i++)
+	{
+		textures[i].Shutdown();
+	}
+	delete [] textures;
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TextureFileClass::TextureFileClass()
+{
+	m_mapping = 0;
+	m_mappingSize = 0;
+	m_format = TEXTURE_FORMAT_RGBA8;
+	m_srgb = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TextureFileClass::TextureFileClass(const TextureFileClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TextureFileClass::~TextureFileClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Opens a texture file through the file system, mapping it when it can. </summary>
+///
+/// <param name="fileSystem"> The file system. </param>
+/// <param name="name">		  The name of the file, a .dds or .ktx2. </param>
+///
+/// <returns> false if the file can't be read or is not a texture the engine can use. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureFileClass::Initialize(FileSystemClass* fileSystem, const char* name)
+{
+	const char* data;
+	size_t size;
+	bool mapped;
+
+	PROFILE_FUNCTION();
+
+	Shutdown();
+
+	if(!fileSystem || !name)
+	{
+		return false;
+	}
+
+	data = fileSystem->MapFile(name, size, mapped);
+	if(mapped)
+	{
+		m_mapping = data;
+		m_mappingSize = size;
+	}
+
+	// A file compressed in a pack can't be used where it is, so it is read into memory.
+	if(!data)
+	{
+		if(!fileSystem->ReadFile(name, m_copy) || m_copy.empty())
+		{
+			LOG_ERROR(LOG_CATEGORY_RESOURCE, "Could not open the texture %s.", name);
+			return false;
+		}
+
+		data = &m_copy[0];
+		size = m_copy.size();
+	}
+
+	if(!Parse(data, size))
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "%s is not a DDS or KTX2 texture the engine can use.", name);
+		Shutdown();
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Opens a texture file already in memory, which the caller keeps until Shutdown. </summary>
+///
+/// <param name="data"> The contents of the file. </param>
+/// <param name="size"> The size of the file. </param>
+///
+/// <returns> false if it is not a texture the engine can use. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureFileClass::Initialize(const char* data, size_t size)
+{
+	Shutdown();
+
+	if(!Parse(data, size))
+	{
+		Shutdown();
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Forgets the mips, and unmaps the file or lets go of its copy. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TextureFileClass::Shutdown()
+{
+	m_mips.clear();
+
+	if(m_mapping)
+	{
+		PlatformClass::UnmapFile(m_mapping, m_mappingSize);
+		m_mapping = 0;
+		m_mappingSize = 0;
+	}
+
+	vector<char>().swap(m_copy);
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the format of the texture. </summary>
+///
+/// <returns> The format. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+TextureFormat TextureFileClass::GetFormat()
+{
+	return m_format;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if the colours of the texture are sRGB. </summary>
+///
+/// <returns> true if they are, false if they are linear. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureFileClass::IsSrgb()
+{
+	return m_srgb;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of mips, 0 if no file is open. </summary>
+///
+/// <returns> The number of mips. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int TextureFileClass::GetMipCount()
+{
+	return (int)m_mips.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets a mip, the largest first. </summary>
+///
+/// <param name="level"> The level of the mip. </param>
+///
+/// <returns> The mip, valid until Shutdown. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+const TextureFileMip& TextureFileClass::GetMip(int level)
+{
+	return m_mips[level];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the bytes of the mips from one level to the smallest, what a texture created from them takes. </summary>
+///
+/// <param name="firstMip"> The first mip. </param>
+///
+/// <returns> The bytes. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t TextureFileClass::GetSize(int firstMip)
+{
+	size_t size;
+	int i;
+
+	size = 0;
+	for(i=firstMip; i<(int)m_mips.size(); i++)
+	{
+		size += m_mips[i].size;
+	}
+
+	return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Measures the loading of a set of textures three ways: read into memory, the way every
+/// 	other asset is, then mapped with every mip, then mapped with the lower mips only. The
+/// 	set is one made up image encoded once and written as every file, half DDS and half
+/// 	KTX2. The files were just written, so they come from the file cache: this measures the
+/// 	loader, not the disk.
+/// </summary>
+///
+/// <param name="result"> [out] What was measured. </param>
+///
+/// <returns> false if the set could not be written or loaded, or the passes read other data. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureFileClass::Benchmark(TextureLoadBenchmark& result)
+{
+	TextureImage image;
+	TextureData texture;
+	FileSystemClass fileSystem;
+	vector<string> names;
+	unsigned long long copiedChecksum, mappedChecksum, lowMipsChecksum;
+	bool written, loaded;
+	int i, x, y;
+
+	memset(&result, 0, sizeof(TextureLoadBenchmark));
+	result.textures = TEXTURE_LOAD_BENCHMARK_COUNT;
+	result.size = TEXTURE_LOAD_BENCHMARK_SIZE;
+
+	image.width = TEXTURE_LOAD_BENCHMARK_SIZE;
+	image.height = TEXTURE_LOAD_BENCHMARK_SIZE;
+	image.pixels.resize((size_t)image.width * image.height * 4);
+	for(y=0; y<image.height; y++)
+	{
+		for(x=0; x<image.width; x++)
+		{
+			image.pixels[((size_t)y * image.width + x) * 4 + 0] = (unsigned char)(x ^ y);
+			image.pixels[((size_t)y * image.width + x) * 4 + 1] = (unsigned char)(x * y >> 6);
+			image.pixels[((size_t)y * image.width + x) * 4 + 2] = (unsigned char)(x + y);
+			image.pixels[((size_t)y * image.width + x) * 4 + 3] = 255;
+		}
+	}
+
+	if(!TextureBuilderClass::Build(image, TEXTURE_FORMAT_BC7, true, texture))
+	{
+		return false;
+	}
+
+	written = true;
+	for(i=0; i<TEXTURE_LOAD_BENCHMARK_COUNT && written; i++)
+	{
+		ostringstream name;
+
+		name << "textureload-" << i << (i % 2 ? ".ktx2" : ".dds");
+		names.push_back(name.str());
+		written = i % 2 ? TextureBuilderClass::WriteKtx2(names[i].c_str(), texture) : TextureBuilderClass::WriteDds(names[i].c_str(), texture);
+	}
+
+	loaded = false;
+	if(written && fileSystem.MountDirectory("."))
+	{
+		loaded = RunLoadPass(fileSystem, names, false, 0, result.copied, copiedChecksum) &&
+			RunLoadPass(fileSystem, names, true, 0, result.mapped, mappedChecksum) &&
+			RunLoadPass(fileSystem, names, true, TEXTURE_STREAMING_SKIP_MIPS, result.lowMips, lowMipsChecksum) &&
+			copiedChecksum == mappedChecksum;
+	}
+	fileSystem.Shutdown();
+
+	for(i=0; i<(int)names.size(); i++)
+	{
+		remove(names[i].c_str());
+	}
+
+	return loaded;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds the mips of a file from its headers. </summary>
+///
+/// <param name="data"> The contents of the file. </param>
+/// <param name="size"> The size of the file. </param>
+///
+/// <returns> false if it is neither a DDS nor a KTX2 file the engine can use. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureFileClass::Parse(const char* data, size_t size)
+{
+	m_format = TEXTURE_FORMAT_RGBA8;
+	m_srgb = false;
+	m_mips.clear();
+
+	if(!data)
+	{
+		return false;
+	}
+
+	if(size >= sizeof(DDS_MAGIC) + sizeof(DdsHeader) && memcmp(data, &DDS_MAGIC, sizeof(DDS_MAGIC)) == 0)
+	{
+		return ParseDds(data, size);
+	}
+
+	if(size >= sizeof(Ktx2Header) && memcmp(data, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+	{
+		return ParseKtx2(data, size);
+	}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Finds the mips of a DDS file. The format is named by the DX10 header, or by the old
+/// 	four character codes and bit masks of the ones the engine has. The mips follow the
+/// 	headers, largest first.
+/// </summary>
+///
+/// <param name="data"> The contents of the file. </param>
+/// <param name="size"> The size of the file. </param>
+///
+/// <returns> false if it is not a 2D texture in a format the engine has, or is cut short. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureFileClass::ParseDds(const char* data, size_t size)
+{
+	DdsHeader header;
+	DdsHeaderDx10 extension;
+	size_t offset, mipSize;
+	unsigned int mipCount, i;
+	int width, height;
+
+	// The headers are copied out, the file could be anywhere in memory.
+	memcpy(&header, data + sizeof(DDS_MAGIC), sizeof(DdsHeader));
+	offset = sizeof(DDS_MAGIC) + sizeof(DdsHeader);
+	if(header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat) || (header.caps2 & (DdsCaps2Cubemap | DdsCaps2Volume)))
+	{
+		return false;
+	}
+
+	if(header.pixelFormat.flags & DdsPixelFormatFourCC)
+	{
+		if(header.pixelFormat.fourCC == DDS_FOURCC_DX10)
+		{
+			if(size < offset + sizeof(DdsHeaderDx10))
+			{
+				return false;
+			}
+
+			memcpy(&extension, data + offset, sizeof(DdsHeaderDx10));
+			offset += sizeof(DdsHeaderDx10);
+			if(extension.resourceDimension != DdsDimensionTexture2D || extension.arraySize > 1 || (extension.miscFlag & DdsMiscTextureCube))
+			{
+				return false;
+			}
+
+			if(!FindFormat(extension.dxgiFormat, false, m_format, m_srgb))
+			{
+				return false;
+			}
+		}
+		else if(header.pixelFormat.fourCC == DdsFourCCDxt1)
+		{
+			m_format = TEXTURE_FORMAT_BC1;
+		}
+		else if(header.pixelFormat.fourCC == DdsFourCCDxt5)
+		{
+			m_format = TEXTURE_FORMAT_BC3;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else if((header.pixelFormat.flags & DdsPixelFormatRgb) && header.pixelFormat.rgbBitCount == 32 && header.pixelFormat.rBitMask == 0x000000FF &&
+		header.pixelFormat.gBitMask == 0x0000FF00 && header.pixelFormat.bBitMask == 0x00FF0000 && header.pixelFormat.aBitMask == 0xFF000000)
+	{
+		m_format = TEXTURE_FORMAT_RGBA8;
+	}
+	else
+	{
+		return false;
+	}
+
+	mipCount = (header.flags & DdsFlagMipMapCount) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+	if(!CheckSize(header.width, header.height, mipCount))
+	{
+		return false;
+	}
+
+	width = header.width;
+	height = header.height;
+	for(i=0; i<mipCount; i++)
+	{
+		mipSize = TextureCompressionClass::GetSize(m_format, width, height);
+		if(mipSize > size - offset)
+		{
+			m_mips.clear();
+			return false;
+		}
+
+		AddMip(width, height, data + offset);
+		offset += mipSize;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Finds the mips of a KTX2 file through its level index. Only plain 2D textures are taken,
+/// 	one layer and one face, and no supercompression: a supercompressed level would have to
+/// 	be decoded before it could be used.
+/// </summary>
+///
+/// <param name="data"> The contents of the file. </param>
+/// <param name="size"> The size of the file. </param>
+///
+/// <returns> false if it is not a texture the engine can use, or a level is not where it should be. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool TextureFileClass::ParseKtx2(const char* data, size_t size)
+{
+	Ktx2Header header;
+	Ktx2Level level;
+	unsigned long long mipSize, alignment;
+	unsigned int levelCount, i;
+	int width, height;
+
+	memcpy(&header, data, sizeof(Ktx2Header));
+	if(!FindFormat(header.vkFormat, true, m_format, m_srgb))
+	{
+		return false;
+	}
+
+	if(header.typeSize != 1 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1 || header.supercompressionScheme != 0)
+	{
+		return false;
+	}
+
+	// No levels asks for the mips to be made when loading, the file still has the first one.
+	levelCount = header.levelCount > 0 ? header.levelCount : 1;
+	if(!CheckSize(header.pixelWidth, header.pixelHeight, levelCount))
+	{
+		return false;
+	}
+
+	if(sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level) > size || (unsigned long long)header.dfdByteOffset + header.dfdByteLength > size)
+	{
+		return false;
+	}
+
+	alignment = (unsigned long long)TextureCompressionClass::GetRowPitch(m_format, 1);
+	width = header.pixelWidth;
+	height = header.pixelHeight;
+	for(i=0; i<levelCount; i++)
+	{
+		memcpy(&level, data + sizeof(Ktx2Header) + i * sizeof(Ktx2Level), sizeof(Ktx2Level));
+		mipSize = TextureCompressionClass::GetSize(m_format, width, height);
+		if(level.byteLength != mipSize || level.byteOffset % alignment != 0 || level.byteOffset > size || level.byteLength > size - level.byteOffset)
+		{
+			m_mips.clear();
+			return false;
+		}
+
+		AddMip(width, height, data + level.byteOffset);
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds the next mip, once the file was checked to hold it. </summary>
+///
+/// <param name="width">  The width of the mip. </param>
+/// <param name="height"> The height of the mip. </param>
+/// <param name="data">   Where the mip is in the file. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void TextureFileClass::AddMip(int width, int height, const char* data)
+{
+	TextureFileMip mip;
+
+	mip.width = width;
+	mip.height = height;
+	mip.rowPitch = TextureCompressionClass::GetRowPitch(m_format, width);
+	mip.data = (const unsigned char*)data;
+	mip.size = TextureCompressionClass::GetSize(m_format, width, height);
+	m_mips.push_back(mip);
+
+	return;
+}
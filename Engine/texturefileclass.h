@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	texturefileclass.h
+//
+// summary:	Declares the texturefileclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _TEXTUREFILECLASS_H_
+#define _TEXTUREFILECLASS_H_
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "texturebuilderclass.h"
+#include "filesystemclass.h"
+
+// Globals.
+const int TEXTURE_FILE_MAX_SIZE = 16384;
+const int TEXTURE_STREAMING_SKIP_MIPS = 2;
+const int TEXTURE_LOAD_BENCHMARK_COUNT = 48;
+const int TEXTURE_LOAD_BENCHMARK_SIZE = 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> One mip level of a texture file, where it is in the file. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextureFileMip
+{
+	int width;
+	int height;
+	int rowPitch;
+	const unsigned char* data;
+	size_t size;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> What one pass of the load benchmark measured, the memory on top of what the process had before it. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextureLoadPass
+{
+	unsigned long long bytes;
+	double ms;
+	double megabytesPerSecond;
+	unsigned long long peakResidentBytes;
+	unsigned long long peakPrivateBytes;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	What the load benchmark measured on a set of textures: read into memory then parsed,
+/// 	mapped with every mip, and mapped with only the lower mips.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct TextureLoadBenchmark
+{
+	int textures;
+	int size;
+	TextureLoadPass copied;
+	TextureLoadPass mapped;
+	TextureLoadPass lowMips;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	A texture file built offline, DDS or KTX2, opened where it is: the file is mapped and
+/// 	its headers are checked, and every mip level points into the mapping, ready to be handed
+/// 	to the creation of the texture as it is. Nothing is decoded or copied, and only the
+/// 	pages of the levels that are used are ever read from the disk, so a texture can be
+/// 	created from its lower mips first and from the whole chain later.
+///
+/// 	A file in a pack is used where the pack is mapped when it is stored uncompressed, and
+/// 	read into memory otherwise. The headers are checked against the size of the file before
+/// 	anything is pointed at, so a truncated or made up file fails to open instead of being
+/// 	read out of bounds.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class TextureFileClass
+{
+public:
+	TextureFileClass();
+	TextureFileClass(const TextureFileClass&);
+	~TextureFileClass();
+
+	bool Initialize(FileSystemClass*, const char*);
+	bool Initialize(const char*, size_t);
+	void Shutdown();
+
+	TextureFormat GetFormat();
+	bool IsSrgb();
+	int GetMipCount();
+	const TextureFileMip& GetMip(int);
+	size_t GetSize(int = 0);
+
+	static bool Benchmark(TextureLoadBenchmark&);
+
+private:
+	bool Parse(const char*, size_t);
+	bool ParseDds(const char*, size_t);
+	bool ParseKtx2(const char*, size_t);
+	void AddMip(int, int, const char*);
+
+private:
+	const char* m_mapping;
+	size_t m_mappingSize;
+	vector<char> m_copy;
+	TextureFormat m_format;
+	bool m_srgb;
+	vector<TextureFileMip> m_mips;
+};
+
+#endif
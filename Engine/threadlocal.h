@@ -0,0 +1,18 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	threadlocal.h
+//
+// summary:	Declares the thread local storage keyword
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _THREADLOCAL_H_
+#define _THREADLOCAL_H_
+
+// Pre-processing directives.
+// Variables marked THREAD_LOCAL get one copy per thread. Only plain data (pointers, integers) may
+// be marked, since the older compilers don't run constructors for thread local variables.
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+#endif
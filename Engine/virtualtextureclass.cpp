@@ -0,0 +1,756 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	virtualtextureclass.cpp
+//
+// summary:	Implements the virtualtextureclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "virtualtextureclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+// Includes.
+#include "profilerclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+VirtualTextureClass::VirtualTextureClass()
+{
+	m_source = 0;
+	m_leastRecent = -1;
+	m_mostRecent = -1;
+	m_uploadsPerFrame = VIRTUAL_TEXTURE_UPLOADS_PER_FRAME;
+	m_frame = 0;
+	memset(&m_stats, 0, sizeof(VirtualTextureStats));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+VirtualTextureClass::VirtualTextureClass(const VirtualTextureClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+VirtualTextureClass::~VirtualTextureClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Lays out the levels and the page table, and loads the tile of the last level for good. </summary>
+///
+/// <param name="source">	  The source of the tiles. </param>
+/// <param name="width">	  The width of the virtual texture in texels. </param>
+/// <param name="height">	  The height of the virtual texture in texels. </param>
+/// <param name="cacheTiles"> The number of slots of the physical cache. </param>
+///
+/// <returns> false if the texture has too many tiles or levels, or the last tile could not be loaded. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool VirtualTextureClass::Initialize(VirtualTileSourceClass* source, int width, int height, int cacheTiles)
+{
+	LevelType level;
+	PageType page;
+	SlotType slot;
+	size_t first;
+	int i;
+
+	Shutdown();
+
+	// The slot and the level of a tile share an entry of the page table built for the shader.
+	if(!source || width <= 0 || height <= 0 || cacheTiles < 2 || cacheTiles > 0x10000)
+	{
+		return false;
+	}
+
+	// Every level halves the last, down to the one that fits in a tile.
+	first = 0;
+	while(true)
+	{
+		level.tilesX = (width + VIRTUAL_TEXTURE_TILE_SIZE - 1) / VIRTUAL_TEXTURE_TILE_SIZE;
+		level.tilesY = (height + VIRTUAL_TEXTURE_TILE_SIZE - 1) / VIRTUAL_TEXTURE_TILE_SIZE;
+		level.first = first;
+		if(level.tilesX > (1 << VIRTUAL_TEXTURE_TILE_BITS) || level.tilesY > (1 << VIRTUAL_TEXTURE_TILE_BITS) || m_levels.size() == VIRTUAL_TEXTURE_MAX_LEVELS)
+		{
+			m_levels.clear();
+			return false;
+		}
+
+		m_levels.push_back(level);
+		first += (size_t)level.tilesX * level.tilesY;
+		if(level.tilesX == 1 && level.tilesY == 1)
+		{
+			break;
+		}
+
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+
+	page.slot = -1;
+	page.seen = 0;
+	page.requested = 0;
+	page.pixels = 0;
+	page.weight = 0;
+	m_pages.assign(first, page);
+
+	slot.tile = VIRTUAL_TILE_NONE;
+	slot.used = 0;
+	slot.previous = -1;
+	slot.next = -1;
+	slot.pinned = false;
+	m_slots.assign(cacheTiles, slot);
+
+	// The free slots are taken from the back, the first slot first.
+	for(i=cacheTiles-1; i>=0; i--)
+	{
+		m_freeSlots.push_back(i);
+	}
+
+	m_source = source;
+	m_leastRecent = -1;
+	m_mostRecent = -1;
+	m_frame = 0;
+	memset(&m_stats, 0, sizeof(VirtualTextureStats));
+	m_stats.cacheTiles = cacheTiles;
+	m_stats.pageTableBytes = m_pages.size() * sizeof(PageType);
+
+	// The last level is always there to draw from.
+	if(!LoadTile(PackTile((int)m_levels.size() - 1, 0, 0), TakeSlot(), true))
+	{
+		Shutdown();
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Forgets every tile and the page table. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::Shutdown()
+{
+	m_source = 0;
+	m_levels.clear();
+	m_pages.clear();
+	m_slots.clear();
+	m_freeSlots.clear();
+	m_visible.clear();
+	m_requested.clear();
+	m_requests.clear();
+	m_leastRecent = -1;
+	m_mostRecent = -1;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets the number of tiles loaded a frame at most. </summary>
+///
+/// <param name="uploads"> The number of tiles. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::SetUploadsPerFrame(int uploads)
+{
+	m_uploadsPerFrame = uploads > 0 ? uploads : 1;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Takes the feedback of a frame: marks used the tiles it was drawn with, requests the ones
+/// 	missing and loads the most urgent of them.
+/// </summary>
+///
+/// <param name="feedback"> The tile every pixel of the feedback wanted, VIRTUAL_TILE_NONE for none. </param>
+/// <param name="count">	The number of pixels. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::Update(const unsigned int* feedback, int count)
+{
+	PageType* page;
+	unsigned long long key;
+	unsigned int tile;
+	int i, slot, missed;
+
+	PROFILE_FUNCTION();
+
+	if(!m_source)
+	{
+		return;
+	}
+
+	m_frame++;
+	m_stats.frames++;
+	m_visible.clear();
+	m_requested.clear();
+	m_requests.clear();
+
+	// Count the pixels of every tile seen. The feedback comes from the GPU, so it is checked first.
+	for(i=0; i<count; i++)
+	{
+		tile = feedback[i];
+		if(tile == VIRTUAL_TILE_NONE)
+		{
+			continue;
+		}
+
+		if(!IsValidTile(tile))
+		{
+			m_stats.invalidFeedback++;
+			continue;
+		}
+
+		page = &m_pages[GetPageIndex(tile)];
+		if(page->seen != m_frame)
+		{
+			page->seen = m_frame;
+			page->pixels = 0;
+			m_visible.push_back(tile);
+		}
+		page->pixels++;
+	}
+
+	// Mark used what was drawn, and request what was missing.
+	missed = 0;
+	for(i=0; i<(int)m_visible.size(); i++)
+	{
+		page = &m_pages[GetPageIndex(m_visible[i])];
+		if(page->slot >= 0)
+		{
+			Touch(page->slot);
+			continue;
+		}
+
+		missed++;
+		Request(m_visible[i], page->pixels);
+	}
+
+	m_stats.visibleTiles = (int)m_visible.size();
+	m_stats.visibleTileFrames += m_visible.size();
+	m_stats.missedTileFrames += missed;
+	if(missed > 0)
+	{
+		m_stats.missFrames++;
+	}
+
+	// The coarsest requests first, then the ones the most pixels want.
+	for(i=0; i<(int)m_requested.size(); i++)
+	{
+		key = (unsigned long long)GetTileLevel(m_requested[i]) << 32 | m_pages[GetPageIndex(m_requested[i])].weight;
+		m_requests.push_back(make_pair(key, m_requested[i]));
+	}
+	sort(m_requests.begin(), m_requests.end(), greater<pair<unsigned long long, unsigned int> >());
+
+	m_stats.requests = (int)m_requests.size();
+	if(m_stats.requests > m_stats.peakRequests)
+	{
+		m_stats.peakRequests = m_stats.requests;
+	}
+
+	// Load as many as the frame allows, while there are slots not in use.
+	for(i=0; i<(int)m_requests.size() && i<m_uploadsPerFrame; i++)
+	{
+		slot = TakeSlot();
+		if(slot < 0)
+		{
+			m_stats.fullFrames++;
+			break;
+		}
+
+		LoadTile(m_requests[i].second, slot, false);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of mip levels. </summary>
+///
+/// <returns> The number of levels, the last one a single tile. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int VirtualTextureClass::GetLevelCount()
+{
+	return (int)m_levels.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the number of tiles of a level. </summary>
+///
+/// <param name="level">  The level. </param>
+/// <param name="tilesX"> [out] The tiles across. </param>
+/// <param name="tilesY"> [out] The tiles down. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::GetLevelSize(int level, int& tilesX, int& tilesY)
+{
+	tilesX = 0;
+	tilesY = 0;
+
+	if(level >= 0 && level < (int)m_levels.size())
+	{
+		tilesX = m_levels[level].tilesX;
+		tilesY = m_levels[level].tilesY;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the slot a tile is cached in. </summary>
+///
+/// <param name="tile"> The tile. </param>
+///
+/// <returns> The slot, -1 if the tile is not in the cache. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int VirtualTextureClass::GetSlot(unsigned int tile)
+{
+	if(!IsValidTile(tile))
+	{
+		return -1;
+	}
+
+	return m_pages[GetPageIndex(tile)].slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Finds what a tile is drawn from: the tile itself when it is cached, its nearest cached ancestor otherwise. </summary>
+///
+/// <param name="tile">  The tile. </param>
+/// <param name="level"> [out] The level of the tile found, -1 if none. </param>
+///
+/// <returns> The slot of the tile found, -1 if none. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int VirtualTextureClass::FindSlot(unsigned int tile, int& level)
+{
+	int slot;
+
+	level = -1;
+
+	if(!IsValidTile(tile))
+	{
+		return -1;
+	}
+
+	while(tile != VIRTUAL_TILE_NONE)
+	{
+		slot = m_pages[GetPageIndex(tile)].slot;
+		if(slot >= 0)
+		{
+			level = GetTileLevel(tile);
+			return slot;
+		}
+
+		tile = GetParent(tile);
+	}
+
+	return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Builds the page table of a level as the shader indexes it: for every tile, row by row,
+/// 	the slot it is drawn from in the low 16 bits and the level of what is in that slot above.
+/// </summary>
+///
+/// <param name="level">   The level. </param>
+/// <param name="entries"> [out] An entry for every tile of the level. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::BuildPageTable(int level, vector<unsigned int>& entries)
+{
+	int x, y, slot, found;
+
+	entries.clear();
+
+	if(level < 0 || level >= (int)m_levels.size())
+	{
+		return;
+	}
+
+	entries.resize((size_t)m_levels[level].tilesX * m_levels[level].tilesY);
+	for(y=0; y<m_levels[level].tilesY; y++)
+	{
+		for(x=0; x<m_levels[level].tilesX; x++)
+		{
+			slot = FindSlot(PackTile(level, x, y), found);
+			entries[(size_t)y * m_levels[level].tilesX + x] = (unsigned int)slot | (unsigned int)found << 16;
+		}
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Checks the page table, the slots and the least recently used list agree: every cached tile
+/// 	is in one slot the page table points at, every slot is free, pinned or in the list once,
+/// 	and the list goes from the least to the most recently used.
+/// </summary>
+///
+/// <returns> true if they agree. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool VirtualTextureClass::Validate()
+{
+	unsigned int used;
+	int i, previous, slots, listed, pinned, empty;
+	size_t j, pages;
+
+	// Every cached tile is where the page table says.
+	slots = 0;
+	pinned = 0;
+	empty = 0;
+	for(i=0; i<(int)m_slots.size(); i++)
+	{
+		if(m_slots[i].tile == VIRTUAL_TILE_NONE)
+		{
+			empty++;
+			continue;
+		}
+
+		if(!IsValidTile(m_slots[i].tile) || m_pages[GetPageIndex(m_slots[i].tile)].slot != i)
+		{
+			return false;
+		}
+
+		slots++;
+		if(m_slots[i].pinned)
+		{
+			pinned++;
+		}
+	}
+
+	// And the page table points at no other slot.
+	pages = 0;
+	for(j=0; j<m_pages.size(); j++)
+	{
+		if(m_pages[j].slot >= 0)
+		{
+			pages++;
+		}
+	}
+
+	if(slots != m_stats.residentTiles || pages != (size_t)slots || empty != (int)m_freeSlots.size())
+	{
+		return false;
+	}
+
+	// The list holds every other cached tile, oldest first.
+	listed = 0;
+	previous = -1;
+	used = 0;
+	for(i=m_leastRecent; i>=0; i=m_slots[i].next)
+	{
+		if(m_slots[i].previous != previous || m_slots[i].pinned || m_slots[i].tile == VIRTUAL_TILE_NONE || m_slots[i].used < used || listed == (int)m_slots.size())
+		{
+			return false;
+		}
+
+		used = m_slots[i].used;
+		previous = i;
+		listed++;
+	}
+
+	return previous == m_mostRecent && listed + pinned == slots;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the counters. </summary>
+///
+/// <param name="stats"> [out] The counters. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::GetStats(VirtualTextureStats& stats)
+{
+	stats = m_stats;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Packs a tile into the number the feedback and the page table name it by. </summary>
+///
+/// <param name="level"> The level. </param>
+/// <param name="x">	 The column of the tile in its level. </param>
+/// <param name="y">	 The row of the tile in its level. </param>
+///
+/// <returns> The tile. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned int VirtualTextureClass::PackTile(int level, int x, int y)
+{
+	return (unsigned int)level << (2 * VIRTUAL_TEXTURE_TILE_BITS) | (unsigned int)y << VIRTUAL_TEXTURE_TILE_BITS | (unsigned int)x;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the level of a tile. </summary>
+///
+/// <param name="tile"> The tile. </param>
+///
+/// <returns> The level. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int VirtualTextureClass::GetTileLevel(unsigned int tile)
+{
+	return (int)(tile >> (2 * VIRTUAL_TEXTURE_TILE_BITS));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the column of a tile in its level. </summary>
+///
+/// <param name="tile"> The tile. </param>
+///
+/// <returns> The column. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int VirtualTextureClass::GetTileX(unsigned int tile)
+{
+	return (int)(tile & ((1u << VIRTUAL_TEXTURE_TILE_BITS) - 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the row of a tile in its level. </summary>
+///
+/// <param name="tile"> The tile. </param>
+///
+/// <returns> The row. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int VirtualTextureClass::GetTileY(unsigned int tile)
+{
+	return (int)(tile >> VIRTUAL_TEXTURE_TILE_BITS & ((1u << VIRTUAL_TEXTURE_TILE_BITS) - 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if a tile is in the texture. </summary>
+///
+/// <param name="tile"> The tile. </param>
+///
+/// <returns> true if its level and its place in the level exist. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool VirtualTextureClass::IsValidTile(unsigned int tile)
+{
+	int level;
+
+	if(tile == VIRTUAL_TILE_NONE)
+	{
+		return false;
+	}
+
+	level = GetTileLevel(tile);
+
+	return level < (int)m_levels.size() && GetTileX(tile) < m_levels[level].tilesX && GetTileY(tile) < m_levels[level].tilesY;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the index of the page table entry of a valid tile. </summary>
+///
+/// <param name="tile"> The tile. </param>
+///
+/// <returns> The index. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+size_t VirtualTextureClass::GetPageIndex(unsigned int tile)
+{
+	const LevelType& level = m_levels[GetTileLevel(tile)];
+
+	return level.first + (size_t)GetTileY(tile) * level.tilesX + GetTileX(tile);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the tile of the next level that covers a tile. </summary>
+///
+/// <param name="tile"> The tile. </param>
+///
+/// <returns> The parent, VIRTUAL_TILE_NONE for the tile of the last level. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+unsigned int VirtualTextureClass::GetParent(unsigned int tile)
+{
+	int level;
+
+	level = GetTileLevel(tile) + 1;
+	if(level >= (int)m_levels.size())
+	{
+		return VIRTUAL_TILE_NONE;
+	}
+
+	return PackTile(level, GetTileX(tile) / 2, GetTileY(tile) / 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Requests a missing tile and the missing ones above it, each weighed with the pixels that
+/// 	want it, and marks used the cached ancestor the tile is drawn from meanwhile.
+/// </summary>
+///
+/// <param name="tile">   The tile. </param>
+/// <param name="pixels"> The pixels of the feedback that wanted it. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::Request(unsigned int tile, unsigned int pixels)
+{
+	PageType* page;
+
+	while(tile != VIRTUAL_TILE_NONE)
+	{
+		page = &m_pages[GetPageIndex(tile)];
+		if(page->slot >= 0)
+		{
+			Touch(page->slot);
+			return;
+		}
+
+		if(page->requested != m_frame)
+		{
+			page->requested = m_frame;
+			page->weight = 0;
+			m_requested.push_back(tile);
+		}
+		page->weight += pixels;
+
+		tile = GetParent(tile);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Marks a slot used this frame, which moves it to the most recent end of the list. </summary>
+///
+/// <param name="slot"> The slot. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::Touch(int slot)
+{
+	if(m_slots[slot].pinned)
+	{
+		return;
+	}
+
+	m_slots[slot].used = m_frame;
+	if(slot != m_mostRecent)
+	{
+		Unlink(slot);
+		LinkLast(slot);
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Takes a slot out of the least recently used list. </summary>
+///
+/// <param name="slot"> The slot. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::Unlink(int slot)
+{
+	if(m_slots[slot].previous >= 0)
+	{
+		m_slots[m_slots[slot].previous].next = m_slots[slot].next;
+	}
+	else
+	{
+		m_leastRecent = m_slots[slot].next;
+	}
+
+	if(m_slots[slot].next >= 0)
+	{
+		m_slots[m_slots[slot].next].previous = m_slots[slot].previous;
+	}
+	else
+	{
+		m_mostRecent = m_slots[slot].previous;
+	}
+
+	m_slots[slot].previous = -1;
+	m_slots[slot].next = -1;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Puts a slot at the most recent end of the least recently used list. </summary>
+///
+/// <param name="slot"> The slot. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureClass::LinkLast(int slot)
+{
+	m_slots[slot].previous = m_mostRecent;
+	m_slots[slot].next = -1;
+
+	if(m_mostRecent >= 0)
+	{
+		m_slots[m_mostRecent].next = slot;
+	}
+	else
+	{
+		m_leastRecent = slot;
+	}
+	m_mostRecent = slot;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Takes a free slot, or evicts the tile least recently used when it wasn't used this frame. </summary>
+///
+/// <returns> The slot, -1 if every slot holds a tile in use. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int VirtualTextureClass::TakeSlot()
+{
+	int slot;
+
+	if(!m_freeSlots.empty())
+	{
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		return slot;
+	}
+
+	slot = m_leastRecent;
+	if(slot < 0 || m_slots[slot].used == m_frame)
+	{
+		return -1;
+	}
+
+	m_pages[GetPageIndex(m_slots[slot].tile)].slot = -1;
+	m_slots[slot].tile = VIRTUAL_TILE_NONE;
+	Unlink(slot);
+
+	m_stats.residentTiles--;
+	m_stats.evictions++;
+
+	return slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Loads a tile into a slot taken for it, and puts the slot back with the free ones if it fails. </summary>
+///
+/// <param name="tile">   The tile. </param>
+/// <param name="slot">   The slot. </param>
+/// <param name="pinned"> true if the tile is never evicted. </param>
+///
+/// <returns> true if the tile was loaded. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool VirtualTextureClass::LoadTile(unsigned int tile, int slot, bool pinned)
+{
+	if(slot < 0)
+	{
+		return false;
+	}
+
+	if(!m_source->LoadTile(tile, slot))
+	{
+		m_stats.failedLoads++;
+		m_freeSlots.push_back(slot);
+		return false;
+	}
+
+	m_slots[slot].tile = tile;
+	m_slots[slot].used = m_frame;
+	m_slots[slot].pinned = pinned;
+	m_pages[GetPageIndex(tile)].slot = slot;
+	if(!pinned)
+	{
+		LinkLast(slot);
+	}
+
+	m_stats.residentTiles++;
+	m_stats.uploads++;
+
+	return true;
+}
@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	virtualtextureclass.h
+//
+// summary:	Declares the virtualtextureclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _VIRTUALTEXTURECLASS_H_
+#define _VIRTUALTEXTURECLASS_H_
+
+// System Includes.
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "virtualtilesourceclass.h"
+
+// Globals.
+const int VIRTUAL_TEXTURE_TILE_SIZE = 128;
+const int VIRTUAL_TEXTURE_MAX_LEVELS = 15;
+const int VIRTUAL_TEXTURE_TILE_BITS = 14;
+const int VIRTUAL_TEXTURE_CACHE_TILES = 1024;
+const int VIRTUAL_TEXTURE_UPLOADS_PER_FRAME = 16;
+const unsigned int VIRTUAL_TILE_NONE = 0xFFFFFFFF;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Counters of the virtual texture. A miss is a visible tile that was drawn from a coarser
+/// 	mip because it wasn't in the cache; a full frame is one where every slot held a tile in
+/// 	use and the requests left had to wait.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct VirtualTextureStats
+{
+	int cacheTiles;
+	int residentTiles;
+	int visibleTiles;
+	int requests;
+	int peakRequests;
+	unsigned long long pageTableBytes;
+	unsigned long frames;
+	unsigned long uploads;
+	unsigned long evictions;
+	unsigned long failedLoads;
+	unsigned long invalidFeedback;
+	unsigned long missFrames;
+	unsigned long fullFrames;
+	unsigned long long visibleTileFrames;
+	unsigned long long missedTileFrames;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Manages the pages of a virtual texture, a texture too large to be in memory, on the CPU.
+/// 	Every mip level is cut into square tiles, and only the tiles something is drawn with are
+/// 	kept, in a physical cache of a fixed number of slots: the memory of the texture stays the
+/// 	same whatever its size. The page table says, for every tile of every level, which slot
+/// 	holds it, if any.
+///
+/// 	Update is given the feedback of a frame: for every pixel of a small render target, the
+/// 	tile it sampled (VIRTUAL_TILE_NONE where nothing was). Each tile seen is either in the
+/// 	cache, and is marked used, or it is drawn from its nearest cached ancestor, which is
+/// 	marked used instead, and it and the missing tiles between them are requested. The
+/// 	coarsest requests go first, so each upload sharpens everything under it, then the ones
+/// 	the most pixels want. The single tile of the last level is loaded at startup and never
+/// 	leaves, so every tile always has something to be drawn from.
+///
+/// 	Only a few tiles are uploaded a frame. A slot is taken from the free ones, or from the
+/// 	tile least recently used, which is kept in a list so finding it costs nothing; a tile used
+/// 	this frame is never evicted, the request waits for a later frame instead.
+///
+/// 	Nothing here touches the GPU: the tiles go through a VirtualTileSourceClass, and the page
+/// 	table the shader indexes is built with BuildPageTable.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class VirtualTextureClass
+{
+private:
+	struct LevelType
+	{
+		int tilesX;
+		int tilesY;
+		size_t first;
+	};
+
+	struct PageType
+	{
+		int slot;
+		unsigned int seen;
+		unsigned int requested;
+		unsigned int pixels;
+		unsigned int weight;
+	};
+
+	struct SlotType
+	{
+		unsigned int tile;
+		unsigned int used;
+		int previous;
+		int next;
+		bool pinned;
+	};
+
+public:
+	VirtualTextureClass();
+	VirtualTextureClass(const VirtualTextureClass&);
+	~VirtualTextureClass();
+
+	bool Initialize(VirtualTileSourceClass*, int, int, int = VIRTUAL_TEXTURE_CACHE_TILES);
+	void Shutdown();
+
+	void SetUploadsPerFrame(int);
+	void Update(const unsigned int*, int);
+
+	int GetLevelCount();
+	void GetLevelSize(int, int&, int&);
+	int GetSlot(unsigned int);
+	int FindSlot(unsigned int, int&);
+	void BuildPageTable(int, vector<unsigned int>&);
+	bool Validate();
+	void GetStats(VirtualTextureStats&);
+
+	static unsigned int PackTile(int, int, int);
+	static int GetTileLevel(unsigned int);
+	static int GetTileX(unsigned int);
+	static int GetTileY(unsigned int);
+
+private:
+	bool IsValidTile(unsigned int);
+	size_t GetPageIndex(unsigned int);
+	unsigned int GetParent(unsigned int);
+	void Request(unsigned int, unsigned int);
+	void Touch(int);
+	void Unlink(int);
+	void LinkLast(int);
+	int TakeSlot();
+	bool LoadTile(unsigned int, int, bool);
+
+private:
+	VirtualTileSourceClass* m_source;
+	vector<LevelType> m_levels;
+	vector<PageType> m_pages;
+	vector<SlotType> m_slots;
+	vector<int> m_freeSlots;
+	vector<unsigned int> m_visible;
+	vector<unsigned int> m_requested;
+	vector<pair<unsigned long long, unsigned int> > m_requests;
+	int m_leastRecent;
+	int m_mostRecent;
+	int m_uploadsPerFrame;
+	unsigned int m_frame;
+	VirtualTextureStats m_stats;
+};
+
+#endif
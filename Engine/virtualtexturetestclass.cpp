@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	virtualtexturetestclass.cpp
+//
+// summary:	Implements the virtualtexturetestclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "virtualtexturetestclass.h"
+
+// System Includes.
+#include <cmath>
+
+// Includes.
+#include "profilerclass.h"
+#include "logclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+VirtualTextureTestClass::VirtualTextureTestClass()
+{
+	m_time = 0.0;
+	m_x = 0.0f;
+	m_y = 0.0f;
+	m_heading = 0.0f;
+	m_frameLoads = 0;
+	m_loads = 0;
+	m_mistakes = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+VirtualTextureTestClass::VirtualTextureTestClass(const VirtualTextureTestClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+VirtualTextureTestClass::~VirtualTextureTestClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Lays out the texture and the feedback buffer. </summary>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool VirtualTextureTestClass::Initialize()
+{
+	m_feedback.assign(VIRTUAL_TEXTURE_TEST_FEEDBACK_WIDTH * VIRTUAL_TEXTURE_TEST_FEEDBACK_HEIGHT, VIRTUAL_TILE_NONE);
+	m_time = 0.0;
+	m_x = VIRTUAL_TEXTURE_TEST_SIZE * 0.5f;
+	m_y = VIRTUAL_TEXTURE_TEST_SIZE * 0.5f;
+	m_heading = 0.0f;
+	m_frameLoads = 0;
+	m_loads = 0;
+	m_mistakes = 0;
+
+	return m_Texture.Initialize(this, VIRTUAL_TEXTURE_TEST_SIZE, VIRTUAL_TEXTURE_TEST_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Logs the report and releases the texture. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureTestClass::Shutdown()
+{
+	VirtualTextureStats stats;
+	double megabyte, cached;
+
+	m_Texture.GetStats(stats);
+	m_Texture.Shutdown();
+
+	megabyte = 1024.0 * 1024.0;
+	cached = stats.visibleTileFrames ? 100.0 * (stats.visibleTileFrames - stats.missedTileFrames) / stats.visibleTileFrames : 100.0;
+
+	LOG_INFO(LOG_CATEGORY_RESOURCE, "Virtual texture test: %lu frames, %lu uploads, %lu evictions, %lu failed loads, at most %d requests waiting.", stats.frames, stats.uploads, stats.evictions, stats.failedLoads, stats.peakRequests);
+	LOG_INFO(LOG_CATEGORY_RESOURCE, "Virtual texture test: %.2f%% of the visible tiles were cached, %lu frames drew some from coarser mips, %lu found the cache full.", cached, stats.missFrames, stats.fullFrames);
+	LOG_INFO(LOG_CATEGORY_RESOURCE, "Virtual texture test: %.0f MB of texture in a cache of %d tiles (%.1f MB) and a page table of %.1f MB.", (double)VIRTUAL_TEXTURE_TEST_SIZE * VIRTUAL_TEXTURE_TEST_SIZE * 4.0 / 3.0 / megabyte, stats.cacheTiles, (double)stats.cacheTiles * VIRTUAL_TEXTURE_TEST_TILE_BYTES / megabyte, stats.pageTableBytes / megabyte);
+
+	if(m_mistakes > 0 || stats.invalidFeedback > 0)
+	{
+		LOG_ERROR(LOG_CATEGORY_RESOURCE, "Virtual texture test: the cache was broken (%lu bad loads or frames, %lu bad feedback pixels).", m_mistakes, stats.invalidFeedback);
+	}
+
+	m_feedback.clear();
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Moves the camera one step, works out what it sees and pages the texture. </summary>
+///
+/// <param name="deltaSeconds"> The seconds the frame clock moved this frame. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void VirtualTextureTestClass::Frame(double deltaSeconds)
+{
+	float distance, forwardX, forwardY, depth, footprint, lateral, u, v;
+	int row, column, ground, level, tileTexels, x, y;
+
+	PROFILE_FUNCTION();
+
+	m_time += deltaSeconds;
+	m_frameLoads = 0;
+
+	// Turn one way then the other, and rise and fall so the view goes through every level.
+	m_heading += 0.5f * sinf((float)m_time * 6.2831853f / VIRTUAL_TEXTURE_TEST_TURN_PERIOD) * (float)deltaSeconds;
+	forwardX = cosf(m_heading);
+	forwardY = sinf(m_heading);
+	m_x = fmodf(m_x + forwardX * VIRTUAL_TEXTURE_TEST_SPEED * (float)deltaSeconds + VIRTUAL_TEXTURE_TEST_SIZE, (float)VIRTUAL_TEXTURE_TEST_SIZE);
+	m_y = fmodf(m_y + forwardY * VIRTUAL_TEXTURE_TEST_SPEED * (float)deltaSeconds + VIRTUAL_TEXTURE_TEST_SIZE, (float)VIRTUAL_TEXTURE_TEST_SIZE);
+	distance = VIRTUAL_TEXTURE_TEST_MIN_DISTANCE + (VIRTUAL_TEXTURE_TEST_MAX_DISTANCE - VIRTUAL_TEXTURE_TEST_MIN_DISTANCE) * 0.5f * (1.0f - cosf((float)m_time * 6.2831853f / VIRTUAL_TEXTURE_TEST_ZOOM_PERIOD));
+
+	// The rows at the top are sky, the ones below go from the horizon to the bottom of the screen.
+	ground = (int)(VIRTUAL_TEXTURE_TEST_FEEDBACK_HEIGHT * VIRTUAL_TEXTURE_TEST_SKY);
+	for(row=0; row<VIRTUAL_TEXTURE_TEST_FEEDBACK_HEIGHT; row++)
+	{
+		if(row < ground)
+		{
+			for(column=0; column<VIRTUAL_TEXTURE_TEST_FEEDBACK_WIDTH; column++)
+			{
+				m_feedback[row * VIRTUAL_TEXTURE_TEST_FEEDBACK_WIDTH + column] = VIRTUAL_TILE_NONE;
+			}
+			continue;
+		}
+
+		// The row sees the ground at a depth, and a screen pixel covers a footprint of texels there.
+		v = (row - ground + 0.5f) / (VIRTUAL_TEXTURE_TEST_FEEDBACK_HEIGHT - ground);
+		depth = distance / (1.0f - VIRTUAL_TEXTURE_TEST_HORIZON * (1.0f - v));
+		footprint = depth * VIRTUAL_TEXTURE_TEST_VIEW_WIDTH / VIRTUAL_TEXTURE_TEST_SCREEN_WIDTH;
+
+		level = 0;
+		while(footprint >= 2.0f && level < m_Texture.GetLevelCount() - 1)
+		{
+			footprint *= 0.5f;
+			level++;
+		}
+		tileTexels = VIRTUAL_TEXTURE_TILE_SIZE << level;
+
+		for(column=0; column<VIRTUAL_TEXTURE_TEST_FEEDBACK_WIDTH; column++)
+		{
+			lateral = ((column + 0.5f) / VIRTUAL_TEXTURE_TEST_FEEDBACK_WIDTH - 0.5f) * depth * VIRTUAL_TEXTURE_TEST_VIEW_WIDTH;
+			u = m_x + forwardX * depth - forwardY * lateral;
+			v = m_y + forwardY * depth + forwardX * lateral;
+
+			// The texture wraps.
+			x = ((int)floorf(u) % VIRTUAL_TEXTURE_TEST_SIZE + VIRTUAL_TEXTURE_TEST_SIZE) % VIRTUAL_TEXTURE_TEST_SIZE;
+			y = ((int)floorf(v) % VIRTUAL_TEXTURE_TEST_SIZE + VIRTUAL_TEXTURE_TEST_SIZE) % VIRTUAL_TEXTURE_TEST_SIZE;
+
+			m_feedback[row * VIRTUAL_TEXTURE_TEST_FEEDBACK_WIDTH + column] = VirtualTextureClass::PackTile(level, x / tileTexels, y / tileTexels);
+		}
+	}
+
+	m_Texture.Update(&m_feedback[0], (int)m_feedback.size());
+
+	if(!m_Texture.Validate())
+	{
+		m_mistakes++;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Loads a tile, which fails now and then, made up from the tile and the count of loads. </summary>
+///
+/// <param name="tile"> The tile. </param>
+/// <param name="slot"> The slot. </param>
+///
+/// <returns> false for about one load in VIRTUAL_TEXTURE_TEST_FAILURE_RATE, true otherwise. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool VirtualTextureTestClass::LoadTile(unsigned int tile, int slot)
+{
+	unsigned int hash;
+
+	m_loads++;
+	m_frameLoads++;
+
+	// A tile is never loaded twice, and a frame never goes over its budget.
+	if(m_Texture.GetSlot(tile) >= 0 || slot < 0 || slot >= VIRTUAL_TEXTURE_CACHE_TILES || m_frameLoads > VIRTUAL_TEXTURE_UPLOADS_PER_FRAME)
+	{
+		m_mistakes++;
+	}
+
+	// The tile of the last level is loaded before the first frame, and has to be.
+	if(m_time == 0.0)
+	{
+		return true;
+	}
+
+	hash = (tile ^ (unsigned int)m_loads) * 2654435761u;
+	hash ^= hash >> 15;
+
+	return hash % VIRTUAL_TEXTURE_TEST_FAILURE_RATE != 0;
+}
@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	virtualtexturetestclass.h
+//
+// summary:	Declares the virtualtexturetestclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _VIRTUALTEXTURETESTCLASS_H_
+#define _VIRTUALTEXTURETESTCLASS_H_
+
+// System Includes.
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "virtualtextureclass.h"
+
+// Globals.
+const int VIRTUAL_TEXTURE_TEST_SIZE = 65536;
+const int VIRTUAL_TEXTURE_TEST_TILE_BYTES = VIRTUAL_TEXTURE_TILE_SIZE * VIRTUAL_TEXTURE_TILE_SIZE;
+const int VIRTUAL_TEXTURE_TEST_FEEDBACK_WIDTH = 80;
+const int VIRTUAL_TEXTURE_TEST_FEEDBACK_HEIGHT = 45;
+const int VIRTUAL_TEXTURE_TEST_SCREEN_WIDTH = 1280;
+const float VIRTUAL_TEXTURE_TEST_SKY = 0.2f;
+const float VIRTUAL_TEXTURE_TEST_HORIZON = 0.95f;
+const float VIRTUAL_TEXTURE_TEST_VIEW_WIDTH = 1.6f;
+const float VIRTUAL_TEXTURE_TEST_MIN_DISTANCE = 300.0f;
+const float VIRTUAL_TEXTURE_TEST_MAX_DISTANCE = 3000.0f;
+const float VIRTUAL_TEXTURE_TEST_ZOOM_PERIOD = 15.0f;
+const float VIRTUAL_TEXTURE_TEST_SPEED = 1500.0f;
+const float VIRTUAL_TEXTURE_TEST_TURN_PERIOD = 20.0f;
+const unsigned int VIRTUAL_TEXTURE_TEST_FAILURE_RATE = 997;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Runs the virtual texture on a made up 64K texture, for "-vttest", so the paging can be
+/// 	measured on the headless machines. A camera flies low over a ground plane covered by the
+/// 	texture, turning and zooming in and out, and the feedback buffer is worked out on the CPU:
+/// 	for every pixel under the horizon, the texel it sees and the mip its footprint picks. The
+/// 	tiles hold nothing, and about one load in a thousand fails.
+///
+/// 	Every load is checked to be of a tile not already cached and within the budget of the
+/// 	frame, and the cache is validated every frame. Shutdown logs how often the view was
+/// 	drawn from coarser mips, and the memory the cache takes against the whole texture.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class VirtualTextureTestClass : public VirtualTileSourceClass
+{
+public:
+	VirtualTextureTestClass();
+	VirtualTextureTestClass(const VirtualTextureTestClass&);
+	~VirtualTextureTestClass();
+
+	bool Initialize();
+	void Shutdown();
+	void Frame(double);
+
+	bool LoadTile(unsigned int, int);
+
+private:
+	VirtualTextureClass m_Texture;
+	vector<unsigned int> m_feedback;
+	double m_time;
+	float m_x;
+	float m_y;
+	float m_heading;
+	int m_frameLoads;
+	unsigned long m_loads;
+	unsigned long m_mistakes;
+};
+
+#endif
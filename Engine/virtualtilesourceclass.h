@@ -0,0 +1,27 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	virtualtilesourceclass.h
+//
+// summary:	Declares the virtualtilesourceclass interface
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _VIRTUALTILESOURCECLASS_H_
+#define _VIRTUALTILESOURCECLASS_H_
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Implemented by whatever holds the tiles of a virtual texture and the physical texture they
+/// 	are cached in. The virtual texture only decides which tile goes in which slot of the cache
+/// 	and calls this, so it doesn't know where the tiles come from and can be driven with no
+/// 	GPU behind it.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class VirtualTileSourceClass
+{
+public:
+	virtual ~VirtualTileSourceClass() {}
+
+	// Fill a slot of the cache with a tile, whatever the slot held before is gone. Returns false
+	// if the tile could not be read, the slot is left empty and the tile is asked for again.
+	virtual bool LoadTile(unsigned int, int) = 0;
+};
+
+#endif
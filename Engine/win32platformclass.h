@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	win32platformclass.h
+//
+// summary:	Declares the win32platformclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _WIN32PLATFORMCLASS_H_
+#define _WIN32PLATFORMCLASS_H_
+
+// Pre-processing directives.
+// Used to speed up the build process, it reduces the size of
+// the Win32 header files by excluding some of the less used APIs.
+#define WIN32_LEAN_AND_MEAN
+
+// System Includes.
+#include <windows.h>
+#include <windowsx.h>
+
+// Includes.
+#include "platformclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	The Win32 backend of the platform layer. It creates the window the graphics render to
+/// 	and turns the windows messages the application cares about into platform events; the
+/// 	rest goes to the default window procedure.
+/// </summary>
+///
+/// <remarks> Filipe, 25 Nov 2012. </remarks>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class Win32PlatformClass : public PlatformClass
+{
+public:
+	Win32PlatformClass();
+	Win32PlatformClass(const Win32PlatformClass&);
+	~Win32PlatformClass();
+
+	bool Initialize(bool, int&, int&);
+	void Shutdown();
+	bool PollEvent(PlatformEvent&);
+	void* GetWindowHandle();
+
+	LRESULT CALLBACK MessageHandler(HWND, UINT, WPARAM, LPARAM);
+
+private:
+	bool EnterFullscreen();
+
+private:
+	LPCWSTR m_applicationName;
+	LPCWSTR m_windowTitle;
+	DWORD m_windowStyle;
+	HINSTANCE m_hinstance;
+	HWND m_hwnd;
+};
+
+// Global Function Prototypes.
+static LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
+
+// Globals.
+static Win32PlatformClass* ApplicationHandle = 0;
+
+#endif
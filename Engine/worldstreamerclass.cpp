@@ -0,0 +1,572 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	worldstreamerclass.cpp
+//
+// summary:	Implements the worldstreamerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "worldstreamerclass.h"
+
+// System Includes.
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Includes.
+#include "profilerclass.h"
+#include "logclass.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Default constructor. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+WorldStreamerClass::WorldStreamerClass()
+{
+	m_source = 0;
+	m_cellsX = 0;
+	m_cellsZ = 0;
+	m_cellSize = 0.0f;
+	m_loadRadius = WORLD_STREAMER_LOAD_RADIUS;
+	m_unloadRadius = WORLD_STREAMER_UNLOAD_RADIUS;
+	m_loadsPerFrame = WORLD_STREAMER_LOADS_PER_FRAME;
+	m_bytesPerFrame = WORLD_STREAMER_BYTES_PER_FRAME;
+	m_positionX = 0.0f;
+	m_positionZ = 0.0f;
+	m_velocityX = 0.0f;
+	m_velocityZ = 0.0f;
+	m_hasPosition = false;
+	m_stall = 0;
+	memset(&m_stats, 0, sizeof(WorldStreamerStats));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty copy constructor. (See reason in systemclass) </summary>
+///
+/// <param name="other"> The other. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+WorldStreamerClass::WorldStreamerClass(const WorldStreamerClass& other)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Empty destructor. (See reason in systemclass) </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+WorldStreamerClass::~WorldStreamerClass()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Lays out the grid and asks the source for the size of every cell. </summary>
+///
+/// <param name="source">   The owner of the contents of the cells. </param>
+/// <param name="cellsX">   The number of cells along x. </param>
+/// <param name="cellsZ">   The number of cells along z. </param>
+/// <param name="cellSize"> The size of the side of a cell. </param>
+/// <param name="budget">   The memory the cells may take, in bytes. </param>
+///
+/// <returns> true if it succeeds, false if it fails. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool WorldStreamerClass::Initialize(StreamableCellClass* source, int cellsX, int cellsZ, float cellSize, unsigned long long budget)
+{
+	unsigned int i;
+
+	if(!source || cellsX < 1 || cellsZ < 1 || cellSize <= 0.0f || budget == 0)
+	{
+		return false;
+	}
+
+	m_source = source;
+	m_cellsX = cellsX;
+	m_cellsZ = cellsZ;
+	m_cellSize = cellSize;
+	m_hasPosition = false;
+	m_stall = 0;
+	memset(&m_stats, 0, sizeof(WorldStreamerStats));
+	m_stats.budget = budget;
+
+	m_cells.resize((size_t)cellsX * cellsZ);
+	for(i=0; i<m_cells.size(); i++)
+	{
+		m_cells[i].state = CELL_UNLOADED;
+		m_cells[i].size = m_source->GetCellSize(i);
+		m_cells[i].rank = 0.0f;
+		m_cells[i].active = -1;
+
+		// A cell bigger than the whole budget could never come in, and would hold up the ones behind it.
+		if(m_cells[i].size > budget)
+		{
+			LOG_WARNING(LOG_CATEGORY_RESOURCE, "World cell %u takes %llu bytes, more than the streaming budget.", i, m_cells[i].size);
+			m_cells[i].state = CELL_FAILED;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Unloads the resident cells. The loads in flight are forgotten, the source has to drop
+/// 	them itself.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void WorldStreamerClass::Shutdown()
+{
+	unsigned int i;
+
+	for(i=0; i<m_active.size(); i++)
+	{
+		if(m_cells[m_active[i]].state == CELL_RESIDENT)
+		{
+			m_source->UnloadCell(m_active[i]);
+		}
+	}
+
+	m_cells.clear();
+	m_active.clear();
+	m_candidates.clear();
+	m_evictable.clear();
+	m_source = 0;
+	m_stats.usedBytes = 0;
+	m_stats.residentCells = 0;
+	m_stats.loadingCells = 0;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets the radii, the unload radius is kept past the load radius. </summary>
+///
+/// <param name="loadRadius">   The rank under which cells are loaded. </param>
+/// <param name="unloadRadius"> The rank past which cells are unloaded. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void WorldStreamerClass::SetRadii(float loadRadius, float unloadRadius)
+{
+	m_loadRadius = loadRadius;
+	m_unloadRadius = unloadRadius > loadRadius ? unloadRadius : loadRadius;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets how much loading can be started in one frame. </summary>
+///
+/// <param name="loads"> The number of loads. </param>
+/// <param name="bytes"> The bytes, the first load of a frame is always let through. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void WorldStreamerClass::SetFrameLimits(int loads, unsigned long long bytes)
+{
+	m_loadsPerFrame = loads > 0 ? loads : 1;
+	m_bytesPerFrame = bytes;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Streams around the camera: unloads the cells that fell past the unload radius, starts
+/// 	loading the nearest cells under the load radius within the frame limits and the budget,
+/// 	and checks whether the cells around the camera are in.
+/// </summary>
+///
+/// <param name="x">			The camera position along x. </param>
+/// <param name="z">			The camera position along z. </param>
+/// <param name="deltaSeconds"> The time since the last update. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void WorldStreamerClass::Update(float x, float z, float deltaSeconds)
+{
+	unsigned long long size, bytes;
+	unsigned int i;
+	float reach, rank;
+	int cell, cellX, cellZ, minX, maxX, minZ, maxZ, loads, unloads;
+	bool stall;
+
+	PROFILE_FUNCTION();
+
+	if(!m_source)
+	{
+		return;
+	}
+
+	// The velocity comes from the movement of the camera, smoothed so one odd frame doesn't turn the streaming around.
+	// A jump past the unload radius is a cut to somewhere else, not movement.
+	if(m_hasPosition && fabsf(x - m_positionX) + fabsf(z - m_positionZ) > m_unloadRadius)
+	{
+		m_velocityX = 0.0f;
+		m_velocityZ = 0.0f;
+	}
+	else if(m_hasPosition && deltaSeconds > 0.0f)
+	{
+		m_velocityX += ((x - m_positionX) / deltaSeconds - m_velocityX) * WORLD_STREAMER_VELOCITY_SMOOTHING;
+		m_velocityZ += ((z - m_positionZ) / deltaSeconds - m_velocityZ) * WORLD_STREAMER_VELOCITY_SMOOTHING;
+	}
+	m_positionX = x;
+	m_positionZ = z;
+	m_hasPosition = true;
+	m_stats.frames++;
+
+	// Rank the cells in memory and unload the ones ranked past the unload radius. (Unload moves the last cell into the slot.)
+	unloads = 0;
+	i = 0;
+	while(i < m_active.size())
+	{
+		cell = m_active[i];
+		m_cells[cell].rank = RankCell(cell, x, z);
+		if(m_cells[cell].state == CELL_RESIDENT && m_cells[cell].rank > m_unloadRadius && unloads < WORLD_STREAMER_UNLOADS_PER_FRAME)
+		{
+			Unload(cell);
+			unloads++;
+			continue;
+		}
+		i++;
+	}
+
+	// Find the cells ranked under the load radius. The look ahead can only bring a cell closer by the speed times the look ahead time.
+	reach = m_loadRadius + sqrtf(m_velocityX * m_velocityX + m_velocityZ * m_velocityZ) * WORLD_STREAMER_LOOK_AHEAD;
+	minX = max((int)floorf((x - reach) / m_cellSize), 0);
+	maxX = min((int)floorf((x + reach) / m_cellSize), m_cellsX - 1);
+	minZ = max((int)floorf((z - reach) / m_cellSize), 0);
+	maxZ = min((int)floorf((z + reach) / m_cellSize), m_cellsZ - 1);
+
+	m_candidates.clear();
+	for(cellZ=minZ; cellZ<=maxZ; cellZ++)
+	{
+		for(cellX=minX; cellX<=maxX; cellX++)
+		{
+			cell = cellZ * m_cellsX + cellX;
+			if(m_cells[cell].state != CELL_UNLOADED)
+			{
+				continue;
+			}
+
+			rank = RankCell(cell, x, z);
+			if(rank <= m_loadRadius)
+			{
+				m_candidates.push_back(make_pair(rank, cell));
+			}
+		}
+	}
+	sort(m_candidates.begin(), m_candidates.end());
+
+	// Start the loads, nearest first, until the frame limits are reached or the budget can't make room.
+	loads = 0;
+	bytes = 0;
+	for(i=0; i<m_candidates.size() && loads < m_loadsPerFrame && m_stats.loadingCells < WORLD_STREAMER_MAX_LOADING; i++)
+	{
+		cell = m_candidates[i].second;
+		size = m_cells[cell].size;
+		if(loads > 0 && bytes + size > m_bytesPerFrame)
+		{
+			break;
+		}
+
+		if(m_stats.usedBytes + size > m_stats.budget && !MakeRoom(size, m_candidates[i].first))
+		{
+			m_stats.budgetLimitedFrames++;
+			break;
+		}
+
+		if(!m_source->LoadCell(cell))
+		{
+			LOG_WARNING(LOG_CATEGORY_RESOURCE, "Could not start loading world cell %d.", cell);
+			m_cells[cell].state = CELL_FAILED;
+			m_stats.failedLoads++;
+			continue;
+		}
+
+		m_cells[cell].state = CELL_LOADING;
+		m_cells[cell].rank = m_candidates[i].first;
+		m_cells[cell].active = (int)m_active.size();
+		m_active.push_back(cell);
+
+		m_stats.usedBytes += size;
+		m_stats.loadingCells++;
+		m_stats.loads++;
+		loads++;
+		bytes += size;
+	}
+
+	if(m_stats.usedBytes > m_stats.peakUsedBytes)
+	{
+		m_stats.peakUsedBytes = m_stats.usedBytes;
+	}
+
+	// Count the frames the camera is next to a hole.
+	stall = CheckStall(x, z);
+	if(stall)
+	{
+		m_stall++;
+		m_stats.stallFrames++;
+		if(m_stall > m_stats.longestStall)
+		{
+			m_stats.longestStall = m_stall;
+		}
+	}
+	else
+	{
+		m_stall = 0;
+	}
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Called by the source, on the frame thread, when a load it started is over. </summary>
+///
+/// <param name="cell">   The index of the cell. </param>
+/// <param name="result"> true if the cell is in memory, false if the load failed. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void WorldStreamerClass::CellLoaded(int cell, bool result)
+{
+	// A load that finishes after a shutdown isn't known any more.
+	if(cell < 0 || cell >= (int)m_cells.size() || m_cells[cell].state != CELL_LOADING)
+	{
+		return;
+	}
+
+	m_stats.loadingCells--;
+
+	if(!result)
+	{
+		LOG_WARNING(LOG_CATEGORY_RESOURCE, "Could not load world cell %d, it is left out.", cell);
+		RemoveActive(cell);
+		m_cells[cell].state = CELL_FAILED;
+		m_stats.failedLoads++;
+		return;
+	}
+
+	m_cells[cell].state = CELL_RESIDENT;
+	m_stats.residentCells++;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the cell a point is in. </summary>
+///
+/// <param name="x"> The position along x. </param>
+/// <param name="z"> The position along z. </param>
+///
+/// <returns> The index of the cell, -1 outside the world. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+int WorldStreamerClass::GetCellIndex(float x, float z)
+{
+	int cellX, cellZ;
+
+	if(x < 0.0f || z < 0.0f || m_cellSize <= 0.0f)
+	{
+		return -1;
+	}
+
+	cellX = (int)(x / m_cellSize);
+	cellZ = (int)(z / m_cellSize);
+	if(cellX >= m_cellsX || cellZ >= m_cellsZ)
+	{
+		return -1;
+	}
+
+	return cellZ * m_cellsX + cellX;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the state of a cell. </summary>
+///
+/// <param name="cell"> The index of the cell. </param>
+///
+/// <returns> The state, unloaded for an unknown cell. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+CellState WorldStreamerClass::GetCellState(int cell)
+{
+	if(cell < 0 || cell >= (int)m_cells.size())
+	{
+		return CELL_UNLOADED;
+	}
+
+	return m_cells[cell].state;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the counters. </summary>
+///
+/// <param name="stats"> [out] The stats. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void WorldStreamerClass::GetStats(WorldStreamerStats& stats)
+{
+	stats = m_stats;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Gets the distance from a point to the nearest point of a cell. </summary>
+///
+/// <param name="cell"> The index of the cell. </param>
+/// <param name="x">	The position along x. </param>
+/// <param name="z">	The position along z. </param>
+///
+/// <returns> The distance, 0 inside the cell. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+float WorldStreamerClass::GetCellDistance(int cell, float x, float z)
+{
+	float minX, minZ, distanceX, distanceZ;
+
+	minX = (float)(cell % m_cellsX) * m_cellSize;
+	minZ = (float)(cell / m_cellsX) * m_cellSize;
+
+	distanceX = x < minX ? minX - x : (x > minX + m_cellSize ? x - minX - m_cellSize : 0.0f);
+	distanceZ = z < minZ ? minZ - z : (z > minZ + m_cellSize ? z - minZ - m_cellSize : 0.0f);
+
+	return sqrtf(distanceX * distanceX + distanceZ * distanceZ);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Ranks a cell, lower comes first. The rank is the distance to the cell less the way the
+/// 	camera covers towards its center in the look ahead time; a cell off to the side or behind
+/// 	keeps its distance.
+/// </summary>
+///
+/// <param name="cell"> The index of the cell. </param>
+/// <param name="x">	The camera position along x. </param>
+/// <param name="z">	The camera position along z. </param>
+///
+/// <returns> The rank. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+float WorldStreamerClass::RankCell(int cell, float x, float z)
+{
+	float distance, centerX, centerZ, length, toward;
+
+	distance = GetCellDistance(cell, x, z);
+
+	centerX = ((float)(cell % m_cellsX) + 0.5f) * m_cellSize - x;
+	centerZ = ((float)(cell / m_cellsX) + 0.5f) * m_cellSize - z;
+	length = sqrtf(centerX * centerX + centerZ * centerZ);
+	if(length > 0.0f)
+	{
+		toward = (centerX * m_velocityX + centerZ * m_velocityZ) / length;
+		if(toward > 0.0f)
+		{
+			distance -= toward * WORLD_STREAMER_LOOK_AHEAD;
+		}
+	}
+
+	return distance > 0.0f ? distance : 0.0f;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Unloads a resident cell. </summary>
+///
+/// <param name="cell"> The index of the cell. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void WorldStreamerClass::Unload(int cell)
+{
+	m_source->UnloadCell(cell);
+	m_stats.residentCells--;
+	m_stats.unloads++;
+
+	RemoveActive(cell);
+	m_cells[cell].state = CELL_UNLOADED;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Takes a cell out of the active list and gives its memory back to the budget. </summary>
+///
+/// <param name="cell"> The index of the cell. </param>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void WorldStreamerClass::RemoveActive(int cell)
+{
+	int slot;
+
+	// Move the last active cell into the slot.
+	slot = m_cells[cell].active;
+	m_active[slot] = m_active.back();
+	m_cells[m_active[slot]].active = slot;
+	m_active.pop_back();
+
+	m_cells[cell].active = -1;
+	m_stats.usedBytes -= m_cells[cell].size;
+
+	return;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Makes room in the budget for a load by evicting the resident cells ranked behind it by
+/// 	more than the gap between the radii, farthest first. Once it has to evict it goes on down
+/// 	to the low water mark, so the next loads don't evict a cell each. Nothing is evicted if
+/// 	that would still not make enough room.
+/// </summary>
+///
+/// <param name="size"> The size of the load. </param>
+/// <param name="rank"> The rank of the cell to load. </param>
+///
+/// <returns> true if the load fits now, false if it has to wait. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool WorldStreamerClass::MakeRoom(unsigned long long size, float rank)
+{
+	unsigned long long freed, lowWater;
+	unsigned int i;
+	int cell;
+
+	PROFILE_FUNCTION();
+
+	m_evictable.clear();
+	freed = 0;
+	for(i=0; i<m_active.size(); i++)
+	{
+		cell = m_active[i];
+		if(m_cells[cell].state == CELL_RESIDENT && m_cells[cell].rank > rank + m_unloadRadius - m_loadRadius)
+		{
+			m_evictable.push_back(make_pair(m_cells[cell].rank, cell));
+			freed += m_cells[cell].size;
+		}
+	}
+
+	if(m_stats.usedBytes - freed + size > m_stats.budget)
+	{
+		return false;
+	}
+
+	sort(m_evictable.begin(), m_evictable.end());
+
+	lowWater = (unsigned long long)(m_stats.budget * WORLD_STREAMER_LOW_WATER);
+	i = (unsigned int)m_evictable.size();
+	while(i > 0 && (m_stats.usedBytes + size > m_stats.budget || m_stats.usedBytes + size > lowWater))
+	{
+		i--;
+		Unload(m_evictable[i].second);
+		m_stats.evictions++;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Query if a cell within the stall radius of the camera isn't resident. </summary>
+///
+/// <param name="x"> The camera position along x. </param>
+/// <param name="z"> The camera position along z. </param>
+///
+/// <returns> true if the camera is next to a hole, false if not. </returns>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+bool WorldStreamerClass::CheckStall(float x, float z)
+{
+	int cell, cellX, cellZ, minX, maxX, minZ, maxZ;
+
+	minX = max((int)floorf((x - WORLD_STREAMER_STALL_RADIUS) / m_cellSize), 0);
+	maxX = min((int)floorf((x + WORLD_STREAMER_STALL_RADIUS) / m_cellSize), m_cellsX - 1);
+	minZ = max((int)floorf((z - WORLD_STREAMER_STALL_RADIUS) / m_cellSize), 0);
+	maxZ = min((int)floorf((z + WORLD_STREAMER_STALL_RADIUS) / m_cellSize), m_cellsZ - 1);
+
+	for(cellZ=minZ; cellZ<=maxZ; cellZ++)
+	{
+		for(cellX=minX; cellX<=maxX; cellX++)
+		{
+			cell = cellZ * m_cellsX + cellX;
+			if((m_cells[cell].state == CELL_UNLOADED || m_cells[cell].state == CELL_LOADING) && GetCellDistance(cell, x, z) <= WORLD_STREAMER_STALL_RADIUS)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// file:	worldstreamerclass.h
+//
+// summary:	Declares the worldstreamerclass class
+////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef _WORLDSTREAMERCLASS_H_
+#define _WORLDSTREAMERCLASS_H_
+
+// System Includes.
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Includes.
+#include "streamablecellclass.h"
+
+// Globals.
+const float WORLD_STREAMER_LOAD_RADIUS = 192.0f;
+const float WORLD_STREAMER_UNLOAD_RADIUS = 256.0f;
+const float WORLD_STREAMER_STALL_RADIUS = 32.0f;
+const float WORLD_STREAMER_LOOK_AHEAD = 2.0f;
+const float WORLD_STREAMER_VELOCITY_SMOOTHING = 0.1f;
+const float WORLD_STREAMER_LOW_WATER = 0.85f;
+const int WORLD_STREAMER_LOADS_PER_FRAME = 2;
+const int WORLD_STREAMER_UNLOADS_PER_FRAME = 4;
+const int WORLD_STREAMER_MAX_LOADING = 8;
+const unsigned long long WORLD_STREAMER_BYTES_PER_FRAME = 8 * 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary> Values that represent the states of a cell. </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+enum CellState
+{
+	CELL_UNLOADED,
+	CELL_LOADING,
+	CELL_RESIDENT,
+	CELL_FAILED
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Counters of the streamer. The memory counts the resident cells and the ones loading, a
+/// 	load reserves its size when it starts. A stall is a frame where a cell next to the camera
+/// 	wasn't resident, the frame would have drawn a hole.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+struct WorldStreamerStats
+{
+	unsigned long long budget;
+	unsigned long long usedBytes;
+	unsigned long long peakUsedBytes;
+	int residentCells;
+	int loadingCells;
+	unsigned long frames;
+	unsigned long loads;
+	unsigned long unloads;
+	unsigned long evictions;
+	unsigned long failedLoads;
+	unsigned long stallFrames;
+	unsigned long longestStall;
+	unsigned long budgetLimitedFrames;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+/// <summary>
+/// 	Streams the world in and out around the camera. The world is a grid of square cells on the
+/// 	xz plane, starting at the origin; what a cell holds is up to the StreamableCellClass.
+///
+/// 	Update is given the camera position every frame and works out the velocity from it. A
+/// 	cell is ranked by its distance to the camera, less the way the camera will cover towards
+/// 	it in the look ahead time, so the cells ahead come in before the ones behind. The cells
+/// 	ranked under the load radius are loaded nearest first, and a cell is unloaded only once it
+/// 	ranks past the unload radius; the gap between the two keeps a camera going back and forth
+/// 	on a cell border from loading and unloading the same cells.
+///
+/// 	The loads started in a frame are capped in count and bytes, so streaming never hitches
+/// 	the frame, and so are the loads in flight, so a disk that can't keep up doesn't build a
+/// 	queue of cells the camera has already left behind the ones it needs now. The budget is hard: a load that doesn't fit evicts cells ranked well behind it,
+/// 	down to the low water mark so the next loads fit too, and if that isn't enough it waits.
+/// </summary>
+////////////////////////////////////////////////////////////////////////////////////////////////////
+class WorldStreamerClass
+{
+private:
+	struct CellType
+	{
+		CellState state;
+		unsigned long long size;
+		float rank;
+		int active;
+	};
+
+public:
+	WorldStreamerClass();
+	WorldStreamerClass(const WorldStreamerClass&);
+	~WorldStreamerClass();
+
+	bool Initialize(StreamableCellClass*, int, int, float, unsigned long long);
+	void Shutdown();
+
+	void SetRadii(float, float);
+	void SetFrameLimits(int, unsigned long long);
+
+	void Update(float, float, float);
+	void CellLoaded(int, bool);
+
+	int GetCellIndex(float, float);
+	CellState GetCellState(int);
+	void GetStats(WorldStreamerStats&);
+
+private:
+	float GetCellDistance(int, float, float);
+	float RankCell(int, float, float);
+	void Unload(int);
+	void RemoveActive(int);
+	bool MakeRoom(unsigned long long, float);
+	bool CheckStall(float, float);
+
+private:
+	StreamableCellClass* m_source;
+	vector<CellType> m_cells;
+	vector<int> m_active;
+	vector<pair<float, int> > m_candidates;
+	vector<pair<float, int> > m_evictable;
+	int m_cellsX;
+	int m_cellsZ;
+	float m_cellSize;
+	float m_loadRadius;
+	float m_unloadRadius;
+	int m_loadsPerFrame;
+	unsigned long long m_bytesPerFrame;
+	float m_positionX;
+	float m_positionZ;
+	float m_velocityX;
+	float m_velocityZ;
+	bool m_hasPosition;
+	unsigned long m_stall;
+	WorldStreamerStats m_stats;
+};
+
+#endif